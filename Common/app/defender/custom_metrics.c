@@ -0,0 +1,280 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "cbor.h"
+
+#include "metrics_collector.h"
+#include "custom_metrics.h"
+
+/* "name:100.0" */
+#define TASK_CPU_STRING_LEN    ( CUSTOM_METRICS_TASK_NAME_LEN + 7 )
+
+#define PERMILLE_MAX           1000U
+
+/*-----------------------------------------------------------*/
+
+void vCustomMetricsSetTasks( CustomMetrics_t * pxMetrics,
+                             const TaskStatsEntry_t * pxEntries,
+                             uint32_t ulNumEntries,
+                             uint32_t ulWindowRunTime )
+{
+    pxMetrics->ulNumTasks = 0;
+
+    for( uint32_t i = 0; ( i < ulNumEntries ) && ( i < CUSTOM_METRICS_TASKS_MAX ) && ( ulWindowRunTime > 0 ); i++ )
+    {
+        CustomMetricsTask_t * pxTask = &( pxMetrics->xTasks[ i ] );
+
+        ( void ) snprintf( pxTask->pcName, sizeof( pxTask->pcName ), "%s", pxEntries[ i ].pcTaskName );
+        pxTask->ulCpuPermille = ( uint32_t ) ( ( ( uint64_t ) pxEntries[ i ].ulRunTime * PERMILLE_MAX ) / ulWindowRunTime );
+
+        if( pxTask->ulCpuPermille > PERMILLE_MAX )
+        {
+            pxTask->ulCpuPermille = PERMILLE_MAX;
+        }
+
+        pxMetrics->ulNumTasks++;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void vCustomMetricsSetLatency( CustomMetricsLatency_t * pxLatency,
+                               const LatencyHist_t * pxHist )
+{
+    pxLatency->ulCount = pxHist->ulCount;
+    pxLatency->ulP50Ms = ulLatencyHistPercentile( pxHist, 50 );
+    pxLatency->ulP90Ms = ulLatencyHistPercentile( pxHist, 90 );
+    pxLatency->ulP99Ms = ulLatencyHistPercentile( pxHist, 99 );
+    pxLatency->ulMaxMs = pxHist->ulMaxMs;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Open "pcName": [ { "pcType": and leave the value to the caller */
+static CborError prvOpenMetric( CborEncoder * pxMapEncoder,
+                                CborEncoder * pxArrayEncoder,
+                                CborEncoder * pxValueEncoder,
+                                const char * pcName,
+                                const char * pcType )
+{
+    CborError xError = CborNoError;
+
+    xError = cbor_encode_text_stringz( pxMapEncoder, pcName );
+
+    if( METRICS_CBOR_OK( xError ) )
+    {
+        xError |= cbor_encoder_create_array( pxMapEncoder, pxArrayEncoder, 1 );
+    }
+
+    if( METRICS_CBOR_OK( xError ) )
+    {
+        xError |= cbor_encoder_create_map( pxArrayEncoder, pxValueEncoder, 1 );
+    }
+
+    if( METRICS_CBOR_OK( xError ) )
+    {
+        xError |= cbor_encode_text_stringz( pxValueEncoder, pcType );
+    }
+
+    return xError;
+}
+
+static CborError prvCloseMetric( CborEncoder * pxMapEncoder,
+                                 CborEncoder * pxArrayEncoder,
+                                 CborEncoder * pxValueEncoder )
+{
+    CborError xError = CborNoError;
+
+    xError = cbor_encoder_close_container( pxArrayEncoder, pxValueEncoder );
+
+    if( METRICS_CBOR_OK( xError ) )
+    {
+        xError |= cbor_encoder_close_container( pxMapEncoder, pxArrayEncoder );
+    }
+
+    return xError;
+}
+
+/*-----------------------------------------------------------*/
+
+static CborError prvEncodeNumber( CborEncoder * pxMapEncoder,
+                                  const char * pcName,
+                                  uint32_t ulValue )
+{
+    CborEncoder xArrayEncoder;
+    CborEncoder xValueEncoder;
+    CborError xError = CborNoError;
+
+    xError = prvOpenMetric( pxMapEncoder, &xArrayEncoder, &xValueEncoder, pcName, "number" );
+
+    if( METRICS_CBOR_OK( xError ) )
+    {
+        xError |= cbor_encode_uint( &xValueEncoder, ulValue );
+    }
+
+    if( METRICS_CBOR_OK( xError ) )
+    {
+        xError |= prvCloseMetric( pxMapEncoder, &xArrayEncoder, &xValueEncoder );
+    }
+
+    return xError;
+}
+
+/*-----------------------------------------------------------*/
+
+static CborError prvEncodeLatency( CborEncoder * pxMapEncoder,
+                                   const char * pcName,
+                                   const CustomMetricsLatency_t * pxLatency )
+{
+    CborEncoder xArrayEncoder;
+    CborEncoder xValueEncoder;
+    CborEncoder xListEncoder;
+    CborError xError = CborNoError;
+
+    xError = prvOpenMetric( pxMapEncoder, &xArrayEncoder, &xValueEncoder, pcName, "number_list" );
+
+    if( METRICS_CBOR_OK( xError ) )
+    {
+        xError |= cbor_encoder_create_array( &xValueEncoder, &xListEncoder, 4 );
+    }
+
+    if( METRICS_CBOR_OK( xError ) )
+    {
+        xError |= cbor_encode_uint( &xListEncoder, pxLatency->ulP50Ms );
+        xError |= cbor_encode_uint( &xListEncoder, pxLatency->ulP90Ms );
+        xError |= cbor_encode_uint( &xListEncoder, pxLatency->ulP99Ms );
+        xError |= cbor_encode_uint( &xListEncoder, pxLatency->ulMaxMs );
+    }
+
+    if( METRICS_CBOR_OK( xError ) )
+    {
+        xError |= cbor_encoder_close_container( &xValueEncoder, &xListEncoder );
+    }
+
+    if( METRICS_CBOR_OK( xError ) )
+    {
+        xError |= prvCloseMetric( pxMapEncoder, &xArrayEncoder, &xValueEncoder );
+    }
+
+    return xError;
+}
+
+/*-----------------------------------------------------------*/
+
+static CborError prvEncodeTasks( CborEncoder * pxMapEncoder,
+                                 const CustomMetrics_t * pxMetrics )
+{
+    CborEncoder xArrayEncoder;
+    CborEncoder xValueEncoder;
+    CborEncoder xListEncoder;
+    CborError xError = CborNoError;
+
+    xError = prvOpenMetric( pxMapEncoder, &xArrayEncoder, &xValueEncoder, "task_cpu", "string_list" );
+
+    if( METRICS_CBOR_OK( xError ) )
+    {
+        xError |= cbor_encoder_create_array( &xValueEncoder, &xListEncoder, pxMetrics->ulNumTasks );
+    }
+
+    for( uint32_t i = 0; ( i < pxMetrics->ulNumTasks ) && METRICS_CBOR_OK( xError ); i++ )
+    {
+        char pcEntry[ TASK_CPU_STRING_LEN ];
+        const CustomMetricsTask_t * pxTask = &( pxMetrics->xTasks[ i ] );
+
+        ( void ) snprintf( pcEntry, sizeof( pcEntry ), "%s:%lu.%lu",
+                           pxTask->pcName,
+                           ( unsigned long ) ( pxTask->ulCpuPermille / 10U ),
+                           ( unsigned long ) ( pxTask->ulCpuPermille % 10U ) );
+
+        xError |= cbor_encode_text_stringz( &xListEncoder, pcEntry );
+    }
+
+    if( METRICS_CBOR_OK( xError ) )
+    {
+        xError |= cbor_encoder_close_container( &xValueEncoder, &xListEncoder );
+    }
+
+    if( METRICS_CBOR_OK( xError ) )
+    {
+        xError |= prvCloseMetric( pxMapEncoder, &xArrayEncoder, &xValueEncoder );
+    }
+
+    return xError;
+}
+
+/*-----------------------------------------------------------*/
+
+CborError xCustomMetricsEncode( CborEncoder * pxCustomMetricsEncoder,
+                                const CustomMetrics_t * pxMetrics )
+{
+    CborError xError = CborNoError;
+
+    xError = prvEncodeNumber( pxCustomMetricsEncoder, "heap_min_free", pxMetrics->ulHeapMinFree );
+
+    if( METRICS_CBOR_OK( xError ) )
+    {
+        xError |= prvEncodeTasks( pxCustomMetricsEncoder, pxMetrics );
+    }
+
+    if( METRICS_CBOR_OK( xError ) )
+    {
+        xError |= prvEncodeNumber( pxCustomMetricsEncoder, "mqtt_pub_count", pxMetrics->xPublishLatency.ulCount );
+    }
+
+    if( METRICS_CBOR_OK( xError ) && ( pxMetrics->xPublishLatency.ulCount > 0 ) )
+    {
+        xError |= prvEncodeLatency( pxCustomMetricsEncoder, "mqtt_pub_ms", &( pxMetrics->xPublishLatency ) );
+    }
+
+    if( METRICS_CBOR_OK( xError ) )
+    {
+        xError |= prvEncodeNumber( pxCustomMetricsEncoder, "mx_spi_errors", pxMetrics->ulSpiErrors );
+        xError |= prvEncodeNumber( pxCustomMetricsEncoder, "mx_spi_drops", pxMetrics->ulSpiDrops );
+    }
+
+    if( METRICS_CBOR_OK( xError ) && pxMetrics->xHasFs )
+    {
+        xError |= prvEncodeNumber( pxCustomMetricsEncoder, "lfs_erases", pxMetrics->ulFsErases );
+        xError |= prvEncodeNumber( pxCustomMetricsEncoder, "lfs_prog_bytes", pxMetrics->ulFsProgBytes );
+        xError |= prvEncodeNumber( pxCustomMetricsEncoder, "lfs_errors", pxMetrics->ulFsErrors );
+    }
+
+    if( METRICS_CBOR_OK( xError ) )
+    {
+        xError |= prvEncodeNumber( pxCustomMetricsEncoder, "tls_hs_count", pxMetrics->xHandshakeLatency.ulCount );
+        xError |= prvEncodeNumber( pxCustomMetricsEncoder, "tls_hs_fail", pxMetrics->ulHandshakeFailures );
+    }
+
+    if( METRICS_CBOR_OK( xError ) && ( pxMetrics->xHandshakeLatency.ulCount > 0 ) )
+    {
+        xError |= prvEncodeLatency( pxCustomMetricsEncoder, "tls_hs_ms", &( pxMetrics->xHandshakeLatency ) );
+    }
+
+    return xError;
+}
@@ -0,0 +1,115 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+
+#ifndef _CUSTOM_METRICS_H
+#define _CUSTOM_METRICS_H
+
+/*
+ * Device Defender custom metrics ("cmet") for runtime performance.
+ *
+ * The values are gathered once per report into a CustomMetrics_t and
+ * encoded from there, so the encoder does not depend on FreeRTOS and can be
+ * exercised on the host. Counters are deltas over the report interval.
+ * Each metric is encoded as a single element array holding a map with one
+ * "number", "number_list" or "string_list" entry, as described at
+ * https://docs.aws.amazon.com/iot/latest/developerguide/dd-detect-custom-metrics.html
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cbor.h"
+
+#include "latency_hist.h"
+#include "task_stats.h"
+
+/* Tasks reported in "task_cpu", in decreasing order of CPU share */
+#define CUSTOM_METRICS_TASKS_MAX        6
+
+/* Matches configMAX_TASK_NAME_LEN */
+#define CUSTOM_METRICS_TASK_NAME_LEN    32
+
+typedef struct
+{
+    char pcName[ CUSTOM_METRICS_TASK_NAME_LEN ];
+    uint32_t ulCpuPermille; /* Share of the interval spent in the task, in 0.1% */
+} CustomMetricsTask_t;
+
+typedef struct
+{
+    uint32_t ulCount;
+    uint32_t ulP50Ms;
+    uint32_t ulP90Ms;
+    uint32_t ulP99Ms;
+    uint32_t ulMaxMs;
+} CustomMetricsLatency_t;
+
+typedef struct
+{
+    uint32_t ulHeapMinFree;                                /* heap_min_free */
+    uint32_t ulNumTasks;                                   /* task_cpu */
+    CustomMetricsTask_t xTasks[ CUSTOM_METRICS_TASKS_MAX ];
+    CustomMetricsLatency_t xPublishLatency;                /* mqtt_pub_count, mqtt_pub_ms */
+    uint32_t ulSpiErrors;                                  /* mx_spi_errors */
+    uint32_t ulSpiDrops;                                   /* mx_spi_drops */
+    bool xHasFs;                                           /* lfs_* are only reported with a file system */
+    uint32_t ulFsErases;                                   /* lfs_erases */
+    uint32_t ulFsProgBytes;                                /* lfs_prog_bytes */
+    uint32_t ulFsErrors;                                   /* lfs_errors */
+    CustomMetricsLatency_t xHandshakeLatency;              /* tls_hs_count, tls_hs_ms */
+    uint32_t ulHandshakeFailures;                          /* tls_hs_fail */
+} CustomMetrics_t;
+
+/**
+ * @brief Fill the task CPU shares from a task stats interval.
+ *
+ * @param[out] pxMetrics Metrics to update.
+ * @param[in] pxEntries Per task run time over the interval, sorted by
+ * decreasing run time as returned by ulTaskStatsInterval().
+ * @param[in] ulNumEntries Number of entries in pxEntries.
+ * @param[in] ulWindowRunTime Length of the interval in run time counter ticks.
+ */
+void vCustomMetricsSetTasks( CustomMetrics_t * pxMetrics,
+                             const TaskStatsEntry_t * pxEntries,
+                             uint32_t ulNumEntries,
+                             uint32_t ulWindowRunTime );
+
+/**
+ * @brief Summarize a latency histogram into the percentiles reported.
+ */
+void vCustomMetricsSetLatency( CustomMetricsLatency_t * pxLatency,
+                               const LatencyHist_t * pxHist );
+
+/**
+ * @brief Encode the custom metrics into the open "cmet" map.
+ *
+ * Latency percentiles are omitted when there were no samples in the interval.
+ */
+CborError xCustomMetricsEncode( CborEncoder * pxCustomMetricsEncoder,
+                                const CustomMetrics_t * pxMetrics );
+
+#endif /* _CUSTOM_METRICS_H */
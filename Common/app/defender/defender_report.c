@@ -0,0 +1,161 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cbor.h"
+
+#include "defender_report.h"
+
+#define REPORT_VERSION    "1.0"
+
+/*-----------------------------------------------------------*/
+
+static CborError prvEncodeHeader( CborEncoder * pxMapEncoder,
+                                  uint64_t ullReportId )
+{
+    CborEncoder xHeaderEncoder;
+    CborError xError = CborNoError;
+
+    xError = cbor_encode_text_stringz( pxMapEncoder, "hed" );
+
+    if( METRICS_CBOR_OK( xError ) )
+    {
+        xError |= cbor_encoder_create_map( pxMapEncoder, &xHeaderEncoder, 2 );
+    }
+
+    if( METRICS_CBOR_OK( xError ) )
+    {
+        xError |= cbor_encode_text_stringz( &xHeaderEncoder, "rid" );
+        xError |= cbor_encode_uint( &xHeaderEncoder, ullReportId );
+        xError |= cbor_encode_text_stringz( &xHeaderEncoder, "v" );
+        xError |= cbor_encode_text_stringz( &xHeaderEncoder, REPORT_VERSION );
+    }
+
+    if( METRICS_CBOR_OK( xError ) )
+    {
+        xError |= cbor_encoder_close_container( pxMapEncoder, &xHeaderEncoder );
+    }
+
+    return xError;
+}
+
+/*-----------------------------------------------------------*/
+
+static CborError prvEncodeMetrics( CborEncoder * pxMapEncoder,
+                                   const char * pcName,
+                                   const MetricsCollectorFn_t * pxCollectors,
+                                   size_t xNumCollectors )
+{
+    CborEncoder xMetricsEncoder;
+    CborError xError = CborNoError;
+
+    xError = cbor_encode_text_stringz( pxMapEncoder, pcName );
+
+    if( METRICS_CBOR_OK( xError ) )
+    {
+        xError |= cbor_encoder_create_map( pxMapEncoder, &xMetricsEncoder, CborIndefiniteLength );
+    }
+
+    for( size_t i = 0; ( i < xNumCollectors ) && METRICS_CBOR_OK( xError ); i++ )
+    {
+        xError |= pxCollectors[ i ]( &xMetricsEncoder );
+    }
+
+    if( METRICS_CBOR_OK( xError ) )
+    {
+        xError |= cbor_encoder_close_container( pxMapEncoder, &xMetricsEncoder );
+    }
+
+    return xError;
+}
+
+/*-----------------------------------------------------------*/
+
+size_t xDefenderReportEncode( uint8_t * pucBuffer,
+                              size_t xBufferLen,
+                              uint64_t ullReportId,
+                              const MetricsCollectorFn_t * pxCollectors,
+                              size_t xNumCollectors,
+                              const MetricsCollectorFn_t * pxCustomCollectors,
+                              size_t xNumCustomCollectors,
+                              size_t * pxNeeded )
+{
+    CborEncoder xEncoder;
+    CborEncoder xMapEncoder;
+    CborError xError = CborNoError;
+    size_t xWritten = 0;
+
+    if( pucBuffer == NULL )
+    {
+        xBufferLen = 0;
+    }
+
+    cbor_encoder_init( &xEncoder, pucBuffer, xBufferLen, 0 );
+
+    xError = cbor_encoder_create_map( &xEncoder, &xMapEncoder, CborIndefiniteLength );
+
+    if( METRICS_CBOR_OK( xError ) )
+    {
+        xError |= prvEncodeHeader( &xMapEncoder, ullReportId );
+    }
+
+    if( METRICS_CBOR_OK( xError ) )
+    {
+        xError |= prvEncodeMetrics( &xMapEncoder, "met", pxCollectors, xNumCollectors );
+    }
+
+    if( METRICS_CBOR_OK( xError ) && ( xNumCustomCollectors > 0 ) )
+    {
+        xError |= prvEncodeMetrics( &xMapEncoder, "cmet", pxCustomCollectors, xNumCustomCollectors );
+    }
+
+    if( METRICS_CBOR_OK( xError ) )
+    {
+        xError |= cbor_encoder_close_container( &xEncoder, &xMapEncoder );
+    }
+
+    if( !METRICS_CBOR_OK( xError ) )
+    {
+        *pxNeeded = 0;
+    }
+    else if( cbor_encoder_get_extra_bytes_needed( &xEncoder ) > 0 )
+    {
+        /* The encoder stops writing at the end of the buffer and counts the
+         * rest of the report as extra bytes. */
+        *pxNeeded = xBufferLen + cbor_encoder_get_extra_bytes_needed( &xEncoder );
+    }
+    else
+    {
+        xWritten = cbor_encoder_get_buffer_size( &xEncoder, pucBuffer );
+        *pxNeeded = xWritten;
+    }
+
+    return xWritten;
+}
+
+/*-----------------------------------------------------------*/
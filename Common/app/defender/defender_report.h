@@ -0,0 +1,73 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+#ifndef _DEFENDER_REPORT_H
+#define _DEFENDER_REPORT_H
+
+/*
+ * Device Defender report encoding without a fixed size buffer.
+ *
+ * xDefenderReportEncode() first runs over an encoder without a buffer to find
+ * the exact size of the report, then the caller allocates that much and
+ * encodes again into the allocation, which is published as is. The format is
+ * described at
+ * https://docs.aws.amazon.com/iot/latest/developerguide/detect-device-side-metrics.html
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cbor.h"
+
+#include "metrics_collector.h"
+
+/**
+ * @brief Encode a Device Defender report.
+ *
+ * Pass a NULL buffer and a zero length to size the report.
+ *
+ * @param[out] pucBuffer Buffer to encode into, or NULL.
+ * @param[in] xBufferLen Length of pucBuffer.
+ * @param[in] ullReportId Report id placed in the header.
+ * @param[in] pxCollectors Collectors encoding the "met" map, in order.
+ * @param[in] xNumCollectors Number of entries in pxCollectors.
+ * @param[in] pxCustomCollectors Collectors encoding the "cmet" map of custom
+ * metrics, in order. The map is omitted if there are none.
+ * @param[in] xNumCustomCollectors Number of entries in pxCustomCollectors.
+ * @param[out] pxNeeded Total number of bytes the report needs.
+ *
+ * @return The number of bytes written, or 0 if the report did not fit in
+ * xBufferLen bytes (see pxNeeded) or a collector failed (pxNeeded is 0).
+ */
+size_t xDefenderReportEncode( uint8_t * pucBuffer,
+                              size_t xBufferLen,
+                              uint64_t ullReportId,
+                              const MetricsCollectorFn_t * pxCollectors,
+                              size_t xNumCollectors,
+                              const MetricsCollectorFn_t * pxCustomCollectors,
+                              size_t xNumCustomCollectors,
+                              size_t * pxNeeded );
+
+#endif /* _DEFENDER_REPORT_H */
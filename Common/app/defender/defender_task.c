@@ -31,8 +31,10 @@
  * related to device defender.
  *
  * This demo subscribes to the device defender topics. It then collects metrics
- * for the open ports and sockets on the device using FreeRTOS+TCP. Additionally
- * the stack high water mark and task ids are collected for custom metrics.
+ * for the open ports and sockets on the device using lwIP. Additionally
+ * runtime performance counters (CPU share per task, heap low water mark,
+ * MQTT publish and TLS handshake latencies, MXCHIP SPI errors and drops and
+ * flash wear) are collected as custom metrics.
  * These metrics are uses to generate a device defender report. The
  * report is then published, and the demo waits for a response from the device
  * defender service. Upon receiving the response or timing out, the demo
@@ -47,7 +49,8 @@
  */
 
 #include "logging_levels.h"
-#define LOG_LEVEL    LOG_ERROR
+#define LOG_LEVEL     LOG_ERROR
+#define LOG_MODULE    LOG_MODULE_DEFENDER
 #include "logging.h"
 
 
@@ -78,13 +81,14 @@
 /* Metrics collector. */
 #include "metrics_collector.h"
 
-#include "cbor.h"
+/* Report encoder. */
+#include "defender_report.h"
 
 #define TCP_PORTS_MAX                      10
 #define UDP_PORTS_MAX                      10
 #define CONNECTIONS_MAX                    10
 #define TASKS_MAX                          10
-#define REPORT_BUFFER_SIZE                 1024
+#define REPORT_ENCODE_ATTEMPTS             3
 
 #define REPORT_MAJOR_VERSION               1
 #define REPORT_MINOR_VERSION               0
@@ -121,12 +125,28 @@ struct MQTTAgentCommandContext
     char * ppcTopic[ NUM_TOPIC_STRINGS ];
     BaseType_t xWaitingForCallback;
     MQTTAgentHandle_t xAgentHandle;
+    uint8_t * pucPendingReport;
 };
 
 typedef struct MQTTAgentCommandContext DefenderAgentCtx_t;
 
 BaseType_t xExitFlag = pdFALSE;
 
+/* Collectors encoding the "met" map of each report, in report order. */
+static const MetricsCollectorFn_t pxMetricsCollectors[] =
+{
+    xGetNetworkStats,
+    xGetListeningTcpPorts,
+    xGetListeningUdpPorts,
+    xGetEstablishedConnections
+};
+
+/* Collectors encoding the "cmet" map of custom metrics. */
+static const MetricsCollectorFn_t pxCustomMetricsCollectors[] =
+{
+    xGetCustomMetrics
+};
+
 /*-----------------------------------------------------------*/
 
 /**
@@ -178,12 +198,19 @@ static void prvReportRejectedCallback( void * pxSubscriptionContext,
                                        MQTTPublishInfo_t * pxPublishInfo );
 
 /**
- * @brief Collect all the metrics to be sent in the device defender report.
+ * @brief Collect the device metrics and encode them into a report.
  *
- * @return true if all the metrics are successfully collected;
- * false otherwise.
+ * The report is sized with a pre-pass and encoded into an allocation of
+ * exactly that size, so it is not limited by a fixed buffer. If the metrics
+ * grow between the two passes, the report is sized again and re-encoded.
+ *
+ * @param[in] ullReportId Report id placed in the header.
+ * @param[out] pxReportLen Length of the report.
+ *
+ * @return The report, to be released with vPortFree(), or NULL on failure.
  */
-static CborError prvCollectDeviceMetrics( CborEncoder * pxEncoder );
+static uint8_t * prvBuildDeviceMetricsReport( uint64_t ullReportId,
+                                              size_t * pxReportLen );
 
 /**
  * @brief Publish the generated device defender report.
@@ -396,13 +423,18 @@ static void prvUnsubscribeFromDefenderTopics( DefenderAgentCtx_t * pxCtx )
 static void prvPrintHex( const uint8_t * pcPayload,
                          size_t xPayloadLen )
 {
-    for( uint32_t i = 0; i < xPayloadLen; i += 16 )
+    /* Reports are allocated to their exact length, so the last line may be
+     * shorter than 16 bytes. */
+    for( size_t i = 0; i < xPayloadLen; i += 16 )
     {
-        LogDebug( "\t%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X",
-                  pcPayload[ i + 0 ], pcPayload[ i + 1 ], pcPayload[ i + 2 ], pcPayload[ i + 3 ],
-                  pcPayload[ i + 4 ], pcPayload[ i + 5 ], pcPayload[ i + 6 ], pcPayload[ i + 7 ],
-                  pcPayload[ i + 8 ], pcPayload[ i + 9 ], pcPayload[ i + 10 ], pcPayload[ i + 11 ],
-                  pcPayload[ i + 12 ], pcPayload[ i + 13 ], pcPayload[ i + 14 ], pcPayload[ i + 15 ] );
+        char pcLine[ ( 2 * 16 ) + 1 ] = { 0 };
+
+        for( size_t j = 0; ( j < 16 ) && ( ( i + j ) < xPayloadLen ); j++ )
+        {
+            ( void ) snprintf( &( pcLine[ 2 * j ] ), 3, "%02X", pcPayload[ i + j ] );
+        }
+
+        LogDebug( "\t%s", pcLine );
     }
 }
 
@@ -476,57 +508,60 @@ static void prvReportRejectedCallback( void * pvCtx,
 
 /*-----------------------------------------------------------*/
 
-static CborError prvCollectDeviceMetrics( CborEncoder * pxEncoder )
+static uint8_t * prvBuildDeviceMetricsReport( uint64_t ullReportId,
+                                              size_t * pxReportLen )
 {
-    CborEncoder xMetricsEncoder;
-    CborError xError = CborNoError;
-
-    configASSERT( pxEncoder != NULL );
-
-    xError = cbor_encode_text_stringz( pxEncoder, "met" );
-    configASSERT_CONTINUE( xError == CborNoError );
-
-    if( xError == CborNoError )
+    const size_t xNumCollectors = sizeof( pxMetricsCollectors ) / sizeof( pxMetricsCollectors[ 0 ] );
+    const size_t xNumCustomCollectors = sizeof( pxCustomMetricsCollectors ) / sizeof( pxCustomMetricsCollectors[ 0 ] );
+    uint8_t * pucReport = NULL;
+    size_t xNeeded = 0;
+    size_t xLen = 0;
+
+    /* Both passes encode these snapshots, so they normally agree on the size.
+     * The custom metrics cover the time since the previous report. */
+    vMetricsCollectorSnapshot();
+    vCustomMetricsSnapshot();
+
+    /* Size pass: encode without a buffer. */
+    ( void ) xDefenderReportEncode( NULL, 0, ullReportId,
+                                    pxMetricsCollectors, xNumCollectors,
+                                    pxCustomMetricsCollectors, xNumCustomCollectors,
+                                    &xNeeded );
+
+    for( uint32_t ulAttempt = 0; ( ulAttempt < REPORT_ENCODE_ATTEMPTS ) && ( xLen == 0 ) && ( xNeeded > 0 ); ulAttempt++ )
     {
-        xError = cbor_encoder_create_map( pxEncoder, &xMetricsEncoder, CborIndefiniteLength );
-        configASSERT_CONTINUE( xError == CborNoError );
-    }
+        pucReport = pvPortMalloc( xNeeded );
 
-    if( xError == CborNoError )
-    {
-        xError = xGetNetworkStats( &xMetricsEncoder );
-        configASSERT_CONTINUE( xError == CborNoError );
-    }
+        if( pucReport == NULL )
+        {
+            LogError( "Failed to allocate %lu bytes for the defender report.", ( unsigned long ) xNeeded );
+            xNeeded = 0;
+        }
+        else
+        {
+            size_t xBufferLen = xNeeded;
 
-    if( xError == CborNoError )
-    {
-        xError = xGetListeningTcpPorts( &xMetricsEncoder );
-        configASSERT_CONTINUE( xError == CborNoError );
-    }
+            xLen = xDefenderReportEncode( pucReport, xBufferLen, ullReportId,
+                                          pxMetricsCollectors, xNumCollectors,
+                                          pxCustomMetricsCollectors, xNumCustomCollectors,
+                                          &xNeeded );
 
-    if( xError == CborNoError )
-    {
-        xError = xGetListeningUdpPorts( &xMetricsEncoder );
-        configASSERT_CONTINUE( xError == CborNoError );
-    }
-
-    if( xError == CborNoError )
-    {
-        xError = xGetEstablishedConnections( &xMetricsEncoder );
-        configASSERT_CONTINUE( xError == CborNoError );
+            if( xLen == 0 )
+            {
+                /* A collector reported more than in the size pass. */
+                LogDebug( "Defender report grew from %lu to %lu bytes.",
+                          ( unsigned long ) xBufferLen, ( unsigned long ) xNeeded );
+                vPortFree( pucReport );
+                pucReport = NULL;
+            }
+        }
     }
 
-    if( xError == CborNoError )
-    {
-        xError = cbor_encoder_close_container( pxEncoder, &xMetricsEncoder );
-        configASSERT_CONTINUE( xError == CborNoError );
-    }
+    *pxReportLen = xLen;
 
-    return xError;
+    return pucReport;
 }
 
-
-
 /*-----------------------------------------------------------*/
 
 static bool prvPublishDeviceMetricsReport( DefenderAgentCtx_t * pxCtx,
@@ -536,6 +571,7 @@ static bool prvPublishDeviceMetricsReport( DefenderAgentCtx_t * pxCtx,
     static MQTTPublishInfo_t xPublishInfo = { 0 };
     MQTTAgentCommandInfo_t xCommandParams = { 0 };
     uint32_t ulStatus = MQTTSuccess;
+    TickType_t xStartTicks;
 
     xPublishInfo.qos = MQTTQoS1;
     xPublishInfo.pTopicName = pxCtx->ppcTopic[ IDX_PUBLISH ];
@@ -549,6 +585,8 @@ static bool prvPublishDeviceMetricsReport( DefenderAgentCtx_t * pxCtx,
 
     pxCtx->xWaitingForCallback = pdTRUE;
 
+    xStartTicks = xTaskGetTickCount();
+
     ulStatus = MQTTAgent_Publish( pxCtx->xAgentHandle,
                                   &xPublishInfo,
                                   &xCommandParams );
@@ -568,6 +606,10 @@ static bool prvPublishDeviceMetricsReport( DefenderAgentCtx_t * pxCtx,
         {
             LogError( "Failed to publish report." );
         }
+        else if( ulStatus == MQTTSuccess )
+        {
+            vMqttAgentRecordPublishLatency( ( xTaskGetTickCount() - xStartTicks ) * portTICK_PERIOD_MS );
+        }
     }
 
     LogDebug( "Printing sent payload Len: %ld.", ulReportLength );
@@ -597,8 +639,6 @@ void vDefenderAgentTask( void * pvParameters )
 
     xExitFlag = pdFALSE;
 
-    uint8_t pucReportBuffer[ REPORT_BUFFER_SIZE ] = { 0 };
-
     /* Remove compiler warnings about unused parameters. */
     ( void ) pvParameters;
 
@@ -658,71 +698,22 @@ void vDefenderAgentTask( void * pvParameters )
         uint32_t ulNotificationValue = 0;
         ReportStatus_t xReportStatus = ReportStatusNotReceived;
 
-        CborEncoder xEncoder;
-        CborEncoder xMapEncoder;
-        CborEncoder xHeaderEncoder;
-
-        CborError xError = CborNoError;
-
-        cbor_encoder_init( &xEncoder, pucReportBuffer, REPORT_BUFFER_SIZE, 0 );
-
-        xError = cbor_encoder_create_map( &xEncoder, &xMapEncoder, CborIndefiniteLength );
-        configASSERT_CONTINUE( xError == CborNoError );
-
-        if( xError == CborNoError )
-        {
-            xError = cbor_encode_text_stringz( &xMapEncoder, "hed" );
-            configASSERT_CONTINUE( xError == CborNoError );
-        }
-
-        /* Add Header */
-        if( xError == CborNoError )
-        {
-            xError = cbor_encoder_create_map( &xMapEncoder, &xHeaderEncoder, 2 );
-            configASSERT_CONTINUE( xError == CborNoError );
-        }
-
-        /* Report ID */
-        if( xError == CborNoError )
-        {
-            xError = cbor_encode_text_stringz( &xHeaderEncoder, "rid" );
-            configASSERT_CONTINUE( xError == CborNoError );
-
-            xError |= cbor_encode_uint( &xHeaderEncoder, ulReportId );
-            configASSERT_CONTINUE( xError == CborNoError );
-        }
+        uint8_t * pucReport = NULL;
+        size_t xReportLen = 0;
 
-        /* Version */
-        if( xError == CborNoError )
+        /* A report whose publish timed out may still have been referenced by
+         * the MQTT agent, so it is only released one reporting interval later. */
+        if( xCtx.pucPendingReport != NULL )
         {
-            xError = cbor_encode_text_stringz( &xHeaderEncoder, "v" );
-            configASSERT_CONTINUE( xError == CborNoError );
-
-            xError = cbor_encode_text_stringz( &xHeaderEncoder, "1.0" );
-            configASSERT_CONTINUE( xError == CborNoError );
+            vPortFree( xCtx.pucPendingReport );
+            xCtx.pucPendingReport = NULL;
         }
 
-        if( xError == CborNoError )
-        {
-            xError = cbor_encoder_close_container( &xMapEncoder, &xHeaderEncoder );
-            configASSERT_CONTINUE( xError == CborNoError );
-        }
+        /* Collect device metrics. */
+        LogInfo( "Collecting device metrics..." );
+        pucReport = prvBuildDeviceMetricsReport( ulReportId, &xReportLen );
 
-        if( xError == CborNoError )
-        {
-            /* Collect device metrics. */
-            LogInfo( "Collecting device metrics..." );
-            xError = prvCollectDeviceMetrics( &xMapEncoder );
-            configASSERT_CONTINUE( xError == CborNoError );
-        }
-
-        if( xError == CborNoError )
-        {
-            xError = cbor_encoder_close_container( &xEncoder, &xMapEncoder );
-            configASSERT_CONTINUE( xError == CborNoError );
-        }
-
-        if( xError != CborNoError )
+        if( pucReport == NULL )
         {
             LogError( "Failed to collect device metrics." );
         }
@@ -730,17 +721,23 @@ void vDefenderAgentTask( void * pvParameters )
         /* Format defined here:
          * https://docs.aws.amazon.com/iot/latest/developerguide/detect-device-side-metrics.html
          */
-        if( xError == CborNoError )
+        if( pucReport != NULL )
         {
-            size_t xLen = cbor_encoder_get_buffer_size( &xEncoder, pucReportBuffer );
             LogInfo( "Publishing device defender report." );
 
-            xSuccess = prvPublishDeviceMetricsReport( &xCtx, pucReportBuffer, xLen );
+            xSuccess = prvPublishDeviceMetricsReport( &xCtx, pucReport, xReportLen );
 
             if( xSuccess != true )
             {
                 LogError( "Failed to publish device defender report." );
+                xCtx.pucPendingReport = pucReport;
+            }
+            else
+            {
+                vPortFree( pucReport );
             }
+
+            pucReport = NULL;
         }
 
         /* Wait for the response to our report */
@@ -779,6 +776,11 @@ void vDefenderAgentTask( void * pvParameters )
 
     prvUnsubscribeFromDefenderTopics( &xCtx );
 
+    if( xCtx.pucPendingReport != NULL )
+    {
+        vPortFree( xCtx.pucPendingReport );
+    }
+
     prvClearCtx( &xCtx );
 
 
@@ -31,6 +31,32 @@
 #include <stddef.h>
 #include "cbor.h"
 
+/**
+ * @brief Check the result of a CBOR encoder call while building a report.
+ *
+ * Reports are sized with a pre-pass over an encoder without a buffer. TinyCBOR
+ * keeps counting the bytes needed once it runs out of space, so
+ * CborErrorOutOfMemory is not treated as a failure and encoding continues.
+ */
+#define METRICS_CBOR_OK( xError )    ( ( ( xError ) & ~CborErrorOutOfMemory ) == CborNoError )
+
+/**
+ * @brief A function encoding one group of metrics into the "met" or "cmet" map.
+ *
+ * Collectors are called once to size a report and again to fill it, so they
+ * must not have side effects beyond encoding. The metrics may change between
+ * the two calls; the caller retries with the new size if they grew.
+ */
+typedef CborError ( * MetricsCollectorFn_t )( CborEncoder * pxMetricsEncoder );
+
+/**
+ * @brief Copy the network metrics out of lwIP.
+ *
+ * Takes the TCPIP core lock once for a short copy. The collectors below encode
+ * the most recent snapshot and do not lock.
+ */
+void vMetricsCollectorSnapshot( void );
+
 /**
  * @brief Get network stats.
  *
@@ -57,4 +83,17 @@ CborError xGetListeningUdpPorts( CborEncoder * pxMetricsEncoder );
  */
 CborError xGetEstablishedConnections( CborEncoder * pxMetricsEncoder );
 
+/**
+ * @brief Gather the runtime performance custom metrics.
+ *
+ * Counters and latencies cover the time since the previous call, so it is
+ * called once per report.
+ */
+void vCustomMetricsSnapshot( void );
+
+/**
+ * @brief Encode the most recent custom metrics snapshot into the "cmet" map.
+ */
+CborError xGetCustomMetrics( CborEncoder * pxCustomMetricsEncoder );
+
 #endif /* __METRICS_COLLECTOR_H__ */
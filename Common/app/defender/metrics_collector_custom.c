@@ -0,0 +1,174 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+/*
+ * Runtime performance custom metrics for the Device Defender report.
+ *
+ * vCustomMetricsSnapshot() is called once per report by the Defender task.
+ * It reads counters which the subsystems already maintain: the kernel run
+ * time counters, the heap low water mark, the publish and TLS handshake
+ * latency histograms, the MXCHIP SPI and TX queue statistics and the
+ * littlefs wear counters. Each source is a fixed size copy, so the cost of a
+ * snapshot is bounded by the number of tasks and does not grow with uptime or
+ * traffic. Cumulative counters are reported as deltas over the interval.
+ */
+
+/* Standard includes. */
+#include <stdint.h>
+#include <string.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Interface includes. */
+#include "metrics_collector.h"
+#include "custom_metrics.h"
+
+/* Sources. */
+#include "task_stats.h"
+#include "mqtt_agent_task.h"
+#include "mbedtls_transport.h"
+#include "mx_netconn.h"
+#include "kvstore_config.h"
+
+#if defined( KV_STORE_NVIMPL_LITTLEFS ) && ( KV_STORE_NVIMPL_LITTLEFS == 1 )
+#include "lfs.h"
+#include "fs/lfs_port.h"
+#define METRICS_HAS_LFS    1
+#else
+#define METRICS_HAS_LFS    0
+#endif
+
+#include "cbor.h"
+
+/*-----------------------------------------------------------*/
+
+typedef struct
+{
+    TaskStatsInterval_t xTaskInterval;
+    MxSpiStats_t xSpiStats;
+    uint32_t ulTxDropped;
+#if METRICS_HAS_LFS
+    LfsPortStats_t xFsStats;
+#endif
+} MetricsPrevious_t;
+
+/* Counters at the previous snapshot */
+static MetricsPrevious_t xPrevious = { 0 };
+
+static CustomMetrics_t xCustomMetrics = { 0 };
+
+/* Scratch space for the snapshot, kept off the Defender task stack */
+static TaskStatsEntry_t xTaskEntries[ TASK_STATS_INTERVAL_TASKS ];
+static LatencyHist_t xLatencyHist;
+
+/*-----------------------------------------------------------*/
+
+static void prvSnapshotTasks( void )
+{
+    uint32_t ulNumEntries;
+    uint32_t ulWindowRunTime = 0;
+
+    ulNumEntries = ulTaskStatsInterval( &( xPrevious.xTaskInterval ),
+                                        xTaskEntries,
+                                        TASK_STATS_INTERVAL_TASKS,
+                                        &ulWindowRunTime );
+
+    /* Task names point into the TCBs. They are copied before this task
+     * blocks, so the idle task has no chance to free a deleted task first. */
+    vCustomMetricsSetTasks( &xCustomMetrics, xTaskEntries, ulNumEntries, ulWindowRunTime );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvSnapshotNetwork( void )
+{
+    MxSpiStats_t xSpiStats;
+    MxTxQueueStats_t xTxQueueStats[ MX_TX_CLASS_MAX ];
+    uint32_t ulTxDropped = 0;
+
+    net_get_spi_stats( &xSpiStats );
+    net_get_tx_queue_stats( xTxQueueStats );
+
+    for( uint32_t i = 0; i < MX_TX_CLASS_MAX; i++ )
+    {
+        ulTxDropped += xTxQueueStats[ i ].ulDropped;
+    }
+
+    xCustomMetrics.ulSpiErrors = ( xSpiStats.ulErrors - xPrevious.xSpiStats.ulErrors ) +
+                                 ( xSpiStats.ulHeaderErrors - xPrevious.xSpiStats.ulHeaderErrors );
+    xCustomMetrics.ulSpiDrops = ( xSpiStats.ulRxDropped - xPrevious.xSpiStats.ulRxDropped ) +
+                                ( ulTxDropped - xPrevious.ulTxDropped );
+
+    xPrevious.xSpiStats = xSpiStats;
+    xPrevious.ulTxDropped = ulTxDropped;
+
+    mbedtls_transport_take_handshake_stats( &xLatencyHist, &( xCustomMetrics.ulHandshakeFailures ) );
+    vCustomMetricsSetLatency( &( xCustomMetrics.xHandshakeLatency ), &xLatencyHist );
+
+    vMqttAgentTakePublishLatency( &xLatencyHist );
+    vCustomMetricsSetLatency( &( xCustomMetrics.xPublishLatency ), &xLatencyHist );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvSnapshotFs( void )
+{
+#if METRICS_HAS_LFS
+    LfsPortStats_t xFsStats;
+
+    lfs_port_get_stats( &xFsStats );
+
+    xCustomMetrics.xHasFs = true;
+    xCustomMetrics.ulFsErases = xFsStats.ulErases - xPrevious.xFsStats.ulErases;
+    xCustomMetrics.ulFsProgBytes = xFsStats.ulProgBytes - xPrevious.xFsStats.ulProgBytes;
+    xCustomMetrics.ulFsErrors = ( xFsStats.ulEraseErrors - xPrevious.xFsStats.ulEraseErrors ) +
+                                ( xFsStats.ulProgErrors - xPrevious.xFsStats.ulProgErrors );
+
+    xPrevious.xFsStats = xFsStats;
+#else
+    xCustomMetrics.xHasFs = false;
+#endif
+}
+
+/*-----------------------------------------------------------*/
+
+void vCustomMetricsSnapshot( void )
+{
+    xCustomMetrics.ulHeapMinFree = ( uint32_t ) xPortGetMinimumEverFreeHeapSize();
+
+    prvSnapshotTasks();
+    prvSnapshotNetwork();
+    prvSnapshotFs();
+}
+
+/*-----------------------------------------------------------*/
+
+CborError xGetCustomMetrics( CborEncoder * pxCustomMetricsEncoder )
+{
+    return xCustomMetricsEncode( pxCustomMetricsEncoder, &xCustomMetrics );
+}
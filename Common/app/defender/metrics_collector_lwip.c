@@ -24,8 +24,24 @@
  *
  */
 
+/*
+ * Network metrics for the Device Defender report.
+ *
+ * vMetricsCollectorSnapshot() copies everything the report needs out of lwIP
+ * in a single pass with the TCPIP core locked: the interface counters, which
+ * lwIP maintains as packets are processed, the interface names and one
+ * compact record per listening port and established connection. The
+ * collectors then encode the snapshot without holding the lock, and encode
+ * the same data in the size pass and in the encode pass of a report.
+ *
+ * The snapshot arrays are sized from the lwIP PCB pools, so they hold every
+ * PCB that can exist.
+ */
+
 /* Standard includes. */
 #include <stdint.h>
+#include <stdio.h>
+#include <string.h>
 
 /* Interface includes. */
 #include "metrics_collector.h"
@@ -39,6 +55,7 @@
 #include "lwip/tcp.h"           /* struct tcp_pcb */
 #include "lwip/udp.h"           /* struct udp_pcb */
 #include "lwip/priv/tcp_priv.h" /* tcp_listen_pcbs_t */
+#include "arch/perf.h"
 
 #include "cbor.h"
 
@@ -57,14 +74,66 @@
 #error "LWIP_BYTES_IN_OUT_UNSUPPORTED must be set to 0."
 #endif
 
+#if MEMP_MEM_MALLOC != 0
+#error "The metrics snapshot is sized from the lwIP PCB pools. MEMP_MEM_MALLOC must be set to 0."
+#endif
+
 #define UINT16_STR_LEN         5
 #define IPADDR_PORT_STR_LEN    ( IPADDR_STRLEN_MAX + sizeof( ':' ) + UINT16_STR_LEN + sizeof( '\0' ) )
 
+#define METRICS_MAX_NETIFS     4
+
 /* Variables defined in the LWIP source code. */
 extern struct tcp_pcb * tcp_active_pcbs;        /* List of all TCP PCBs that are in a state in which they accept or send data. */
 extern union tcp_listen_pcbs_t tcp_listen_pcbs; /* List of all TCP PCBs in LISTEN state. */
 extern struct udp_pcb * udp_pcbs;               /* List of UDP PCBs. */
 extern struct netif * netif_default;
+
+/*-----------------------------------------------------------*/
+
+typedef struct
+{
+    uint8_t ucIndex;
+    char pcName[ NETIF_NAMESIZE ];
+} MetricsNetif_t;
+
+typedef struct
+{
+    uint16_t usLocalPort;
+    uint8_t ucNetifIdx;
+} MetricsPort_t;
+
+typedef struct
+{
+    ip_addr_t xRemoteIp;
+    uint16_t usRemotePort;
+    uint16_t usLocalPort;
+    uint8_t ucNetifIdx;
+} MetricsConnection_t;
+
+typedef struct
+{
+    uint64_t xBytesIn;
+    uint64_t xBytesOut;
+    uint64_t xPktsIn;
+    uint64_t xPktsOut;
+
+    uint8_t ucDefaultNetifIdx; /* 0 when there is no default interface */
+    size_t xNumNetifs;
+    MetricsNetif_t pxNetifs[ METRICS_MAX_NETIFS ];
+
+    size_t xNumTcpPorts;
+    MetricsPort_t pxTcpPorts[ MEMP_NUM_TCP_PCB_LISTEN ];
+
+    size_t xNumUdpPorts;
+    MetricsPort_t pxUdpPorts[ MEMP_NUM_UDP_PCB ];
+
+    size_t xNumConnections;
+    MetricsConnection_t pxConnections[ MEMP_NUM_TCP_PCB ];
+} MetricsSnapshot_t;
+
+static MetricsSnapshot_t xSnapshot = { 0 };
+
 /*-----------------------------------------------------------*/
 
 static inline CborError cbor_add_kv_uint( CborEncoder * pxEncoder,
@@ -91,419 +160,343 @@ static inline CborError cbor_add_kv_str( CborEncoder * pxEncoder,
     return xError;
 }
 
-CborError xGetNetworkStats( CborEncoder * pxEncoder )
-{
-    CborError xError = CborNoError;
-
-    if( pxEncoder == NULL )
-    {
-        LogError( "Invalid parameter: pxEncoder: %p", pxEncoder );
-        xError = CborErrorImproperValue;
-    }
-    else
-    {
-        struct netif * pxNetif = NULL;
-
-        uint64_t xBytesIn = 0;
-        uint64_t xBytesOut = 0;
-        uint64_t xPktsIn = 0;
-        uint64_t xPktsOut = 0;
-
-        CborEncoder xNSEncoder;
-
-        xError = cbor_encode_text_stringz( pxEncoder, "ns" );
-        configASSERT_CONTINUE( xError == CborNoError );
+/*-----------------------------------------------------------*/
 
-        if( xError == CborNoError )
-        {
-            xError = cbor_encoder_create_map( pxEncoder, &xNSEncoder, 4 );
-            configASSERT_CONTINUE( xError == CborNoError );
-        }
+/* Called with the TCPIP core locked. */
+static void prvSnapshotNetifs( MetricsSnapshot_t * pxSnap )
+{
+    struct netif * pxNetif = NULL;
 
-        LOCK_TCPIP_CORE();
+    pxSnap->ucDefaultNetifIdx = ( netif_default != NULL ) ? netif_get_index( netif_default ) : 0;
 
 #if LWIP_SINGLE_NETIF
-        pxNetif = netif_default;
+    pxNetif = netif_default;
+
+    if( pxNetif != NULL )
 #else
-        NETIF_FOREACH( pxNetif )
+    NETIF_FOREACH( pxNetif )
 #endif /* LWIP_SINGLE_NETIF */
-        {
-            xBytesIn += pxNetif->mib2_counters.ifinoctets;
-            xBytesOut += pxNetif->mib2_counters.ifoutoctets;
-
-            xPktsIn += pxNetif->mib2_counters.ifinnucastpkts;
-            xPktsIn += pxNetif->mib2_counters.ifinucastpkts;
+    {
+        pxSnap->xBytesIn += pxNetif->mib2_counters.ifinoctets;
+        pxSnap->xBytesOut += pxNetif->mib2_counters.ifoutoctets;
 
-            xPktsOut += pxNetif->mib2_counters.ifoutucastpkts;
-            xPktsOut += pxNetif->mib2_counters.ifoutnucastpkts;
-        }
+        pxSnap->xPktsIn += pxNetif->mib2_counters.ifinnucastpkts;
+        pxSnap->xPktsIn += pxNetif->mib2_counters.ifinucastpkts;
 
-        UNLOCK_TCPIP_CORE();
+        pxSnap->xPktsOut += pxNetif->mib2_counters.ifoutucastpkts;
+        pxSnap->xPktsOut += pxNetif->mib2_counters.ifoutnucastpkts;
 
-        if( xError == CborNoError )
+        if( pxSnap->xNumNetifs < METRICS_MAX_NETIFS )
         {
-            xError |= cbor_add_kv_uint( &xNSEncoder, "pi", xPktsIn );
-            configASSERT_CONTINUE( xError == CborNoError );
-
-            xError |= cbor_add_kv_uint( &xNSEncoder, "po", xPktsOut );
-            configASSERT_CONTINUE( xError == CborNoError );
+            MetricsNetif_t * pxEntry = &( pxSnap->pxNetifs[ pxSnap->xNumNetifs ] );
 
-            xError = cbor_add_kv_uint( &xNSEncoder, "bi", xBytesIn );
-            configASSERT_CONTINUE( xError == CborNoError );
+            pxEntry->ucIndex = netif_get_index( pxNetif );
 
-            xError |= cbor_add_kv_uint( &xNSEncoder, "bo", xBytesOut );
-            configASSERT_CONTINUE( xError == CborNoError );
-        }
-
-        if( xError == CborNoError )
-        {
-            xError = cbor_encoder_close_container( pxEncoder, &xNSEncoder );
+            if( netif_index_to_name( pxEntry->ucIndex, pxEntry->pcName ) != NULL )
+            {
+                pxSnap->xNumNetifs++;
+            }
         }
     }
-
-    return xError;
 }
 
-/*-----------------------------------------------------------*/
-
-static size_t xCountListeningTcpPorts( void )
+/* Called with the TCPIP core locked. */
+static void prvSnapshotPcbs( MetricsSnapshot_t * pxSnap )
 {
-    size_t xPortCount = 0;
-
-    for( struct tcp_pcb_listen * pxCurPcb = tcp_listen_pcbs.listen_pcbs; pxCurPcb != NULL; pxCurPcb = pxCurPcb->next )
+    for( struct tcp_pcb_listen * pxCurPcb = tcp_listen_pcbs.listen_pcbs;
+         ( pxCurPcb != NULL ) && ( pxSnap->xNumTcpPorts < MEMP_NUM_TCP_PCB_LISTEN );
+         pxCurPcb = pxCurPcb->next )
     {
         if( pxCurPcb->state == LISTEN )
         {
-            xPortCount++;
+            pxSnap->pxTcpPorts[ pxSnap->xNumTcpPorts ].usLocalPort = pxCurPcb->local_port;
+            pxSnap->pxTcpPorts[ pxSnap->xNumTcpPorts ].ucNetifIdx = pxCurPcb->netif_idx;
+            pxSnap->xNumTcpPorts++;
         }
     }
 
-    return xPortCount;
-}
+    for( struct udp_pcb * pxCurPcb = udp_pcbs;
+         ( pxCurPcb != NULL ) && ( pxSnap->xNumUdpPorts < MEMP_NUM_UDP_PCB );
+         pxCurPcb = pxCurPcb->next )
+    {
+        pxSnap->pxUdpPorts[ pxSnap->xNumUdpPorts ].usLocalPort = pxCurPcb->local_port;
+        pxSnap->pxUdpPorts[ pxSnap->xNumUdpPorts ].ucNetifIdx = pxCurPcb->netif_idx;
+        pxSnap->xNumUdpPorts++;
+    }
 
-/*-----------------------------------------------------------*/
+    for( struct tcp_pcb * pxCurPcb = tcp_active_pcbs;
+         ( pxCurPcb != NULL ) && ( pxSnap->xNumConnections < MEMP_NUM_TCP_PCB );
+         pxCurPcb = pxCurPcb->next )
+    {
+        MetricsConnection_t * pxConn = &( pxSnap->pxConnections[ pxSnap->xNumConnections ] );
+
+        ip_addr_copy( pxConn->xRemoteIp, pxCurPcb->remote_ip );
+        pxConn->usRemotePort = pxCurPcb->remote_port;
+        pxConn->usLocalPort = pxCurPcb->local_port;
+        pxConn->ucNetifIdx = pxCurPcb->netif_idx;
+        pxSnap->xNumConnections++;
+    }
+}
 
-static char * pcGetNetifName( uint8_t ucNetifIdx,
-                              char * pcNetifBuf )
+void vMetricsCollectorSnapshot( void )
 {
-    char * pcNetifNameFound = NULL;
+    MetricsSnapshot_t * pxSnap = &xSnapshot;
+
+    pxSnap->xBytesIn = 0;
+    pxSnap->xBytesOut = 0;
+    pxSnap->xPktsIn = 0;
+    pxSnap->xPktsOut = 0;
+    pxSnap->xNumNetifs = 0;
+    pxSnap->xNumTcpPorts = 0;
+    pxSnap->xNumUdpPorts = 0;
+    pxSnap->xNumConnections = 0;
+
+    LOCK_TCPIP_CORE();
 
-    /* netif_idx == 0 means no specific interface or the default interface */
-    if( ucNetifIdx == 0 )
-    {
-        if( netif_default != NULL )
-        {
-            pcNetifNameFound = netif_index_to_name( netif_default->num, pcNetifBuf );
-        }
-        else
-        {
-            strcpy( pcNetifBuf, "any" );
-            pcNetifBuf[ 3 ] = '\0';
-            pcNetifNameFound = pcNetifBuf;
-        }
-    }
-    else
     {
-        pcNetifNameFound = netif_index_to_name( ucNetifIdx, pcNetifBuf );
+        PERF_START;
+
+        prvSnapshotNetifs( pxSnap );
+        prvSnapshotPcbs( pxSnap );
+
+        PERF_STOP( "metrics_snapshot" );
     }
 
-    return pcNetifNameFound;
+    UNLOCK_TCPIP_CORE();
+
+    LogDebug( "Metrics snapshot: %lu tcp ports, %lu udp ports, %lu connections.",
+              ( unsigned long ) pxSnap->xNumTcpPorts,
+              ( unsigned long ) pxSnap->xNumUdpPorts,
+              ( unsigned long ) pxSnap->xNumConnections );
 }
 
 /*-----------------------------------------------------------*/
 
-static CborError xAppendTcpPtsToList( CborEncoder * pxPTSEncoder )
+static const char * pcGetNetifName( uint8_t ucNetifIdx )
 {
-    CborError xError = CborNoError;
+    const char * pcNetifNameFound = NULL;
 
-    configASSERT( pxPTSEncoder != NULL );
-
-    for( struct tcp_pcb_listen * pxCurPcb = tcp_listen_pcbs.listen_pcbs; pxCurPcb != NULL; pxCurPcb = pxCurPcb->next )
+    /* netif_idx == 0 means no specific interface or the default interface */
+    if( ucNetifIdx == 0 )
     {
-        CborEncoder xPTEncoder;
-        char pcNetifBuf[ NETIF_NAMESIZE ] = { 0 };
-        char * pcNetifNameFound = NULL;
-
-        pcNetifNameFound = pcGetNetifName( pxCurPcb->netif_idx, pcNetifBuf );
-
-        if( pcNetifNameFound != NULL )
-        {
-            xError = cbor_encoder_create_map( pxPTSEncoder, &xPTEncoder, 2 );
-            configASSERT_CONTINUE( xError == CborNoError );
+        ucNetifIdx = xSnapshot.ucDefaultNetifIdx;
 
-            if( xError == CborNoError )
-            {
-                xError = cbor_add_kv_str( &xPTEncoder, "if", pcNetifNameFound );
-                configASSERT_CONTINUE( xError == CborNoError );
-            }
-        }
-        else
+        if( ucNetifIdx == 0 )
         {
-            xError = cbor_encoder_create_map( pxPTSEncoder, &xPTEncoder, 1 );
-            configASSERT_CONTINUE( xError == CborNoError );
-        }
-
-        if( xError == CborNoError )
-        {
-            xError = cbor_add_kv_uint( &xPTEncoder, "pt", pxCurPcb->local_port );
-            configASSERT_CONTINUE( xError == CborNoError );
+            pcNetifNameFound = "any";
         }
+    }
 
-        if( xError == CborNoError )
+    for( size_t i = 0; ( i < xSnapshot.xNumNetifs ) && ( pcNetifNameFound == NULL ); i++ )
+    {
+        if( xSnapshot.pxNetifs[ i ].ucIndex == ucNetifIdx )
         {
-            xError = cbor_encoder_close_container( pxPTSEncoder, &xPTEncoder );
+            pcNetifNameFound = xSnapshot.pxNetifs[ i ].pcName;
         }
     }
 
-    return xError;
+    return pcNetifNameFound;
 }
 
 /*-----------------------------------------------------------*/
 
-CborError xGetListeningTcpPorts( CborEncoder * pxMetricsEncoder )
+CborError xGetNetworkStats( CborEncoder * pxEncoder )
 {
     CborError xError = CborNoError;
-    uint32_t ulPortCount = 0;
 
-    if( pxMetricsEncoder == NULL )
+    if( pxEncoder == NULL )
     {
-        LogError( "Invalid parameter: pxMetricsEncoder: %p", pxMetricsEncoder );
+        LogError( "Invalid parameter: pxEncoder: %p", pxEncoder );
         xError = CborErrorImproperValue;
     }
     else
     {
-        CborEncoder xTPEncoder;
-        CborEncoder xPTSEncoder;
-
-        LOCK_TCPIP_CORE();
-        ulPortCount = xCountListeningTcpPorts();
-
-        xError = cbor_encode_text_stringz( pxMetricsEncoder, "tp" );
-        configASSERT_CONTINUE( xError == CborNoError );
+        CborEncoder xNSEncoder;
 
-        if( xError == CborNoError )
-        {
-            /* Create listening_tcp_ports / tp object */
-            if( ulPortCount > 0 )
-            {
-                xError = cbor_encoder_create_map( pxMetricsEncoder, &xTPEncoder, 2 );
-                configASSERT_CONTINUE( xError == CborNoError );
-            }
-            else
-            {
-                xError = cbor_encoder_create_map( pxMetricsEncoder, &xTPEncoder, 1 );
-                configASSERT_CONTINUE( xError == CborNoError );
-            }
-        }
+        xError = cbor_encode_text_stringz( pxEncoder, "ns" );
+        configASSERT_CONTINUE( METRICS_CBOR_OK( xError ) );
 
-        /* Encode number of ports parameter */
-        if( xError == CborNoError )
+        if( METRICS_CBOR_OK( xError ) )
         {
-            xError = cbor_add_kv_uint( &xTPEncoder, "t", ulPortCount );
-            configASSERT_CONTINUE( xError == CborNoError );
+            xError |= cbor_encoder_create_map( pxEncoder, &xNSEncoder, 4 );
+            configASSERT_CONTINUE( METRICS_CBOR_OK( xError ) );
         }
 
-        /* Construct ports list / pts if any tcp ports are listening */
-        if( ulPortCount > 0 )
+        if( METRICS_CBOR_OK( xError ) )
         {
-            if( xError == CborNoError )
-            {
-                xError = cbor_encode_text_stringz( &xTPEncoder, "pts" );
-                configASSERT_CONTINUE( xError == CborNoError );
-            }
-
-            if( xError == CborNoError )
-            {
-                xError = cbor_encoder_create_array( &xTPEncoder, &xPTSEncoder, ulPortCount );
-                configASSERT_CONTINUE( xError == CborNoError );
-            }
-
-            if( xError == CborNoError )
-            {
-                xError = xAppendTcpPtsToList( &xPTSEncoder );
-                configASSERT_CONTINUE( xError == CborNoError );
-            }
-
-            if( xError == CborNoError )
-            {
-                xError = cbor_encoder_close_container( &xTPEncoder, &xPTSEncoder );
-                configASSERT_CONTINUE( xError == CborNoError );
-            }
+            xError |= cbor_add_kv_uint( &xNSEncoder, "pi", xSnapshot.xPktsIn );
+            xError |= cbor_add_kv_uint( &xNSEncoder, "po", xSnapshot.xPktsOut );
+            xError |= cbor_add_kv_uint( &xNSEncoder, "bi", xSnapshot.xBytesIn );
+            xError |= cbor_add_kv_uint( &xNSEncoder, "bo", xSnapshot.xBytesOut );
+            configASSERT_CONTINUE( METRICS_CBOR_OK( xError ) );
         }
 
-        if( xError == CborNoError )
+        if( METRICS_CBOR_OK( xError ) )
         {
-            xError = cbor_encoder_close_container( pxMetricsEncoder, &xTPEncoder );
-            configASSERT_CONTINUE( xError == CborNoError );
+            xError |= cbor_encoder_close_container( pxEncoder, &xNSEncoder );
         }
-
-        UNLOCK_TCPIP_CORE();
     }
 
     return xError;
 }
-/*-----------------------------------------------------------*/
-
-static size_t xCountListeningUdpPorts( void )
-{
-    size_t xPortCount = 0;
-
-    for( struct udp_pcb * pxCurPcb = udp_pcbs; pxCurPcb != NULL; pxCurPcb = pxCurPcb->next )
-    {
-        xPortCount++;
-    }
 
-    return xPortCount;
-}
+/*-----------------------------------------------------------*/
 
-static CborError xAppendUdpPtsToList( CborEncoder * pxPTSEncoder )
+static CborError xAppendPtsToList( CborEncoder * pxPTSEncoder,
+                                   const MetricsPort_t * pxPorts,
+                                   size_t xNumPorts )
 {
     CborError xError = CborNoError;
 
     configASSERT( pxPTSEncoder != NULL );
 
-    for( struct udp_pcb * pxCurPcb = udp_pcbs; pxCurPcb != NULL; pxCurPcb = pxCurPcb->next )
+    for( size_t i = 0; ( i < xNumPorts ) && METRICS_CBOR_OK( xError ); i++ )
     {
         CborEncoder xPTEncoder;
-        char pcNetifBuf[ NETIF_NAMESIZE ] = { 0 };
-        char * pcNetifName = NULL;
-
-        pcNetifName = pcGetNetifName( pxCurPcb->netif_idx, pcNetifBuf );
+        const char * pcNetifName = pcGetNetifName( pxPorts[ i ].ucNetifIdx );
 
         if( pcNetifName != NULL )
         {
-            xError = cbor_encoder_create_map( pxPTSEncoder, &xPTEncoder, 2 );
-            configASSERT_CONTINUE( xError == CborNoError );
+            xError |= cbor_encoder_create_map( pxPTSEncoder, &xPTEncoder, 2 );
+            configASSERT_CONTINUE( METRICS_CBOR_OK( xError ) );
 
-            if( xError == CborNoError )
+            if( METRICS_CBOR_OK( xError ) )
             {
-                xError = cbor_add_kv_str( &xPTEncoder, "if", pcNetifName );
-                configASSERT_CONTINUE( xError == CborNoError );
+                xError |= cbor_add_kv_str( &xPTEncoder, "if", pcNetifName );
+                configASSERT_CONTINUE( METRICS_CBOR_OK( xError ) );
             }
         }
         else
         {
-            xError = cbor_encoder_create_map( pxPTSEncoder, &xPTEncoder, 1 );
-            configASSERT_CONTINUE( xError == CborNoError );
+            xError |= cbor_encoder_create_map( pxPTSEncoder, &xPTEncoder, 1 );
+            configASSERT_CONTINUE( METRICS_CBOR_OK( xError ) );
         }
 
-        if( xError == CborNoError )
+        if( METRICS_CBOR_OK( xError ) )
         {
-            xError = cbor_add_kv_uint( &xPTEncoder, "pt", pxCurPcb->local_port );
-            configASSERT_CONTINUE( xError == CborNoError );
+            xError |= cbor_add_kv_uint( &xPTEncoder, "pt", pxPorts[ i ].usLocalPort );
+            configASSERT_CONTINUE( METRICS_CBOR_OK( xError ) );
         }
 
-        if( xError == CborNoError )
+        if( METRICS_CBOR_OK( xError ) )
         {
-            xError = cbor_encoder_close_container( pxPTSEncoder, &xPTEncoder );
+            xError |= cbor_encoder_close_container( pxPTSEncoder, &xPTEncoder );
         }
     }
 
     return xError;
 }
 
+/*-----------------------------------------------------------*/
 
-
-CborError xGetListeningUdpPorts( CborEncoder * pxMetricsEncoder )
+/* Encode a listening_tcp_ports / tp or listening_udp_ports / up object. */
+static CborError xEncodeListeningPorts( CborEncoder * pxMetricsEncoder,
+                                        const char * pcKey,
+                                        const MetricsPort_t * pxPorts,
+                                        size_t xNumPorts )
 {
     CborError xError = CborNoError;
-    uint32_t ulPortCount = 0;
+    CborEncoder xPortsEncoder;
+    CborEncoder xPTSEncoder;
 
-    if( pxMetricsEncoder == NULL )
+    xError = cbor_encode_text_stringz( pxMetricsEncoder, pcKey );
+    configASSERT_CONTINUE( METRICS_CBOR_OK( xError ) );
+
+    if( METRICS_CBOR_OK( xError ) )
     {
-        LogError( "Invalid parameter: pxMetricsEncoder: %p", pxMetricsEncoder );
-        xError = CborErrorImproperValue;
+        xError |= cbor_encoder_create_map( pxMetricsEncoder, &xPortsEncoder, ( xNumPorts > 0 ) ? 2 : 1 );
+        configASSERT_CONTINUE( METRICS_CBOR_OK( xError ) );
     }
-    else
-    {
-        CborEncoder xUPEncoder;
-        CborEncoder xPTSEncoder;
-
-        LOCK_TCPIP_CORE();
-        ulPortCount = xCountListeningUdpPorts();
 
-        xError = cbor_encode_text_stringz( pxMetricsEncoder, "up" );
-        configASSERT_CONTINUE( xError == CborNoError );
+    /* Encode number of ports parameter */
+    if( METRICS_CBOR_OK( xError ) )
+    {
+        xError |= cbor_add_kv_uint( &xPortsEncoder, "t", xNumPorts );
+        configASSERT_CONTINUE( METRICS_CBOR_OK( xError ) );
+    }
 
-        if( xError == CborNoError )
+    /* Construct ports list / pts if any ports are listening */
+    if( xNumPorts > 0 )
+    {
+        if( METRICS_CBOR_OK( xError ) )
         {
-            /* Create listening_udp_ports / up object */
-            if( ulPortCount > 0 )
-            {
-                xError = cbor_encoder_create_map( pxMetricsEncoder, &xUPEncoder, 2 );
-                configASSERT_CONTINUE( xError == CborNoError );
-            }
-            else
-            {
-                xError = cbor_encoder_create_map( pxMetricsEncoder, &xUPEncoder, 1 );
-                configASSERT_CONTINUE( xError == CborNoError );
-            }
+            xError |= cbor_encode_text_stringz( &xPortsEncoder, "pts" );
+            configASSERT_CONTINUE( METRICS_CBOR_OK( xError ) );
         }
 
-        /* Encode number of ports parameter */
-        if( xError == CborNoError )
+        if( METRICS_CBOR_OK( xError ) )
         {
-            xError = cbor_add_kv_uint( &xUPEncoder, "t", ulPortCount );
-            configASSERT_CONTINUE( xError == CborNoError );
+            xError |= cbor_encoder_create_array( &xPortsEncoder, &xPTSEncoder, xNumPorts );
+            configASSERT_CONTINUE( METRICS_CBOR_OK( xError ) );
         }
 
-        /* Construct ports list / pts if any udp ports are listening */
-        if( ulPortCount > 0 )
+        if( METRICS_CBOR_OK( xError ) )
         {
-            if( xError == CborNoError )
-            {
-                xError = cbor_encode_text_stringz( &xUPEncoder, "pts" );
-                configASSERT_CONTINUE( xError == CborNoError );
-            }
-
-            if( xError == CborNoError )
-            {
-                xError = cbor_encoder_create_array( &xUPEncoder, &xPTSEncoder, ulPortCount );
-                configASSERT_CONTINUE( xError == CborNoError );
-            }
-
-            if( xError == CborNoError )
-            {
-                xError = xAppendUdpPtsToList( &xPTSEncoder );
-                configASSERT_CONTINUE( xError == CborNoError );
-            }
-
-            if( xError == CborNoError )
-            {
-                xError = cbor_encoder_close_container( &xUPEncoder, &xPTSEncoder );
-                configASSERT_CONTINUE( xError == CborNoError );
-            }
+            xError |= xAppendPtsToList( &xPTSEncoder, pxPorts, xNumPorts );
+            configASSERT_CONTINUE( METRICS_CBOR_OK( xError ) );
         }
 
-        if( xError == CborNoError )
+        if( METRICS_CBOR_OK( xError ) )
         {
-            xError = cbor_encoder_close_container( pxMetricsEncoder, &xUPEncoder );
-            configASSERT_CONTINUE( xError == CborNoError );
+            xError |= cbor_encoder_close_container( &xPortsEncoder, &xPTSEncoder );
+            configASSERT_CONTINUE( METRICS_CBOR_OK( xError ) );
         }
+    }
 
-        UNLOCK_TCPIP_CORE();
+    if( METRICS_CBOR_OK( xError ) )
+    {
+        xError |= cbor_encoder_close_container( pxMetricsEncoder, &xPortsEncoder );
+        configASSERT_CONTINUE( METRICS_CBOR_OK( xError ) );
     }
 
     return xError;
 }
+
 /*-----------------------------------------------------------*/
 
+CborError xGetListeningTcpPorts( CborEncoder * pxMetricsEncoder )
+{
+    CborError xError = CborNoError;
+
+    if( pxMetricsEncoder == NULL )
+    {
+        LogError( "Invalid parameter: pxMetricsEncoder: %p", pxMetricsEncoder );
+        xError = CborErrorImproperValue;
+    }
+    else
+    {
+        xError = xEncodeListeningPorts( pxMetricsEncoder, "tp",
+                                        xSnapshot.pxTcpPorts, xSnapshot.xNumTcpPorts );
+    }
+
+    return xError;
+}
+
+/*-----------------------------------------------------------*/
 
-static size_t xCountTcpConnections( void )
+CborError xGetListeningUdpPorts( CborEncoder * pxMetricsEncoder )
 {
-    size_t xConnectionCount = 0;
+    CborError xError = CborNoError;
 
-    for( struct tcp_pcb * pxCurPcb = tcp_active_pcbs; pxCurPcb != NULL; pxCurPcb = pxCurPcb->next )
+    if( pxMetricsEncoder == NULL )
+    {
+        LogError( "Invalid parameter: pxMetricsEncoder: %p", pxMetricsEncoder );
+        xError = CborErrorImproperValue;
+    }
+    else
     {
-        xConnectionCount++;
+        xError = xEncodeListeningPorts( pxMetricsEncoder, "up",
+                                        xSnapshot.pxUdpPorts, xSnapshot.xNumUdpPorts );
     }
 
-    return xConnectionCount;
+    return xError;
 }
 
+/*-----------------------------------------------------------*/
+
 static bool xIpAddrPortToString( char * pcBuffer,
                                  size_t xBuffLen,
-                                 ip_addr_t * pxIpAddr,
+                                 const ip_addr_t * pxIpAddr,
                                  uint16_t usPort )
 {
     bool xReturn = false;
@@ -529,23 +522,23 @@ static CborError xAppendTcpConnectionsToList( CborEncoder * pxCSEncoder )
 
     configASSERT( pxCSEncoder != NULL );
 
-    for( struct tcp_pcb * pxCurPcb = tcp_active_pcbs; pxCurPcb != NULL; pxCurPcb = pxCurPcb->next )
+    for( size_t i = 0; ( i < xSnapshot.xNumConnections ) && METRICS_CBOR_OK( xError ); i++ )
     {
+        const MetricsConnection_t * pxConn = &( xSnapshot.pxConnections[ i ] );
         CborEncoder xCEncoder;
         char pcRemoteIpBuf[ IPADDR_PORT_STR_LEN ] = { 0 };
-        char pcNetifBuf[ NETIF_NAMESIZE ] = { 0 };
-        char * pcNetifName = NULL;
+        const char * pcNetifName = NULL;
 
-        xError = cbor_encoder_create_map( pxCSEncoder, &xCEncoder, 3 );
-        configASSERT_CONTINUE( xError == CborNoError );
+        xError |= cbor_encoder_create_map( pxCSEncoder, &xCEncoder, 3 );
+        configASSERT_CONTINUE( METRICS_CBOR_OK( xError ) );
 
         /* Add remote ip / port attribute */
-        if( xError == CborNoError )
+        if( METRICS_CBOR_OK( xError ) )
         {
-            if( xIpAddrPortToString( pcRemoteIpBuf, IPADDR_PORT_STR_LEN, &( pxCurPcb->remote_ip ), pxCurPcb->remote_port ) )
+            if( xIpAddrPortToString( pcRemoteIpBuf, IPADDR_PORT_STR_LEN, &( pxConn->xRemoteIp ), pxConn->usRemotePort ) )
             {
-                xError = cbor_add_kv_str( &xCEncoder, "rad", pcRemoteIpBuf );
-                configASSERT_CONTINUE( xError == CborNoError );
+                xError |= cbor_add_kv_str( &xCEncoder, "rad", pcRemoteIpBuf );
+                configASSERT_CONTINUE( METRICS_CBOR_OK( xError ) );
             }
             else
             {
@@ -553,44 +546,45 @@ static CborError xAppendTcpConnectionsToList( CborEncoder * pxCSEncoder )
             }
         }
 
-        pcNetifName = pcGetNetifName( pxCurPcb->netif_idx, pcNetifBuf );
+        pcNetifName = pcGetNetifName( pxConn->ucNetifIdx );
 
         /* add local interface attribute */
         if( pcNetifName != NULL )
         {
-            if( xError == CborNoError )
+            if( METRICS_CBOR_OK( xError ) )
             {
-                xError = cbor_add_kv_str( &xCEncoder, "li", pcNetifName );
-                configASSERT_CONTINUE( xError == CborNoError );
+                xError |= cbor_add_kv_str( &xCEncoder, "li", pcNetifName );
+                configASSERT_CONTINUE( METRICS_CBOR_OK( xError ) );
             }
         }
         else
         {
             xError = CborUnknownError;
-            configASSERT_CONTINUE( xError == CborNoError );
+            configASSERT_CONTINUE( METRICS_CBOR_OK( xError ) );
         }
 
         /* Add local port attribute */
-        if( xError == CborNoError )
+        if( METRICS_CBOR_OK( xError ) )
         {
-            xError = cbor_add_kv_uint( &xCEncoder, "lp", pxCurPcb->local_port );
-            configASSERT_CONTINUE( xError == CborNoError );
+            xError |= cbor_add_kv_uint( &xCEncoder, "lp", pxConn->usLocalPort );
+            configASSERT_CONTINUE( METRICS_CBOR_OK( xError ) );
         }
 
-        if( xError == CborNoError )
+        if( METRICS_CBOR_OK( xError ) )
         {
-            xError = cbor_encoder_close_container( pxCSEncoder, &xCEncoder );
+            xError |= cbor_encoder_close_container( pxCSEncoder, &xCEncoder );
         }
     }
 
     return xError;
 }
 
+/*-----------------------------------------------------------*/
 
 CborError xGetEstablishedConnections( CborEncoder * pxMetricsEncoder )
 {
     CborError xError = CborNoError;
-    uint32_t ulConnCount = 0;
+    size_t xConnCount = xSnapshot.xNumConnections;
 
     if( pxMetricsEncoder == NULL )
     {
@@ -603,88 +597,75 @@ CborError xGetEstablishedConnections( CborEncoder * pxMetricsEncoder )
         CborEncoder xECEncoder; /* ec object */
         CborEncoder xCSEncoder; /* cs list */
 
-        LOCK_TCPIP_CORE();
-        ulConnCount = xCountTcpConnections();
-
         xError = cbor_encode_text_stringz( pxMetricsEncoder, "tc" );
-        configASSERT_CONTINUE( xError == CborNoError );
+        configASSERT_CONTINUE( METRICS_CBOR_OK( xError ) );
 
-        if( xError == CborNoError )
+        if( METRICS_CBOR_OK( xError ) )
         {
             /* Create tcp_connections / tc object */
-            xError = cbor_encoder_create_map( pxMetricsEncoder, &xTCEncoder, 1 );
-            configASSERT_CONTINUE( xError == CborNoError );
+            xError |= cbor_encoder_create_map( pxMetricsEncoder, &xTCEncoder, 1 );
+            configASSERT_CONTINUE( METRICS_CBOR_OK( xError ) );
         }
 
-        if( xError == CborNoError )
+        if( METRICS_CBOR_OK( xError ) )
         {
-            xError = cbor_encode_text_stringz( &xTCEncoder, "ec" );
-            configASSERT_CONTINUE( xError == CborNoError );
+            xError |= cbor_encode_text_stringz( &xTCEncoder, "ec" );
+            configASSERT_CONTINUE( METRICS_CBOR_OK( xError ) );
         }
 
-        if( xError == CborNoError )
+        if( METRICS_CBOR_OK( xError ) )
         {
             /* Create established_connections / ec object */
-            if( ulConnCount > 0 )
-            {
-                xError = cbor_encoder_create_map( &xTCEncoder, &xECEncoder, 2 );
-                configASSERT_CONTINUE( xError == CborNoError );
-            }
-            else
-            {
-                xError = cbor_encoder_create_map( &xTCEncoder, &xECEncoder, 1 );
-                configASSERT_CONTINUE( xError == CborNoError );
-            }
+            xError |= cbor_encoder_create_map( &xTCEncoder, &xECEncoder, ( xConnCount > 0 ) ? 2 : 1 );
+            configASSERT_CONTINUE( METRICS_CBOR_OK( xError ) );
         }
 
         /* Encode number of connections parameter */
-        if( xError == CborNoError )
+        if( METRICS_CBOR_OK( xError ) )
         {
-            xError = cbor_add_kv_uint( &xECEncoder, "t", ulConnCount );
-            configASSERT_CONTINUE( xError == CborNoError );
+            xError |= cbor_add_kv_uint( &xECEncoder, "t", xConnCount );
+            configASSERT_CONTINUE( METRICS_CBOR_OK( xError ) );
         }
 
         /* Construct connections_list / cs if any tcp ports are connected */
-        if( ulConnCount > 0 )
+        if( xConnCount > 0 )
         {
-            if( xError == CborNoError )
+            if( METRICS_CBOR_OK( xError ) )
             {
-                xError = cbor_encode_text_stringz( &xECEncoder, "cs" );
-                configASSERT_CONTINUE( xError == CborNoError );
+                xError |= cbor_encode_text_stringz( &xECEncoder, "cs" );
+                configASSERT_CONTINUE( METRICS_CBOR_OK( xError ) );
             }
 
-            if( xError == CborNoError )
+            if( METRICS_CBOR_OK( xError ) )
             {
-                xError = cbor_encoder_create_array( &xECEncoder, &xCSEncoder, ulConnCount );
-                configASSERT_CONTINUE( xError == CborNoError );
+                xError |= cbor_encoder_create_array( &xECEncoder, &xCSEncoder, xConnCount );
+                configASSERT_CONTINUE( METRICS_CBOR_OK( xError ) );
             }
 
-            if( xError == CborNoError )
+            if( METRICS_CBOR_OK( xError ) )
             {
-                xError = xAppendTcpConnectionsToList( &xCSEncoder );
-                configASSERT_CONTINUE( xError == CborNoError );
+                xError |= xAppendTcpConnectionsToList( &xCSEncoder );
+                configASSERT_CONTINUE( METRICS_CBOR_OK( xError ) );
             }
 
-            if( xError == CborNoError )
+            if( METRICS_CBOR_OK( xError ) )
             {
-                xError = cbor_encoder_close_container( &xECEncoder, &xCSEncoder );
-                configASSERT_CONTINUE( xError == CborNoError );
+                xError |= cbor_encoder_close_container( &xECEncoder, &xCSEncoder );
+                configASSERT_CONTINUE( METRICS_CBOR_OK( xError ) );
             }
         }
 
-        if( xError == CborNoError )
+        if( METRICS_CBOR_OK( xError ) )
         {
-            xError = cbor_encoder_close_container( &xTCEncoder, &xECEncoder );
-            configASSERT_CONTINUE( xError == CborNoError );
+            xError |= cbor_encoder_close_container( &xTCEncoder, &xECEncoder );
+            configASSERT_CONTINUE( METRICS_CBOR_OK( xError ) );
         }
 
-        if( xError == CborNoError )
+        if( METRICS_CBOR_OK( xError ) )
         {
-            xError = cbor_encoder_close_container( pxMetricsEncoder, &xTCEncoder );
-            configASSERT_CONTINUE( xError == CborNoError );
+            xError |= cbor_encoder_close_container( pxMetricsEncoder, &xTCEncoder );
+            configASSERT_CONTINUE( METRICS_CBOR_OK( xError ) );
         }
-
-        UNLOCK_TCPIP_CORE();
     }
 
     return xError;
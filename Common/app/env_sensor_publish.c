@@ -28,7 +28,8 @@
 #include "logging_levels.h"
 /* define LOG_LEVEL here if you want to modify the logging level from the default */
 
-#define LOG_LEVEL    LOG_ERROR
+#define LOG_LEVEL     LOG_ERROR
+#define LOG_MODULE    LOG_MODULE_SENSOR
 
 #include "logging.h"
 
@@ -51,13 +52,16 @@
 /* Subscription manager header include. */
 #include "subscription_manager.h"
 
-/* Sensor includes */
-#include "b_u585i_iot02a_env_sensors.h"
+#include "sensor_sched.h"
+#include "telemetry_cbor.h"
+#include "telemetry_delta.h"
+#include "sensor_replay.h"
 
 
 #define MQTT_PUBLISH_MAX_LEN                 ( 512 )
 #define MQTT_PUBLISH_TIME_BETWEEN_MS         ( 1000 )
 #define MQTT_PUBLISH_TOPIC                   "env_sensor_data"
+#define MQTT_SCHEMA_TOPIC_SUFFIX             "/schema"
 #define MQTT_PUBLICH_TOPIC_STR_LEN           ( 256 )
 #define MQTT_PUBLISH_BLOCK_TIME_MS           ( 1000 )
 #define MQTT_PUBLISH_NOTIFICATION_WAIT_MS    ( 1000 )
@@ -65,6 +69,14 @@
 #define MQTT_NOTIFY_IDX                      ( 1 )
 #define MQTT_PUBLISH_QOS                     ( MQTTQoS0 )
 
+/* temp_0_c, rh_pct, temp_1_c, baro_mbar */
+#define ENV_NUM_CHANNELS                     ( 4 )
+
+/* HTS221 and LPS22HH readings arrive from the sensor acquisition task */
+#define ENV_SAMPLE_RATE_HZ                   ( 1000.0f / MQTT_PUBLISH_TIME_BETWEEN_MS )
+#define ENV_SAMPLE_TIMEOUT_MS                ( 2 * MQTT_PUBLISH_TIME_BETWEEN_MS )
+#define ENV_RING_LEN                         ( 8 )
+
 /*-----------------------------------------------------------*/
 
 /**
@@ -79,12 +91,32 @@ struct MQTTAgentCommandContext
 
 typedef struct
 {
-    float_t fTemperature0;
-    float_t fTemperature1;
-    float_t fHumidity;
-    float_t fBarometricPressure;
+    float fTemperature0;
+    float fTemperature1;
+    float fHumidity;
+    float fBarometricPressure;
 } EnvironmentalSensorData_t;
 
+/* CBOR keyframe layout: the sequence number then one field per channel */
+static const TelemetryField_t xEnvFields[ ENV_NUM_CHANNELS + 1 ] =
+{
+    { "seq",       TELEMETRY_FIELD_FIXED, 0  },
+    { "temp_0_c",  TELEMETRY_FIELD_FIXED, -2 },
+    { "rh_pct",    TELEMETRY_FIELD_FIXED, -1 },
+    { "temp_1_c",  TELEMETRY_FIELD_FIXED, -2 },
+    { "baro_mbar", TELEMETRY_FIELD_FIXED, -2 },
+};
+
+static const TelemetrySchema_t xEnvSchema =
+{
+    .usId         = 1,
+    .usRepeatFrom = sizeof( xEnvFields ) / sizeof( xEnvFields[ 0 ] ),
+    .ulNumFields  = sizeof( xEnvFields ) / sizeof( xEnvFields[ 0 ] ),
+    .pxFields     = xEnvFields,
+    .ulNumGroups  = 0,
+    .ppcGroups    = NULL,
+};
+
 /*-----------------------------------------------------------*/
 
 static void prvPublishCommandCallback( MQTTAgentCommandContext_t * pxCommandContext,
@@ -114,6 +146,7 @@ static BaseType_t prvPublishAndWaitForAck( MQTTAgentHandle_t xAgentHandle,
 {
     BaseType_t xResult = pdFALSE;
     MQTTStatus_t xStatus;
+    TickType_t xStartTicks;
 
     configASSERT( pcTopic != NULL );
     configASSERT( pvPublishData != NULL );
@@ -146,6 +179,7 @@ static BaseType_t prvPublishAndWaitForAck( MQTTAgentHandle_t xAgentHandle,
     /* Clear the notification index */
     xTaskNotifyStateClearIndexed( NULL, MQTT_NOTIFY_IDX );
 
+    xStartTicks = xTaskGetTickCount();
 
     xStatus = MQTTAgent_Publish( xAgentHandle,
                                  &xPublishInfo,
@@ -169,6 +203,10 @@ static BaseType_t prvPublishAndWaitForAck( MQTTAgentHandle_t xAgentHandle,
                       xCommandContext.xReturnStatus );
             xResult = pdFALSE;
         }
+        else
+        {
+            vMqttAgentRecordPublishLatency( ( xTaskGetTickCount() - xStartTicks ) * portTICK_PERIOD_MS );
+        }
     }
     else
     {
@@ -193,47 +231,96 @@ static BaseType_t xIsMqttConnected( void )
 
 /*-----------------------------------------------------------*/
 
-static BaseType_t xInitSensors( void )
+/* Collect one reading from each sensor, pdFALSE if they did not all arrive in time */
+static BaseType_t prvReadSensors( SensorRing_t * pxRing,
+                                  EnvironmentalSensorData_t * pxData )
 {
-    int32_t lBspError = BSP_ERROR_NONE;
+    const uint32_t ulAllSensors = ( 1UL << SENSOR_ID_HTS221 ) | ( 1UL << SENSOR_ID_LPS22HH );
+    uint32_t ulSeen = 0;
+    TickType_t xTicksToWait = pdMS_TO_TICKS( ENV_SAMPLE_TIMEOUT_MS );
+    TimeOut_t xTimeOut;
 
-    lBspError = BSP_ENV_SENSOR_Init( 0, ENV_TEMPERATURE );
+    vTaskSetTimeOutState( &xTimeOut );
 
-    lBspError |= BSP_ENV_SENSOR_Init( 0, ENV_HUMIDITY );
-
-    lBspError |= BSP_ENV_SENSOR_Init( 1, ENV_TEMPERATURE );
-
-    lBspError |= BSP_ENV_SENSOR_Init( 1, ENV_PRESSURE );
-
-    lBspError |= BSP_ENV_SENSOR_Enable( 0, ENV_TEMPERATURE );
+    while( ( ulSeen != ulAllSensors ) &&
+           ( xTaskCheckForTimeOut( &xTimeOut, &xTicksToWait ) == pdFALSE ) )
+    {
+        SensorSample_t xSample;
 
-    lBspError |= BSP_ENV_SENSOR_Enable( 0, ENV_HUMIDITY );
+        ( void ) xSensorRingWait( xTicksToWait );
 
-    lBspError |= BSP_ENV_SENSOR_Enable( 1, ENV_TEMPERATURE );
+        /* Drain everything queued while publishing, the latest reading wins */
+        while( xSensorRingPop( pxRing, &xSample ) == pdTRUE )
+        {
+            if( xSample.ucSensor == SENSOR_ID_HTS221 )
+            {
+                pxData->fTemperature0 = xSample.fValues[ 0 ];
+                pxData->fHumidity = xSample.fValues[ 1 ];
+            }
+            else
+            {
+                pxData->fTemperature1 = xSample.fValues[ 0 ];
+                pxData->fBarometricPressure = xSample.fValues[ 1 ];
+            }
 
-    lBspError |= BSP_ENV_SENSOR_Enable( 1, ENV_PRESSURE );
+            ulSeen |= ( 1UL << xSample.ucSensor );
+        }
+    }
 
-    lBspError |= BSP_ENV_SENSOR_SetOutputDataRate( 0, ENV_TEMPERATURE, 1.0f );
+    return( ulSeen == ulAllSensors ? pdTRUE : pdFALSE );
+}
 
-    lBspError |= BSP_ENV_SENSOR_SetOutputDataRate( 0, ENV_HUMIDITY, 1.0f );
+/*-----------------------------------------------------------*/
 
-    lBspError |= BSP_ENV_SENSOR_SetOutputDataRate( 1, ENV_TEMPERATURE, 1.0f );
+static size_t prvFormatJson( char * pcBuf,
+                             size_t xBufLen,
+                             const EnvironmentalSensorData_t * pxData )
+{
+    int lLen = snprintf( pcBuf,
+                         xBufLen,
+                         "{ \"temp_0_c\": %f, \"rh_pct\": %f, \"temp_1_c\": %f, \"baro_mbar\": %f }",
+                         pxData->fTemperature0,
+                         pxData->fHumidity,
+                         pxData->fTemperature1,
+                         pxData->fBarometricPressure );
+
+    return ( ( lLen > 0 ) && ( ( size_t ) lLen < xBufLen ) ) ? ( size_t ) lLen : 0;
+}
 
-    lBspError |= BSP_ENV_SENSOR_SetOutputDataRate( 1, ENV_PRESSURE, 1.0f );
+/* Quantize the readings to the resolution of their CBOR fields */
+static void prvQuantize( const EnvironmentalSensorData_t * pxData,
+                         int64_t * pllValues )
+{
+    const float pfValues[ ENV_NUM_CHANNELS ] =
+    {
+        pxData->fTemperature0,
+        pxData->fHumidity,
+        pxData->fTemperature1,
+        pxData->fBarometricPressure
+    };
 
-    return( lBspError == BSP_ERROR_NONE ? pdTRUE : pdFALSE );
+    for( uint32_t i = 0; i < ENV_NUM_CHANNELS; i++ )
+    {
+        pllValues[ i ] = llTelemetryQuantize( pfValues[ i ], xEnvFields[ i + 1 ].cExponent );
+    }
 }
 
-static BaseType_t xUpdateSensorData( EnvironmentalSensorData_t * pxData )
+/* Take the next sample from the replay generator instead of the sensors */
+static BaseType_t prvReadReplay( EnvironmentalSensorData_t * pxData )
 {
-    int32_t lBspError = BSP_ERROR_NONE;
+    float pfSample[ 1 ][ SENSOR_REPLAY_MAX_CHANNELS ];
+    BaseType_t xResult = pdFALSE;
 
-    lBspError = BSP_ENV_SENSOR_GetValue( 0, ENV_TEMPERATURE, &pxData->fTemperature0 );
-    lBspError |= BSP_ENV_SENSOR_GetValue( 0, ENV_HUMIDITY, &pxData->fHumidity );
-    lBspError |= BSP_ENV_SENSOR_GetValue( 1, ENV_TEMPERATURE, &pxData->fTemperature1 );
-    lBspError |= BSP_ENV_SENSOR_GetValue( 1, ENV_PRESSURE, &pxData->fBarometricPressure );
+    if( ulSensorReplayRead( SENSOR_REPLAY_ENV, pfSample, 1 ) == 1 )
+    {
+        pxData->fTemperature0 = pfSample[ 0 ][ 0 ];
+        pxData->fHumidity = pfSample[ 0 ][ 1 ];
+        pxData->fTemperature1 = pfSample[ 0 ][ 2 ];
+        pxData->fBarometricPressure = pfSample[ 0 ][ 3 ];
+        xResult = pdTRUE;
+    }
 
-    return( lBspError == BSP_ERROR_NONE ? pdTRUE : pdFALSE );
+    return xResult;
 }
 
 /*-----------------------------------------------------------*/
@@ -244,16 +331,25 @@ void vEnvironmentSensorPublishTask( void * pvParameters )
 {
     BaseType_t xResult = pdFALSE;
     BaseType_t xExitFlag = pdFALSE;
+    BaseType_t xSchemaSent = pdFALSE;
     char payloadBuf[ MQTT_PUBLISH_MAX_LEN ];
     MQTTAgentHandle_t xAgentHandle = NULL;
     char pcTopicString[ MQTT_PUBLICH_TOPIC_STR_LEN ] = { 0 };
+    char pcSchemaTopicString[ MQTT_PUBLICH_TOPIC_STR_LEN ] = { 0 };
     size_t uxTopicLen = 0;
+    TelemetryFormat_t xFormat = TELEMETRY_FORMAT_JSON;
+    static TelemetryDelta_t xDelta;
+    uint32_t pulDeadbands[ ENV_NUM_CHANNELS ] = { 0 };
+    uint32_t ulKeyframeInterval = 0;
+    SensorRing_t * pxRing = NULL;
 
     ( void ) pvParameters;
 
-    xResult = xInitSensors();
+    pxRing = pxSensorRingCreate( ENV_RING_LEN );
 
-    if( xResult != pdTRUE )
+    if( ( pxRing == NULL ) ||
+        ( xSensorSchedEnable( SENSOR_ID_HTS221, ENV_SAMPLE_RATE_HZ, pxRing ) != pdTRUE ) ||
+        ( xSensorSchedEnable( SENSOR_ID_LPS22HH, ENV_SAMPLE_RATE_HZ, pxRing ) != pdTRUE ) )
     {
         LogError( "Error while initializing environmental sensors." );
         vTaskDelete( NULL );
@@ -272,62 +368,141 @@ void vEnvironmentSensorPublishTask( void * pvParameters )
         xExitFlag = pdTRUE;
     }
 
-    xAgentHandle = xGetMqttAgentHandle();
+    xFormat = ( KVStore_getUInt32( CS_ENV_PUB_FORMAT, NULL ) == TELEMETRY_FORMAT_CBOR ) ? TELEMETRY_FORMAT_CBOR : TELEMETRY_FORMAT_JSON;
 
-    while( xExitFlag == pdFALSE )
+    if( xFormat == TELEMETRY_FORMAT_CBOR )
     {
-        TickType_t xTicksToWait = pdMS_TO_TICKS( MQTT_PUBLISH_TIME_BETWEEN_MS );
-        TimeOut_t xTimeOut;
+        ( void ) strlcpy( pcSchemaTopicString, pcTopicString, MQTT_PUBLICH_TOPIC_STR_LEN );
+
+        if( strlcat( pcSchemaTopicString, MQTT_SCHEMA_TOPIC_SUFFIX, MQTT_PUBLICH_TOPIC_STR_LEN ) >= MQTT_PUBLICH_TOPIC_STR_LEN )
+        {
+            LogError( "Failed to construct schema topic string." );
+            xExitFlag = pdTRUE;
+        }
+    }
+
+    /* Both temperature channels share a dead band */
+    pulDeadbands[ 0 ] = KVStore_getUInt32( CS_ENV_DEADBAND_TEMP, NULL );
+    pulDeadbands[ 1 ] = KVStore_getUInt32( CS_ENV_DEADBAND_RH, NULL );
+    pulDeadbands[ 2 ] = pulDeadbands[ 0 ];
+    pulDeadbands[ 3 ] = KVStore_getUInt32( CS_ENV_DEADBAND_BARO, NULL );
+    ulKeyframeInterval = ( KVStore_getUInt32( CS_ENV_KEYFRAME_S, NULL ) * 1000 ) / MQTT_PUBLISH_TIME_BETWEEN_MS;
 
-        vTaskSetTimeOutState( &xTimeOut );
+    vTelemetryDeltaInit( &xDelta, ENV_NUM_CHANNELS, pulDeadbands, ulKeyframeInterval );
+
+    xAgentHandle = xGetMqttAgentHandle();
 
+    while( xExitFlag == pdFALSE )
+    {
+        BaseType_t xReplay = xSensorReplayActive( SENSOR_REPLAY_ENV );
         EnvironmentalSensorData_t xEnvData;
-        xResult = xUpdateSensorData( &xEnvData );
+
+        if( xReplay == pdTRUE )
+        {
+            /* Sensor readings queued meanwhile would be stale once the replay stops */
+            vSensorRingFlush( pxRing );
+            vTaskDelay( xSensorReplayPeriod( SENSOR_REPLAY_ENV ) );
+            xResult = prvReadReplay( &xEnvData );
+        }
+        else
+        {
+            xResult = prvReadSensors( pxRing, &xEnvData );
+        }
 
         if( xResult != pdTRUE )
         {
-            LogError( "Error while reading sensor data." );
+            /* A replay source simply has no sample due yet */
+            if( xReplay == pdFALSE )
+            {
+                LogError( "Timed out waiting for environmental sensor data." );
+            }
         }
         else if( xIsMqttConnected() == pdTRUE )
         {
-            int bytesWritten = 0;
-
-            /* Write to */
-            bytesWritten = snprintf( payloadBuf,
-                                     MQTT_PUBLISH_MAX_LEN,
-                                     "{ \"temp_0_c\": %f, \"rh_pct\": %f, \"temp_1_c\": %f, \"baro_mbar\": %f }",
-                                     xEnvData.fTemperature0,
-                                     xEnvData.fHumidity,
-                                     xEnvData.fTemperature1,
-                                     xEnvData.fBarometricPressure );
-
-            if( bytesWritten < MQTT_PUBLISH_MAX_LEN )
+            size_t xPayloadLen = 0;
+
+            /* Describe the CBOR record layout once per connection */
+            if( ( xFormat == TELEMETRY_FORMAT_CBOR ) && ( xSchemaSent == pdFALSE ) )
+            {
+                xPayloadLen = xTelemetryEncodeSchema( &xEnvSchema, ( uint8_t * ) payloadBuf, MQTT_PUBLISH_MAX_LEN );
+
+                if( xPayloadLen > 0 )
+                {
+                    xSchemaSent = prvPublishAndWaitForAck( xAgentHandle,
+                                                           pcSchemaTopicString,
+                                                           payloadBuf,
+                                                           xPayloadLen );
+                }
+            }
+
+            int64_t pllValues[ ENV_NUM_CHANNELS ];
+            TelemetryDeltaAction_t xAction;
+
+            /* Readings within their dead band of the last published values are not
+             * sent. A JSON reading carries no sequence number or keyframe that would
+             * let the receiver tell a suppressed reading from a lost one, so JSON
+             * publishes every reading. */
+            if( xFormat == TELEMETRY_FORMAT_CBOR )
+            {
+                prvQuantize( &xEnvData, pllValues );
+                xAction = xTelemetryDeltaUpdate( &xDelta, pllValues );
+            }
+            else
+            {
+                xAction = TELEMETRY_DELTA_KEYFRAME;
+            }
+
+            xPayloadLen = 0;
+
+            if( xAction == TELEMETRY_DELTA_SKIP )
+            {
+                xResult = pdTRUE;
+            }
+            else if( xFormat == TELEMETRY_FORMAT_CBOR )
+            {
+                vTraceBegin( "env_cbor_encode" );
+                xPayloadLen = xTelemetryEncodeDelta( &xEnvSchema, &xDelta, xAction, ( uint8_t * ) payloadBuf, MQTT_PUBLISH_MAX_LEN );
+                vTraceEnd( "env_cbor_encode" );
+            }
+            else
+            {
+                vTraceBegin( "env_json_encode" );
+                xPayloadLen = prvFormatJson( payloadBuf, MQTT_PUBLISH_MAX_LEN, &xEnvData );
+                vTraceEnd( "env_json_encode" );
+            }
+
+            if( xPayloadLen > 0 )
             {
                 xResult = prvPublishAndWaitForAck( xAgentHandle,
                                                    pcTopicString,
                                                    payloadBuf,
-                                                   bytesWritten );
+                                                   xPayloadLen );
             }
-            else if( bytesWritten > 0 )
+            else if( xAction != TELEMETRY_DELTA_SKIP )
             {
-                LogError( "Not enough buffer space." );
+                LogError( "Failed to encode the sensor payload." );
+                xResult = pdFALSE;
             }
-            else
+
+            if( ( xReplay == pdTRUE ) && ( xAction != TELEMETRY_DELTA_SKIP ) )
             {
-                LogError( "Printf call failed." );
+                vSensorReplayRecordPublish( SENSOR_REPLAY_ENV, xResult, xPayloadLen );
             }
 
-            if( xResult == pdTRUE )
+            if( xResult != pdTRUE )
+            {
+                /* The receiver missed a record, resynchronize it */
+                vTelemetryDeltaForceKeyframe( &xDelta );
+            }
+            else if( ( xPayloadLen > 0 ) && ( xFormat == TELEMETRY_FORMAT_JSON ) )
             {
                 LogDebug( payloadBuf );
             }
         }
-
-        /* Adjust remaining tick count */
-        if( xTaskCheckForTimeOut( &xTimeOut, &xTicksToWait ) == pdFALSE )
+        else
         {
-            /* Wait until its time to poll the sensors again */
-            vTaskDelay( xTicksToWait );
+            xSchemaSent = pdFALSE;
+            vTelemetryDeltaForceKeyframe( &xDelta );
         }
     }
 }
@@ -0,0 +1,270 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+#include "logging_levels.h"
+/* define LOG_LEVEL here if you want to modify the logging level from the default */
+
+#define LOG_LEVEL     LOG_ERROR
+#define LOG_MODULE    LOG_MODULE_SENSOR
+
+#include "logging.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "hw_defs.h"
+#include "imu_fifo.h"
+
+#include "b_u585i_iot02a_motion_sensors.h"
+
+/* Words of one sample set as stored in the FIFO: gyro x, y, z then accel x, y, z */
+#define IMU_FIFO_SET_WORDS      6
+
+/* Sample sets transferred per bus transaction */
+#define IMU_FIFO_BURST_SAMPLES  32
+
+#define IMU_FIFO_STATUS_LEN     4
+#define IMU_FIFO_STATUS2_EMPTY  0x10
+#define IMU_FIFO_STATUS2_OVR    0x40
+#define IMU_FIFO_DEPTH_WORDS    2048
+#define IMU_FIFO_DIFF_MASK      0x07FF
+#define IMU_FIFO_PATTERN_MASK   0x03FF
+
+static TaskHandle_t xConsumerTask = NULL;
+static float fAccSensitivity = 0.0f;
+static float fGyroSensitivity = 0.0f;
+static uint32_t ulOverruns = 0;
+static int16_t psBurstBuf[ IMU_FIFO_BURST_SAMPLES * IMU_FIFO_SET_WORDS ];
+
+/*-----------------------------------------------------------*/
+
+static inline stmdev_ctx_t * prvGetCtx( void )
+{
+    return &( ( ( ISM330DLC_Object_t * ) Motion_Sensor_CompObj[ 0 ] )->Ctx );
+}
+
+static void prvWatermarkCallback( void * pvContext )
+{
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+    ( void ) pvContext;
+
+    if( xConsumerTask != NULL )
+    {
+        vTaskNotifyGiveIndexedFromISR( xConsumerTask,
+                                       IMU_FIFO_NOTIFY_IDX,
+                                       &xHigherPriorityTaskWoken );
+    }
+
+    portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t xImuFifoInit( float fOdrHz,
+                         uint32_t ulWatermark )
+{
+    ISM330DLC_Object_t * pxObj = ( ISM330DLC_Object_t * ) Motion_Sensor_CompObj[ 0 ];
+    int32_t lError = ISM330DLC_OK;
+    ism330dlc_int1_route_t xRoute;
+
+    configASSERT( pxObj != NULL );
+
+    if( ulWatermark == 0 )
+    {
+        ulWatermark = 1;
+    }
+    else if( ulWatermark > IMU_FIFO_MAX_SAMPLES )
+    {
+        ulWatermark = IMU_FIFO_MAX_SAMPLES;
+    }
+
+    xConsumerTask = xTaskGetCurrentTaskHandle();
+    ulOverruns = 0;
+
+    /* Bypass mode empties the FIFO before it is reconfigured */
+    lError |= ISM330DLC_FIFO_Set_Mode( pxObj, ISM330DLC_BYPASS_MODE );
+
+    lError |= ISM330DLC_ACC_SetOutputDataRate( pxObj, fOdrHz );
+    lError |= ISM330DLC_GYRO_SetOutputDataRate( pxObj, fOdrHz );
+    lError |= ISM330DLC_ACC_GetSensitivity( pxObj, &fAccSensitivity );
+    lError |= ISM330DLC_GYRO_GetSensitivity( pxObj, &fGyroSensitivity );
+
+    lError |= ISM330DLC_FIFO_ACC_Set_Decimation( pxObj, ISM330DLC_FIFO_XL_NO_DEC );
+    lError |= ISM330DLC_FIFO_GYRO_Set_Decimation( pxObj, ISM330DLC_FIFO_GY_NO_DEC );
+    lError |= ISM330DLC_FIFO_Set_ODR_Value( pxObj, fOdrHz );
+    lError |= ISM330DLC_FIFO_Set_Watermark_Level( pxObj, ( uint16_t ) ( ulWatermark * IMU_FIFO_SET_WORDS ) );
+
+    lError |= ism330dlc_pin_int1_route_get( &( pxObj->Ctx ), &xRoute );
+    xRoute.int1_fth = 1;
+    lError |= ism330dlc_pin_int1_route_set( &( pxObj->Ctx ), xRoute );
+
+    GPIO_EXTI_Register_Callback( ISM330_INT1_Pin, prvWatermarkCallback, NULL );
+
+    /* Stream mode keeps sampling and drops the oldest data on overflow */
+    lError |= ISM330DLC_FIFO_Set_Mode( pxObj, ISM330DLC_STREAM_MODE );
+
+    if( lError != ISM330DLC_OK )
+    {
+        LogError( "Failed to configure the ISM330DLC FIFO." );
+        vImuFifoDeinit();
+    }
+    else
+    {
+        LogInfo( "ISM330DLC FIFO batching at %ld Hz, watermark %lu samples.",
+                 ( int32_t ) fOdrHz, ulWatermark );
+    }
+
+    return( lError == ISM330DLC_OK ? pdTRUE : pdFALSE );
+}
+
+/*-----------------------------------------------------------*/
+
+void vImuFifoDeinit( void )
+{
+    ISM330DLC_Object_t * pxObj = ( ISM330DLC_Object_t * ) Motion_Sensor_CompObj[ 0 ];
+    ism330dlc_int1_route_t xRoute;
+
+    GPIO_EXTI_Register_Callback( ISM330_INT1_Pin, NULL, NULL );
+
+    if( ism330dlc_pin_int1_route_get( &( pxObj->Ctx ), &xRoute ) == ISM330DLC_OK )
+    {
+        xRoute.int1_fth = 0;
+        ( void ) ism330dlc_pin_int1_route_set( &( pxObj->Ctx ), xRoute );
+    }
+
+    ( void ) ISM330DLC_FIFO_Set_Mode( pxObj, ISM330DLC_BYPASS_MODE );
+
+    xConsumerTask = NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t xImuFifoWait( TickType_t xTimeout )
+{
+    return( ulTaskNotifyTakeIndexed( IMU_FIFO_NOTIFY_IDX, pdTRUE, xTimeout ) > 0 ? pdTRUE : pdFALSE );
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t ulImuFifoRead( int32_t plSamples[][ IMU_FIFO_NUM_AXES ],
+                        uint32_t ulMaxSamples )
+{
+    stmdev_ctx_t * pxCtx = prvGetCtx();
+    uint8_t pucStatus[ IMU_FIFO_STATUS_LEN ] = { 0 };
+    uint32_t ulNumRead = 0;
+    int32_t lError;
+
+    /* FIFO_STATUS1..4: unread word count, flags and the pattern position */
+    lError = ism330dlc_read_reg( pxCtx, ISM330DLC_FIFO_STATUS1, pucStatus, IMU_FIFO_STATUS_LEN );
+
+    if( lError == ISM330DLC_OK )
+    {
+        uint32_t ulWords = ( ( ( uint32_t ) pucStatus[ 1 ] << 8 ) | pucStatus[ 0 ] ) & IMU_FIFO_DIFF_MASK;
+        uint32_t ulPattern = ( ( ( uint32_t ) pucStatus[ 3 ] << 8 ) | pucStatus[ 2 ] ) & IMU_FIFO_PATTERN_MASK;
+
+        /* DIFF_FIFO is 11 bits wide, a full FIFO reads as 0 words but not empty */
+        if( ( ulWords == 0 ) && ( ( pucStatus[ 1 ] & IMU_FIFO_STATUS2_EMPTY ) == 0 ) )
+        {
+            ulWords = IMU_FIFO_DEPTH_WORDS;
+        }
+
+        if( ( pucStatus[ 1 ] & IMU_FIFO_STATUS2_OVR ) != 0 )
+        {
+            ulOverruns++;
+            LogWarn( "ISM330DLC FIFO overrun, oldest samples were dropped." );
+        }
+
+        /* Discard a partial set so that reads start on a gyro x word */
+        if( ( ulPattern != 0 ) && ( ulPattern < IMU_FIFO_SET_WORDS ) )
+        {
+            uint32_t ulSkip = IMU_FIFO_SET_WORDS - ulPattern;
+
+            if( ulWords >= ulSkip )
+            {
+                lError = ism330dlc_read_reg( pxCtx, ISM330DLC_FIFO_DATA_OUT_L,
+                                             ( uint8_t * ) psBurstBuf,
+                                             ( uint16_t ) ( ulSkip * sizeof( int16_t ) ) );
+                ulWords -= ulSkip;
+            }
+            else
+            {
+                ulWords = 0;
+            }
+        }
+
+        uint32_t ulAvailable = ulWords / IMU_FIFO_SET_WORDS;
+
+        if( ulAvailable > ulMaxSamples )
+        {
+            ulAvailable = ulMaxSamples;
+        }
+
+        while( ( lError == ISM330DLC_OK ) && ( ulNumRead < ulAvailable ) )
+        {
+            uint32_t ulBurst = ulAvailable - ulNumRead;
+
+            if( ulBurst > IMU_FIFO_BURST_SAMPLES )
+            {
+                ulBurst = IMU_FIFO_BURST_SAMPLES;
+            }
+
+            /* The FIFO output register rolls over, so one read drains ulBurst sets */
+            lError = ism330dlc_read_reg( pxCtx, ISM330DLC_FIFO_DATA_OUT_L,
+                                         ( uint8_t * ) psBurstBuf,
+                                         ( uint16_t ) ( ulBurst * IMU_FIFO_SET_WORDS * sizeof( int16_t ) ) );
+
+            for( uint32_t i = 0; ( lError == ISM330DLC_OK ) && ( i < ulBurst ); i++ )
+            {
+                const int16_t * psSet = &( psBurstBuf[ i * IMU_FIFO_SET_WORDS ] );
+                int32_t * plOut = plSamples[ ulNumRead + i ];
+
+                for( uint32_t ulAxis = 0; ulAxis < 3; ulAxis++ )
+                {
+                    plOut[ ulAxis ] = ( int32_t ) ( ( float ) psSet[ 3 + ulAxis ] * fAccSensitivity );
+                    plOut[ 3 + ulAxis ] = ( int32_t ) ( ( float ) psSet[ ulAxis ] * fGyroSensitivity );
+                }
+            }
+
+            if( lError == ISM330DLC_OK )
+            {
+                ulNumRead += ulBurst;
+            }
+        }
+    }
+
+    if( lError != ISM330DLC_OK )
+    {
+        LogError( "Failed to read the ISM330DLC FIFO." );
+    }
+
+    return ulNumRead;
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t ulImuFifoGetOverruns( void )
+{
+    return ulOverruns;
+}
@@ -0,0 +1,549 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+#include <string.h>
+
+#include "json_scan.h"
+
+typedef enum
+{
+    SCAN_EXPECT_VALUE = 0,
+    SCAN_EXPECT_VALUE_OR_END, /* After '[' */
+    SCAN_EXPECT_KEY,          /* After ',' in an object */
+    SCAN_EXPECT_KEY_OR_END,   /* After '{' */
+    SCAN_EXPECT_COLON,
+    SCAN_EXPECT_COMMA_OR_END,
+    SCAN_DONE
+} ScanState_t;
+
+typedef struct
+{
+    const char * pcStart; /* Opening brace or bracket */
+    const char * pcKey;   /* Current key of an object, NULL in an array */
+    size_t xKeyLength;
+    uint8_t ucIsArray;
+} ScanLevel_t;
+
+typedef struct
+{
+    const char * pcDoc;
+    size_t xLength;
+    size_t xPos;
+    size_t xDepth;
+    ScanLevel_t pxLevels[ JSON_SCAN_MAX_DEPTH ];
+    JsonScanField_t * pxFields;
+    size_t xNumFields;
+} JsonScanner_t;
+
+/*-----------------------------------------------------------*/
+
+static inline int prvIsDigit( char c )
+{
+    return( ( c >= '0' ) && ( c <= '9' ) );
+}
+
+static inline int prvIsHex( char c )
+{
+    return( prvIsDigit( c ) || ( ( c >= 'a' ) && ( c <= 'f' ) ) || ( ( c >= 'A' ) && ( c <= 'F' ) ) );
+}
+
+static void prvSkipSpace( JsonScanner_t * pxScan )
+{
+    while( pxScan->xPos < pxScan->xLength )
+    {
+        char c = pxScan->pcDoc[ pxScan->xPos ];
+
+        if( ( c != ' ' ) && ( c != '\t' ) && ( c != '\n' ) && ( c != '\r' ) )
+        {
+            break;
+        }
+
+        pxScan->xPos++;
+    }
+}
+
+/*
+ * Does the path of the value about to be parsed equal pcPath? Each segment
+ * of the path must equal the key of one level as a whole, so a key which
+ * contains a '.' matches no path.
+ */
+static int prvPathMatches( const JsonScanner_t * pxScan,
+                           const char * pcPath )
+{
+    int lMatch = ( pxScan->xDepth > 0 );
+    const char * pcSegment = pcPath;
+
+    for( size_t i = 0; ( lMatch != 0 ) && ( i < pxScan->xDepth ); i++ )
+    {
+        const ScanLevel_t * pxLevel = &( pxScan->pxLevels[ i ] );
+        size_t xSegmentLength = strcspn( pcSegment, "." );
+
+        if( pxLevel->ucIsArray != 0 )
+        {
+            lMatch = 0;
+        }
+        else if( ( xSegmentLength != pxLevel->xKeyLength ) ||
+                 ( memcmp( pcSegment, pxLevel->pcKey, xSegmentLength ) != 0 ) )
+        {
+            lMatch = 0;
+        }
+        else
+        {
+            pcSegment = &( pcSegment[ xSegmentLength ] );
+
+            /* Segments are separated by '.' and the last one ends the path */
+            if( i + 1 < pxScan->xDepth )
+            {
+                lMatch = ( *pcSegment == '.' );
+                pcSegment++;
+            }
+            else
+            {
+                lMatch = ( *pcSegment == '\0' );
+            }
+        }
+    }
+
+    return lMatch;
+}
+
+static void prvRecordValue( JsonScanner_t * pxScan,
+                            JsonScanType_t xType,
+                            const char * pcValue,
+                            size_t xValueLength )
+{
+    for( size_t i = 0; i < pxScan->xNumFields; i++ )
+    {
+        JsonScanField_t * pxField = &( pxScan->pxFields[ i ] );
+
+        if( ( pxField->xType == JSON_SCAN_NOT_FOUND ) && prvPathMatches( pxScan, pxField->pcPath ) )
+        {
+            pxField->xType = xType;
+            pxField->pcValue = pcValue;
+            pxField->xValueLength = xValueLength;
+        }
+    }
+}
+
+/* Parse a string at the current '"', return its contents or NULL when malformed */
+static const char * prvParseString( JsonScanner_t * pxScan,
+                                    size_t * pxContentLength )
+{
+    const char * pcContent = &( pxScan->pcDoc[ pxScan->xPos + 1 ] );
+    const char * pcResult = NULL;
+    size_t xPos = pxScan->xPos + 1;
+
+    while( xPos < pxScan->xLength )
+    {
+        unsigned char c = ( unsigned char ) pxScan->pcDoc[ xPos ];
+
+        if( c == '"' )
+        {
+            *pxContentLength = xPos - ( pxScan->xPos + 1 );
+            pxScan->xPos = xPos + 1;
+            pcResult = pcContent;
+            break;
+        }
+        else if( c < 0x20 )
+        {
+            break;
+        }
+        else if( c == '\\' )
+        {
+            char cEscape = ( xPos + 1 < pxScan->xLength ) ? pxScan->pcDoc[ xPos + 1 ] : '\0';
+
+            if( cEscape == 'u' )
+            {
+                size_t i = 0;
+
+                for( i = 0; ( i < 4 ) && ( xPos + 2 + i < pxScan->xLength ); i++ )
+                {
+                    if( !prvIsHex( pxScan->pcDoc[ xPos + 2 + i ] ) )
+                    {
+                        break;
+                    }
+                }
+
+                if( i != 4 )
+                {
+                    break;
+                }
+
+                xPos += 6;
+            }
+            else if( ( cEscape != '\0' ) && ( strchr( "\"\\/bfnrt", cEscape ) != NULL ) )
+            {
+                xPos += 2;
+            }
+            else
+            {
+                break;
+            }
+        }
+        else
+        {
+            xPos++;
+        }
+    }
+
+    return pcResult;
+}
+
+/* -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)? */
+static size_t prvParseNumber( const JsonScanner_t * pxScan )
+{
+    const char * pcDoc = pxScan->pcDoc;
+    size_t xLen = pxScan->xLength;
+    size_t xPos = pxScan->xPos;
+    size_t xDigits = 0;
+    size_t xResult = 0;
+
+    if( pcDoc[ xPos ] == '-' )
+    {
+        xPos++;
+    }
+
+    if( ( xPos < xLen ) && ( pcDoc[ xPos ] == '0' ) )
+    {
+        xPos++;
+        xDigits = 1;
+    }
+    else
+    {
+        while( ( xPos < xLen ) && prvIsDigit( pcDoc[ xPos ] ) )
+        {
+            xPos++;
+            xDigits++;
+        }
+    }
+
+    if( ( xDigits > 0 ) && ( xPos < xLen ) && ( pcDoc[ xPos ] == '.' ) )
+    {
+        xPos++;
+        xDigits = 0;
+
+        while( ( xPos < xLen ) && prvIsDigit( pcDoc[ xPos ] ) )
+        {
+            xPos++;
+            xDigits++;
+        }
+    }
+
+    if( ( xDigits > 0 ) && ( xPos < xLen ) && ( ( pcDoc[ xPos ] == 'e' ) || ( pcDoc[ xPos ] == 'E' ) ) )
+    {
+        xPos++;
+
+        if( ( xPos < xLen ) && ( ( pcDoc[ xPos ] == '+' ) || ( pcDoc[ xPos ] == '-' ) ) )
+        {
+            xPos++;
+        }
+
+        xDigits = 0;
+
+        while( ( xPos < xLen ) && prvIsDigit( pcDoc[ xPos ] ) )
+        {
+            xPos++;
+            xDigits++;
+        }
+    }
+
+    if( xDigits > 0 )
+    {
+        xResult = xPos - pxScan->xPos;
+    }
+
+    return xResult;
+}
+
+/* Parse the scalar at the current position, returns 0 when malformed */
+static int prvParseScalar( JsonScanner_t * pxScan )
+{
+    const char * pcValue = &( pxScan->pcDoc[ pxScan->xPos ] );
+    size_t xRemaining = pxScan->xLength - pxScan->xPos;
+    JsonScanType_t xType = JSON_SCAN_NOT_FOUND;
+    size_t xValueLength = 0;
+    int lResult = 1;
+
+    if( *pcValue == '"' )
+    {
+        pcValue = prvParseString( pxScan, &xValueLength );
+        lResult = ( pcValue != NULL );
+        xType = JSON_SCAN_STRING;
+    }
+    else
+    {
+        if( ( xRemaining >= 4 ) && ( strncmp( pcValue, "true", 4 ) == 0 ) )
+        {
+            xType = JSON_SCAN_TRUE;
+            xValueLength = 4;
+        }
+        else if( ( xRemaining >= 5 ) && ( strncmp( pcValue, "false", 5 ) == 0 ) )
+        {
+            xType = JSON_SCAN_FALSE;
+            xValueLength = 5;
+        }
+        else if( ( xRemaining >= 4 ) && ( strncmp( pcValue, "null", 4 ) == 0 ) )
+        {
+            xType = JSON_SCAN_NULL;
+            xValueLength = 4;
+        }
+        else
+        {
+            xType = JSON_SCAN_NUMBER;
+            xValueLength = prvParseNumber( pxScan );
+        }
+
+        lResult = ( xValueLength > 0 );
+        pxScan->xPos += xValueLength;
+    }
+
+    if( lResult != 0 )
+    {
+        prvRecordValue( pxScan, xType, pcValue, xValueLength );
+    }
+
+    return lResult;
+}
+
+static void prvCloseContainer( JsonScanner_t * pxScan,
+                               ScanState_t * pxState )
+{
+    const ScanLevel_t * pxLevel = &( pxScan->pxLevels[ pxScan->xDepth - 1 ] );
+    const char * pcStart = pxLevel->pcStart;
+    JsonScanType_t xType = ( pxLevel->ucIsArray != 0 ) ? JSON_SCAN_ARRAY : JSON_SCAN_OBJECT;
+
+    pxScan->xPos++;
+    pxScan->xDepth--;
+
+    /* The path of the container is the path of its parent's current key */
+    prvRecordValue( pxScan, xType, pcStart, ( size_t ) ( &( pxScan->pcDoc[ pxScan->xPos ] ) - pcStart ) );
+
+    *pxState = ( pxScan->xDepth == 0 ) ? SCAN_DONE : SCAN_EXPECT_COMMA_OR_END;
+}
+
+/*-----------------------------------------------------------*/
+
+JsonScanStatus_t xJsonScan( const char * pcDoc,
+                            size_t xDocLength,
+                            JsonScanField_t * pxFields,
+                            size_t xNumFields )
+{
+    JsonScanStatus_t xStatus = JSON_SCAN_SUCCESS;
+    ScanState_t xState = SCAN_EXPECT_VALUE;
+    JsonScanner_t xScan;
+
+    if( ( pcDoc == NULL ) || ( xDocLength == 0 ) || ( ( pxFields == NULL ) && ( xNumFields > 0 ) ) )
+    {
+        xStatus = JSON_SCAN_BAD_PARAMETER;
+    }
+    else
+    {
+        xScan.pcDoc = pcDoc;
+        xScan.xLength = xDocLength;
+        xScan.xPos = 0;
+        xScan.xDepth = 0;
+        xScan.pxFields = pxFields;
+        xScan.xNumFields = xNumFields;
+
+        for( size_t i = 0; i < xNumFields; i++ )
+        {
+            pxFields[ i ].xType = JSON_SCAN_NOT_FOUND;
+            pxFields[ i ].pcValue = NULL;
+            pxFields[ i ].xValueLength = 0;
+        }
+    }
+
+    while( xStatus == JSON_SCAN_SUCCESS )
+    {
+        char c;
+
+        prvSkipSpace( &xScan );
+
+        if( xScan.xPos >= xScan.xLength )
+        {
+            if( xState != SCAN_DONE )
+            {
+                xStatus = JSON_SCAN_ILLEGAL_DOCUMENT;
+            }
+
+            break;
+        }
+
+        c = pcDoc[ xScan.xPos ];
+
+        switch( xState )
+        {
+            case SCAN_EXPECT_VALUE:
+            case SCAN_EXPECT_VALUE_OR_END:
+
+                if( ( c == ']' ) && ( xState == SCAN_EXPECT_VALUE_OR_END ) )
+                {
+                    prvCloseContainer( &xScan, &xState );
+                }
+                else if( ( c == '{' ) || ( c == '[' ) )
+                {
+                    if( xScan.xDepth >= JSON_SCAN_MAX_DEPTH )
+                    {
+                        xStatus = JSON_SCAN_MAX_DEPTH_EXCEEDED;
+                    }
+                    else
+                    {
+                        ScanLevel_t * pxLevel = &( xScan.pxLevels[ xScan.xDepth ] );
+
+                        pxLevel->pcStart = &( pcDoc[ xScan.xPos ] );
+                        pxLevel->pcKey = NULL;
+                        pxLevel->xKeyLength = 0;
+                        pxLevel->ucIsArray = ( c == '[' );
+                        xScan.xDepth++;
+                        xScan.xPos++;
+                        xState = ( c == '[' ) ? SCAN_EXPECT_VALUE_OR_END : SCAN_EXPECT_KEY_OR_END;
+                    }
+                }
+                else if( prvParseScalar( &xScan ) != 0 )
+                {
+                    xState = ( xScan.xDepth == 0 ) ? SCAN_DONE : SCAN_EXPECT_COMMA_OR_END;
+                }
+                else
+                {
+                    xStatus = JSON_SCAN_ILLEGAL_DOCUMENT;
+                }
+
+                break;
+
+            case SCAN_EXPECT_KEY:
+            case SCAN_EXPECT_KEY_OR_END:
+
+                if( ( c == '}' ) && ( xState == SCAN_EXPECT_KEY_OR_END ) )
+                {
+                    prvCloseContainer( &xScan, &xState );
+                }
+                else if( c == '"' )
+                {
+                    ScanLevel_t * pxLevel = &( xScan.pxLevels[ xScan.xDepth - 1 ] );
+
+                    pxLevel->pcKey = prvParseString( &xScan, &( pxLevel->xKeyLength ) );
+                    xStatus = ( pxLevel->pcKey != NULL ) ? JSON_SCAN_SUCCESS : JSON_SCAN_ILLEGAL_DOCUMENT;
+                    xState = SCAN_EXPECT_COLON;
+                }
+                else
+                {
+                    xStatus = JSON_SCAN_ILLEGAL_DOCUMENT;
+                }
+
+                break;
+
+            case SCAN_EXPECT_COLON:
+
+                if( c == ':' )
+                {
+                    xScan.xPos++;
+                    xState = SCAN_EXPECT_VALUE;
+                }
+                else
+                {
+                    xStatus = JSON_SCAN_ILLEGAL_DOCUMENT;
+                }
+
+                break;
+
+            case SCAN_EXPECT_COMMA_OR_END:
+               {
+                   uint8_t ucIsArray = xScan.pxLevels[ xScan.xDepth - 1 ].ucIsArray;
+
+                   if( c == ',' )
+                   {
+                       xScan.xPos++;
+                       xState = ( ucIsArray != 0 ) ? SCAN_EXPECT_VALUE : SCAN_EXPECT_KEY;
+                   }
+                   else if( ( ( c == ']' ) && ( ucIsArray != 0 ) ) ||
+                            ( ( c == '}' ) && ( ucIsArray == 0 ) ) )
+                   {
+                       prvCloseContainer( &xScan, &xState );
+                   }
+                   else
+                   {
+                       xStatus = JSON_SCAN_ILLEGAL_DOCUMENT;
+                   }
+               }
+               break;
+
+            case SCAN_DONE:
+            default:
+                /* Only whitespace may follow the top level value */
+                xStatus = JSON_SCAN_ILLEGAL_DOCUMENT;
+                break;
+        }
+    }
+
+    return xStatus;
+}
+
+void vJsonScanDispatch( const JsonScanField_t * pxFields,
+                        size_t xNumFields,
+                        void * pvCtx )
+{
+    for( size_t i = 0; i < xNumFields; i++ )
+    {
+        if( ( pxFields[ i ].xType != JSON_SCAN_NOT_FOUND ) && ( pxFields[ i ].xHandler != NULL ) )
+        {
+            pxFields[ i ].xHandler( &( pxFields[ i ] ), pvCtx );
+        }
+    }
+}
+
+uint32_t ulJsonScanToUInt32( const JsonScanField_t * pxField,
+                             uint32_t ulDefault )
+{
+    uint32_t ulValue = 0;
+    size_t i = 0;
+
+    if( ( pxField->xType != JSON_SCAN_NUMBER ) && ( pxField->xType != JSON_SCAN_STRING ) )
+    {
+        ulValue = ulDefault;
+    }
+    else
+    {
+        int lOverflow = 0;
+
+        for( i = 0; ( i < pxField->xValueLength ) && prvIsDigit( pxField->pcValue[ i ] ); i++ )
+        {
+            uint32_t ulDigit = ( uint32_t ) ( pxField->pcValue[ i ] - '0' );
+
+            if( ulValue > ( ( UINT32_MAX - ulDigit ) / 10 ) )
+            {
+                lOverflow = 1;
+                break;
+            }
+
+            ulValue = ( ulValue * 10 ) + ulDigit;
+        }
+
+        if( ( i == 0 ) || ( lOverflow != 0 ) )
+        {
+            ulValue = ulDefault;
+        }
+    }
+
+    return ulValue;
+}
@@ -28,7 +28,8 @@
 #include "logging_levels.h"
 /* define LOG_LEVEL here if you want to modify the logging level from the default */
 
-#define LOG_LEVEL    LOG_ERROR
+#define LOG_LEVEL     LOG_ERROR
+#define LOG_MODULE    LOG_MODULE_SENSOR
 
 #include "logging.h"
 
@@ -36,6 +37,7 @@
 /* Standard includes. */
 #include <string.h>
 #include <stdio.h>
+#include <stdarg.h>
 #include <assert.h>
 
 /* Kernel includes. */
@@ -47,6 +49,11 @@
 
 #include "sys_evt.h"
 
+#include "sensor_aggregate.h"
+#include "sensor_sched.h"
+#include "telemetry_cbor.h"
+#include "sensor_replay.h"
+
 
 /* MQTT library includes. */
 #include "core_mqtt.h"
@@ -58,20 +65,121 @@
 /* Subscription manager header include. */
 #include "subscription_manager.h"
 
-/* Sensor includes */
-#include "b_u585i_iot02a_motion_sensors.h"
-
 /**
  * @brief Size of statically allocated buffers for holding topic names and
  * payloads.
  */
-#define MQTT_PUBLISH_MAX_LEN                 ( 200 )
-#define MQTT_PUBLISH_PERIOD_MS               ( 100 )
+#define MQTT_PUBLISH_MAX_LEN                 ( 2048 )
+#define MOTION_SAMPLE_PERIOD_MS              ( 100 )
 #define MQTT_PUBLICH_TOPIC_STR_LEN           ( 256 )
 #define MQTT_PUBLISH_BLOCK_TIME_MS           ( 200 )
 #define MQTT_PUBLISH_NOTIFICATION_WAIT_MS    ( 1000 )
 #define MQTT_NOTIFY_IDX                      ( 1 )
 #define MQTT_PUBLISH_QOS                     ( MQTTQoS0 )
+#define MQTT_SCHEMA_TOPIC_SUFFIX             "/schema"
+
+/**
+ * @brief Samples are aggregated over a window of motion_window_ms and
+ * published as one message. Raw sample batches are bounded by the payload size.
+ */
+#define MOTION_NUM_AXES                      ( 9 )
+#define MOTION_MAX_RAW_SAMPLES               ( 20 )
+#define MOTION_MAX_WINDOW_MS                 ( 60000 )
+
+/**
+ * @brief Accelerometer / gyroscope and magnetometer samples arrive from the
+ * sensor acquisition task at their own rates. The latest magnetometer reading
+ * is held for every accelerometer / gyroscope sample until the next one.
+ */
+#define MOTION_FIFO_ODR_HZ                   ( 104.0f )
+#define MOTION_FIFO_RAW_ODR_HZ               ( 12.5f )
+#define MOTION_MAGNETO_RATE_HZ               ( 10.0f )
+#define MOTION_RING_LEN                      ( 64 )
+#define MOTION_FIFO_BATCH                    ( 32 )
+
+typedef enum
+{
+    MOTION_PUB_SUMMARY = 0,
+    MOTION_PUB_RAW = 1
+} MotionPubMode_t;
+
+/* Axis order within a sample */
+static const char * const pcSensorNames[] = { "acceleration_mG", "gyro_mDPS", "magnetism_mGauss" };
+static const char * const pcAxisNames[] = { "x", "y", "z" };
+
+/* CBOR layouts: a summary repeats the statistics per axis, a raw batch repeats samples */
+static const char * const pcAxisLabels[ MOTION_NUM_AXES ] =
+{
+    "acceleration_mG.x",  "acceleration_mG.y",  "acceleration_mG.z",
+    "gyro_mDPS.x",        "gyro_mDPS.y",        "gyro_mDPS.z",
+    "magnetism_mGauss.x", "magnetism_mGauss.y", "magnetism_mGauss.z"
+};
+
+static const TelemetryField_t xSummaryFields[] =
+{
+    { "window_ms", TELEMETRY_FIELD_FIXED, 0  },
+    { "samples",   TELEMETRY_FIELD_FIXED, 0  },
+    { "min",       TELEMETRY_FIELD_FIXED, 0  },
+    { "max",       TELEMETRY_FIELD_FIXED, 0  },
+    { "mean",      TELEMETRY_FIELD_FIXED, -1 },
+    { "rms",       TELEMETRY_FIELD_FIXED, -1 },
+    { "var",       TELEMETRY_FIELD_FIXED, 0  },
+};
+
+static const TelemetrySchema_t xSummarySchema =
+{
+    .usId         = 2,
+    .usRepeatFrom = 2,
+    .ulNumFields  = sizeof( xSummaryFields ) / sizeof( xSummaryFields[ 0 ] ),
+    .pxFields     = xSummaryFields,
+    .ulNumGroups  = MOTION_NUM_AXES,
+    .ppcGroups    = pcAxisLabels,
+};
+
+static const TelemetryField_t xRawFields[] =
+{
+    { "period_ms",          TELEMETRY_FIELD_FIXED, 0 },
+    { "samples",            TELEMETRY_FIELD_FIXED, 0 },
+    { "acceleration_mG.x",  TELEMETRY_FIELD_FIXED, 0 },
+    { "acceleration_mG.y",  TELEMETRY_FIELD_FIXED, 0 },
+    { "acceleration_mG.z",  TELEMETRY_FIELD_FIXED, 0 },
+    { "gyro_mDPS.x",        TELEMETRY_FIELD_FIXED, 0 },
+    { "gyro_mDPS.y",        TELEMETRY_FIELD_FIXED, 0 },
+    { "gyro_mDPS.z",        TELEMETRY_FIELD_FIXED, 0 },
+    { "magnetism_mGauss.x", TELEMETRY_FIELD_FIXED, 0 },
+    { "magnetism_mGauss.y", TELEMETRY_FIELD_FIXED, 0 },
+    { "magnetism_mGauss.z", TELEMETRY_FIELD_FIXED, 0 },
+};
+
+static const TelemetrySchema_t xRawSchema =
+{
+    .usId         = 3,
+    .usRepeatFrom = 2,
+    .ulNumFields  = sizeof( xRawFields ) / sizeof( xRawFields[ 0 ] ),
+    .pxFields     = xRawFields,
+    .ulNumGroups  = 0,
+    .ppcGroups    = NULL,
+};
+
+typedef struct
+{
+    MQTTAgentHandle_t xAgentHandle;
+    const char * pcTopic;
+    const char * pcSchemaTopic;
+    MotionPubMode_t xPubMode;
+    TelemetryFormat_t xFormat;
+    BaseType_t xSchemaSent;
+    uint32_t ulWindowMs;
+    uint32_t ulSamplePeriodMs;
+    uint32_t ulMaxSamples;
+    TickType_t xWindowStart;
+    SensorAggWindow_t xWindow;
+    SensorRing_t * pxRing;
+    int32_t plMagneto[ 3 ];
+} MotionPubCtx_t;
+
+static char pcPayloadBuf[ MQTT_PUBLISH_MAX_LEN ];
+static int32_t plRawSamples[ MOTION_MAX_RAW_SAMPLES ][ MOTION_NUM_AXES ];
 
 
 /*-----------------------------------------------------------*/
@@ -117,6 +225,7 @@ static BaseType_t prvPublishAndWaitForAck( MQTTAgentHandle_t xAgentHandle,
                                            size_t xPublishDataLen )
 {
     MQTTStatus_t xStatus;
+    TickType_t xStartTicks;
 
     configASSERT( pcTopic != NULL );
     configASSERT( pvPublishData != NULL );
@@ -148,6 +257,7 @@ static BaseType_t prvPublishAndWaitForAck( MQTTAgentHandle_t xAgentHandle,
     /* Clear the notification index */
     xTaskNotifyStateClearIndexed( NULL, MQTT_NOTIFY_IDX );
 
+    xStartTicks = xTaskGetTickCount();
 
     xStatus = MQTTAgent_Publish( xAgentHandle,
                                  &xPublishInfo,
@@ -174,6 +284,10 @@ static BaseType_t prvPublishAndWaitForAck( MQTTAgentHandle_t xAgentHandle,
                           xStatus );
                 xResult = pdFALSE;
             }
+            else
+            {
+                vMqttAgentRecordPublishLatency( ( xTaskGetTickCount() - xStartTicks ) * portTICK_PERIOD_MS );
+            }
         }
         else
         {
@@ -191,45 +305,347 @@ static BaseType_t prvPublishAndWaitForAck( MQTTAgentHandle_t xAgentHandle,
 }
 
 /*-----------------------------------------------------------*/
-static BaseType_t xInitSensors( void )
+/* Append formatted text at *pxOffset, returns pdFALSE once the buffer is full */
+static BaseType_t prvAppend( char * pcBuf,
+                             size_t xBufLen,
+                             size_t * pxOffset,
+                             const char * pcFormat,
+                             ... )
+{
+    BaseType_t xResult = pdFALSE;
+
+    if( *pxOffset < xBufLen )
+    {
+        va_list xArgs;
+        int lLen;
+
+        va_start( xArgs, pcFormat );
+        lLen = vsnprintf( &( pcBuf[ *pxOffset ] ), xBufLen - *pxOffset, pcFormat, xArgs );
+        va_end( xArgs );
+
+        if( ( lLen > 0 ) && ( ( size_t ) lLen < ( xBufLen - *pxOffset ) ) )
+        {
+            *pxOffset += ( size_t ) lLen;
+            xResult = pdTRUE;
+        }
+        else
+        {
+            *pxOffset = xBufLen;
+        }
+    }
+
+    return xResult;
+}
+
+static size_t prvFormatSummary( char * pcBuf,
+                                size_t xBufLen,
+                                const SensorAggWindow_t * pxWindow,
+                                uint32_t ulWindowMs )
+{
+    size_t xOffset = 0;
+
+    ( void ) prvAppend( pcBuf, xBufLen, &xOffset, "{\"window_ms\":%lu,\"samples\":%lu",
+                        ulWindowMs, pxWindow->ulCount );
+
+    for( uint32_t ulSensor = 0; ulSensor < ( MOTION_NUM_AXES / 3 ); ulSensor++ )
+    {
+        ( void ) prvAppend( pcBuf, xBufLen, &xOffset, ",\"%s\":{", pcSensorNames[ ulSensor ] );
+
+        for( uint32_t ulAxis = 0; ulAxis < 3; ulAxis++ )
+        {
+            SensorAggStats_t xStats;
+
+            vSensorAggGetStats( pxWindow, ( ulSensor * 3 ) + ulAxis, &xStats );
+
+            ( void ) prvAppend( pcBuf, xBufLen, &xOffset,
+                                "%s\"%s\":{\"min\":%ld,\"max\":%ld,\"mean\":%.1f,\"rms\":%.1f,\"var\":%.1f}",
+                                ( ulAxis == 0 ) ? "" : ",",
+                                pcAxisNames[ ulAxis ],
+                                xStats.lMin,
+                                xStats.lMax,
+                                ( double ) xStats.fMean,
+                                ( double ) xStats.fRms,
+                                ( double ) xStats.fVariance );
+        }
+
+        ( void ) prvAppend( pcBuf, xBufLen, &xOffset, "}" );
+    }
+
+    ( void ) prvAppend( pcBuf, xBufLen, &xOffset, "}" );
+
+    return ( xOffset < xBufLen ) ? xOffset : 0;
+}
+
+static size_t prvFormatRaw( char * pcBuf,
+                            size_t xBufLen,
+                            int32_t plSamples[][ MOTION_NUM_AXES ],
+                            uint32_t ulNumSamples,
+                            uint32_t ulPeriodMs )
 {
-    int32_t lBspError = BSP_ERROR_NONE;
+    size_t xOffset = 0;
+
+    ( void ) prvAppend( pcBuf, xBufLen, &xOffset, "{\"period_ms\":%lu,\"samples\":%lu",
+                        ulPeriodMs, ulNumSamples );
+
+    for( uint32_t ulSensor = 0; ulSensor < ( MOTION_NUM_AXES / 3 ); ulSensor++ )
+    {
+        ( void ) prvAppend( pcBuf, xBufLen, &xOffset, ",\"%s\":[", pcSensorNames[ ulSensor ] );
 
-    /* Gyro + Accelerometer*/
-    lBspError = BSP_MOTION_SENSOR_Init( 0, MOTION_GYRO | MOTION_ACCELERO );
-    lBspError |= BSP_MOTION_SENSOR_Enable( 0, MOTION_GYRO );
-    lBspError |= BSP_MOTION_SENSOR_Enable( 0, MOTION_ACCELERO );
-    lBspError |= BSP_MOTION_SENSOR_SetOutputDataRate( 0, MOTION_GYRO, 1.0f );
-    lBspError |= BSP_MOTION_SENSOR_SetOutputDataRate( 0, MOTION_ACCELERO, 1.0f );
+        for( uint32_t i = 0; i < ulNumSamples; i++ )
+        {
+            const int32_t * plAxes = &( plSamples[ i ][ ulSensor * 3 ] );
 
-    /* Magnetometer */
-    lBspError |= BSP_MOTION_SENSOR_Init( 1, MOTION_MAGNETO );
-    lBspError |= BSP_MOTION_SENSOR_Enable( 1, MOTION_MAGNETO );
-    lBspError |= BSP_MOTION_SENSOR_SetOutputDataRate( 1, MOTION_MAGNETO, 1.0f );
+            ( void ) prvAppend( pcBuf, xBufLen, &xOffset, "%s[%ld,%ld,%ld]",
+                                ( i == 0 ) ? "" : ",",
+                                plAxes[ 0 ], plAxes[ 1 ], plAxes[ 2 ] );
+        }
 
-    return( lBspError == BSP_ERROR_NONE ? pdTRUE : pdFALSE );
+        ( void ) prvAppend( pcBuf, xBufLen, &xOffset, "]" );
+    }
+
+    ( void ) prvAppend( pcBuf, xBufLen, &xOffset, "}" );
+
+    return ( xOffset < xBufLen ) ? xOffset : 0;
+}
+
+static size_t prvFormatSummaryCbor( uint8_t * pucBuf,
+                                   size_t xBufLen,
+                                   const SensorAggWindow_t * pxWindow,
+                                   uint32_t ulWindowMs )
+{
+    TelemetryEncoder_t xEncoder;
+
+    vTelemetryBegin( &xEncoder, &xSummarySchema, pucBuf, xBufLen );
+    vTelemetryAddInt( &xEncoder, ulWindowMs );
+    vTelemetryAddInt( &xEncoder, pxWindow->ulCount );
+
+    for( uint32_t ulAxis = 0; ulAxis < MOTION_NUM_AXES; ulAxis++ )
+    {
+        SensorAggStats_t xStats;
+
+        vSensorAggGetStats( pxWindow, ulAxis, &xStats );
+
+        vTelemetryAddInt( &xEncoder, xStats.lMin );
+        vTelemetryAddInt( &xEncoder, xStats.lMax );
+        vTelemetryAddFloat( &xEncoder, xStats.fMean );
+        vTelemetryAddFloat( &xEncoder, xStats.fRms );
+        vTelemetryAddFloat( &xEncoder, xStats.fVariance );
+    }
+
+    return xTelemetryEnd( &xEncoder );
+}
+
+static size_t prvFormatRawCbor( uint8_t * pucBuf,
+                               size_t xBufLen,
+                               int32_t plSamples[][ MOTION_NUM_AXES ],
+                               uint32_t ulNumSamples,
+                               uint32_t ulPeriodMs )
+{
+    TelemetryEncoder_t xEncoder;
+
+    vTelemetryBegin( &xEncoder, &xRawSchema, pucBuf, xBufLen );
+    vTelemetryAddInt( &xEncoder, ulPeriodMs );
+    vTelemetryAddInt( &xEncoder, ulNumSamples );
+
+    for( uint32_t i = 0; i < ulNumSamples; i++ )
+    {
+        for( uint32_t ulAxis = 0; ulAxis < MOTION_NUM_AXES; ulAxis++ )
+        {
+            vTelemetryAddInt( &xEncoder, plSamples[ i ][ ulAxis ] );
+        }
+    }
+
+    return xTelemetryEnd( &xEncoder );
+}
+
+/*-----------------------------------------------------------*/
+
+static size_t prvFormatWindow( MotionPubCtx_t * pxCtx )
+{
+    size_t xPayloadLen = 0;
+
+    if( pxCtx->xFormat == TELEMETRY_FORMAT_CBOR )
+    {
+        vTraceBegin( "motion_cbor_encode" );
+
+        if( pxCtx->xPubMode == MOTION_PUB_RAW )
+        {
+            xPayloadLen = prvFormatRawCbor( ( uint8_t * ) pcPayloadBuf, MQTT_PUBLISH_MAX_LEN, plRawSamples,
+                                            pxCtx->xWindow.ulCount, pxCtx->ulSamplePeriodMs );
+        }
+        else
+        {
+            xPayloadLen = prvFormatSummaryCbor( ( uint8_t * ) pcPayloadBuf, MQTT_PUBLISH_MAX_LEN,
+                                                &( pxCtx->xWindow ), pxCtx->ulWindowMs );
+        }
+
+        vTraceEnd( "motion_cbor_encode" );
+    }
+    else
+    {
+        vTraceBegin( "motion_json_encode" );
+
+        if( pxCtx->xPubMode == MOTION_PUB_RAW )
+        {
+            xPayloadLen = prvFormatRaw( pcPayloadBuf, MQTT_PUBLISH_MAX_LEN, plRawSamples,
+                                        pxCtx->xWindow.ulCount, pxCtx->ulSamplePeriodMs );
+        }
+        else
+        {
+            xPayloadLen = prvFormatSummary( pcPayloadBuf, MQTT_PUBLISH_MAX_LEN,
+                                            &( pxCtx->xWindow ), pxCtx->ulWindowMs );
+        }
+
+        vTraceEnd( "motion_json_encode" );
+    }
+
+    return xPayloadLen;
+}
+
+/* Describe the CBOR record layout once per connection */
+static void prvPublishSchema( MotionPubCtx_t * pxCtx )
+{
+    const TelemetrySchema_t * pxSchema = ( pxCtx->xPubMode == MOTION_PUB_RAW ) ? &xRawSchema : &xSummarySchema;
+    size_t xSchemaLen;
+
+    xSchemaLen = xTelemetryEncodeSchema( pxSchema, ( uint8_t * ) pcPayloadBuf, MQTT_PUBLISH_MAX_LEN );
+
+    if( xSchemaLen > 0 )
+    {
+        pxCtx->xSchemaSent = prvPublishAndWaitForAck( pxCtx->xAgentHandle,
+                                                      pxCtx->pcSchemaTopic,
+                                                      pcPayloadBuf,
+                                                      xSchemaLen );
+    }
+}
+
+static void prvPublishWindow( MotionPubCtx_t * pxCtx )
+{
+    size_t xPayloadLen = 0;
+
+    if( xIsMqttAgentConnected() != pdTRUE )
+    {
+        pxCtx->xSchemaSent = pdFALSE;
+    }
+    else if( ( pxCtx->xFormat == TELEMETRY_FORMAT_CBOR ) && ( pxCtx->xSchemaSent == pdFALSE ) )
+    {
+        prvPublishSchema( pxCtx );
+    }
+
+    if( pxCtx->xWindow.ulCount > 0 )
+    {
+        xPayloadLen = prvFormatWindow( pxCtx );
+
+        if( ( xPayloadLen > 0 ) &&
+            ( xIsMqttAgentConnected() == pdTRUE ) )
+        {
+            BaseType_t xPublished = prvPublishAndWaitForAck( pxCtx->xAgentHandle,
+                                                             pxCtx->pcTopic,
+                                                             pcPayloadBuf,
+                                                             xPayloadLen );
+
+            if( xPublished != pdPASS )
+            {
+                LogError( "Failed to publish motion sensor data" );
+            }
+
+            vSensorReplayRecordPublish( SENSOR_REPLAY_MOTION, xPublished, xPayloadLen );
+        }
+        else if( xPayloadLen == 0 )
+        {
+            LogError( "Motion sensor payload does not fit in %d bytes.", MQTT_PUBLISH_MAX_LEN );
+        }
+    }
+
+    vSensorAggReset( &( pxCtx->xWindow ) );
+    pxCtx->xWindowStart = xTaskGetTickCount();
+}
+
+static void prvAddSample( MotionPubCtx_t * pxCtx,
+                          const int32_t * plSample )
+{
+    /* Publish early rather than overflow the raw buffer or the aggregation range */
+    if( pxCtx->xWindow.ulCount >= pxCtx->ulMaxSamples )
+    {
+        prvPublishWindow( pxCtx );
+    }
+
+    if( pxCtx->xPubMode == MOTION_PUB_RAW )
+    {
+        ( void ) memcpy( plRawSamples[ pxCtx->xWindow.ulCount ], plSample, sizeof( int32_t ) * MOTION_NUM_AXES );
+    }
+
+    vSensorAggAddSample( &( pxCtx->xWindow ), plSample );
+}
+
+static void prvSampleRing( MotionPubCtx_t * pxCtx )
+{
+    SensorSample_t xSample;
+
+    ( void ) xSensorRingWait( pdMS_TO_TICKS( pxCtx->ulWindowMs ) );
+
+    while( xSensorRingPop( pxCtx->pxRing, &xSample ) == pdTRUE )
+    {
+        if( xSample.ucSensor == SENSOR_ID_MAGNETO )
+        {
+            pxCtx->plMagneto[ 0 ] = ( int32_t ) xSample.fValues[ 0 ];
+            pxCtx->plMagneto[ 1 ] = ( int32_t ) xSample.fValues[ 1 ];
+            pxCtx->plMagneto[ 2 ] = ( int32_t ) xSample.fValues[ 2 ];
+        }
+        else
+        {
+            const float * pfImu = xSample.fValues;
+            const int32_t plSample[ MOTION_NUM_AXES ] =
+            {
+                ( int32_t ) pfImu[ 0 ], ( int32_t ) pfImu[ 1 ], ( int32_t ) pfImu[ 2 ],
+                ( int32_t ) pfImu[ 3 ], ( int32_t ) pfImu[ 4 ], ( int32_t ) pfImu[ 5 ],
+                pxCtx->plMagneto[ 0 ],  pxCtx->plMagneto[ 1 ],  pxCtx->plMagneto[ 2 ]
+            };
+
+            prvAddSample( pxCtx, plSample );
+        }
+    }
+}
+
+/* Feed generated samples through the same windowing path as the sensors */
+static void prvSampleReplay( MotionPubCtx_t * pxCtx )
+{
+    static float pfReplaySamples[ MOTION_FIFO_BATCH ][ SENSOR_REPLAY_MAX_CHANNELS ];
+    uint32_t ulNumSamples;
+
+    /* Sensor samples queued meanwhile would be stale once the replay stops */
+    vSensorRingFlush( pxCtx->pxRing );
+    vTaskDelay( xSensorReplayPeriod( SENSOR_REPLAY_MOTION ) );
+
+    /* Anything beyond one batch is counted as dropped, as a FIFO overrun would be */
+    ulNumSamples = ulSensorReplayRead( SENSOR_REPLAY_MOTION, pfReplaySamples, MOTION_FIFO_BATCH );
+
+    for( uint32_t i = 0; i < ulNumSamples; i++ )
+    {
+        int32_t plSample[ MOTION_NUM_AXES ];
+
+        for( uint32_t ulAxis = 0; ulAxis < MOTION_NUM_AXES; ulAxis++ )
+        {
+            plSample[ ulAxis ] = ( int32_t ) pfReplaySamples[ i ][ ulAxis ];
+        }
+
+        prvAddSample( pxCtx, plSample );
+    }
 }
 
 /*-----------------------------------------------------------*/
 void vMotionSensorsPublish( void * pvParameters )
 {
     ( void ) pvParameters;
-    BaseType_t xResult = pdFALSE;
     BaseType_t xExitFlag = pdFALSE;
 
-    MQTTAgentHandle_t xAgentHandle = NULL;
-    char pcPayloadBuf[ MQTT_PUBLISH_MAX_LEN ];
+    static MotionPubCtx_t xCtx;
     char pcTopicString[ MQTT_PUBLICH_TOPIC_STR_LEN ] = { 0 };
+    char pcSchemaTopicString[ MQTT_PUBLICH_TOPIC_STR_LEN ] = { 0 };
     char * pcDeviceId = NULL;
     size_t xTopicLen = 0;
-
-    xResult = xInitSensors();
-
-    if( xResult != pdTRUE )
-    {
-        LogError( "Error while initializing motion sensors." );
-        vTaskDelete( NULL );
-    }
+    uint32_t ulMaxWindowMs = 0;
+    float fOdrHz = 0.0f;
 
     pcDeviceId = KVStore_getStringHeap( CS_CORE_THING_NAME, NULL );
 
@@ -240,6 +656,7 @@ void vMotionSensorsPublish( void * pvParameters )
     else
     {
         xTopicLen = snprintf( pcTopicString, MQTT_PUBLICH_TOPIC_STR_LEN, "%s/motion_sensor_data", pcDeviceId );
+        ( void ) snprintf( pcSchemaTopicString, MQTT_PUBLICH_TOPIC_STR_LEN, "%s/motion_sensor_data" MQTT_SCHEMA_TOPIC_SUFFIX, pcDeviceId );
     }
 
     if( ( xTopicLen == 0 ) || ( xTopicLen > MQTT_PUBLICH_TOPIC_STR_LEN ) )
@@ -247,63 +664,73 @@ void vMotionSensorsPublish( void * pvParameters )
         LogError( "Error while constructing topic string." );
     }
 
-    xAgentHandle = xGetMqttAgentHandle();
+    xCtx.pcTopic = pcTopicString;
+    xCtx.pcSchemaTopic = pcSchemaTopicString;
+    xCtx.xSchemaSent = pdFALSE;
+    xCtx.xFormat = ( KVStore_getUInt32( CS_MOTION_PUB_FORMAT, NULL ) == TELEMETRY_FORMAT_CBOR ) ? TELEMETRY_FORMAT_CBOR : TELEMETRY_FORMAT_JSON;
+    xCtx.xPubMode = ( KVStore_getUInt32( CS_MOTION_PUB_MODE, NULL ) == MOTION_PUB_RAW ) ? MOTION_PUB_RAW : MOTION_PUB_SUMMARY;
+    xCtx.ulMaxSamples = ( xCtx.xPubMode == MOTION_PUB_RAW ) ? MOTION_MAX_RAW_SAMPLES : SENSOR_AGG_MAX_SAMPLES;
 
-    while( xExitFlag == pdFALSE )
+    /* Raw mode samples at a low rate so that a batch still fits in one payload */
+    fOdrHz = ( xCtx.xPubMode == MOTION_PUB_RAW ) ? MOTION_FIFO_RAW_ODR_HZ : MOTION_FIFO_ODR_HZ;
+    xCtx.ulSamplePeriodMs = ( uint32_t ) ( 1000.0f / fOdrHz );
+
+    xCtx.pxRing = pxSensorRingCreate( MOTION_RING_LEN );
+
+    if( ( xCtx.pxRing == NULL ) ||
+        ( xSensorSchedEnable( SENSOR_ID_IMU, fOdrHz, xCtx.pxRing ) != pdTRUE ) ||
+        ( xSensorSchedEnable( SENSOR_ID_MAGNETO, MOTION_MAGNETO_RATE_HZ, xCtx.pxRing ) != pdTRUE ) )
     {
-        /* Interpret sensor data */
-        int32_t lBspError = BSP_ERROR_NONE;
-        BSP_MOTION_SENSOR_Axes_t xAcceleroAxes, xGyroAxes, xMagnetoAxes;
+        LogError( "Error while initializing motion sensors." );
+        vTaskDelete( NULL );
+    }
+
+    ulMaxWindowMs = xCtx.ulMaxSamples * xCtx.ulSamplePeriodMs;
+
+    if( ulMaxWindowMs > MOTION_MAX_WINDOW_MS )
+    {
+        ulMaxWindowMs = MOTION_MAX_WINDOW_MS;
+    }
+
+    xCtx.ulWindowMs = KVStore_getUInt32( CS_MOTION_WINDOW_MS, NULL );
+
+    if( xCtx.ulWindowMs > ulMaxWindowMs )
+    {
+        xCtx.ulWindowMs = ulMaxWindowMs;
+    }
+    else if( xCtx.ulWindowMs < MOTION_SAMPLE_PERIOD_MS )
+    {
+        xCtx.ulWindowMs = MOTION_SAMPLE_PERIOD_MS;
+    }
 
-        lBspError = BSP_MOTION_SENSOR_GetAxes( 0, MOTION_GYRO, &xGyroAxes );
-        lBspError |= BSP_MOTION_SENSOR_GetAxes( 0, MOTION_ACCELERO, &xAcceleroAxes );
-        lBspError |= BSP_MOTION_SENSOR_GetAxes( 1, MOTION_MAGNETO, &xMagnetoAxes );
+    LogInfo( "Publishing motion sensor %s every %lu ms.",
+             ( xCtx.xPubMode == MOTION_PUB_RAW ) ? "samples" : "summaries", xCtx.ulWindowMs );
 
-        if( lBspError == BSP_ERROR_NONE )
+    vSensorAggInit( &( xCtx.xWindow ), MOTION_NUM_AXES );
+
+    xCtx.xAgentHandle = xGetMqttAgentHandle();
+
+    xCtx.xWindowStart = xTaskGetTickCount();
+
+    while( xExitFlag == pdFALSE )
+    {
+        if( xSensorReplayActive( SENSOR_REPLAY_MOTION ) == pdTRUE )
         {
-            int bytesWritten = snprintf( pcPayloadBuf,
-                                         MQTT_PUBLISH_MAX_LEN,
-                                         "{"
-                                         "\"acceleration_mG\":"
-                                         "{"
-                                         "\"x\": %ld,"
-                                         "\"y\": %ld,"
-                                         "\"z\": %ld"
-                                         "},"
-                                         "\"gyro_mDPS\":"
-                                         "{"
-                                         "\"x\": %ld,"
-                                         "\"y\": %ld,"
-                                         "\"z\": %ld"
-                                         "},"
-                                         "\"magnetism_mGauss\":"
-                                         "{"
-                                         "\"x\": %ld,"
-                                         "\"y\": %ld,"
-                                         "\"z\": %ld"
-                                         "}"
-                                         "}",
-                                         xAcceleroAxes.x, xAcceleroAxes.y, xAcceleroAxes.z,
-                                         xGyroAxes.x, xGyroAxes.y, xGyroAxes.z,
-                                         xMagnetoAxes.x, xMagnetoAxes.y, xMagnetoAxes.z );
-
-            if( ( bytesWritten < MQTT_PUBLISH_MAX_LEN ) &&
-                ( xIsMqttAgentConnected() == pdTRUE ) )
-            {
-                xResult = prvPublishAndWaitForAck( xAgentHandle,
-                                                   pcTopicString,
-                                                   pcPayloadBuf,
-                                                   bytesWritten );
-
-                if( xResult != pdPASS )
-                {
-                    LogError( "Failed to publish motion sensor data" );
-                }
-            }
+            prvSampleReplay( &xCtx );
+        }
+        else
+        {
+            prvSampleRing( &xCtx );
         }
 
-        vTaskDelay( pdMS_TO_TICKS( MQTT_PUBLISH_PERIOD_MS ) );
+        if( ( xTaskGetTickCount() - xCtx.xWindowStart ) >= pdMS_TO_TICKS( xCtx.ulWindowMs ) )
+        {
+            prvPublishWindow( &xCtx );
+        }
     }
 
+    ( void ) xSensorSchedEnable( SENSOR_ID_IMU, 0.0f, NULL );
+    ( void ) xSensorSchedEnable( SENSOR_ID_MAGNETO, 0.0f, NULL );
+
     vPortFree( pcDeviceId );
 }
@@ -31,7 +31,8 @@
 
 #include "logging_levels.h"
 
-#define LOG_LEVEL    LOG_ERROR
+#define LOG_LEVEL     LOG_ERROR
+#define LOG_MODULE    LOG_MODULE_MQTT
 
 #include "logging.h"
 
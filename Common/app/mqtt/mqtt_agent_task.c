@@ -27,7 +27,8 @@
  */
 
 #include "logging_levels.h"
-#define LOG_LEVEL    LOG_DEBUG
+#define LOG_LEVEL     LOG_DEBUG
+#define LOG_MODULE    LOG_MODULE_MQTT
 #include "logging.h"
 
 /* Standard includes. */
@@ -64,6 +65,7 @@
 
 #include "mbedtls_transport.h"
 #include "sys_evt.h"
+#include "trace_ring.h"
 
 /*-----------------------------------------------------------*/
 
@@ -212,6 +214,9 @@ static uint32_t prvGetTimeMs( void );
  */
 static uint32_t ulGlobalEntryTimeMs;
 
+/* Publish latencies reported by the publishing tasks */
+static LatencyHist_t xPublishLatency = { 0 };
+
 /*-----------------------------------------------------------*/
 
 static inline BaseType_t xLockSubCtx( SubMgrCtx_t * pxSubCtx )
@@ -318,6 +323,48 @@ bool xIsMqttAgentConnected( void )
 
 /*-----------------------------------------------------------*/
 
+UBaseType_t uxGetMqttAgentQueueDepth( void )
+{
+    UBaseType_t uxDepth = 0;
+    MQTTAgentHandle_t xHandle = xDefaultInstanceHandle;
+
+    if( ( xHandle != NULL ) &&
+        ( xHandle->agentInterface.pMsgCtx != NULL ) &&
+        ( xHandle->agentInterface.pMsgCtx->xQueue != NULL ) )
+    {
+        uxDepth = uxQueueMessagesWaiting( xHandle->agentInterface.pMsgCtx->xQueue );
+    }
+
+    return uxDepth;
+}
+
+/*-----------------------------------------------------------*/
+
+void vMqttAgentRecordPublishLatency( uint32_t ulLatencyMs )
+{
+    taskENTER_CRITICAL();
+    {
+        vLatencyHistRecord( &xPublishLatency, ulLatencyMs );
+    }
+    taskEXIT_CRITICAL();
+}
+
+/*-----------------------------------------------------------*/
+
+void vMqttAgentTakePublishLatency( LatencyHist_t * pxHist )
+{
+    configASSERT( pxHist != NULL );
+
+    taskENTER_CRITICAL();
+    {
+        ( void ) memcpy( pxHist, &xPublishLatency, sizeof( LatencyHist_t ) );
+        ( void ) memset( &xPublishLatency, 0, sizeof( LatencyHist_t ) );
+    }
+    taskEXIT_CRITICAL();
+}
+
+/*-----------------------------------------------------------*/
+
 static inline void prvUpdateCallbackRefs( SubCallbackElement_t * pxCallbacksList,
                                           MQTTSubscribeInfo_t * pxSubList,
                                           size_t uxOldIdx,
@@ -503,6 +550,8 @@ static bool prvAgentMessageReceive( MQTTAgentMessageContext_t * pxMsgCtx,
                                     &ulNotifyValue,
                                     pdMS_TO_TICKS( blockTimeMs ) ) )
         {
+            vTraceValue( "mqtt_agent_wake", ulNotifyValue );
+
             /* Prioritize processing incoming network packets over local requests */
             if( ulNotifyValue & MQTT_AGENT_NOTIFY_FLAG_SOCKET_RECV )
             {
@@ -660,6 +709,8 @@ static void prvIncomingPublishCallback( MQTTAgentContext_t * pMqttAgentContext,
 
     pxCtx = ( SubMgrCtx_t * ) pMqttAgentContext->pIncomingCallbackContext;
 
+    vTraceBegin( "mqtt_incoming_publish" );
+
     if( xLockSubCtx( pxCtx ) )
     {
         /* Iterate over pxCtx->pxCallbacks list */
@@ -686,6 +737,8 @@ static void prvIncomingPublishCallback( MQTTAgentContext_t * pMqttAgentContext,
         ( void ) xUnlockSubCtx( pxCtx );
     }
 
+    vTraceEnd( "mqtt_incoming_publish" );
+
     if( !xPublishHandled )
     {
         LogWarn( "Incoming publish with topic: \"%.*s\" does not match any callback functions.",
@@ -1109,12 +1162,16 @@ void vMQTTAgentTask( void * pvParameters )
 
             ( void ) MQTTAgent_CancelAll( &( pxCtx->xAgentContext ) );
 
+            vTraceBegin( "mqtt_connect" );
+
             xMQTTStatus = MQTT_Connect( &( pxCtx->xAgentContext.mqttContext ),
                                         &( pxCtx->xConnectInfo ),
                                         NULL,
                                         CONNACK_RECV_TIMEOUT_MS,
                                         &xSessionPresent );
 
+            vTraceEnd( "mqtt_connect" );
+
             configASSERT_CONTINUE( MUTEX_IS_OWNED( pxCtx->xSubMgrCtx.xMutex ) );
 
             LogInfo( "Session present: %d", xSessionPresent );
@@ -2,6 +2,7 @@
 #define _MQTT_AGENT_TASK_H_
 
 #include "FreeRTOS.h"
+#include "latency_hist.h"
 
 struct MQTTAgentTaskCtx;
 typedef struct MQTTAgentContext * MQTTAgentHandle_t;
@@ -15,6 +16,15 @@ void vSleepUntilMQTTAgentConnected( void );
 
 bool xIsMqttAgentConnected( void );
 
+/* Number of commands waiting in the default agent's command queue, 0 before the agent starts */
+UBaseType_t uxGetMqttAgentQueueDepth( void );
+
+/* Record the time from MQTTAgent_Publish to its completion callback, as seen by a publishing task */
+void vMqttAgentRecordPublishLatency( uint32_t ulLatencyMs );
+
+/* Copy the publish latencies recorded since the previous call and reset them */
+void vMqttAgentTakePublishLatency( LatencyHist_t * pxHist );
+
 void vMQTTAgentTask( void * pvParameters );
 
 
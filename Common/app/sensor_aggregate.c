@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+#include <string.h>
+#include <math.h>
+
+#include "sensor_aggregate.h"
+
+/*-----------------------------------------------------------*/
+
+void vSensorAggInit( SensorAggWindow_t * pxWindow,
+                     uint32_t ulNumAxes )
+{
+    pxWindow->ulNumAxes = ( ulNumAxes > SENSOR_AGG_MAX_AXES ) ? SENSOR_AGG_MAX_AXES : ulNumAxes;
+    vSensorAggReset( pxWindow );
+}
+
+void vSensorAggReset( SensorAggWindow_t * pxWindow )
+{
+    pxWindow->ulCount = 0;
+
+    for( uint32_t i = 0; i < pxWindow->ulNumAxes; i++ )
+    {
+        pxWindow->xAxes[ i ].lMin = INT32_MAX;
+        pxWindow->xAxes[ i ].lMax = INT32_MIN;
+        pxWindow->xAxes[ i ].llSum = 0;
+        pxWindow->xAxes[ i ].ullSumSq = 0;
+    }
+}
+
+void vSensorAggAddSample( SensorAggWindow_t * pxWindow,
+                          const int32_t * plValues )
+{
+    for( uint32_t i = 0; i < pxWindow->ulNumAxes; i++ )
+    {
+        SensorAggAxis_t * pxAxis = &( pxWindow->xAxes[ i ] );
+        int32_t lValue = plValues[ i ];
+
+        if( lValue < pxAxis->lMin )
+        {
+            pxAxis->lMin = lValue;
+        }
+
+        if( lValue > pxAxis->lMax )
+        {
+            pxAxis->lMax = lValue;
+        }
+
+        pxAxis->llSum += lValue;
+        pxAxis->ullSumSq += ( uint64_t ) ( ( int64_t ) lValue * lValue );
+    }
+
+    pxWindow->ulCount++;
+}
+
+void vSensorAggGetStats( const SensorAggWindow_t * pxWindow,
+                         uint32_t ulAxis,
+                         SensorAggStats_t * pxStats )
+{
+    ( void ) memset( pxStats, 0, sizeof( SensorAggStats_t ) );
+
+    if( ( pxWindow->ulCount > 0 ) && ( ulAxis < pxWindow->ulNumAxes ) )
+    {
+        const SensorAggAxis_t * pxAxis = &( pxWindow->xAxes[ ulAxis ] );
+        uint64_t ullCount = pxWindow->ulCount;
+        uint64_t ullSumAbs = ( uint64_t ) ( ( pxAxis->llSum < 0 ) ? -pxAxis->llSum : pxAxis->llSum );
+
+        /* n * sum( x^2 ) - sum( x )^2 is exact and never negative */
+        uint64_t ullSpread = ( ullCount * pxAxis->ullSumSq ) - ( ullSumAbs * ullSumAbs );
+
+        pxStats->lMin = pxAxis->lMin;
+        pxStats->lMax = pxAxis->lMax;
+        pxStats->fMean = ( float ) pxAxis->llSum / ( float ) ullCount;
+        pxStats->fRms = sqrtf( ( float ) pxAxis->ullSumSq / ( float ) ullCount );
+        pxStats->fVariance = ( float ) ullSpread / ( ( float ) ullCount * ( float ) ullCount );
+    }
+}
@@ -0,0 +1,409 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+#include <string.h>
+#include <math.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "sensor_replay.h"
+#include "mqtt_agent_task.h"
+
+#define SENSOR_REPLAY_TWO_PI    ( 6.2831853f )
+
+typedef struct
+{
+    float fBase;
+    float fAmplitude;
+    float fPeriodS;
+    float fNoise;
+} SyntheticChannel_t;
+
+typedef struct
+{
+    uint32_t ulNumChannels;
+    const SyntheticChannel_t * pxSynthetic;
+    volatile uint32_t ulRateHz;
+    SensorReplayMode_t xMode;
+    TickType_t xStartTick;
+    uint32_t ulNextSample;
+    uint32_t ulConsumed;
+    uint32_t ulDropped;
+    uint32_t ulPublished;
+    uint32_t ulFailed;
+    uint32_t ulBytes;
+    uint32_t ulMaxQueueDepth;
+    float * pfTrace;
+    uint32_t ulTraceRows;
+    const float * pfTraceInUse; /* Trace the reader generates from outside the critical section */
+    float * pfTraceRetired;     /* Cleared while in use, freed by the reader once done */
+} ReplaySource_t;
+
+/* Source state copied in the critical section, so that samples can be
+ * generated outside of it while the source is stopped or cleared */
+typedef struct
+{
+    uint32_t ulNumChannels;
+    const SyntheticChannel_t * pxSynthetic;
+    uint32_t ulRateHz;
+    SensorReplayMode_t xMode;
+    const float * pfTrace;
+    uint32_t ulTraceRows;
+} ReplaySnapshot_t;
+
+static const SyntheticChannel_t xEnvSynthetic[] =
+{
+    { 22.5f,   0.5f,  600.0f, 0.01f },
+    { 45.0f,   5.0f,  900.0f, 0.05f },
+    { 22.1f,   0.5f,  600.0f, 0.01f },
+    { 1013.2f, 1.5f, 3600.0f, 0.02f },
+};
+
+static const SyntheticChannel_t xMotionSynthetic[] =
+{
+    { 0.0f,    50.0f,  0.5f, 5.0f   },
+    { 0.0f,    50.0f,  0.7f, 5.0f   },
+    { 1000.0f, 20.0f,  0.3f, 5.0f   },
+    { 0.0f,    500.0f, 1.1f, 100.0f },
+    { 0.0f,    500.0f, 1.3f, 100.0f },
+    { 0.0f,    500.0f, 1.7f, 100.0f },
+    { 200.0f,  10.0f,  5.0f, 2.0f   },
+    { -50.0f,  10.0f,  5.0f, 2.0f   },
+    { 400.0f,  10.0f,  5.0f, 2.0f   },
+};
+
+static ReplaySource_t xSources[ SENSOR_REPLAY_NUM_SOURCES ] =
+{
+    { .ulNumChannels = 4, .pxSynthetic = xEnvSynthetic    },
+    { .ulNumChannels = 9, .pxSynthetic = xMotionSynthetic },
+};
+
+/*-----------------------------------------------------------*/
+
+/* Uniform noise in [ -1, 1 ) hashed from the sample and channel, reproducible
+ * between runs and independent of the order in which samples are generated */
+static float prvNoise( uint32_t ulSample,
+                       uint32_t ulChannel )
+{
+    uint32_t ulHash = ( ulSample * SENSOR_REPLAY_MAX_CHANNELS ) + ulChannel + 1UL;
+
+    ulHash = ( ulHash * 1664525UL ) + 1013904223UL;
+    ulHash ^= ulHash >> 16;
+    ulHash *= 0x7FEB352DUL;
+    ulHash ^= ulHash >> 15;
+
+    return ( ( float ) ( ulHash >> 8 ) / 8388608.0f ) - 1.0f;
+}
+
+static void prvGenerate( const ReplaySnapshot_t * pxSnap,
+                         uint32_t ulSample,
+                         float * pfOut )
+{
+    if( ( pxSnap->xMode == SENSOR_REPLAY_TRACE ) && ( pxSnap->ulTraceRows > 0 ) )
+    {
+        const float * pfRow = &( pxSnap->pfTrace[ ( ulSample % pxSnap->ulTraceRows ) * pxSnap->ulNumChannels ] );
+
+        ( void ) memcpy( pfOut, pfRow, pxSnap->ulNumChannels * sizeof( float ) );
+    }
+    else
+    {
+        float fTimeS = ( float ) ulSample / ( float ) pxSnap->ulRateHz;
+
+        for( uint32_t i = 0; i < pxSnap->ulNumChannels; i++ )
+        {
+            const SyntheticChannel_t * pxCh = &( pxSnap->pxSynthetic[ i ] );
+            float fPhase = fmodf( fTimeS / pxCh->fPeriodS, 1.0f ) * SENSOR_REPLAY_TWO_PI;
+
+            pfOut[ i ] = pxCh->fBase + ( pxCh->fAmplitude * sinf( fPhase ) ) + ( pxCh->fNoise * prvNoise( ulSample, i ) );
+        }
+    }
+}
+
+static inline uint32_t prvSamplesDue( const ReplaySource_t * pxSrc )
+{
+    uint64_t ullElapsed = ( uint64_t ) ( xTaskGetTickCount() - pxSrc->xStartTick );
+
+    return ( uint32_t ) ( ( ullElapsed * pxSrc->ulRateHz ) / configTICK_RATE_HZ );
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t xSensorReplayStart( SensorReplaySourceId_t xSource,
+                               uint32_t ulRateHz,
+                               SensorReplayMode_t xMode )
+{
+    BaseType_t xResult = pdFALSE;
+
+    if( ( xSource < SENSOR_REPLAY_NUM_SOURCES ) &&
+        ( ulRateHz >= SENSOR_REPLAY_MIN_RATE_HZ ) &&
+        ( ulRateHz <= SENSOR_REPLAY_MAX_RATE_HZ ) &&
+        ( ( xMode == SENSOR_REPLAY_SYNTHETIC ) || ( xSources[ xSource ].ulTraceRows > 0 ) ) )
+    {
+        ReplaySource_t * pxSrc = &( xSources[ xSource ] );
+
+        taskENTER_CRITICAL();
+        {
+            pxSrc->xMode = xMode;
+            pxSrc->xStartTick = xTaskGetTickCount();
+            pxSrc->ulNextSample = 0;
+            pxSrc->ulConsumed = 0;
+            pxSrc->ulDropped = 0;
+            pxSrc->ulPublished = 0;
+            pxSrc->ulFailed = 0;
+            pxSrc->ulBytes = 0;
+            pxSrc->ulMaxQueueDepth = 0;
+            pxSrc->ulRateHz = ulRateHz;
+        }
+        taskEXIT_CRITICAL();
+
+        xResult = pdTRUE;
+    }
+
+    return xResult;
+}
+
+void vSensorReplayStop( SensorReplaySourceId_t xSource )
+{
+    if( xSource < SENSOR_REPLAY_NUM_SOURCES )
+    {
+        /* Readers check the rate and then copy it, which must not straddle a stop */
+        taskENTER_CRITICAL();
+        {
+            xSources[ xSource ].ulRateHz = 0;
+        }
+        taskEXIT_CRITICAL();
+    }
+}
+
+BaseType_t xSensorReplayAddRow( SensorReplaySourceId_t xSource,
+                                const float * pfValues,
+                                uint32_t ulNumValues )
+{
+    BaseType_t xResult = pdFALSE;
+
+    if( ( xSource < SENSOR_REPLAY_NUM_SOURCES ) &&
+        ( xSources[ xSource ].ulRateHz == 0 ) &&
+        ( ulNumValues == xSources[ xSource ].ulNumChannels ) )
+    {
+        ReplaySource_t * pxSrc = &( xSources[ xSource ] );
+
+        if( pxSrc->pfTrace == NULL )
+        {
+            pxSrc->pfTrace = pvPortMalloc( SENSOR_REPLAY_MAX_ROWS * pxSrc->ulNumChannels * sizeof( float ) );
+        }
+
+        if( ( pxSrc->pfTrace != NULL ) && ( pxSrc->ulTraceRows < SENSOR_REPLAY_MAX_ROWS ) )
+        {
+            ( void ) memcpy( &( pxSrc->pfTrace[ pxSrc->ulTraceRows * pxSrc->ulNumChannels ] ),
+                             pfValues, ulNumValues * sizeof( float ) );
+            pxSrc->ulTraceRows++;
+            xResult = pdTRUE;
+        }
+    }
+
+    return xResult;
+}
+
+void vSensorReplayClear( SensorReplaySourceId_t xSource )
+{
+    float * pfFree = NULL;
+
+    if( xSource < SENSOR_REPLAY_NUM_SOURCES )
+    {
+        ReplaySource_t * pxSrc = &( xSources[ xSource ] );
+
+        taskENTER_CRITICAL();
+        {
+            if( pxSrc->ulRateHz == 0 )
+            {
+                /* A reader which started before the source was stopped may still
+                 * be copying rows, in which case it frees the trace when done */
+                if( ( pxSrc->pfTrace != NULL ) && ( pxSrc->pfTrace == pxSrc->pfTraceInUse ) )
+                {
+                    pxSrc->pfTraceRetired = pxSrc->pfTrace;
+                }
+                else
+                {
+                    pfFree = pxSrc->pfTrace;
+                }
+
+                pxSrc->pfTrace = NULL;
+                pxSrc->ulTraceRows = 0;
+            }
+        }
+        taskEXIT_CRITICAL();
+
+        vPortFree( pfFree );
+    }
+}
+
+BaseType_t xSensorReplayActive( SensorReplaySourceId_t xSource )
+{
+    return ( ( xSource < SENSOR_REPLAY_NUM_SOURCES ) && ( xSources[ xSource ].ulRateHz != 0 ) ) ? pdTRUE : pdFALSE;
+}
+
+TickType_t xSensorReplayPeriod( SensorReplaySourceId_t xSource )
+{
+    TickType_t xPeriod = 1;
+    uint32_t ulRateHz = ( xSource < SENSOR_REPLAY_NUM_SOURCES ) ? xSources[ xSource ].ulRateHz : 0;
+
+    if( ( ulRateHz > 0 ) && ( ( configTICK_RATE_HZ / ulRateHz ) > 1 ) )
+    {
+        xPeriod = configTICK_RATE_HZ / ulRateHz;
+    }
+
+    return xPeriod;
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t ulSensorReplayRead( SensorReplaySourceId_t xSource,
+                             float pfSamples[][ SENSOR_REPLAY_MAX_CHANNELS ],
+                             uint32_t ulMaxSamples )
+{
+    uint32_t ulNumRead = 0;
+    uint32_t ulFirst = 0;
+
+    if( xSource < SENSOR_REPLAY_NUM_SOURCES )
+    {
+        ReplaySource_t * pxSrc = &( xSources[ xSource ] );
+        ReplaySnapshot_t xSnap = { 0 };
+        float * pfFree = NULL;
+
+        taskENTER_CRITICAL();
+        {
+            /* Nothing is due once the source is stopped */
+            if( pxSrc->ulRateHz != 0 )
+            {
+                uint32_t ulAvailable = prvSamplesDue( pxSrc ) - pxSrc->ulNextSample;
+
+                if( ulAvailable > ulMaxSamples )
+                {
+                    pxSrc->ulDropped += ulAvailable - ulMaxSamples;
+                    pxSrc->ulNextSample += ulAvailable - ulMaxSamples;
+                    ulAvailable = ulMaxSamples;
+                }
+
+                ulFirst = pxSrc->ulNextSample;
+                pxSrc->ulNextSample += ulAvailable;
+                pxSrc->ulConsumed += ulAvailable;
+                ulNumRead = ulAvailable;
+
+                xSnap.ulNumChannels = pxSrc->ulNumChannels;
+                xSnap.pxSynthetic = pxSrc->pxSynthetic;
+                xSnap.ulRateHz = pxSrc->ulRateHz;
+                xSnap.xMode = pxSrc->xMode;
+                xSnap.pfTrace = pxSrc->pfTrace;
+                xSnap.ulTraceRows = pxSrc->ulTraceRows;
+
+                /* Holds the trace until the rows are copied, see vSensorReplayClear */
+                pxSrc->pfTraceInUse = pxSrc->pfTrace;
+            }
+        }
+        taskEXIT_CRITICAL();
+
+        for( uint32_t i = 0; i < ulNumRead; i++ )
+        {
+            prvGenerate( &xSnap, ulFirst + i, pfSamples[ i ] );
+        }
+
+        if( xSnap.pfTrace != NULL )
+        {
+            taskENTER_CRITICAL();
+            {
+                pxSrc->pfTraceInUse = NULL;
+                pfFree = pxSrc->pfTraceRetired;
+                pxSrc->pfTraceRetired = NULL;
+            }
+            taskEXIT_CRITICAL();
+
+            vPortFree( pfFree );
+        }
+    }
+
+    return ulNumRead;
+}
+
+void vSensorReplayRecordPublish( SensorReplaySourceId_t xSource,
+                                 BaseType_t xSuccess,
+                                 size_t xPayloadLen )
+{
+    if( xSensorReplayActive( xSource ) == pdTRUE )
+    {
+        ReplaySource_t * pxSrc = &( xSources[ xSource ] );
+        uint32_t ulDepth = ( uint32_t ) uxGetMqttAgentQueueDepth();
+
+        taskENTER_CRITICAL();
+        {
+            if( xSuccess == pdTRUE )
+            {
+                pxSrc->ulPublished++;
+                pxSrc->ulBytes += ( uint32_t ) xPayloadLen;
+            }
+            else
+            {
+                pxSrc->ulFailed++;
+            }
+
+            if( ulDepth > pxSrc->ulMaxQueueDepth )
+            {
+                pxSrc->ulMaxQueueDepth = ulDepth;
+            }
+        }
+        taskEXIT_CRITICAL();
+    }
+}
+
+void vSensorReplayGetStats( SensorReplaySourceId_t xSource,
+                            SensorReplayStats_t * pxStats )
+{
+    ( void ) memset( pxStats, 0, sizeof( SensorReplayStats_t ) );
+
+    if( xSource < SENSOR_REPLAY_NUM_SOURCES )
+    {
+        ReplaySource_t * pxSrc = &( xSources[ xSource ] );
+
+        taskENTER_CRITICAL();
+        {
+            pxStats->ulRateHz = pxSrc->ulRateHz;
+            pxStats->xMode = pxSrc->xMode;
+            pxStats->ulNumChannels = pxSrc->ulNumChannels;
+            pxStats->ulTraceRows = pxSrc->ulTraceRows;
+            pxStats->ulConsumed = pxSrc->ulConsumed;
+            pxStats->ulDropped = pxSrc->ulDropped;
+            pxStats->ulPublished = pxSrc->ulPublished;
+            pxStats->ulFailed = pxSrc->ulFailed;
+            pxStats->ulBytes = pxSrc->ulBytes;
+            pxStats->ulMaxQueueDepth = pxSrc->ulMaxQueueDepth;
+
+            if( pxSrc->ulRateHz > 0 )
+            {
+                pxStats->ulElapsedMs = ( uint32_t ) ( xTaskGetTickCount() - pxSrc->xStartTick ) * portTICK_PERIOD_MS;
+                pxStats->ulSamples = prvSamplesDue( pxSrc );
+            }
+        }
+        taskEXIT_CRITICAL();
+    }
+}
@@ -0,0 +1,723 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+#include "logging_levels.h"
+/* define LOG_LEVEL here if you want to modify the logging level from the default */
+
+#define LOG_LEVEL     LOG_ERROR
+#define LOG_MODULE    LOG_MODULE_SENSOR
+
+#include "logging.h"
+
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "hw_defs.h"
+#include "dwt_cycles.h"
+#include "imu_fifo.h"
+#include "sensor_sched.h"
+
+#include "b_u585i_iot02a_env_sensors.h"
+#include "b_u585i_iot02a_motion_sensors.h"
+
+/* FIFO batches are sized for this latency and drained after twice as long if an interrupt is missed */
+#define SENSOR_SCHED_FIFO_LATENCY_MS      ( 250 )
+#define SENSOR_SCHED_FIFO_BATCH           ( 32 )
+#define SENSOR_SCHED_ENABLE_TIMEOUT_MS    ( 1000 )
+
+/* Tick differences above this are treated as negative, i.e. a deadline still in the future */
+#define SENSOR_SCHED_HORIZON              ( portMAX_DELAY / 2 )
+
+/* Set by xSensorSchedEnable in the acquisition task's IMU_FIFO_NOTIFY_IDX value,
+ * where the watermark interrupt increments the bits below it */
+#define SENSOR_SCHED_EVT_REQUEST          ( 1UL << 31 )
+
+typedef enum
+{
+    SENSOR_STATE_OFF = 0,
+    SENSOR_STATE_PENDING,
+    SENSOR_STATE_RUNNING,
+    SENSOR_STATE_FAILED
+} SensorState_t;
+
+typedef struct SchedSensor SchedSensor_t;
+
+struct SchedSensor
+{
+    const char * pcName;
+    uint32_t ulInstance;
+    uint32_t pulFunctions[ 2 ];
+    BaseType_t ( * pxStart )( SchedSensor_t * pxSensor );
+    BaseType_t ( * pxRead )( SchedSensor_t * pxSensor,
+                             uint32_t ulTimestampMs );
+
+    /* Set by xSensorSchedEnable, applied by the acquisition task */
+    volatile SensorState_t xState;
+    float fRequestedHz;
+    SensorRing_t * pxRequestedRing;
+    TaskHandle_t xRequester;
+    uint32_t ulRequests;
+
+    /* Owned by the acquisition task */
+    float fRateHz;
+    SensorRing_t * pxRing;
+    BaseType_t xBspReady;
+    BaseType_t xUsesFifo;
+    TickType_t xPeriod;
+    TickType_t xDeadline;
+    uint32_t ulReads;
+    uint32_t ulSamples;
+    uint32_t ulErrors;
+    uint32_t ulOverruns;
+    uint32_t ulMaxLatenessMs;
+    uint32_t ulMaxReadUs;
+};
+
+static BaseType_t prvStartEnv( SchedSensor_t * pxSensor );
+static BaseType_t prvReadEnv( SchedSensor_t * pxSensor,
+                              uint32_t ulTimestampMs );
+static BaseType_t prvStartImu( SchedSensor_t * pxSensor );
+static BaseType_t prvReadImu( SchedSensor_t * pxSensor,
+                              uint32_t ulTimestampMs );
+static BaseType_t prvStartMagneto( SchedSensor_t * pxSensor );
+static BaseType_t prvReadMagneto( SchedSensor_t * pxSensor,
+                                  uint32_t ulTimestampMs );
+
+static SchedSensor_t xSensors[ SENSOR_ID_MAX ] =
+{
+    [ SENSOR_ID_HTS221 ] =
+    {
+        .pcName       = "hts221",
+        .ulInstance   = 0,
+        .pulFunctions = { ENV_TEMPERATURE, ENV_HUMIDITY },
+        .pxStart      = prvStartEnv,
+        .pxRead       = prvReadEnv,
+    },
+    [ SENSOR_ID_LPS22HH ] =
+    {
+        .pcName       = "lps22hh",
+        .ulInstance   = 1,
+        .pulFunctions = { ENV_TEMPERATURE, ENV_PRESSURE },
+        .pxStart      = prvStartEnv,
+        .pxRead       = prvReadEnv,
+    },
+    [ SENSOR_ID_IMU ] =
+    {
+        .pcName       = "ism330dlc",
+        .ulInstance   = 0,
+        .pulFunctions = { MOTION_ACCELERO, MOTION_GYRO },
+        .pxStart      = prvStartImu,
+        .pxRead       = prvReadImu,
+    },
+    [ SENSOR_ID_MAGNETO ] =
+    {
+        .pcName       = "iis2mdc",
+        .ulInstance   = 1,
+        .pulFunctions = { MOTION_MAGNETO, 0 },
+        .pxStart      = prvStartMagneto,
+        .pxRead       = prvReadMagneto,
+    },
+};
+
+static TaskHandle_t xSchedTask = NULL;
+static int32_t plFifoSamples[ SENSOR_SCHED_FIFO_BATCH ][ IMU_FIFO_NUM_AXES ];
+
+/*-----------------------------------------------------------*/
+
+SensorRing_t * pxSensorRingCreate( uint32_t ulLength )
+{
+    SensorRing_t * pxRing = NULL;
+
+    configASSERT( ( ulLength > 0 ) && ( ( ulLength & ( ulLength - 1 ) ) == 0 ) );
+
+    pxRing = pvPortMalloc( sizeof( SensorRing_t ) );
+
+    if( pxRing != NULL )
+    {
+        ( void ) memset( pxRing, 0, sizeof( SensorRing_t ) );
+
+        pxRing->ulMask = ulLength - 1;
+        pxRing->xConsumer = xTaskGetCurrentTaskHandle();
+        pxRing->pxSamples = pvPortMalloc( sizeof( SensorSample_t ) * ulLength );
+
+        if( pxRing->pxSamples == NULL )
+        {
+            vPortFree( pxRing );
+            pxRing = NULL;
+        }
+    }
+
+    return pxRing;
+}
+
+static BaseType_t prvRingPush( SensorRing_t * pxRing,
+                               const SensorSample_t * pxSample )
+{
+    BaseType_t xResult = pdFALSE;
+    uint32_t ulHead = pxRing->ulHead;
+    uint32_t ulUsed = ulHead - pxRing->ulTail;
+
+    if( ulUsed > pxRing->ulMask )
+    {
+        pxRing->ulDropped++;
+    }
+    else
+    {
+        pxRing->pxSamples[ ulHead & pxRing->ulMask ] = *pxSample;
+
+        /* Publish the sample before the index that makes it visible */
+        portMEMORY_BARRIER();
+        pxRing->ulHead = ulHead + 1;
+
+        if( ( ulUsed + 1 ) > pxRing->ulHighWater )
+        {
+            pxRing->ulHighWater = ulUsed + 1;
+        }
+
+        xResult = pdTRUE;
+    }
+
+    return xResult;
+}
+
+static inline uint32_t prvRingFree( const SensorRing_t * pxRing )
+{
+    return ( pxRing->ulMask + 1 ) - ( pxRing->ulHead - pxRing->ulTail );
+}
+
+BaseType_t xSensorRingPop( SensorRing_t * pxRing,
+                           SensorSample_t * pxSample )
+{
+    BaseType_t xResult = pdFALSE;
+    uint32_t ulTail = pxRing->ulTail;
+
+    if( ulTail != pxRing->ulHead )
+    {
+        portMEMORY_BARRIER();
+        *pxSample = pxRing->pxSamples[ ulTail & pxRing->ulMask ];
+
+        /* The slot may be reused as soon as the tail moves past it */
+        portMEMORY_BARRIER();
+        pxRing->ulTail = ulTail + 1;
+        xResult = pdTRUE;
+    }
+
+    return xResult;
+}
+
+void vSensorRingFlush( SensorRing_t * pxRing )
+{
+    pxRing->ulTail = pxRing->ulHead;
+}
+
+BaseType_t xSensorRingWait( TickType_t xTimeout )
+{
+    return( ulTaskNotifyTakeIndexed( SENSOR_SCHED_NOTIFY_IDX, pdTRUE, xTimeout ) > 0 ? pdTRUE : pdFALSE );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvPush( SchedSensor_t * pxSensor,
+                     uint32_t ulTimestampMs,
+                     const float * pfValues,
+                     uint32_t ulNumValues )
+{
+    SensorSample_t xSample =
+    {
+        .ulTimestampMs = ulTimestampMs,
+        .ucSensor      = ( uint8_t ) ( pxSensor - xSensors ),
+        .ucNumValues   = ( uint8_t ) ulNumValues,
+    };
+
+    ( void ) memcpy( xSample.fValues, pfValues, sizeof( float ) * ulNumValues );
+
+    if( prvRingPush( pxSensor->pxRing, &xSample ) == pdTRUE )
+    {
+        pxSensor->ulSamples++;
+    }
+}
+
+static BaseType_t prvStartEnv( SchedSensor_t * pxSensor )
+{
+    int32_t lBspError = BSP_ERROR_NONE;
+
+    for( uint32_t i = 0; i < 2; i++ )
+    {
+        if( pxSensor->xBspReady == pdFALSE )
+        {
+            lBspError |= BSP_ENV_SENSOR_Init( pxSensor->ulInstance, pxSensor->pulFunctions[ i ] );
+            lBspError |= BSP_ENV_SENSOR_Enable( pxSensor->ulInstance, pxSensor->pulFunctions[ i ] );
+        }
+
+        lBspError |= BSP_ENV_SENSOR_SetOutputDataRate( pxSensor->ulInstance, pxSensor->pulFunctions[ i ], pxSensor->fRateHz );
+    }
+
+    return( lBspError == BSP_ERROR_NONE ? pdTRUE : pdFALSE );
+}
+
+static BaseType_t prvReadEnv( SchedSensor_t * pxSensor,
+                              uint32_t ulTimestampMs )
+{
+    int32_t lBspError = BSP_ERROR_NONE;
+    float pfValues[ 2 ];
+
+    lBspError = BSP_ENV_SENSOR_GetValue( pxSensor->ulInstance, pxSensor->pulFunctions[ 0 ], &( pfValues[ 0 ] ) );
+    lBspError |= BSP_ENV_SENSOR_GetValue( pxSensor->ulInstance, pxSensor->pulFunctions[ 1 ], &( pfValues[ 1 ] ) );
+
+    if( lBspError == BSP_ERROR_NONE )
+    {
+        prvPush( pxSensor, ulTimestampMs, pfValues, 2 );
+    }
+
+    return( lBspError == BSP_ERROR_NONE ? pdTRUE : pdFALSE );
+}
+
+static BaseType_t prvStartImu( SchedSensor_t * pxSensor )
+{
+    int32_t lBspError = BSP_ERROR_NONE;
+
+    if( pxSensor->xBspReady == pdFALSE )
+    {
+        lBspError = BSP_MOTION_SENSOR_Init( 0, MOTION_GYRO | MOTION_ACCELERO );
+        lBspError |= BSP_MOTION_SENSOR_Enable( 0, MOTION_GYRO );
+        lBspError |= BSP_MOTION_SENSOR_Enable( 0, MOTION_ACCELERO );
+    }
+
+    lBspError |= BSP_MOTION_SENSOR_SetOutputDataRate( 0, MOTION_GYRO, pxSensor->fRateHz );
+    lBspError |= BSP_MOTION_SENSOR_SetOutputDataRate( 0, MOTION_ACCELERO, pxSensor->fRateHz );
+
+    if( lBspError == BSP_ERROR_NONE )
+    {
+        uint32_t ulWatermark = ( uint32_t ) ( ( pxSensor->fRateHz * SENSOR_SCHED_FIFO_LATENCY_MS ) / 1000.0f );
+
+        if( ulWatermark < 1 )
+        {
+            ulWatermark = 1;
+        }
+        else if( ulWatermark > SENSOR_SCHED_FIFO_BATCH )
+        {
+            ulWatermark = SENSOR_SCHED_FIFO_BATCH;
+        }
+
+        pxSensor->xUsesFifo = xImuFifoInit( pxSensor->fRateHz, ulWatermark );
+
+        if( pxSensor->xUsesFifo == pdTRUE )
+        {
+            /* The deadline is only a fallback, the watermark interrupt paces reads */
+            pxSensor->xPeriod = pdMS_TO_TICKS( ( ulWatermark * 2000 ) / ( uint32_t ) pxSensor->fRateHz + 1 );
+        }
+        else
+        {
+            LogError( "IMU FIFO unavailable, polling at %lu mHz.", ( uint32_t ) ( pxSensor->fRateHz * 1000.0f ) );
+        }
+    }
+
+    return( lBspError == BSP_ERROR_NONE ? pdTRUE : pdFALSE );
+}
+
+static BaseType_t prvReadImu( SchedSensor_t * pxSensor,
+                              uint32_t ulTimestampMs )
+{
+    BaseType_t xResult = pdTRUE;
+
+    if( pxSensor->xUsesFifo == pdTRUE )
+    {
+        uint32_t ulFree = prvRingFree( pxSensor->pxRing );
+        uint32_t ulNumSamples = 0;
+
+        /* Leave what does not fit in the ring in the sensor FIFO until the consumer catches up */
+        if( ulFree > 0 )
+        {
+            ulNumSamples = ulImuFifoRead( plFifoSamples, ( ulFree < SENSOR_SCHED_FIFO_BATCH ) ? ulFree : SENSOR_SCHED_FIFO_BATCH );
+        }
+
+        for( uint32_t i = 0; i < ulNumSamples; i++ )
+        {
+            float pfValues[ IMU_FIFO_NUM_AXES ];
+            uint32_t ulAgeMs = ( uint32_t ) ( ( float ) ( ulNumSamples - 1 - i ) * 1000.0f / pxSensor->fRateHz );
+
+            for( uint32_t ulAxis = 0; ulAxis < IMU_FIFO_NUM_AXES; ulAxis++ )
+            {
+                pfValues[ ulAxis ] = ( float ) plFifoSamples[ i ][ ulAxis ];
+            }
+
+            /* The newest set was sampled just before the read, older ones one ODR period apart */
+            prvPush( pxSensor, ulTimestampMs - ulAgeMs, pfValues, IMU_FIFO_NUM_AXES );
+        }
+    }
+    else
+    {
+        int32_t lBspError = BSP_ERROR_NONE;
+        BSP_MOTION_SENSOR_Axes_t xAcceleroAxes, xGyroAxes;
+
+        lBspError = BSP_MOTION_SENSOR_GetAxes( 0, MOTION_ACCELERO, &xAcceleroAxes );
+        lBspError |= BSP_MOTION_SENSOR_GetAxes( 0, MOTION_GYRO, &xGyroAxes );
+
+        if( lBspError == BSP_ERROR_NONE )
+        {
+            const float pfValues[ IMU_FIFO_NUM_AXES ] =
+            {
+                ( float ) xAcceleroAxes.x, ( float ) xAcceleroAxes.y, ( float ) xAcceleroAxes.z,
+                ( float ) xGyroAxes.x,     ( float ) xGyroAxes.y,     ( float ) xGyroAxes.z
+            };
+
+            prvPush( pxSensor, ulTimestampMs, pfValues, IMU_FIFO_NUM_AXES );
+        }
+        else
+        {
+            xResult = pdFALSE;
+        }
+    }
+
+    return xResult;
+}
+
+static BaseType_t prvStartMagneto( SchedSensor_t * pxSensor )
+{
+    int32_t lBspError = BSP_ERROR_NONE;
+
+    if( pxSensor->xBspReady == pdFALSE )
+    {
+        lBspError = BSP_MOTION_SENSOR_Init( 1, MOTION_MAGNETO );
+        lBspError |= BSP_MOTION_SENSOR_Enable( 1, MOTION_MAGNETO );
+    }
+
+    lBspError |= BSP_MOTION_SENSOR_SetOutputDataRate( 1, MOTION_MAGNETO, pxSensor->fRateHz );
+
+    return( lBspError == BSP_ERROR_NONE ? pdTRUE : pdFALSE );
+}
+
+static BaseType_t prvReadMagneto( SchedSensor_t * pxSensor,
+                                  uint32_t ulTimestampMs )
+{
+    BSP_MOTION_SENSOR_Axes_t xMagnetoAxes;
+    BaseType_t xResult = pdFALSE;
+
+    if( BSP_MOTION_SENSOR_GetAxes( 1, MOTION_MAGNETO, &xMagnetoAxes ) == BSP_ERROR_NONE )
+    {
+        const float pfValues[ 3 ] = { ( float ) xMagnetoAxes.x, ( float ) xMagnetoAxes.y, ( float ) xMagnetoAxes.z };
+
+        prvPush( pxSensor, ulTimestampMs, pfValues, 3 );
+        xResult = pdTRUE;
+    }
+
+    return xResult;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvStopSensor( SchedSensor_t * pxSensor )
+{
+    if( pxSensor->xUsesFifo == pdTRUE )
+    {
+        vImuFifoDeinit();
+        pxSensor->xUsesFifo = pdFALSE;
+    }
+}
+
+/* Configure sensors enabled or disabled since the last pass */
+static void prvApplyRequests( TickType_t xNow )
+{
+    for( uint32_t i = 0; i < SENSOR_ID_MAX; i++ )
+    {
+        SchedSensor_t * pxSensor = &( xSensors[ i ] );
+
+        if( pxSensor->xState == SENSOR_STATE_PENDING )
+        {
+            SensorState_t xNewState = SENSOR_STATE_OFF;
+            TaskHandle_t xRequester = NULL;
+            uint32_t ulApplied;
+
+            prvStopSensor( pxSensor );
+
+            /* Readings go to the old ring until here, a reader never sees the ring change under it */
+            taskENTER_CRITICAL();
+            {
+                pxSensor->fRateHz = pxSensor->fRequestedHz;
+                pxSensor->pxRing = pxSensor->pxRequestedRing;
+                ulApplied = pxSensor->ulRequests;
+            }
+            taskEXIT_CRITICAL();
+
+            if( ( pxSensor->fRateHz > 0.0f ) && ( pxSensor->pxRing != NULL ) )
+            {
+                pxSensor->xPeriod = ( TickType_t ) ( ( float ) configTICK_RATE_HZ / pxSensor->fRateHz );
+
+                if( pxSensor->xPeriod == 0 )
+                {
+                    pxSensor->xPeriod = 1;
+                }
+
+                if( pxSensor->pxStart( pxSensor ) == pdTRUE )
+                {
+                    pxSensor->xBspReady = pdTRUE;
+                    pxSensor->xDeadline = xNow;
+                    xNewState = SENSOR_STATE_RUNNING;
+                }
+                else
+                {
+                    LogError( "Failed to start sensor %s.", pxSensor->pcName );
+                    pxSensor->ulErrors++;
+                    xNewState = SENSOR_STATE_FAILED;
+                }
+            }
+
+            taskENTER_CRITICAL();
+            {
+                /* A request made while this one was applied stays pending for the next pass */
+                if( pxSensor->ulRequests == ulApplied )
+                {
+                    pxSensor->xState = xNewState;
+                    xRequester = pxSensor->xRequester;
+                    pxSensor->xRequester = NULL;
+                }
+            }
+            taskEXIT_CRITICAL();
+
+            if( xRequester != NULL )
+            {
+                ( void ) xTaskNotifyGiveIndexed( xRequester, SENSOR_SCHED_REQUEST_IDX );
+            }
+        }
+    }
+}
+
+static void prvReadSensor( SchedSensor_t * pxSensor )
+{
+    uint32_t ulHead = pxSensor->pxRing->ulHead;
+    uint32_t ulStartCycles = DWT->CYCCNT;
+    uint32_t ulReadUs;
+
+    if( pxSensor->pxRead( pxSensor, xTaskGetTickCount() * portTICK_PERIOD_MS ) != pdTRUE )
+    {
+        pxSensor->ulErrors++;
+    }
+
+    ulReadUs = ( DWT->CYCCNT - ulStartCycles ) / ( SystemCoreClock / 1000000 );
+    pxSensor->ulReads++;
+
+    if( ulReadUs > pxSensor->ulMaxReadUs )
+    {
+        pxSensor->ulMaxReadUs = ulReadUs;
+    }
+
+    if( pxSensor->pxRing->ulHead != ulHead )
+    {
+        ( void ) xTaskNotifyGiveIndexed( pxSensor->pxRing->xConsumer, SENSOR_SCHED_NOTIFY_IDX );
+    }
+}
+
+/* Read every sensor whose deadline has passed, or the IMU on a FIFO watermark */
+static void prvRunDue( TickType_t xNow,
+                       BaseType_t xFifoEvent )
+{
+    for( uint32_t i = 0; i < SENSOR_ID_MAX; i++ )
+    {
+        SchedSensor_t * pxSensor = &( xSensors[ i ] );
+        TickType_t xLateness = xNow - pxSensor->xDeadline;
+        BaseType_t xDue = ( xLateness < SENSOR_SCHED_HORIZON ) ? pdTRUE : pdFALSE;
+
+        if( ( pxSensor->xState == SENSOR_STATE_RUNNING ) &&
+            ( ( xDue == pdTRUE ) || ( ( xFifoEvent == pdTRUE ) && ( pxSensor->xUsesFifo == pdTRUE ) ) ) )
+        {
+            prvReadSensor( pxSensor );
+
+            if( pxSensor->xUsesFifo == pdTRUE )
+            {
+                /* Restart the fallback timeout */
+                pxSensor->xDeadline = xNow + pxSensor->xPeriod;
+            }
+            else
+            {
+                if( ( xLateness * portTICK_PERIOD_MS ) > pxSensor->ulMaxLatenessMs )
+                {
+                    pxSensor->ulMaxLatenessMs = xLateness * portTICK_PERIOD_MS;
+                }
+
+                pxSensor->xDeadline += pxSensor->xPeriod;
+
+                /* Skip rather than burst when a whole period was missed */
+                if( ( TickType_t ) ( xNow - pxSensor->xDeadline ) < SENSOR_SCHED_HORIZON )
+                {
+                    pxSensor->ulOverruns++;
+                    pxSensor->xDeadline = xNow + pxSensor->xPeriod;
+                }
+            }
+        }
+    }
+}
+
+static TickType_t prvTicksToNextDeadline( TickType_t xNow )
+{
+    TickType_t xWait = portMAX_DELAY;
+
+    for( uint32_t i = 0; i < SENSOR_ID_MAX; i++ )
+    {
+        if( xSensors[ i ].xState == SENSOR_STATE_RUNNING )
+        {
+            TickType_t xRemaining = xSensors[ i ].xDeadline - xNow;
+
+            if( xRemaining >= SENSOR_SCHED_HORIZON )
+            {
+                xRemaining = 0;
+            }
+
+            if( xRemaining < xWait )
+            {
+                xWait = xRemaining;
+            }
+        }
+    }
+
+    return xWait;
+}
+
+void vSensorSchedTask( void * pvParameters )
+{
+    BaseType_t xFifoEvent = pdFALSE;
+    uint32_t ulEvents;
+
+    ( void ) pvParameters;
+
+    xSchedTask = xTaskGetCurrentTaskHandle();
+
+    vDwtCycleCounterEnable();
+
+    for( ; ; )
+    {
+        TickType_t xNow = xTaskGetTickCount();
+
+        prvApplyRequests( xNow );
+        prvRunDue( xNow, xFifoEvent );
+
+        /* Sleep until the earliest deadline, a FIFO watermark or a new request */
+        ulEvents = ulTaskNotifyTakeIndexed( IMU_FIFO_NOTIFY_IDX,
+                                            pdTRUE,
+                                            prvTicksToNextDeadline( xTaskGetTickCount() ) );
+
+        /* A request alone must not be taken for a watermark interrupt */
+        xFifoEvent = ( ( ulEvents & ~SENSOR_SCHED_EVT_REQUEST ) != 0 ) ? pdTRUE : pdFALSE;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t xSensorSchedEnable( SensorId_t xSensor,
+                               float fRateHz,
+                               SensorRing_t * pxRing )
+{
+    BaseType_t xResult = pdFALSE;
+    SchedSensor_t * pxSensor = NULL;
+    TimeOut_t xTimeOut;
+    TickType_t xTicksToWait = pdMS_TO_TICKS( SENSOR_SCHED_ENABLE_TIMEOUT_MS );
+
+    configASSERT( xSensor < SENSOR_ID_MAX );
+    configASSERT( ( fRateHz == 0.0f ) || ( pxRing != NULL ) );
+
+    pxSensor = &( xSensors[ xSensor ] );
+
+    /* Drop an acknowledgement of an earlier request which timed out */
+    ( void ) ulTaskNotifyTakeIndexed( SENSOR_SCHED_REQUEST_IDX, pdTRUE, 0 );
+
+    taskENTER_CRITICAL();
+    {
+        pxSensor->fRequestedHz = fRateHz;
+        pxSensor->pxRequestedRing = pxRing;
+        pxSensor->xRequester = xTaskGetCurrentTaskHandle();
+        pxSensor->ulRequests++;
+        pxSensor->xState = SENSOR_STATE_PENDING;
+    }
+    taskEXIT_CRITICAL();
+
+    if( xSchedTask != NULL )
+    {
+        ( void ) xTaskNotifyIndexed( xSchedTask, IMU_FIFO_NOTIFY_IDX, SENSOR_SCHED_EVT_REQUEST, eSetBits );
+    }
+
+    vTaskSetTimeOutState( &xTimeOut );
+
+    /* The acquisition task owns the bus, it acknowledges once the sensor is configured */
+    while( ( pxSensor->xState == SENSOR_STATE_PENDING ) &&
+           ( xTaskCheckForTimeOut( &xTimeOut, &xTicksToWait ) == pdFALSE ) )
+    {
+        ( void ) ulTaskNotifyTakeIndexed( SENSOR_SCHED_REQUEST_IDX, pdTRUE, xTicksToWait );
+    }
+
+    taskENTER_CRITICAL();
+    {
+        pxSensor->xRequester = NULL;
+    }
+    taskEXIT_CRITICAL();
+
+    if( fRateHz == 0.0f )
+    {
+        xResult = ( pxSensor->xState == SENSOR_STATE_OFF ) ? pdTRUE : pdFALSE;
+    }
+    else
+    {
+        xResult = ( pxSensor->xState == SENSOR_STATE_RUNNING ) ? pdTRUE : pdFALSE;
+    }
+
+    return xResult;
+}
+
+void vSensorSchedGetStats( SensorId_t xSensor,
+                           SensorSchedStats_t * pxStats )
+{
+    const SchedSensor_t * pxSensor = NULL;
+
+    configASSERT( xSensor < SENSOR_ID_MAX );
+
+    pxSensor = &( xSensors[ xSensor ] );
+
+    pxStats->pcName = pxSensor->pcName;
+    pxStats->fRateHz = ( pxSensor->xState == SENSOR_STATE_RUNNING ) ? pxSensor->fRateHz : 0.0f;
+    pxStats->xUsesFifo = pxSensor->xUsesFifo;
+    pxStats->ulReads = pxSensor->ulReads;
+    pxStats->ulSamples = pxSensor->ulSamples;
+    pxStats->ulErrors = pxSensor->ulErrors;
+    pxStats->ulOverruns = pxSensor->ulOverruns;
+    pxStats->ulMaxLatenessMs = pxSensor->ulMaxLatenessMs;
+    pxStats->ulMaxReadUs = pxSensor->ulMaxReadUs;
+
+    if( pxSensor->pxRing != NULL )
+    {
+        pxStats->ulRingLength = pxSensor->pxRing->ulMask + 1;
+        pxStats->ulRingHighWater = pxSensor->pxRing->ulHighWater;
+        pxStats->ulRingDropped = pxSensor->pxRing->ulDropped;
+    }
+    else
+    {
+        pxStats->ulRingLength = 0;
+        pxStats->ulRingHighWater = 0;
+        pxStats->ulRingDropped = 0;
+    }
+}
+
+UBaseType_t uxSensorSchedStackHighWater( void )
+{
+    return ( xSchedTask != NULL ) ? uxTaskGetStackHighWaterMark( xSchedTask ) : 0;
+}
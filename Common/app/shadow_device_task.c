@@ -25,24 +25,22 @@
  */
 
 /*
- * Demo for showing how to use the Device Shadow library's API. This version
- * of the Device Shadow API provides macros and helper functions for assembling MQTT topics
- * strings, and for determining whether an incoming MQTT message is related to the
- * device shadow.
+ * Shadow service serving the classic shadow and the named shadows of this
+ * thing from a single task.
  *
- * This example assumes there is a powerOn state in the device shadow. It does the
- * following operations:
- * 1. Assemble strings for the MQTT topics of device shadow, by using macros defined by the Device Shadow library.
- * 2. Subscribe to those MQTT topics using the MQTT Agent.
- * 3. Register callbacks for incoming shadow topic publishes with the subsciption_manager.
- * 3. Publish to report the current state of powerOn.
- * 5. Check if powerOn has been changed and send an update if so.
- * 6. If a publish to update reported state was sent, wait until either prvIncomingPublishUpdateAcceptedCallback
- *    or prvIncomingPublishUpdateRejectedCallback handle the response.
- * 7. Wait until time for next check and repeat from step 5.
+ * 1. Subsystems prepare a ShadowInstance_t with their reported properties and
+ *    delta handlers and register it with xShadowServiceRegister.
+ * 2. The service builds the update topic of each shadow once and subscribes to
+ *    the update response topics with wildcard filters shared by every shadow:
+ *    three filters for the classic shadow and three for all named shadows.
+ * 3. prvIncomingPublishCallback routes each response to its shadow by topic.
+ *    Deltas are applied by the shadow's handlers; accepted and rejected
+ *    responses are matched with the outstanding report by client token.
+ * 4. Reported properties changed with vShadowServiceSet are sent as partial
+ *    reported documents, coalesced and rate limited per shadow.
  *
- * Meanwhile, when prvIncomingPublishUpdateDeltaCallback receives changes to the shadow state,
- * it will apply them on the device.
+ * The demo device itself registers the classic shadow with a powerOn state
+ * driving the red LED.
  */
 
 #include "logging_levels.h"
@@ -68,73 +66,47 @@
 /* Subscription manager header include. */
 #include "subscription_manager.h"
 
-/* JSON library includes. */
-#include "core_json.h"
-
-/* Shadow API header. */
-#include "shadow.h"
+/* Shadow service, topics, reported state and delta parsing. */
+#include "shadow_service.h"
+#include "shadow_topic.h"
 
 #include "kvstore.h"
 
 #include "hw_defs.h"
 
 /**
- * @brief Format string representing a Shadow document with a "reported" state.
- *
- * The real json document will look like this:
- * {
- *   "state": {
- *     "reported": {
- *       "powerOn": 1
- *     }
- *   },
- *   "clientToken": "021909"
- * }
+ * @brief Size of the buffer holding a partial reported document, for example:
+ * {"state":{"reported":{"powerOn":1}},"clientToken":"021909"}
  *
- * Note the client token, which is optional. The token is used to identify the
- * response to an update. The client token must be unique at any given time,
- * but may be reused once the update is completed. For this demo, a timestamp
- * is used for a client token.
+ * Only the properties that changed since the last accepted report are sent.
+ * The client token identifies the response to a report; a counter shared by
+ * every shadow is used so that tokens are unique across outstanding reports.
  */
-#define shadowexampleSHADOW_REPORTED_JSON \
-    "{"                                   \
-    "\"state\":{"                         \
-    "\"reported\":{"                      \
-    "\"powerOn\":%1u"                     \
-    "}"                                   \
-    "},"                                  \
-    "\"clientToken\":\"%06lu\""           \
-    "}"
+#define shadowREPORT_DOC_LENGTH                        ( 512U )
 
 /**
- * @brief The expected size of #SHADOW_REPORTED_JSON.
- *
- * Since all of the format specifiers in #SHADOW_REPORTED_JSON include a length,
- * its actual size can be calculated at compile time from the difference between
- * the lengths of the format strings and their formatted output. We must subtract 2
- * from the length as according the following formula:
- * 1. The length of the format string "%1u" is 3.
- * 2. The length of the format string "%06lu" is 5.
- * 3. The formatted length in case 1. is 1 ( for the state of powerOn ).
- * 4. The formatted length in case 2. is 6 ( for the clientToken length ).
- * 5. Thus the additional size of our format is 2 = 3 + 5 - 1 - 6 + 1 (termination character).
- *
- * Custom applications may calculate the length of the JSON document with the same method.
+ * @brief A report is sent once the reported properties have not changed for
+ * shadowREPORT_DEBOUNCE_MS, or once the oldest unreported change is
+ * shadowREPORT_MAX_DELAY_MS old, so that bursts of changes are coalesced.
  */
-#define shadowexampleSHADOW_REPORTED_JSON_LENGTH       ( sizeof( shadowexampleSHADOW_REPORTED_JSON ) - 2 )
+#define shadowREPORT_DEBOUNCE_MS                       ( 250U )
+#define shadowREPORT_MAX_DELAY_MS                      ( 2000U )
 
 /**
- * @brief Time in ms to wait between checking for updates to report.
+ * @brief Minimum time in ms between two reports of the same shadow.
  */
-#define shadowMS_BETWEEN_REPORTS                       ( 15000U )
+#define shadowREPORT_MIN_INTERVAL_MS                   ( 1000U )
 
 /**
- * @brief This demo uses task notifications to signal tasks from MQTT callback
- * functions. shadowexampleMS_TO_WAIT_FOR_NOTIFICATION defines the time, in ticks,
- * to wait for such a callback.
+ * @brief Time in ms to wait for the response to a report.
  */
 #define shadow_SIGNAL_TIMEOUT                          ( 30 * 1000 )
 
+/**
+ * @brief Time in ms between attempts to subscribe when a subscription failed.
+ */
+#define shadowSUBSCRIBE_RETRY_MS                       ( 5000U )
+
 /**
  * @brief The maximum amount of time in milliseconds to wait for the commands
  * to be posted to the MQTT agent should the MQTT agent's command queue be full.
@@ -143,568 +115,807 @@
 #define shadowexampleMAX_COMMAND_SEND_BLOCK_TIME_MS    ( 60 * 1000 )
 
 /**
- * @brief An invalid value for the powerOn state. This is used to set the last
- * reported state to a value that will not match the current state. As we only
- * set the powerOn state to 0 or 1, any other value will suffice.
+ * @brief Time in ms to wait for the PUBACK of a report. The document buffer
+ * is reused once the publish completed.
  */
-#define shadowexampleINVALID_POWERON_STATE             ( 2 )
+#define shadowPUBLISH_NOTIFICATION_WAIT_MS             ( 5000U )
 
 /**
- * @brief Defines structure passed to callbacks and local functions.
+ * @brief Notification index used by the publish completion callback. Index 0
+ * signals property changes, update responses and new registrations.
  */
-typedef struct MQTTAgentCommandContext
-{
-    char * pcDeviceName;
-    uint8_t ucDeviceNameLen;
-    char * pcTopicUpdate;
-    uint16_t usTopicUpdateLen;
-    char * pcTopicUpdateDelta;
-    uint16_t usTopicUpdateDeltaLen;
-    char * pcTopicUpdateAccepted;
-    uint16_t usTopicUpdateAcceptedLen;
-    char * pcTopicUpdateRejected;
-    uint16_t usTopicUpdateRejectedLen;
-    char * pcTopicDelete;
-    uint16_t usTopicDeleteLen;
-
-    /**
-     * @brief The simulated device current power on state.
-     */
-    uint32_t ulCurrentPowerOnState;
-
-    /**
-     * @brief The last reported state. It is initialized to an invalid value so that
-     * an update is initially sent.
-     */
-    uint32_t ulReportedPowerOnState;
+#define shadowPUBLISH_NOTIFY_IDX                       ( 1 )
 
-    /**
-     * @brief Match the received clientToken with the one sent in a device shadow
-     * update. Set to 0 when not waiting on a response.
-     */
-    uint32_t ulClientToken;
+/**
+ * @brief Outcome of the outstanding report of a shadow.
+ */
+#define shadowRESPONSE_NONE                            ( 0U )
+#define shadowRESPONSE_ACCEPTED                        ( 1U )
+#define shadowRESPONSE_REJECTED                        ( 2U )
 
-    /**
-     * @brief The handle of this task. It is used by callbacks to notify this task.
-     */
-    TaskHandle_t xShadowDeviceTaskHandle;
+/**
+ * @brief Index of each reported property of the demo device shadow.
+ */
+#define shadowPROP_POWER_ON                            ( 0 )
 
-    MQTTAgentHandle_t xAgentHandle;
-} ShadowDeviceCtx_t;
+struct MQTTAgentCommandContext
+{
+    MQTTStatus_t xReturnStatus;
+    TaskHandle_t xTaskToNotify;
+};
 
-extern MQTTAgentContext_t xGlobalMqttAgentContext;
+/**
+ * @brief Update response filters. Classic shadow filters first, then the
+ * filters matching every named shadow.
+ */
+typedef enum
+{
+    shadowFILTER_DELTA = 0,
+    shadowFILTER_ACCEPTED,
+    shadowFILTER_REJECTED,
+    shadowFILTER_NAMED_DELTA,
+    shadowFILTER_NAMED_ACCEPTED,
+    shadowFILTER_NAMED_REJECTED,
+    shadowFILTER_COUNT
+} ShadowFilter_t;
 
 /*-----------------------------------------------------------*/
 
 /**
- * @brief Subscribe to the used device shadow topics.
- *
- * @return true if the subscribe is successful;
- * false otherwise.
+ * @brief Registered shadows. Entries are only appended, with the scheduler
+ * suspended, so the MQTT agent task may read the first ulNumShadows entries.
  */
-static bool prvSubscribeToShadowUpdateTopics( ShadowDeviceCtx_t * pxCtx );
+static ShadowInstance_t * pxShadows[ SHADOW_SERVICE_MAX_SHADOWS ] = { NULL };
+static volatile uint32_t ulNumShadows = 0;
 
 /**
- * @brief The callback to execute when there is an incoming publish on the
- * topic for delta updates. It verifies the document and sets the
- * powerOn state accordingly.
+ * @brief Shadows below this index have an update topic and subscriptions.
+ * Only accessed by the shadow task and read by the MQTT agent task.
  */
-static void prvIncomingPublishUpdateDeltaCallback( void * pvCtx,
-                                                   MQTTPublishInfo_t * pxPublishInfo );
+static volatile uint32_t ulNumReady = 0;
 
-/**
- * @brief The callback to execute when there is an incoming publish on the
- * topic for accepted requests. It verifies the document is valid and is being waited on.
- * If so it updates the last reported state and notifies the task to inform completion
- * of the update request.
- */
-static void prvIncomingPublishUpdateAcceptedCallback( void * pvCtx,
-                                                      MQTTPublishInfo_t * pxPublishInfo );
+static TaskHandle_t xShadowTaskHandle = NULL;
+static MQTTAgentHandle_t xAgentHandle = NULL;
+
+static char * pcThingName = NULL;
+static size_t xThingNameLen = 0;
 
+/* Topic filters must stay in scope while subscribed */
+static char * pcFilters[ shadowFILTER_COUNT ] = { NULL };
+static bool pxSubscribed[ shadowFILTER_COUNT ] = { false };
+
+static uint32_t ulNextClientToken = 0;
+
+/* The demo device shadow */
+static ShadowInstance_t xDeviceShadow;
+static ShadowProperty_t pxDeviceProps[ 1 ];
+static uint32_t ulCurrentPowerOnState = 0;
 
 /**
- * @brief The callback to execute when there is an incoming publish on the
- * topic for rejected requests. It verifies the document is valid and is being waited on.
- * If so it notifies the task to inform completion of the update request.
+ * @brief Apply a new powerOn state received in a delta document.
  */
-static void prvIncomingPublishUpdateRejectedCallback( void * pvCtx,
-                                                      MQTTPublishInfo_t * pxPublishInfo );
+static void prvDeltaPowerOnHandler( const JsonScanField_t * pxField,
+                                    void * pvCtx );
 
 /**
- * @brief Entry point of shadow demo.
- *
- * This main function demonstrates how to use the macros provided by the
- * Device Shadow library to assemble strings for the MQTT topics defined
- * by AWS IoT Device Shadow. It uses these macros for topics to subscribe
- * to:
- * - SHADOW_TOPIC_STRING_UPDATE_DELTA for "$aws/things/thingName/shadow/update/delta"
- * - SHADOW_TOPIC_STRING_UPDATE_ACCEPTED for "$aws/things/thingName/shadow/update/accepted"
- * - SHADOW_TOPIC_STRING_UPDATE_REJECTED for "$aws/things/thingName/shadow/update/rejected"
- *
- * It also uses these macros for topics to publish to:
- * - SHADOW_TOPIC_STIRNG_DELETE for "$aws/things/thingName/shadow/delete"
- * - SHADOW_TOPIC_STRING_UPDATE for "$aws/things/thingName/shadow/update"
+ * @brief Desired properties handled by the device. Every path is located in a
+ * single pass over a delta document, then the handlers of the properties
+ * present are called in table order. The first entry must remain "version".
  */
-void vShadowDeviceTask( void * pvParameters );
+static JsonScanField_t xDeviceDeltaFields[] =
+{
+    { .pcPath = "version"                                          },
+    { .pcPath = "state.powerOn", .xHandler = prvDeltaPowerOnHandler },
+};
+
+/*-----------------------------------------------------------*/
+
+static inline uint32_t prvNowMs( void )
+{
+    return ( uint32_t ) ( xTaskGetTickCount() * portTICK_PERIOD_MS );
+}
+
+/*-----------------------------------------------------------*/
+
+void vShadowServiceInitInstance( ShadowInstance_t * pxShadow,
+                                 const char * pcName,
+                                 ShadowProperty_t * pxProps,
+                                 uint32_t ulMaxProps,
+                                 JsonScanField_t * pxDeltaFields,
+                                 size_t xNumDeltaFields,
+                                 void * pvCtx )
+{
+    configASSERT( pxShadow != NULL );
+
+    ( void ) memset( pxShadow, 0, sizeof( ShadowInstance_t ) );
+
+    pxShadow->pcName = pcName;
+    pxShadow->usNameLen = ( pcName != NULL ) ? ( uint16_t ) strnlen( pcName, SHADOW_TOPIC_NAME_MAX_LENGTH + 1 ) : 0;
+    pxShadow->pxDeltaFields = pxDeltaFields;
+    pxShadow->xNumDeltaFields = ( pxDeltaFields != NULL ) ? xNumDeltaFields : 0;
+    pxShadow->pvCtx = pvCtx;
+
+    vShadowReportedInit( &( pxShadow->xReported ),
+                         pxProps,
+                         ulMaxProps,
+                         shadowREPORT_DEBOUNCE_MS,
+                         shadowREPORT_MAX_DELAY_MS,
+                         shadowREPORT_MIN_INTERVAL_MS );
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t lShadowServiceAddProperty( ShadowInstance_t * pxShadow,
+                                   const char * pcName,
+                                   int32_t lValue )
+{
+    configASSERT( pxShadow != NULL );
+
+    return lShadowReportedAdd( &( pxShadow->xReported ), pcName, lValue, prvNowMs() );
+}
 
-static bool prvInitializeCtx( ShadowDeviceCtx_t * pxCtx )
+/*-----------------------------------------------------------*/
+
+bool xShadowServiceRegister( ShadowInstance_t * pxShadow )
 {
     bool xSuccess = true;
 
-    configASSERT( pxCtx );
+    configASSERT( pxShadow != NULL );
 
-    pxCtx->pcDeviceName = NULL;
+    if( pxShadow->pcName != NULL )
+    {
+        /* Names are used verbatim in topics and may not be empty or contain a level separator or wildcard */
+        xSuccess = ( pxShadow->usNameLen > 0 ) &&
+                   ( pxShadow->usNameLen <= SHADOW_TOPIC_NAME_MAX_LENGTH ) &&
+                   ( strpbrk( pxShadow->pcName, "/+#" ) == NULL );
+    }
 
-    /* Note: KVStore_getSize always returns the buffer length needed */
-    if( KVStore_getSize( CS_CORE_THING_NAME ) <= UINT8_MAX )
+    if( ( pxShadow->xNumDeltaFields > 0 ) &&
+        ( strcmp( pxShadow->pxDeltaFields[ 0 ].pcPath, "version" ) != 0 ) )
     {
-        size_t uxDeviceNameLen = 0;
-        pxCtx->pcDeviceName = KVStore_getStringHeap( CS_CORE_THING_NAME, NULL );
+        xSuccess = false;
+    }
 
-        if( pxCtx->pcDeviceName )
+    if( xSuccess )
+    {
+        vTaskSuspendAll();
         {
-            uxDeviceNameLen = strnlen( pxCtx->pcDeviceName, KVStore_getSize( CS_CORE_THING_NAME ) );
-        }
+            for( uint32_t i = 0; i < ulNumShadows; i++ )
+            {
+                if( ( pxShadows[ i ] == pxShadow ) ||
+                    ( ( pxShadows[ i ]->usNameLen == pxShadow->usNameLen ) &&
+                      ( ( pxShadow->pcName == NULL ) ||
+                        ( strcmp( pxShadows[ i ]->pcName, pxShadow->pcName ) == 0 ) ) ) )
+                {
+                    xSuccess = false;
+                }
+            }
 
-        if( uxDeviceNameLen < UINT8_MAX )
-        {
-            pxCtx->ucDeviceNameLen = ( uint8_t ) uxDeviceNameLen;
+            if( xSuccess && ( ulNumShadows < SHADOW_SERVICE_MAX_SHADOWS ) )
+            {
+                pxShadows[ ulNumShadows ] = pxShadow;
+                ulNumShadows++;
+            }
+            else
+            {
+                xSuccess = false;
+            }
         }
+        ( void ) xTaskResumeAll();
     }
 
-    if( ( pxCtx->pcDeviceName != NULL ) &&
-        ( pxCtx->ucDeviceNameLen > 0 ) )
+    if( !xSuccess )
     {
-        ShadowStatus_t xStatus = SHADOW_SUCCESS;
-
-        pxCtx->usTopicUpdateLen = SHADOW_TOPIC_LENGTH_UPDATE( pxCtx->ucDeviceNameLen );
-        pxCtx->pcTopicUpdate = pvPortMalloc( pxCtx->usTopicUpdateLen );
+        LogError( "Failed to register shadow %s.", ( pxShadow->pcName != NULL ) ? pxShadow->pcName : "(classic)" );
+    }
+    else if( xShadowTaskHandle != NULL )
+    {
+        ( void ) xTaskNotifyGive( xShadowTaskHandle );
+    }
 
-        xStatus |= Shadow_GetTopicString( ShadowTopicStringTypeUpdate,
-                                          pxCtx->pcDeviceName,
-                                          pxCtx->ucDeviceNameLen,
-                                          pxCtx->pcTopicUpdate,
-                                          pxCtx->usTopicUpdateLen,
-                                          &( pxCtx->usTopicUpdateLen ) );
+    return xSuccess;
+}
 
-        pxCtx->usTopicUpdateDeltaLen = SHADOW_TOPIC_LENGTH_UPDATE_DELTA( pxCtx->ucDeviceNameLen );
-        pxCtx->pcTopicUpdateDelta = pvPortMalloc( pxCtx->usTopicUpdateDeltaLen );
+/*-----------------------------------------------------------*/
 
-        xStatus |= Shadow_GetTopicString( ShadowTopicStringTypeUpdateDelta,
-                                          pxCtx->pcDeviceName,
-                                          pxCtx->ucDeviceNameLen,
-                                          pxCtx->pcTopicUpdateDelta,
-                                          pxCtx->usTopicUpdateDeltaLen,
-                                          &( pxCtx->usTopicUpdateDeltaLen ) );
+void vShadowServiceSet( ShadowInstance_t * pxShadow,
+                        int32_t lIndex,
+                        int32_t lValue )
+{
+    uint32_t ulChanges = 0;
+    bool xChanged = false;
 
-        pxCtx->usTopicUpdateAcceptedLen = SHADOW_TOPIC_LENGTH_UPDATE_ACCEPTED( pxCtx->ucDeviceNameLen );
-        pxCtx->pcTopicUpdateAccepted = pvPortMalloc( pxCtx->usTopicUpdateAcceptedLen );
+    configASSERT( pxShadow != NULL );
 
-        xStatus |= Shadow_GetTopicString( ShadowTopicStringTypeUpdateAccepted,
-                                          pxCtx->pcDeviceName,
-                                          pxCtx->ucDeviceNameLen,
-                                          pxCtx->pcTopicUpdateAccepted,
-                                          pxCtx->usTopicUpdateAcceptedLen,
-                                          &( pxCtx->usTopicUpdateAcceptedLen ) );
+    vTaskSuspendAll();
+    {
+        ulChanges = pxShadow->xReported.ulChanges;
+        vShadowReportedSet( &( pxShadow->xReported ), lIndex, lValue, prvNowMs() );
+        xChanged = ( pxShadow->xReported.ulChanges != ulChanges );
+    }
+    ( void ) xTaskResumeAll();
 
-        pxCtx->usTopicUpdateRejectedLen = SHADOW_TOPIC_LENGTH_UPDATE_REJECTED( pxCtx->ucDeviceNameLen );
-        pxCtx->pcTopicUpdateRejected = pvPortMalloc( pxCtx->usTopicUpdateRejectedLen );
+    if( xChanged && ( xShadowTaskHandle != NULL ) )
+    {
+        ( void ) xTaskNotifyGive( xShadowTaskHandle );
+    }
+}
 
-        xStatus |= Shadow_GetTopicString( ShadowTopicStringTypeUpdateRejected,
-                                          pxCtx->pcDeviceName,
-                                          pxCtx->ucDeviceNameLen,
-                                          pxCtx->pcTopicUpdateRejected,
-                                          pxCtx->usTopicUpdateRejectedLen,
-                                          &( pxCtx->usTopicUpdateRejectedLen ) );
+/*-----------------------------------------------------------*/
 
+static void prvDeltaPowerOnHandler( const JsonScanField_t * pxField,
+                                    void * pvCtx )
+{
+    uint32_t ulNewState = ulJsonScanToUInt32( pxField, 0 );
 
-        pxCtx->usTopicDeleteLen = SHADOW_TOPIC_LENGTH_DELETE( pxCtx->ucDeviceNameLen );
-        pxCtx->pcTopicDelete = pvPortMalloc( pxCtx->usTopicDeleteLen );
+    ( void ) pvCtx;
 
-        xStatus |= Shadow_GetTopicString( ShadowTopicStringTypeDelete,
-                                          pxCtx->pcDeviceName,
-                                          pxCtx->ucDeviceNameLen,
-                                          pxCtx->pcTopicDelete,
-                                          pxCtx->usTopicDeleteLen,
-                                          &( pxCtx->usTopicDeleteLen ) );
+    LogInfo( "Setting powerOn state to %u.", ( unsigned int ) ulNewState );
+    /* Set the new powerOn state. */
+    ulCurrentPowerOnState = ulNewState;
 
-        xSuccess &= ( xStatus == SHADOW_SUCCESS );
+    if( ulNewState == 1 )
+    {
+        HAL_GPIO_WritePin( LED_RED_GPIO_Port, LED_RED_Pin, GPIO_PIN_RESET ); /* Turn the LED ON */
     }
     else
     {
-        xSuccess = false;
+        HAL_GPIO_WritePin( LED_RED_GPIO_Port, LED_RED_Pin, GPIO_PIN_SET ); /* Turn the LED off */
     }
 
-    return xSuccess;
+    /* Report the new state. */
+    vShadowServiceSet( &xDeviceShadow, shadowPROP_POWER_ON, ( int32_t ) ulNewState );
 }
 
 /*-----------------------------------------------------------*/
 
-static bool prvSubscribeToShadowUpdateTopics( ShadowDeviceCtx_t * pxCtx )
+static void prvHandleDelta( ShadowInstance_t * pxShadow,
+                            MQTTPublishInfo_t * pxPublishInfo )
 {
-    MQTTStatus_t xStatus = MQTTSuccess;
+    uint32_t ulVersion = 0UL;
+    JsonScanStatus_t xScanStatus = JSON_SCAN_SUCCESS;
+    const JsonScanField_t * pxVersion = &( pxShadow->pxDeltaFields[ 0 ] );
+
+    /* The payload will look similar to this:
+     * {
+     *      "version": 12,
+     *      "timestamp": 1595437367,
+     *      "state": {
+     *          "powerOn": 1
+     *      },
+     *      "metadata": {
+     *          "powerOn": {
+     *          "timestamp": 1595437367
+     *          }
+     *      },
+     *      "clientToken": "388062"
+     *  }
+     */
 
-    xStatus = MqttAgent_SubscribeSync( pxCtx->xAgentHandle,
-                                       pxCtx->pcTopicUpdateDelta,
-                                       MQTTQoS1,
-                                       prvIncomingPublishUpdateDeltaCallback,
-                                       pxCtx );
+    /* Validate the document and locate every handled property in one pass. */
+    xScanStatus = xJsonScan( pxPublishInfo->pPayload,
+                             pxPublishInfo->payloadLength,
+                             pxShadow->pxDeltaFields,
+                             pxShadow->xNumDeltaFields );
 
-    if( xStatus != MQTTSuccess )
+    if( xScanStatus != JSON_SCAN_SUCCESS )
+    {
+        LogError( "Invalid JSON document received!" );
+    }
+    else if( pxVersion->xType == JSON_SCAN_NOT_FOUND )
     {
-        LogError( "Failed to subscribe to topic: %s", pxCtx->pcTopicUpdateDelta );
+        LogError( "Version field not found in JSON document!" );
     }
     else
     {
-        xStatus = MqttAgent_SubscribeSync( pxCtx->xAgentHandle,
-                                           pxCtx->pcTopicUpdateAccepted,
-                                           MQTTQoS1,
-                                           prvIncomingPublishUpdateAcceptedCallback,
-                                           pxCtx );
+        /* Convert the extracted value to an unsigned integer value. */
+        ulVersion = ulJsonScanToUInt32( pxVersion, 0 );
 
-        if( xStatus != MQTTSuccess )
+        /* Make sure the version is newer than the last one we received. */
+        if( ulVersion <= pxShadow->ulVersion )
         {
-            LogError( "Failed to subscribe to topic: %s", pxCtx->pcTopicUpdateAccepted );
+            /* In this demo, we discard the incoming message
+             * if the version number is not newer than the latest
+             * that we've received before. Your application may use a
+             * different approach.
+             */
+            LogWarn( ( "Received unexpected delta update with version %u. Current version is %u",
+                       ( unsigned int ) ulVersion,
+                       ( unsigned int ) pxShadow->ulVersion ) );
         }
-    }
+        else
+        {
+            LogInfo( "Received delta update with version %.*s.",
+                     pxVersion->xValueLength,
+                     pxVersion->pcValue );
 
-    if( xStatus == MQTTSuccess )
-    {
-        xStatus = MqttAgent_SubscribeSync( pxCtx->xAgentHandle,
-                                           pxCtx->pcTopicUpdateRejected,
-                                           MQTTQoS1,
-                                           prvIncomingPublishUpdateRejectedCallback,
-                                           pxCtx );
+            /* Set received version as the current version. */
+            pxShadow->ulVersion = ulVersion;
 
-        if( xStatus != MQTTSuccess )
-        {
-            LogError( "Failed to subscribe to topic: %s", pxCtx->pcTopicUpdateRejected );
+            vJsonScanDispatch( &( pxShadow->pxDeltaFields[ 1 ] ), pxShadow->xNumDeltaFields - 1, pxShadow->pvCtx );
         }
     }
-
-    return( xStatus == MQTTSuccess );
 }
 
 /*-----------------------------------------------------------*/
 
-static void prvIncomingPublishUpdateDeltaCallback( void * pvCtx,
-                                                   MQTTPublishInfo_t * pxPublishInfo )
+static void prvHandleResponse( ShadowInstance_t * pxShadow,
+                               MQTTPublishInfo_t * pxPublishInfo,
+                               bool xAccepted )
 {
-    static uint32_t ulCurrentVersion = 0; /* Remember the latest version number we've received */
+    uint32_t ulReceivedToken = 0UL;
     uint32_t ulVersion = 0UL;
-    uint32_t ulNewState = 0UL;
-    char * pcOutValue = NULL;
-    uint32_t ulOutValueLength = 0UL;
-    JSONStatus_t result = JSONSuccess;
-
-    ShadowDeviceCtx_t * pxCtx = ( ShadowDeviceCtx_t * ) pvCtx;
-
-    configASSERT( pxPublishInfo != NULL );
-    configASSERT( pxPublishInfo->pPayload != NULL );
-
-    LogDebug( "/update/delta json payload:%.*s.",
-              pxPublishInfo->payloadLength,
-              ( const char * ) pxPublishInfo->pPayload );
-
-    /* The payload will look similar to this:
+    JsonScanStatus_t xScanStatus = JSON_SCAN_SUCCESS;
+    JsonScanField_t pxFields[] =
+    {
+        { .pcPath = "clientToken" },
+        { .pcPath = "version"     },
+        { .pcPath = "code"        },
+    };
+
+    /* An accepted response echoes the reported state with its metadata, the
+     * new document version and the clientToken we sent on the /update topic.
+     * A rejected response looks similar to this:
      * {
-     *      "state": {
-     *          "powerOn": 1
-     *      },
-     *      "metadata": {
-     *          "powerOn": {
-     *              "timestamp": 1595437367
-     *          }
-     *      },
-     *      "timestamp": 1595437367,
-     *      "clientToken": "388062",
-     *      "version": 12
-     *  }
+     *    "code": error-code,
+     *    "message": "error-message",
+     *    "timestamp": timestamp,
+     *    "clientToken": "token"
+     * }
      */
 
-    /* Make sure the payload is a valid json document. */
-    result = JSON_Validate( pxPublishInfo->pPayload,
-                            pxPublishInfo->payloadLength );
+    /* Validate the document and locate the clientToken, version and error code in one pass. */
+    xScanStatus = xJsonScan( pxPublishInfo->pPayload,
+                             pxPublishInfo->payloadLength,
+                             pxFields,
+                             sizeof( pxFields ) / sizeof( pxFields[ 0 ] ) );
 
-    if( result != JSONSuccess )
+    if( xScanStatus != JSON_SCAN_SUCCESS )
     {
         LogError( "Invalid JSON document received!" );
     }
+    else if( pxFields[ 0 ].xType == JSON_SCAN_NOT_FOUND )
+    {
+        LogDebug( "Ignoring update response with no clientToken field." );
+    }
     else
     {
-        /* Obtain the version value. */
-        result = JSON_Search( ( char * ) pxPublishInfo->pPayload,
-                              pxPublishInfo->payloadLength,
-                              "version",
-                              sizeof( "version" ) - 1,
-                              &pcOutValue,
-                              ( size_t * ) &ulOutValueLength );
+        ulReceivedToken = ulJsonScanToUInt32( &( pxFields[ 0 ] ), 0 );
 
-        if( result != JSONSuccess )
+        /* If we are waiting for a response, ulClientToken will be the token for the response
+         * we are waiting for, else it will be 0. ulReceivedToken may not match if the response is
+         * not for us or if it is is a response that arrived after we timed out
+         * waiting for it.
+         */
+        if( ( ulReceivedToken == 0 ) || ( ulReceivedToken != pxShadow->ulClientToken ) )
         {
-            LogError( "Version field not found in JSON document!" );
+            LogDebug( "Ignoring update response with clientToken %lu.", ( unsigned long ) ulReceivedToken );
         }
-        else
+        else if( xAccepted )
         {
-            /* Convert the extracted value to an unsigned integer value. */
-            ulVersion = ( uint32_t ) strtoul( pcOutValue, NULL, 10 );
+            LogInfo( "Received accepted response for update with token %lu. ", ( unsigned long ) ulReceivedToken );
+
+            /* Deltas generated before this report are stale once it is accepted. */
+            ulVersion = ulJsonScanToUInt32( &( pxFields[ 1 ] ), 0 );
 
-            /* Make sure the version is newer than the last one we received. */
-            if( ulVersion <= ulCurrentVersion )
+            if( ulVersion > pxShadow->ulVersion )
             {
-                /* In this demo, we discard the incoming message
-                 * if the version number is not newer than the latest
-                 * that we've received before. Your application may use a
-                 * different approach.
-                 */
-                LogWarn( ( "Received unexpected delta update with version %u. Current version is %u",
-                           ( unsigned int ) ulVersion,
-                           ( unsigned int ) ulCurrentVersion ) );
+                pxShadow->ulVersion = ulVersion;
+            }
+
+            pxShadow->ulResponse = shadowRESPONSE_ACCEPTED;
+        }
+        else
+        {
+            if( pxFields[ 2 ].xType == JSON_SCAN_NOT_FOUND )
+            {
+                LogWarn( "Received rejected response for update with token %lu and no error code.", ( unsigned long ) ulReceivedToken );
             }
             else
             {
-                LogInfo( "Received delta update with version %.*s.",
-                         ulOutValueLength,
-                         pcOutValue );
-
-                /* Set received version as the current version. */
-                ulCurrentVersion = ulVersion;
-
-                /* Get powerOn state from json documents. */
-                result = JSON_Search( ( char * ) pxPublishInfo->pPayload,
-                                      pxPublishInfo->payloadLength,
-                                      "state.powerOn",
-                                      sizeof( "state.powerOn" ) - 1,
-                                      &pcOutValue,
-                                      ( size_t * ) &ulOutValueLength );
-
-                if( result != JSONSuccess )
-                {
-                    LogWarn( "powerOn field not found in JSON document!" );
-                }
-                else
-                {
-                    /* Convert the powerOn state value to an unsigned integer value. */
-                    ulNewState = ( uint32_t ) strtoul( pcOutValue, NULL, 10 );
-
-                    LogInfo( "Setting powerOn state to %u.", ( unsigned int ) ulNewState );
-                    /* Set the new powerOn state. */
-                    pxCtx->ulCurrentPowerOnState = ulNewState;
-
-                    if( ulNewState == 1 )
-                    {
-                        HAL_GPIO_WritePin( LED_RED_GPIO_Port, LED_RED_Pin, GPIO_PIN_RESET ); /* Turn the LED ON */
-                    }
-                    else
-                    {
-                        HAL_GPIO_WritePin( LED_RED_GPIO_Port, LED_RED_Pin, GPIO_PIN_SET ); /* Turn the LED off */
-                    }
-                }
+                LogWarn( "Received rejected response for update with token %lu and error code %.*s.", ( unsigned long ) ulReceivedToken,
+                         pxFields[ 2 ].xValueLength,
+                         pxFields[ 2 ].pcValue );
             }
+
+            pxShadow->ulResponse = shadowRESPONSE_REJECTED;
         }
     }
 }
 
 /*-----------------------------------------------------------*/
 
-static void prvIncomingPublishUpdateAcceptedCallback( void * pvCtx,
-                                                      MQTTPublishInfo_t * pxPublishInfo )
+/**
+ * @brief Shared callback of every update response subscription. Routes the
+ * publish to its shadow and wakes the shadow task on a response.
+ */
+static void prvIncomingPublishCallback( void * pvCtx,
+                                        MQTTPublishInfo_t * pxPublishInfo )
 {
-    char * pcOutValue = NULL;
-    uint32_t ulOutValueLength = 0UL;
-    uint32_t ulReceivedToken = 0UL;
-    JSONStatus_t result = JSONSuccess;
+    ShadowTopicType_t xType = SHADOW_TOPIC_UNKNOWN;
+    ShadowInstance_t * pxShadow = NULL;
+    const char * pcName = NULL;
+    size_t xNameLen = 0;
 
-    ShadowDeviceCtx_t * pxCtx = ( ShadowDeviceCtx_t * ) pvCtx;
+    ( void ) pvCtx;
 
-    configASSERT( pvCtx != NULL );
     configASSERT( pxPublishInfo != NULL );
     configASSERT( pxPublishInfo->pPayload != NULL );
 
-    LogDebug( "/update/accepted JSON payload: %.*s.",
+    LogDebug( "%.*s payload: %.*s.",
+              pxPublishInfo->topicNameLength,
+              pxPublishInfo->pTopicName,
               pxPublishInfo->payloadLength,
               ( const char * ) pxPublishInfo->pPayload );
 
-    /* Handle the reported state with state change in /update/accepted topic.
-     * Thus we will retrieve the client token from the JSON document to see if
-     * it's the same one we sent with reported state on the /update topic.
-     * The payload will look similar to this:
-     *  {
-     *      "state": {
-     *          "reported": {
-     *             "powerOn": 1
-     *          }
-     *      },
-     *      "metadata": {
-     *          "reported": {
-     *              "powerOn": {
-     *                  "timestamp": 1596573647
-     *              }
-     *          }
-     *      },
-     *      "version": 14698,
-     *      "timestamp": 1596573647,
-     *      "clientToken": "022485"
-     *  }
-     */
+    xType = xShadowTopicParse( pxPublishInfo->pTopicName,
+                               pxPublishInfo->topicNameLength,
+                               pcThingName,
+                               xThingNameLen,
+                               &pcName,
+                               &xNameLen );
 
-    /* Make sure the payload is a valid json document. */
-    result = JSON_Validate( pxPublishInfo->pPayload,
-                            pxPublishInfo->payloadLength );
+    for( uint32_t i = 0; ( xType != SHADOW_TOPIC_UNKNOWN ) && ( i < ulNumReady ) && ( pxShadow == NULL ); i++ )
+    {
+        if( ( pxShadows[ i ]->usNameLen == xNameLen ) &&
+            ( ( pcName == NULL ) || ( memcmp( pxShadows[ i ]->pcName, pcName, xNameLen ) == 0 ) ) )
+        {
+            pxShadow = pxShadows[ i ];
+        }
+    }
 
-    if( result != JSONSuccess )
+    if( pxShadow == NULL )
     {
-        LogError( "Invalid JSON document received!" );
+        LogDebug( "Ignoring publish to %.*s.", pxPublishInfo->topicNameLength, pxPublishInfo->pTopicName );
+    }
+    else if( xType == SHADOW_TOPIC_DELTA )
+    {
+        if( pxShadow->xNumDeltaFields > 0 )
+        {
+            prvHandleDelta( pxShadow, pxPublishInfo );
+        }
     }
     else
     {
-        /* Get clientToken from json documents. */
-        result = JSON_Search( ( char * ) pxPublishInfo->pPayload,
-                              pxPublishInfo->payloadLength,
-                              "clientToken",
-                              sizeof( "clientToken" ) - 1,
-                              &pcOutValue,
-                              ( size_t * ) &ulOutValueLength );
+        prvHandleResponse( pxShadow, pxPublishInfo, ( xType == SHADOW_TOPIC_ACCEPTED ) );
+
+        if( pxShadow->ulResponse != shadowRESPONSE_NONE )
+        {
+            /* Wake up the shadow task which is waiting for this response. */
+            ( void ) xTaskNotifyGive( xShadowTaskHandle );
+        }
     }
+}
 
-    if( result != JSONSuccess )
+/*-----------------------------------------------------------*/
+
+static bool prvLoadThingName( void )
+{
+    /* Note: KVStore_getSize always returns the buffer length needed */
+    if( KVStore_getSize( CS_CORE_THING_NAME ) <= UINT8_MAX )
     {
-        LogDebug( "Ignoring publish on /update/accepted with no clientToken field." );
+        pcThingName = KVStore_getStringHeap( CS_CORE_THING_NAME, NULL );
+
+        if( pcThingName != NULL )
+        {
+            xThingNameLen = strnlen( pcThingName, KVStore_getSize( CS_CORE_THING_NAME ) );
+        }
     }
-    else
+
+    return( ( pcThingName != NULL ) && ( xThingNameLen > 0 ) && ( xThingNameLen < UINT8_MAX ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static char * prvBuildTopic( const char * pcName,
+                             const char * pcSuffix,
+                             uint16_t * pusLen )
+{
+    /* "$aws/things/" + thing + "/shadow/" [ + "name/" + name + "/" ] + suffix + NUL */
+    size_t xMaxLen = 12 + xThingNameLen + 8 + strlen( pcSuffix ) + 1;
+    char * pcTopic = NULL;
+    size_t xLen = 0;
+
+    if( pcName != NULL )
     {
-        /* Convert the code to an unsigned integer value. */
-        ulReceivedToken = ( uint32_t ) strtoul( pcOutValue, NULL, 10 );
+        xMaxLen += 5 + strlen( pcName ) + 1;
+    }
 
-        /* If we are waiting for a response, ulClientToken will be the token for the response
-         * we are waiting for, else it will be 0. ulReceivedToken may not match if the response is
-         * not for us or if it is is a response that arrived after we timed out
-         * waiting for it.
-         */
-        if( ulReceivedToken != pxCtx->ulClientToken )
+    pcTopic = pvPortMalloc( xMaxLen );
+
+    if( pcTopic != NULL )
+    {
+        xLen = xShadowTopicBuild( pcTopic, xMaxLen, pcThingName, xThingNameLen, pcName, pcSuffix );
+
+        if( xLen == 0 )
         {
-            LogDebug( "Ignoring publish on /update/accepted with clientToken %lu.", ( unsigned long ) ulReceivedToken );
+            vPortFree( pcTopic );
+            pcTopic = NULL;
         }
-        else
+    }
+
+    if( pusLen != NULL )
+    {
+        *pusLen = ( uint16_t ) xLen;
+    }
+
+    return pcTopic;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvSubscribeFilters( ShadowFilter_t xFirst )
+{
+    static const char * const pcSuffixes[ 3 ] =
+    {
+        SHADOW_TOPIC_SUFFIX_DELTA,
+        SHADOW_TOPIC_SUFFIX_ACCEPTED,
+        SHADOW_TOPIC_SUFFIX_REJECTED,
+    };
+    bool xSuccess = true;
+
+    for( uint32_t i = 0; ( i < 3 ) && xSuccess; i++ )
+    {
+        ShadowFilter_t xFilter = ( ShadowFilter_t ) ( xFirst + i );
+
+        if( pcFilters[ xFilter ] == NULL )
         {
-            LogInfo( "Received accepted response for update with token %lu. ", ( unsigned long ) pxCtx->ulClientToken );
+            pcFilters[ xFilter ] = prvBuildTopic( ( xFirst == shadowFILTER_NAMED_DELTA ) ? "+" : NULL,
+                                                  pcSuffixes[ i ],
+                                                  NULL );
+        }
 
-            /*  Obtain the accepted state from the response and update our last sent state. */
-            result = JSON_Search( ( char * ) pxPublishInfo->pPayload,
-                                  pxPublishInfo->payloadLength,
-                                  "state.reported.powerOn",
-                                  sizeof( "state.reported.powerOn" ) - 1,
-                                  &pcOutValue,
-                                  ( size_t * ) &ulOutValueLength );
+        if( pcFilters[ xFilter ] == NULL )
+        {
+            LogError( "Failed to allocate a shadow topic filter." );
+            xSuccess = false;
+        }
+        else if( !pxSubscribed[ xFilter ] )
+        {
+            MQTTStatus_t xStatus = MqttAgent_SubscribeSync( xAgentHandle,
+                                                            pcFilters[ xFilter ],
+                                                            MQTTQoS1,
+                                                            prvIncomingPublishCallback,
+                                                            NULL );
 
-            if( result != JSONSuccess )
+            if( xStatus != MQTTSuccess )
             {
-                LogError( "powerOn field not found in JSON document!" );
+                LogError( "Failed to subscribe to topic: %s", pcFilters[ xFilter ] );
+                xSuccess = false;
             }
             else
             {
-                /* Convert the powerOn state value to an unsigned integer value and
-                 * save the new last reported value*/
-                pxCtx->ulReportedPowerOnState = ( uint32_t ) strtoul( pcOutValue, NULL, 10 );
+                pxSubscribed[ xFilter ] = true;
             }
+        }
+    }
 
-            /* Wake up the shadow task which is waiting for this response. */
-            xTaskNotifyGive( pxCtx->xShadowDeviceTaskHandle );
+    return xSuccess;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Build the topics and subscriptions of newly registered shadows */
+static bool prvServiceNewShadows( void )
+{
+    bool xSuccess = true;
+
+    while( xSuccess && ( ulNumReady < ulNumShadows ) )
+    {
+        ShadowInstance_t * pxShadow = pxShadows[ ulNumReady ];
+
+        if( pxShadow->pcTopicUpdate == NULL )
+        {
+            pxShadow->pcTopicUpdate = prvBuildTopic( pxShadow->pcName,
+                                                     SHADOW_TOPIC_SUFFIX_UPDATE,
+                                                     &( pxShadow->usTopicUpdateLen ) );
+        }
+
+        if( pxShadow->pcTopicUpdate == NULL )
+        {
+            LogError( "Failed to allocate the update topic of shadow %s.", ( pxShadow->pcName != NULL ) ? pxShadow->pcName : "(classic)" );
+            xSuccess = false;
+        }
+        else
+        {
+            xSuccess = prvSubscribeFilters( ( pxShadow->pcName != NULL ) ? shadowFILTER_NAMED_DELTA : shadowFILTER_DELTA );
+        }
+
+        if( xSuccess )
+        {
+            LogInfo( "Serving shadow %s.", ( pxShadow->pcName != NULL ) ? pxShadow->pcName : "(classic)" );
+            ulNumReady++;
         }
     }
+
+    return xSuccess;
 }
 
 /*-----------------------------------------------------------*/
 
-static void prvIncomingPublishUpdateRejectedCallback( void * pvCtx,
-                                                      MQTTPublishInfo_t * pxPublishInfo )
+static void prvPublishCommandCallback( MQTTAgentCommandContext_t * pxCommandContext,
+                                       MQTTAgentReturnInfo_t * pxReturnInfo )
 {
-    JSONStatus_t result = JSONSuccess;
-    char * pcOutValue = NULL;
-    uint32_t ulOutValueLength = 0UL;
-    uint32_t ulReceivedToken = 0UL;
+    configASSERT( pxCommandContext != NULL );
+    configASSERT( pxReturnInfo != NULL );
 
-    ShadowDeviceCtx_t * pxCtx = ( ShadowDeviceCtx_t * ) pvCtx;
+    pxCommandContext->xReturnStatus = pxReturnInfo->returnCode;
 
-    configASSERT( pvCtx != NULL );
-    configASSERT( pxPublishInfo != NULL );
-    configASSERT( pxPublishInfo->pPayload != NULL );
+    if( pxCommandContext->xTaskToNotify != NULL )
+    {
+        ( void ) xTaskNotifyGiveIndexed( pxCommandContext->xTaskToNotify,
+                                         shadowPUBLISH_NOTIFY_IDX );
+    }
+}
 
-    LogDebug( "/update/rejected json payload: %.*s.",
-              pxPublishInfo->payloadLength,
-              ( const char * ) pxPublishInfo->pPayload );
+/*-----------------------------------------------------------*/
 
-    /* The payload will look similar to this:
-     * {
-     *    "code": error-code,
-     *    "message": "error-message",
-     *    "timestamp": timestamp,
-     *    "clientToken": "token"
-     * }
-     */
+static bool prvPublishReport( ShadowInstance_t * pxShadow,
+                              const char * pcDocument,
+                              size_t xDocumentLen )
+{
+    bool xSuccess = false;
+    MQTTStatus_t xStatus;
+    TickType_t xStartTicks;
 
-    /* Make sure the payload is a valid json document. */
-    result = JSON_Validate( pxPublishInfo->pPayload,
-                            pxPublishInfo->payloadLength );
+    MQTTPublishInfo_t xPublishInfo =
+    {
+        .qos             = MQTTQoS1,
+        .retain          = 0,
+        .dup             = 0,
+        .pTopicName      = pxShadow->pcTopicUpdate,
+        .topicNameLength = pxShadow->usTopicUpdateLen,
+        .pPayload        = pcDocument,
+        .payloadLength   = xDocumentLen
+    };
+
+    MQTTAgentCommandContext_t xCommandContext =
+    {
+        .xTaskToNotify = xTaskGetCurrentTaskHandle(),
+        .xReturnStatus = MQTTIllegalState,
+    };
 
-    if( result != JSONSuccess )
+    MQTTAgentCommandInfo_t xCommandParams =
     {
-        LogError( "Invalid JSON document received!" );
+        .blockTimeMs                 = shadowexampleMAX_COMMAND_SEND_BLOCK_TIME_MS,
+        .cmdCompleteCallback         = prvPublishCommandCallback,
+        .pCmdCompleteCallbackContext = &xCommandContext,
+    };
+
+    LogInfo( "Publishing to %s with client token %lu.", pxShadow->pcTopicUpdate, ( unsigned long ) pxShadow->ulClientToken );
+    LogDebug( "Publish content: %.*s", xDocumentLen, pcDocument );
+
+    /* Clear the notification index */
+    ( void ) xTaskNotifyStateClearIndexed( NULL, shadowPUBLISH_NOTIFY_IDX );
+
+    xStartTicks = xTaskGetTickCount();
+
+    xStatus = MQTTAgent_Publish( xAgentHandle,
+                                 &xPublishInfo,
+                                 &xCommandParams );
+
+    if( xStatus != MQTTSuccess )
+    {
+        LogError( "Failed to publish report to shadow." );
     }
-    else
+    else if( ulTaskNotifyTakeIndexed( shadowPUBLISH_NOTIFY_IDX,
+                                      pdTRUE,
+                                      pdMS_TO_TICKS( shadowPUBLISH_NOTIFICATION_WAIT_MS ) ) == 0 )
     {
-        /* Get clientToken from json documents. */
-        result = JSON_Search( ( char * ) pxPublishInfo->pPayload,
-                              pxPublishInfo->payloadLength,
-                              "clientToken",
-                              sizeof( "clientToken" ) - 1,
-                              &pcOutValue,
-                              ( size_t * ) &ulOutValueLength );
+        LogError( "Timed out waiting for the PUBACK of a shadow report." );
     }
-
-    if( result != JSONSuccess )
+    else if( xCommandContext.xReturnStatus != MQTTSuccess )
     {
-        LogDebug( "Ignoring publish on /update/rejected with clientToken %lu.", ( unsigned long ) ulReceivedToken );
+        LogError( "MQTT Agent returned error code: %d during publish operation.",
+                  xCommandContext.xReturnStatus );
     }
     else
     {
-        /* Convert the code to an unsigned integer value. */
-        ulReceivedToken = ( uint32_t ) strtoul( pcOutValue, NULL, 10 );
+        vMqttAgentRecordPublishLatency( ( xTaskGetTickCount() - xStartTicks ) * portTICK_PERIOD_MS );
+        xSuccess = true;
+    }
 
-        /* If we are waiting for a response, ulClientToken will be the token for the response
-         * we are waiting for, else it will be 0. ulReceivedToken may not match if the response is
-         * not for us or if it is is a response that arrived after we timed out
-         * waiting for it.
-         */
-        if( ulReceivedToken != pxCtx->ulClientToken )
+    return xSuccess;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvCompleteReport( ShadowInstance_t * pxShadow,
+                               bool xAccepted )
+{
+    /* Late responses are ignored once the token is cleared */
+    pxShadow->ulClientToken = 0;
+    pxShadow->ulResponse = shadowRESPONSE_NONE;
+
+    vTaskSuspendAll();
+    {
+        vShadowReportedComplete( &( pxShadow->xReported ), xAccepted ? 1U : 0U, prvNowMs() );
+    }
+    ( void ) xTaskResumeAll();
+}
+
+/*-----------------------------------------------------------*/
+
+/* Handle the response to the outstanding report of a shadow and send the
+ * next one when due. Returns the time in ms until the shadow needs service. */
+static uint32_t prvServiceShadow( ShadowInstance_t * pxShadow,
+                                  char * pcDocument,
+                                  size_t xDocumentSize )
+{
+    uint32_t ulNowMs = prvNowMs();
+    uint32_t ulWaitMs = SHADOW_REPORTED_IDLE;
+    uint32_t ulClientToken = 0;
+    size_t xDocumentLen = 0;
+
+    if( pxShadow->ulClientToken != 0 )
+    {
+        if( pxShadow->ulResponse != shadowRESPONSE_NONE )
         {
-            LogDebug( "Ignoring publish on /update/rejected with clientToken %lu.", ( unsigned long ) ulReceivedToken );
+            prvCompleteReport( pxShadow, ( pxShadow->ulResponse == shadowRESPONSE_ACCEPTED ) );
+        }
+        else if( ( ulNowMs - pxShadow->ulSentMs ) >= shadow_SIGNAL_TIMEOUT )
+        {
+            LogError( "Timed out waiting for response to report." );
+
+            /* If we time out waiting for a response and then the report is accepted, the
+             * state may be out of sync. The properties are sent again. */
+            prvCompleteReport( pxShadow, false );
         }
         else
         {
-            /*  Obtain the error code. */
-            result = JSON_Search( ( char * ) pxPublishInfo->pPayload,
-                                  pxPublishInfo->payloadLength,
-                                  "code",
-                                  sizeof( "code" ) - 1,
-                                  &pcOutValue,
-                                  ( size_t * ) &ulOutValueLength );
-
-            if( result != JSONSuccess )
-            {
-                LogWarn( "Received rejected response for update with token %lu and no error code.", ( unsigned long ) pxCtx->ulClientToken );
-            }
-            else
+            ulWaitMs = shadow_SIGNAL_TIMEOUT - ( ulNowMs - pxShadow->ulSentMs );
+        }
+    }
+
+    if( pxShadow->ulClientToken == 0 )
+    {
+        /* Create a new client token, unique among the outstanding reports of every shadow. */
+        ulClientToken = ( ulNextClientToken % 1000000 ) + 1;
+
+        vTaskSuspendAll();
+        {
+            ulWaitMs = ulShadowReportedTimeToSendMs( &( pxShadow->xReported ), ulNowMs );
+
+            if( ulWaitMs == 0 )
             {
-                LogWarn( "Received rejected response for update with token %lu and error code %.*s.", ( unsigned long ) pxCtx->ulClientToken,
-                         ulOutValueLength,
-                         pcOutValue );
+                /* Generate a report carrying only the changed properties. */
+                xDocumentLen = xShadowReportedBuild( &( pxShadow->xReported ),
+                                                     pcDocument,
+                                                     xDocumentSize,
+                                                     ulClientToken,
+                                                     ulNowMs );
             }
+        }
+        ( void ) xTaskResumeAll();
+    }
 
-            /* Wake up the shadow task which is waiting for this response. */
-            xTaskNotifyGive( pxCtx->xShadowDeviceTaskHandle );
+    if( xDocumentLen > 0 )
+    {
+        /* Save the token for use in the update accepted and rejected callbacks. */
+        ulNextClientToken = ulClientToken;
+        pxShadow->ulResponse = shadowRESPONSE_NONE;
+        pxShadow->ulSentMs = ulNowMs;
+        pxShadow->ulClientToken = ulClientToken;
+
+        if( prvPublishReport( pxShadow, pcDocument, xDocumentLen ) )
+        {
+            ulWaitMs = shadow_SIGNAL_TIMEOUT;
+        }
+        else
+        {
+            prvCompleteReport( pxShadow, false );
+            ulWaitMs = shadowREPORT_MIN_INTERVAL_MS;
         }
     }
+    else if( ulWaitMs == 0 )
+    {
+        LogError( "Report of shadow %s does not fit in %lu bytes.",
+                  ( pxShadow->pcName != NULL ) ? pxShadow->pcName : "(classic)",
+                  ( unsigned long ) xDocumentSize );
+        ulWaitMs = SHADOW_REPORTED_IDLE;
+    }
+
+    return ulWaitMs;
 }
 
 /*-----------------------------------------------------------*/
@@ -712,40 +923,40 @@ static void prvIncomingPublishUpdateRejectedCallback( void * pvCtx,
 void vShadowDeviceTask( void * pvParameters )
 {
     bool xStatus = true;
-    uint32_t ulNotificationValue;
-    static MQTTPublishInfo_t xPublishInfo = { 0 };
-    MQTTAgentCommandInfo_t xCommandParams = { 0 };
-    MQTTStatus_t xCommandAdded;
-    ShadowDeviceCtx_t xShadowCtx = { 0 };
+    bool xReady = true;
+    uint32_t ulWaitMs;
+    int32_t lPropIndex;
 
-    /* A buffer containing the update document. It has static duration to prevent
-     * it from being placed on the call stack. */
-    static char pcUpdateDocument[ shadowexampleSHADOW_REPORTED_JSON_LENGTH + 1 ] = { 0 };
+    /* The update document is shared by every shadow and has static duration to
+     * prevent it from being placed on the call stack. */
+    static char pcUpdateDocument[ shadowREPORT_DOC_LENGTH ] = { 0 };
 
     /* Remove compiler warnings about unused parameters. */
     ( void ) pvParameters;
 
     /* Record the handle of this task so that the callbacks can send a notification to this task. */
-    xShadowCtx.xShadowDeviceTaskHandle = xTaskGetCurrentTaskHandle();
+    xShadowTaskHandle = xTaskGetCurrentTaskHandle();
+    ulNextClientToken = ( xTaskGetTickCount() % 1000000 );
 
-    /* Wait for MqttAgent to be ready. */
-    xShadowCtx.xAgentHandle = xGetMqttAgentHandle();
+    /* Register the demo device on the classic shadow. */
+    vShadowServiceInitInstance( &xDeviceShadow,
+                                NULL,
+                                pxDeviceProps,
+                                sizeof( pxDeviceProps ) / sizeof( pxDeviceProps[ 0 ] ),
+                                xDeviceDeltaFields,
+                                sizeof( xDeviceDeltaFields ) / sizeof( xDeviceDeltaFields[ 0 ] ),
+                                NULL );
+
+    lPropIndex = lShadowServiceAddProperty( &xDeviceShadow, "powerOn", ( int32_t ) ulCurrentPowerOnState );
+    configASSERT( lPropIndex == shadowPROP_POWER_ON );
+    ( void ) lPropIndex;
 
-    xStatus = prvInitializeCtx( &xShadowCtx );
+    ( void ) xShadowServiceRegister( &xDeviceShadow );
 
-    /* Set up the MQTTAgentCommandInfo_t for the demo loop.
-     * We do not need a completion callback here since for publishes, we expect to get a
-     * response on the appropriate topics for accepted or rejected reports, and for pings
-     * we do not care about the completion. */
-    xCommandParams.blockTimeMs = shadowexampleMAX_COMMAND_SEND_BLOCK_TIME_MS;
-    xCommandParams.cmdCompleteCallback = NULL;
+    /* Wait for MqttAgent to be ready. */
+    xAgentHandle = xGetMqttAgentHandle();
 
-    /* Set up MQTTPublishInfo_t for the update reports. */
-    xPublishInfo.qos = MQTTQoS1;
-    xPublishInfo.pTopicName = xShadowCtx.pcTopicUpdate;
-    xPublishInfo.topicNameLength = xShadowCtx.usTopicUpdateLen;
-    xPublishInfo.pPayload = pcUpdateDocument;
-    xPublishInfo.payloadLength = ( shadowexampleSHADOW_REPORTED_JSON_LENGTH + 1 );
+    xStatus = prvLoadThingName();
 
     /* Wait for first mqtt connection */
     ( void ) xEventGroupWaitBits( xSystemEvents,
@@ -754,73 +965,27 @@ void vShadowDeviceTask( void * pvParameters )
                                   pdTRUE,
                                   portMAX_DELAY );
 
-    if( xStatus == true )
-    {
-        /* Subscribe to Shadow topics. */
-        xStatus = prvSubscribeToShadowUpdateTopics( &xShadowCtx );
-    }
-
     if( xStatus == true )
     {
         for( ; ; )
         {
-            if( xShadowCtx.ulCurrentPowerOnState == xShadowCtx.ulReportedPowerOnState )
-            {
-                LogDebug( "No change in powerOn state since last report. Current state is %u.", xShadowCtx.ulCurrentPowerOnState );
-            }
-            else
-            {
-                LogInfo( "PowerOn state is now %u. Sending new report.", ( unsigned int ) xShadowCtx.ulCurrentPowerOnState );
-
-                /* Create a new client token and save it for use in the update accepted and rejected callbacks. */
-                xShadowCtx.ulClientToken = ( xTaskGetTickCount() % 1000000 );
-
-                /* Generate update report. */
-                ( void ) memset( pcUpdateDocument,
-                                 0x00,
-                                 sizeof( pcUpdateDocument ) );
+            xReady = prvServiceNewShadows();
 
-                snprintf( pcUpdateDocument,
-                          shadowexampleSHADOW_REPORTED_JSON_LENGTH + 1,
-                          shadowexampleSHADOW_REPORTED_JSON,
-                          ( unsigned int ) xShadowCtx.ulCurrentPowerOnState,
-                          ( long unsigned ) xShadowCtx.ulClientToken );
+            ulWaitMs = xReady ? SHADOW_REPORTED_IDLE : shadowSUBSCRIBE_RETRY_MS;
 
-                /* Send update. */
-                LogInfo( "Publishing to /update with following client token %lu.", ( long unsigned ) xShadowCtx.ulClientToken );
-                LogDebug( "Publish content: %.*s", shadowexampleSHADOW_REPORTED_JSON_LENGTH, pcUpdateDocument );
-
-                xCommandAdded = MQTTAgent_Publish( xShadowCtx.xAgentHandle,
-                                                   &xPublishInfo,
-                                                   &xCommandParams );
+            for( uint32_t i = 0; i < ulNumReady; i++ )
+            {
+                uint32_t ulShadowWaitMs = prvServiceShadow( pxShadows[ i ], pcUpdateDocument, sizeof( pcUpdateDocument ) );
 
-                if( xCommandAdded != MQTTSuccess )
+                if( ulShadowWaitMs < ulWaitMs )
                 {
-                    LogError( "Failed to publish report to shadow." );
+                    ulWaitMs = ulShadowWaitMs;
                 }
-                else
-                {
-                    /* Wait for the response to our report. When the Device shadow service receives the request it will
-                     * publish a response to  the /update/accepted or update/rejected */
-                    ulNotificationValue = ulTaskNotifyTake( pdFALSE, pdMS_TO_TICKS( shadow_SIGNAL_TIMEOUT ) );
-
-                    if( ulNotificationValue == 0 )
-                    {
-                        LogError( "Timed out waiting for response to report." );
-
-                        /* If we time out waiting for a response and then the report is accepted, the
-                         * state may be out of sync. Set the reported state as to ensure we resend the
-                         * report. */
-                        xShadowCtx.ulReportedPowerOnState = shadowexampleINVALID_POWERON_STATE;
-                    }
-                }
-
-                /* Clear the client token */
-                xShadowCtx.ulClientToken = 0;
             }
 
-            LogDebug( "Sleeping until next update check." );
-            vTaskDelay( pdMS_TO_TICKS( shadowMS_BETWEEN_REPORTS ) );
+            /* Woken early by property changes, update responses and registrations. */
+            ( void ) ulTaskNotifyTake( pdTRUE,
+                                       ( ulWaitMs == SHADOW_REPORTED_IDLE ) ? portMAX_DELAY : pdMS_TO_TICKS( ulWaitMs ) );
         }
     }
     else
@@ -0,0 +1,279 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "shadow_reported.h"
+
+#define SHADOW_PROP_DIRTY        ( 0x01U )
+#define SHADOW_PROP_IN_FLIGHT    ( 0x02U )
+#define SHADOW_PROP_KNOWN        ( 0x04U ) /* lReported holds the service's value */
+
+/*-----------------------------------------------------------*/
+
+/* Recompute the dirty flag of a property against the value the service holds,
+ * or will hold once the outstanding update is accepted. */
+static void prvUpdateDirty( ShadowReported_t * pxReported,
+                            ShadowProperty_t * pxProp,
+                            uint32_t ulNowMs )
+{
+    uint8_t ucDirty = 0;
+
+    if( ( pxProp->ucFlags & SHADOW_PROP_IN_FLIGHT ) != 0 )
+    {
+        ucDirty = ( pxProp->lValue != pxProp->lInFlight );
+    }
+    else if( ( pxProp->ucFlags & SHADOW_PROP_KNOWN ) != 0 )
+    {
+        ucDirty = ( pxProp->lValue != pxProp->lReported );
+    }
+    else
+    {
+        ucDirty = 1;
+    }
+
+    if( ucDirty && ( ( pxProp->ucFlags & SHADOW_PROP_DIRTY ) == 0 ) )
+    {
+        if( pxReported->ulNumDirty == 0 )
+        {
+            pxReported->ulFirstDirtyMs = ulNowMs;
+        }
+
+        pxReported->ulNumDirty++;
+        pxProp->ucFlags |= SHADOW_PROP_DIRTY;
+    }
+    else if( !ucDirty && ( ( pxProp->ucFlags & SHADOW_PROP_DIRTY ) != 0 ) )
+    {
+        pxReported->ulNumDirty--;
+        pxProp->ucFlags &= ~SHADOW_PROP_DIRTY;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void vShadowReportedInit( ShadowReported_t * pxReported,
+                          ShadowProperty_t * pxProps,
+                          uint32_t ulMaxProps,
+                          uint32_t ulDebounceMs,
+                          uint32_t ulMaxDelayMs,
+                          uint32_t ulMinIntervalMs )
+{
+    ( void ) memset( pxReported, 0, sizeof( ShadowReported_t ) );
+
+    pxReported->pxProps = pxProps;
+    pxReported->ulMaxProps = ( pxProps != NULL ) ? ulMaxProps : 0;
+
+    pxReported->ulDebounceMs = ulDebounceMs;
+    pxReported->ulMaxDelayMs = ulMaxDelayMs;
+    pxReported->ulMinIntervalMs = ulMinIntervalMs;
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t lShadowReportedAdd( ShadowReported_t * pxReported,
+                            const char * pcName,
+                            int32_t lValue,
+                            uint32_t ulNowMs )
+{
+    int32_t lIndex = -1;
+
+    if( ( pcName != NULL ) && ( pxReported->ulNumProps < pxReported->ulMaxProps ) )
+    {
+        ShadowProperty_t * pxProp = &( pxReported->pxProps[ pxReported->ulNumProps ] );
+
+        pxProp->pcName = pcName;
+        pxProp->lValue = lValue;
+        pxProp->ucFlags = 0;
+
+        lIndex = ( int32_t ) pxReported->ulNumProps;
+        pxReported->ulNumProps++;
+        pxReported->ulLastChangeMs = ulNowMs;
+
+        prvUpdateDirty( pxReported, pxProp, ulNowMs );
+    }
+
+    return lIndex;
+}
+
+/*-----------------------------------------------------------*/
+
+void vShadowReportedSet( ShadowReported_t * pxReported,
+                         int32_t lIndex,
+                         int32_t lValue,
+                         uint32_t ulNowMs )
+{
+    if( ( lIndex >= 0 ) && ( ( uint32_t ) lIndex < pxReported->ulNumProps ) )
+    {
+        ShadowProperty_t * pxProp = &( pxReported->pxProps[ lIndex ] );
+
+        if( pxProp->lValue != lValue )
+        {
+            pxProp->lValue = lValue;
+            pxReported->ulChanges++;
+            pxReported->ulLastChangeMs = ulNowMs;
+
+            prvUpdateDirty( pxReported, pxProp, ulNowMs );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t ulShadowReportedTimeToSendMs( const ShadowReported_t * pxReported,
+                                       uint32_t ulNowMs )
+{
+    uint32_t ulWaitMs = SHADOW_REPORTED_IDLE;
+
+    if( ( pxReported->ulNumDirty > 0 ) && ( pxReported->ucInFlight == 0 ) )
+    {
+        uint32_t ulQuietMs = ulNowMs - pxReported->ulLastChangeMs;
+        uint32_t ulAgeMs = ulNowMs - pxReported->ulFirstDirtyMs;
+        uint32_t ulMaxWaitMs = 0;
+
+        /* Due once the properties have settled, or once the oldest change has waited long enough */
+        ulWaitMs = ( ulQuietMs >= pxReported->ulDebounceMs ) ? 0 : pxReported->ulDebounceMs - ulQuietMs;
+        ulMaxWaitMs = ( ulAgeMs >= pxReported->ulMaxDelayMs ) ? 0 : pxReported->ulMaxDelayMs - ulAgeMs;
+
+        if( ulMaxWaitMs < ulWaitMs )
+        {
+            ulWaitMs = ulMaxWaitMs;
+        }
+
+        /* Rate limit */
+        if( pxReported->ucHasSent != 0 )
+        {
+            uint32_t ulSinceMs = ulNowMs - pxReported->ulLastSendMs;
+
+            if( ( ulSinceMs < pxReported->ulMinIntervalMs ) &&
+                ( ulWaitMs < pxReported->ulMinIntervalMs - ulSinceMs ) )
+            {
+                ulWaitMs = pxReported->ulMinIntervalMs - ulSinceMs;
+            }
+        }
+    }
+
+    return ulWaitMs;
+}
+
+/*-----------------------------------------------------------*/
+
+size_t xShadowReportedBuild( ShadowReported_t * pxReported,
+                             char * pcBuffer,
+                             size_t xBufferLen,
+                             uint32_t ulClientToken,
+                             uint32_t ulNowMs )
+{
+    size_t xLen = 0;
+    int lWritten = 0;
+    uint32_t i = 0;
+
+    if( ( pxReported->ulNumDirty > 0 ) && ( pxReported->ucInFlight == 0 ) && ( pcBuffer != NULL ) )
+    {
+        lWritten = snprintf( pcBuffer, xBufferLen, "{\"state\":{\"reported\":{" );
+        xLen = ( lWritten > 0 ) ? ( size_t ) lWritten : xBufferLen;
+
+        for( i = 0; ( i < pxReported->ulNumProps ) && ( xLen < xBufferLen ); i++ )
+        {
+            const ShadowProperty_t * pxProp = &( pxReported->pxProps[ i ] );
+
+            if( ( pxProp->ucFlags & SHADOW_PROP_DIRTY ) != 0 )
+            {
+                lWritten = snprintf( &( pcBuffer[ xLen ] ), xBufferLen - xLen, "%s\"%s\":%ld",
+                                     ( pcBuffer[ xLen - 1 ] == '{' ) ? "" : ",",
+                                     pxProp->pcName, ( long ) pxProp->lValue );
+                xLen += ( lWritten > 0 ) ? ( size_t ) lWritten : xBufferLen;
+            }
+        }
+
+        if( xLen < xBufferLen )
+        {
+            lWritten = snprintf( &( pcBuffer[ xLen ] ), xBufferLen - xLen,
+                                 "}},\"clientToken\":\"%06lu\"}", ( unsigned long ) ulClientToken );
+            xLen += ( lWritten > 0 ) ? ( size_t ) lWritten : xBufferLen;
+        }
+
+        if( xLen >= xBufferLen )
+        {
+            /* Truncated, leave the properties dirty */
+            xLen = 0;
+        }
+        else
+        {
+            for( i = 0; i < pxReported->ulNumProps; i++ )
+            {
+                ShadowProperty_t * pxProp = &( pxReported->pxProps[ i ] );
+
+                if( ( pxProp->ucFlags & SHADOW_PROP_DIRTY ) != 0 )
+                {
+                    pxProp->lInFlight = pxProp->lValue;
+                    pxProp->ucFlags = ( pxProp->ucFlags & ~SHADOW_PROP_DIRTY ) | SHADOW_PROP_IN_FLIGHT;
+                }
+            }
+
+            pxReported->ulNumDirty = 0;
+            pxReported->ucInFlight = 1;
+            pxReported->ucHasSent = 1;
+            pxReported->ulLastSendMs = ulNowMs;
+            pxReported->ulUpdates++;
+            pxReported->ulBytes += ( uint32_t ) xLen;
+        }
+    }
+
+    return xLen;
+}
+
+/*-----------------------------------------------------------*/
+
+void vShadowReportedComplete( ShadowReported_t * pxReported,
+                              uint8_t ucAccepted,
+                              uint32_t ulNowMs )
+{
+    uint32_t i = 0;
+
+    for( i = 0; i < pxReported->ulNumProps; i++ )
+    {
+        ShadowProperty_t * pxProp = &( pxReported->pxProps[ i ] );
+
+        if( ( pxProp->ucFlags & SHADOW_PROP_IN_FLIGHT ) != 0 )
+        {
+            if( ucAccepted != 0 )
+            {
+                pxProp->lReported = pxProp->lInFlight;
+                pxProp->ucFlags |= SHADOW_PROP_KNOWN;
+            }
+            else
+            {
+                /* The service may or may not hold the value after a timeout */
+                pxProp->ucFlags &= ~SHADOW_PROP_KNOWN;
+                pxReported->ulRetries++;
+            }
+
+            pxProp->ucFlags &= ~SHADOW_PROP_IN_FLIGHT;
+            prvUpdateDirty( pxReported, pxProp, ulNowMs );
+        }
+    }
+
+    pxReported->ucInFlight = 0;
+}
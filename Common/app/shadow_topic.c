@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "shadow_topic.h"
+
+#define SHADOW_TOPIC_PREFIX    "$aws/things/"
+#define SHADOW_TOPIC_SHADOW    "/shadow/"
+#define SHADOW_TOPIC_NAME      "name/"
+
+#define STRLEN( x )    ( sizeof( x ) - 1 )
+
+/*-----------------------------------------------------------*/
+
+/* Consume pcLiteral from the front of the remaining topic */
+static int prvConsume( const char ** ppcTopic,
+                       size_t * pxLen,
+                       const char * pcLiteral,
+                       size_t xLiteralLen )
+{
+    int lMatch = 0;
+
+    if( ( *pxLen >= xLiteralLen ) && ( memcmp( *ppcTopic, pcLiteral, xLiteralLen ) == 0 ) )
+    {
+        *ppcTopic += xLiteralLen;
+        *pxLen -= xLiteralLen;
+        lMatch = 1;
+    }
+
+    return lMatch;
+}
+
+/*-----------------------------------------------------------*/
+
+size_t xShadowTopicBuild( char * pcBuffer,
+                          size_t xBufferLen,
+                          const char * pcThing,
+                          size_t xThingLen,
+                          const char * pcName,
+                          const char * pcSuffix )
+{
+    int lLen = 0;
+
+    if( ( pcBuffer != NULL ) && ( pcThing != NULL ) && ( pcSuffix != NULL ) && ( xThingLen <= UINT16_MAX ) )
+    {
+        if( pcName == NULL )
+        {
+            lLen = snprintf( pcBuffer, xBufferLen, SHADOW_TOPIC_PREFIX "%.*s" SHADOW_TOPIC_SHADOW "%s",
+                             ( int ) xThingLen, pcThing, pcSuffix );
+        }
+        else
+        {
+            lLen = snprintf( pcBuffer, xBufferLen, SHADOW_TOPIC_PREFIX "%.*s" SHADOW_TOPIC_SHADOW SHADOW_TOPIC_NAME "%s/%s",
+                             ( int ) xThingLen, pcThing, pcName, pcSuffix );
+        }
+    }
+
+    if( ( lLen < 0 ) || ( ( size_t ) lLen >= xBufferLen ) )
+    {
+        lLen = 0;
+    }
+
+    return ( size_t ) lLen;
+}
+
+/*-----------------------------------------------------------*/
+
+ShadowTopicType_t xShadowTopicParse( const char * pcTopic,
+                                     size_t xTopicLen,
+                                     const char * pcThing,
+                                     size_t xThingLen,
+                                     const char ** ppcName,
+                                     size_t * pxNameLen )
+{
+    ShadowTopicType_t xType = SHADOW_TOPIC_UNKNOWN;
+    const char * pcName = NULL;
+    size_t xNameLen = 0;
+
+    if( ( pcTopic != NULL ) &&
+        prvConsume( &pcTopic, &xTopicLen, SHADOW_TOPIC_PREFIX, STRLEN( SHADOW_TOPIC_PREFIX ) ) &&
+        prvConsume( &pcTopic, &xTopicLen, pcThing, xThingLen ) &&
+        prvConsume( &pcTopic, &xTopicLen, SHADOW_TOPIC_SHADOW, STRLEN( SHADOW_TOPIC_SHADOW ) ) )
+    {
+        if( prvConsume( &pcTopic, &xTopicLen, SHADOW_TOPIC_NAME, STRLEN( SHADOW_TOPIC_NAME ) ) )
+        {
+            const char * pcSlash = memchr( pcTopic, '/', xTopicLen );
+
+            if( ( pcSlash != NULL ) && ( pcSlash != pcTopic ) &&
+                ( ( size_t ) ( pcSlash - pcTopic ) <= SHADOW_TOPIC_NAME_MAX_LENGTH ) )
+            {
+                pcName = pcTopic;
+                xNameLen = ( size_t ) ( pcSlash - pcTopic );
+                xTopicLen -= xNameLen + 1;
+                pcTopic = pcSlash + 1;
+            }
+            else
+            {
+                /* Leave nothing to match below */
+                xTopicLen = 0;
+            }
+        }
+
+        if( ( xTopicLen == STRLEN( SHADOW_TOPIC_SUFFIX_DELTA ) ) &&
+            ( memcmp( pcTopic, SHADOW_TOPIC_SUFFIX_DELTA, xTopicLen ) == 0 ) )
+        {
+            xType = SHADOW_TOPIC_DELTA;
+        }
+        else if( ( xTopicLen == STRLEN( SHADOW_TOPIC_SUFFIX_ACCEPTED ) ) &&
+                 ( memcmp( pcTopic, SHADOW_TOPIC_SUFFIX_ACCEPTED, xTopicLen ) == 0 ) )
+        {
+            xType = SHADOW_TOPIC_ACCEPTED;
+        }
+        else if( ( xTopicLen == STRLEN( SHADOW_TOPIC_SUFFIX_REJECTED ) ) &&
+                 ( memcmp( pcTopic, SHADOW_TOPIC_SUFFIX_REJECTED, xTopicLen ) == 0 ) )
+        {
+            xType = SHADOW_TOPIC_REJECTED;
+        }
+    }
+
+    if( xType != SHADOW_TOPIC_UNKNOWN )
+    {
+        if( ppcName != NULL )
+        {
+            *ppcName = pcName;
+        }
+
+        if( pxNameLen != NULL )
+        {
+            *pxNameLen = xNameLen;
+        }
+    }
+
+    return xType;
+}
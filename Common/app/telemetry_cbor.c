@@ -0,0 +1,266 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+#include <string.h>
+
+#include "telemetry_cbor.h"
+
+/*-----------------------------------------------------------*/
+
+uint16_t usTelemetryFloatToHalf( float fValue )
+{
+    uint32_t ulBits;
+    uint32_t ulAbs;
+    uint32_t ulHalf;
+    uint16_t usSign;
+
+    ( void ) memcpy( &ulBits, &fValue, sizeof( ulBits ) );
+
+    usSign = ( uint16_t ) ( ( ulBits >> 16 ) & 0x8000 );
+    ulAbs = ulBits & 0x7FFFFFFF;
+
+    if( ulAbs >= 0x7F800000 )
+    {
+        /* Infinity stays infinity, NaN becomes a quiet NaN */
+        ulHalf = ( ulAbs > 0x7F800000 ) ? 0x7E00 : 0x7C00;
+    }
+    else if( ulAbs >= 0x477FF000 )
+    {
+        /* Rounds to a magnitude of at least 65520, which overflows */
+        ulHalf = 0x7C00;
+    }
+    else if( ulAbs >= 0x38800000 )
+    {
+        /* Normal: rebias the exponent and round the mantissa to nearest even */
+        ulHalf = ( ( ulAbs - 0x38000000 ) >> 13 );
+        ulHalf += ( ( ( ulAbs & 0x1FFF ) > 0x1000 ) ||
+                  ( ( ( ulAbs & 0x1FFF ) == 0x1000 ) && ( ( ulHalf & 1 ) != 0 ) ) ) ? 1 : 0;
+    }
+    else if( ulAbs >= 0x33000000 )
+    {
+        /* Subnormal: shift the full mantissa into units of 2^-24 */
+        uint32_t ulMantissa = ( ulAbs & 0x007FFFFF ) | 0x00800000;
+        uint32_t ulShift = 126 - ( ulAbs >> 23 );
+        uint32_t ulRem = ulMantissa & ( ( 1UL << ulShift ) - 1 );
+        uint32_t ulHalfway = 1UL << ( ulShift - 1 );
+
+        ulHalf = ulMantissa >> ulShift;
+        ulHalf += ( ( ulRem > ulHalfway ) ||
+                  ( ( ulRem == ulHalfway ) && ( ( ulHalf & 1 ) != 0 ) ) ) ? 1 : 0;
+    }
+    else
+    {
+        ulHalf = 0;
+    }
+
+    return ( uint16_t ) ( usSign | ulHalf );
+}
+
+/*-----------------------------------------------------------*/
+
+size_t xTelemetryEncodeSchema( const TelemetrySchema_t * pxSchema,
+                               uint8_t * pucBuf,
+                               size_t xBufLen )
+{
+    CborEncoder xRoot;
+    CborEncoder xMap;
+    CborEncoder xFields;
+    CborError xError;
+
+    cbor_encoder_init( &xRoot, pucBuf, xBufLen, 0 );
+
+    xError = cbor_encoder_create_map( &xRoot, &xMap, ( pxSchema->ulNumGroups > 0 ) ? 4 : 3 );
+    xError |= cbor_encode_text_stringz( &xMap, "id" );
+    xError |= cbor_encode_uint( &xMap, pxSchema->usId );
+    xError |= cbor_encode_text_stringz( &xMap, "rpt" );
+    xError |= cbor_encode_uint( &xMap, pxSchema->usRepeatFrom );
+    xError |= cbor_encode_text_stringz( &xMap, "f" );
+    xError |= cbor_encoder_create_array( &xMap, &xFields, pxSchema->ulNumFields );
+
+    for( uint32_t i = 0; ( xError == CborNoError ) && ( i < pxSchema->ulNumFields ); i++ )
+    {
+        const TelemetryField_t * pxField = &( pxSchema->pxFields[ i ] );
+        CborEncoder xField;
+
+        xError = cbor_encoder_create_array( &xFields, &xField, 3 );
+        xError |= cbor_encode_text_stringz( &xField, pxField->pcName );
+        xError |= cbor_encode_uint( &xField, pxField->xType );
+        xError |= cbor_encode_int( &xField, pxField->cExponent );
+        xError |= cbor_encoder_close_container( &xFields, &xField );
+    }
+
+    xError |= cbor_encoder_close_container( &xMap, &xFields );
+
+    if( pxSchema->ulNumGroups > 0 )
+    {
+        CborEncoder xGroups;
+
+        xError |= cbor_encode_text_stringz( &xMap, "g" );
+        xError |= cbor_encoder_create_array( &xMap, &xGroups, pxSchema->ulNumGroups );
+
+        for( uint32_t i = 0; i < pxSchema->ulNumGroups; i++ )
+        {
+            xError |= cbor_encode_text_stringz( &xGroups, pxSchema->ppcGroups[ i ] );
+        }
+
+        xError |= cbor_encoder_close_container( &xMap, &xGroups );
+    }
+
+    xError |= cbor_encoder_close_container( &xRoot, &xMap );
+
+    return ( xError == CborNoError ) ? cbor_encoder_get_buffer_size( &xRoot, pucBuf ) : 0;
+}
+
+/*-----------------------------------------------------------*/
+
+void vTelemetryBegin( TelemetryEncoder_t * pxEncoder,
+                      const TelemetrySchema_t * pxSchema,
+                      uint8_t * pucBuf,
+                      size_t xBufLen )
+{
+    pxEncoder->pucBuf = pucBuf;
+    pxEncoder->pxSchema = pxSchema;
+    pxEncoder->ulField = 0;
+
+    cbor_encoder_init( &( pxEncoder->xRoot ), pucBuf, xBufLen, 0 );
+
+    pxEncoder->xError = cbor_encoder_create_array( &( pxEncoder->xRoot ),
+                                                   &( pxEncoder->xRecord ),
+                                                   CborIndefiniteLength );
+    pxEncoder->xError |= cbor_encode_uint( &( pxEncoder->xRecord ), pxSchema->usId );
+}
+
+/* Returns NULL once a record holds more values than its schema allows */
+static const TelemetryField_t * prvNextField( TelemetryEncoder_t * pxEncoder )
+{
+    const TelemetrySchema_t * pxSchema = pxEncoder->pxSchema;
+    const TelemetryField_t * pxField = NULL;
+
+    if( pxEncoder->ulField < pxSchema->ulNumFields )
+    {
+        pxField = &( pxSchema->pxFields[ pxEncoder->ulField ] );
+        pxEncoder->ulField++;
+
+        if( pxEncoder->ulField == pxSchema->ulNumFields )
+        {
+            pxEncoder->ulField = pxSchema->usRepeatFrom;
+        }
+    }
+    else
+    {
+        pxEncoder->xError |= CborErrorTooManyItems;
+    }
+
+    return pxField;
+}
+
+void vTelemetryAddFloat( TelemetryEncoder_t * pxEncoder,
+                         float fValue )
+{
+    const TelemetryField_t * pxField = prvNextField( pxEncoder );
+
+    if( pxField == NULL )
+    {
+        /* Error already recorded */
+    }
+    else if( pxField->xType == TELEMETRY_FIELD_HALF )
+    {
+        uint16_t usHalf = usTelemetryFloatToHalf( fValue );
+
+        pxEncoder->xError |= cbor_encode_half_float( &( pxEncoder->xRecord ), &usHalf );
+    }
+    else
+    {
+        pxEncoder->xError |= cbor_encode_int( &( pxEncoder->xRecord ),
+                                              llTelemetryQuantize( fValue, pxField->cExponent ) );
+    }
+}
+
+void vTelemetryAddInt( TelemetryEncoder_t * pxEncoder,
+                       int64_t llValue )
+{
+    if( prvNextField( pxEncoder ) != NULL )
+    {
+        pxEncoder->xError |= cbor_encode_int( &( pxEncoder->xRecord ), llValue );
+    }
+}
+
+size_t xTelemetryEnd( TelemetryEncoder_t * pxEncoder )
+{
+    pxEncoder->xError |= cbor_encoder_close_container( &( pxEncoder->xRoot ),
+                                                       &( pxEncoder->xRecord ) );
+
+    return ( pxEncoder->xError == CborNoError ) ?
+           cbor_encoder_get_buffer_size( &( pxEncoder->xRoot ), pxEncoder->pucBuf ) : 0;
+}
+
+/*-----------------------------------------------------------*/
+
+size_t xTelemetryEncodeDelta( const TelemetrySchema_t * pxSchema,
+                              const TelemetryDelta_t * pxDelta,
+                              TelemetryDeltaAction_t xAction,
+                              uint8_t * pucBuf,
+                              size_t xBufLen )
+{
+    CborEncoder xRoot;
+    CborEncoder xRecord;
+    CborError xError;
+
+    cbor_encoder_init( &xRoot, pucBuf, xBufLen, 0 );
+
+    xError = cbor_encoder_create_array( &xRoot, &xRecord, CborIndefiniteLength );
+
+    if( xAction == TELEMETRY_DELTA_KEYFRAME )
+    {
+        xError |= cbor_encode_uint( &xRecord, pxSchema->usId );
+        xError |= cbor_encode_uint( &xRecord, pxDelta->ulSeq );
+
+        for( uint32_t i = 0; i < pxDelta->ulNumChannels; i++ )
+        {
+            xError |= cbor_encode_int( &xRecord, pxDelta->pllLast[ i ] );
+        }
+    }
+    else if( xAction == TELEMETRY_DELTA_UPDATE )
+    {
+        xError |= cbor_encode_uint( &xRecord, pxSchema->usId | TELEMETRY_DELTA_ID_FLAG );
+        xError |= cbor_encode_uint( &xRecord, pxDelta->ulSeq );
+        xError |= cbor_encode_uint( &xRecord, pxDelta->ulChangedMask );
+
+        for( uint32_t i = 0; i < pxDelta->ulNumChannels; i++ )
+        {
+            if( ( pxDelta->ulChangedMask & ( 1UL << i ) ) != 0 )
+            {
+                xError |= cbor_encode_int( &xRecord, pxDelta->pllDelta[ i ] );
+            }
+        }
+    }
+    else
+    {
+        xError = CborErrorIllegalType;
+    }
+
+    xError |= cbor_encoder_close_container( &xRoot, &xRecord );
+
+    return ( xError == CborNoError ) ? cbor_encoder_get_buffer_size( &xRoot, pucBuf ) : 0;
+}
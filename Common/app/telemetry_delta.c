@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+#include <string.h>
+
+#include "telemetry_delta.h"
+
+#define TELEMETRY_EXP_MIN    ( -6 )
+#define TELEMETRY_EXP_MAX    ( 6 )
+
+/* 10^-exponent for each supported exponent */
+static const float pfScale[] =
+{
+    1e6f, 1e5f, 1e4f, 1e3f, 1e2f, 1e1f, 1.0f, 1e-1f, 1e-2f, 1e-3f, 1e-4f, 1e-5f, 1e-6f
+};
+
+/*-----------------------------------------------------------*/
+
+int64_t llTelemetryQuantize( float fValue,
+                             int8_t cExponent )
+{
+    int32_t lExp = cExponent;
+
+    if( lExp < TELEMETRY_EXP_MIN )
+    {
+        lExp = TELEMETRY_EXP_MIN;
+    }
+    else if( lExp > TELEMETRY_EXP_MAX )
+    {
+        lExp = TELEMETRY_EXP_MAX;
+    }
+
+    fValue *= pfScale[ lExp - TELEMETRY_EXP_MIN ];
+
+    /* Saturate rather than invoke undefined behaviour in the conversion */
+    if( fValue >= 9.2e18f )
+    {
+        fValue = 9.2e18f;
+    }
+    else if( fValue <= -9.2e18f )
+    {
+        fValue = -9.2e18f;
+    }
+    else if( fValue != fValue )
+    {
+        fValue = 0.0f;
+    }
+
+    return ( int64_t ) ( fValue + ( ( fValue < 0.0f ) ? -0.5f : 0.5f ) );
+}
+
+/*-----------------------------------------------------------*/
+
+void vTelemetryDeltaInit( TelemetryDelta_t * pxDelta,
+                          uint32_t ulNumChannels,
+                          const uint32_t * pulDeadbands,
+                          uint32_t ulKeyframeInterval )
+{
+    ( void ) memset( pxDelta, 0, sizeof( TelemetryDelta_t ) );
+
+    pxDelta->ulNumChannels = ( ulNumChannels > TELEMETRY_DELTA_MAX_CHANNELS ) ?
+                             TELEMETRY_DELTA_MAX_CHANNELS : ulNumChannels;
+    pxDelta->ulKeyframeInterval = ulKeyframeInterval;
+    pxDelta->ucNeedKeyframe = 1;
+
+    for( uint32_t i = 0; i < pxDelta->ulNumChannels; i++ )
+    {
+        pxDelta->pllDeadband[ i ] = ( pulDeadbands != NULL ) ? pulDeadbands[ i ] : 0;
+    }
+}
+
+void vTelemetryDeltaForceKeyframe( TelemetryDelta_t * pxDelta )
+{
+    pxDelta->ucNeedKeyframe = 1;
+}
+
+TelemetryDeltaAction_t xTelemetryDeltaUpdate( TelemetryDelta_t * pxDelta,
+                                              const int64_t * pllValues )
+{
+    TelemetryDeltaAction_t xAction = TELEMETRY_DELTA_SKIP;
+
+    pxDelta->ulSinceKeyframe++;
+    pxDelta->ulChangedMask = 0;
+
+    if( ( pxDelta->ucNeedKeyframe != 0 ) ||
+        ( pxDelta->ulSinceKeyframe >= pxDelta->ulKeyframeInterval ) )
+    {
+        for( uint32_t i = 0; i < pxDelta->ulNumChannels; i++ )
+        {
+            pxDelta->pllLast[ i ] = pllValues[ i ];
+            pxDelta->pllDelta[ i ] = 0;
+        }
+
+        pxDelta->ulSinceKeyframe = 0;
+        pxDelta->ucNeedKeyframe = 0;
+        xAction = TELEMETRY_DELTA_KEYFRAME;
+    }
+    else
+    {
+        for( uint32_t i = 0; i < pxDelta->ulNumChannels; i++ )
+        {
+            int64_t llDelta = pllValues[ i ] - pxDelta->pllLast[ i ];
+            int64_t llMagnitude = ( llDelta < 0 ) ? -llDelta : llDelta;
+
+            pxDelta->pllDelta[ i ] = 0;
+
+            if( llMagnitude > pxDelta->pllDeadband[ i ] )
+            {
+                pxDelta->pllDelta[ i ] = llDelta;
+                pxDelta->pllLast[ i ] = pllValues[ i ];
+                pxDelta->ulChangedMask |= ( 1UL << i );
+            }
+        }
+
+        if( pxDelta->ulChangedMask != 0 )
+        {
+            xAction = TELEMETRY_DELTA_UPDATE;
+        }
+    }
+
+    if( xAction != TELEMETRY_DELTA_SKIP )
+    {
+        pxDelta->ulSeq++;
+    }
+
+    return xAction;
+}
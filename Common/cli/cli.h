@@ -31,7 +31,8 @@
 
 #define CLI_UART_RX_READ_SZ_10MS      128
 
-#define CLI_UART_TX_WRITE_SZ_5MS      64
+/* Largest single DMA transfer to the console UART, ~44ms at 115200 baud */
+#define CLI_UART_TX_DMA_LEN           512
 
 #define CLI_UART_RX_STREAM_LEN        512
 
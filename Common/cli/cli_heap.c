@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+#include <string.h>
+#include <stdio.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "cli.h"
+#include "cli_prv.h"
+
+#include "heap_trace.h"
+
+static void prvHeapTraceCommand( ConsoleIO_t * const pxCIO,
+                                 uint32_t ulArgc,
+                                 char * ppcArgv[] );
+
+const CLI_Command_Definition_t xCommandDef_heapTrace =
+{
+    "heaptrace",
+    "heaptrace\r\n"
+    "    Display heap allocation counters and live / peak bytes per allocation call site.\r\n"
+    "    Call sites are code addresses, resolve them with addr2line.\r\n"
+    "    heaptrace frag  Display the free block size histogram.\r\n"
+    "    heaptrace reset Clear the counters and peak values.\r\n\n",
+    prvHeapTraceCommand
+};
+
+#if HEAP_TRACE_ENABLED
+
+static void prvPrintSummary( ConsoleIO_t * const pxCIO )
+{
+    HeapTraceStats_t xStats;
+    uint32_t ulElapsedMs;
+
+    vHeapTraceGetStats( &xStats );
+
+    ulElapsedMs = ( ( uint32_t ) xTaskGetTickCount() - xStats.ulResetTick ) * portTICK_PERIOD_MS;
+
+    if( ulElapsedMs == 0 )
+    {
+        ulElapsedMs = 1;
+    }
+
+    ( void ) snprintf( pcCliScratchBuffer, CLI_OUTPUT_SCRATCH_BUF_LEN,
+                       "Allocs: %lu, frees: %lu, failed: %lu, untracked: %lu\r\n"
+                       "Live: %lu bytes, peak: %lu bytes\r\n",
+                       xStats.ulAllocs,
+                       xStats.ulFrees,
+                       xStats.ulFailures,
+                       xStats.ulUntracked,
+                       xStats.ulLiveBytes,
+                       xStats.ulPeakBytes );
+    pxCIO->print( pcCliScratchBuffer );
+
+    ( void ) snprintf( pcCliScratchBuffer, CLI_OUTPUT_SCRATCH_BUF_LEN,
+                       "Rate over %lu s: %lu allocs/s, %lu bytes/s\r\n",
+                       ulElapsedMs / 1000,
+                       ( uint32_t ) ( ( ( uint64_t ) xStats.ulAllocs * 1000 ) / ulElapsedMs ),
+                       ( uint32_t ) ( ( ( uint64_t ) xStats.ulAllocBytes * 1000 ) / ulElapsedMs ) );
+    pxCIO->print( pcCliScratchBuffer );
+}
+
+static void prvPrintSites( ConsoleIO_t * const pxCIO )
+{
+    HeapTraceSite_t xSite;
+
+    pxCIO->print( "+------------------------------------------------------------+\r\n" );
+    pxCIO->print( "| Call site  |   Allocs   | Live blocks | Live bytes | Peak   |\r\n" );
+    pxCIO->print( "+------------------------------------------------------------+\r\n" );
+
+    for( uint32_t i = 0; ulHeapTraceGetSite( i, &xSite ) != 0; i++ )
+    {
+        if( xSite.pvCaller == NULL )
+        {
+            ( void ) snprintf( pcCliScratchBuffer, CLI_OUTPUT_SCRATCH_BUF_LEN, "| %-10s ", "other" );
+        }
+        else
+        {
+            ( void ) snprintf( pcCliScratchBuffer, CLI_OUTPUT_SCRATCH_BUF_LEN, "| 0x%08lx ", ( uint32_t ) xSite.pvCaller );
+        }
+
+        pxCIO->print( pcCliScratchBuffer );
+
+        ( void ) snprintf( pcCliScratchBuffer, CLI_OUTPUT_SCRATCH_BUF_LEN,
+                           "| %10lu | %11lu | %10lu | %6lu |\r\n",
+                           xSite.ulAllocs,
+                           xSite.ulLiveBlocks,
+                           xSite.ulLiveBytes,
+                           xSite.ulPeakBytes );
+        pxCIO->print( pcCliScratchBuffer );
+    }
+
+    pxCIO->print( "+------------------------------------------------------------+\r\n" );
+}
+
+static void prvPrintFragmentation( ConsoleIO_t * const pxCIO )
+{
+    HeapTraceWalk_t xWalk;
+
+    vHeapTraceWalk( &xWalk );
+
+    ( void ) snprintf( pcCliScratchBuffer, CLI_OUTPUT_SCRATCH_BUF_LEN,
+                       "Used blocks: %lu, free blocks: %lu, free bytes: %lu, largest free: %lu\r\n",
+                       xWalk.ulUsedBlocks,
+                       xWalk.ulFreeBlocks,
+                       xWalk.ulFreeBytes,
+                       xWalk.ulLargestFree );
+    pxCIO->print( pcCliScratchBuffer );
+
+    if( xWalk.ulFreeBytes > 0 )
+    {
+        /* 0% when all free memory is in one block */
+        ( void ) snprintf( pcCliScratchBuffer, CLI_OUTPUT_SCRATCH_BUF_LEN,
+                           "Fragmentation: %lu%%\r\n",
+                           100 - ( uint32_t ) ( ( ( uint64_t ) xWalk.ulLargestFree * 100 ) / xWalk.ulFreeBytes ) );
+        pxCIO->print( pcCliScratchBuffer );
+    }
+
+    pxCIO->print( "+---------------------------+\r\n" );
+    pxCIO->print( "| Free block size | Blocks  |\r\n" );
+    pxCIO->print( "+---------------------------+\r\n" );
+
+    for( uint32_t i = 0; i < HEAP_TRACE_HISTOGRAM_BUCKETS; i++ )
+    {
+        if( xWalk.pulFreeHistogram[ i ] > 0 )
+        {
+            ( void ) snprintf( pcCliScratchBuffer, CLI_OUTPUT_SCRATCH_BUF_LEN,
+                               "|      < %8lu | %7lu |\r\n",
+                               1UL << ( i + 5 ),
+                               xWalk.pulFreeHistogram[ i ] );
+            pxCIO->print( pcCliScratchBuffer );
+        }
+    }
+
+    pxCIO->print( "+---------------------------+\r\n" );
+}
+
+static void prvHeapTraceCommand( ConsoleIO_t * const pxCIO,
+                                 uint32_t ulArgc,
+                                 char * ppcArgv[] )
+{
+    if( ulArgc <= 1 )
+    {
+        prvPrintSummary( pxCIO );
+        prvPrintSites( pxCIO );
+    }
+    else if( strcmp( "frag", ppcArgv[ 1 ] ) == 0 )
+    {
+        prvPrintFragmentation( pxCIO );
+    }
+    else if( strcmp( "reset", ppcArgv[ 1 ] ) == 0 )
+    {
+        vHeapTraceReset();
+        pxCIO->print( "Heap trace counters cleared.\r\n" );
+    }
+    else
+    {
+        pxCIO->print( "Error: Unknown argument.\r\n" );
+    }
+}
+
+#else /* HEAP_TRACE_ENABLED */
+
+static void prvHeapTraceCommand( ConsoleIO_t * const pxCIO,
+                                 uint32_t ulArgc,
+                                 char * ppcArgv[] )
+{
+    ( void ) ulArgc;
+    ( void ) ppcArgv;
+
+    pxCIO->print( "Heap tracing is disabled. Set HEAP_TRACE_ENABLED to 1 in heap_trace.h.\r\n" );
+}
+
+#endif /* HEAP_TRACE_ENABLED */
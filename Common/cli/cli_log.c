@@ -0,0 +1,226 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+#include <string.h>
+#include <stdio.h>
+
+#include "FreeRTOS.h"
+
+#include "cli.h"
+#include "cli_prv.h"
+#include "logging.h"
+#include "kvstore.h"
+
+static void prvLogStatCommand( ConsoleIO_t * const pxCIO,
+                               uint32_t ulArgc,
+                               char * ppcArgv[] );
+
+static void prvLogLevelCommand( ConsoleIO_t * const pxCIO,
+                                uint32_t ulArgc,
+                                char * ppcArgv[] );
+
+static const char * const pcModuleNames[ LOG_MODULE_MAX ] = LOG_MODULE_NAMES;
+
+static const char * const pcLevelNames[] = { "none", "error", "warn", "info", "debug" };
+
+const CLI_Command_Definition_t xCommandDef_logstat =
+{
+    "logstat",
+    "logstat\r\n"
+    "    Display the cost of log calls in CPU cycles, including the time spent\r\n"
+    "    with the scheduler suspended, for the text and binary logging paths,\r\n"
+    "    and the fill level and drop count of each log staging buffer.\r\n"
+    "    logstat reset  Clear the statistics.\r\n\n",
+    prvLogStatCommand
+};
+
+const CLI_Command_Definition_t xCommandDef_loglevel =
+{
+    "loglevel",
+    "loglevel\r\n"
+    "    Display the runtime log level of each module.\r\n"
+    "    loglevel <module|all> <none|error|warn|info|debug>\r\n"
+    "        Set the runtime log level of a module. Messages above the compile\r\n"
+    "        time LOG_LEVEL of a file are never output. Run \"conf commit\" to\r\n"
+    "        keep the new levels across a reboot.\r\n\n",
+    prvLogLevelCommand
+};
+
+static void prvPrintLogStats( ConsoleIO_t * const pxCIO )
+{
+    static const char * const pcPathNames[ LOG_PATH_MAX ] = { "text", "binary" };
+    LoggingStats_t xStats[ LOG_PATH_MAX ];
+    LogStagingInfo_t xInfo;
+
+    vLoggingGetStats( xStats );
+
+#ifdef LOGGING_DEFERRED_BINARY
+    pxCIO->print( "Logging mode: deferred binary\r\n" );
+#else
+    pxCIO->print( "Logging mode: text\r\n" );
+#endif
+
+    pxCIO->print( "+------------------------------------------------------------------------------------+\r\n" );
+    pxCIO->print( "| Path   |   Calls    |  Dropped   | Avg cycles | Max cycles | Avg susp. | Max susp. |\r\n" );
+    pxCIO->print( "+------------------------------------------------------------------------------------+\r\n" );
+
+    for( uint32_t i = 0; i < LOG_PATH_MAX; i++ )
+    {
+        uint32_t ulAvgCycles = 0;
+        uint32_t ulAvgSuspended = 0;
+
+        if( xStats[ i ].ulCalls > 0 )
+        {
+            ulAvgCycles = ( uint32_t ) ( xStats[ i ].ullTotalCycles / xStats[ i ].ulCalls );
+            ulAvgSuspended = ( uint32_t ) ( xStats[ i ].ullTotalSuspendedCycles / xStats[ i ].ulCalls );
+        }
+
+        ( void ) snprintf( pcCliScratchBuffer, CLI_OUTPUT_SCRATCH_BUF_LEN,
+                           "| %-6s | %10lu | %10lu | %10lu | %10lu | %9lu | %9lu |\r\n",
+                           pcPathNames[ i ],
+                           xStats[ i ].ulCalls,
+                           xStats[ i ].ulDropped,
+                           ulAvgCycles,
+                           xStats[ i ].ulMaxCycles,
+                           ulAvgSuspended,
+                           xStats[ i ].ulMaxSuspendedCycles );
+        pxCIO->print( pcCliScratchBuffer );
+    }
+
+    pxCIO->print( "+------------------------------------------------------------------------------------+\r\n" );
+
+    pxCIO->print( "+--------------------------------------------------+\r\n" );
+    pxCIO->print( "| Staging buffer   |  Size  |  Used  |  Dropped    |\r\n" );
+    pxCIO->print( "+--------------------------------------------------+\r\n" );
+
+    for( uint32_t i = 0; ulLoggingGetStagingInfo( i, &xInfo ) != 0; i++ )
+    {
+        ( void ) snprintf( pcCliScratchBuffer, CLI_OUTPUT_SCRATCH_BUF_LEN,
+                           "| %-16.16s | %6lu | %6lu | %10lu  |\r\n",
+                           xInfo.pcOwnerName,
+                           xInfo.ulSize,
+                           xInfo.ulUsed,
+                           xInfo.ulDropped );
+        pxCIO->print( pcCliScratchBuffer );
+    }
+
+    pxCIO->print( "+--------------------------------------------------+\r\n" );
+}
+
+static void prvLogStatCommand( ConsoleIO_t * const pxCIO,
+                               uint32_t ulArgc,
+                               char * ppcArgv[] )
+{
+    if( ulArgc <= 1 )
+    {
+        prvPrintLogStats( pxCIO );
+    }
+    else if( strcmp( "reset", ppcArgv[ 1 ] ) == 0 )
+    {
+        vLoggingResetStats();
+        pxCIO->print( "Logging statistics cleared.\r\n" );
+    }
+    else
+    {
+        pxCIO->print( "Error: Unknown argument.\r\n" );
+    }
+}
+
+static void prvPrintLogLevels( ConsoleIO_t * const pxCIO )
+{
+    for( uint32_t i = 0; i < LOG_MODULE_MAX; i++ )
+    {
+        uint8_t ucLevel = pucLogModuleLevels[ i ];
+
+        ( void ) snprintf( pcCliScratchBuffer, CLI_OUTPUT_SCRATCH_BUF_LEN,
+                           "%-10s %s\r\n",
+                           pcModuleNames[ i ],
+                           ( ucLevel <= LOG_DEBUG ) ? pcLevelNames[ ucLevel ] : "?" );
+        pxCIO->print( pcCliScratchBuffer );
+    }
+}
+
+static void prvLogLevelCommand( ConsoleIO_t * const pxCIO,
+                                uint32_t ulArgc,
+                                char * ppcArgv[] )
+{
+    if( ulArgc <= 1 )
+    {
+        prvPrintLogLevels( pxCIO );
+    }
+    else if( ulArgc == 3 )
+    {
+        uint32_t ulModule = LOG_MODULE_MAX;
+        uint32_t ulLevel = LOG_DEBUG + 1;
+        BaseType_t xAll = ( strcmp( "all", ppcArgv[ 1 ] ) == 0 ) ? pdTRUE : pdFALSE;
+
+        for( uint32_t i = 0; i < LOG_MODULE_MAX; i++ )
+        {
+            if( strcmp( pcModuleNames[ i ], ppcArgv[ 1 ] ) == 0 )
+            {
+                ulModule = i;
+            }
+        }
+
+        for( uint32_t i = 0; i <= LOG_DEBUG; i++ )
+        {
+            if( strcmp( pcLevelNames[ i ], ppcArgv[ 2 ] ) == 0 )
+            {
+                ulLevel = i;
+            }
+        }
+
+        if( ( ulModule == LOG_MODULE_MAX ) &&
+            ( xAll == pdFALSE ) )
+        {
+            pxCIO->print( "Error: Unknown module.\r\n" );
+        }
+        else if( ulLevel > LOG_DEBUG )
+        {
+            pxCIO->print( "Error: Unknown log level.\r\n" );
+        }
+        else
+        {
+            if( xAll == pdTRUE )
+            {
+                for( uint32_t i = 0; i < LOG_MODULE_MAX; i++ )
+                {
+                    vLoggingSetModuleLevel( i, ( uint8_t ) ulLevel );
+                }
+            }
+            else
+            {
+                vLoggingSetModuleLevel( ulModule, ( uint8_t ) ulLevel );
+            }
+
+            ( void ) KVStore_setUInt32( CS_LOG_LEVELS, ulLoggingGetModuleLevels() );
+
+            prvPrintLogLevels( pxCIO );
+        }
+    }
+    else
+    {
+        pxCIO->print( "Error: Invalid arguments.\r\n" );
+    }
+}
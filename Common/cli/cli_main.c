@@ -340,12 +340,21 @@ void Task_CLI( void * pvParameters )
     FreeRTOS_CLIRegisterCommand( &xCommandDef_conf );
     FreeRTOS_CLIRegisterCommand( &xCommandDef_pki );
     FreeRTOS_CLIRegisterCommand( &xCommandDef_ps );
+    FreeRTOS_CLIRegisterCommand( &xCommandDef_top );
     FreeRTOS_CLIRegisterCommand( &xCommandDef_kill );
     FreeRTOS_CLIRegisterCommand( &xCommandDef_killAll );
     FreeRTOS_CLIRegisterCommand( &xCommandDef_heapStat );
+    FreeRTOS_CLIRegisterCommand( &xCommandDef_heapTrace );
     FreeRTOS_CLIRegisterCommand( &xCommandDef_reset );
     FreeRTOS_CLIRegisterCommand( &xCommandDef_uptime );
     FreeRTOS_CLIRegisterCommand( &xCommandDef_rngtest );
+    FreeRTOS_CLIRegisterCommand( &xCommandDef_perf );
+    FreeRTOS_CLIRegisterCommand( &xCommandDef_netstat );
+    FreeRTOS_CLIRegisterCommand( &xCommandDef_logstat );
+    FreeRTOS_CLIRegisterCommand( &xCommandDef_loglevel );
+    FreeRTOS_CLIRegisterCommand( &xCommandDef_trace );
+    FreeRTOS_CLIRegisterCommand( &xCommandDef_replay );
+    FreeRTOS_CLIRegisterCommand( &xCommandDef_sensors );
 
     char * pcCommandBuffer = NULL;
 
@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+#include <string.h>
+#include <stdio.h>
+
+#include "FreeRTOS.h"
+
+#include "cli.h"
+#include "cli_prv.h"
+
+#include "mx_netconn.h"
+
+static void prvNetstatCommand( ConsoleIO_t * const pxCIO,
+                               uint32_t ulArgc,
+                               char * ppcArgv[] );
+
+const CLI_Command_Definition_t xCommandDef_netstat =
+{
+    "netstat",
+    "netstat\r\n"
+    "    Display MXCHIP transmit queue and SPI transport counters since boot.\r\n"
+    "    Queue delays are the time frames spent queued before the SPI transfer, in ms.\r\n"
+    "    Copied frames had to be cloned into a contiguous buffer before transmission.\r\n\n",
+    prvNetstatCommand
+};
+
+static const char * const ppcTxClassNames[ MX_TX_CLASS_MAX ] =
+{
+    "interactive",
+    "bulk"
+};
+
+static void prvPrintTxQueueStats( ConsoleIO_t * const pxCIO )
+{
+    MxTxQueueStats_t xTxQueueStats[ MX_TX_CLASS_MAX ];
+
+    net_get_tx_queue_stats( xTxQueueStats );
+
+    pxCIO->print( "+----------------------------------------------------------------------------------------------+\r\n" );
+    pxCIO->print( "| TX class    |  Enqueued  |  Dropped   |  Dequeued  | Avg ms | Max ms |  Copied  | Copied B   |\r\n" );
+    pxCIO->print( "+----------------------------------------------------------------------------------------------+\r\n" );
+
+    for( uint32_t i = 0; i < MX_TX_CLASS_MAX; i++ )
+    {
+        MxTxQueueStats_t * pxStats = &( xTxQueueStats[ i ] );
+        uint32_t ulAvgDelayMs = 0;
+
+        if( pxStats->ulDequeued > 0 )
+        {
+            ulAvgDelayMs = ( pxStats->ulTotalDelayTicks / pxStats->ulDequeued ) * portTICK_PERIOD_MS;
+        }
+
+        ( void ) snprintf( pcCliScratchBuffer, CLI_OUTPUT_SCRATCH_BUF_LEN,
+                           "| %-11s | %10lu | %10lu | %10lu | %6lu | %6lu | %8lu | %10lu |\r\n",
+                           ppcTxClassNames[ i ],
+                           pxStats->ulEnqueued,
+                           pxStats->ulDropped,
+                           pxStats->ulDequeued,
+                           ulAvgDelayMs,
+                           pxStats->ulMaxDelayTicks * portTICK_PERIOD_MS,
+                           pxStats->ulCopiedFrames,
+                           pxStats->ulCopiedBytes );
+        pxCIO->print( pcCliScratchBuffer );
+    }
+
+    pxCIO->print( "+----------------------------------------------------------------------------------------------+\r\n" );
+}
+
+static void prvPrintSpiStats( ConsoleIO_t * const pxCIO )
+{
+    MxSpiStats_t xSpiStats;
+
+    net_get_spi_stats( &xSpiStats );
+
+    ( void ) snprintf( pcCliScratchBuffer, CLI_OUTPUT_SCRATCH_BUF_LEN,
+                       "SPI transfers: %lu, errors: %lu, header errors: %lu, rx dropped: %lu\r\n",
+                       xSpiStats.ulTransfers,
+                       xSpiStats.ulErrors,
+                       xSpiStats.ulHeaderErrors,
+                       xSpiStats.ulRxDropped );
+    pxCIO->print( pcCliScratchBuffer );
+}
+
+static void prvNetstatCommand( ConsoleIO_t * const pxCIO,
+                               uint32_t ulArgc,
+                               char * ppcArgv[] )
+{
+    ( void ) ppcArgv;
+
+    if( ulArgc <= 1 )
+    {
+        prvPrintTxQueueStats( pxCIO );
+        prvPrintSpiStats( pxCIO );
+    }
+    else
+    {
+        pxCIO->print( "Error: Unknown argument.\r\n" );
+    }
+}
@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+#include <string.h>
+#include <stdio.h>
+
+#include "FreeRTOS.h"
+
+#include "cli.h"
+#include "cli_prv.h"
+
+#include "arch/perf.h"
+
+static void prvPerfCommand( ConsoleIO_t * const pxCIO,
+                            uint32_t ulArgc,
+                            char * ppcArgv[] );
+
+const CLI_Command_Definition_t xCommandDef_perf =
+{
+    "perf",
+    "perf\r\n"
+    "    Display per-site timing collected by the lwIP PERF_START / PERF_STOP hooks.\r\n"
+    "    Values are in CPU cycles.\r\n"
+    "    perf -v    Also display the log2 histogram for each site.\r\n"
+    "    perf reset Clear all collected samples.\r\n\n",
+    prvPerfCommand
+};
+
+#if LWIP_PERF
+
+static void prvPrintHistogram( ConsoleIO_t * const pxCIO,
+                               const LwipPerfSite_t * pxSite )
+{
+    for( uint32_t i = 0; i < LWIP_PERF_HISTOGRAM_BUCKETS; i++ )
+    {
+        if( pxSite->pulHistogram[ i ] > 0 )
+        {
+            ( void ) snprintf( pcCliScratchBuffer, CLI_OUTPUT_SCRATCH_BUF_LEN,
+                               "|     >= %10lu : %10lu\r\n",
+                               ( i == 0 ) ? 0UL : ( 1UL << i ),
+                               pxSite->pulHistogram[ i ] );
+            pxCIO->print( pcCliScratchBuffer );
+        }
+    }
+}
+
+static void prvPrintSites( ConsoleIO_t * const pxCIO,
+                           BaseType_t xVerbose )
+{
+    LwipPerfSite_t xSite;
+
+    pxCIO->print( "+------------------------------------------------------------------------+\r\n" );
+    pxCIO->print( "| Site               |  Samples   |    Min     |    Avg     |    Max     |\r\n" );
+    pxCIO->print( "+------------------------------------------------------------------------+\r\n" );
+
+    for( uint32_t i = 0; ulLwipPerfGetSite( i, &xSite ) != 0; i++ )
+    {
+        uint32_t ulAvg = 0;
+
+        if( xSite.ulSamples > 0 )
+        {
+            ulAvg = ( uint32_t ) ( xSite.ullTotal / xSite.ulSamples );
+        }
+        else
+        {
+            xSite.ulMin = 0;
+        }
+
+        ( void ) snprintf( pcCliScratchBuffer, CLI_OUTPUT_SCRATCH_BUF_LEN,
+                           "| %-18.18s | %10lu | %10lu | %10lu | %10lu |\r\n",
+                           xSite.pcName,
+                           xSite.ulSamples,
+                           xSite.ulMin,
+                           ulAvg,
+                           xSite.ulMax );
+        pxCIO->print( pcCliScratchBuffer );
+
+        if( xVerbose == pdTRUE )
+        {
+            prvPrintHistogram( pxCIO, &xSite );
+        }
+    }
+
+    pxCIO->print( "+------------------------------------------------------------------------+\r\n" );
+
+    if( ulLwipPerfDroppedSamples > 0 )
+    {
+        ( void ) snprintf( pcCliScratchBuffer, CLI_OUTPUT_SCRATCH_BUF_LEN,
+                           "%lu samples dropped, increase LWIP_PERF_MAX_SITES.\r\n",
+                           ulLwipPerfDroppedSamples );
+        pxCIO->print( pcCliScratchBuffer );
+    }
+}
+
+static void prvPerfCommand( ConsoleIO_t * const pxCIO,
+                            uint32_t ulArgc,
+                            char * ppcArgv[] )
+{
+    if( ulArgc <= 1 )
+    {
+        prvPrintSites( pxCIO, pdFALSE );
+    }
+    else if( strcmp( "-v", ppcArgv[ 1 ] ) == 0 )
+    {
+        prvPrintSites( pxCIO, pdTRUE );
+    }
+    else if( strcmp( "reset", ppcArgv[ 1 ] ) == 0 )
+    {
+        vLwipPerfReset();
+        pxCIO->print( "lwIP perf counters cleared.\r\n" );
+    }
+    else
+    {
+        pxCIO->print( "Error: Unknown argument.\r\n" );
+    }
+}
+
+#else /* LWIP_PERF */
+
+static void prvPerfCommand( ConsoleIO_t * const pxCIO,
+                            uint32_t ulArgc,
+                            char * ppcArgv[] )
+{
+    ( void ) ulArgc;
+    ( void ) ppcArgv;
+
+    pxCIO->print( "lwIP perf instrumentation is disabled. Set LWIP_PERF to 1 in lwipopts.h.\r\n" );
+}
+
+#endif /* LWIP_PERF */
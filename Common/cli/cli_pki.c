@@ -555,7 +555,7 @@ static void vSubCommand_GenerateKey( ConsoleIO_t * pxCIO,
     if( pucPublicKeyDer )
     {
         /* Free heap allocated memory */
-        vPortFree( pucPublicKeyDer );
+        mbedtls_free( pucPublicKeyDer );
         pucPublicKeyDer = NULL;
     }
 }
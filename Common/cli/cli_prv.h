@@ -126,11 +126,20 @@ UART_HandleTypeDef * vInitUartEarly( void );
 extern const CLI_Command_Definition_t xCommandDef_conf;
 extern const CLI_Command_Definition_t xCommandDef_pki;
 extern const CLI_Command_Definition_t xCommandDef_ps;
+extern const CLI_Command_Definition_t xCommandDef_top;
 extern const CLI_Command_Definition_t xCommandDef_kill;
 extern const CLI_Command_Definition_t xCommandDef_killAll;
 extern const CLI_Command_Definition_t xCommandDef_heapStat;
+extern const CLI_Command_Definition_t xCommandDef_heapTrace;
 extern const CLI_Command_Definition_t xCommandDef_reset;
 extern const CLI_Command_Definition_t xCommandDef_uptime;
 extern const CLI_Command_Definition_t xCommandDef_rngtest;
+extern const CLI_Command_Definition_t xCommandDef_perf;
+extern const CLI_Command_Definition_t xCommandDef_netstat;
+extern const CLI_Command_Definition_t xCommandDef_logstat;
+extern const CLI_Command_Definition_t xCommandDef_loglevel;
+extern const CLI_Command_Definition_t xCommandDef_trace;
+extern const CLI_Command_Definition_t xCommandDef_replay;
+extern const CLI_Command_Definition_t xCommandDef_sensors;
 
 #endif /* _CLI_PRIV */
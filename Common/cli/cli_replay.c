@@ -0,0 +1,256 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "cli.h"
+#include "cli_prv.h"
+
+#include "sensor_replay.h"
+#include "mqtt_agent_task.h"
+
+static void prvReplayCommand( ConsoleIO_t * const pxCIO,
+                              uint32_t ulArgc,
+                              char * ppcArgv[] );
+
+const CLI_Command_Definition_t xCommandDef_replay =
+{
+    "replay",
+    "replay\r\n"
+    "    Drive the sensor publishers from generated or recorded samples instead of\r\n"
+    "    the sensors, to load test the publish path at a controlled rate.\r\n"
+    "    replay start <env|motion> <hz> [synthetic|trace]\r\n"
+    "                 Start replaying at <hz> samples per second (1 to 1000).\r\n"
+    "    replay stop <env|motion>\r\n"
+    "                 Stop replaying and return to the sensors.\r\n"
+    "    replay csv <env|motion> <v1,v2,...>\r\n"
+    "                 Append one trace row: env takes temp_0,rh,temp_1,baro and\r\n"
+    "                 motion takes acc xyz,gyro xyz,mag xyz. See tools/replay_push.py.\r\n"
+    "    replay clear <env|motion>\r\n"
+    "                 Discard the trace rows of a stopped source.\r\n"
+    "    replay stats Print throughput, drops, queue depth and heap usage.\r\n\n",
+    prvReplayCommand
+};
+
+static const char * const pcSourceNames[ SENSOR_REPLAY_NUM_SOURCES ] =
+{
+    "env",
+    "motion"
+};
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvParseSource( const char * pcArg,
+                                  SensorReplaySourceId_t * pxSource )
+{
+    BaseType_t xResult = pdFALSE;
+
+    for( uint32_t i = 0; ( pcArg != NULL ) && ( i < SENSOR_REPLAY_NUM_SOURCES ); i++ )
+    {
+        if( strcmp( pcSourceNames[ i ], pcArg ) == 0 )
+        {
+            *pxSource = ( SensorReplaySourceId_t ) i;
+            xResult = pdTRUE;
+            break;
+        }
+    }
+
+    return xResult;
+}
+
+static void prvReplayStart( ConsoleIO_t * const pxCIO,
+                            SensorReplaySourceId_t xSource,
+                            uint32_t ulArgc,
+                            char * ppcArgv[] )
+{
+    SensorReplayMode_t xMode = SENSOR_REPLAY_SYNTHETIC;
+    uint32_t ulRateHz = 0;
+
+    if( ulArgc > 3 )
+    {
+        ulRateHz = strtoul( ppcArgv[ 3 ], NULL, 10 );
+    }
+
+    if( ( ulArgc > 4 ) && ( strcmp( "trace", ppcArgv[ 4 ] ) == 0 ) )
+    {
+        xMode = SENSOR_REPLAY_TRACE;
+    }
+
+    if( xSensorReplayStart( xSource, ulRateHz, xMode ) == pdTRUE )
+    {
+        ( void ) snprintf( pcCliScratchBuffer, CLI_OUTPUT_SCRATCH_BUF_LEN,
+                           "Replaying %s %s samples at %lu Hz.\r\n",
+                           ( xMode == SENSOR_REPLAY_TRACE ) ? "trace" : "synthetic",
+                           pcSourceNames[ xSource ],
+                           ( unsigned long ) ulRateHz );
+        pxCIO->print( pcCliScratchBuffer );
+    }
+    else if( xMode == SENSOR_REPLAY_TRACE )
+    {
+        pxCIO->print( "Error: Invalid rate or no trace rows loaded.\r\n" );
+    }
+    else
+    {
+        pxCIO->print( "Error: Rate must be between 1 and 1000 Hz.\r\n" );
+    }
+}
+
+static void prvReplayCsv( ConsoleIO_t * const pxCIO,
+                          SensorReplaySourceId_t xSource,
+                          uint32_t ulArgc,
+                          char * ppcArgv[] )
+{
+    float pfValues[ SENSOR_REPLAY_MAX_CHANNELS ];
+    uint32_t ulNumValues = 0;
+    char * pcCursor = ( ulArgc > 3 ) ? ppcArgv[ 3 ] : NULL;
+
+    while( ( pcCursor != NULL ) && ( *pcCursor != '\0' ) && ( ulNumValues < SENSOR_REPLAY_MAX_CHANNELS ) )
+    {
+        char * pcEnd = NULL;
+
+        pfValues[ ulNumValues ] = strtof( pcCursor, &pcEnd );
+
+        if( pcEnd == pcCursor )
+        {
+            pcCursor = NULL;
+        }
+        else
+        {
+            ulNumValues++;
+            pcCursor = ( *pcEnd == ',' ) ? ( pcEnd + 1 ) : pcEnd;
+        }
+    }
+
+    if( ( pcCursor == NULL ) || ( *pcCursor != '\0' ) )
+    {
+        pxCIO->print( "Error: Malformed row.\r\n" );
+    }
+    else if( xSensorReplayAddRow( xSource, pfValues, ulNumValues ) != pdTRUE )
+    {
+        pxCIO->print( "Error: Wrong column count, trace full or source running.\r\n" );
+    }
+    else
+    {
+        /* Keep the acknowledgement short, rows are usually pushed by a script */
+        pxCIO->print( "ok\r\n" );
+    }
+}
+
+static void prvPrintStats( ConsoleIO_t * const pxCIO,
+                           SensorReplaySourceId_t xSource )
+{
+    SensorReplayStats_t xStats;
+    uint32_t ulPubRate = 0;
+
+    vSensorReplayGetStats( xSource, &xStats );
+
+    if( xStats.ulElapsedMs > 0 )
+    {
+        ulPubRate = ( uint32_t ) ( ( ( uint64_t ) xStats.ulPublished * 1000 ) / xStats.ulElapsedMs );
+    }
+
+    ( void ) snprintf( pcCliScratchBuffer, CLI_OUTPUT_SCRATCH_BUF_LEN,
+                       "%-6s %-9s %4lu Hz rows=%lu elapsed=%lu ms samples=%lu consumed=%lu dropped=%lu\r\n"
+                       "       published=%lu failed=%lu bytes=%lu pub_rate=%lu/s max_queue=%lu\r\n",
+                       pcSourceNames[ xSource ],
+                       ( xStats.ulRateHz == 0 ) ? "stopped" :
+                       ( xStats.xMode == SENSOR_REPLAY_TRACE ) ? "trace" : "synthetic",
+                       ( unsigned long ) xStats.ulRateHz,
+                       ( unsigned long ) xStats.ulTraceRows,
+                       ( unsigned long ) xStats.ulElapsedMs,
+                       ( unsigned long ) xStats.ulSamples,
+                       ( unsigned long ) xStats.ulConsumed,
+                       ( unsigned long ) xStats.ulDropped,
+                       ( unsigned long ) xStats.ulPublished,
+                       ( unsigned long ) xStats.ulFailed,
+                       ( unsigned long ) xStats.ulBytes,
+                       ( unsigned long ) ulPubRate,
+                       ( unsigned long ) xStats.ulMaxQueueDepth );
+    pxCIO->print( pcCliScratchBuffer );
+}
+
+static void prvReplayStats( ConsoleIO_t * const pxCIO )
+{
+    for( uint32_t i = 0; i < SENSOR_REPLAY_NUM_SOURCES; i++ )
+    {
+        prvPrintStats( pxCIO, ( SensorReplaySourceId_t ) i );
+    }
+
+    ( void ) snprintf( pcCliScratchBuffer, CLI_OUTPUT_SCRATCH_BUF_LEN,
+                       "mqtt_queue=%lu heap_free=%lu heap_min=%lu\r\n",
+                       ( unsigned long ) uxGetMqttAgentQueueDepth(),
+                       ( unsigned long ) xPortGetFreeHeapSize(),
+                       ( unsigned long ) xPortGetMinimumEverFreeHeapSize() );
+    pxCIO->print( pcCliScratchBuffer );
+}
+
+static void prvReplayCommand( ConsoleIO_t * const pxCIO,
+                              uint32_t ulArgc,
+                              char * ppcArgv[] )
+{
+    SensorReplaySourceId_t xSource = SENSOR_REPLAY_ENV;
+
+    if( ( ulArgc <= 1 ) || ( strcmp( "stats", ppcArgv[ 1 ] ) == 0 ) )
+    {
+        prvReplayStats( pxCIO );
+    }
+    else if( ( ulArgc <= 2 ) || ( prvParseSource( ppcArgv[ 2 ], &xSource ) != pdTRUE ) )
+    {
+        pxCIO->print( "Error: Expected a source, env or motion.\r\n" );
+    }
+    else if( strcmp( "start", ppcArgv[ 1 ] ) == 0 )
+    {
+        prvReplayStart( pxCIO, xSource, ulArgc, ppcArgv );
+    }
+    else if( strcmp( "stop", ppcArgv[ 1 ] ) == 0 )
+    {
+        vSensorReplayStop( xSource );
+        prvPrintStats( pxCIO, xSource );
+    }
+    else if( strcmp( "csv", ppcArgv[ 1 ] ) == 0 )
+    {
+        prvReplayCsv( pxCIO, xSource, ulArgc, ppcArgv );
+    }
+    else if( strcmp( "clear", ppcArgv[ 1 ] ) == 0 )
+    {
+        if( xSensorReplayActive( xSource ) == pdTRUE )
+        {
+            pxCIO->print( "Error: Stop the source before clearing its trace.\r\n" );
+        }
+        else
+        {
+            vSensorReplayClear( xSource );
+            pxCIO->print( "Trace cleared.\r\n" );
+        }
+    }
+    else
+    {
+        pxCIO->print( "Error: Unknown argument.\r\n" );
+    }
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+#include <stdio.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "cli.h"
+#include "cli_prv.h"
+
+#include "sensor_sched.h"
+
+static void prvSensorsCommand( ConsoleIO_t * const pxCIO,
+                               uint32_t ulArgc,
+                               char * ppcArgv[] );
+
+const CLI_Command_Definition_t xCommandDef_sensors =
+{
+    "sensors",
+    "sensors\r\n"
+    "    Print the sensor acquisition schedule: rate, reads, errors, missed\r\n"
+    "    deadlines, worst lateness and bus read time per sensor, consumer ring\r\n"
+    "    usage and the unused stack of the acquisition task.\r\n\n",
+    prvSensorsCommand
+};
+
+/*-----------------------------------------------------------*/
+
+static void prvSensorsCommand( ConsoleIO_t * const pxCIO,
+                               uint32_t ulArgc,
+                               char * ppcArgv[] )
+{
+    ( void ) ulArgc;
+    ( void ) ppcArgv;
+
+    pxCIO->print( "sensor      rate_mhz mode  reads    samples  errors overruns late_ms read_us ring     dropped\r\n" );
+
+    for( uint32_t i = 0; i < SENSOR_ID_MAX; i++ )
+    {
+        SensorSchedStats_t xStats;
+
+        vSensorSchedGetStats( ( SensorId_t ) i, &xStats );
+
+        ( void ) snprintf( pcCliScratchBuffer, CLI_OUTPUT_SCRATCH_BUF_LEN,
+                           "%-11s %8lu %-5s %-8lu %-8lu %-6lu %-8lu %-7lu %-7lu %3lu/%-4lu %lu\r\n",
+                           xStats.pcName,
+                           ( unsigned long ) ( xStats.fRateHz * 1000.0f ),
+                           ( xStats.xUsesFifo == pdTRUE ) ? "fifo" : "poll",
+                           ( unsigned long ) xStats.ulReads,
+                           ( unsigned long ) xStats.ulSamples,
+                           ( unsigned long ) xStats.ulErrors,
+                           ( unsigned long ) xStats.ulOverruns,
+                           ( unsigned long ) xStats.ulMaxLatenessMs,
+                           ( unsigned long ) xStats.ulMaxReadUs,
+                           ( unsigned long ) xStats.ulRingHighWater,
+                           ( unsigned long ) xStats.ulRingLength,
+                           ( unsigned long ) xStats.ulRingDropped );
+        pxCIO->print( pcCliScratchBuffer );
+    }
+
+    ( void ) snprintf( pcCliScratchBuffer, CLI_OUTPUT_SCRATCH_BUF_LEN,
+                       "acquisition task stack unused: %lu words\r\n",
+                       ( unsigned long ) uxSensorSchedStackHighWater() );
+    pxCIO->print( pcCliScratchBuffer );
+}
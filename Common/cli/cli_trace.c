@@ -0,0 +1,283 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+#include <string.h>
+#include <stdio.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
+#include "cli.h"
+#include "cli_prv.h"
+
+#include "trace_ring.h"
+
+static void prvTraceCommand( ConsoleIO_t * const pxCIO,
+                             uint32_t ulArgc,
+                             char * ppcArgv[] );
+
+const CLI_Command_Definition_t xCommandDef_trace =
+{
+    "trace",
+    "trace\r\n"
+    "    Record scheduler, queue, interrupt and user events to a RAM ring buffer.\r\n"
+    "    trace start [sched] [queue] [isr] [user]\r\n"
+    "               Clear the ring and start recording the given event classes\r\n"
+    "               (default: all).\r\n"
+    "    trace stop Stop recording.\r\n"
+    "    trace dump Stop recording and print the recorded events. Convert the output\r\n"
+    "               with tools/trace_to_json.py for chrome://tracing or Perfetto.\r\n\n",
+    prvTraceCommand
+};
+
+#if TRACE_RING_ENABLED
+
+static const char * prvEventTypeToString( uint8_t ucType )
+{
+    const char * pcType = "unknown";
+
+    switch( ucType )
+    {
+        case TRACE_EVT_TASK_SWITCH:
+            pcType = "switch";
+            break;
+
+        case TRACE_EVT_QUEUE_SEND:
+            pcType = "qsend";
+            break;
+
+        case TRACE_EVT_QUEUE_RECEIVE:
+            pcType = "qrecv";
+            break;
+
+        case TRACE_EVT_QUEUE_BLOCK_SEND:
+            pcType = "qblock_send";
+            break;
+
+        case TRACE_EVT_QUEUE_BLOCK_RECV:
+            pcType = "qblock_recv";
+            break;
+
+        case TRACE_EVT_ISR_ENTER:
+            pcType = "isr_enter";
+            break;
+
+        case TRACE_EVT_ISR_EXIT:
+            pcType = "isr_exit";
+            break;
+
+        case TRACE_EVT_USER_BEGIN:
+            pcType = "begin";
+            break;
+
+        case TRACE_EVT_USER_END:
+            pcType = "end";
+            break;
+
+        case TRACE_EVT_USER_VALUE:
+            pcType = "value";
+            break;
+
+        default:
+            break;
+    }
+
+    return pcType;
+}
+
+static const char * prvEventLabel( const TraceEvent_t * pxEvent )
+{
+    const char * pcLabel = NULL;
+
+    switch( pxEvent->ucType )
+    {
+        case TRACE_EVT_USER_BEGIN:
+        case TRACE_EVT_USER_END:
+        case TRACE_EVT_USER_VALUE:
+            pcLabel = ( const char * ) pxEvent->ulArg;
+            break;
+
+        case TRACE_EVT_QUEUE_SEND:
+        case TRACE_EVT_QUEUE_RECEIVE:
+        case TRACE_EVT_QUEUE_BLOCK_SEND:
+        case TRACE_EVT_QUEUE_BLOCK_RECV:
+            /* Only queues added to the queue registry have a name */
+            pcLabel = pcQueueGetName( ( QueueHandle_t ) pxEvent->ulArg );
+            break;
+
+        default:
+            break;
+    }
+
+    return ( pcLabel != NULL ) ? pcLabel : "";
+}
+
+static void prvPrintTaskNames( ConsoleIO_t * const pxCIO )
+{
+    UBaseType_t uxNumTasks = uxTaskGetNumberOfTasks();
+    TaskStatus_t * pxTaskStatusArray = ( TaskStatus_t * ) pvPortMalloc( sizeof( TaskStatus_t ) * uxNumTasks );
+
+    if( pxTaskStatusArray == NULL )
+    {
+        pxCIO->print( "Error: Not enough memory to list task names.\r\n" );
+    }
+    else
+    {
+        uxNumTasks = uxTaskGetSystemState( pxTaskStatusArray, uxNumTasks, NULL );
+
+        for( uint32_t i = 0; i < uxNumTasks; i++ )
+        {
+            ( void ) snprintf( pcCliScratchBuffer, CLI_OUTPUT_SCRATCH_BUF_LEN,
+                               "T %lu %s\r\n",
+                               ( unsigned long ) pxTaskStatusArray[ i ].xTaskNumber,
+                               pxTaskStatusArray[ i ].pcTaskName );
+            pxCIO->print( pcCliScratchBuffer );
+        }
+
+        vPortFree( pxTaskStatusArray );
+    }
+}
+
+/*
+ * Output format, one record per line:
+ *   #trace hz=<cycle counter frequency> events=<count> lost=<count>
+ *   T <task number> <task name>
+ *   E <cycles> <type> <task number> <arg> <value> <flags> [label]
+ *   #end
+ */
+static void prvDumpTrace( ConsoleIO_t * const pxCIO )
+{
+    TraceEvent_t xEvent;
+    uint32_t ulCount;
+
+    vTraceRingStop();
+
+    ulCount = ulTraceRingRead( 0, &xEvent );
+
+    ( void ) snprintf( pcCliScratchBuffer, CLI_OUTPUT_SCRATCH_BUF_LEN,
+                       "#trace hz=%lu events=%lu lost=%lu\r\n",
+                       ( unsigned long ) SystemCoreClock,
+                       ( unsigned long ) ulCount,
+                       ( unsigned long ) ulTraceRingLost() );
+    pxCIO->print( pcCliScratchBuffer );
+
+    prvPrintTaskNames( pxCIO );
+
+    for( uint32_t i = 0; i < ulCount; i++ )
+    {
+        ( void ) ulTraceRingRead( i, &xEvent );
+
+        ( void ) snprintf( pcCliScratchBuffer, CLI_OUTPUT_SCRATCH_BUF_LEN,
+                           "E %lu %s %u 0x%08lx %lu %u %s\r\n",
+                           ( unsigned long ) xEvent.ulTimestamp,
+                           prvEventTypeToString( xEvent.ucType ),
+                           ( unsigned int ) xEvent.usTask,
+                           ( unsigned long ) xEvent.ulArg,
+                           ( unsigned long ) xEvent.ulValue,
+                           ( unsigned int ) xEvent.ucFlags,
+                           prvEventLabel( &xEvent ) );
+        pxCIO->print( pcCliScratchBuffer );
+    }
+
+    pxCIO->print( "#end\r\n" );
+}
+
+static uint32_t prvParseClassMask( uint32_t ulArgc,
+                                   char * ppcArgv[] )
+{
+    uint32_t ulMask = 0;
+
+    for( uint32_t i = 2; i < ulArgc; i++ )
+    {
+        if( strcmp( "sched", ppcArgv[ i ] ) == 0 )
+        {
+            ulMask |= TRACE_CLASS_SCHED;
+        }
+        else if( strcmp( "queue", ppcArgv[ i ] ) == 0 )
+        {
+            ulMask |= TRACE_CLASS_QUEUE;
+        }
+        else if( strcmp( "isr", ppcArgv[ i ] ) == 0 )
+        {
+            ulMask |= TRACE_CLASS_ISR;
+        }
+        else if( strcmp( "user", ppcArgv[ i ] ) == 0 )
+        {
+            ulMask |= TRACE_CLASS_USER;
+        }
+        else if( strcmp( "all", ppcArgv[ i ] ) == 0 )
+        {
+            ulMask |= TRACE_CLASS_ALL;
+        }
+        else
+        {
+            /* Ignore unknown classes */
+        }
+    }
+
+    return ( ulMask == 0 ) ? TRACE_CLASS_ALL : ulMask;
+}
+
+static void prvTraceCommand( ConsoleIO_t * const pxCIO,
+                             uint32_t ulArgc,
+                             char * ppcArgv[] )
+{
+    if( ulArgc <= 1 )
+    {
+        pxCIO->print( ( ulTraceClassMask != 0 ) ? "Trace recording is running.\r\n" : "Trace recording is stopped.\r\n" );
+    }
+    else if( strcmp( "start", ppcArgv[ 1 ] ) == 0 )
+    {
+        vTraceRingStart( prvParseClassMask( ulArgc, ppcArgv ) );
+        pxCIO->print( "Trace recording started.\r\n" );
+    }
+    else if( strcmp( "stop", ppcArgv[ 1 ] ) == 0 )
+    {
+        vTraceRingStop();
+        pxCIO->print( "Trace recording stopped.\r\n" );
+    }
+    else if( strcmp( "dump", ppcArgv[ 1 ] ) == 0 )
+    {
+        prvDumpTrace( pxCIO );
+    }
+    else
+    {
+        pxCIO->print( "Error: Unknown argument.\r\n" );
+    }
+}
+
+#else /* TRACE_RING_ENABLED */
+
+static void prvTraceCommand( ConsoleIO_t * const pxCIO,
+                             uint32_t ulArgc,
+                             char * ppcArgv[] )
+{
+    ( void ) ulArgc;
+    ( void ) ppcArgv;
+
+    pxCIO->print( "Trace recording is disabled. Set TRACE_RING_ENABLED to 1 in trace_ring.h.\r\n" );
+}
+
+#endif /* TRACE_RING_ENABLED */
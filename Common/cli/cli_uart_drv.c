@@ -26,6 +26,7 @@
 #include "cli.h"
 #include "cli_prv.h"
 #include "logging.h"
+#include "trace_ring.h"
 #include "stream_buffer.h"
 #include "message_buffer.h"
 
@@ -33,9 +34,14 @@
 
 #define HW_FIFO_LEN    8
 
-extern volatile StreamBufferHandle_t xLogMBuf;
+static char ucLogLineTxBuff[ dlMAX_LOG_LINE_LENGTH ];
 
-static char ucLogLineTxBuff[ dlMAX_PRINT_STRING_LENGTH ];
+/* Double buffered DMA transmit */
+static uint8_t pucTxDmaBuffer[ 2 ][ CLI_UART_TX_DMA_LEN ];
+
+#ifdef LOGGING_DEFERRED_BINARY
+static char pcBinaryLogLine[ dlBINARY_MAX_LINE_LEN ];
+#endif
 static SemaphoreHandle_t xUartTxSem = NULL;
 
 static volatile BaseType_t xPartialCommand = pdFALSE;
@@ -69,6 +75,27 @@ static BaseType_t xExitFlag = pdFALSE;
 static TaskHandle_t xRxThreadHandle = NULL;
 static TaskHandle_t xTxThreadHandle = NULL;
 
+static DMA_HandleTypeDef xTxDmaHandle =
+{
+    .Instance                  = GPDMA1_Channel6,
+    .Init                      =
+    {
+        .Request               = GPDMA1_REQUEST_USART1_TX,
+        .BlkHWRequest          = DMA_BREQ_SINGLE_BURST,
+        .Direction             = DMA_MEMORY_TO_PERIPH,
+        .SrcInc                = DMA_SINC_INCREMENTED,
+        .DestInc               = DMA_DINC_FIXED,
+        .SrcDataWidth          = DMA_SRC_DATAWIDTH_BYTE,
+        .DestDataWidth         = DMA_DEST_DATAWIDTH_BYTE,
+        .Priority              = DMA_LOW_PRIORITY_LOW_WEIGHT,
+        .SrcBurstLength        = 1,
+        .DestBurstLength       = 1,
+        .TransferAllocatedPort = DMA_SRC_ALLOCATED_PORT0 | DMA_DEST_ALLOCATED_PORT1,
+        .TransferEventMode     = DMA_TCEM_BLOCK_TRANSFER,
+        .Mode                  = DMA_NORMAL,
+    },
+};
+
 static void vUart1MspInitCallback( UART_HandleTypeDef * huart )
 {
     HAL_StatusTypeDef xHalStatus = HAL_OK;
@@ -105,6 +132,23 @@ static void vUart1MspInitCallback( UART_HandleTypeDef * huart )
         GPIO_InitStruct.Alternate = GPIO_AF7_USART1;
         HAL_GPIO_Init( GPIOA, &GPIO_InitStruct );
 
+        /* GPDMA1 channel 6 -> USART1_TX */
+        __HAL_RCC_GPDMA1_CLK_ENABLE();
+
+        xHalStatus = HAL_DMA_Init( &xTxDmaHandle );
+        configASSERT( xHalStatus == HAL_OK );
+
+        if( xHalStatus == HAL_OK )
+        {
+            __HAL_LINKDMA( huart, hdmatx, xTxDmaHandle );
+
+            xHalStatus = HAL_DMA_ConfigChannelAttributes( &xTxDmaHandle, DMA_CHANNEL_NPRIV );
+            configASSERT( xHalStatus == HAL_OK );
+        }
+
+        HAL_NVIC_SetPriority( GPDMA1_Channel6_IRQn, 5, 1 );
+        HAL_NVIC_EnableIRQ( GPDMA1_Channel6_IRQn );
+
         HAL_NVIC_SetPriority( USART1_IRQn, 5, 1 );
         HAL_NVIC_EnableIRQ( USART1_IRQn );
     }
@@ -112,7 +156,16 @@ static void vUart1MspInitCallback( UART_HandleTypeDef * huart )
 
 void USART1_IRQHandler( void )
 {
+    vTraceIsrEnter( USART1_IRQn );
     HAL_UART_IRQHandler( &xConsoleHandle );
+    vTraceIsrExit( USART1_IRQn );
+}
+
+void GPDMA1_Channel6_IRQHandler( void )
+{
+    vTraceIsrEnter( GPDMA1_Channel6_IRQn );
+    HAL_DMA_IRQHandler( &xTxDmaHandle );
+    vTraceIsrExit( GPDMA1_Channel6_IRQn );
 }
 
 static void vUart1MspDeInitCallback( UART_HandleTypeDef * huart )
@@ -120,6 +173,10 @@ static void vUart1MspDeInitCallback( UART_HandleTypeDef * huart )
     if( huart == &xConsoleHandle )
     {
         HAL_NVIC_DisableIRQ( USART1_IRQn );
+        HAL_NVIC_DisableIRQ( GPDMA1_Channel6_IRQn );
+
+        ( void ) HAL_DMA_DeInit( &xTxDmaHandle );
+
         /* De-initialize GPIOs */
         HAL_GPIO_DeInit( GPIOA, GPIO_PIN_10 | GPIO_PIN_9 );
         __HAL_RCC_USART1_CLK_DISABLE();
@@ -331,84 +388,133 @@ static void txCompleteCallback( UART_HandleTypeDef * pxUartHandle )
 }
 
 
-/* Uart transmit thread */
-static void vTxThread( void * pvParameters )
+/* Move one pending log line into the tx stream. Returns pdTRUE if a line was queued. */
+static BaseType_t prvEnqueueLogLine( void )
 {
-    uint8_t pucTxBuffer[ CLI_UART_TX_WRITE_SZ_5MS ] = { 0 };
-    HAL_StatusTypeDef xHalStatus = HAL_OK;
+    BaseType_t xQueued = pdFALSE;
 
-    size_t xBytes = 0;
-
-    while( !xExitFlag )
+    /* Take the uart write semaphore (non-blocking) */
+    if( xSemaphoreTake( xUartTxSem, 0 ) == pdTRUE )
     {
-        /* Read up to 64 bytes
-         * wait up to BUFFER_READ_TIMEOUT before getting less than 64 */
-        xBytes = xStreamBufferReceive( xUartTxStream,
-                                       pucTxBuffer,
-                                       CLI_UART_TX_WRITE_SZ_5MS,
-                                       BUFFER_READ_TIMEOUT_MS );
-
-        /* If tx buffer is empty */
-        if( xBytes == 0 )
+        const char * pcLogLine = ucLogLineTxBuff;
+        size_t xBytes = xLoggingReceive( ucLogLineTxBuff, sizeof( ucLogLineTxBuff ) );
+
+#ifdef LOGGING_DEFERRED_BINARY
+        /* Binary records are formatted on the host by tools/log_decoder.py */
+        if( ( xBytes > 0 ) &&
+            ( ( uint8_t ) ucLogLineTxBuff[ 0 ] == dlBINARY_RECORD_TAG ) )
         {
-            /* Take the uart write semaphore (non-blocking) */
-            if( xSemaphoreTake( xUartTxSem, 0 ) == pdTRUE )
-            {
-                xBytes = xMessageBufferReceive( xLogMBuf, ucLogLineTxBuff, dlMAX_PRINT_STRING_LENGTH, 0 );
+            xBytes = xLoggingEncodeBinaryRecord( ( uint8_t * ) ucLogLineTxBuff, xBytes,
+                                                 pcBinaryLogLine, sizeof( pcBinaryLogLine ) );
+            pcLogLine = pcBinaryLogLine;
+        }
+#endif /* LOGGING_DEFERRED_BINARY */
 
-                /* All log messages should be less than the maximum length */
-                configASSERT( ( xBytes + CLI_OUTPUT_EOL_LEN + CLI_INPUT_LINE_LEN_MAX ) <= CLI_UART_TX_STREAM_LEN );
+        /* All log messages should be less than the maximum length */
+        configASSERT( ( xBytes + CLI_OUTPUT_EOL_LEN + CLI_INPUT_LINE_LEN_MAX ) <= CLI_UART_TX_STREAM_LEN );
 
-                /* If we got a log message to output, add it to the stream buffer to be processed */
-                if( xBytes > 0 )
-                {
-                    if( xPartialCommand == pdTRUE )
-                    {
-                        /* Overwrite existing line contents */
-                        ( void ) xStreamBufferSend( xUartTxStream, "\r\033[K", 4, 0 );
-                    }
-
-                    /* enqueue the log message */
-                    ( void ) xStreamBufferSend( xUartTxStream, ucLogLineTxBuff, xBytes, 0 );
+        /* If we got a log message to output, add it to the stream buffer to be processed */
+        if( xBytes > 0 )
+        {
+            if( xPartialCommand == pdTRUE )
+            {
+                /* Overwrite existing line contents */
+                ( void ) xStreamBufferSend( xUartTxStream, "\r\033[K", 4, 0 );
+            }
 
-                    /* Add CRLF */
-                    ( void ) xStreamBufferSend( xUartTxStream, CLI_OUTPUT_EOL, CLI_OUTPUT_EOL_LEN, 0 );
+            /* enqueue the log message */
+            ( void ) xStreamBufferSend( xUartTxStream, pcLogLine, xBytes, 0 );
 
-                    if( xPartialCommand == pdTRUE )
-                    {
-                        ( void ) xStreamBufferSend( xUartTxStream, CLI_PROMPT_STR, CLI_PROMPT_LEN, 0 );
+            /* Add CRLF */
+            ( void ) xStreamBufferSend( xUartTxStream, CLI_OUTPUT_EOL, CLI_OUTPUT_EOL_LEN, 0 );
 
-                        /* Restore current command line contents */
-                        if( ulInBufferIdx > 0 )
-                        {
-                            ( void ) xStreamBufferSend( xUartTxStream, pcInputBuffer, ulInBufferIdx, 0 );
-                        }
-                    }
+            if( xPartialCommand == pdTRUE )
+            {
+                ( void ) xStreamBufferSend( xUartTxStream, CLI_PROMPT_STR, CLI_PROMPT_LEN, 0 );
 
-                    ( void ) xSemaphoreGive( xUartTxSem );
-                    xBytes = xStreamBufferReceive( xUartTxStream,
-                                                   pucTxBuffer,
-                                                   CLI_UART_TX_WRITE_SZ_5MS,
-                                                   0 );
-                }
-                else
+                /* Restore current command line contents */
+                if( ulInBufferIdx > 0 )
                 {
-                    ( void ) xSemaphoreGive( xUartTxSem );
+                    ( void ) xStreamBufferSend( xUartTxStream, pcInputBuffer, ulInBufferIdx, 0 );
                 }
             }
+
+            xQueued = pdTRUE;
+        }
+
+        ( void ) xSemaphoreGive( xUartTxSem );
+    }
+
+    return xQueued;
+}
+
+/*
+ * Fill a DMA buffer from the tx stream, topping it up with pending log lines.
+ * Log lines are only queued once the stream has been drained so that they
+ * do not interleave with partially written console output.
+ */
+static size_t prvFillTxBuffer( uint8_t * pucBuffer,
+                               TickType_t xTimeout )
+{
+    size_t xBytes = xStreamBufferReceive( xUartTxStream,
+                                          pucBuffer,
+                                          CLI_UART_TX_DMA_LEN,
+                                          xTimeout );
+
+    while( ( xBytes < CLI_UART_TX_DMA_LEN ) &&
+           ( xStreamBufferIsEmpty( xUartTxStream ) == pdTRUE ) &&
+           ( prvEnqueueLogLine() == pdTRUE ) )
+    {
+        xBytes += xStreamBufferReceive( xUartTxStream,
+                                        &( pucBuffer[ xBytes ] ),
+                                        CLI_UART_TX_DMA_LEN - xBytes,
+                                        0 );
+    }
+
+    return xBytes;
+}
+
+/*
+ * Uart transmit thread
+ * Two buffers are used: while one is being sent by the DMA controller, the
+ * next one is filled from the tx stream.
+ */
+static void vTxThread( void * pvParameters )
+{
+    BaseType_t xTxInFlight = pdFALSE;
+    uint32_t ulBufferIdx = 0;
+
+    while( !xExitFlag )
+    {
+        size_t xBytes = 0;
+
+        if( xTxInFlight == pdFALSE )
+        {
+            /* Idle: wait up to BUFFER_READ_TIMEOUT for new data */
+            xBytes = prvFillTxBuffer( pucTxDmaBuffer[ ulBufferIdx ], BUFFER_READ_TIMEOUT_MS );
+        }
+        else
+        {
+            /* Prepare the next buffer while the previous one is sent */
+            xBytes = prvFillTxBuffer( pucTxDmaBuffer[ ulBufferIdx ], 0 );
+
+            /* Wait for completion event */
+            ( void ) ulTaskNotifyTakeIndexed( 1, pdTRUE, portMAX_DELAY );
+            xTxInFlight = pdFALSE;
         }
 
         /* Transmit if bytes available to transmit */
         if( xBytes > 0 )
         {
+            HAL_StatusTypeDef xHalStatus;
+
             ( void ) xTaskNotifyStateClearIndexed( NULL, 1 );
-            xHalStatus = HAL_UART_Transmit_IT( &xConsoleHandle, pucTxBuffer, ( uint16_t ) xBytes );
-/*			configASSERT( xHalStatus == HAL_OK ); */
+            xHalStatus = HAL_UART_Transmit_DMA( &xConsoleHandle, pucTxDmaBuffer[ ulBufferIdx ], ( uint16_t ) xBytes );
 
             if( xHalStatus == HAL_OK )
             {
-                /* Wait for completion event (should be within 1 or 2 ms) */
-                ( void ) ulTaskNotifyTakeIndexed( 1, pdTRUE, portMAX_DELAY );
+                xTxInFlight = pdTRUE;
+                ulBufferIdx ^= 1;
             }
         }
     }
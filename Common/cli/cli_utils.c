@@ -35,6 +35,7 @@
 
 #include "cli.h"
 #include "cli_prv.h"
+#include "task_stats.h"
 
 #include "core_cm33.h"
 
@@ -42,6 +43,10 @@ static void prvPSCommand( ConsoleIO_t * const pxConsoleIO,
                           uint32_t ulArgc,
                           char * ppcArgv[] );
 
+static void prvTopCommand( ConsoleIO_t * const pxCIO,
+                           uint32_t ulArgc,
+                           char * ppcArgv[] );
+
 static void vKillAllCommand( ConsoleIO_t * const pxCIO,
                              uint32_t ulArgc,
                              char * ppcArgv[] );
@@ -71,6 +76,16 @@ const CLI_Command_Definition_t xCommandDef_ps =
     prvPSCommand
 };
 
+const CLI_Command_Definition_t xCommandDef_top =
+{
+    "top",
+    "top\r\n"
+    "    top [ -d <ms> ] [ -n <count> ]\r\n"
+    "        Sample per task CPU usage, context switches and interrupt time over a window\r\n"
+    "        of <ms> milliseconds (default 1000), <count> times (default 1).\r\n\n",
+    prvTopCommand
+};
+
 const CLI_Command_Definition_t xCommandDef_kill =
 {
     "kill",
@@ -204,17 +219,19 @@ static void prvPSCommand( ConsoleIO_t * const pxCIO,
     }
     else
     {
-        unsigned long ulTotalRuntime = 0;
+        configRUN_TIME_COUNTER_TYPE xTotalRuntime = 0;
         uxNumTasks = uxTaskGetSystemState( pxTaskStatusArray,
                                            uxNumTasks,
-                                           &ulTotalRuntime );
-
-        ulTotalRuntime /= 100;
+                                           &xTotalRuntime );
 
-        snprintf( pcCliScratchBuffer, CLI_OUTPUT_SCRATCH_BUF_LEN, "Total Runtime: %lu\r\n", ulTotalRuntime );
+        /* The run time counter ticks at 1 MHz */
+        snprintf( pcCliScratchBuffer, CLI_OUTPUT_SCRATCH_BUF_LEN, "Total Runtime: %lu s\r\n", ( unsigned long ) ( xTotalRuntime / 1000000 ) );
 
         pxCIO->print( pcCliScratchBuffer );
 
+        /* Per task percentages */
+        xTotalRuntime /= 100;
+
         pxCIO->print( "+----------------------------------------------------------------------------------+\r\n" );
         pxCIO->print( "| Task |   State   |    Task Name     |___Priority__| %CPU | Stack | Stack | Stack |\r\n" );
         pxCIO->print( "|  ID  |           |                  | Base | Cur. |      | Alloc |  HWM  | Usage |\r\n" );
@@ -232,7 +249,7 @@ static void prvPSCommand( ConsoleIO_t * const pxCIO,
                       pxTaskStatusArray[ i ].pcTaskName,
                       pxTaskStatusArray[ i ].uxBasePriority,
                       pxTaskStatusArray[ i ].uxCurrentPriority,
-                      pxTaskStatusArray[ i ].ulRunTimeCounter / ulTotalRuntime,
+                      ( uint32_t ) ( pxTaskStatusArray[ i ].ulRunTimeCounter / xTotalRuntime ),
                       ulStackSize,
                       ( uint32_t ) pxTaskStatusArray[ i ].usStackHighWaterMark,
                       ucStackUsagePct );
@@ -244,6 +261,166 @@ static void prvPSCommand( ConsoleIO_t * const pxCIO,
     }
 }
 
+#define TOP_DEFAULT_WINDOW_MS    1000
+#define TOP_MAX_WINDOW_MS        60000
+#define TOP_MAX_COUNT            100
+
+static void prvPrintTopTasks( ConsoleIO_t * const pxCIO,
+                              const TaskStatsEntry_t * pxEntries,
+                              uint32_t ulNumEntries,
+                              const TaskStatsSummary_t * pxSummary )
+{
+    snprintf( pcCliScratchBuffer, CLI_OUTPUT_SCRATCH_BUF_LEN,
+              "Window: %lu ms, %lu run time counts\r\n",
+              pxSummary->ulWindowTicks * portTICK_PERIOD_MS,
+              pxSummary->ulWindowRunTime );
+    pxCIO->print( pcCliScratchBuffer );
+
+    pxCIO->print( "+-------------------------------------------------------------------------+\r\n" );
+    pxCIO->print( "| Task |    Task Name     |   State   | Prio |  %CPU  | Switches | Stack |\r\n" );
+    pxCIO->print( "|  ID  |                  |           |      |        |          |  HWM  |\r\n" );
+    pxCIO->print( "+-------------------------------------------------------------------------+\r\n" );
+    /* "| 1234 | AAAAAAAAAAAAAAAA | AAAAAAAAA |  00  | 100.0% | 00000000 | 00000 |" */
+
+    for( uint32_t i = 0; i < ulNumEntries; i++ )
+    {
+        uint32_t ulPermille = 0;
+
+        if( pxSummary->ulWindowRunTime > 0 )
+        {
+            ulPermille = ( uint32_t ) ( ( ( uint64_t ) pxEntries[ i ].ulRunTime * 1000 ) / pxSummary->ulWindowRunTime );
+        }
+
+        snprintf( pcCliScratchBuffer, CLI_OUTPUT_SCRATCH_BUF_LEN,
+                  "| %4lu | %-16.16s | %-9s |  %2u  | %3lu.%lu%% | %8lu | %5u |\r\n",
+                  pxEntries[ i ].ulTaskNumber,
+                  pxEntries[ i ].pcTaskName,
+                  pceTaskStateToString( ( eTaskState ) pxEntries[ i ].ucState ),
+                  ( unsigned int ) pxEntries[ i ].ucPriority,
+                  ulPermille / 10,
+                  ulPermille % 10,
+                  pxEntries[ i ].ulSwitches,
+                  ( unsigned int ) pxEntries[ i ].usStackHighWaterMark );
+        pxCIO->print( pcCliScratchBuffer );
+    }
+
+    pxCIO->print( "+-------------------------------------------------------------------------+\r\n" );
+}
+
+static void prvPrintTopIsrs( ConsoleIO_t * const pxCIO,
+                             const TaskStatsSummary_t * pxSummary )
+{
+    uint64_t ullWindowCycles = ( ( uint64_t ) pxSummary->ulCycleHz * pxSummary->ulWindowTicks ) / configTICK_RATE_HZ;
+
+    if( pxSummary->ulNumIsrs > 0 )
+    {
+        pxCIO->print( "| IRQ  |   Count    |  Time (us) |  %CPU  |\r\n" );
+        pxCIO->print( "+-----------------------------------------+\r\n" );
+
+        for( uint32_t i = 0; i < pxSummary->ulNumIsrs; i++ )
+        {
+            const TaskStatsIsrEntry_t * pxIsr = &( pxSummary->xIsrs[ i ] );
+            uint32_t ulMicros = 0;
+            uint32_t ulPermille = 0;
+
+            if( pxSummary->ulCycleHz > 0 )
+            {
+                ulMicros = ( uint32_t ) ( ( ( uint64_t ) pxIsr->ulCycles * 1000000 ) / pxSummary->ulCycleHz );
+            }
+
+            if( ullWindowCycles > 0 )
+            {
+                ulPermille = ( uint32_t ) ( ( ( uint64_t ) pxIsr->ulCycles * 1000 ) / ullWindowCycles );
+            }
+
+            snprintf( pcCliScratchBuffer, CLI_OUTPUT_SCRATCH_BUF_LEN,
+                      "| %4lu | %10lu | %10lu | %3lu.%lu%% |\r\n",
+                      pxIsr->ulIrqNumber,
+                      pxIsr->ulCount,
+                      ulMicros,
+                      ulPermille / 10,
+                      ulPermille % 10 );
+            pxCIO->print( pcCliScratchBuffer );
+        }
+
+        pxCIO->print( "+-----------------------------------------+\r\n" );
+    }
+}
+
+static void prvTopCommand( ConsoleIO_t * const pxCIO,
+                           uint32_t ulArgc,
+                           char * ppcArgv[] )
+{
+    uint32_t ulWindowMs = TOP_DEFAULT_WINDOW_MS;
+    uint32_t ulCount = 1;
+    BaseType_t xValid = pdTRUE;
+
+    for( uint32_t i = 1; ( i < ulArgc ) && ( xValid == pdTRUE ); i++ )
+    {
+        char * pcEnd = NULL;
+        unsigned long ulValue = 0;
+
+        if( ( i + 1 ) < ulArgc )
+        {
+            ulValue = strtoul( ppcArgv[ i + 1 ], &pcEnd, 10 );
+        }
+
+        if( ( pcEnd == NULL ) || ( *pcEnd != '\0' ) || ( ulValue == 0 ) )
+        {
+            xValid = pdFALSE;
+        }
+        else if( strcmp( "-d", ppcArgv[ i ] ) == 0 )
+        {
+            ulWindowMs = ( ulValue > TOP_MAX_WINDOW_MS ) ? TOP_MAX_WINDOW_MS : ulValue;
+            i++;
+        }
+        else if( strcmp( "-n", ppcArgv[ i ] ) == 0 )
+        {
+            ulCount = ( ulValue > TOP_MAX_COUNT ) ? TOP_MAX_COUNT : ulValue;
+            i++;
+        }
+        else
+        {
+            xValid = pdFALSE;
+        }
+    }
+
+    if( xValid == pdFALSE )
+    {
+        pxCIO->print( "Error: Invalid arguments. Usage: top [ -d <ms> ] [ -n <count> ]\r\n" );
+    }
+    else
+    {
+        uint32_t ulMaxEntries = uxTaskGetNumberOfTasks() + 4;
+        TaskStatsEntry_t * pxEntries = ( TaskStatsEntry_t * ) pvPortMalloc( sizeof( TaskStatsEntry_t ) * ulMaxEntries );
+        TaskStatsSummary_t * pxSummary = ( TaskStatsSummary_t * ) pvPortMalloc( sizeof( TaskStatsSummary_t ) );
+
+        if( ( pxEntries == NULL ) || ( pxSummary == NULL ) )
+        {
+            pxCIO->print( "Error: Not enough memory to complete the operation" );
+        }
+        else
+        {
+            for( uint32_t i = 0; i < ulCount; i++ )
+            {
+                uint32_t ulNumEntries = ulTaskStatsSample( ulWindowMs, pxEntries, ulMaxEntries, pxSummary );
+
+                if( ulNumEntries == 0 )
+                {
+                    pxCIO->print( "Error: Failed to sample the system state.\r\n" );
+                    break;
+                }
+
+                prvPrintTopTasks( pxCIO, pxEntries, ulNumEntries, pxSummary );
+                prvPrintTopIsrs( pxCIO, pxSummary );
+            }
+        }
+
+        vPortFree( pxEntries );
+        vPortFree( pxSummary );
+    }
+}
+
 typedef enum
 {
     SIGHUP = 1,
@@ -307,10 +484,9 @@ static TaskHandle_t xGetTaskHandleFromID( UBaseType_t uxTaskID )
 
     if( pxTaskStatusArray != NULL )
     {
-        unsigned long ulTotalRuntime = 0;
         uxNumTasks = uxTaskGetSystemState( pxTaskStatusArray,
                                            uxNumTasks,
-                                           &ulTotalRuntime );
+                                           NULL );
 
         for( uint32_t i = 0; i < uxNumTasks; i++ )
         {
@@ -26,6 +26,7 @@
  */
 
 /* Standard includes. */
+#include <assert.h>
 #include <stdio.h>
 #include <stdarg.h>
 #include <string.h>
@@ -34,12 +35,17 @@
 /* FreeRTOS includes. */
 #include "FreeRTOS.h"
 #include "task.h"
-#include "message_buffer.h"
+#include "atomic.h"
 #include "cli_prv.h"
 
 /* Project Includes */
 #include "logging.h"
 #include "hw_defs.h"
+#include "dwt_cycles.h"
+
+#ifdef LOGGING_DEFERRED_BINARY
+#include "mbedtls/base64.h"
+#endif
 
 /*-----------------------------------------------------------*/
 /* todo take into account maximum cli line length */
@@ -47,137 +53,714 @@
 #error "CLI_UART_TX_STREAM_LEN must be >= dlMAX_LOG_LINE_LENGTH"
 #endif
 
-volatile StreamBufferHandle_t xLogMBuf = NULL;
+#if ( dlSTAGING_TLS_INDEX >= configNUM_THREAD_LOCAL_STORAGE_POINTERS )
+#error "dlSTAGING_TLS_INDEX must be less than configNUM_THREAD_LOCAL_STORAGE_POINTERS"
+#endif
+
+#if ( LOG_MODULE_MAX > 8 )
+#error "Runtime log levels of at most 8 modules can be packed into a uint32_t"
+#endif
+
+#if ( ( dlSTAGING_BUFFER_LEN & ( dlSTAGING_BUFFER_LEN - 1 ) ) != 0 ) || \
+    ( ( dlLOGGING_STREAM_LENGTH & ( dlLOGGING_STREAM_LENGTH - 1 ) ) != 0 )
+#error "dlSTAGING_BUFFER_LEN and dlLOGGING_STREAM_LENGTH must be powers of two"
+#endif
+
+/*
+ * Log records are staged in single producer / single consumer rings which are
+ * drained by the console TX task. Each task that logs gets its own ring,
+ * allocated on its first log call and written without any lock. Interrupts,
+ * and tasks for which no ring could be allocated, share xSharedStaging which
+ * is written inside a critical section. The consumer merges all rings in the
+ * order in which the log calls were made (ulSequence).
+ *
+ * Every record starts on an 8 byte boundary with a LogRecordHeader_t. A record
+ * with dlRECORD_FLAG_PAD set marks unused space at the end of the ring.
+ *
+ * A task's ring is freed by the consumer once the task has been deleted and
+ * the ring is drained. Call statistics are kept per ring and only written by
+ * its producer, so recording them takes no lock either.
+ */
+typedef struct
+{
+    uint16_t usLength;
+    uint16_t usFlags;
+    uint32_t ulSequence;
+} LogRecordHeader_t;
+
+#define dlRECORD_FLAG_PAD          0x1
+#define dlRECORD_ALIGN( x )        ( ( ( x ) + 7UL ) & ~7UL )
+
+static_assert( dlSTAGING_BUFFER_LEN >= ( sizeof( LogRecordHeader_t ) + dlMAX_LOG_LINE_LENGTH ), "dlSTAGING_BUFFER_LEN must hold a full log line" );
+static_assert( dlLOGGING_STREAM_LENGTH >= ( sizeof( LogRecordHeader_t ) + dlMAX_LOG_LINE_LENGTH ), "dlLOGGING_STREAM_LENGTH must hold a full log line" );
+
+/* Counters of the log calls made through one staging buffer. Totals wrap, so
+ * they are reported as the difference to the values at the last reset. */
+typedef struct
+{
+    uint32_t ulCalls;
+    uint32_t ulDropped;
+    uint32_t ulMaxCycles;
+    uint32_t ulTotalCycles;
+    uint32_t ulMaxSuspendedCycles;
+    uint32_t ulTotalSuspendedCycles;
+} LogCallStats_t;
+
+typedef struct
+{
+    volatile uint32_t ulHead;                   /* Written by the producer only */
+    volatile uint32_t ulTail;                   /* Written by the consumer only */
+    volatile uint32_t ulDropped;                /* Written by the producer only */
+    uint32_t ulDroppedReported;                 /* Written by the consumer only */
+    volatile BaseType_t xOwnerDeleted;          /* Set when the producing task is deleted */
+    uint32_t ulSize;
+    uint8_t * pucData;
+    char pcOwnerName[ configMAX_TASK_NAME_LEN ];
+    LogCallStats_t xStats[ LOG_PATH_MAX ];      /* Written by the producer only */
+    LogCallStats_t xStatsBase[ LOG_PATH_MAX ];  /* Totals at the last vLoggingResetStats */
+} LogStagingBuffer_t;
+
+/* Marks a task whose staging buffer could not be allocated */
+#define dlSTAGING_UNAVAILABLE    ( ( void * ) 1 )
+
+static uint8_t pucSharedStagingData[ dlLOGGING_STREAM_LENGTH ] __attribute__( ( aligned( 8 ) ) );
+
+static LogStagingBuffer_t xSharedStaging =
+{
+    .ulSize      = dlLOGGING_STREAM_LENGTH,
+    .pucData     = pucSharedStagingData,
+    .pcOwnerName = "shared",
+};
+
+static LogStagingBuffer_t * pxStagingBuffers[ dlSTAGING_MAX_TASKS ] = { NULL };
+static volatile uint32_t ulNumStagingBuffers = 0;
+
+static volatile uint32_t ulLogSequence = 0;
 
 UART_HandleTypeDef * pxEarlyUart = NULL;
 
+/* Used before the scheduler starts and by tasks without a staging buffer */
 static char pcPrintBuff[ dlMAX_LOG_LINE_LENGTH ];
 
-/* Should only be called during an assert with the scheduler suspended. */
-void vDyingGasp( void )
+/* Used from interrupt context, with interrupts masked */
+static char pcIsrPrintBuff[ dlISR_MAX_LOG_LINE_LENGTH ];
+
+/* Holds the synthetic "messages dropped" line built by the consumer */
+static char pcDropNotice[ 64 ];
+
+/* Calls made through staging buffers which have since been freed */
+static LoggingStats_t xRetiredStats[ LOG_PATH_MAX ] = { 0 };
+
+/* Start with every module at LOG_DEBUG so that only the compile time
+ * LOG_LEVEL applies until the stored levels are loaded. */
+uint8_t pucLogModuleLevels[ LOG_MODULE_MAX ] = { [ 0 ... ( LOG_MODULE_MAX - 1 ) ] = LOG_DEBUG };
+
+/* Must be called by the buffer's producer. The shared buffer has several
+ * producers, so its counters are updated with interrupts masked. */
+static void prvRecordStats( LogStagingBuffer_t * pxBuffer,
+                            LogPath_t xPath,
+                            uint32_t ulCycles,
+                            uint32_t ulSuspendedCycles,
+                            BaseType_t xDropped )
 {
-    BaseType_t xNumBytes = 0;
+    UBaseType_t uxSavedInterruptStatus = 0;
+    LogCallStats_t * pxStats = &( pxBuffer->xStats[ xPath ] );
 
-    pxEarlyUart = vInitUartEarly();
+    if( pxBuffer == &xSharedStaging )
+    {
+        uxSavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+    }
 
-    do
+    pxStats->ulCalls++;
+    pxStats->ulTotalCycles += ulCycles;
+    pxStats->ulTotalSuspendedCycles += ulSuspendedCycles;
+
+    if( ulCycles > pxStats->ulMaxCycles )
     {
-        xNumBytes = xMessageBufferReceiveFromISR( xLogMBuf, pcPrintBuff, dlMAX_PRINT_STRING_LENGTH, 0 );
-        ( void ) HAL_UART_Transmit( pxEarlyUart, ( uint8_t * ) pcPrintBuff, xNumBytes, 10 * 1000 );
-        ( void ) HAL_UART_Transmit( pxEarlyUart, ( uint8_t * ) "\r\n", 2, 10 * 1000 );
+        pxStats->ulMaxCycles = ulCycles;
     }
-    while( xNumBytes != 0 );
 
-    HAL_GPIO_WritePin( LED_RED_GPIO_Port, LED_GREEN_Pin, GPIO_PIN_SET );
-    HAL_GPIO_WritePin( LED_RED_GPIO_Port, LED_RED_Pin, GPIO_PIN_RESET );
+    if( ulSuspendedCycles > pxStats->ulMaxSuspendedCycles )
+    {
+        pxStats->ulMaxSuspendedCycles = ulSuspendedCycles;
+    }
+
+    if( xDropped == pdTRUE )
+    {
+        pxStats->ulDropped++;
+    }
+
+    if( pxBuffer == &xSharedStaging )
+    {
+        taskEXIT_CRITICAL_FROM_ISR( uxSavedInterruptStatus );
+    }
 }
 
-/*
- * Blocking write function for early printing
- * PRE: must be called when scheduler is not running.
- */
-static void vSendLogMessageEarly( const char * buffer,
-                                  unsigned int count )
+/* Must be called with interrupts masked */
+static void prvAddStats( LoggingStats_t pxStats[ LOG_PATH_MAX ],
+                         const LogStagingBuffer_t * pxBuffer )
 {
-    configASSERT( xTaskGetSchedulerState() != taskSCHEDULER_RUNNING );
+    for( uint32_t i = 0; i < LOG_PATH_MAX; i++ )
+    {
+        const LogCallStats_t * pxCurrent = &( pxBuffer->xStats[ i ] );
+        const LogCallStats_t * pxBase = &( pxBuffer->xStatsBase[ i ] );
 
-#ifdef LOGGING_OUTPUT_ITM
-    uint32_t i = 0;
+        pxStats[ i ].ulCalls += pxCurrent->ulCalls - pxBase->ulCalls;
+        pxStats[ i ].ulDropped += pxCurrent->ulDropped - pxBase->ulDropped;
+        pxStats[ i ].ullTotalCycles += pxCurrent->ulTotalCycles - pxBase->ulTotalCycles;
+        pxStats[ i ].ullTotalSuspendedCycles += pxCurrent->ulTotalSuspendedCycles - pxBase->ulTotalSuspendedCycles;
 
-    for( unsigned int i = 0; i < len; i++ )
+        if( pxCurrent->ulMaxCycles > pxStats[ i ].ulMaxCycles )
+        {
+            pxStats[ i ].ulMaxCycles = pxCurrent->ulMaxCycles;
+        }
+
+        if( pxCurrent->ulMaxSuspendedCycles > pxStats[ i ].ulMaxSuspendedCycles )
+        {
+            pxStats[ i ].ulMaxSuspendedCycles = pxCurrent->ulMaxSuspendedCycles;
+        }
+    }
+}
+
+void vLoggingGetStats( LoggingStats_t pxStats[ LOG_PATH_MAX ] )
+{
+    UBaseType_t uxSavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+
+    ( void ) memcpy( pxStats, xRetiredStats, sizeof( xRetiredStats ) );
+
+    prvAddStats( pxStats, &xSharedStaging );
+
+    for( uint32_t i = 0; i < ulNumStagingBuffers; i++ )
     {
-        ( void ) ITM_SendChar( lineOutBuf[ i ] );
+        prvAddStats( pxStats, pxStagingBuffers[ i ] );
     }
-#endif
 
+    taskEXIT_CRITICAL_FROM_ISR( uxSavedInterruptStatus );
+}
 
-#ifdef LOGGING_OUTPUT_UART
-    /* blocking write to UART */
-    ( void ) HAL_UART_Transmit( pxEarlyUart, ( uint8_t * ) buffer, count, 100000 );
-    ( void ) HAL_UART_Transmit( pxEarlyUart, ( uint8_t * ) "\r\n", 2, 100000 );
-#endif
+static void prvResetStats( LogStagingBuffer_t * pxBuffer )
+{
+    ( void ) memcpy( pxBuffer->xStatsBase, pxBuffer->xStats, sizeof( pxBuffer->xStats ) );
+
+    /* A producer racing with this may keep its previous maximum */
+    for( uint32_t i = 0; i < LOG_PATH_MAX; i++ )
+    {
+        pxBuffer->xStats[ i ].ulMaxCycles = 0;
+        pxBuffer->xStats[ i ].ulMaxSuspendedCycles = 0;
+    }
 }
 
-void vInitLoggingEarly( void )
+void vLoggingResetStats( void )
 {
-    pxEarlyUart = vInitUartEarly();
-    vSendLogMessageEarly( "\r\n", 2 );
+    UBaseType_t uxSavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+
+    ( void ) memset( xRetiredStats, 0, sizeof( xRetiredStats ) );
+
+    prvResetStats( &xSharedStaging );
+
+    for( uint32_t i = 0; i < ulNumStagingBuffers; i++ )
+    {
+        prvResetStats( pxStagingBuffers[ i ] );
+    }
+
+    taskEXIT_CRITICAL_FROM_ISR( uxSavedInterruptStatus );
 }
 
-static void vSendLogMessage( const char * buffer,
-                             unsigned int count )
+/*-----------------------------------------------------------*/
+
+void vLoggingSetModuleLevel( uint32_t ulModule,
+                             uint8_t ucLevel )
 {
-    if( xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED )
+    if( ulModule < LOG_MODULE_MAX )
     {
-        vSendLogMessageEarly( buffer, count );
+        pucLogModuleLevels[ ulModule ] = ( ucLevel > LOG_DEBUG ) ? LOG_DEBUG : ucLevel;
     }
-    else if( xPortIsInsideInterrupt() == pdTRUE )
+}
+
+void vLoggingSetModuleLevels( uint32_t ulPackedLevels )
+{
+    for( uint32_t i = 0; i < LOG_MODULE_MAX; i++ )
+    {
+        vLoggingSetModuleLevel( i, ( uint8_t ) ( ( ulPackedLevels >> ( 4 * i ) ) & 0xF ) );
+    }
+}
+
+uint32_t ulLoggingGetModuleLevels( void )
+{
+    uint32_t ulPackedLevels = 0;
+
+    for( uint32_t i = 0; i < LOG_MODULE_MAX; i++ )
     {
-        UBaseType_t uxContext;
-        BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-        configASSERT( xLogMBuf != NULL );
+        ulPackedLevels |= ( ( uint32_t ) pucLogModuleLevels[ i ] & 0xF ) << ( 4 * i );
+    }
+
+    return ulPackedLevels;
+}
+
+/*-----------------------------------------------------------*/
 
-        /* Enter critical section to preserve ordering of log messages */
-        uxContext = taskENTER_CRITICAL_FROM_ISR();
-        size_t xSpaceAvailable = xMessageBufferSpaceAvailable( xLogMBuf );
+static LogStagingBuffer_t * prvGetStagingBuffer( uint32_t ulIndex )
+{
+    LogStagingBuffer_t * pxBuffer = NULL;
+
+    if( ulIndex == 0 )
+    {
+        pxBuffer = &xSharedStaging;
+    }
+    else if( ulIndex <= ulNumStagingBuffers )
+    {
+        pxBuffer = pxStagingBuffers[ ulIndex - 1 ];
+    }
+    else
+    {
+        /* Past the last buffer */
+    }
+
+    return pxBuffer;
+}
+
+static uint32_t prvGetStagingCount( void )
+{
+    return ulNumStagingBuffers + 1;
+}
+
+uint32_t ulLoggingGetStagingInfo( uint32_t ulIndex,
+                                  LogStagingInfo_t * pxInfo )
+{
+    uint32_t ulResult = 0;
+    LogStagingBuffer_t * pxBuffer;
 
-        if( xSpaceAvailable > sizeof( size_t ) )
+    /* The consumer may free a buffer at any time, so copy it out while the list is stable */
+    taskENTER_CRITICAL();
+
+    pxBuffer = prvGetStagingBuffer( ulIndex );
+
+    if( pxBuffer != NULL )
+    {
+        ( void ) strncpy( pxInfo->pcOwnerName, pxBuffer->pcOwnerName, dlSTAGING_NAME_LEN - 1 );
+        pxInfo->pcOwnerName[ dlSTAGING_NAME_LEN - 1 ] = '\0';
+        pxInfo->ulSize = pxBuffer->ulSize;
+        pxInfo->ulUsed = pxBuffer->ulHead - pxBuffer->ulTail;
+        pxInfo->ulDropped = pxBuffer->ulDropped;
+        ulResult = 1;
+    }
+
+    taskEXIT_CRITICAL();
+
+    return ulResult;
+}
+
+/* Expanded by traceTASK_DELETE inside vTaskDelete, with interrupts masked */
+void vLoggingTaskDeleted( void * pvTask )
+{
+    LogStagingBuffer_t * pxBuffer = pvTaskGetThreadLocalStoragePointer( ( TaskHandle_t ) pvTask, dlSTAGING_TLS_INDEX );
+
+    if( ( pxBuffer != NULL ) &&
+        ( pxBuffer != dlSTAGING_UNAVAILABLE ) )
+    {
+        pxBuffer->xOwnerDeleted = pdTRUE;
+    }
+}
+
+/*
+ * Free the staging buffers of deleted tasks once everything they hold has
+ * been output. Only called by the consumer.
+ */
+static void prvReapStagingBuffers( void )
+{
+    uint32_t i = 0;
+
+    while( i < ulNumStagingBuffers )
+    {
+        LogStagingBuffer_t * pxBuffer = pxStagingBuffers[ i ];
+        BaseType_t xRemoved = pdFALSE;
+
+        if( ( pxBuffer->xOwnerDeleted == pdTRUE ) &&
+            ( pxBuffer->ulTail == pxBuffer->ulHead ) &&
+            ( pxBuffer->ulDroppedReported == pxBuffer->ulDropped ) )
         {
-            xSpaceAvailable -= sizeof( size_t );
+            taskENTER_CRITICAL();
+
+            prvAddStats( xRetiredStats, pxBuffer );
+
+            /* Order does not matter since records are merged by sequence number */
+            ulNumStagingBuffers--;
+            pxStagingBuffers[ i ] = pxStagingBuffers[ ulNumStagingBuffers ];
+            pxStagingBuffers[ ulNumStagingBuffers ] = NULL;
+            xRemoved = pdTRUE;
+
+            taskEXIT_CRITICAL();
+        }
 
-            if( xSpaceAvailable < ( count + sizeof( size_t ) ) )
+        if( xRemoved == pdTRUE )
+        {
+            /* The buffer moved into slot i is checked next */
+            vPortFree( pxBuffer );
+        }
+        else
+        {
+            i++;
+        }
+    }
+}
+
+/* Return the calling task's staging buffer, allocating it on first use.
+ * Buffers are freed by prvReapStagingBuffers after the task is deleted. */
+static LogStagingBuffer_t * prvGetTaskStagingBuffer( void )
+{
+    LogStagingBuffer_t * pxBuffer = pvTaskGetThreadLocalStoragePointer( NULL, dlSTAGING_TLS_INDEX );
+
+    if( pxBuffer == NULL )
+    {
+        /* Mark first so that logging from within pvPortMalloc (e.g. the
+         * malloc failed hook) does not recurse into here. */
+        vTaskSetThreadLocalStoragePointer( NULL, dlSTAGING_TLS_INDEX, dlSTAGING_UNAVAILABLE );
+
+        pxBuffer = pvPortMalloc( sizeof( LogStagingBuffer_t ) + dlSTAGING_BUFFER_LEN );
+
+        if( pxBuffer != NULL )
+        {
+            ( void ) memset( pxBuffer, 0, sizeof( LogStagingBuffer_t ) );
+            pxBuffer->ulSize = dlSTAGING_BUFFER_LEN;
+            pxBuffer->pucData = ( uint8_t * ) &( pxBuffer[ 1 ] );
+            ( void ) strncpy( pxBuffer->pcOwnerName, pcTaskGetName( NULL ), configMAX_TASK_NAME_LEN - 1 );
+
+            taskENTER_CRITICAL();
+
+            if( ulNumStagingBuffers < dlSTAGING_MAX_TASKS )
             {
-                ( void ) xMessageBufferSendFromISR( xLogMBuf, buffer, xSpaceAvailable - sizeof( size_t ), &xHigherPriorityTaskWoken );
+                pxStagingBuffers[ ulNumStagingBuffers ] = pxBuffer;
+                __DMB();
+                ulNumStagingBuffers++;
             }
             else
             {
-                ( void ) xMessageBufferSendFromISR( xLogMBuf, buffer, count, &xHigherPriorityTaskWoken );
+                vPortFree( pxBuffer );
+                pxBuffer = NULL;
             }
+
+            taskEXIT_CRITICAL();
         }
 
-        taskEXIT_CRITICAL_FROM_ISR( uxContext );
+        if( pxBuffer != NULL )
+        {
+            vTaskSetThreadLocalStoragePointer( NULL, dlSTAGING_TLS_INDEX, pxBuffer );
+        }
+    }
+    else if( pxBuffer == dlSTAGING_UNAVAILABLE )
+    {
+        pxBuffer = NULL;
+    }
+    else
+    {
+        /* Already allocated */
+    }
+
+    return pxBuffer;
+}
+
+/*
+ * Reserve contiguous space for a record payload of at least xMinLen bytes.
+ * Returns a pointer to the payload area, with the usable length in *pxMaxLen,
+ * or NULL if the buffer does not have xMinLen bytes free. The end of the ring
+ * is only skipped when it is too short for xMinLen.
+ * Must only be called by the buffer's producer.
+ */
+static uint8_t * prvStagingReserve( LogStagingBuffer_t * pxBuffer,
+                                    size_t xMinLen,
+                                    size_t * pxMaxLen )
+{
+    uint8_t * pucPayload = NULL;
+    uint32_t ulHead = pxBuffer->ulHead;
+    uint32_t ulFree = pxBuffer->ulSize - ( ulHead - pxBuffer->ulTail );
+    uint32_t ulOffset = ulHead & ( pxBuffer->ulSize - 1 );
+    uint32_t ulContiguous = pxBuffer->ulSize - ulOffset;
+    uint32_t ulNeeded = sizeof( LogRecordHeader_t ) + dlRECORD_ALIGN( xMinLen );
 
-        portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
+    /* Records are not split, so skip the end of the ring if it is too short */
+    if( ( ulContiguous < ulNeeded ) &&
+        ( ulFree >= ( ulContiguous + ulNeeded ) ) )
+    {
+        LogRecordHeader_t * pxPad = ( LogRecordHeader_t * ) &( pxBuffer->pucData[ ulOffset ] );
+
+        pxPad->usLength = 0;
+        pxPad->usFlags = dlRECORD_FLAG_PAD;
+        __DMB();
+        ulHead += ulContiguous;
+        pxBuffer->ulHead = ulHead;
+
+        ulFree -= ulContiguous;
+        ulOffset = 0;
+        ulContiguous = pxBuffer->ulSize;
+    }
+
+    if( ulContiguous > ulFree )
+    {
+        ulContiguous = ulFree;
+    }
+
+    if( ulContiguous >= ulNeeded )
+    {
+        *pxMaxLen = ulContiguous - sizeof( LogRecordHeader_t );
+        pucPayload = &( pxBuffer->pucData[ ulOffset + sizeof( LogRecordHeader_t ) ] );
+    }
+
+    return pucPayload;
+}
+
+/* Publish a record previously reserved with prvStagingReserve. */
+static void prvStagingCommit( LogStagingBuffer_t * pxBuffer,
+                              size_t xLen,
+                              uint32_t ulSequence )
+{
+    uint32_t ulHead = pxBuffer->ulHead;
+    LogRecordHeader_t * pxHeader = ( LogRecordHeader_t * ) &( pxBuffer->pucData[ ulHead & ( pxBuffer->ulSize - 1 ) ] );
+
+    pxHeader->usLength = ( uint16_t ) xLen;
+    pxHeader->usFlags = 0;
+    pxHeader->ulSequence = ulSequence;
+
+    /* The record must be visible before the consumer sees the new head */
+    __DMB();
+    pxBuffer->ulHead = ulHead + sizeof( LogRecordHeader_t ) + dlRECORD_ALIGN( xLen );
+}
+
+static BaseType_t prvStagingWrite( LogStagingBuffer_t * pxBuffer,
+                                   const void * pvRecord,
+                                   size_t xLen,
+                                   uint32_t ulSequence )
+{
+    BaseType_t xResult = pdFALSE;
+    size_t xMaxLen = 0;
+    uint8_t * pucPayload = prvStagingReserve( pxBuffer, xLen, &xMaxLen );
+
+    if( pucPayload != NULL )
+    {
+        ( void ) memcpy( pucPayload, pvRecord, xLen );
+        prvStagingCommit( pxBuffer, xLen, ulSequence );
+        xResult = pdTRUE;
     }
     else
     {
-        configASSERT( xLogMBuf != NULL );
-        size_t xSpaceAvailable = xMessageBufferSpaceAvailable( xLogMBuf );
+        pxBuffer->ulDropped++;
+    }
+
+    return xResult;
+}
+
+/* Write into the shared buffer from a task without a buffer of its own or
+ * from an interrupt. */
+static BaseType_t prvSharedStagingWrite( const void * pvRecord,
+                                         size_t xLen,
+                                         uint32_t ulSequence )
+{
+    BaseType_t xResult;
+    UBaseType_t uxSavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+
+    xResult = prvStagingWrite( &xSharedStaging, pvRecord, xLen, ulSequence );
+
+    taskEXIT_CRITICAL_FROM_ISR( uxSavedInterruptStatus );
+
+    return xResult;
+}
+
+/* Return the oldest record in a staging buffer, skipping padding. */
+static LogRecordHeader_t * prvStagingPeek( LogStagingBuffer_t * pxBuffer )
+{
+    LogRecordHeader_t * pxHeader = NULL;
+    uint32_t ulTail = pxBuffer->ulTail;
+
+    while( ( pxHeader == NULL ) &&
+           ( ulTail != pxBuffer->ulHead ) )
+    {
+        __DMB();
+        pxHeader = ( LogRecordHeader_t * ) &( pxBuffer->pucData[ ulTail & ( pxBuffer->ulSize - 1 ) ] );
+
+        if( ( pxHeader->usFlags & dlRECORD_FLAG_PAD ) != 0 )
+        {
+            ulTail += pxBuffer->ulSize - ( ulTail & ( pxBuffer->ulSize - 1 ) );
+            pxBuffer->ulTail = ulTail;
+            pxHeader = NULL;
+        }
+    }
+
+    return pxHeader;
+}
+
+static void prvStagingConsume( LogStagingBuffer_t * pxBuffer,
+                               const LogRecordHeader_t * pxHeader )
+{
+    uint32_t ulLen = sizeof( LogRecordHeader_t ) + dlRECORD_ALIGN( pxHeader->usLength );
+
+    /* Finish reading the record before handing the space back */
+    __DMB();
+    pxBuffer->ulTail += ulLen;
+}
+
+/*
+ * Copy the oldest pending log record from any staging buffer into pcBuffer.
+ * Called by the console TX task (and by vDyingGasp). Returns the record
+ * length or 0 if there is nothing to output.
+ */
+size_t xLoggingReceive( char * pcBuffer,
+                        size_t xBufferLen )
+{
+    size_t xLen = 0;
+    uint32_t ulNumBuffers = prvGetStagingCount();
+    LogStagingBuffer_t * pxOldestBuffer = NULL;
+    LogRecordHeader_t * pxOldestHeader = NULL;
+
+    for( uint32_t i = 0; ( i < ulNumBuffers ) && ( xLen == 0 ); i++ )
+    {
+        LogStagingBuffer_t * pxBuffer = prvGetStagingBuffer( i );
+        uint32_t ulDropped = pxBuffer->ulDropped;
 
-        if( xSpaceAvailable > sizeof( size_t ) )
+        /* Report drops as soon as they are noticed */
+        if( ulDropped != pxBuffer->ulDroppedReported )
         {
-            xSpaceAvailable -= sizeof( size_t );
+            int lLen = snprintf( pcDropNotice, sizeof( pcDropNotice ),
+                                 "<WRN> %8lu [%-10.10s] %lu log messages dropped",
+                                 ( ( unsigned long ) xTaskGetTickCount() / portTICK_PERIOD_MS ) & 0xFFFFFF,
+                                 pxBuffer->pcOwnerName,
+                                 ( unsigned long ) ( ulDropped - pxBuffer->ulDroppedReported ) );
 
-            if( xSpaceAvailable < count )
+            pxBuffer->ulDroppedReported = ulDropped;
+
+            if( lLen > 0 )
             {
-                ( void ) xMessageBufferSend( xLogMBuf, buffer, xSpaceAvailable, 0 );
+                xLen = ( ( size_t ) lLen < xBufferLen ) ? ( size_t ) lLen : xBufferLen;
+                xLen = ( xLen < sizeof( pcDropNotice ) ) ? xLen : ( sizeof( pcDropNotice ) - 1 );
+                ( void ) memcpy( pcBuffer, pcDropNotice, xLen );
             }
-            else
+        }
+        else
+        {
+            LogRecordHeader_t * pxHeader = prvStagingPeek( pxBuffer );
+
+            if( ( pxHeader != NULL ) &&
+                ( ( pxOldestHeader == NULL ) ||
+                  ( ( int32_t ) ( pxHeader->ulSequence - pxOldestHeader->ulSequence ) < 0 ) ) )
             {
-                ( void ) xMessageBufferSend( xLogMBuf, buffer, count, 0 );
+                pxOldestHeader = pxHeader;
+                pxOldestBuffer = pxBuffer;
             }
         }
     }
+
+    if( ( xLen == 0 ) &&
+        ( pxOldestHeader != NULL ) )
+    {
+        xLen = pxOldestHeader->usLength;
+
+        if( xLen > xBufferLen )
+        {
+            xLen = xBufferLen;
+        }
+
+        ( void ) memcpy( pcBuffer, &( pxOldestHeader[ 1 ] ), xLen );
+        prvStagingConsume( pxOldestBuffer, pxOldestHeader );
+    }
+
+    /* Everything has been output, so release buffers of deleted tasks.
+     * Not done from vDyingGasp, which runs with the scheduler suspended. */
+    if( ( xLen == 0 ) &&
+        ( xTaskGetSchedulerState() == taskSCHEDULER_RUNNING ) )
+    {
+        prvReapStagingBuffers();
+    }
+
+    return xLen;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Should only be called during an assert with the scheduler suspended. */
+void vDyingGasp( void )
+{
+    size_t xNumBytes = 0;
+
+    pxEarlyUart = vInitUartEarly();
+
+    do
+    {
+        xNumBytes = xLoggingReceive( pcPrintBuff, dlMAX_LOG_LINE_LENGTH );
+
+#ifdef LOGGING_DEFERRED_BINARY
+        if( ( xNumBytes > 0 ) &&
+            ( ( uint8_t ) pcPrintBuff[ 0 ] == dlBINARY_RECORD_TAG ) )
+        {
+            char pcLine[ dlBINARY_MAX_LINE_LEN ];
+            size_t xLineLen = xLoggingEncodeBinaryRecord( ( uint8_t * ) pcPrintBuff, xNumBytes, pcLine, sizeof( pcLine ) );
+
+            ( void ) HAL_UART_Transmit( pxEarlyUart, ( uint8_t * ) pcLine, xLineLen, 10 * 1000 );
+        }
+        else
+#endif /* LOGGING_DEFERRED_BINARY */
+        {
+            ( void ) HAL_UART_Transmit( pxEarlyUart, ( uint8_t * ) pcPrintBuff, xNumBytes, 10 * 1000 );
+        }
+
+        ( void ) HAL_UART_Transmit( pxEarlyUart, ( uint8_t * ) "\r\n", 2, 10 * 1000 );
+    }
+    while( xNumBytes != 0 );
+
+    HAL_GPIO_WritePin( LED_RED_GPIO_Port, LED_GREEN_Pin, GPIO_PIN_SET );
+    HAL_GPIO_WritePin( LED_RED_GPIO_Port, LED_RED_Pin, GPIO_PIN_RESET );
+}
+
+/*
+ * Blocking write function for early printing
+ * PRE: must be called when scheduler is not running.
+ */
+static void vSendLogMessageEarly( const char * buffer,
+                                  unsigned int count )
+{
+    configASSERT( xTaskGetSchedulerState() != taskSCHEDULER_RUNNING );
+
+#ifdef LOGGING_OUTPUT_ITM
+    uint32_t i = 0;
+
+    for( unsigned int i = 0; i < len; i++ )
+    {
+        ( void ) ITM_SendChar( lineOutBuf[ i ] );
+    }
+#endif
+
+
+#ifdef LOGGING_OUTPUT_UART
+    /* blocking write to UART */
+    ( void ) HAL_UART_Transmit( pxEarlyUart, ( uint8_t * ) buffer, count, 100000 );
+    ( void ) HAL_UART_Transmit( pxEarlyUart, ( uint8_t * ) "\r\n", 2, 100000 );
+#endif
+}
+
+void vInitLoggingEarly( void )
+{
+    pxEarlyUart = vInitUartEarly();
+    vSendLogMessageEarly( "\r\n", 2 );
 }
 
 void vLoggingInit( void )
 {
-    xLogMBuf = xMessageBufferCreate( dlLOGGING_STREAM_LENGTH );
+    /* Enable the cycle counter used for the logging cost statistics */
+    vDwtCycleCounterEnable();
 }
 
 /*-----------------------------------------------------------*/
 
-void vLoggingPrintf( const char * const pcLogLevel,
-                     const char * const pcFileName,
-                     const unsigned long ulLineNumber,
-                     const char * const pcFormat,
-                     ... )
+/* Format a complete log line (prefix, message and trailer) into pcBuffer.
+ * Returns the length of the line, not including a terminator. */
+static size_t prvFormatLogLine( char * pcBuffer,
+                                size_t xBufferLen,
+                                const char * const pcLogLevel,
+                                const char * const pcFileName,
+                                const unsigned long ulLineNumber,
+                                const char * const pcFormat,
+                                va_list args )
 {
     uint32_t ulLenTotal = 0;
     int32_t lLenPart = -1;
-    va_list args;
     const char * pcTaskName = NULL;
-    BaseType_t xSchedulerWasSuspended = pdFALSE;
 
     /* Additional info to place at the start of the log line */
     if( xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED )
@@ -189,16 +772,9 @@ void vLoggingPrintf( const char * const pcLogLevel,
         pcTaskName = "None";
     }
 
-    if( xTaskGetSchedulerState() == taskSCHEDULER_RUNNING )
-    {
-        xSchedulerWasSuspended = pdTRUE;
-        /* Suspend the scheduler to access pcPrintBuff */
-        vTaskSuspendAll();
-    }
-
-    pcPrintBuff[ 0 ] = '\0';
-    lLenPart = snprintf( pcPrintBuff,
-                         dlMAX_PRINT_STRING_LENGTH,
+    pcBuffer[ 0 ] = '\0';
+    lLenPart = snprintf( pcBuffer,
+                         xBufferLen,
                          "<%-3.3s> %8lu [%-10.10s] ",
                          pcLogLevel,
                          ( ( unsigned long ) xTaskGetTickCount() / portTICK_PERIOD_MS ) & 0xFFFFFF,
@@ -206,78 +782,512 @@ void vLoggingPrintf( const char * const pcLogLevel,
 
     configASSERT( lLenPart > 0 );
 
-    if( lLenPart < dlMAX_PRINT_STRING_LENGTH )
+    if( lLenPart < xBufferLen )
     {
         ulLenTotal = lLenPart;
     }
     else
     {
-        ulLenTotal = dlMAX_PRINT_STRING_LENGTH;
+        ulLenTotal = xBufferLen - 1;
     }
 
-    if( ulLenTotal < dlMAX_PRINT_STRING_LENGTH )
+    if( ulLenTotal < ( xBufferLen - 1 ) )
     {
         /* There are a variable number of parameters. */
-        va_start( args, pcFormat );
-        lLenPart = vsnprintf( &pcPrintBuff[ ulLenTotal ],
-                              ( dlMAX_PRINT_STRING_LENGTH - ulLenTotal ),
+        lLenPart = vsnprintf( &pcBuffer[ ulLenTotal ],
+                              ( xBufferLen - ulLenTotal ),
                               pcFormat,
                               args );
-        va_end( args );
 
-        configASSERT( lLenPart > 0 );
+        configASSERT( lLenPart >= 0 );
 
-        if( lLenPart + ulLenTotal < dlMAX_PRINT_STRING_LENGTH )
+        if( lLenPart + ulLenTotal < xBufferLen )
         {
             ulLenTotal += lLenPart;
         }
         else
         {
-            ulLenTotal = dlMAX_PRINT_STRING_LENGTH;
+            ulLenTotal = xBufferLen - 1;
         }
     }
 
     /* remove any \r\n\0 characters at the end of the message */
     while( ulLenTotal > 0 &&
-           ( pcPrintBuff[ ulLenTotal - 1 ] == '\r' ||
-             pcPrintBuff[ ulLenTotal - 1 ] == '\n' ||
-             pcPrintBuff[ ulLenTotal - 1 ] == '\0' ) )
+           ( pcBuffer[ ulLenTotal - 1 ] == '\r' ||
+             pcBuffer[ ulLenTotal - 1 ] == '\n' ||
+             pcBuffer[ ulLenTotal - 1 ] == '\0' ) )
     {
-        pcPrintBuff[ ulLenTotal - 1 ] = '\0';
+        pcBuffer[ ulLenTotal - 1 ] = '\0';
         ulLenTotal--;
     }
 
     if( ( pcFileName != NULL ) &&
         ( ulLineNumber > 0 ) &&
-        ( ulLenTotal < dlMAX_LOG_LINE_LENGTH ) )
+        ( ulLenTotal < ( xBufferLen - 1 ) ) )
     {
         /* Add the trailer including file name and line number */
-        lLenPart = snprintf( &pcPrintBuff[ ulLenTotal ],
-                             ( dlMAX_LOG_LINE_LENGTH - ulLenTotal ),
+        lLenPart = snprintf( &pcBuffer[ ulLenTotal ],
+                             ( xBufferLen - ulLenTotal ),
                              " (%s:%lu)",
                              pcFileName,
                              ulLineNumber );
 
         configASSERT( lLenPart > 0 );
 
-        if( lLenPart + ulLenTotal < dlMAX_LOG_LINE_LENGTH )
+        if( lLenPart + ulLenTotal < xBufferLen )
         {
             ulLenTotal += lLenPart;
         }
         else
         {
-            ulLenTotal = dlMAX_LOG_LINE_LENGTH;
+            ulLenTotal = xBufferLen - 1;
+        }
+    }
+
+    return ulLenTotal;
+}
+
+/*
+ * Format a log line straight into the task's own staging buffer. The line is
+ * formatted into the contiguous space at the head of the ring. If it was cut
+ * short there, the end of the ring is skipped and the line is formatted again
+ * at the start, so that only the length actually used is committed. A line
+ * which does not fit in the free space is dropped rather than truncated.
+ */
+static BaseType_t prvStagingFormat( LogStagingBuffer_t * pxBuffer,
+                                    uint32_t ulSequence,
+                                    const char * const pcLogLevel,
+                                    const char * const pcFileName,
+                                    const unsigned long ulLineNumber,
+                                    const char * const pcFormat,
+                                    va_list args )
+{
+    BaseType_t xFits = pdFALSE;
+    size_t xMinLen = 1;
+    size_t xMaxLen = 0;
+    size_t xLen = 0;
+
+    for( uint32_t ulAttempt = 0; ( ulAttempt < 2 ) && ( xFits == pdFALSE ); ulAttempt++ )
+    {
+        char * pcPayload = ( char * ) prvStagingReserve( pxBuffer, xMinLen, &xMaxLen );
+        va_list xArgs;
+
+        if( pcPayload == NULL )
+        {
+            break;
+        }
+
+        if( xMaxLen > dlMAX_LOG_LINE_LENGTH )
+        {
+            xMaxLen = dlMAX_LOG_LINE_LENGTH;
+        }
+
+        va_copy( xArgs, args );
+        xLen = prvFormatLogLine( pcPayload, xMaxLen,
+                                 pcLogLevel, pcFileName, ulLineNumber, pcFormat, xArgs );
+        va_end( xArgs );
+
+        /* A line filling the whole space may have been cut short, unless it is
+         * already at the maximum line length */
+        xFits = ( ( ( xLen + 1 ) < xMaxLen ) || ( xMaxLen == dlMAX_LOG_LINE_LENGTH ) ) ? pdTRUE : pdFALSE;
+
+        /* Only retry where more space is available than in this attempt */
+        xMinLen = xMaxLen + 1;
+    }
+
+    if( xFits == pdTRUE )
+    {
+        prvStagingCommit( pxBuffer, xLen, ulSequence );
+    }
+    else
+    {
+        pxBuffer->ulDropped++;
+    }
+
+    return xFits;
+}
+
+static void prvLoggingPrintfV( const char * const pcLogLevel,
+                               const char * const pcFileName,
+                               const unsigned long ulLineNumber,
+                               const char * const pcFormat,
+                               va_list args )
+{
+    uint32_t ulStartCycles = DWT->CYCCNT;
+    uint32_t ulSuspendedCycles = 0;
+    BaseType_t xSent = pdTRUE;
+    LogStagingBuffer_t * pxBuffer = &xSharedStaging;
+
+    if( xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED )
+    {
+        size_t xLen = prvFormatLogLine( pcPrintBuff, dlMAX_LOG_LINE_LENGTH,
+                                        pcLogLevel, pcFileName, ulLineNumber, pcFormat, args );
+
+        vSendLogMessageEarly( pcPrintBuff, xLen );
+    }
+    else if( xPortIsInsideInterrupt() == pdTRUE )
+    {
+        /* Keep interrupts masked while pcIsrPrintBuff is in use */
+        UBaseType_t uxSavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+        uint32_t ulSequence = Atomic_Increment_u32( &ulLogSequence );
+        size_t xLen = prvFormatLogLine( pcIsrPrintBuff, dlISR_MAX_LOG_LINE_LENGTH,
+                                        pcLogLevel, pcFileName, ulLineNumber, pcFormat, args );
+
+        xSent = prvSharedStagingWrite( pcIsrPrintBuff, xLen, ulSequence );
+
+        taskEXIT_CRITICAL_FROM_ISR( uxSavedInterruptStatus );
+    }
+    else
+    {
+        LogStagingBuffer_t * pxTaskBuffer = prvGetTaskStagingBuffer();
+        uint32_t ulSequence = Atomic_Increment_u32( &ulLogSequence );
+
+        if( pxTaskBuffer != NULL )
+        {
+            pxBuffer = pxTaskBuffer;
+            xSent = prvStagingFormat( pxBuffer, ulSequence,
+                                      pcLogLevel, pcFileName, ulLineNumber, pcFormat, args );
+        }
+        else
+        {
+            size_t xLen;
+
+            /* Suspend the scheduler to access pcPrintBuff */
+            vTaskSuspendAll();
+            ulSuspendedCycles = DWT->CYCCNT;
+
+            xLen = prvFormatLogLine( pcPrintBuff, dlMAX_LOG_LINE_LENGTH,
+                                     pcLogLevel, pcFileName, ulLineNumber, pcFormat, args );
+            xSent = prvSharedStagingWrite( pcPrintBuff, xLen, ulSequence );
+
+            ulSuspendedCycles = DWT->CYCCNT - ulSuspendedCycles;
+            ( void ) xTaskResumeAll();
+        }
+    }
+
+    prvRecordStats( pxBuffer, LOG_PATH_TEXT, DWT->CYCCNT - ulStartCycles, ulSuspendedCycles, ( xSent == pdTRUE ) ? pdFALSE : pdTRUE );
+}
+
+void vLoggingPrintf( const char * const pcLogLevel,
+                     const char * const pcFileName,
+                     const unsigned long ulLineNumber,
+                     const char * const pcFormat,
+                     ... )
+{
+    va_list args;
+
+    va_start( args, pcFormat );
+    prvLoggingPrintfV( pcLogLevel, pcFileName, ulLineNumber, pcFormat, args );
+    va_end( args );
+}
+
+#ifdef LOGGING_DEFERRED_BINARY
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvPackBytes( uint8_t * pucRecord,
+                                size_t * pxOffset,
+                                const void * pvData,
+                                size_t xLen )
+{
+    BaseType_t xResult = pdFALSE;
+
+    if( ( *pxOffset + xLen ) <= dlBINARY_MAX_RECORD_LEN )
+    {
+        ( void ) memcpy( &( pucRecord[ *pxOffset ] ), pvData, xLen );
+        *pxOffset += xLen;
+        xResult = pdTRUE;
+    }
+
+    return xResult;
+}
+
+/* Strings are copied with their terminator, truncated to dlBINARY_MAX_STRING_LEN */
+static BaseType_t prvPackString( uint8_t * pucRecord,
+                                 size_t * pxOffset,
+                                 const char * pcString )
+{
+    BaseType_t xResult = pdFALSE;
+    size_t xLen;
+
+    if( pcString == NULL )
+    {
+        pcString = "(null)";
+    }
+
+    xLen = strnlen( pcString, dlBINARY_MAX_STRING_LEN );
+
+    if( ( *pxOffset + xLen + 1 ) <= dlBINARY_MAX_RECORD_LEN )
+    {
+        ( void ) memcpy( &( pucRecord[ *pxOffset ] ), pcString, xLen );
+        pucRecord[ *pxOffset + xLen ] = '\0';
+        *pxOffset += xLen + 1;
+        xResult = pdTRUE;
+    }
+
+    return xResult;
+}
+
+static BaseType_t prvPackFieldWidth( uint8_t * pucRecord,
+                                     size_t * pxOffset,
+                                     const char ** ppcCursor,
+                                     va_list * pxArgs )
+{
+    BaseType_t xResult = pdTRUE;
+
+    if( **ppcCursor == '*' )
+    {
+        int lValue = va_arg( *pxArgs, int );
+
+        xResult = prvPackBytes( pucRecord, pxOffset, &lValue, sizeof( lValue ) );
+        ( *ppcCursor )++;
+    }
+    else
+    {
+        while( isdigit( ( int ) **ppcCursor ) )
+        {
+            ( *ppcCursor )++;
+        }
+    }
+
+    return xResult;
+}
+
+/*
+ * Walk the format string and copy each argument into the record without
+ * formatting it. Integers are stored as 4 bytes (8 for ll / j), floating point
+ * as an 8 byte double and strings inline. tools/log_decoder.py walks the
+ * format string the same way to unpack them.
+ */
+static BaseType_t prvPackArgs( uint8_t * pucRecord,
+                               size_t * pxOffset,
+                               const char * pcFormat,
+                               va_list * pxArgs )
+{
+    BaseType_t xResult = pdTRUE;
+    const char * pcCursor = pcFormat;
+
+    while( ( *pcCursor != '\0' ) && ( xResult == pdTRUE ) )
+    {
+        uint32_t ulLongCount = 0;
+
+        if( *pcCursor != '%' )
+        {
+            pcCursor++;
+            continue;
+        }
+
+        pcCursor++;
+
+        if( *pcCursor == '%' )
+        {
+            pcCursor++;
+            continue;
+        }
+
+        /* Flags */
+        while( ( *pcCursor == '-' ) || ( *pcCursor == '+' ) || ( *pcCursor == ' ' ) ||
+               ( *pcCursor == '#' ) || ( *pcCursor == '0' ) )
+        {
+            pcCursor++;
+        }
+
+        /* Width, then precision. '*' consumes an int argument. */
+        xResult = prvPackFieldWidth( pucRecord, pxOffset, &pcCursor, pxArgs );
+
+        if( ( xResult == pdTRUE ) && ( *pcCursor == '.' ) )
+        {
+            pcCursor++;
+            xResult = prvPackFieldWidth( pucRecord, pxOffset, &pcCursor, pxArgs );
+        }
+
+        /* Length modifiers */
+        while( ( *pcCursor == 'l' ) || ( *pcCursor == 'h' ) || ( *pcCursor == 'z' ) ||
+               ( *pcCursor == 'j' ) || ( *pcCursor == 't' ) || ( *pcCursor == 'L' ) )
+        {
+            if( ( *pcCursor == 'l' ) || ( *pcCursor == 'j' ) )
+            {
+                ulLongCount += ( *pcCursor == 'j' ) ? 2 : 1;
+            }
+
+            pcCursor++;
+        }
+
+        if( xResult != pdTRUE )
+        {
+            break;
+        }
+
+        switch( *pcCursor )
+        {
+            case 'd':
+            case 'i':
+            case 'u':
+            case 'x':
+            case 'X':
+            case 'o':
+            case 'c':
+
+                if( ulLongCount >= 2 )
+                {
+                    long long llValue = va_arg( *pxArgs, long long );
+                    xResult = prvPackBytes( pucRecord, pxOffset, &llValue, sizeof( llValue ) );
+                }
+                else
+                {
+                    uint32_t ulValue = ( uint32_t ) va_arg( *pxArgs, long );
+                    xResult = prvPackBytes( pucRecord, pxOffset, &ulValue, sizeof( ulValue ) );
+                }
+
+                break;
+
+            case 'p':
+               {
+                   uint32_t ulValue = ( uint32_t ) ( uintptr_t ) va_arg( *pxArgs, void * );
+                   xResult = prvPackBytes( pucRecord, pxOffset, &ulValue, sizeof( ulValue ) );
+               }
+               break;
+
+            case 's':
+                xResult = prvPackString( pucRecord, pxOffset, va_arg( *pxArgs, const char * ) );
+                break;
+
+            case 'f':
+            case 'F':
+            case 'e':
+            case 'E':
+            case 'g':
+            case 'G':
+            case 'a':
+            case 'A':
+               {
+                   double xValue = va_arg( *pxArgs, double );
+                   xResult = prvPackBytes( pucRecord, pxOffset, &xValue, sizeof( xValue ) );
+               }
+               break;
+
+            case 'n':
+                ( void ) va_arg( *pxArgs, void * );
+                break;
+
+            default:
+                break;
+        }
+
+        if( *pcCursor != '\0' )
+        {
+            pcCursor++;
+        }
+    }
+
+    return xResult;
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * Record layout (little endian):
+ *   uint8_t  tag (dlBINARY_RECORD_TAG)
+ *   uint8_t  flags
+ *   uint32_t address of the LogSite_t
+ *   uint32_t timestamp in ms
+ *   char[]   task name, NUL terminated
+ *   ...      packed arguments
+ */
+void vLoggingPrintfBinary( const LogSite_t * pxSite,
+                           const char * const pcFormat,
+                           ... )
+{
+    va_list args;
+    uint32_t ulStartCycles = DWT->CYCCNT;
+
+    va_start( args, pcFormat );
+
+    if( xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED )
+    {
+        const char * pcFileName = strrchr( pxSite->pcFileName, '/' );
+
+        pcFileName = ( pcFileName != NULL ) ? ( pcFileName + 1 ) : pxSite->pcFileName;
+
+        /* Early messages go straight to the UART, nothing to defer */
+        prvLoggingPrintfV( pxSite->pcLogLevel, pcFileName, pxSite->ulLineNumber, pcFormat, args );
+    }
+    else
+    {
+        uint8_t pucRecord[ dlBINARY_MAX_RECORD_LEN ];
+        size_t xOffset = 0;
+        uint32_t ulValue;
+        uint32_t ulSequence = Atomic_Increment_u32( &ulLogSequence );
+        BaseType_t xSent = pdFALSE;
+        LogStagingBuffer_t * pxBuffer = NULL;
+
+        pucRecord[ 0 ] = dlBINARY_RECORD_TAG;
+        pucRecord[ 1 ] = 0;
+        xOffset = 2;
+
+        ulValue = ( uint32_t ) ( uintptr_t ) pxSite;
+        ( void ) prvPackBytes( pucRecord, &xOffset, &ulValue, sizeof( ulValue ) );
+
+        ulValue = ( ( uint32_t ) xTaskGetTickCount() / portTICK_PERIOD_MS );
+        ( void ) prvPackBytes( pucRecord, &xOffset, &ulValue, sizeof( ulValue ) );
+
+        if( ( prvPackString( pucRecord, &xOffset, pcTaskGetName( NULL ) ) != pdTRUE ) ||
+            ( prvPackArgs( pucRecord, &xOffset, pcFormat, &args ) != pdTRUE ) )
+        {
+            pucRecord[ 1 ] |= dlBINARY_FLAG_TRUNCATED;
+        }
+
+        if( xPortIsInsideInterrupt() == pdFALSE )
+        {
+            pxBuffer = prvGetTaskStagingBuffer();
+        }
+
+        if( pxBuffer != NULL )
+        {
+            xSent = prvStagingWrite( pxBuffer, pucRecord, xOffset, ulSequence );
+        }
+        else
+        {
+            pxBuffer = &xSharedStaging;
+            xSent = prvSharedStagingWrite( pucRecord, xOffset, ulSequence );
         }
+
+        prvRecordStats( pxBuffer, LOG_PATH_BINARY, DWT->CYCCNT - ulStartCycles, 0, ( xSent == pdTRUE ) ? pdFALSE : pdTRUE );
     }
 
-    vSendLogMessage( ( void * ) pcPrintBuff, ulLenTotal );
+    va_end( args );
+}
+
+/*-----------------------------------------------------------*/
 
-    if( xSchedulerWasSuspended == pdTRUE )
+size_t xLoggingEncodeBinaryRecord( const uint8_t * pucRecord,
+                                   size_t xRecordLen,
+                                   char * pcLine,
+                                   size_t xLineLen )
+{
+    size_t xPrefixLen = strlen( dlBINARY_LINE_PREFIX );
+    size_t xEncodedLen = 0;
+    size_t xResult = 0;
+
+    if( xLineLen > xPrefixLen )
     {
-        xTaskResumeAll();
+        ( void ) memcpy( pcLine, dlBINARY_LINE_PREFIX, xPrefixLen );
+
+        if( mbedtls_base64_encode( ( unsigned char * ) &( pcLine[ xPrefixLen ] ),
+                                   xLineLen - xPrefixLen,
+                                   &xEncodedLen,
+                                   pucRecord,
+                                   xRecordLen ) == 0 )
+        {
+            xResult = xPrefixLen + xEncodedLen;
+        }
     }
+
+    return xResult;
 }
 
+#endif /* LOGGING_DEFERRED_BINARY */
+
 /*-----------------------------------------------------------*/
 void vLoggingDeInit( void )
 {
@@ -29,6 +29,7 @@
 
 /* Standard Include. */
 #include <stdio.h>
+#include <stdint.h>
 
 /* Include header for logging level macros. */
 #include "logging_levels.h"
@@ -38,6 +39,14 @@
 #define dlMAX_PRINT_STRING_LENGTH    1024 - CLI_OUTPUT_EOL_LEN       /* maximum length of any single log line */
 #define dlLOGGING_STREAM_LENGTH      4096
 #define dlMAX_LOG_LINE_LENGTH        ( dlMAX_PRINT_STRING_LENGTH + CLI_OUTPUT_EOL_LEN )
+#define dlISR_MAX_LOG_LINE_LENGTH    256
+
+/* Per-task log staging buffers. Sizes must be powers of two and hold at
+ * least one record of dlMAX_LOG_LINE_LENGTH bytes. */
+#define dlSTAGING_BUFFER_LEN         2048
+#define dlSTAGING_MAX_TASKS          24
+#define dlSTAGING_TLS_INDEX          1
+#define dlSTAGING_NAME_LEN           16
 
 /* Default logging config */
 #if ( !defined( LOGGING_OUTPUT_UART ) && !defined( LOGGING_OUTPUT_ITM ) && !defined( LOGGING_OUTPUT_NONE ) )
@@ -46,10 +55,50 @@
 
 #define LOGGING_TIMEOUT_MS    100
 
+/* Define LOGGING_DEFERRED_BINARY to record SdkLog / LogXxx calls as compact
+ * binary records (call site address, timestamp, task name and raw arguments)
+ * instead of formatting them on the device. Records are emitted on the console
+ * as base64 lines prefixed with dlBINARY_LINE_PREFIX and turned back into text
+ * by tools/log_decoder.py using the firmware ELF file. */
+/* #define LOGGING_DEFERRED_BINARY */
+
+#define dlBINARY_RECORD_TAG        0xB1
+#define dlBINARY_MAX_RECORD_LEN    160
+#define dlBINARY_MAX_STRING_LEN    48
+#define dlBINARY_LINE_PREFIX       "@@"
+#define dlBINARY_MAX_LINE_LEN      ( 2 + ( 4 * ( ( dlBINARY_MAX_RECORD_LEN + 2 ) / 3 ) ) + 1 )
+
+/* Set in the flags byte of a binary record when arguments were dropped */
+#define dlBINARY_FLAG_TRUNCATED    0x1
+
 #ifndef LOG_LEVEL
 #define LOG_LEVEL             LOG_DEBUG
 #endif
 
+/* LOG_MODULE is only looked up where a LogXxx macro is expanded. It is not
+ * defaulted with a macro here, since this file is included by FreeRTOSConfig.h
+ * ahead of the component headers (arch/cc.h, core_mqtt_config.h ...) which
+ * define it for a whole library. Until one of them does, this enumerator
+ * stands for it. */
+#ifndef LOG_MODULE
+enum
+{
+    LOG_MODULE = LOG_MODULE_DEFAULT
+};
+#endif
+
+#define LOG_MODULE_NAMES \
+    {                    \
+        "default",       \
+        "net",           \
+        "tls",           \
+        "mqtt",          \
+        "ota",           \
+        "sensor",        \
+        "defender",      \
+        "storage"        \
+    }
+
 /* Get rid of extra C89 style parentheses generated by core FreeRTOS libraries */
 
 #define REMOVE_PARENS( ... )    STR( OVE __VA_ARGS__ )
@@ -68,6 +117,78 @@ void vLoggingInit( void );
 void vLoggingDeInit( void );
 void vDyingGasp( void );
 void vInitLoggingEarly( void );
+size_t xLoggingReceive( char * pcBuffer,
+                        size_t xBufferLen );
+
+/* Static description of a log call site, referenced by binary log records.
+ * The layout is decoded by tools/log_decoder.py. */
+typedef struct
+{
+    const char * pcLogLevel;
+    const char * pcFileName;
+    uint32_t ulLineNumber;
+    const char * pcFormat;
+} LogSite_t;
+
+void vLoggingPrintfBinary( const LogSite_t * pxSite,
+                           const char * const pcFormat,
+                           ... );
+
+size_t xLoggingEncodeBinaryRecord( const uint8_t * pucRecord,
+                                   size_t xRecordLen,
+                                   char * pcLine,
+                                   size_t xLineLen );
+
+typedef enum
+{
+    LOG_PATH_TEXT = 0,
+    LOG_PATH_BINARY,
+    LOG_PATH_MAX
+} LogPath_t;
+
+/* Cost of each vLoggingPrintf / vLoggingPrintfBinary call in CPU cycles */
+typedef struct
+{
+    uint32_t ulCalls;
+    uint32_t ulDropped;
+    uint32_t ulMaxCycles;
+    uint64_t ullTotalCycles;
+    uint32_t ulMaxSuspendedCycles;
+    uint64_t ullTotalSuspendedCycles;
+} LoggingStats_t;
+
+void vLoggingGetStats( LoggingStats_t pxStats[ LOG_PATH_MAX ] );
+void vLoggingResetStats( void );
+
+/* Runtime log level of each module, checked by the LogXxx macros before the
+ * arguments are evaluated. Use vLoggingSetModuleLevel to modify. */
+extern uint8_t pucLogModuleLevels[ LOG_MODULE_MAX ];
+
+void vLoggingSetModuleLevel( uint32_t ulModule,
+                             uint8_t ucLevel );
+
+/* Levels are packed 4 bits per module, LOG_MODULE_DEFAULT in the low bits */
+void vLoggingSetModuleLevels( uint32_t ulPackedLevels );
+uint32_t ulLoggingGetModuleLevels( void );
+
+/* State of one log staging buffer. Index 0 is the buffer shared by interrupts
+ * and by tasks without a buffer of their own. */
+typedef struct
+{
+    char pcOwnerName[ dlSTAGING_NAME_LEN ];
+    uint32_t ulSize;
+    uint32_t ulUsed;
+    uint32_t ulDropped;
+} LogStagingInfo_t;
+
+/* Returns 0 once ulIndex is past the last staging buffer */
+uint32_t ulLoggingGetStagingInfo( uint32_t ulIndex,
+                                  LogStagingInfo_t * pxInfo );
+
+/* Staging buffers of deleted tasks are freed by the console task once drained */
+void vLoggingTaskDeleted( void * pvTask );
+
+#define traceTASK_DELETE( pxTCB )    vLoggingTaskDeleted( ( void * ) ( pxTCB ) )
 
 /* task.h cannot be included here because this file is included by FreeRTOSConfig.h */
 extern void vTaskSuspendAll( void );
@@ -80,14 +201,31 @@ extern void vTaskSuspendAll( void );
 #define __NAME_ARG__    ( __builtin_strrchr( __BASE_FILE__, '/' ) ? __builtin_strrchr( __BASE_FILE__, '/' ) + 1 : __BASE_FILE__ )
 
 /* Generic logging macros */
+#ifdef LOGGING_DEFERRED_BINARY
+
+#define LOG_FIRST_ARG( x, ... )    x
+
+#define SdkLog( level, ... )                                                                          \
+    do {                                                                                              \
+        static const LogSite_t xLogSite = { level, __BASE_FILE__, __LINE__, LOG_FIRST_ARG( __VA_ARGS__, 0 ) }; \
+        vLoggingPrintfBinary( &xLogSite, __VA_ARGS__ );                                               \
+    } while( 0 )
+
+#else
+
 #define SdkLog( level, ... )    do { vLoggingPrintf( level, __NAME_ARG__, __LINE__, __VA_ARGS__ ); } while( 0 )
 
+#endif /* LOGGING_DEFERRED_BINARY */
+
 #define LogAssert( ... )        do { SdkLog( "ASRT", __VA_ARGS__ ); } while( 0 )
 
 #define LogSys( ... )           do { vLoggingPrintf( "SYS", __NAME_ARG__, __LINE__, __VA_ARGS__ ); } while( 0 )
 
 #define LogKernel( ... )        SdkLog( "KRN", __VA_ARGS__ )
 
+/* Single load and compare against the runtime level of this file's module */
+#define LOG_RUNTIME_ENABLED( level )    ( pucLogModuleLevels[ LOG_MODULE ] >= ( level ) )
+
 #if !defined( LOG_LEVEL ) ||       \
     ( ( LOG_LEVEL != LOG_NONE ) && \
     ( LOG_LEVEL != LOG_ERROR ) &&  \
@@ -99,25 +237,25 @@ extern void vTaskSuspendAll( void );
 #else
 
 #if ( LOG_LEVEL >= LOG_ERROR )
-#define LogError( ... )    SdkLog( "ERR", REMOVE_PARENS( __VA_ARGS__ ) )
+#define LogError( ... )    do { if( LOG_RUNTIME_ENABLED( LOG_ERROR ) ) { SdkLog( "ERR", REMOVE_PARENS( __VA_ARGS__ ) ); } } while( 0 )
 #else
 #define LogError( ... )
 #endif
 
 #if ( LOG_LEVEL >= LOG_WARN )
-#define LogWarn( ... )    SdkLog( "WRN", REMOVE_PARENS( __VA_ARGS__ ) )
+#define LogWarn( ... )    do { if( LOG_RUNTIME_ENABLED( LOG_WARN ) ) { SdkLog( "WRN", REMOVE_PARENS( __VA_ARGS__ ) ); } } while( 0 )
 #else
 #define LogWarn( ... )
 #endif
 
 #if ( LOG_LEVEL >= LOG_INFO )
-#define LogInfo( ... )    SdkLog( "INF", REMOVE_PARENS( __VA_ARGS__ ) )
+#define LogInfo( ... )    do { if( LOG_RUNTIME_ENABLED( LOG_INFO ) ) { SdkLog( "INF", REMOVE_PARENS( __VA_ARGS__ ) ); } } while( 0 )
 #else
 #define LogInfo( ... )
 #endif
 
 #if ( LOG_LEVEL >= LOG_DEBUG )
-#define LogDebug( ... )    SdkLog( "DBG", REMOVE_PARENS( __VA_ARGS__ ) )
+#define LogDebug( ... )    do { if( LOG_RUNTIME_ENABLED( LOG_DEBUG ) ) { SdkLog( "DBG", REMOVE_PARENS( __VA_ARGS__ ) ); } } while( 0 )
 #else
 #define LogDebug( ... )
 #endif
@@ -109,4 +109,24 @@
  */
 #define LOG_DEBUG    4
 
+/**
+ * @brief Modules for runtime log level filtering.
+ *
+ * A source file selects its module by defining LOG_MODULE next to LOG_LEVEL.
+ * The config header of a library (arch/cc.h for lwIP, core_mqtt_config.h,
+ * ota_config.h, lfs_config.h) defines it for the library sources, which
+ * works even after logging.h was included. Files with neither are part of
+ * #LOG_MODULE_DEFAULT. The runtime level of each module can be lowered below
+ * the compile time LOG_LEVEL with the "loglevel" CLI command.
+ */
+#define LOG_MODULE_DEFAULT     0
+#define LOG_MODULE_NET         1
+#define LOG_MODULE_TLS         2
+#define LOG_MODULE_MQTT        3
+#define LOG_MODULE_OTA         4
+#define LOG_MODULE_SENSOR      5
+#define LOG_MODULE_DEFENDER    6
+#define LOG_MODULE_STORAGE     7
+#define LOG_MODULE_MAX         8
+
 #endif /* ifndef LOGGING_LEVELS_H */
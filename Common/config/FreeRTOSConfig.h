@@ -70,6 +70,7 @@ extern uint32_t SystemCoreClock;
 #define configMAX_PRIORITIES                       ( 56 )
 #define configMINIMAL_STACK_SIZE                   ( ( uint16_t ) 1024 )
 #define configTOTAL_HEAP_SIZE                      ( ( size_t ) 300 * 1024 )
+#define configAPPLICATION_ALLOCATED_HEAP           1
 #define configMAX_TASK_NAME_LEN                    ( 32 )
 #define configUSE_TRACE_FACILITY                   1
 #define configUSE_16_BIT_TICKS                     0
@@ -86,6 +87,7 @@ extern uint32_t SystemCoreClock;
 
 
 #define configGENERATE_RUN_TIME_STATS              1
+#define configRUN_TIME_COUNTER_TYPE                uint64_t
 
 /* For lwip errno support */
 #define configUSE_NEWLIB_REENTRANT                 1
@@ -187,12 +189,19 @@ extern uint32_t SystemCoreClock;
 
 #include "stack_macros.h"
 
+/* Kernel trace hooks for the event trace recorder and the task stats sampler */
+#include "trace_ring.h"
+
+/* Heap allocation tracking hooks */
+#include "heap_trace.h"
+
 #define configAPPLICATION_PROVIDES_cOutputBuffer    1
 #define configCOMMAND_INT_MAX_OUTPUT_SIZE           128
 
 #include "hw_defs.h"
 #define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()
-#define portGET_RUN_TIME_COUNTER_VALUE()    ( timer_get_count( pxHndlTim5 ) )
+/* TIM5 runs at 1 MHz and is extended to 64 bits, see ullRunTimeCounterGet */
+#define portGET_RUN_TIME_COUNTER_VALUE()    ( ullRunTimeCounterGet() )
 
 
 
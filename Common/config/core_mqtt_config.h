@@ -32,6 +32,10 @@
 #define LOG_LEVEL    LOG_ERROR
 #endif
 
+#ifndef LOG_MODULE
+#define LOG_MODULE    LOG_MODULE_MQTT
+#endif
+
 /* Remove extra C89 style parentheses */
 #define LOGGING_REMOVE_PARENS
 
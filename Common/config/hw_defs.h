@@ -23,6 +23,10 @@
 #define MXCHIP_RESET_Pin           GPIO_PIN_15
 #define MXCHIP_RESET_GPIO_Port     GPIOF
 
+#define ISM330_INT1_Pin            GPIO_PIN_11
+#define ISM330_INT1_GPIO_Port      GPIOE
+#define ISM330_INT1_EXTI_IRQn      EXTI11_IRQn
+
 extern RTC_HandleTypeDef * pxHndlRtc;
 extern SPI_HandleTypeDef * pxHndlSpi2;
 extern TIM_HandleTypeDef * pxHndlTim5;
@@ -45,6 +49,9 @@ static inline uint32_t timer_get_count( TIM_HandleTypeDef * pxHndl )
 
 void hw_init( void );
 
+/* TIM5 extended to 64 bits in software, used as the run time stats counter */
+uint64_t ullRunTimeCounterGet( void );
+
 typedef void ( * GPIOInterruptCallback_t ) ( void * pvContext );
 
 void GPIO_EXTI_Register_Callback( uint16_t usGpioPinMask,
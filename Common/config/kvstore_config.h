@@ -36,6 +36,15 @@ typedef enum KvStoreEnum
     CS_WIFI_SSID,
     CS_WIFI_CREDENTIAL,
     CS_TIME_HWM_S_1970,
+    CS_LOG_LEVELS,
+    CS_MOTION_WINDOW_MS,
+    CS_MOTION_PUB_MODE,
+    CS_MOTION_PUB_FORMAT,
+    CS_ENV_PUB_FORMAT,
+    CS_ENV_DEADBAND_TEMP,
+    CS_ENV_DEADBAND_RH,
+    CS_ENV_DEADBAND_BARO,
+    CS_ENV_KEYFRAME_S,
     CS_NUM_KEYS
 } KVStoreKey_t;
 
@@ -46,25 +55,61 @@ typedef enum KvStoreEnum
 #define WIFI_SSID_DFLT         ""
 #define WIFI_PASSWORD_DFLT     ""
 
+/* Runtime log level of each logging module, 4 bits per module (LOG_DEBUG) */
+#define LOG_LEVELS_DFLT        0x44444444
+
+/* Motion sensor aggregation window and publish mode (0: summary, 1: raw samples) */
+#define MOTION_WINDOW_MS_DFLT    1000
+#define MOTION_PUB_MODE_DFLT     0
+
+/* Telemetry payload format per topic (0: JSON, 1: CBOR) */
+#define MOTION_PUB_FORMAT_DFLT    0
+#define ENV_PUB_FORMAT_DFLT       0
+
+/* Environment sensor dead bands (0.01 C, 0.1 %RH, 0.01 mbar) and keyframe interval,
+ * applied to CBOR publishes only: env_pub_format 0 (JSON) publishes every reading */
+#define ENV_DEADBAND_TEMP_DFLT    5
+#define ENV_DEADBAND_RH_DFLT      5
+#define ENV_DEADBAND_BARO_DFLT    10
+#define ENV_KEYFRAME_S_DFLT       60
+
 /* Array to map between strings and KVStoreKey_t IDs */
-#define KV_STORE_STRINGS   \
-    {                      \
-        "thing_name",      \
-        "mqtt_endpoint",   \
-        "mqtt_port",       \
-        "wifi_ssid",       \
-        "wifi_credential", \
-        "time_hwm"         \
+#define KV_STORE_STRINGS     \
+    {                        \
+        "thing_name",        \
+        "mqtt_endpoint",     \
+        "mqtt_port",         \
+        "wifi_ssid",         \
+        "wifi_credential",   \
+        "time_hwm",          \
+        "log_levels",        \
+        "motion_window_ms",  \
+        "motion_pub_mode",   \
+        "motion_pub_format", \
+        "env_pub_format",    \
+        "env_db_temp",       \
+        "env_db_rh",         \
+        "env_db_baro",       \
+        "env_keyframe_s"     \
     }
 
-#define KV_STORE_DEFAULTS                                                           \
-    {                                                                               \
-        KV_DFLT( KV_TYPE_STRING, THING_NAME_DFLT ),     /* CS_CORE_THING_NAME */    \
-        KV_DFLT( KV_TYPE_STRING, MQTT_ENDOPOINT_DFLT ), /* CS_CORE_MQTT_ENDPOINT */ \
-        KV_DFLT( KV_TYPE_UINT32, 8883 ),                /* CS_CORE_MQTT_PORT */     \
-        KV_DFLT( KV_TYPE_STRING, WIFI_SSID_DFLT ),      /* CS_WIFI_SSID */          \
-        KV_DFLT( KV_TYPE_STRING, WIFI_PASSWORD_DFLT ),  /* CS_WIFI_CREDENTIAL */    \
-        KV_DFLT( KV_TYPE_UINT32, 0 ),                   /* CS_TIME_HWM_S_1970 */    \
+#define KV_STORE_DEFAULTS                                                              \
+    {                                                                                  \
+        KV_DFLT( KV_TYPE_STRING, THING_NAME_DFLT ),        /* CS_CORE_THING_NAME */    \
+        KV_DFLT( KV_TYPE_STRING, MQTT_ENDOPOINT_DFLT ),    /* CS_CORE_MQTT_ENDPOINT */ \
+        KV_DFLT( KV_TYPE_UINT32, 8883 ),                   /* CS_CORE_MQTT_PORT */     \
+        KV_DFLT( KV_TYPE_STRING, WIFI_SSID_DFLT ),         /* CS_WIFI_SSID */          \
+        KV_DFLT( KV_TYPE_STRING, WIFI_PASSWORD_DFLT ),     /* CS_WIFI_CREDENTIAL */    \
+        KV_DFLT( KV_TYPE_UINT32, 0 ),                      /* CS_TIME_HWM_S_1970 */    \
+        KV_DFLT( KV_TYPE_UINT32, LOG_LEVELS_DFLT ),        /* CS_LOG_LEVELS */         \
+        KV_DFLT( KV_TYPE_UINT32, MOTION_WINDOW_MS_DFLT ),  /* CS_MOTION_WINDOW_MS */   \
+        KV_DFLT( KV_TYPE_UINT32, MOTION_PUB_MODE_DFLT ),   /* CS_MOTION_PUB_MODE */    \
+        KV_DFLT( KV_TYPE_UINT32, MOTION_PUB_FORMAT_DFLT ), /* CS_MOTION_PUB_FORMAT */  \
+        KV_DFLT( KV_TYPE_UINT32, ENV_PUB_FORMAT_DFLT ),    /* CS_ENV_PUB_FORMAT */     \
+        KV_DFLT( KV_TYPE_UINT32, ENV_DEADBAND_TEMP_DFLT ), /* CS_ENV_DEADBAND_TEMP */  \
+        KV_DFLT( KV_TYPE_UINT32, ENV_DEADBAND_RH_DFLT ),   /* CS_ENV_DEADBAND_RH */    \
+        KV_DFLT( KV_TYPE_UINT32, ENV_DEADBAND_BARO_DFLT ), /* CS_ENV_DEADBAND_BARO */  \
+        KV_DFLT( KV_TYPE_UINT32, ENV_KEYFRAME_S_DFLT ),    /* CS_ENV_KEYFRAME_S */     \
     }
 
 #endif /* _KVSTORE_CONFIG_H */
@@ -44,6 +44,13 @@
 #define LWIP_ARP                              1
 #define LWIP_STATS                            1
 #define MIB2_STATS                            1
+
+/* Set to 1 to route lwIP's PERF_START / PERF_STOP instrumentation points to
+ * the cycle counter histograms in lwip_port (see arch/perf.h and the "perf"
+ * command). Off by default since it adds a critical section to the hot paths. */
+#ifndef LWIP_PERF
+#define LWIP_PERF                             0
+#endif
 #define LWIP_POSIX_SOCKETS_IO_NAMES           0
 #define LWIP_COMPAT_SOCKETS                   2
 
@@ -142,10 +149,11 @@
 #define LWIP_RAW            1             /* PING changed to 1 */
 /*#define DEFAULT_RAW_RECVMBOX_SIZE       3 / * for ICMP PING * / */
 
-/* To use single transmit pbuf ,this may be more efficient for MXCHIP */
-/*#define LWIP_NETIF_TX_SINGLE_PBUF 1 */
-/*#define TCP_OVERSIZE              1 */
+/* Use a single transmit pbuf per frame so that the MXCHIP driver can hand frames to SPI DMA without copying */
+#define LWIP_NETIF_TX_SINGLE_PBUF       1
+#define TCP_OVERSIZE                    TCP_MSS
 /* when allocating buffer for MXCHIP , an header must be provisionned for TX buffers , default is zero */
+/* Must be at least sizeof( BypassInOut_t ) */
 #define PBUF_LINK_ENCAPSULATION_HLEN    28
 #endif /* LWIP_HDR_LWIPOPTS_H */
 
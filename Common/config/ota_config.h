@@ -36,6 +36,10 @@
 #define LOG_LEVEL    LOG_INFO
 #endif
 
+#ifndef LOG_MODULE
+#define LOG_MODULE    LOG_MODULE_OTA
+#endif
+
 #include "logging.h"
 
 
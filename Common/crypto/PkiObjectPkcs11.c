@@ -116,7 +116,7 @@ static CK_RV xPrvExportPubKeyDer( CK_SESSION_HANDLE xSession,
         *pulPubKeyDerLen = xTemplate.ulValueLen + sizeof( pucEcP256AsnAndOid ) - sizeof( pucUnusedKeyTag ) + 1;
 
         /* Allocate a buffer for the DER form  of the key */
-        *ppucPubKeyDer = pvPortMalloc( *pulPubKeyDerLen );
+        *ppucPubKeyDer = mbedtls_calloc( 1, *pulPubKeyDerLen );
 
         xResult = CKR_FUNCTION_FAILED;
     }
@@ -150,7 +150,7 @@ static CK_RV xPrvExportPubKeyDer( CK_SESSION_HANDLE xSession,
     {
         if( *ppucPubKeyDer != NULL )
         {
-            vPortFree( *ppucPubKeyDer );
+            mbedtls_free( *ppucPubKeyDer );
             *ppucPubKeyDer = NULL;
         }
 
@@ -0,0 +1,125 @@
+/*
+ * FreeRTOS STM32U5 Reference Integration
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+
+#ifndef _HEAP_TRACE_H
+#define _HEAP_TRACE_H
+
+/*
+ * Allocation tracking for the FreeRTOS heap (heap_4).
+ *
+ * The traceMALLOC / traceFREE kernel hooks attribute every block to the code
+ * address that called pvPortMalloc. Wrappers such as malloc and
+ * mbedtls_platform_calloc use pvPortMallocFromCaller so that their own caller
+ * is recorded instead. Addresses can be resolved with addr2line.
+ *
+ * Sizes are heap_4 block sizes, including the block header and alignment.
+ * heap_4 passes traceMALLOC the size it asked for but traceFREE the size of
+ * the block, which is larger when the free block it came from was too small
+ * to split, so both hooks read the size from the block header.
+ *
+ * This header is included by FreeRTOSConfig.h, so it must not depend on any
+ * FreeRTOS types.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Set to 0 to remove allocation tracking */
+#ifndef HEAP_TRACE_ENABLED
+#define HEAP_TRACE_ENABLED    1
+#endif
+
+/* Number of distinct call sites, further sites are accounted to site 0 */
+#define HEAP_TRACE_MAX_SITES            64
+
+/* Number of live blocks whose call site is remembered, must be a power of two */
+#define HEAP_TRACE_MAX_BLOCKS           1024
+
+/* Free block size histogram buckets, bucket n counts blocks of less than 2^( n + 5 ) bytes */
+#define HEAP_TRACE_HISTOGRAM_BUCKETS    16
+
+typedef struct
+{
+    const void * pvCaller;
+    uint32_t ulLiveBytes;
+    uint32_t ulPeakBytes;
+    uint32_t ulLiveBlocks;
+    uint32_t ulAllocs;
+} HeapTraceSite_t;
+
+typedef struct
+{
+    uint32_t ulAllocs;
+    uint32_t ulFrees;
+    uint32_t ulFailures;
+    uint32_t ulUntracked;  /* Blocks whose call site could not be remembered */
+    uint32_t ulAllocBytes; /* Bytes allocated since the last reset */
+    uint32_t ulLiveBytes;
+    uint32_t ulPeakBytes;
+    uint32_t ulResetTick;  /* Tick count at the last reset, for rates */
+} HeapTraceStats_t;
+
+typedef struct
+{
+    uint32_t ulFreeBlocks;
+    uint32_t ulFreeBytes;
+    uint32_t ulLargestFree;
+    uint32_t ulUsedBlocks;
+    uint32_t pulFreeHistogram[ HEAP_TRACE_HISTOGRAM_BUCKETS ];
+} HeapTraceWalk_t;
+
+#if HEAP_TRACE_ENABLED
+
+void vHeapTraceMalloc( void * pvAddress,
+                       size_t xSize,
+                       const void * pvReturnAddress );
+void vHeapTraceFree( void * pvAddress,
+                     size_t xSize );
+
+void * pvHeapTraceMallocFrom( size_t xSize,
+                              const void * pvCaller );
+
+/* Allocate on behalf of the calling function's caller */
+#define pvPortMallocFromCaller( xSize )    pvHeapTraceMallocFrom( ( xSize ), __builtin_return_address( 0 ) )
+
+void vHeapTraceGetStats( HeapTraceStats_t * pxStats );
+uint32_t ulHeapTraceGetSite( uint32_t ulIndex,
+                             HeapTraceSite_t * pxSite );
+void vHeapTraceReset( void );
+void vHeapTraceWalk( HeapTraceWalk_t * pxWalk );
+
+/* Kernel hooks, expanded inside pvPortMalloc and vPortFree with the scheduler suspended */
+#define traceMALLOC( pvAddress, uiSize )    vHeapTraceMalloc( ( pvAddress ), ( uiSize ), __builtin_return_address( 0 ) )
+#define traceFREE( pvAddress, uiSize )      vHeapTraceFree( ( pvAddress ), ( uiSize ) )
+
+#else /* HEAP_TRACE_ENABLED */
+
+#define pvPortMallocFromCaller( xSize )    pvPortMalloc( xSize )
+
+#endif /* HEAP_TRACE_ENABLED */
+
+#endif /* _HEAP_TRACE_H */
@@ -0,0 +1,65 @@
+/*
+ * FreeRTOS STM32U5 Reference Integration
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+
+#ifndef _IMU_FIFO_H
+#define _IMU_FIFO_H
+
+/*
+ * Batched accelerometer / gyroscope sampling through the ISM330DLC FIFO.
+ *
+ * The sensor fills its FIFO at the configured output data rate and raises
+ * INT1 once the watermark is reached. The consumer task then drains every
+ * complete sample set in a single burst bus transaction instead of issuing
+ * two register reads per sample.
+ *
+ * xImuFifoInit must be called from the task that consumes the samples, after
+ * BSP_MOTION_SENSOR_Init / BSP_MOTION_SENSOR_Enable for instance 0.
+ */
+
+#include "FreeRTOS.h"
+
+#define IMU_FIFO_NUM_AXES       6 /* accel x, y, z in mG then gyro x, y, z in mDPS */
+#define IMU_FIFO_NOTIFY_IDX     2
+#define IMU_FIFO_MAX_SAMPLES    341 /* 4 kB FIFO / 12 bytes per sample set */
+
+BaseType_t xImuFifoInit( float fOdrHz,
+                         uint32_t ulWatermark );
+
+/* Returns the sensor to bypass mode and releases the INT1 callback */
+void vImuFifoDeinit( void );
+
+/* Block until the watermark interrupt fires, returns pdFALSE on timeout */
+BaseType_t xImuFifoWait( TickType_t xTimeout );
+
+/* Read up to ulMaxSamples complete sample sets, returns the number read */
+uint32_t ulImuFifoRead( int32_t plSamples[][ IMU_FIFO_NUM_AXES ],
+                        uint32_t ulMaxSamples );
+
+/* Number of times the FIFO overflowed and dropped its oldest samples */
+uint32_t ulImuFifoGetOverruns( void );
+
+#endif /* _IMU_FIFO_H */
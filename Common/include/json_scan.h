@@ -0,0 +1,112 @@
+/*
+ * FreeRTOS STM32U5 Reference Integration
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+
+
+#ifndef _JSON_SCAN_H
+#define _JSON_SCAN_H
+
+/*
+ * Single pass JSON field extraction.
+ *
+ * xJsonScan validates a document and, in the same pass, records where the
+ * value of each registered dotted path (e.g. "state.reported.powerOn") is,
+ * so the document is read once however many paths are registered. Each
+ * value is still compared with every path not found yet, so the cost grows
+ * with the document size times the number of paths; a path is rejected on
+ * its first differing key, which keeps this cheap for the few paths of a
+ * shadow handler. Nothing is allocated: the parser keeps a stack of
+ * JSON_SCAN_MAX_DEPTH open containers and values point into the document.
+ *
+ * Limitations: keys are compared as they appear in the document, without
+ * unescaping, keys which contain a '.' and elements of arrays cannot be
+ * addressed, and the first of duplicate keys wins. String contents are not checked for valid UTF-8.
+ *
+ * The scanner has no RTOS dependencies.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef JSON_SCAN_MAX_DEPTH
+#define JSON_SCAN_MAX_DEPTH    16
+#endif
+
+typedef enum
+{
+    JSON_SCAN_SUCCESS = 0,
+    JSON_SCAN_BAD_PARAMETER,
+    JSON_SCAN_ILLEGAL_DOCUMENT,
+    JSON_SCAN_MAX_DEPTH_EXCEEDED
+} JsonScanStatus_t;
+
+typedef enum
+{
+    JSON_SCAN_NOT_FOUND = 0,
+    JSON_SCAN_STRING, /* Value excludes the quotes and is not unescaped */
+    JSON_SCAN_NUMBER,
+    JSON_SCAN_TRUE,
+    JSON_SCAN_FALSE,
+    JSON_SCAN_NULL,
+    JSON_SCAN_OBJECT, /* Value spans the braces */
+    JSON_SCAN_ARRAY   /* Value spans the brackets */
+} JsonScanType_t;
+
+typedef struct JsonScanField JsonScanField_t;
+
+typedef void ( * JsonScanHandler_t )( const JsonScanField_t * pxField,
+                                      void * pvCtx );
+
+struct JsonScanField
+{
+    const char * pcPath;
+    JsonScanHandler_t xHandler; /* Optional, called by vJsonScanDispatch */
+
+    /* Set by xJsonScan */
+    JsonScanType_t xType;
+    const char * pcValue;
+    size_t xValueLength;
+};
+
+/* Validate pcDoc and locate every field of pxFields, clearing them first */
+JsonScanStatus_t xJsonScan( const char * pcDoc,
+                            size_t xDocLength,
+                            JsonScanField_t * pxFields,
+                            size_t xNumFields );
+
+/* Call the handler of every field found, in table order */
+void vJsonScanDispatch( const JsonScanField_t * pxFields,
+                        size_t xNumFields,
+                        void * pvCtx );
+
+/*
+ * Parse a found number or string field as a base 10 unsigned integer, or
+ * return ulDefault when it does not start with a digit or exceeds UINT32_MAX.
+ */
+uint32_t ulJsonScanToUInt32( const JsonScanField_t * pxField,
+                             uint32_t ulDefault );
+
+#endif /* _JSON_SCAN_H */
@@ -0,0 +1,64 @@
+/*
+ * FreeRTOS STM32U5 Reference Integration
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+
+#ifndef _LATENCY_HIST_H
+#define _LATENCY_HIST_H
+
+/*
+ * Fixed size latency histogram for percentiles on a constrained target.
+ *
+ * Each power of two range of milliseconds is split into 4 linear buckets, so
+ * a percentile is reported with an error of at most 25%, and values up to
+ * about two minutes are resolved in 64 buckets. Recording is a handful of
+ * instructions and needs no allocation, so it can be done inline by callers
+ * holding a critical section. The module does not depend on FreeRTOS;
+ * callers provide the locking.
+ */
+
+#include <stdint.h>
+
+#define LATENCY_HIST_BUCKETS    64
+
+typedef struct
+{
+    uint32_t ulCount;
+    uint32_t ulMaxMs;
+    uint64_t ullTotalMs;
+    uint32_t pulBuckets[ LATENCY_HIST_BUCKETS ];
+} LatencyHist_t;
+
+void vLatencyHistRecord( LatencyHist_t * pxHist,
+                         uint32_t ulMs );
+
+/*
+ * Upper bound of the bucket holding the ulPercent'th percentile, limited to
+ * the largest value recorded. Returns 0 for an empty histogram.
+ */
+uint32_t ulLatencyHistPercentile( const LatencyHist_t * pxHist,
+                                  uint32_t ulPercent );
+
+#endif /* _LATENCY_HIST_H */
@@ -45,6 +45,7 @@
 #include "tls_transport_config.h"
 
 #include "PkiObject.h"
+#include "latency_hist.h"
 
 #ifdef MBEDTLS_TRANSPORT_PKCS11
 #include "core_pkcs11_config.h"
@@ -184,6 +185,17 @@ int32_t mbedtls_transport_setsockopt( NetworkContext_t * pxNetworkContext,
  */
 void mbedtls_transport_disconnect( NetworkContext_t * pxNetworkContext );
 
+/**
+ * @brief Take the TLS handshake statistics recorded since the previous call.
+ *
+ * The statistics are reset, so they are meant for a single periodic consumer.
+ *
+ * @param[out] pxDurations Durations of the successful handshakes in ms.
+ * @param[out] pulFailures Number of handshakes which failed.
+ */
+void mbedtls_transport_take_handshake_stats( LatencyHist_t * pxDurations,
+                                             uint32_t * pulFailures );
+
 /**
  * @brief Receives data from an established TLS connection.
  *
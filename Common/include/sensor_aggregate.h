@@ -0,0 +1,84 @@
+/*
+ * FreeRTOS STM32U5 Reference Integration
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+
+#ifndef _SENSOR_AGGREGATE_H
+#define _SENSOR_AGGREGATE_H
+
+/*
+ * Windowed aggregation of multi axis sensor samples.
+ *
+ * Samples are accumulated as exact 64 bit sums, so the statistics are exact
+ * for up to SENSOR_AGG_MAX_SAMPLES samples per window with magnitudes up to
+ * 2^21. Floating point is only used when the statistics are read out.
+ *
+ * The engine has no RTOS dependencies.
+ */
+
+#include <stdint.h>
+
+#define SENSOR_AGG_MAX_AXES       9
+#define SENSOR_AGG_MAX_SAMPLES    1024
+
+typedef struct
+{
+    int32_t lMin;
+    int32_t lMax;
+    int64_t llSum;
+    uint64_t ullSumSq;
+} SensorAggAxis_t;
+
+typedef struct
+{
+    uint32_t ulNumAxes;
+    uint32_t ulCount;
+    SensorAggAxis_t xAxes[ SENSOR_AGG_MAX_AXES ];
+} SensorAggWindow_t;
+
+typedef struct
+{
+    int32_t lMin;
+    int32_t lMax;
+    float fMean;
+    float fRms;
+    float fVariance; /* Population variance */
+} SensorAggStats_t;
+
+void vSensorAggInit( SensorAggWindow_t * pxWindow,
+                     uint32_t ulNumAxes );
+
+void vSensorAggReset( SensorAggWindow_t * pxWindow );
+
+/* plValues holds one value per axis */
+void vSensorAggAddSample( SensorAggWindow_t * pxWindow,
+                          const int32_t * plValues );
+
+/* pxStats is zeroed when the window is empty */
+void vSensorAggGetStats( const SensorAggWindow_t * pxWindow,
+                         uint32_t ulAxis,
+                         SensorAggStats_t * pxStats );
+
+#endif /* _SENSOR_AGGREGATE_H */
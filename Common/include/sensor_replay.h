@@ -0,0 +1,111 @@
+/*
+ * FreeRTOS STM32U5 Reference Integration
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+
+#ifndef _SENSOR_REPLAY_H
+#define _SENSOR_REPLAY_H
+
+/*
+ * Sensor replay / load generator.
+ *
+ * While a source is started, the sensor publish tasks take their readings
+ * from it instead of the BSP. Samples are produced at a fixed rate from
+ * 1 Hz to 1 kHz, either from a synthetic waveform or by looping over trace
+ * rows pushed with the "replay" CLI command (see tools/replay_push.py). A
+ * sample that is due but not read before the reader's batch fills up is
+ * counted as dropped, the way a sensor FIFO overflows, so the publish path
+ * can be driven past its limits without the sensors.
+ */
+
+#include "FreeRTOS.h"
+
+#define SENSOR_REPLAY_MAX_CHANNELS    9
+#define SENSOR_REPLAY_MAX_ROWS        256
+#define SENSOR_REPLAY_MIN_RATE_HZ     1
+#define SENSOR_REPLAY_MAX_RATE_HZ     1000
+
+typedef enum
+{
+    SENSOR_REPLAY_ENV = 0,    /* temp_0_c, rh_pct, temp_1_c, baro_mbar */
+    SENSOR_REPLAY_MOTION = 1, /* accel x, y, z mG, gyro x, y, z mDPS, magneto x, y, z mGauss */
+    SENSOR_REPLAY_NUM_SOURCES
+} SensorReplaySourceId_t;
+
+typedef enum
+{
+    SENSOR_REPLAY_SYNTHETIC = 0,
+    SENSOR_REPLAY_TRACE = 1
+} SensorReplayMode_t;
+
+typedef struct
+{
+    uint32_t ulRateHz; /* 0 when stopped */
+    SensorReplayMode_t xMode;
+    uint32_t ulNumChannels;
+    uint32_t ulTraceRows;
+    uint32_t ulElapsedMs;
+    uint32_t ulSamples;   /* Samples due since the source was started */
+    uint32_t ulConsumed;  /* Samples read by the publish task */
+    uint32_t ulDropped;   /* Samples not read in time */
+    uint32_t ulPublished; /* Records published successfully */
+    uint32_t ulFailed;    /* Records that failed to publish */
+    uint32_t ulBytes;     /* Payload bytes published */
+    uint32_t ulMaxQueueDepth;
+} SensorReplayStats_t;
+
+BaseType_t xSensorReplayStart( SensorReplaySourceId_t xSource,
+                               uint32_t ulRateHz,
+                               SensorReplayMode_t xMode );
+
+void vSensorReplayStop( SensorReplaySourceId_t xSource );
+
+/* Append one trace row, only while the source is stopped */
+BaseType_t xSensorReplayAddRow( SensorReplaySourceId_t xSource,
+                                const float * pfValues,
+                                uint32_t ulNumValues );
+
+void vSensorReplayClear( SensorReplaySourceId_t xSource );
+
+BaseType_t xSensorReplayActive( SensorReplaySourceId_t xSource );
+
+/* Ticks between samples, at least one */
+TickType_t xSensorReplayPeriod( SensorReplaySourceId_t xSource );
+
+/* Read up to ulMaxSamples due samples, older samples beyond that are dropped.
+ * Each source has a single reader, its publish task. */
+uint32_t ulSensorReplayRead( SensorReplaySourceId_t xSource,
+                             float pfSamples[][ SENSOR_REPLAY_MAX_CHANNELS ],
+                             uint32_t ulMaxSamples );
+
+/* Called by the publish task after every publish attempt */
+void vSensorReplayRecordPublish( SensorReplaySourceId_t xSource,
+                                 BaseType_t xSuccess,
+                                 size_t xPayloadLen );
+
+void vSensorReplayGetStats( SensorReplaySourceId_t xSource,
+                            SensorReplayStats_t * pxStats );
+
+#endif /* _SENSOR_REPLAY_H */
@@ -0,0 +1,125 @@
+/*
+ * FreeRTOS STM32U5 Reference Integration
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+
+
+#ifndef _SENSOR_SCHED_H
+#define _SENSOR_SCHED_H
+
+/*
+ * Sensor acquisition service.
+ *
+ * A single task owns the sensor I2C bus. Every enabled sensor is read when its
+ * deadline is due, each at its own rate, and the ISM330DLC FIFO is drained on
+ * its watermark interrupt. Samples are stamped from the RTOS tick and pushed to
+ * the ring of the consumer that enabled the sensor. A ring has one producer
+ * (the acquisition task) and one consumer task, so neither side takes a lock.
+ *
+ * vSensorSchedTask must be created before any consumer calls
+ * xSensorSchedEnable. It should run above the priority of its consumers.
+ */
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#define SENSOR_SCHED_MAX_VALUES    6
+#define SENSOR_SCHED_NOTIFY_IDX    3 /* Consumer task notification index */
+#define SENSOR_SCHED_REQUEST_IDX   4 /* Enable request acknowledgement to the requesting task */
+
+typedef enum
+{
+    SENSOR_ID_HTS221 = 0, /* temp_0 C, rh % */
+    SENSOR_ID_LPS22HH,    /* temp_1 C, baro mbar */
+    SENSOR_ID_IMU,        /* accel x, y, z mG, gyro x, y, z mDPS */
+    SENSOR_ID_MAGNETO,    /* magneto x, y, z mGauss */
+    SENSOR_ID_MAX
+} SensorId_t;
+
+typedef struct
+{
+    uint32_t ulTimestampMs;
+    uint8_t ucSensor;    /* SensorId_t */
+    uint8_t ucNumValues;
+    float fValues[ SENSOR_SCHED_MAX_VALUES ];
+} SensorSample_t;
+
+typedef struct
+{
+    volatile uint32_t ulHead; /* Written by the acquisition task only */
+    volatile uint32_t ulTail; /* Written by the consumer only */
+    uint32_t ulMask;
+    uint32_t ulDropped;
+    uint32_t ulHighWater;
+    TaskHandle_t xConsumer;
+    SensorSample_t * pxSamples;
+} SensorRing_t;
+
+typedef struct
+{
+    const char * pcName;
+    float fRateHz;            /* 0 when disabled */
+    BaseType_t xUsesFifo;
+    uint32_t ulReads;         /* Bus reads, a FIFO burst counts once */
+    uint32_t ulSamples;       /* Samples pushed to the consumer ring */
+    uint32_t ulErrors;
+    uint32_t ulOverruns;      /* Deadlines missed by a whole period */
+    uint32_t ulMaxLatenessMs; /* Worst start of a read after its deadline */
+    uint32_t ulMaxReadUs;     /* Longest bus read */
+    uint32_t ulRingLength;
+    uint32_t ulRingHighWater;
+    uint32_t ulRingDropped;   /* Samples lost to a full ring, shared by the ring's sensors */
+} SensorSchedStats_t;
+
+void vSensorSchedTask( void * pvParameters );
+
+/* Allocate a ring of ulLength samples (a power of two) for the calling task */
+SensorRing_t * pxSensorRingCreate( uint32_t ulLength );
+
+/*
+ * Start reading xSensor at fRateHz into pxRing, or stop it when fRateHz is 0.
+ * Blocks until the acquisition task has configured the sensor and returns
+ * pdFALSE if it could not.
+ */
+BaseType_t xSensorSchedEnable( SensorId_t xSensor,
+                               float fRateHz,
+                               SensorRing_t * pxRing );
+
+/* Consumer side: block until new samples were pushed, pdFALSE on timeout */
+BaseType_t xSensorRingWait( TickType_t xTimeout );
+
+BaseType_t xSensorRingPop( SensorRing_t * pxRing,
+                           SensorSample_t * pxSample );
+
+/* Consumer side: discard everything queued so far */
+void vSensorRingFlush( SensorRing_t * pxRing );
+
+void vSensorSchedGetStats( SensorId_t xSensor,
+                           SensorSchedStats_t * pxStats );
+
+/* Unused stack of the acquisition task in words */
+UBaseType_t uxSensorSchedStackHighWater( void );
+
+#endif /* _SENSOR_SCHED_H */
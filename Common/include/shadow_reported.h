@@ -0,0 +1,137 @@
+/*
+ * FreeRTOS STM32U5 Reference Integration
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+#ifndef _SHADOW_REPORTED_H
+#define _SHADOW_REPORTED_H
+
+/*
+ * Incremental reported state for a device shadow.
+ *
+ * Each reported property is registered once and its current value is set
+ * whenever the device state may have changed. A property is dirty while its
+ * value differs from the value the shadow service holds, or will hold once
+ * the outstanding update is accepted. Only dirty properties are sent, as a
+ * partial "reported" document:
+ *
+ *   { "state": { "reported": { "powerOn": 1 } }, "clientToken": "021909" }
+ *
+ * Changes are coalesced: an update is due once no property changed for
+ * ulDebounceMs, or once the oldest unreported change is ulMaxDelayMs old,
+ * and never less than ulMinIntervalMs after the previous update. At most one
+ * update is outstanding; properties rejected or timed out are sent again.
+ *
+ * The registry has no RTOS dependencies and must be used from a single task,
+ * or with the caller serializing access. Properties are stored in an array
+ * provided by the caller, so a registry costs only its own property count.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Returned by ulShadowReportedTimeToSendMs when nothing is waiting to be sent */
+#define SHADOW_REPORTED_IDLE         UINT32_MAX
+
+typedef struct
+{
+    const char * pcName;    /* Key under state.reported, must not need escaping */
+    int32_t lValue;         /* Current device value */
+    int32_t lReported;      /* Value held by the shadow service */
+    int32_t lInFlight;      /* Value carried by the outstanding update */
+    uint8_t ucFlags;
+} ShadowProperty_t;
+
+typedef struct
+{
+    ShadowProperty_t * pxProps;
+    uint32_t ulMaxProps;
+    uint32_t ulNumProps;
+    uint32_t ulDebounceMs;
+    uint32_t ulMaxDelayMs;
+    uint32_t ulMinIntervalMs;
+    uint32_t ulNumDirty;
+    uint32_t ulFirstDirtyMs;    /* Time of the oldest unreported change */
+    uint32_t ulLastChangeMs;
+    uint32_t ulLastSendMs;
+    uint8_t ucInFlight;         /* An update is waiting for a response */
+    uint8_t ucHasSent;
+
+    /* Statistics */
+    uint32_t ulChanges;         /* Value changes passed to vShadowReportedSet */
+    uint32_t ulUpdates;         /* Update documents built */
+    uint32_t ulBytes;           /* Total length of those documents */
+    uint32_t ulRetries;         /* Properties sent again after a failed update */
+} ShadowReported_t;
+
+void vShadowReportedInit( ShadowReported_t * pxReported,
+                          ShadowProperty_t * pxProps,
+                          uint32_t ulMaxProps,
+                          uint32_t ulDebounceMs,
+                          uint32_t ulMaxDelayMs,
+                          uint32_t ulMinIntervalMs );
+
+/*
+ * Register a property with its initial value and return its index, or -1
+ * when the property array is full. New properties are dirty so that the first
+ * update reports the complete state.
+ */
+int32_t lShadowReportedAdd( ShadowReported_t * pxReported,
+                            const char * pcName,
+                            int32_t lValue,
+                            uint32_t ulNowMs );
+
+/* Set the current value of a property, marking it dirty if it changed */
+void vShadowReportedSet( ShadowReported_t * pxReported,
+                         int32_t lIndex,
+                         int32_t lValue,
+                         uint32_t ulNowMs );
+
+/*
+ * Time in ms until an update is due: 0 when one should be built now,
+ * SHADOW_REPORTED_IDLE when nothing is dirty or an update is outstanding.
+ */
+uint32_t ulShadowReportedTimeToSendMs( const ShadowReported_t * pxReported,
+                                       uint32_t ulNowMs );
+
+/*
+ * Write a partial reported document carrying every dirty property and mark
+ * them in flight. Returns the document length, or 0 when nothing is dirty,
+ * an update is outstanding or the document does not fit in xBufferLen.
+ */
+size_t xShadowReportedBuild( ShadowReported_t * pxReported,
+                             char * pcBuffer,
+                             size_t xBufferLen,
+                             uint32_t ulClientToken,
+                             uint32_t ulNowMs );
+
+/*
+ * Complete the outstanding update. Accepted properties become the reported
+ * values; on rejection or timeout they are dirty again.
+ */
+void vShadowReportedComplete( ShadowReported_t * pxReported,
+                              uint8_t ucAccepted,
+                              uint32_t ulNowMs );
+
+#endif /* _SHADOW_REPORTED_H */
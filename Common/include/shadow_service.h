@@ -0,0 +1,98 @@
+/*
+ * FreeRTOS STM32U5 Reference Integration
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+#ifndef _SHADOW_SERVICE_H
+#define _SHADOW_SERVICE_H
+
+/*
+ * One task serving the classic shadow and any number of named shadows of
+ * this thing. Subsystems describe their shadow with a ShadowInstance_t and
+ * register it; the service builds its update topic once, routes update
+ * responses to it through wildcard subscriptions shared by every shadow and
+ * sends its reported state incrementally (see shadow_reported.h).
+ *
+ * Delta handlers run in the MQTT agent task. vShadowServiceSet may be called
+ * from any task, including from a delta handler.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "json_scan.h"
+#include "shadow_reported.h"
+
+#define SHADOW_SERVICE_MAX_SHADOWS    32
+
+typedef struct
+{
+    /* Set by vShadowServiceInitInstance */
+    const char * pcName;                /* NULL for the classic shadow */
+    JsonScanField_t * pxDeltaFields;    /* "version" first, then the handled desired properties */
+    size_t xNumDeltaFields;
+    void * pvCtx;                       /* Passed to the delta handlers */
+    ShadowReported_t xReported;
+
+    /* Owned by the shadow service */
+    char * pcTopicUpdate;
+    uint16_t usTopicUpdateLen;
+    uint16_t usNameLen;
+    uint32_t ulVersion;                 /* Latest document version seen, MQTT agent task only */
+    uint32_t ulClientToken;             /* Token of the outstanding report, 0 when none */
+    uint32_t ulSentMs;
+    volatile uint32_t ulResponse;       /* Outcome of the outstanding report */
+} ShadowInstance_t;
+
+/*
+ * Prepare a shadow before registration. pxProps provides room for ulMaxProps
+ * reported properties. The delta field table may be NULL for a shadow that
+ * only reports.
+ */
+void vShadowServiceInitInstance( ShadowInstance_t * pxShadow,
+                                 const char * pcName,
+                                 ShadowProperty_t * pxProps,
+                                 uint32_t ulMaxProps,
+                                 JsonScanField_t * pxDeltaFields,
+                                 size_t xNumDeltaFields,
+                                 void * pvCtx );
+
+/* Add a reported property before registration, returning its index or -1 */
+int32_t lShadowServiceAddProperty( ShadowInstance_t * pxShadow,
+                                   const char * pcName,
+                                   int32_t lValue );
+
+/* Hand a prepared shadow to the service. Returns false when the name is
+ * invalid or already registered, or when SHADOW_SERVICE_MAX_SHADOWS are. */
+bool xShadowServiceRegister( ShadowInstance_t * pxShadow );
+
+/* Set the current value of a reported property of a registered shadow */
+void vShadowServiceSet( ShadowInstance_t * pxShadow,
+                        int32_t lIndex,
+                        int32_t lValue );
+
+void vShadowDeviceTask( void * pvParameters );
+
+#endif /* _SHADOW_SERVICE_H */
@@ -0,0 +1,82 @@
+/*
+ * FreeRTOS STM32U5 Reference Integration
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+#ifndef _SHADOW_TOPIC_H
+#define _SHADOW_TOPIC_H
+
+/*
+ * Device shadow topic strings for the classic and named shadows of a thing:
+ *
+ *   $aws/things/<thing>/shadow/<suffix>
+ *   $aws/things/<thing>/shadow/name/<shadow>/<suffix>
+ *
+ * A shadow name of "+" builds the topic filter matching every named shadow,
+ * so one subscription per response type serves any number of shadows.
+ * No RTOS dependencies.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Shadow names are limited to 64 characters by the service */
+#define SHADOW_TOPIC_NAME_MAX_LENGTH    64
+
+#define SHADOW_TOPIC_SUFFIX_UPDATE      "update"
+#define SHADOW_TOPIC_SUFFIX_DELTA       "update/delta"
+#define SHADOW_TOPIC_SUFFIX_ACCEPTED    "update/accepted"
+#define SHADOW_TOPIC_SUFFIX_REJECTED    "update/rejected"
+
+typedef enum
+{
+    SHADOW_TOPIC_UNKNOWN = 0,
+    SHADOW_TOPIC_DELTA,
+    SHADOW_TOPIC_ACCEPTED,
+    SHADOW_TOPIC_REJECTED
+} ShadowTopicType_t;
+
+/*
+ * Write a NUL terminated topic into pcBuffer and return its length, or 0 when
+ * it does not fit. A NULL pcName builds a topic of the classic shadow.
+ */
+size_t xShadowTopicBuild( char * pcBuffer,
+                          size_t xBufferLen,
+                          const char * pcThing,
+                          size_t xThingLen,
+                          const char * pcName,
+                          const char * pcSuffix );
+
+/*
+ * Classify an update response topic of the given thing. The shadow name is
+ * returned in ppcName and pxNameLen, NULL and 0 for the classic shadow.
+ */
+ShadowTopicType_t xShadowTopicParse( const char * pcTopic,
+                                     size_t xTopicLen,
+                                     const char * pcThing,
+                                     size_t xThingLen,
+                                     const char ** ppcName,
+                                     size_t * pxNameLen );
+
+#endif /* _SHADOW_TOPIC_H */
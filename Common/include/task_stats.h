@@ -0,0 +1,143 @@
+/*
+ * FreeRTOS STM32U5 Reference Integration
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+
+#ifndef _TASK_STATS_H
+#define _TASK_STATS_H
+
+/*
+ * Windowed CPU usage sampler used by the "top" CLI command.
+ *
+ * Per task run time comes from the kernel run time stats counter. Context
+ * switches are counted in a thread local storage slot from the
+ * traceTASK_SWITCHED_IN hook and interrupt time is accumulated by the
+ * vTraceIsrEnter / vTraceIsrExit macros in the instrumented handlers.
+ *
+ * The sampler only uses kernel APIs and the taskstatsGET_CYCLE_COUNT macro,
+ * so it can be built for the FreeRTOS POSIX port by defining
+ * taskstatsGET_CYCLE_COUNT and taskstatsCYCLE_COUNT_HZ in FreeRTOSConfig.h.
+ *
+ * This header is included by FreeRTOSConfig.h, so it must not depend on any
+ * FreeRTOS types.
+ */
+
+#include <stdint.h>
+
+/* Thread local storage slot used for the per task context switch counter */
+#define TASK_STATS_TLS_INDEX    2
+
+/* Number of distinct interrupt handlers that can be timed */
+#define TASK_STATS_MAX_IRQS     8
+
+/* Number of tasks whose counters are kept between ulTaskStatsInterval calls */
+#define TASK_STATS_INTERVAL_TASKS    32
+
+typedef struct
+{
+    const char * pcTaskName;
+    uint32_t ulTaskNumber;
+    uint32_t ulRunTime;            /* Run time counter ticks spent in the task during the window */
+    uint32_t ulSwitches;           /* Times the task was switched in during the window */
+    uint16_t usStackHighWaterMark; /* In words */
+    uint8_t ucPriority;
+    uint8_t ucState;               /* eTaskState */
+} TaskStatsEntry_t;
+
+typedef struct
+{
+    uint32_t ulIrqNumber;
+    uint32_t ulCount;  /* Handler invocations during the window */
+    uint32_t ulCycles; /* Cycles spent in the handler during the window */
+} TaskStatsIsrEntry_t;
+
+typedef struct
+{
+    uint32_t ulWindowTicks;   /* Length of the window in kernel ticks */
+    uint32_t ulWindowRunTime; /* Length of the window in run time counter ticks */
+    uint32_t ulCycleHz;       /* Frequency of the counter used for ulCycles */
+    uint32_t ulNumIsrs;
+    TaskStatsIsrEntry_t xIsrs[ TASK_STATS_MAX_IRQS ];
+} TaskStatsSummary_t;
+
+typedef struct
+{
+    uint32_t ulTaskNumber;
+    uint32_t ulRunTime;
+    uint32_t ulSwitches;
+} TaskStatsCounters_t;
+
+typedef struct
+{
+    uint32_t ulRunTime; /* Total run time counter at the previous call */
+    uint32_t ulNumTasks;
+    TaskStatsCounters_t xTasks[ TASK_STATS_INTERVAL_TASKS ];
+} TaskStatsInterval_t;
+
+/*
+ * Sample the system state, wait ulWindowMs and sample it again.
+ * Fills up to ulMaxEntries entries with the per task deltas, sorted by
+ * decreasing run time, and returns the number of entries filled.
+ * Task names point into the task control blocks and are only valid while
+ * the tasks exist.
+ */
+uint32_t ulTaskStatsSample( uint32_t ulWindowMs,
+                            TaskStatsEntry_t * pxEntries,
+                            uint32_t ulMaxEntries,
+                            TaskStatsSummary_t * pxSummary );
+
+/*
+ * Non blocking variant for periodic reporters. Fills up to ulMaxEntries
+ * entries with the per task deltas since the previous call with the same
+ * pxInterval, sorted by decreasing run time, and sets *pulWindowRunTime to
+ * the length of that interval in run time counter ticks. A zeroed pxInterval
+ * reports the run time since boot. Task names are only valid while the tasks
+ * exist, as for ulTaskStatsSample.
+ */
+uint32_t ulTaskStatsInterval( TaskStatsInterval_t * pxInterval,
+                              TaskStatsEntry_t * pxEntries,
+                              uint32_t ulMaxEntries,
+                              uint32_t * pulWindowRunTime );
+
+void vTaskStatsIsrEnter( uint32_t ulIrqNumber );
+void vTaskStatsIsrExit( uint32_t ulIrqNumber );
+
+extern void * volatile pvTaskStatsLastTcb;
+
+/*
+ * Expanded inside tasks.c by traceTASK_SWITCHED_IN. Counts the switch in the
+ * incoming task's thread local storage slot when the running task changes.
+ */
+#define taskstatsTASK_SWITCHED_IN()                                                      \
+    do {                                                                                 \
+        if( pvTaskStatsLastTcb != ( void * ) pxCurrentTCB )                              \
+        {                                                                                \
+            pvTaskStatsLastTcb = ( void * ) pxCurrentTCB;                                \
+            pxCurrentTCB->pvThreadLocalStoragePointers[ TASK_STATS_TLS_INDEX ] =         \
+                ( void * ) ( ( uintptr_t ) pxCurrentTCB->pvThreadLocalStoragePointers[ TASK_STATS_TLS_INDEX ] + 1 ); \
+        }                                                                                \
+    } while( 0 )
+
+#endif /* _TASK_STATS_H */
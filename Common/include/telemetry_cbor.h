@@ -0,0 +1,137 @@
+/*
+ * FreeRTOS STM32U5 Reference Integration
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+
+#ifndef _TELEMETRY_CBOR_H
+#define _TELEMETRY_CBOR_H
+
+/*
+ * Compact CBOR encoding for sensor telemetry.
+ *
+ * A record is a CBOR array holding the schema id followed by one value per
+ * schema field, in schema order. Field names are not sent with the data:
+ * they are described once per connection by a schema message published on
+ * "<topic>/schema":
+ *
+ *   { "id": <id>, "rpt": <index>, "f": [ [ <name>, <type>, <exponent> ], ... ],
+ *     "g": [ <label>, ... ] }
+ *
+ * Fields from index "rpt" onward repeat until the end of the record, which
+ * allows variable length batches. An "rpt" equal to the number of fields
+ * means the record has exactly one value per field. The optional "g" list
+ * names successive repetitions, e.g. the axis each group of statistics
+ * belongs to. Fixed point fields carry the integer
+ * round( value * 10^-exponent ), half float fields an IEEE 754 binary16.
+ * Neither needs the newlib float formatter.
+ *
+ * Channels compressed with telemetry_delta are sent as keyframes and delta
+ * records. A keyframe is a normal record whose first field is the sequence
+ * number. A delta record carries the schema id with TELEMETRY_DELTA_ID_FLAG
+ * set, the sequence number, a bit mask of the channels that changed and the
+ * change of each of those channels. A receiver applies a delta record only if
+ * its sequence number follows the previous record, otherwise it waits for the
+ * next keyframe.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cbor.h"
+
+#include "telemetry_delta.h"
+
+#define TELEMETRY_DELTA_ID_FLAG    0x8000
+
+typedef enum
+{
+    TELEMETRY_FORMAT_JSON = 0,
+    TELEMETRY_FORMAT_CBOR = 1
+} TelemetryFormat_t;
+
+typedef enum
+{
+    TELEMETRY_FIELD_FIXED = 0,
+    TELEMETRY_FIELD_HALF = 1
+} TelemetryFieldType_t;
+
+typedef struct
+{
+    const char * pcName;
+    TelemetryFieldType_t xType;
+    int8_t cExponent; /* Fixed point only, e.g. -2 for a resolution of 0.01 */
+} TelemetryField_t;
+
+typedef struct
+{
+    uint16_t usId;
+    uint16_t usRepeatFrom;
+    uint32_t ulNumFields;
+    const TelemetryField_t * pxFields;
+    uint32_t ulNumGroups;
+    const char * const * ppcGroups;
+} TelemetrySchema_t;
+
+typedef struct
+{
+    CborEncoder xRoot;
+    CborEncoder xRecord;
+    const uint8_t * pucBuf;
+    const TelemetrySchema_t * pxSchema;
+    uint32_t ulField;
+    CborError xError;
+} TelemetryEncoder_t;
+
+/* Encode the schema description, returns the length or 0 if it does not fit */
+size_t xTelemetryEncodeSchema( const TelemetrySchema_t * pxSchema,
+                               uint8_t * pucBuf,
+                               size_t xBufLen );
+
+void vTelemetryBegin( TelemetryEncoder_t * pxEncoder,
+                      const TelemetrySchema_t * pxSchema,
+                      uint8_t * pucBuf,
+                      size_t xBufLen );
+
+/* Encode the next field from a value in the field's units */
+void vTelemetryAddFloat( TelemetryEncoder_t * pxEncoder,
+                         float fValue );
+
+/* Encode the next field from an integer that is already scaled */
+void vTelemetryAddInt( TelemetryEncoder_t * pxEncoder,
+                       int64_t llValue );
+
+/* Close the record, returns the length or 0 if it did not fit */
+size_t xTelemetryEnd( TelemetryEncoder_t * pxEncoder );
+
+/* Encode the last xTelemetryDeltaUpdate result, channel i is schema field i + 1 */
+size_t xTelemetryEncodeDelta( const TelemetrySchema_t * pxSchema,
+                              const TelemetryDelta_t * pxDelta,
+                              TelemetryDeltaAction_t xAction,
+                              uint8_t * pucBuf,
+                              size_t xBufLen );
+
+uint16_t usTelemetryFloatToHalf( float fValue );
+
+#endif /* _TELEMETRY_CBOR_H */
@@ -0,0 +1,86 @@
+/*
+ * FreeRTOS STM32U5 Reference Integration
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+
+#ifndef _TELEMETRY_DELTA_H
+#define _TELEMETRY_DELTA_H
+
+/*
+ * Keyframe / delta compression for periodic multi channel telemetry.
+ *
+ * Channel values are fixed point integers. Each update is compared against
+ * the value the receiver last reconstructed: channels that moved by no more
+ * than their dead band are not sent, so the reconstruction error of every
+ * channel is bounded by its dead band and does not accumulate. When no
+ * channel changed the update is suppressed entirely. A keyframe carrying
+ * every channel is sent every ulKeyframeInterval updates, and whenever one is
+ * requested, so that a receiver can resynchronize after a lost record.
+ *
+ * The compressor has no RTOS or encoding dependencies.
+ */
+
+#include <stdint.h>
+
+#define TELEMETRY_DELTA_MAX_CHANNELS    16
+
+typedef enum
+{
+    TELEMETRY_DELTA_SKIP = 0,
+    TELEMETRY_DELTA_KEYFRAME,
+    TELEMETRY_DELTA_UPDATE
+} TelemetryDeltaAction_t;
+
+typedef struct
+{
+    uint32_t ulNumChannels;
+    uint32_t ulKeyframeInterval;
+    uint32_t ulSinceKeyframe;
+    uint32_t ulSeq;             /* Incremented for every record sent */
+    uint32_t ulChangedMask;     /* Channels carried by the last update */
+    uint8_t ucNeedKeyframe;
+    int64_t pllDeadband[ TELEMETRY_DELTA_MAX_CHANNELS ];
+    int64_t pllLast[ TELEMETRY_DELTA_MAX_CHANNELS ];  /* Receiver's view of each channel */
+    int64_t pllDelta[ TELEMETRY_DELTA_MAX_CHANNELS ]; /* Deltas of the last update */
+} TelemetryDelta_t;
+
+/* A keyframe interval of 0 or 1 sends every update as a keyframe */
+void vTelemetryDeltaInit( TelemetryDelta_t * pxDelta,
+                          uint32_t ulNumChannels,
+                          const uint32_t * pulDeadbands,
+                          uint32_t ulKeyframeInterval );
+
+/* Request a keyframe on the next update, e.g. after a record was lost */
+void vTelemetryDeltaForceKeyframe( TelemetryDelta_t * pxDelta );
+
+/* Decide what to send for one set of channel values and update the state */
+TelemetryDeltaAction_t xTelemetryDeltaUpdate( TelemetryDelta_t * pxDelta,
+                                              const int64_t * pllValues );
+
+/* Round a value to the fixed point representation 10^-cExponent units */
+int64_t llTelemetryQuantize( float fValue,
+                             int8_t cExponent );
+
+#endif /* _TELEMETRY_DELTA_H */
@@ -0,0 +1,151 @@
+/*
+ * FreeRTOS STM32U5 Reference Integration
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+
+#ifndef _TRACE_RING_H
+#define _TRACE_RING_H
+
+/*
+ * Binary event trace recorder.
+ *
+ * Events are stored in a fixed size RAM ring and can be dumped with the
+ * "trace" CLI command. tools/trace_to_json.py converts a dump to the Chrome
+ * trace event format, which can be loaded in chrome://tracing or Perfetto.
+ *
+ * This header is included by FreeRTOSConfig.h to install the kernel trace
+ * hooks, so it must not depend on any FreeRTOS types.
+ */
+
+#include <stdint.h>
+
+#include "task_stats.h"
+
+/* Set to 0 to remove the recorder and all of its hooks */
+#ifndef TRACE_RING_ENABLED
+#define TRACE_RING_ENABLED    1
+#endif
+
+/* Number of events in the ring, must be a power of two (16 bytes each) */
+#define TRACE_RING_LEN        1024
+
+/* Event types */
+#define TRACE_EVT_TASK_SWITCH       0x01 /* ulArg: unused */
+#define TRACE_EVT_QUEUE_SEND        0x10 /* ulArg: queue address, ucFlags: queue type */
+#define TRACE_EVT_QUEUE_RECEIVE     0x11
+#define TRACE_EVT_QUEUE_BLOCK_SEND  0x12
+#define TRACE_EVT_QUEUE_BLOCK_RECV  0x13
+#define TRACE_EVT_ISR_ENTER         0x20 /* ulArg: IRQ number */
+#define TRACE_EVT_ISR_EXIT          0x21
+#define TRACE_EVT_USER_BEGIN        0x30 /* ulArg: label (const char *) */
+#define TRACE_EVT_USER_END          0x31
+#define TRACE_EVT_USER_VALUE        0x32 /* ulArg: label, ulValue: value */
+
+/* Event classes, used to select what is recorded */
+#define TRACE_CLASS_SCHED    0x1
+#define TRACE_CLASS_QUEUE    0x2
+#define TRACE_CLASS_ISR      0x4
+#define TRACE_CLASS_USER     0x8
+#define TRACE_CLASS_ALL      0xF
+
+typedef struct
+{
+    uint32_t ulTimestamp; /* DWT cycle counter */
+    uint8_t ucType;
+    uint8_t ucFlags;
+    uint16_t usTask;      /* Task number (uxTaskGetTaskNumber) of the running task */
+    uint32_t ulArg;
+    uint32_t ulValue;
+} TraceEvent_t;
+
+#if TRACE_RING_ENABLED
+
+extern volatile uint32_t ulTraceClassMask;
+
+void vTraceRingStart( uint32_t ulClassMask );
+void vTraceRingStop( void );
+uint32_t ulTraceRingRead( uint32_t ulIndex,
+                          TraceEvent_t * pxEvent );
+uint32_t ulTraceRingLost( void );
+
+void vTraceRingRecordValue( uint32_t ulClass,
+                            uint8_t ucType,
+                            uint8_t ucFlags,
+                            uint32_t ulArg,
+                            uint32_t ulValue );
+
+/* The class mask is checked inline so that disabled hooks cost a load and a branch */
+#define vTraceRingRecord( ulClass, ucType, ucFlags, ulArg )                           \
+    do {                                                                             \
+        if( ( ulTraceClassMask & ( ulClass ) ) != 0 ) {                              \
+            vTraceRingRecordValue( ( ulClass ), ( ucType ), ( ucFlags ), ( ulArg ), 0 ); \
+        }                                                                            \
+    } while( 0 )
+void vTraceRingTaskSwitchedIn( uint32_t ulTaskNumber );
+
+/* User events, pcLabel must be a string literal or otherwise outlive the trace */
+#define vTraceBegin( pcLabel )    vTraceRingRecord( TRACE_CLASS_USER, TRACE_EVT_USER_BEGIN, 0, ( uint32_t ) ( pcLabel ) )
+#define vTraceEnd( pcLabel )      vTraceRingRecord( TRACE_CLASS_USER, TRACE_EVT_USER_END, 0, ( uint32_t ) ( pcLabel ) )
+#define vTraceValue( pcLabel, ulValue ) \
+    vTraceRingRecordValue( TRACE_CLASS_USER, TRACE_EVT_USER_VALUE, 0, ( uint32_t ) ( pcLabel ), ( ulValue ) )
+
+/* Interrupt handlers, also timed for the task stats sampler */
+#define vTraceIsrEnter( irqn )                                                                   \
+    do {                                                                                         \
+        vTaskStatsIsrEnter( ( uint32_t ) ( irqn ) );                                             \
+        vTraceRingRecord( TRACE_CLASS_ISR, TRACE_EVT_ISR_ENTER, 0, ( uint32_t ) ( irqn ) );     \
+    } while( 0 )
+#define vTraceIsrExit( irqn )                                                                    \
+    do {                                                                                         \
+        vTraceRingRecord( TRACE_CLASS_ISR, TRACE_EVT_ISR_EXIT, 0, ( uint32_t ) ( irqn ) );      \
+        vTaskStatsIsrExit( ( uint32_t ) ( irqn ) );                                              \
+    } while( 0 )
+
+/* Kernel hooks. These are expanded inside tasks.c and queue.c. */
+#define traceTASK_SWITCHED_IN()                                   \
+    do {                                                          \
+        taskstatsTASK_SWITCHED_IN();                              \
+        vTraceRingTaskSwitchedIn( pxCurrentTCB->uxTCBNumber );    \
+    } while( 0 )
+#define traceQUEUE_SEND( pxQueue )                    vTraceRingRecord( TRACE_CLASS_QUEUE, TRACE_EVT_QUEUE_SEND, ( pxQueue )->ucQueueType, ( uint32_t ) ( pxQueue ) )
+#define traceQUEUE_SEND_FROM_ISR( pxQueue )           traceQUEUE_SEND( pxQueue )
+#define traceQUEUE_RECEIVE( pxQueue )                 vTraceRingRecord( TRACE_CLASS_QUEUE, TRACE_EVT_QUEUE_RECEIVE, ( pxQueue )->ucQueueType, ( uint32_t ) ( pxQueue ) )
+#define traceQUEUE_RECEIVE_FROM_ISR( pxQueue )        traceQUEUE_RECEIVE( pxQueue )
+#define traceBLOCKING_ON_QUEUE_SEND( pxQueue )        vTraceRingRecord( TRACE_CLASS_QUEUE, TRACE_EVT_QUEUE_BLOCK_SEND, ( pxQueue )->ucQueueType, ( uint32_t ) ( pxQueue ) )
+#define traceBLOCKING_ON_QUEUE_RECEIVE( pxQueue )     vTraceRingRecord( TRACE_CLASS_QUEUE, TRACE_EVT_QUEUE_BLOCK_RECV, ( pxQueue )->ucQueueType, ( uint32_t ) ( pxQueue ) )
+
+#else /* TRACE_RING_ENABLED */
+
+#define vTraceBegin( pcLabel )
+#define vTraceEnd( pcLabel )
+#define vTraceValue( pcLabel, ulValue )
+#define vTraceIsrEnter( irqn )    vTaskStatsIsrEnter( ( uint32_t ) ( irqn ) )
+#define vTraceIsrExit( irqn )     vTaskStatsIsrExit( ( uint32_t ) ( irqn ) )
+
+#define traceTASK_SWITCHED_IN()    taskstatsTASK_SWITCHED_IN()
+
+#endif /* TRACE_RING_ENABLED */
+
+#endif /* _TRACE_RING_H */
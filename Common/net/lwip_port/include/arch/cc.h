@@ -38,6 +38,10 @@
 #define LOG_LEVEL    LOG_ERROR
 #endif
 
+#ifndef LOG_MODULE
+#define LOG_MODULE    LOG_MODULE_NET
+#endif
+
 #include "logging.h"
 
 /* Include some files for defining library routines */
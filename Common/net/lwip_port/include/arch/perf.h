@@ -34,7 +34,78 @@
 #ifndef __PERF_H__
 #define __PERF_H__
 
-#define PERF_START     /* null definition */
-#define PERF_STOP( x ) /* null definition */
+#include "lwipopts.h"
+
+#if LWIP_PERF
+
+#include <stdint.h>
+
+/* Maximum number of distinct PERF_STOP() sites tracked. Samples from
+ * additional sites are counted in ulLwipPerfDroppedSamples. */
+#ifndef LWIP_PERF_MAX_SITES
+#define LWIP_PERF_MAX_SITES          16
+#endif
+
+/* Histogram bucket n counts samples in the range [ 2^n, 2^(n+1) ).
+ * The last bucket also collects everything above its lower bound. */
+#ifndef LWIP_PERF_HISTOGRAM_BUCKETS
+#define LWIP_PERF_HISTOGRAM_BUCKETS  24
+#endif
+
+typedef struct
+{
+    const char * pcName;
+    uint32_t ulSamples;
+    uint32_t ulMin;
+    uint32_t ulMax;
+    uint64_t ullTotal;
+    uint32_t pulHistogram[ LWIP_PERF_HISTOGRAM_BUCKETS ];
+} LwipPerfSite_t;
+
+/* Enable the cycle counter. Called from sys_init(). */
+void vLwipPerfInit( void );
+
+/* Current value of the free running counter. Cycles on target (DWT),
+ * nanoseconds when built against the POSIX simulator port. */
+uint32_t ulLwipPerfGetCount( void );
+
+/* Value of a call site's cached index before its first sample */
+#define LWIP_PERF_SITE_UNRESOLVED    UINT32_MAX
+
+/* Record a sample for the site named pcName. *pulSiteIndex caches the slot
+ * of the site: it is resolved by name on the first call only, so later
+ * samples do not search the site table. */
+void vLwipPerfRecordSite( uint32_t * pulSiteIndex,
+                          const char * pcName,
+                          uint32_t ulCount );
+
+/* Copy the statistics for site ulIndex into pxSite.
+ * Returns 0 when ulIndex is past the last populated site, 1 otherwise. */
+uint32_t ulLwipPerfGetSite( uint32_t ulIndex,
+                            LwipPerfSite_t * pxSite );
+
+/* Clear the collected samples. Registered sites keep their slots. */
+void vLwipPerfReset( void );
+
+extern volatile uint32_t ulLwipPerfDroppedSamples;
+
+/* Each expansion of PERF_RECORD owns a static holding its resolved site index */
+#define PERF_RECORD( x, count )                                                       \
+    do                                                                                \
+    {                                                                                 \
+        static uint32_t ulPerfSiteIndex = LWIP_PERF_SITE_UNRESOLVED;                  \
+        vLwipPerfRecordSite( &ulPerfSiteIndex, ( x ), ( count ) );                    \
+    } while( 0 )
+
+#define PERF_START        uint32_t ulPerfStartCount = ulLwipPerfGetCount()
+#define PERF_STOP( x )    PERF_RECORD( ( x ), ulLwipPerfGetCount() - ulPerfStartCount )
+
+#else /* LWIP_PERF */
+
+#define PERF_START              /* null definition */
+#define PERF_STOP( x )          /* null definition */
+#define PERF_RECORD( x, count ) /* null definition */
+
+#endif /* LWIP_PERF */
 
 #endif /* __PERF_H__ */
@@ -37,25 +37,69 @@
 #include "queue.h"
 #include "semphr.h"
 
+#include "lwipopts.h"
+
 #define SYS_MBOX_NULL                     ( ( QueueHandle_t ) NULL )
 #define SYS_SEM_NULL                      ( ( SemaphoreHandle_t ) NULL )
 #define SYS_DEFAULT_THREAD_STACK_DEPTH    configMINIMAL_STACK_SIZE
 
-typedef SemaphoreHandle_t   sys_sem_t;
-typedef SemaphoreHandle_t   sys_mutex_t;
-typedef TaskHandle_t        sys_thread_t;
+/* Task notification indices reserved for the lwIP port. A task waiting on an
+ * lwIP mailbox is woken on LWIP_MBOX_NOTIFY_IDX and a task waiting on its
+ * per-thread netconn semaphore on LWIP_SEM_NOTIFY_IDX. */
+#define LWIP_MBOX_NOTIFY_IDX              6
+#define LWIP_SEM_NOTIFY_IDX               7
+
+#if configTASK_NOTIFICATION_ARRAY_ENTRIES <= LWIP_SEM_NOTIFY_IDX
+#error "lwIP FreeRTOS port requires configTASK_NOTIFICATION_ARRAY_ENTRIES > LWIP_SEM_NOTIFY_IDX"
+#endif
+
+typedef TaskHandle_t sys_thread_t;
+
+/* Semaphores with a single known waiter (the per-thread netconn semaphore)
+ * are implemented as a direct to task notification to xOwner. All other
+ * semaphores use a FreeRTOS binary semaphore. */
+struct sys_sem
+{
+    SemaphoreHandle_t xSemaphore;
+    TaskHandle_t xOwner;
+};
+typedef struct sys_sem sys_sem_t;
+
+struct sys_mutex
+{
+    SemaphoreHandle_t xMutex;
+#if LWIP_PERF
+    uint32_t ulLockedAt;
+#endif
+};
+typedef struct sys_mutex sys_mutex_t;
 
+/* Mailboxes are a ring of message pointers guarded by the lwIP protection
+ * level. One task at a time waits in a fetch (xTask) and is woken with a task
+ * notification. A second fetching task waits on xFetchFree until the first
+ * one leaves, which gives it while ulFetchersWaiting is non-zero. Any number
+ * of tasks may post, so posters blocked on a full mailbox wait on xNotFull,
+ * which is given once per removed message while ulPostersWaiting is non-zero. */
 struct sys_mbox
 {
-    QueueHandle_t xMbox;
+    void ** ppvMsgs;
+    uint32_t ulSize;
+    uint32_t ulHead;
+    uint32_t ulCount;
     TaskHandle_t xTask;
+    SemaphoreHandle_t xFetchFree;
+    uint32_t ulFetchersWaiting;
+    SemaphoreHandle_t xNotFull;
+    uint32_t ulPostersWaiting;
 };
 typedef struct sys_mbox sys_mbox_t;
 
-#define sys_mbox_valid( x )          ( ( ( ( x ) == NULL ) || ( ( x )->xMbox == NULL ) ) ? pdFALSE : pdTRUE )
-#define sys_mbox_set_invalid( x )    do { if( ( x ) != NULL ) { ( x )->xMbox = NULL; ( x )->xTask = NULL; } } while( 0 )
-#define sys_sem_valid( x )           ( ( ( * x ) == NULL ) ? pdFALSE : pdTRUE )
-#define sys_sem_set_invalid( x )     ( ( * x ) = NULL )
+#define sys_mbox_valid( x )          ( ( ( ( x ) == NULL ) || ( ( x )->ppvMsgs == NULL ) ) ? pdFALSE : pdTRUE )
+#define sys_mbox_set_invalid( x )    do { if( ( x ) != NULL ) { ( x )->ppvMsgs = NULL; ( x )->xTask = NULL; } } while( 0 )
+#define sys_sem_valid( x )           ( ( ( ( x )->xSemaphore == NULL ) && ( ( x )->xOwner == NULL ) ) ? pdFALSE : pdTRUE )
+#define sys_sem_set_invalid( x )     do { ( x )->xSemaphore = NULL; ( x )->xOwner = NULL; } while( 0 )
+#define sys_mutex_valid( x )         ( ( ( x )->xMutex == NULL ) ? pdFALSE : pdTRUE )
+#define sys_mutex_set_invalid( x )   ( ( x )->xMutex = NULL )
 
 
 #define sys_assert( pcMessage )                                 \
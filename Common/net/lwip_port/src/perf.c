@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+/* Backing implementation for the PERF_START / PERF_STOP hooks in arch/perf.h.
+ * Each distinct PERF_STOP() site gets a slot with min / max / total and a
+ * log2 histogram of the elapsed counter ticks. */
+
+#include "arch/perf.h"
+
+#if LWIP_PERF
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <string.h>
+
+#if defined( __ARM_ARCH )
+#include "dwt_cycles.h"
+#else
+#include <time.h>
+#endif
+
+static LwipPerfSite_t xPerfSites[ LWIP_PERF_MAX_SITES ] = { 0 };
+static uint32_t ulNumPerfSites = 0;
+
+volatile uint32_t ulLwipPerfDroppedSamples = 0;
+
+/*-----------------------------------------------------------*/
+
+void vLwipPerfInit( void )
+{
+#if defined( __ARM_ARCH )
+    vDwtCycleCounterEnable();
+#endif
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t ulLwipPerfGetCount( void )
+{
+#if defined( __ARM_ARCH )
+    return DWT->CYCCNT;
+#else
+    struct timespec xNow;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &xNow );
+
+    return ( uint32_t ) ( ( ( uint64_t ) xNow.tv_sec * 1000000000ULL ) + ( uint64_t ) xNow.tv_nsec );
+#endif
+}
+
+/*-----------------------------------------------------------*/
+
+static inline uint32_t ulHistogramBucket( uint32_t ulCount )
+{
+    uint32_t ulBucket = 0;
+
+    if( ulCount > 1 )
+    {
+        ulBucket = 31 - __builtin_clz( ulCount );
+    }
+
+    if( ulBucket >= LWIP_PERF_HISTOGRAM_BUCKETS )
+    {
+        ulBucket = LWIP_PERF_HISTOGRAM_BUCKETS - 1;
+    }
+
+    return ulBucket;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Called with interrupts masked. Returns LWIP_PERF_SITE_UNRESOLVED when the table is full. */
+static uint32_t ulLookupSite( const char * pcName )
+{
+    uint32_t ulIndex = LWIP_PERF_SITE_UNRESOLVED;
+
+    /* Sites are normally string literals, so the pointer comparison hits first.
+     * Fall back to strcmp since identical literals in different translation
+     * units are not guaranteed to share storage. */
+    for( uint32_t i = 0; i < ulNumPerfSites; i++ )
+    {
+        if( ( xPerfSites[ i ].pcName == pcName ) ||
+            ( strcmp( xPerfSites[ i ].pcName, pcName ) == 0 ) )
+        {
+            ulIndex = i;
+            break;
+        }
+    }
+
+    if( ( ulIndex == LWIP_PERF_SITE_UNRESOLVED ) &&
+        ( ulNumPerfSites < LWIP_PERF_MAX_SITES ) )
+    {
+        ulIndex = ulNumPerfSites;
+        xPerfSites[ ulIndex ].pcName = pcName;
+        xPerfSites[ ulIndex ].ulMin = UINT32_MAX;
+        ulNumPerfSites++;
+    }
+
+    return ulIndex;
+}
+
+/*-----------------------------------------------------------*/
+
+void vLwipPerfRecordSite( uint32_t * pulSiteIndex,
+                          const char * pcName,
+                          uint32_t ulCount )
+{
+    UBaseType_t uxSavedInterruptStatus;
+    uint32_t ulIndex;
+
+    /* PERF_STOP may be reached from the netif input path in interrupt context. */
+    uxSavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+
+    ulIndex = *pulSiteIndex;
+
+    /* Only the first sample of a call site (or every sample once the table is full) searches by name */
+    if( ulIndex == LWIP_PERF_SITE_UNRESOLVED )
+    {
+        ulIndex = ulLookupSite( pcName );
+        *pulSiteIndex = ulIndex;
+    }
+
+    if( ulIndex != LWIP_PERF_SITE_UNRESOLVED )
+    {
+        LwipPerfSite_t * pxSite = &( xPerfSites[ ulIndex ] );
+
+        pxSite->ulSamples++;
+        pxSite->ullTotal += ulCount;
+
+        if( ulCount < pxSite->ulMin )
+        {
+            pxSite->ulMin = ulCount;
+        }
+
+        if( ulCount > pxSite->ulMax )
+        {
+            pxSite->ulMax = ulCount;
+        }
+
+        pxSite->pulHistogram[ ulHistogramBucket( ulCount ) ]++;
+    }
+    else
+    {
+        ulLwipPerfDroppedSamples++;
+    }
+
+    taskEXIT_CRITICAL_FROM_ISR( uxSavedInterruptStatus );
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t ulLwipPerfGetSite( uint32_t ulIndex,
+                            LwipPerfSite_t * pxSite )
+{
+    uint32_t ulResult = 0;
+    UBaseType_t uxSavedInterruptStatus;
+
+    configASSERT( pxSite != NULL );
+
+    uxSavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+
+    if( ulIndex < ulNumPerfSites )
+    {
+        ( void ) memcpy( pxSite, &( xPerfSites[ ulIndex ] ), sizeof( LwipPerfSite_t ) );
+        ulResult = 1;
+    }
+
+    taskEXIT_CRITICAL_FROM_ISR( uxSavedInterruptStatus );
+
+    return ulResult;
+}
+
+/*-----------------------------------------------------------*/
+
+void vLwipPerfReset( void )
+{
+    UBaseType_t uxSavedInterruptStatus;
+
+    uxSavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+
+    /* Call sites cache their slot index, so the slots stay assigned */
+    for( uint32_t i = 0; i < ulNumPerfSites; i++ )
+    {
+        LwipPerfSite_t * pxSite = &( xPerfSites[ i ] );
+
+        pxSite->ulSamples = 0;
+        pxSite->ulMin = UINT32_MAX;
+        pxSite->ulMax = 0;
+        pxSite->ullTotal = 0;
+        ( void ) memset( pxSite->pulHistogram, 0, sizeof( pxSite->pulHistogram ) );
+    }
+
+    ulLwipPerfDroppedSamples = 0;
+
+    taskEXIT_CRITICAL_FROM_ISR( uxSavedInterruptStatus );
+}
+
+#endif /* LWIP_PERF */
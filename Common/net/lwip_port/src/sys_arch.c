@@ -38,6 +38,7 @@
 
 /* ------------------------ System architecture includes ----------------------------- */
 #include "arch/sys_arch.h"
+#include "arch/perf.h"
 #include "logging.h"
 
 /* ------------------------ lwIP includes --------------------------------- */
@@ -61,6 +62,126 @@
  * the interrupt handler setting this variable manually. */
 portBASE_TYPE xInsideISR = pdFALSE;
 
+/*---------------------------------------------------------------------------*
+* Routine:  prvMboxPush / prvMboxPop
+*---------------------------------------------------------------------------*
+* Description:
+*      Add or remove a message from the mailbox ring. The ring is only
+*      accessed with interrupts masked up to configMAX_SYSCALL_INTERRUPT_PRIORITY,
+*      so both functions may be called from a task or from an interrupt.
+*      prvMboxPush returns the task currently fetching from the mailbox (if
+*      any) in pxWaiter so that the caller can wake it. prvMboxPop returns
+*      pdTRUE in pxPosterWaiting when a poster is blocked on the full mailbox,
+*      so that the caller can release it with prvMboxWakePoster.
+*---------------------------------------------------------------------------*/
+static BaseType_t prvMboxPush( sys_mbox_t * pxMailBox,
+                               void * pvMessage,
+                               TaskHandle_t * pxWaiter )
+{
+    BaseType_t xResult = pdFALSE;
+    UBaseType_t uxSavedInterruptStatus;
+
+    uxSavedInterruptStatus = portSET_INTERRUPT_MASK_FROM_ISR();
+
+    if( ( pxMailBox->ppvMsgs != NULL ) &&
+        ( pxMailBox->ulCount < pxMailBox->ulSize ) )
+    {
+        uint32_t ulTail = pxMailBox->ulHead + pxMailBox->ulCount;
+
+        if( ulTail >= pxMailBox->ulSize )
+        {
+            ulTail -= pxMailBox->ulSize;
+        }
+
+        pxMailBox->ppvMsgs[ ulTail ] = pvMessage;
+        pxMailBox->ulCount++;
+        *pxWaiter = pxMailBox->xTask;
+        xResult = pdTRUE;
+    }
+
+    portCLEAR_INTERRUPT_MASK_FROM_ISR( uxSavedInterruptStatus );
+
+    return xResult;
+}
+
+/* Must be called with interrupts masked */
+static void prvMboxRemove( sys_mbox_t * pxMailBox,
+                           void ** ppvMessage,
+                           BaseType_t * pxPosterWaiting )
+{
+    *ppvMessage = pxMailBox->ppvMsgs[ pxMailBox->ulHead ];
+    pxMailBox->ulHead++;
+
+    if( pxMailBox->ulHead >= pxMailBox->ulSize )
+    {
+        pxMailBox->ulHead = 0;
+    }
+
+    pxMailBox->ulCount--;
+    *pxPosterWaiting = ( pxMailBox->ulPostersWaiting > 0 ) ? pdTRUE : pdFALSE;
+}
+
+static BaseType_t prvMboxPop( sys_mbox_t * pxMailBox,
+                              void ** ppvMessage,
+                              BaseType_t * pxPosterWaiting )
+{
+    BaseType_t xResult = pdFALSE;
+    UBaseType_t uxSavedInterruptStatus;
+
+    *pxPosterWaiting = pdFALSE;
+
+    uxSavedInterruptStatus = portSET_INTERRUPT_MASK_FROM_ISR();
+
+    if( ( pxMailBox->ppvMsgs != NULL ) &&
+        ( pxMailBox->ulCount > 0 ) )
+    {
+        prvMboxRemove( pxMailBox, ppvMessage, pxPosterWaiting );
+        xResult = pdTRUE;
+    }
+
+    portCLEAR_INTERRUPT_MASK_FROM_ISR( uxSavedInterruptStatus );
+
+    return xResult;
+}
+
+static void prvMboxWake( TaskHandle_t xWaiter )
+{
+    if( xWaiter != NULL )
+    {
+        if( xInsideISR != pdFALSE )
+        {
+            BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+            vTaskNotifyGiveIndexedFromISR( xWaiter, LWIP_MBOX_NOTIFY_IDX, &xHigherPriorityTaskWoken );
+            portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
+        }
+        else
+        {
+            ( void ) xTaskNotifyGiveIndexed( xWaiter, LWIP_MBOX_NOTIFY_IDX );
+        }
+    }
+}
+
+/* Each removed message releases one blocked poster, which then retries its push */
+static void prvMboxWakePoster( sys_mbox_t * pxMailBox,
+                               BaseType_t xPosterWaiting )
+{
+    if( xPosterWaiting != pdFALSE )
+    {
+        if( xInsideISR != pdFALSE )
+        {
+            BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+            ( void ) xSemaphoreGiveFromISR( pxMailBox->xNotFull, &xHigherPriorityTaskWoken );
+            portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
+        }
+        else
+        {
+            ( void ) xSemaphoreGive( pxMailBox->xNotFull );
+        }
+    }
+}
+
 /*---------------------------------------------------------------------------*
 * Routine:  sys_mbox_new
 *---------------------------------------------------------------------------*
@@ -75,17 +196,48 @@ err_t sys_mbox_new( sys_mbox_t * pxMailBox,
                     int iSize )
 {
     err_t xReturn = ERR_MEM;
-    sys_mbox_t pxTempMbox;
+    void ** ppvMsgs = NULL;
+    SemaphoreHandle_t xNotFull = NULL;
+    SemaphoreHandle_t xFetchFree = NULL;
+
+    configASSERT( iSize > 0 );
 
-    pxTempMbox.xMbox = xQueueCreate( iSize, sizeof( void * ) );
+    ppvMsgs = ( void ** ) pvPortMalloc( sizeof( void * ) * ( size_t ) iSize );
+
+    if( ppvMsgs != NULL )
+    {
+        xNotFull = xSemaphoreCreateCounting( ( UBaseType_t ) iSize, 0 );
+    }
+
+    if( xNotFull != NULL )
+    {
+        xFetchFree = xSemaphoreCreateBinary();
+    }
 
-    if( pxTempMbox.xMbox != NULL )
+    if( xFetchFree != NULL )
     {
-        pxTempMbox.xTask = NULL;
-        *pxMailBox = pxTempMbox;
+        pxMailBox->ulSize = ( uint32_t ) iSize;
+        pxMailBox->ulHead = 0;
+        pxMailBox->ulCount = 0;
+        pxMailBox->xTask = NULL;
+        pxMailBox->xFetchFree = xFetchFree;
+        pxMailBox->ulFetchersWaiting = 0;
+        pxMailBox->xNotFull = xNotFull;
+        pxMailBox->ulPostersWaiting = 0;
+        pxMailBox->ppvMsgs = ppvMsgs;
         xReturn = ERR_OK;
         SYS_STATS_INC_USED( mbox );
     }
+    else
+    {
+        if( xNotFull != NULL )
+        {
+            vSemaphoreDelete( xNotFull );
+        }
+
+        vPortFree( ppvMsgs );
+        SYS_STATS_INC( mbox.err );
+    }
 
     return xReturn;
 }
@@ -105,14 +257,21 @@ err_t sys_mbox_new( sys_mbox_t * pxMailBox,
 *---------------------------------------------------------------------------*/
 void sys_mbox_free( sys_mbox_t * pxMailBox )
 {
-    unsigned long ulMessagesWaiting;
-    QueueHandle_t xMbox;
+    uint32_t ulMessagesWaiting;
+    void ** ppvMsgs;
     TaskHandle_t xTask;
-    sys_mbox_t volatile * pvxMailBox = pxMailBox;
+    UBaseType_t uxSavedInterruptStatus;
 
-    if( pvxMailBox != NULL )
+    if( pxMailBox != NULL )
     {
-        ulMessagesWaiting = uxQueueMessagesWaiting( pvxMailBox->xMbox );
+        uxSavedInterruptStatus = portSET_INTERRUPT_MASK_FROM_ISR();
+        ulMessagesWaiting = pxMailBox->ulCount;
+        ppvMsgs = pxMailBox->ppvMsgs;
+        xTask = pxMailBox->xTask;
+        pxMailBox->ppvMsgs = NULL;
+        pxMailBox->ulCount = 0;
+        portCLEAR_INTERRUPT_MASK_FROM_ISR( uxSavedInterruptStatus );
+
         configASSERT( ( ulMessagesWaiting == 0 ) );
 
 #if SYS_STATS
@@ -126,18 +285,19 @@ void sys_mbox_free( sys_mbox_t * pxMailBox )
         }
 #endif /* SYS_STATS */
 
-        taskENTER_CRITICAL();
-        xMbox = pvxMailBox->xMbox;
-        xTask = pvxMailBox->xTask;
-        pvxMailBox->xMbox = NULL;
-        taskEXIT_CRITICAL();
-
         if( xTask != NULL )
         {
             xTaskAbortDelay( xTask );
         }
 
-        vQueueDelete( xMbox );
+        configASSERT( pxMailBox->ulFetchersWaiting == 0 );
+        configASSERT( pxMailBox->ulPostersWaiting == 0 );
+        vSemaphoreDelete( pxMailBox->xFetchFree );
+        pxMailBox->xFetchFree = NULL;
+        vSemaphoreDelete( pxMailBox->xNotFull );
+        pxMailBox->xNotFull = NULL;
+
+        vPortFree( ppvMsgs );
     }
 }
 
@@ -145,7 +305,8 @@ void sys_mbox_free( sys_mbox_t * pxMailBox )
 * Routine:  sys_mbox_post
 *---------------------------------------------------------------------------*
 * Description:
-*      Post the "msg" to the mailbox.
+*      Post the "msg" to the mailbox. Blocks while the mailbox is full
+*      until a fetch makes room.
 * Inputs:
 *      sys_mbox_t mbox         -- Handle of mailbox
 *      void *data              -- Pointer to data to post
@@ -153,9 +314,43 @@ void sys_mbox_free( sys_mbox_t * pxMailBox )
 void sys_mbox_post( sys_mbox_t * pxMailBox,
                     void * pxMessageToPost )
 {
-    while( xQueueSendToBack( pxMailBox->xMbox, &pxMessageToPost, portMAX_DELAY ) != pdTRUE )
+    TaskHandle_t xWaiter = NULL;
+    BaseType_t xPosted = pdFALSE;
+    UBaseType_t uxSavedInterruptStatus;
+
+    PERF_START;
+
+    configASSERT( xInsideISR == ( portBASE_TYPE ) 0 );
+
+    while( xPosted == pdFALSE )
     {
+        xPosted = prvMboxPush( pxMailBox, pxMessageToPost, &xWaiter );
+
+        if( xPosted == pdFALSE )
+        {
+            /* The mailbox is full. Register as a waiting poster, then check
+             * again so that a message removed in between is not missed. */
+            uxSavedInterruptStatus = portSET_INTERRUPT_MASK_FROM_ISR();
+            pxMailBox->ulPostersWaiting++;
+            portCLEAR_INTERRUPT_MASK_FROM_ISR( uxSavedInterruptStatus );
+
+            xPosted = prvMboxPush( pxMailBox, pxMessageToPost, &xWaiter );
+
+            if( xPosted == pdFALSE )
+            {
+                /* A give with no matching waiter only causes one extra retry */
+                ( void ) xSemaphoreTake( pxMailBox->xNotFull, portMAX_DELAY );
+            }
+
+            uxSavedInterruptStatus = portSET_INTERRUPT_MASK_FROM_ISR();
+            pxMailBox->ulPostersWaiting--;
+            portCLEAR_INTERRUPT_MASK_FROM_ISR( uxSavedInterruptStatus );
+        }
     }
+
+    prvMboxWake( xWaiter );
+
+    PERF_STOP( "sys_mbox_post" );
 }
 
 /*---------------------------------------------------------------------------*
@@ -175,28 +370,24 @@ err_t sys_mbox_trypost( sys_mbox_t * pxMailBox,
                         void * pxMessageToPost )
 {
     err_t xReturn;
-    portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+    TaskHandle_t xWaiter = NULL;
 
-    if( xInsideISR != pdFALSE )
-    {
-        xReturn = xQueueSendFromISR( pxMailBox->xMbox, &pxMessageToPost, &xHigherPriorityTaskWoken );
-    }
-    else
-    {
-        xReturn = xQueueSend( pxMailBox->xMbox, &pxMessageToPost, ( TickType_t ) 0 );
-    }
+    PERF_START;
 
-    if( xReturn == pdPASS )
+    if( prvMboxPush( pxMailBox, pxMessageToPost, &xWaiter ) == pdTRUE )
     {
+        prvMboxWake( xWaiter );
         xReturn = ERR_OK;
     }
     else
     {
-        /* The queue was already full. */
+        /* The mailbox was already full. */
         xReturn = ERR_MEM;
         SYS_STATS_INC( mbox.err );
     }
 
+    PERF_STOP( "sys_mbox_trypost" );
+
     return xReturn;
 }
 
@@ -229,6 +420,10 @@ err_t sys_mbox_trypost_fromisr( sys_mbox_t * pxMailBox,
 *
 *      Note that a function with a similar name, sys_mbox_fetch(), is
 *      implemented by lwIP.
+*
+*      Only one task waits for messages at a time. A task that fetches
+*      while another one is waiting blocks, within its own timeout, until
+*      that task has left.
 * Inputs:
 *      sys_mbox_t mbox         -- Handle of mailbox
 *      void **msg              -- Pointer to pointer to msg received
@@ -242,72 +437,133 @@ u32_t sys_arch_mbox_fetch( sys_mbox_t * pxMailBox,
 {
     void * pvDummy;
     unsigned long ulReturn = SYS_ARCH_TIMEOUT;
-    QueueHandle_t xMbox;
-    TaskHandle_t xTask;
-    BaseType_t xResult;
-    sys_mbox_t volatile * pvxMailBox = pxMailBox;
+    BaseType_t xPosterWaiting = pdFALSE;
+    TaskHandle_t xTask = xTaskGetCurrentTaskHandle();
+    TickType_t xStartTime = xTaskGetTickCount();
+    TickType_t xTicksToWait = ulTimeOut / portTICK_PERIOD_MS;
+    TickType_t xBlockTime;
+    BaseType_t xRegistered = pdFALSE;
+    BaseType_t xQueued = pdFALSE;
+    BaseType_t xWakeFetcher = pdFALSE;
+    BaseType_t xExit = pdFALSE;
+    UBaseType_t uxSavedInterruptStatus;
 
-    if( pvxMailBox == NULL )
+    if( NULL == ppvBuffer )
     {
-        goto exit;
+        ppvBuffer = &pvDummy;
     }
 
-    taskENTER_CRITICAL();
-    xMbox = pvxMailBox->xMbox;
-    xTask = xTaskGetCurrentTaskHandle();
+    *ppvBuffer = NULL;
 
-    if( ( xMbox != NULL ) && ( xTask != NULL ) && ( pvxMailBox->xTask == NULL ) )
+    if( pxMailBox == NULL )
     {
-        pvxMailBox->xTask = xTask;
+        xExit = pdTRUE;
     }
     else
     {
-        xMbox = NULL;
-    }
-
-    taskEXIT_CRITICAL();
-
-    if( xMbox == NULL )
-    {
-        goto exit;
-    }
-
-    if( NULL == ppvBuffer )
-    {
-        ppvBuffer = &pvDummy;
+        configASSERT( xInsideISR == ( portBASE_TYPE ) 0 );
     }
 
-    if( ulTimeOut != 0UL )
+    while( xExit == pdFALSE )
     {
-        configASSERT( xInsideISR == ( portBASE_TYPE ) 0 );
+        uxSavedInterruptStatus = portSET_INTERRUPT_MASK_FROM_ISR();
 
-        if( pdTRUE == xQueueReceive( xMbox, &( *ppvBuffer ), ulTimeOut / portTICK_PERIOD_MS ) )
+        if( pxMailBox->ppvMsgs == NULL )
+        {
+            /* Mailbox was freed while waiting */
+            xExit = pdTRUE;
+        }
+        else if( pxMailBox->ulCount > 0 )
         {
+            prvMboxRemove( pxMailBox, ppvBuffer, &xPosterWaiting );
             ulReturn = 1UL;
+            xExit = pdTRUE;
+        }
+        else if( ( pxMailBox->xTask == NULL ) ||
+                 ( pxMailBox->xTask == xTask ) )
+        {
+            pxMailBox->xTask = xTask;
+            xRegistered = pdTRUE;
         }
         else
         {
-            /* Timed out. */
-            *ppvBuffer = NULL;
+            /* Another task is waiting in a fetch. Queue up behind it, the
+             * count is raised under the mask so that its exit is not missed. */
+            pxMailBox->ulFetchersWaiting++;
+            xQueued = pdTRUE;
+        }
+
+        portCLEAR_INTERRUPT_MASK_FROM_ISR( uxSavedInterruptStatus );
+
+        if( xExit == pdFALSE )
+        {
+            xBlockTime = portMAX_DELAY;
+
+            if( ulTimeOut != 0UL )
+            {
+                TickType_t xElapsed = xTaskGetTickCount() - xStartTime;
+
+                if( xElapsed >= xTicksToWait )
+                {
+                    xExit = pdTRUE;
+                }
+                else
+                {
+                    xBlockTime = xTicksToWait - xElapsed;
+                }
+            }
+
+            if( xExit == pdFALSE )
+            {
+                if( xQueued == pdTRUE )
+                {
+                    /* A give with no matching waiter only causes one extra retry */
+                    ( void ) xSemaphoreTake( pxMailBox->xFetchFree, xBlockTime );
+                }
+                else
+                {
+                    /* Stale notifications only cause the mailbox to be checked again */
+                    ( void ) ulTaskNotifyTakeIndexed( LWIP_MBOX_NOTIFY_IDX, pdTRUE, xBlockTime );
+                }
+            }
+        }
+
+        if( xQueued == pdTRUE )
+        {
+            uxSavedInterruptStatus = portSET_INTERRUPT_MASK_FROM_ISR();
+            pxMailBox->ulFetchersWaiting--;
+            portCLEAR_INTERRUPT_MASK_FROM_ISR( uxSavedInterruptStatus );
+            xQueued = pdFALSE;
         }
     }
-    else
+
+    if( xRegistered == pdTRUE )
     {
-        for( xResult = pdFALSE; ( xMbox != NULL ) && ( xResult != pdTRUE ); )
+        uxSavedInterruptStatus = portSET_INTERRUPT_MASK_FROM_ISR();
+
+        if( pxMailBox->xTask == xTask )
         {
-            xResult = xQueueReceive( xMbox, &( *ppvBuffer ), portMAX_DELAY );
-            xMbox = pvxMailBox->xMbox;
+            pxMailBox->xTask = NULL;
         }
 
-        if( xResult == pdTRUE )
+        if( pxMailBox->ulFetchersWaiting > 0 )
         {
-            ulReturn = 1UL;
+            xWakeFetcher = pdTRUE;
+        }
+
+        portCLEAR_INTERRUPT_MASK_FROM_ISR( uxSavedInterruptStatus );
+
+        if( xWakeFetcher == pdTRUE )
+        {
+            ( void ) xSemaphoreGive( pxMailBox->xFetchFree );
         }
     }
 
-    pvxMailBox->xTask = NULL;
+    if( ulReturn != SYS_ARCH_TIMEOUT )
+    {
+        prvMboxWakePoster( pxMailBox, xPosterWaiting );
+    }
 
-exit:
     return ulReturn;
 }
 
@@ -330,25 +586,16 @@ u32_t sys_arch_mbox_tryfetch( sys_mbox_t * pxMailBox,
 {
     void * pvDummy;
     unsigned long ulReturn;
-    long lResult;
-    portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+    BaseType_t xPosterWaiting;
 
     if( ppvBuffer == NULL )
     {
         ppvBuffer = &pvDummy;
     }
 
-    if( xInsideISR != pdFALSE )
-    {
-        lResult = xQueueReceiveFromISR( pxMailBox->xMbox, &( *ppvBuffer ), &xHigherPriorityTaskWoken );
-    }
-    else
-    {
-        lResult = xQueueReceive( pxMailBox->xMbox, &( *ppvBuffer ), 0UL );
-    }
-
-    if( lResult == pdPASS )
+    if( prvMboxPop( pxMailBox, ppvBuffer, &xPosterWaiting ) == pdTRUE )
     {
+        prvMboxWakePoster( pxMailBox, xPosterWaiting );
         ulReturn = ERR_OK;
     }
     else
@@ -377,13 +624,14 @@ err_t sys_sem_new( sys_sem_t * pxSemaphore,
 {
     err_t xReturn = ERR_MEM;
 
-    vSemaphoreCreateBinary( ( *pxSemaphore ) );
+    pxSemaphore->xOwner = NULL;
+    vSemaphoreCreateBinary( pxSemaphore->xSemaphore );
 
-    if( *pxSemaphore != NULL )
+    if( pxSemaphore->xSemaphore != NULL )
     {
         if( ucCount == 0U )
         {
-            xSemaphoreTake( *pxSemaphore, 1UL );
+            xSemaphoreTake( pxSemaphore->xSemaphore, 1UL );
         }
 
         xReturn = ERR_OK;
@@ -397,6 +645,39 @@ err_t sys_sem_new( sys_sem_t * pxSemaphore,
     return xReturn;
 }
 
+/*---------------------------------------------------------------------------*
+* Routine:  prvSemTake
+*---------------------------------------------------------------------------*
+* Description:
+*      Take a semaphore, either from the owner's task notification or from
+*      the underlying FreeRTOS semaphore.
+*---------------------------------------------------------------------------*/
+static BaseType_t prvSemTake( sys_sem_t * pxSemaphore,
+                              TickType_t xTicksToWait )
+{
+    BaseType_t xResult;
+
+    if( pxSemaphore->xOwner != NULL )
+    {
+        configASSERT( pxSemaphore->xOwner == xTaskGetCurrentTaskHandle() );
+
+        if( ulTaskNotifyTakeIndexed( LWIP_SEM_NOTIFY_IDX, pdTRUE, xTicksToWait ) != 0 )
+        {
+            xResult = pdTRUE;
+        }
+        else
+        {
+            xResult = pdFALSE;
+        }
+    }
+    else
+    {
+        xResult = xSemaphoreTake( pxSemaphore->xSemaphore, xTicksToWait );
+    }
+
+    return xResult;
+}
+
 /*---------------------------------------------------------------------------*
 * Routine:  sys_arch_sem_wait
 *---------------------------------------------------------------------------*
@@ -430,7 +711,7 @@ u32_t sys_arch_sem_wait( sys_sem_t * pxSemaphore,
 
     if( ulTimeout != 0UL )
     {
-        if( xSemaphoreTake( *pxSemaphore, ulTimeout / portTICK_PERIOD_MS ) == pdTRUE )
+        if( prvSemTake( pxSemaphore, ulTimeout / portTICK_PERIOD_MS ) == pdTRUE )
         {
             xEndTime = xTaskGetTickCount();
             xElapsed = ( xEndTime - xStartTime ) * portTICK_PERIOD_MS;
@@ -443,7 +724,7 @@ u32_t sys_arch_sem_wait( sys_sem_t * pxSemaphore,
     }
     else
     {
-        while( xSemaphoreTake( *pxSemaphore, portMAX_DELAY ) != pdTRUE )
+        while( prvSemTake( pxSemaphore, portMAX_DELAY ) != pdTRUE )
         {
         }
 
@@ -468,9 +749,9 @@ err_t sys_mutex_new( sys_mutex_t * pxMutex )
 {
     err_t xReturn = ERR_MEM;
 
-    *pxMutex = xSemaphoreCreateMutex();
+    pxMutex->xMutex = xSemaphoreCreateMutex();
 
-    if( *pxMutex != NULL )
+    if( pxMutex->xMutex != NULL )
     {
         xReturn = ERR_OK;
         SYS_STATS_INC_USED( mutex );
@@ -487,16 +768,36 @@ err_t sys_mutex_new( sys_mutex_t * pxMutex )
  * @param mutex the mutex to lock */
 void sys_mutex_lock( sys_mutex_t * pxMutex )
 {
-    while( xSemaphoreTake( *pxMutex, portMAX_DELAY ) != pdPASS )
+#if LWIP_PERF
+    /* Only contended acquisitions are timed, as "lock_mutex_wait" */
+    if( xSemaphoreTake( pxMutex->xMutex, 0 ) != pdPASS )
+    {
+        PERF_START;
+
+        while( xSemaphoreTake( pxMutex->xMutex, portMAX_DELAY ) != pdPASS )
+        {
+        }
+
+        PERF_STOP( "lock_mutex_wait" );
+    }
+
+    pxMutex->ulLockedAt = ulLwipPerfGetCount();
+#else
+    while( xSemaphoreTake( pxMutex->xMutex, portMAX_DELAY ) != pdPASS )
     {
     }
+#endif /* LWIP_PERF */
 }
 
 /** Unlock a mutex
  * @param mutex the mutex to unlock */
 void sys_mutex_unlock( sys_mutex_t * pxMutex )
 {
-    xSemaphoreGive( *pxMutex );
+#if LWIP_PERF
+    PERF_RECORD( "lock_mutex_hold", ulLwipPerfGetCount() - pxMutex->ulLockedAt );
+#endif
+
+    xSemaphoreGive( pxMutex->xMutex );
 }
 
 
@@ -505,7 +806,7 @@ void sys_mutex_unlock( sys_mutex_t * pxMutex )
 void sys_mutex_free( sys_mutex_t * pxMutex )
 {
     SYS_STATS_DEC( mutex.used );
-    vQueueDelete( *pxMutex );
+    vQueueDelete( pxMutex->xMutex );
 }
 
 
@@ -521,13 +822,24 @@ void sys_sem_signal( sys_sem_t * pxSemaphore )
 {
     portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
 
-    if( xInsideISR != pdFALSE )
+    if( pxSemaphore->xOwner != NULL )
     {
-        xSemaphoreGiveFromISR( *pxSemaphore, &xHigherPriorityTaskWoken );
+        if( xInsideISR != pdFALSE )
+        {
+            vTaskNotifyGiveIndexedFromISR( pxSemaphore->xOwner, LWIP_SEM_NOTIFY_IDX, &xHigherPriorityTaskWoken );
+        }
+        else
+        {
+            ( void ) xTaskNotifyGiveIndexed( pxSemaphore->xOwner, LWIP_SEM_NOTIFY_IDX );
+        }
+    }
+    else if( xInsideISR != pdFALSE )
+    {
+        xSemaphoreGiveFromISR( pxSemaphore->xSemaphore, &xHigherPriorityTaskWoken );
     }
     else
     {
-        xSemaphoreGive( *pxSemaphore );
+        xSemaphoreGive( pxSemaphore->xSemaphore );
     }
 }
 
@@ -542,7 +854,13 @@ void sys_sem_signal( sys_sem_t * pxSemaphore )
 void sys_sem_free( sys_sem_t * pxSemaphore )
 {
     SYS_STATS_DEC( sem.used );
-    vQueueDelete( *pxSemaphore );
+
+    if( pxSemaphore->xSemaphore != NULL )
+    {
+        vQueueDelete( pxSemaphore->xSemaphore );
+    }
+
+    sys_sem_set_invalid( pxSemaphore );
 }
 
 /*---------------------------------------------------------------------------*
@@ -554,6 +872,9 @@ void sys_sem_free( sys_sem_t * pxSemaphore )
 void sys_init( void )
 {
 /*    srand( rand() ); */
+#if LWIP_PERF
+    vLwipPerfInit();
+#endif
 }
 
 u32_t sys_now( void )
@@ -613,6 +934,8 @@ sys_thread_t sys_thread_new( const char * pcName,
 *      Lookup the task-specific semaphore; create one if necessary.
 *      The semaphore pointer lives in the 0th slot of the
 *      TCB local storage array.  Once allocated, it is never released.
+*      Since the owning task is its only waiter, the semaphore is
+*      signaled by a direct to task notification.
 *---------------------------------------------------------------------------*/
 sys_sem_t * sys_arch_netconn_sem_get( void )
 {
@@ -630,8 +953,11 @@ sys_sem_t * sys_arch_netconn_sem_get( void )
         /* allocate memory for this semaphore */
         sem = mem_malloc( sizeof( sys_sem_t ) );
         configASSERT( sem != NULL );
-        err = sys_sem_new( sem, 0 );
-        configASSERT( err == ERR_OK );
+        sem->xSemaphore = NULL;
+        sem->xOwner = task;
+        ( void ) xTaskNotifyStateClearIndexed( task, LWIP_SEM_NOTIFY_IDX );
+        ( void ) ulTaskNotifyValueClearIndexed( task, LWIP_SEM_NOTIFY_IDX, UINT32_MAX );
+        SYS_STATS_INC_USED( sem );
         configASSERT( sys_sem_valid( sem ) );
         vTaskSetThreadLocalStoragePointer( task, 0, sem );
         ret = sem;
@@ -645,6 +971,11 @@ sys_sem_t * sys_arch_netconn_sem_get( void )
 
 #endif /* LWIP_NETCONN_SEM_PER_THREAD */
 
+#if LWIP_PERF
+static UBaseType_t uxProtectNesting = 0;
+static uint32_t ulProtectStart = 0;
+#endif
+
 /*---------------------------------------------------------------------------*
 * Routine:  sys_arch_protect
 *---------------------------------------------------------------------------*
@@ -659,19 +990,30 @@ sys_sem_t * sys_arch_netconn_sem_get( void )
 *      sys_arch_protect() could be called while already protected. In
 *      that case the return value indicates that it is already protected.
 *
+*      Only interrupts at or below configMAX_SYSCALL_INTERRUPT_PRIORITY are
+*      masked: lwIP is never called from a higher priority interrupt. The
+*      previous mask is returned, so this is safe to nest and to call from
+*      an interrupt.
+*
 *      sys_arch_protect() is only required if your port is supporting an
 *      operating system.
 * Outputs:
-*      sys_prot_t              -- Previous protection level (not used here)
+*      sys_prot_t              -- Previous interrupt mask
 *---------------------------------------------------------------------------*/
 sys_prot_t sys_arch_protect( void )
 {
-    if( xInsideISR == pdFALSE )
+    sys_prot_t xValue = ( sys_prot_t ) portSET_INTERRUPT_MASK_FROM_ISR();
+
+#if LWIP_PERF
+    if( uxProtectNesting == 0 )
     {
-        taskENTER_CRITICAL();
+        ulProtectStart = ulLwipPerfGetCount();
     }
 
-    return ( sys_prot_t ) 1;
+    uxProtectNesting++;
+#endif
+
+    return xValue;
 }
 
 /*---------------------------------------------------------------------------*
@@ -683,16 +1025,29 @@ sys_prot_t sys_arch_protect( void )
 *      sys_arch_protect() for more information. This function is only
 *      required if your port is supporting an operating system.
 * Inputs:
-*      sys_prot_t              -- Previous protection level (not used here)
+*      sys_prot_t              -- Interrupt mask returned by sys_arch_protect
 *---------------------------------------------------------------------------*/
 void sys_arch_unprotect( sys_prot_t xValue )
 {
-    ( void ) xValue;
+#if LWIP_PERF
+    uint32_t ulHeld = 0;
+
+    uxProtectNesting--;
 
-    if( xInsideISR == pdFALSE )
+    if( uxProtectNesting == 0 )
     {
-        taskEXIT_CRITICAL();
+        ulHeld = ulLwipPerfGetCount() - ulProtectStart;
     }
+#endif
+
+    portCLEAR_INTERRUPT_MASK_FROM_ISR( ( UBaseType_t ) xValue );
+
+#if LWIP_PERF
+    if( ulHeld > 0 )
+    {
+        PERF_RECORD( "lock_protect_hold", ulHeld );
+    }
+#endif
 }
 
 /*-------------------------------------------------------------------------*
@@ -26,7 +26,8 @@
  */
 #include "logging_levels.h"
 
-#define LOG_LEVEL    LOG_INFO
+#define LOG_LEVEL     LOG_INFO
+#define LOG_MODULE    LOG_MODULE_TLS
 
 #include "logging.h"
 
@@ -37,6 +38,8 @@
 
 /* FreeRTOS includes. */
 #include "FreeRTOS.h"
+#include "task.h"
+#include "trace_ring.h"
 
 
 /* mbedTLS includes. */
@@ -104,6 +107,10 @@ typedef struct TLSContext
 #endif /* TRANSPORT_USE_CTR_DRBG */
 } TLSContext_t;
 
+/* Handshake statistics shared by all connections */
+static LatencyHist_t xHandshakeDurations = { 0 };
+static uint32_t ulHandshakeFailures = 0;
+
 
 /*-----------------------------------------------------------*/
 
@@ -1340,6 +1347,10 @@ TlsTransportStatus_t mbedtls_transport_connect( NetworkContext_t * pxNetworkCont
     /* Perform TLS handshake. */
     if( xStatus == TLS_TRANSPORT_SUCCESS )
     {
+        TickType_t xStartTicks = xTaskGetTickCount();
+
+        vTraceBegin( "tls_handshake" );
+
         /* Perform the TLS handshake. */
         do
         {
@@ -1348,6 +1359,21 @@ TlsTransportStatus_t mbedtls_transport_connect( NetworkContext_t * pxNetworkCont
         while( ( lError == MBEDTLS_ERR_SSL_WANT_READ ) ||
                ( lError == MBEDTLS_ERR_SSL_WANT_WRITE ) );
 
+        vTraceEnd( "tls_handshake" );
+
+        taskENTER_CRITICAL();
+        {
+            if( lError != 0 )
+            {
+                ulHandshakeFailures++;
+            }
+            else
+            {
+                vLatencyHistRecord( &xHandshakeDurations, ( xTaskGetTickCount() - xStartTicks ) * portTICK_PERIOD_MS );
+            }
+        }
+        taskEXIT_CRITICAL();
+
         if( lError != 0 )
         {
             LogError( "Failed to perform TLS handshake: Error: %s : %s.",
@@ -1596,6 +1622,25 @@ void mbedtls_transport_disconnect( NetworkContext_t * pxNetworkContext )
 
 /*-----------------------------------------------------------*/
 
+void mbedtls_transport_take_handshake_stats( LatencyHist_t * pxDurations,
+                                             uint32_t * pulFailures )
+{
+    configASSERT( pxDurations != NULL );
+    configASSERT( pulFailures != NULL );
+
+    taskENTER_CRITICAL();
+    {
+        ( void ) memcpy( pxDurations, &xHandshakeDurations, sizeof( LatencyHist_t ) );
+        *pulFailures = ulHandshakeFailures;
+
+        ( void ) memset( &xHandshakeDurations, 0, sizeof( LatencyHist_t ) );
+        ulHandshakeFailures = 0;
+    }
+    taskEXIT_CRITICAL();
+}
+
+/*-----------------------------------------------------------*/
+
 int32_t mbedtls_transport_recv( NetworkContext_t * pxNetworkContext,
                                 void * pBuffer,
                                 size_t uxBytesToRecv )
@@ -1609,9 +1654,12 @@ int32_t mbedtls_transport_recv( NetworkContext_t * pxNetworkContext,
 
     if( pxTLSCtx->xConnectionState == STATE_CONNECTED )
     {
+        vTraceBegin( "tls_recv" );
         tlsStatus = ( int32_t ) mbedtls_ssl_read( &( pxTLSCtx->xSslCtx ),
                                                   pBuffer,
                                                   uxBytesToRecv );
+        vTraceEnd( "tls_recv" );
+        vTraceValue( "tls_recv_status", ( uint32_t ) tlsStatus );
     }
     else
     {
@@ -1676,9 +1724,12 @@ int32_t mbedtls_transport_send( NetworkContext_t * pxNetworkContext,
 
     if( pxTLSCtx->xConnectionState == STATE_CONNECTED )
     {
+        vTraceBegin( "tls_send" );
         tlsStatus = ( int32_t ) mbedtls_ssl_write( &( pxTLSCtx->xSslCtx ),
                                                    pBuffer,
                                                    uxBytesToSend );
+        vTraceEnd( "tls_send" );
+        vTraceValue( "tls_send_status", ( uint32_t ) tlsStatus );
     }
     else
     {
@@ -24,7 +24,8 @@
  */
 
 #include "logging_levels.h"
-#define LOG_LEVEL    LOG_WARN
+#define LOG_LEVEL     LOG_WARN
+#define LOG_MODULE    LOG_MODULE_NET
 
 #include "logging.h"
 
@@ -36,6 +37,7 @@
 #include "stm32u5xx_hal.h"
 #include "message_buffer.h"
 #include "atomic.h"
+#include "trace_ring.h"
 
 #include "mx_ipc.h"
 #include "mx_prv.h"
@@ -247,6 +249,7 @@ static inline BaseType_t xDoSpiHeaderTransfer( MxDataplaneCtx_t * pxCtx,
         if( ( xRxHeader.type == MX_SPI_READ ) &&
             ( xRxHeader.len != 0 ) )
         {
+            pxCtx->pxSpiStats->ulHeaderErrors++;
             LogError( "RX header validation failed. len: %d, lenx: %d, xord: %d, type: %d, xHalStatus: %d",
                       xRxHeader.len, xRxHeader.lenx, ( xRxHeader.len ) ^ ( xRxHeader.lenx ), xRxHeader.type, xHalStatus );
         }
@@ -360,11 +363,16 @@ static inline BaseType_t xTransmitReceiveMessage( MxDataplaneCtx_t * pxCtx,
 }
 
 
-static void vProcessRxPacket( MessageBufferHandle_t * xControlPlaneResponseBuff,
-                              NetInterface_t * pxNetif,
-                              PacketBuffer_t ** ppxRxPacket )
+/*
+ * @brief Hand a received packet to lwIP or the control plane.
+ * Returns pdFALSE if the packet was dropped.
+ */
+static BaseType_t xProcessRxPacket( MessageBufferHandle_t xControlPlaneResponseBuff,
+                                    NetInterface_t * pxNetif,
+                                    PacketBuffer_t ** ppxRxPacket )
 {
     BaseType_t xResult = pdFALSE;
+    BaseType_t xDelivered = pdTRUE;
 
     /* Read header */
     IPCHeader_t * pxRxPktHeader = ( IPCHeader_t * ) ( *ppxRxPacket )->payload;
@@ -381,6 +389,7 @@ static void vProcessRxPacket( MessageBufferHandle_t * xControlPlaneResponseBuff,
         {
             /* Free packet on failure */
             PBUF_FREE( *ppxRxPacket );
+            xDelivered = pdFALSE;
         }
 
         /* Clear pointer */
@@ -409,10 +418,15 @@ static void vProcessRxPacket( MessageBufferHandle_t * xControlPlaneResponseBuff,
     /* forward to control plane handler */
     else
     {
-        xResult = xMessageBufferSend( xControlPlaneResponseBuff,
-                                      ppxRxPacket,
-                                      sizeof( PacketBuffer_t * ),
-                                      0 );
+        /* The IPC request timers also write to the buffer, writers take turns in a critical section */
+        taskENTER_CRITICAL();
+        {
+            xResult = xMessageBufferSend( xControlPlaneResponseBuff,
+                                          ppxRxPacket,
+                                          sizeof( PacketBuffer_t * ),
+                                          0 );
+        }
+        taskEXIT_CRITICAL();
 
         if( xResult == pdFALSE )
         {
@@ -423,11 +437,14 @@ static void vProcessRxPacket( MessageBufferHandle_t * xControlPlaneResponseBuff,
                       pxRxPktHeader->usIPCApiId );
             PBUF_FREE( *ppxRxPacket );
             pxRxPktHeader = NULL;
+            xDelivered = pdFALSE;
         }
 
         /* Clear pointer */
         ( *ppxRxPacket ) = NULL;
     }
+
+    return xDelivered;
 }
 
 
@@ -471,6 +488,52 @@ void vInitCallbacks( MxDataplaneCtx_t * pxCtx )
     configASSERT( xHalResult == HAL_OK );
 }
 
+/*
+ * Dequeue the next frame to transmit. Control plane messages are sent first,
+ * followed by data plane frames in order of their MxTxClass_t.
+ */
+static PacketBuffer_t * pxGetNextTxPacket( MxDataplaneCtx_t * pxCtx )
+{
+    PacketBuffer_t * pxTxBuff = NULL;
+
+    if( xQueueReceive( pxCtx->xControlPlaneSendQueue, &pxTxBuff, 0 ) == pdTRUE )
+    {
+        LogDebug( "Preparing controlplane message for transmission" );
+    }
+    else
+    {
+        for( uint32_t ulClass = 0; ulClass < MX_TX_CLASS_MAX; ulClass++ )
+        {
+            MxTxQueueItem_t xItem;
+
+            if( xQueueReceive( pxCtx->xDataPlaneSendQueues[ ulClass ], &xItem, 0 ) == pdTRUE )
+            {
+                MxTxQueueStats_t * pxStats = &( pxCtx->pxTxQueueStats[ ulClass ] );
+                uint32_t ulDelay = ( uint32_t ) ( xTaskGetTickCount() - xItem.xEnqueueTime );
+
+                pxStats->ulDequeued++;
+                pxStats->ulTotalDelayTicks += ulDelay;
+
+                if( ulDelay > pxStats->ulMaxDelayTicks )
+                {
+                    pxStats->ulMaxDelayTicks = ulDelay;
+                }
+
+                pxTxBuff = xItem.pxPbuf;
+                LogDebug( "Preparing dataplane message from tx class %d for transmission", ulClass );
+                break;
+            }
+        }
+    }
+
+    if( pxTxBuff != NULL )
+    {
+        configASSERT( pxTxBuff->ref > 0 );
+    }
+
+    return pxTxBuff;
+}
+
 /* Wait for the flow pin go high signifying that the module is ready for more data. */
 static inline BaseType_t xWaitForFlow( MxDataplaneCtx_t * pxCtx )
 {
@@ -506,10 +569,13 @@ void vDataplaneThread( void * pvParameters )
     /* Do hardware reset */
     vDoHardReset( pxCtx );
 
+    /* Frame selected for transmission. Retained across iterations until the SPI data phase is reached. */
+    PacketBuffer_t * pxTxBuff = NULL;
+
     while( exitFlag == pdFALSE )
     {
-        PacketBuffer_t * pxTxBuff = NULL;
         PacketBuffer_t * pxRxBuff = NULL;
+        BaseType_t xTxDone = pdFALSE;
 
         if( pxCtx->ulTxPacketsWaiting == 0 )
         {
@@ -540,36 +606,29 @@ void vDataplaneThread( void * pvParameters )
             uint16_t usTxLen = 0;
             uint16_t usRxLen = 0;
 
-            QueueHandle_t xSourceQueue = NULL;
+            pxCtx->pxSpiStats->ulTransfers++;
 
-            /* Prepare a control plane messages for TX */
-            if( xQueuePeek( pxCtx->xControlPlaneSendQueue, &pxTxBuff, 0 ) == pdTRUE )
+            /* Prepare the next message for TX */
+            if( pxTxBuff == NULL )
             {
-                configASSERT( pxTxBuff != NULL );
-                configASSERT( pxTxBuff->ref > 0 );
-                usTxLen = pxTxBuff->tot_len;
-                xSourceQueue = pxCtx->xControlPlaneSendQueue;
-                LogDebug( "Preparing controlplane message for transmission" );
+                pxTxBuff = pxGetNextTxPacket( pxCtx );
             }
-            else if( xQueuePeek( pxCtx->xDataPlaneSendQueue, &pxTxBuff, 0 ) == pdTRUE )
+
+            if( pxTxBuff != NULL )
             {
-                configASSERT( pxTxBuff != NULL );
-                configASSERT( pxTxBuff->ref > 0 );
                 usTxLen = pxTxBuff->tot_len;
-                xSourceQueue = pxCtx->xDataPlaneSendQueue;
-                LogDebug( "Preparing dataplane message for transmission" );
+            }
+            else if( pxCtx->ulTxPacketsWaiting != 0 )
+            {
+                LogWarn( "Mismatch between ulTxPacketsWaiting and queue contents. Resetting ulTxPacketsWaiting" );
+                pxSpiCtx->ulTxPacketsWaiting = 0;
             }
             else
             {
                 /* Empty, no TX packets */
             }
 
-            if( ( pxTxBuff == NULL ) &&
-                ( pxCtx->ulTxPacketsWaiting != 0 ) )
-            {
-                LogWarn( "Mismatch between ulTxPacketsWaiting and queue contents. Resetting ulTxPacketsWaiting" );
-                pxSpiCtx->ulTxPacketsWaiting = 0;
-            }
+            vTraceBegin( "mx_spi_xfer" );
 
             if( xResult == pdTRUE )
             {
@@ -589,17 +648,12 @@ void vDataplaneThread( void * pvParameters )
                 xResult = xWaitForFlow( pxCtx );
             }
 
-            /* Read from the queue */
+            /* The TX buffer is consumed once the data phase starts. Otherwise it is retried. */
             if( ( xResult == pdTRUE ) &&
-                ( xSourceQueue != NULL ) )
-            {
-                xResult = xQueueReceive( xSourceQueue, &pxTxBuff, 0 );
-                configASSERT( pxTxBuff != NULL );
-                configASSERT( xResult == pdTRUE );
-            }
-            else if( pxTxBuff != NULL )
+                ( pxTxBuff != NULL ) &&
+                ( usTxLen > 0 ) )
             {
-                pxTxBuff = NULL;
+                xTxDone = pdTRUE;
             }
 
             /* Transmit / receive packet data */
@@ -631,6 +685,15 @@ void vDataplaneThread( void * pvParameters )
                                                        usRxLen );
                 }
             }
+
+            if( xResult != pdTRUE )
+            {
+                pxCtx->pxSpiStats->ulErrors++;
+            }
+
+            vTraceValue( "mx_spi_tx_len", usTxLen );
+            vTraceValue( "mx_spi_rx_len", usRxLen );
+            vTraceEnd( "mx_spi_xfer" );
         }
         else
         {
@@ -641,7 +704,7 @@ void vDataplaneThread( void * pvParameters )
         /* Set CS / NSS high (idle) */
         vGpioSet( pxCtx->gpio_nss );
 
-        if( pxTxBuff != NULL )
+        if( xTxDone == pdTRUE )
         {
             /* Decrement TX packets waiting counter */
             ( void ) Atomic_Decrement_u32( &( pxSpiCtx->ulTxPacketsWaiting ) );
@@ -655,7 +718,10 @@ void vDataplaneThread( void * pvParameters )
         if( ( xResult == pdTRUE ) &&
             ( pxRxBuff != NULL ) )
         {
-            vProcessRxPacket( pxCtx->xControlPlaneResponseBuff, pxCtx->pxNetif, &pxRxBuff );
+            if( xProcessRxPacket( pxCtx->xControlPlaneResponseBuff, pxCtx->pxNetif, &pxRxBuff ) != pdTRUE )
+            {
+                pxCtx->pxSpiStats->ulRxDropped++;
+            }
         }
         else if( pxRxBuff != NULL )
         {
@@ -664,7 +730,6 @@ void vDataplaneThread( void * pvParameters )
             pxRxBuff = NULL;
         }
 
-        configASSERT( pxTxBuff == NULL );
         configASSERT( pxRxBuff == NULL );
     }
 }
@@ -23,7 +23,8 @@
  */
 
 #include "logging_levels.h"
-#define LOG_LEVEL    LOG_ERROR
+#define LOG_LEVEL     LOG_ERROR
+#define LOG_MODULE    LOG_MODULE_NET
 #include "logging.h"
 
 
@@ -32,6 +33,7 @@
 #include "FreeRTOS.h"
 #include "semphr.h"
 #include "message_buffer.h"
+#include "timers.h"
 #include "netif/ethernet.h"
 #include "string.h"
 #include "atomic.h"
@@ -46,6 +48,16 @@ typedef struct
     PacketBuffer_t * pxTxPbuf;
     PacketBuffer_t * pxRxPbuf;
     TaskHandle_t xWaitingTask;
+
+    /* Asynchronous requests only */
+    MxRequestCallback_t xCallback;
+    void * pvCallbackCtx;
+    void * pvResponse;
+    uint32_t ulResponseLength;
+    TickType_t xStartTime;
+    TickType_t xTimeout;
+    BaseType_t xTimerArmed;
+    TimerHandle_t xTimeoutTimer;
 } IPCRequestCtx_t;
 
 /* Static variables */
@@ -87,6 +99,13 @@ static void vClearCtx( IPCRequestCtx_t * pxRequestCtx )
             pxRequestCtx->pxRxPbuf = NULL;
         }
 
+        /* Clear asynchronous request state */
+        pxRequestCtx->xCallback = NULL;
+        pxRequestCtx->pvCallbackCtx = NULL;
+        pxRequestCtx->pvResponse = NULL;
+        pxRequestCtx->ulResponseLength = 0;
+        pxRequestCtx->xTimerArmed = pdFALSE;
+
         xResult = xSemaphoreGive( xContextArrayMutex );
 
         configASSERT( xResult == pdTRUE );
@@ -109,119 +128,352 @@ static IPCRequestCtx_t * pxFindAvailableCtx( TickType_t xTimeout,
     /* Wait for a context to become available, then take a token from xContextCountSemaphore */
     xResult = xSemaphoreTake( xContextCountSemaphore, xTimeout );
 
-    configASSERT( xResult == pdTRUE );
-
-    configASSERT( xContextArrayMutex != NULL );
+    if( xResult != pdTRUE )
+    {
+        LogError( "Timed out while waiting for an available IPCRequestCtx." );
+    }
+    else
+    {
+        configASSERT( xContextArrayMutex != NULL );
 
-    xResult = xSemaphoreTake( xContextArrayMutex, xTimeout );
+        xResult = xSemaphoreTake( xContextArrayMutex, xTimeout );
 
-    if( xResult == pdTRUE )
-    {
-        for( uint32_t i = 0; i < NUM_IPC_REQUEST_CTX; i++ )
+        if( xResult == pdTRUE )
         {
-            if( xIPCRequestCtxArray[ i ].ulRequestID == 0 )
+            for( uint32_t i = 0; i < NUM_IPC_REQUEST_CTX; i++ )
             {
-                xIPCRequestCtxArray[ i ].ulRequestID = prvGetNextRequestID();
+                if( xIPCRequestCtxArray[ i ].ulRequestID == 0 )
+                {
+                    xIPCRequestCtxArray[ i ].ulRequestID = prvGetNextRequestID();
 
-                pxRequestCtx = &( xIPCRequestCtxArray[ i ] );
+                    pxRequestCtx = &( xIPCRequestCtxArray[ i ] );
 
-                if( pxRequestCtx->pxRxPbuf != NULL )
-                {
-                    PBUF_FREE( pxRequestCtx->pxRxPbuf );
-                    LogWarn( "pxRxPbuf for IPCRequestCtx %d was non-null upon re-use.", i );
-                }
+                    if( pxRequestCtx->pxRxPbuf != NULL )
+                    {
+                        PBUF_FREE( pxRequestCtx->pxRxPbuf );
+                        LogWarn( "pxRxPbuf for IPCRequestCtx %d was non-null upon re-use.", i );
+                    }
 
-                if( pxRequestCtx->pxTxPbuf != NULL )
-                {
-                    PBUF_FREE( pxRequestCtx->pxTxPbuf );
-                    LogWarn( "pxTxPbuf for IPCRequestCtx %d was non-null upon re-use.", i );
-                }
+                    if( pxRequestCtx->pxTxPbuf != NULL )
+                    {
+                        PBUF_FREE( pxRequestCtx->pxTxPbuf );
+                        LogWarn( "pxTxPbuf for IPCRequestCtx %d was non-null upon re-use.", i );
+                    }
 
-                if( pxRequestCtx->xWaitingTask != NULL )
-                {
-                    pxRequestCtx->xWaitingTask = NULL;
-                    LogWarn( "xWaitingTask for IPCRequestCtx %d was non-null upon re-use.", i );
+                    if( pxRequestCtx->xWaitingTask != NULL )
+                    {
+                        pxRequestCtx->xWaitingTask = NULL;
+                        LogWarn( "xWaitingTask for IPCRequestCtx %d was non-null upon re-use.", i );
+                    }
+
+                    /* Allocate a tx pbuf */
+                    pxRequestCtx->pxTxPbuf = PBUF_ALLOC_TX( xPbufLen );
+                    break;
                 }
+            }
+
+            xResult = xSemaphoreGive( xContextArrayMutex );
 
-                /* Allocate a tx pbuf */
-                pxRequestCtx->pxTxPbuf = PBUF_ALLOC_TX( xPbufLen );
-/*                LogDebug( "Allocated pbuf: %p length: %d ref: %d",  pxRequestCtx->pxTxPbuf, pxRequestCtx->pxRxPbuf->tot_len, pxRequestCtx->pxRxPbuf->ref ); */
-                break;
+            configASSERT( xResult == pdTRUE );
+
+            if( ( pxRequestCtx != NULL ) &&
+                ( pxRequestCtx->pxTxPbuf == NULL ) )
+            {
+                LogError( "Failed to allocate a pbuf for IPC request id: %d.", pxRequestCtx->ulRequestID );
+                vClearCtx( pxRequestCtx );
+                pxRequestCtx = NULL;
             }
         }
+        else
+        {
+            LogError( "Timed out while acquiring xContextArrayMutex." );
 
-        xResult = xSemaphoreGive( xContextArrayMutex );
+            /* Return the token taken above */
+            ( void ) xSemaphoreGive( xContextCountSemaphore );
+        }
+    }
+
+    return pxRequestCtx;
+}
+
+/*
+ * Copy the data portion of a response packet into the caller provided buffer,
+ * truncating to the length actually received from the module.
+ */
+static void vCopyResponse( PacketBuffer_t * pxRxPbuf,
+                           void * pvResponse,
+                           uint32_t ulResponseLength )
+{
+    if( ( pxRxPbuf != NULL ) &&
+        ( pvResponse != NULL ) &&
+        ( ulResponseLength > 0 ) )
+    {
+        IPCPacket_t * pxResponsePacket = ( IPCPacket_t * ) pxRxPbuf->payload;
+        uint32_t ulDataLength = 0;
+
+        if( pxRxPbuf->len > sizeof( IPCHeader_t ) )
+        {
+            ulDataLength = pxRxPbuf->len - sizeof( IPCHeader_t );
+        }
+
+        if( ulDataLength > ulResponseLength )
+        {
+            ulDataLength = ulResponseLength;
+        }
+
+        ( void ) memcpy( pvResponse, &( pxResponsePacket->xData ), ulDataLength );
+    }
+}
+
+/*
+ * Start the timeout timer of an asynchronous request if it has not completed already.
+ */
+static void vArmRequestTimer( IPCRequestCtx_t * pxRequestCtx,
+                              uint32_t ulRequestId )
+{
+    BaseType_t xResult;
+
+    xResult = xSemaphoreTake( xContextArrayMutex, portMAX_DELAY );
+    configASSERT( xResult == pdTRUE );
+
+    if( ( pxRequestCtx->ulRequestID == ulRequestId ) &&
+        ( pxRequestCtx->xCallback != NULL ) )
+    {
+        pxRequestCtx->xTimerArmed = pdTRUE;
+
+        if( xTimerChangePeriod( pxRequestCtx->xTimeoutTimer, pxRequestCtx->xTimeout, 0 ) != pdPASS )
+        {
+            LogError( "Failed to start timeout timer for IPC request id: %d.", ulRequestId );
+        }
+    }
+
+    xResult = xSemaphoreGive( xContextArrayMutex );
+    configASSERT( xResult == pdTRUE );
+}
+
+/*
+ * Timer service task callback. The timer service task must not block, so the
+ * expired request is completed by the control plane router, which is woken by
+ * a NULL message in its response buffer.
+ */
+static void vRequestTimeoutCallback( TimerHandle_t xTimer )
+{
+    PacketBuffer_t * pxWakeup = NULL;
+    size_t xSent;
+
+    /* The data plane thread writes to the same buffer, writers take turns in a critical section */
+    taskENTER_CRITICAL();
+    {
+        xSent = xMessageBufferSend( pxControlPlaneCtx->xControlPlaneResponseBuff,
+                                    &pxWakeup,
+                                    sizeof( PacketBuffer_t * ),
+                                    0 );
+    }
+    taskEXIT_CRITICAL();
+
+    if( xSent == 0 )
+    {
+        /* The buffer is full, try again on the next tick */
+        ( void ) xTimerChangePeriod( xTimer, 1, 0 );
+    }
+}
+
+/*
+ * Complete the asynchronous requests whose timeout has expired with IPC_TIMEOUT.
+ * Called by the control plane router when a request timer wakes it.
+ */
+static void vExpireRequests( void )
+{
+    for( uint32_t i = 0; i < NUM_IPC_REQUEST_CTX; i++ )
+    {
+        IPCRequestCtx_t * pxRequestCtx = &( xIPCRequestCtxArray[ i ] );
+        MxRequestCallback_t xCallback = NULL;
+        void * pvCallbackCtx = NULL;
+        BaseType_t xResult;
 
+        xResult = xSemaphoreTake( xContextArrayMutex, portMAX_DELAY );
         configASSERT( xResult == pdTRUE );
+
+        /* Ignore expirations which raced with a response or a re-use of the context */
+        if( ( pxRequestCtx->ulRequestID != 0 ) &&
+            ( pxRequestCtx->xCallback != NULL ) &&
+            ( pxRequestCtx->xTimerArmed == pdTRUE ) &&
+            ( ( xTaskGetTickCount() - pxRequestCtx->xStartTime ) >= pxRequestCtx->xTimeout ) )
+        {
+            LogWarn( "Timed out waiting for response to IPC request id: %d.", pxRequestCtx->ulRequestID );
+
+            xCallback = pxRequestCtx->xCallback;
+            pvCallbackCtx = pxRequestCtx->pvCallbackCtx;
+            pxRequestCtx->xCallback = NULL;
+        }
+
+        xResult = xSemaphoreGive( xContextArrayMutex );
+        configASSERT( xResult == pdTRUE );
+
+        /* Release the context before calling back so the callback may issue a new request */
+        if( xCallback != NULL )
+        {
+            vClearCtx( pxRequestCtx );
+            xCallback( IPC_TIMEOUT, pvCallbackCtx );
+        }
+    }
+}
+
+/*
+ * Wait for the control plane router to deliver the response to a synchronous request.
+ * The notification value carries the request id so that late responses to an earlier,
+ * timed out request are ignored.
+ */
+static IPCError_t xWaitForResponse( IPCRequestCtx_t * pxRequestCtx,
+                                    uint32_t ulRequestId,
+                                    TickType_t xTimeout )
+{
+    IPCError_t xReturnValue = IPC_TIMEOUT;
+    TickType_t xRemainingTicks = xTimeout;
+    TimeOut_t xTimeOut;
+
+    vTaskSetTimeOutState( &xTimeOut );
+
+    for( ; ; )
+    {
+        uint32_t ulNotifyValue = 0;
+
+        if( ( xTaskNotifyWaitIndexed( IPC_RESPONSE_IDX, 0, 0xFFFFFFFF, &ulNotifyValue, xRemainingTicks ) == pdTRUE ) &&
+            ( ulNotifyValue == ulRequestId ) &&
+            ( pxRequestCtx->pxRxPbuf != NULL ) )
+        {
+            xReturnValue = IPC_SUCCESS;
+            break;
+        }
+
+        /* xTaskCheckForTimeOut adjusts xRemainingTicks */
+        if( xTaskCheckForTimeOut( &xTimeOut, &xRemainingTicks ) == pdTRUE )
+        {
+            break;
+        }
+    }
+
+    pxRequestCtx->xWaitingTask = NULL;
+
+    return xReturnValue;
+}
+
+/*
+ * Reserve a request context and return the request packet, located directly in the
+ * context's TX pbuf so that the request does not need to be copied before transmission.
+ * Returns NULL if no context could be allocated within xTimeout.
+ */
+static IPCPacket_t * pxAllocIPCRequest( uint16_t usApiId,
+                                        uint32_t ulTxPacketDataLen,
+                                        TickType_t xTimeout,
+                                        IPCRequestCtx_t ** ppxRequestCtx )
+{
+    IPCPacket_t * pxTxPkt = NULL;
+
+    configASSERT( ppxRequestCtx != NULL );
+
+    configASSERT( ulTxPacketDataLen <= sizeof( IPCPacketData_t ) );
+
+    BaseType_t ulTxPacketLen = sizeof( IPCHeader_t ) + ulTxPacketDataLen;
+
+    /* Allocate a request context */
+    IPCRequestCtx_t * pxRequestCtx = pxFindAvailableCtx( xTimeout, ulTxPacketLen );
+
+    if( pxRequestCtx == NULL )
+    {
+        LogError( "Timed out while finding a request context." );
     }
     else
     {
-        LogError( "Timed out while acquiring xContextArrayMutex." );
+        pxTxPkt = ( IPCPacket_t * ) pxRequestCtx->pxTxPbuf->payload;
+
+        pxTxPkt->xHeader.ulIPCRequestId = pxRequestCtx->ulRequestID;
+        pxTxPkt->xHeader.usIPCApiId = usApiId;
+
+        LogDebug( "Preparing IPC packet with request_id: %d, api_id: %d, pktdatalen: %d, total_len: %d",
+                  pxRequestCtx->ulRequestID, usApiId, ulTxPacketDataLen, ulTxPacketLen );
     }
 
-    return pxRequestCtx;
+    *ppxRequestCtx = pxRequestCtx;
+
+    return pxTxPkt;
 }
 
-static IPCError_t xSendIPCRequest( IPCPacket_t * pxTxPkt,
-                                   uint32_t ulTxPacketDataLen,
+/*
+ * Send an IPC request prepared with pxAllocIPCRequest to the module.
+ * When xCallback is NULL, block until the response is received or xTimeout expires.
+ * Otherwise, return once the request is queued and call xCallback upon completion.
+ */
+static IPCError_t xSendIPCRequest( IPCRequestCtx_t * pxRequestCtx,
                                    void * pxResponse,
                                    uint32_t ulResponseLength,
-                                   TickType_t xTimeout )
+                                   TickType_t xTimeout,
+                                   MxRequestCallback_t xCallback,
+                                   void * pvCallbackCtx )
 {
     IPCError_t xReturnValue = IPC_SUCCESS;
 
     /* Validate inputs */
-    configASSERT( pxTxPkt != NULL );
-
-    configASSERT( ulTxPacketDataLen <= sizeof( IPCPacketData_t ) );
-
     configASSERT( ( pxResponse != NULL && ulResponseLength > 0 ) ||
                   ( pxResponse == NULL && ulResponseLength == 0 ) );
 
-    BaseType_t ulTxPacketLen = sizeof( IPCHeader_t ) + ulTxPacketDataLen;
     BaseType_t xResult = pdFALSE;
-
-    /* Allocate a request context */
-    IPCRequestCtx_t * pxRequestCtx = pxFindAvailableCtx( xTimeout, ulTxPacketLen );
-
-    LogDebug( "Sending IPC packet with request_id: %d, api_id: %d, pktdatalen: %d, total_len: %d",
-              pxRequestCtx->ulRequestID, pxTxPkt->xHeader.usIPCApiId, ulTxPacketDataLen, ulTxPacketLen );
+    uint32_t ulRequestId = 0;
 
     if( pxRequestCtx == NULL )
     {
-        LogError( "Timed out while finding a request context." );
         xReturnValue = IPC_ERROR_INTERNAL;
     }
     else
     {
-        /* Set request ID */
-        pxTxPkt->xHeader.ulIPCRequestId = pxRequestCtx->ulRequestID;
+        PacketBuffer_t * pxTxPbuf = pxRequestCtx->pxTxPbuf;
+
+        configASSERT( pxTxPbuf != NULL );
+
+        ulRequestId = pxRequestCtx->ulRequestID;
 
-        /* Set task handle */
-        pxRequestCtx->xWaitingTask = xTaskGetCurrentTaskHandle();
+        if( xCallback == NULL )
+        {
+            /* Discard any stale response notification */
+            ( void ) xTaskNotifyStateClearIndexed( NULL, IPC_RESPONSE_IDX );
 
-        /* Copy to pbuf */
-        ( void ) memcpy( pxRequestCtx->pxTxPbuf->payload, pxTxPkt, ulTxPacketLen );
+            /* Set task handle */
+            pxRequestCtx->xWaitingTask = xTaskGetCurrentTaskHandle();
+        }
+        else
+        {
+            pxRequestCtx->xCallback = xCallback;
+            pxRequestCtx->pvCallbackCtx = pvCallbackCtx;
+            pxRequestCtx->pvResponse = pxResponse;
+            pxRequestCtx->ulResponseLength = ulResponseLength;
+            pxRequestCtx->xStartTime = xTaskGetTickCount();
+            pxRequestCtx->xTimeout = ( xTimeout > 0 ) ? xTimeout : 1;
+        }
+
+        /* Ownership of the pbuf passes to the queue. Clear the pointer before sending since
+         * the response may be processed before xQueueSend returns. */
+        pxRequestCtx->pxTxPbuf = NULL;
 
         configASSERT( pxControlPlaneCtx->xControlPlaneSendQueue != NULL );
 
+        /* Count the packet first, the dataplane thread may transmit it and decrement
+         * the count before xQueueSend returns */
+        Atomic_Increment_u32( pxControlPlaneCtx->pulTxPacketsWaiting );
+
         /* Send to dataplane thread for transmission */
         xResult = xQueueSend( pxControlPlaneCtx->xControlPlaneSendQueue,
-                              &( pxRequestCtx->pxTxPbuf ),
+                              &pxTxPbuf,
                               xTimeout );
 
-        Atomic_Increment_u32( pxControlPlaneCtx->pulTxPacketsWaiting );
-
         if( xResult != pdTRUE )
         {
-            LogError( "Error when sending message with request id=%d", pxRequestCtx->ulRequestID );
+            LogError( "Error when sending message with request id=%d", ulRequestId );
+            Atomic_Decrement_u32( pxControlPlaneCtx->pulTxPacketsWaiting );
+            PBUF_FREE( pxTxPbuf );
             xReturnValue = IPC_ERROR_INTERNAL;
         }
         else
         {
-            /* Clear the pointer. Reference is now owned by the queue. */
-            pxRequestCtx->pxTxPbuf = NULL;
-
             configASSERT( pxControlPlaneCtx->xDataPlaneTaskHandle != NULL );
 
             /* Notify dataplane thread of a waiting message */
@@ -229,56 +481,60 @@ static IPCError_t xSendIPCRequest( IPCPacket_t * pxTxPkt,
         }
     }
 
-    IPCPacket_t * pxResponsePacket = NULL;
-
-    /* If the message was sent successfully, wait for a task notification */
-    if( xResult == pdTRUE )
+    if( pxRequestCtx == NULL )
     {
-        /* Wait for notification */
-        xResult = xTaskNotifyWait( 0, 0, NULL, xTimeout );
-
-        if( xResult == pdTRUE )
+        /* No context to clean up */
+    }
+    else if( xReturnValue != IPC_SUCCESS )
+    {
+        /* Request was never sent. Completion callback is not called. */
+        vClearCtx( pxRequestCtx );
+    }
+    else if( xCallback != NULL )
+    {
+        if( xTimeout != portMAX_DELAY )
         {
-            pxResponsePacket = ( IPCPacket_t * ) pxRequestCtx->pxRxPbuf->payload;
+            vArmRequestTimer( pxRequestCtx, ulRequestId );
         }
-        else
+    }
+    else
+    {
+        /* Wait for notification */
+        xReturnValue = xWaitForResponse( pxRequestCtx, ulRequestId, xTimeout );
+
+        if( xReturnValue == IPC_SUCCESS )
         {
-            xReturnValue = IPC_TIMEOUT;
+            vCopyResponse( pxRequestCtx->pxRxPbuf, pxResponse, ulResponseLength );
         }
 
-        pxRequestCtx->xWaitingTask = NULL;
-    }
-
-    if( ( pxResponsePacket != NULL ) &&
-        ( ulResponseLength > 0 ) &&
-        ( pxResponse != NULL ) )
-    {
-        ( void ) memcpy( pxResponse, &( pxResponsePacket->xData ), ulResponseLength );
+        /* Clear the context (also frees the response buffer) */
+        vClearCtx( pxRequestCtx );
     }
 
-    /* Clear the context (also frees the response buffer) */
-    vClearCtx( pxRequestCtx );
-
     return xReturnValue;
 }
 
-IPCError_t mx_RequestVersion( char * pcVersionBuffer,
-                              uint32_t ulVersionLength,
-                              TickType_t xTimeout )
+static IPCError_t xRequestVersion( char * pcVersionBuffer,
+                                   uint32_t ulVersionLength,
+                                   TickType_t xTimeout,
+                                   MxRequestCallback_t xCallback,
+                                   void * pvCallbackCtx )
 {
     IPCError_t xReturnValue = IPC_SUCCESS;
 
-    IPCPacket_t xTxPkt;
-
-    xTxPkt.xHeader.usIPCApiId = IPC_SYS_VERSION;
+    IPCRequestCtx_t * pxRequestCtx = NULL;
 
     if( ( pcVersionBuffer != NULL ) &&
         ( ulVersionLength >= MX_FIRMWARE_REVISION_SIZE ) )
     {
-        xReturnValue = xSendIPCRequest( &xTxPkt, 0,
+        ( void ) pxAllocIPCRequest( IPC_SYS_VERSION, 0, xTimeout, &pxRequestCtx );
+
+        xReturnValue = xSendIPCRequest( pxRequestCtx,
                                         ( IPCPacketData_t * ) pcVersionBuffer,
                                         ulVersionLength,
-                                        xTimeout );
+                                        xTimeout,
+                                        xCallback,
+                                        pvCallbackCtx );
     }
     else
     {
@@ -288,35 +544,63 @@ IPCError_t mx_RequestVersion( char * pcVersionBuffer,
     return xReturnValue;
 }
 
+IPCError_t mx_RequestVersion( char * pcVersionBuffer,
+                              uint32_t ulVersionLength,
+                              TickType_t xTimeout )
+{
+    return xRequestVersion( pcVersionBuffer, ulVersionLength, xTimeout, NULL, NULL );
+}
+
+IPCError_t mx_RequestVersionAsync( char * pcVersionBuffer,
+                                   uint32_t ulVersionLength,
+                                   TickType_t xTimeout,
+                                   MxRequestCallback_t xCallback,
+                                   void * pvCallbackCtx )
+{
+    IPCError_t xReturnValue = IPC_PARAMETER_ERROR;
+
+    if( xCallback != NULL )
+    {
+        xReturnValue = xRequestVersion( pcVersionBuffer, ulVersionLength, xTimeout, xCallback, pvCallbackCtx );
+    }
+
+    return xReturnValue;
+}
+
 IPCError_t mx_FactoryReset( TickType_t xTimeout )
 {
     IPCError_t xReturnValue = IPC_SUCCESS;
 
-    IPCPacket_t xTxPkt;
+    IPCRequestCtx_t * pxRequestCtx = NULL;
 
-    xTxPkt.xHeader.usIPCApiId = IPC_SYS_RESET;
+    ( void ) pxAllocIPCRequest( IPC_SYS_RESET, 0, xTimeout, &pxRequestCtx );
 
-    xReturnValue = xSendIPCRequest( &xTxPkt, 0,
+    xReturnValue = xSendIPCRequest( pxRequestCtx,
                                     NULL, 0,
-                                    xTimeout );
+                                    xTimeout,
+                                    NULL, NULL );
     return xReturnValue;
 }
 
-IPCError_t mx_GetMacAddress( MacAddress_t * pxMacAddress,
-                             TickType_t xTimeout )
+static IPCError_t xGetMacAddress( MacAddress_t * pxMacAddress,
+                                  TickType_t xTimeout,
+                                  MxRequestCallback_t xCallback,
+                                  void * pvCallbackCtx )
 {
     IPCError_t xReturnValue = IPC_SUCCESS;
 
     if( pxMacAddress != NULL )
     {
-        IPCPacket_t xTxPkt;
-        xTxPkt.xHeader.usIPCApiId = IPC_WIFI_GET_MAC;
+        IPCRequestCtx_t * pxRequestCtx = NULL;
 
-        xReturnValue = xSendIPCRequest( &xTxPkt,
-                                        0,
+        ( void ) pxAllocIPCRequest( IPC_WIFI_GET_MAC, 0, xTimeout, &pxRequestCtx );
+
+        xReturnValue = xSendIPCRequest( pxRequestCtx,
                                         ( IPCPacketData_t * ) pxMacAddress,
                                         sizeof( struct eth_addr ),
-                                        xTimeout );
+                                        xTimeout,
+                                        xCallback,
+                                        pvCallbackCtx );
     }
     else
     {
@@ -326,6 +610,27 @@ IPCError_t mx_GetMacAddress( MacAddress_t * pxMacAddress,
     return xReturnValue;
 }
 
+IPCError_t mx_GetMacAddress( MacAddress_t * pxMacAddress,
+                             TickType_t xTimeout )
+{
+    return xGetMacAddress( pxMacAddress, xTimeout, NULL, NULL );
+}
+
+IPCError_t mx_GetMacAddressAsync( MacAddress_t * pxMacAddress,
+                                  TickType_t xTimeout,
+                                  MxRequestCallback_t xCallback,
+                                  void * pvCallbackCtx )
+{
+    IPCError_t xReturnValue = IPC_PARAMETER_ERROR;
+
+    if( xCallback != NULL )
+    {
+        xReturnValue = xGetMacAddress( pxMacAddress, xTimeout, xCallback, pvCallbackCtx );
+    }
+
+    return xReturnValue;
+}
+
 IPCError_t mx_Connect( const char * pcSSID,
                        const char * pcPSK,
                        TickType_t xTimeout )
@@ -361,37 +666,43 @@ IPCError_t mx_Connect( const char * pcSSID,
 
     if( xReturnValue == IPC_SUCCESS )
     {
-        IPCPacket_t xTxPkt;
-
-        xTxPkt.xHeader.usIPCApiId = IPC_WIFI_CONNECT;
+        IPCRequestCtx_t * pxRequestCtx = NULL;
+        IPCPacket_t * pxTxPkt = pxAllocIPCRequest( IPC_WIFI_CONNECT,
+                                                   sizeof( IPCRequestWifiConnect_t ),
+                                                   xTimeout,
+                                                   &pxRequestCtx );
 
-        xTxPkt.xData.xRequestWifiConnect.ucUseAttr = pdFALSE;
-        xTxPkt.xData.xRequestWifiConnect.ucUseStaticIp = pdFALSE;
-        xTxPkt.xData.xRequestWifiConnect.ucAccessPointChannel = 0;
-        xTxPkt.xData.xRequestWifiConnect.ucSecurityType = 0;
+        if( pxTxPkt != NULL )
+        {
+            IPCRequestWifiConnect_t * pxRequest = &( pxTxPkt->xData.xRequestWifiConnect );
 
-        ( void ) memset( &( xTxPkt.xData.xRequestWifiConnect.ucAccessPointBssid ),
-                         0, MX_BSSID_LEN );
-        ( void ) memset( &( xTxPkt.xData.xRequestWifiConnect.xStaticIpInfo ),
-                         0, sizeof( IPInfoType_t ) );
+            pxRequest->ucUseAttr = pdFALSE;
+            pxRequest->ucUseStaticIp = pdFALSE;
+            pxRequest->ucAccessPointChannel = 0;
+            pxRequest->ucSecurityType = 0;
 
+            ( void ) memset( &( pxRequest->ucAccessPointBssid ),
+                             0, MX_BSSID_LEN );
+            ( void ) memset( &( pxRequest->xStaticIpInfo ),
+                             0, sizeof( IPInfoType_t ) );
 
-        ( void ) strncpy( xTxPkt.xData.xRequestWifiConnect.cSSID,
-                          pcSSID,
-                          MX_SSID_BUF_LEN );
 
-        xTxPkt.xData.xRequestWifiConnect.lKeyLength = lPSKLength;
+            ( void ) strncpy( pxRequest->cSSID,
+                              pcSSID,
+                              MX_SSID_BUF_LEN );
 
-        ( void ) strncpy( xTxPkt.xData.xRequestWifiConnect.cPSK,
-                          pcPSK,
-                          MX_PSK_BUF_LEN );
+            pxRequest->lKeyLength = lPSKLength;
 
+            ( void ) strncpy( pxRequest->cPSK,
+                              pcPSK,
+                              MX_PSK_BUF_LEN );
+        }
 
-        xReturnValue = xSendIPCRequest( &xTxPkt,
-                                        sizeof( IPCRequestWifiConnect_t ),
+        xReturnValue = xSendIPCRequest( pxRequestCtx,
                                         NULL,
                                         0,
-                                        xTimeout );
+                                        xTimeout,
+                                        NULL, NULL );
     }
     else
     {
@@ -401,36 +712,71 @@ IPCError_t mx_Connect( const char * pcSSID,
     return xReturnValue;
 }
 
-IPCError_t mx_Disconnect( TickType_t xTimeout )
+static IPCError_t xDisconnect( TickType_t xTimeout,
+                               MxRequestCallback_t xCallback,
+                               void * pvCallbackCtx )
 {
     IPCError_t xReturnValue = IPC_SUCCESS;
 
-    IPCPacket_t xTxPkt;
+    IPCRequestCtx_t * pxRequestCtx = NULL;
 
-    xTxPkt.xHeader.usIPCApiId = IPC_WIFI_DISCONNECT;
+    ( void ) pxAllocIPCRequest( IPC_WIFI_DISCONNECT, 0, xTimeout, &pxRequestCtx );
 
-    xReturnValue = xSendIPCRequest( &xTxPkt, 0,
+    xReturnValue = xSendIPCRequest( pxRequestCtx,
                                     NULL, 0,
-                                    xTimeout );
+                                    xTimeout,
+                                    xCallback,
+                                    pvCallbackCtx );
 
     return xReturnValue;
 }
 
-IPCError_t mx_SetBypassMode( BaseType_t xEnable,
-                             TickType_t xTimeout )
+IPCError_t mx_Disconnect( TickType_t xTimeout )
+{
+    return xDisconnect( xTimeout, NULL, NULL );
+}
+
+IPCError_t mx_DisconnectAsync( TickType_t xTimeout,
+                               MxRequestCallback_t xCallback,
+                               void * pvCallbackCtx )
+{
+    IPCError_t xReturnValue = IPC_PARAMETER_ERROR;
+
+    if( xCallback != NULL )
+    {
+        xReturnValue = xDisconnect( xTimeout, xCallback, pvCallbackCtx );
+    }
+
+    return xReturnValue;
+}
+
+static IPCError_t xSetBypassMode( BaseType_t xEnable,
+                                  TickType_t xTimeout,
+                                  MxRequestCallback_t xCallback,
+                                  void * pvCallbackCtx )
 {
     IPCError_t xError = IPC_SUCCESS;
 
-    IPCPacket_t xTxPkt;
+    IPCRequestCtx_t * pxRequestCtx = NULL;
 
     if( ( xEnable == pdFALSE ) ||
         ( xEnable == pdTRUE ) )
     {
-        xTxPkt.xHeader.usIPCApiId = IPC_WIFI_BYPASS_SET;
-        xTxPkt.xData.xRequestWifiBypassSet.enable = ( uint32_t ) xEnable;
-        xError = xSendIPCRequest( &xTxPkt, sizeof( IPCRequestWifiBypassSet_t ),
+        IPCPacket_t * pxTxPkt = pxAllocIPCRequest( IPC_WIFI_BYPASS_SET,
+                                                   sizeof( IPCRequestWifiBypassSet_t ),
+                                                   xTimeout,
+                                                   &pxRequestCtx );
+
+        if( pxTxPkt != NULL )
+        {
+            pxTxPkt->xData.xRequestWifiBypassSet.enable = ( uint32_t ) xEnable;
+        }
+
+        xError = xSendIPCRequest( pxRequestCtx,
                                   NULL, 0,
-                                  xTimeout );
+                                  xTimeout,
+                                  xCallback,
+                                  pvCallbackCtx );
     }
     else
     {
@@ -440,6 +786,27 @@ IPCError_t mx_SetBypassMode( BaseType_t xEnable,
     return xError;
 }
 
+IPCError_t mx_SetBypassMode( BaseType_t xEnable,
+                             TickType_t xTimeout )
+{
+    return xSetBypassMode( xEnable, xTimeout, NULL, NULL );
+}
+
+IPCError_t mx_SetBypassModeAsync( BaseType_t xEnable,
+                                  TickType_t xTimeout,
+                                  MxRequestCallback_t xCallback,
+                                  void * pvCallbackCtx )
+{
+    IPCError_t xError = IPC_PARAMETER_ERROR;
+
+    if( xCallback != NULL )
+    {
+        xError = xSetBypassMode( xEnable, xTimeout, xCallback, pvCallbackCtx );
+    }
+
+    return xError;
+}
+
 IPCError_t mx_RegisterEventCallback( MxEventCallback_t xCallback,
                                      void * pxCallbackContext )
 {
@@ -489,6 +856,19 @@ void prvControlPlaneRouter( void * pvParameters )
         xIPCRequestCtxArray[ i ].pxTxPbuf = NULL;
         xIPCRequestCtxArray[ i ].pxRxPbuf = NULL;
         xIPCRequestCtxArray[ i ].xWaitingTask = NULL;
+        xIPCRequestCtxArray[ i ].xCallback = NULL;
+        xIPCRequestCtxArray[ i ].pvCallbackCtx = NULL;
+        xIPCRequestCtxArray[ i ].pvResponse = NULL;
+        xIPCRequestCtxArray[ i ].ulResponseLength = 0;
+        xIPCRequestCtxArray[ i ].xStartTime = 0;
+        xIPCRequestCtxArray[ i ].xTimeout = 0;
+        xIPCRequestCtxArray[ i ].xTimerArmed = pdFALSE;
+        xIPCRequestCtxArray[ i ].xTimeoutTimer = xTimerCreate( "MxIPC",
+                                                               MX_DEFAULT_TIMEOUT_TICK,
+                                                               pdFALSE,
+                                                               &( xIPCRequestCtxArray[ i ] ),
+                                                               vRequestTimeoutCallback );
+        configASSERT( xIPCRequestCtxArray[ i ].xTimeoutTimer != NULL );
     }
 
     xSemaphoreGive( xContextArrayMutex );
@@ -534,6 +914,10 @@ void prvControlPlaneRouter( void * pvParameters )
             /* Otherwise, message is a response, find the relevant IPCRequestCtx to send the packet to */
             else
             {
+                IPCRequestCtx_t * pxAsyncCtx = NULL;
+                MxRequestCallback_t xCallback = NULL;
+                void * pvCallbackCtx = NULL;
+
                 /* Wait for xContextArrayMutex */
                 xResult = xSemaphoreTake( xContextArrayMutex, portMAX_DELAY );
 
@@ -550,27 +934,41 @@ void prvControlPlaneRouter( void * pvParameters )
                     }
                 }
 
-                /* Send packet to waiting thread */
+                /* Complete an asynchronous request */
                 if( ( pxTargetCtx != NULL ) &&
-                    ( pxTargetCtx->pxRxPbuf == NULL ) &&
-                    ( pxTargetCtx->xWaitingTask != NULL ) )
+                    ( pxTargetCtx->xCallback != NULL ) )
                 {
-                    LogDebug( "Notifying waiting task %d of RX packet.", pxTargetCtx->xWaitingTask );
-                    pxTargetCtx->pxRxPbuf = pxRxPbuf;
-                    xResult = xTaskNotify( pxTargetCtx->xWaitingTask, 0, eNoAction );
+                    LogDebug( "Completing asynchronous request id: %d.", pxTargetCtx->ulRequestID );
 
-                    if( xResult == pdTRUE )
-                    {
-                        /* Increase pbuf reference count */
-                        pbuf_ref( pxRxPbuf );
-                    }
-                    else
+                    vCopyResponse( pxRxPbuf, pxTargetCtx->pvResponse, pxTargetCtx->ulResponseLength );
+
+                    xCallback = pxTargetCtx->xCallback;
+                    pvCallbackCtx = pxTargetCtx->pvCallbackCtx;
+                    pxTargetCtx->xCallback = NULL;
+
+                    if( pxTargetCtx->xTimerArmed == pdTRUE )
                     {
-                        pxTargetCtx->pxRxPbuf = NULL;
-                        LogError( "Error delivering response message with AppId: %d and RequestId: %d",
-                                  pxRxPacket->xHeader.usIPCApiId,
-                                  pxRxPacket->xHeader.ulIPCRequestId );
+                        pxTargetCtx->xTimerArmed = pdFALSE;
+                        ( void ) xTimerStop( pxTargetCtx->xTimeoutTimer, 0 );
                     }
+
+                    pxAsyncCtx = pxTargetCtx;
+                }
+                /* Send packet to waiting thread */
+                else if( ( pxTargetCtx != NULL ) &&
+                         ( pxTargetCtx->pxRxPbuf == NULL ) &&
+                         ( pxTargetCtx->xWaitingTask != NULL ) )
+                {
+                    LogDebug( "Notifying waiting task %d of RX packet.", pxTargetCtx->xWaitingTask );
+
+                    /* Increase pbuf reference count */
+                    pbuf_ref( pxRxPbuf );
+                    pxTargetCtx->pxRxPbuf = pxRxPbuf;
+
+                    ( void ) xTaskNotifyIndexed( pxTargetCtx->xWaitingTask,
+                                                 IPC_RESPONSE_IDX,
+                                                 pxTargetCtx->ulRequestID,
+                                                 eSetValueWithOverwrite );
                 }
                 else
                 {
@@ -582,11 +980,23 @@ void prvControlPlaneRouter( void * pvParameters )
                 /* Return the mutex */
                 xResult = xSemaphoreGive( xContextArrayMutex );
                 configASSERT( xResult == pdTRUE );
+
+                /* Release the context before calling back so the callback may issue a new request */
+                if( pxAsyncCtx != NULL )
+                {
+                    vClearCtx( pxAsyncCtx );
+                    xCallback( IPC_SUCCESS, pvCallbackCtx );
+                }
             }
 
             LogDebug( "Decreasing reference count of pxRxPbuf %p from %d to %d", pxRxPbuf, pxRxPbuf->ref, ( pxRxPbuf->ref - 1 ) );
             PBUF_FREE( pxRxPbuf );
         }
+        else if( xResult != pdFALSE )
+        {
+            /* A NULL message from vRequestTimeoutCallback */
+            vExpireRequests();
+        }
         else
         {
             LogError( "Error when reading from xControlPlaneResponseBuff" );
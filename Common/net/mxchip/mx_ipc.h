@@ -59,6 +59,40 @@ typedef enum
 typedef void ( * MxEventCallback_t )( MxStatus_t,
                                       void * );
 
+typedef enum
+{
+    MX_TX_CLASS_INTERACTIVE = 0,
+    MX_TX_CLASS_BULK,
+    MX_TX_CLASS_MAX
+} MxTxClass_t;
+
+typedef struct
+{
+    uint32_t ulEnqueued;        /* Frames accepted into the queue */
+    uint32_t ulDropped;         /* Frames dropped because the queue was full */
+    uint32_t ulDequeued;        /* Frames handed to the SPI transport */
+    uint32_t ulTotalDelayTicks; /* Sum of time spent queued by dequeued frames */
+    uint32_t ulMaxDelayTicks;   /* Longest time spent queued by a single frame */
+    uint32_t ulCopiedFrames;    /* Frames which had to be copied before transmission */
+    uint32_t ulCopiedBytes;     /* Bytes copied by the fallback path */
+} MxTxQueueStats_t;
+
+typedef struct
+{
+    uint32_t ulTransfers;    /* SPI transactions started after the module raised the flow pin */
+    uint32_t ulErrors;       /* Transactions which failed: HAL or DMA error, or event timeout */
+    uint32_t ulHeaderErrors; /* Received headers which failed validation */
+    uint32_t ulRxDropped;    /* Received frames dropped by lwIP or a full control plane buffer */
+} MxSpiStats_t;
+
+/*
+ * Completion callback for asynchronous IPC requests.
+ * Called exactly once per accepted request from either the MxCtrl task (on response)
+ * or the timer service task (on timeout). Must not block.
+ */
+typedef void ( * MxRequestCallback_t )( IPCError_t xError,
+                                        void * pvCallbackCtx );
+
 IPCError_t mx_RequestVersion( char * pcVersionBuffer,
                               uint32_t ulVersionLength,
                               TickType_t xTimeout );
@@ -80,4 +114,29 @@ IPCError_t mx_SetBypassMode( BaseType_t xEnable,
 IPCError_t mx_RegisterEventCallback( MxEventCallback_t pvCallback,
                                      void * pxCallbackContext );
 
+/*
+ * Asynchronous variants of the requests above. These return as soon as the request
+ * has been queued for transmission. Any response buffer must remain valid until
+ * xCallback has been called.
+ */
+IPCError_t mx_RequestVersionAsync( char * pcVersionBuffer,
+                                   uint32_t ulVersionLength,
+                                   TickType_t xTimeout,
+                                   MxRequestCallback_t xCallback,
+                                   void * pvCallbackCtx );
+
+IPCError_t mx_GetMacAddressAsync( struct eth_addr * pxMacAddress,
+                                  TickType_t xTimeout,
+                                  MxRequestCallback_t xCallback,
+                                  void * pvCallbackCtx );
+
+IPCError_t mx_DisconnectAsync( TickType_t xTimeout,
+                               MxRequestCallback_t xCallback,
+                               void * pvCallbackCtx );
+
+IPCError_t mx_SetBypassModeAsync( BaseType_t xEnable,
+                                  TickType_t xTimeout,
+                                  MxRequestCallback_t xCallback,
+                                  void * pvCallbackCtx );
+
 #endif /* _MXFREE_IPC_ */
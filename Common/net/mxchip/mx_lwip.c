@@ -23,44 +23,66 @@
  */
 #include "logging_levels.h"
 
-#define LOG_LEVEL    LOG_ERROR
+#define LOG_LEVEL     LOG_ERROR
+#define LOG_MODULE    LOG_MODULE_NET
 
 #include "logging.h"
 
+#include <assert.h>
+
 #include "mx_lwip.h"
 
 #include "FreeRTOS.h"
 #include "atomic.h"
 #include "mx_prv.h"
 
-static void vAddMXHeaderToEthernetFrame( PacketBuffer_t * pxTxPacket )
+#include "lwip/prot/ip.h"
+#include "lwip/prot/ip4.h"
+#include "lwip/prot/udp.h"
+#include "lwip/stats.h"
+#include "arch/perf.h"
+
+static_assert( PBUF_LINK_ENCAPSULATION_HLEN >= sizeof( BypassInOut_t ) );
+
+static const uint16_t pusInteractiveUdpPorts[] = MX_TX_INTERACTIVE_UDP_PORTS;
+
+/*
+ * Prepend the BypassInOut_t header in the headroom reserved by PBUF_LINK_ENCAPSULATION_HLEN.
+ * Returns pdFALSE and leaves the pbuf untouched if there is no room for the header.
+ */
+static BaseType_t xAddMXHeaderToEthernetFrame( PacketBuffer_t * pxTxPacket )
 {
+    BaseType_t xResult = pdFALSE;
+
     configASSERT( pxTxPacket != NULL );
 
     /* Store length of ethernet frame for BypassInOut_t header */
     uint16_t ulEthPacketLen = pxTxPacket->tot_len;
 
     /* Adjust pbuf size to include BypassInOut_t header */
-    uint8_t cErr = pbuf_header( pxTxPacket, sizeof( BypassInOut_t ) );
-
-    configASSERT( cErr == 0 );
+    if( pbuf_add_header( pxTxPacket, sizeof( BypassInOut_t ) ) == 0 )
+    {
+        /* Add on bypass header */
+        BypassInOut_t * pxBypassHeader = ( BypassInOut_t * ) pxTxPacket->payload;
 
-    /* Add on bypass header */
-    BypassInOut_t * pxBypassHeader = ( BypassInOut_t * ) pxTxPacket->payload;
+        pxBypassHeader->xHeader.usIPCApiId = IPC_WIFI_BYPASS_OUT;
+        pxBypassHeader->xHeader.ulIPCRequestId = prvGetNextRequestID();
 
-    pxBypassHeader->xHeader.usIPCApiId = IPC_WIFI_BYPASS_OUT;
-    pxBypassHeader->xHeader.ulIPCRequestId = prvGetNextRequestID();
+        /* Send to station interface */
+        pxBypassHeader->lIndex = WIFI_BYPASS_MODE_STATION;
 
-    /* Send to station interface */
-    pxBypassHeader->lIndex = WIFI_BYPASS_MODE_STATION;
+        /* Fill pad region with zeros */
+        ( void ) memset( pxBypassHeader->ucPad, 0, MX_BYPASS_PAD_LEN );
 
-    /* Fill pad region with zeros */
-    ( void ) memset( pxBypassHeader->ucPad, 0, MX_BYPASS_PAD_LEN );
+        /* Set length field */
+        pxBypassHeader->usDataLen = ulEthPacketLen;
 
-    /* Set length field */
-    pxBypassHeader->usDataLen = ulEthPacketLen;
+        xResult = pdTRUE;
+    }
 
     configASSERT( pxTxPacket->ref >= 1 );
+
+    return xResult;
 }
 
 /* Callback for lwip netif events
@@ -117,36 +139,214 @@ static void vLwipStatusCallback( struct netif * pxNetif )
     xLastFlags = pxNetif->flags;
 }
 
+/* Determine whether either port of a TCP or UDP segment belongs to an interactive service */
+static BaseType_t xIsInteractivePort( uint8_t ucProto,
+                                      uint16_t usSrcPort,
+                                      uint16_t usDestPort )
+{
+    BaseType_t xInteractive = pdFALSE;
+
+    if( ucProto == IP_PROTO_TCP )
+    {
+        xInteractive = ( usSrcPort == MX_TX_INTERACTIVE_TCP_PORT ) ||
+                       ( usDestPort == MX_TX_INTERACTIVE_TCP_PORT );
+    }
+    else
+    {
+        for( uint32_t i = 0;
+             ( xInteractive == pdFALSE ) && ( i < ( sizeof( pusInteractiveUdpPorts ) / sizeof( pusInteractiveUdpPorts[ 0 ] ) ) );
+             i++ )
+        {
+            if( ( usSrcPort == pusInteractiveUdpPorts[ i ] ) ||
+                ( usDestPort == pusInteractiveUdpPorts[ i ] ) )
+            {
+                xInteractive = pdTRUE;
+            }
+        }
+    }
+
+    return xInteractive;
+}
+
+/*
+ * Determine the transmit class of an outbound ethernet frame.
+ * Only fields that are constant for the lifetime of a flow are used, so every frame of a
+ * connection lands in the same queue and can not be reordered against its neighbours.
+ * IP fragments are classified without looking at ports so that all fragments of a datagram
+ * also stay together.
+ */
+static MxTxClass_t xClassifyFrame( PacketBuffer_t * pxPbuf )
+{
+    MxTxClass_t xClass = MX_TX_CLASS_BULK;
+
+    if( pxPbuf->len >= SIZEOF_ETH_HDR )
+    {
+        struct eth_hdr * pxEthHeader = ( struct eth_hdr * ) pxPbuf->payload;
+
+        switch( lwip_htons( pxEthHeader->type ) )
+        {
+            case ETHTYPE_ARP:
+                xClass = MX_TX_CLASS_INTERACTIVE;
+                break;
+
+            case ETHTYPE_IP:
+
+                if( pxPbuf->len >= ( SIZEOF_ETH_HDR + IP_HLEN ) )
+                {
+                    struct ip_hdr * pxIpHeader = ( struct ip_hdr * ) ( ( uint8_t * ) pxPbuf->payload + SIZEOF_ETH_HDR );
+                    uint8_t ucProto = IPH_PROTO( pxIpHeader );
+                    uint16_t usIpHeaderLen = IPH_HL_BYTES( pxIpHeader );
+
+                    if( ( ( IPH_TOS( pxIpHeader ) >> 2 ) >= MX_TX_INTERACTIVE_DSCP_MIN ) ||
+                        ( ucProto == IP_PROTO_ICMP ) )
+                    {
+                        xClass = MX_TX_CLASS_INTERACTIVE;
+                    }
+                    else if( ( ( ucProto == IP_PROTO_TCP ) || ( ucProto == IP_PROTO_UDP ) ) &&
+                             ( ( IPH_OFFSET( pxIpHeader ) & PP_HTONS( IP_OFFMASK | IP_MF ) ) == 0 ) &&
+                             ( pxPbuf->len >= ( SIZEOF_ETH_HDR + usIpHeaderLen + UDP_HLEN ) ) )
+                    {
+                        /* Source and destination ports are the first two fields of both TCP and UDP headers */
+                        struct udp_hdr * pxPorts = ( struct udp_hdr * ) ( ( uint8_t * ) pxIpHeader + usIpHeaderLen );
+
+                        if( xIsInteractivePort( ucProto, lwip_ntohs( pxPorts->src ), lwip_ntohs( pxPorts->dest ) ) )
+                        {
+                            xClass = MX_TX_CLASS_INTERACTIVE;
+                        }
+                    }
+                    else
+                    {
+                        /* Other protocols are bulk */
+                    }
+                }
+
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    return xClass;
+}
+
+/* Add a frame to the queue for the given class without blocking the tcpip thread */
+static err_t xEnqueueFrame( MxNetConnectCtx_t * pxCtx,
+                            MxTxClass_t xClass,
+                            PacketBuffer_t * pxPbuf )
+{
+    err_t xError = ERR_OK;
+    QueueHandle_t xQueue = pxCtx->xDataPlaneSendQueues[ xClass ];
+    MxTxQueueStats_t * pxStats = &( pxCtx->pxTxQueueStats[ xClass ] );
+    MxTxQueueItem_t xItem;
+    BaseType_t xReturn;
+
+    xItem.pxPbuf = pxPbuf;
+    xItem.xEnqueueTime = xTaskGetTickCount();
+
+    xReturn = xQueueSend( xQueue, &xItem, MX_ETH_PACKET_ENQUEUE_TIMEOUT );
+
+    if( ( xReturn != pdTRUE ) &&
+        ( ( ( xClass == MX_TX_CLASS_INTERACTIVE ) && ( MX_TX_INTERACTIVE_DROP_POLICY == MX_TX_DROP_HEAD ) ) ||
+          ( ( xClass == MX_TX_CLASS_BULK ) && ( MX_TX_BULK_DROP_POLICY == MX_TX_DROP_HEAD ) ) ) )
+    {
+        MxTxQueueItem_t xDroppedItem;
+
+        /* The dataplane thread dequeues before transmitting, so the head can be discarded safely */
+        if( xQueueReceive( xQueue, &xDroppedItem, 0 ) == pdTRUE )
+        {
+            LogDebug( "Dropping oldest frame in tx class %d, len: %d", xClass, xDroppedItem.pxPbuf->tot_len );
+
+            PBUF_FREE( xDroppedItem.pxPbuf );
+            ( void ) Atomic_Decrement_u32( pxCtx->pulTxPacketsWaiting );
+            pxStats->ulDropped++;
+            LINK_STATS_INC( link.drop );
+        }
+
+        xReturn = xQueueSend( xQueue, &xItem, 0 );
+    }
+
+    if( xReturn == pdTRUE )
+    {
+        LogDebug( "Packet enqueued into tx class %d addr: %p, len: %d, refs: %d, remaining space: %d",
+                  xClass, pxPbuf, pxPbuf->tot_len, pxPbuf->ref, uxQueueSpacesAvailable( xQueue ) );
+
+        pxStats->ulEnqueued++;
+
+        ( void ) Atomic_Increment_u32( pxCtx->pulTxPacketsWaiting );
+
+        ( void ) xTaskNotifyGiveIndexed( pxCtx->xDataPlaneTaskHandle, DATA_WAITING_IDX );
+    }
+    else
+    {
+        LogDebug( "Dropping frame in tx class %d, len: %d", xClass, pxPbuf->tot_len );
+
+        pxStats->ulDropped++;
+        LINK_STATS_INC( link.drop );
+        PBUF_FREE( pxPbuf );
+
+        /* Let lwip know that the frame was not sent */
+        xError = ERR_MEM;
+    }
+
+    return xError;
+}
+
 /* Network output function for lwip */
 err_t prvxLinkOutput( NetInterface_t * pxNetif,
                       PacketBuffer_t * pxPbuf )
 {
     err_t xError = ERR_OK;
-    BaseType_t xReturn = pdFALSE;
     struct pbuf * pxPbufToSend = pxPbuf;
+    MxTxClass_t xClass = MX_TX_CLASS_BULK;
+    uint32_t ulBytesCopied = 0;
+
+    PERF_START;
 
     if( ( pxPbuf == NULL ) || ( pxNetif == NULL ) )
     {
         xError = ERR_VAL;
     }
-    /* Handle any chained packets */
-    else if( ( pxPbuf->len != pxPbuf->tot_len ) ||
-             ( pxPbuf->next != NULL ) )
+    else
     {
-        pxPbufToSend = pbuf_clone( PBUF_RAW, PBUF_RAM, pxPbuf );
+        /* Classify before the bypass header is prepended */
+        xClass = xClassifyFrame( pxPbuf );
 
-        if( pxPbufToSend == NULL )
+        /* Fast path: single pbufs with headroom are handed to the dataplane without copying */
+        if( ( pxPbuf->next == NULL ) &&
+            ( xAddMXHeaderToEthernetFrame( pxPbuf ) == pdTRUE ) )
         {
-            xError = ERR_MEM;
+            /* Increment reference counter */
+            pbuf_ref( pxPbufToSend );
         }
+        /* Fallback: copy chained packets and pbufs without headroom into a new buffer */
+        else
+        {
+            pxPbufToSend = pbuf_alloc( PBUF_RAW_TX, pxPbuf->tot_len, PBUF_RAM );
 
-        /* Input buffer will be freed by lwip after the current function returns */
-        /* pbuf_clone sets the refcount = 1 upon creation */
-    }
-    else
-    {
-        /* Increment reference counter */
-        pbuf_ref( pxPbufToSend );
+            if( pxPbufToSend == NULL )
+            {
+                xError = ERR_MEM;
+            }
+            else
+            {
+                xError = pbuf_copy( pxPbufToSend, pxPbuf );
+
+                if( xError == ERR_OK )
+                {
+                    ulBytesCopied = pxPbuf->tot_len;
+
+                    /* PBUF_RAW_TX reserves PBUF_LINK_ENCAPSULATION_HLEN bytes of headroom */
+                    ( void ) xAddMXHeaderToEthernetFrame( pxPbufToSend );
+                }
+                else
+                {
+                    PBUF_FREE( pxPbufToSend );
+                }
+            }
+
+            /* Input buffer will be freed by lwip after the current function returns */
+        }
     }
 
 /*    vPrintBuffer("ETH_TX", pxPbuf->payload, pxPbuf->tot_len ); */
@@ -154,39 +354,25 @@ err_t prvxLinkOutput( NetInterface_t * pxNetif,
     /* Get context from netif struct */
     MxNetConnectCtx_t * pxCtx = ( MxNetConnectCtx_t * ) pxNetif->state;
 
-    if( xError == ERR_OK )
-    {
-        vAddMXHeaderToEthernetFrame( pxPbuf );
-    }
-
-    configASSERT( pxCtx->xDataPlaneSendQueue != NULL );
+    configASSERT( pxCtx->xDataPlaneSendQueues[ xClass ] != NULL );
+    configASSERT( pxCtx->pxTxQueueStats != NULL );
     configASSERT( pxCtx->pulTxPacketsWaiting != NULL );
     configASSERT( pxCtx->xDataPlaneTaskHandle != NULL );
 
+    if( ulBytesCopied > 0 )
+    {
+        pxCtx->pxTxQueueStats[ xClass ].ulCopiedFrames++;
+        pxCtx->pxTxQueueStats[ xClass ].ulCopiedBytes += ulBytesCopied;
+    }
+
     if( xError == ERR_OK )
     {
         configASSERT( pxPbufToSend != NULL );
-        xReturn = xQueueSend( pxCtx->xDataPlaneSendQueue,
-                              &pxPbufToSend,
-                              MX_ETH_PACKET_ENQUEUE_TIMEOUT );
-
-        if( xReturn == pdTRUE )
-        {
-            xError = ERR_OK;
-            LogDebug( "Packet enqueued into xDataPlaneSendQueue addr: %p, len: %d, refs: %d, remaining space: %d",
-                      pxPbufToSend, pxPbufToSend->tot_len, pxPbufToSend->ref, uxQueueSpacesAvailable( pxCtx->xDataPlaneSendQueue ) );
-
-            ( void ) Atomic_Increment_u32( pxCtx->pulTxPacketsWaiting );
-
-            ( void ) xTaskNotifyGiveIndexed( pxCtx->xDataPlaneTaskHandle, DATA_WAITING_IDX );
-        }
-        else
-        {
-            xError = ERR_TIMEOUT;
-            PBUF_FREE( pxPbufToSend );
-        }
+        xError = xEnqueueFrame( pxCtx, xClass, pxPbufToSend );
     }
 
+    PERF_STOP( "mx_linkoutput" );
+
     return xError;
 }
 
@@ -195,6 +381,8 @@ BaseType_t prvxLinkInput( NetInterface_t * pxNetif,
 {
     BaseType_t xReturn;
 
+    PERF_START;
+
     if( pxNetif == NULL )
     {
         LogError( "pxNetif is null." );
@@ -243,6 +431,8 @@ BaseType_t prvxLinkInput( NetInterface_t * pxNetif,
         xReturn = pdFALSE;
     }
 
+    PERF_STOP( "mx_linkinput" );
+
     return xReturn;
 }
 
@@ -26,7 +26,8 @@
  */
 
 #include "logging_levels.h"
-#define LOG_LEVEL    LOG_ERROR
+#define LOG_LEVEL     LOG_ERROR
+#define LOG_MODULE    LOG_MODULE_NET
 #include "logging.h"
 
 /* Standard includes */
@@ -58,6 +59,8 @@
 static TaskHandle_t xNetTaskHandle = NULL;
 static MxDataplaneCtx_t xDataPlaneCtx;
 static ControlPlaneCtx_t xControlPlaneCtx;
+static MxTxQueueStats_t xTxQueueStats[ MX_TX_CLASS_MAX ];
+static MxSpiStats_t xSpiStats;
 
 #if LOG_LEVEL == LOG_DEBUG
 
@@ -230,6 +233,22 @@ BaseType_t net_request_reconnect( void )
     return xReturn;
 }
 
+void net_get_tx_queue_stats( MxTxQueueStats_t pxStats[ MX_TX_CLASS_MAX ] )
+{
+    if( pxStats != NULL )
+    {
+        ( void ) memcpy( pxStats, xTxQueueStats, sizeof( xTxQueueStats ) );
+    }
+}
+
+void net_get_spi_stats( MxSpiStats_t * pxStats )
+{
+    if( pxStats != NULL )
+    {
+        ( void ) memcpy( pxStats, &xSpiStats, sizeof( xSpiStats ) );
+    }
+}
+
 /*
  * Handles network interface state change notifications from the control plane.
  */
@@ -351,11 +370,17 @@ static void vInitializeContexts( MxNetConnectCtx_t * pxCtx )
 {
     MessageBufferHandle_t xControlPlaneResponseBuff;
     QueueHandle_t xControlPlaneSendQueue;
-    QueueHandle_t xDataPlaneSendQueue;
+    QueueHandle_t xDataPlaneSendQueues[ MX_TX_CLASS_MAX ];
 
     /* Construct queues */
-    xDataPlaneSendQueue = xQueueCreate( DATA_PLANE_QUEUE_LEN, sizeof( PacketBuffer_t * ) );
-    configASSERT( xDataPlaneSendQueue != NULL );
+    xDataPlaneSendQueues[ MX_TX_CLASS_INTERACTIVE ] = xQueueCreate( DATA_PLANE_PRIO_QUEUE_LEN, sizeof( MxTxQueueItem_t ) );
+    configASSERT( xDataPlaneSendQueues[ MX_TX_CLASS_INTERACTIVE ] != NULL );
+
+    xDataPlaneSendQueues[ MX_TX_CLASS_BULK ] = xQueueCreate( DATA_PLANE_QUEUE_LEN, sizeof( MxTxQueueItem_t ) );
+    configASSERT( xDataPlaneSendQueues[ MX_TX_CLASS_BULK ] != NULL );
+
+    ( void ) memset( xTxQueueStats, 0, sizeof( xTxQueueStats ) );
+    ( void ) memset( &xSpiStats, 0, sizeof( xSpiStats ) );
 
     xControlPlaneResponseBuff = xMessageBufferCreate( CONTROL_PLANE_BUFFER_SZ );
     configASSERT( xControlPlaneResponseBuff != NULL );
@@ -370,7 +395,8 @@ static void vInitializeContexts( MxNetConnectCtx_t * pxCtx )
     ( void ) memset( &( pxCtx->pcFirmwareRevision ), 0, MX_FIRMWARE_REVISION_SIZE );
     ( void ) memset( &( pxCtx->xMacAddress ), 0, sizeof( MacAddress_t ) );
 
-    pxCtx->xDataPlaneSendQueue = xDataPlaneSendQueue;
+    ( void ) memcpy( pxCtx->xDataPlaneSendQueues, xDataPlaneSendQueues, sizeof( xDataPlaneSendQueues ) );
+    pxCtx->pxTxQueueStats = xTxQueueStats;
     pxCtx->pulTxPacketsWaiting = &( xDataPlaneCtx.ulTxPacketsWaiting );
     pxCtx->xNetTaskHandle = xTaskGetCurrentTaskHandle();
 
@@ -390,7 +416,9 @@ static void vInitializeContexts( MxNetConnectCtx_t * pxCtx )
     /* Set queue handles */
     xDataPlaneCtx.xControlPlaneSendQueue = xControlPlaneSendQueue;
     xDataPlaneCtx.xControlPlaneResponseBuff = xControlPlaneResponseBuff;
-    xDataPlaneCtx.xDataPlaneSendQueue = xDataPlaneSendQueue;
+    ( void ) memcpy( xDataPlaneCtx.xDataPlaneSendQueues, xDataPlaneSendQueues, sizeof( xDataPlaneSendQueues ) );
+    xDataPlaneCtx.pxTxQueueStats = xTxQueueStats;
+    xDataPlaneCtx.pxSpiStats = &xSpiStats;
     xDataPlaneCtx.pxNetif = &( pxCtx->xNetif );
 
     /* Construct controlplane context */
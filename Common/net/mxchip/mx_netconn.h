@@ -29,8 +29,11 @@
 #define MX_NETCONN_H
 
 #include "FreeRTOS.h"
+#include "mx_ipc.h"
 
 void net_main( void * pvParameters );
 BaseType_t net_request_reconnect( void );
+void net_get_tx_queue_stats( MxTxQueueStats_t pxStats[ MX_TX_CLASS_MAX ] );
+void net_get_spi_stats( MxSpiStats_t * pxStats );
 
 #endif /* MX_NETCONN_H */
@@ -59,8 +59,18 @@ extern "C"
 #define MX_STATUS_UPDATE_BIT             0x40
 #define ASYNC_REQUEST_RECONNECT_BIT      0x80
 
+/* Tasks waiting on an IPC response are woken on a dedicated index so that
+ * notifications sent on the default index cannot complete a request early. */
+#define IPC_RESPONSE_IDX                 5
+
+#if configTASK_NOTIFICATION_ARRAY_ENTRIES <= IPC_RESPONSE_IDX
+#error "MXCHIP driver requires configTASK_NOTIFICATION_ARRAY_ENTRIES > IPC_RESPONSE_IDX"
+#endif
+
 /* Constants */
-#define NUM_IPC_REQUEST_CTX              1
+#ifndef NUM_IPC_REQUEST_CTX
+#define NUM_IPC_REQUEST_CTX              4
+#endif /* NUM_IPC_REQUEST_CTX */
 #define MX_DEFAULT_TIMEOUT_MS            100
 #define MX_DEFAULT_TIMEOUT_TICK          pdMS_TO_TICKS( MX_DEFAULT_TIMEOUT_MS )
 #define MX_TIMEOUT_CONNECT               pdMS_TO_TICKS( 120 * 1000 )
@@ -72,14 +82,46 @@ extern "C"
 #define MX_BSSID_LEN                     MX_MACADDR_LEN
 #define MX_SPI_TRANSACTION_TIMEOUT       MX_DEFAULT_TIMEOUT_TICK
 #define MX_MAX_MESSAGE_LEN               4096
-#define MX_ETH_PACKET_ENQUEUE_TIMEOUT    pdMS_TO_TICKS( 5 * 10000 )
+#define MX_ETH_PACKET_ENQUEUE_TIMEOUT    0
 #define MX_SPI_EVENT_TIMEOUT             pdMS_TO_TICKS( 10000 )
 #define MX_SPI_FLOW_TIMEOUT              pdMS_TO_TICKS( 10 )
 
 #define CONTROL_PLANE_QUEUE_LEN          10
 #define DATA_PLANE_QUEUE_LEN             10
+#define DATA_PLANE_PRIO_QUEUE_LEN        8
 #define CONTROL_PLANE_BUFFER_SZ          ( 25 * sizeof( void * ) + sizeof( size_t ) )
 
+/*
+ * Outbound ethernet frames are sorted into MX_TX_CLASS_INTERACTIVE when they are ARP or
+ * ICMP packets, when the IPv4 DSCP is at least MX_TX_INTERACTIVE_DSCP_MIN (settable per
+ * socket with IP_TOS), when they belong to a TCP connection to or from
+ * MX_TX_INTERACTIVE_TCP_PORT (MQTT) or when they belong to a UDP exchange on one of
+ * MX_TX_INTERACTIVE_UDP_PORTS (DNS, DHCP, SNTP). Everything else is MX_TX_CLASS_BULK.
+ * The class depends only on the flow, never on the frame size, so the frames of one
+ * connection are never reordered between the two queues.
+ */
+#define MX_TX_INTERACTIVE_DSCP_MIN       24 /* CS3 and above */
+
+#ifndef MX_TX_INTERACTIVE_TCP_PORT
+#define MX_TX_INTERACTIVE_TCP_PORT       8883
+#endif /* MX_TX_INTERACTIVE_TCP_PORT */
+
+#ifndef MX_TX_INTERACTIVE_UDP_PORTS
+#define MX_TX_INTERACTIVE_UDP_PORTS      { 53, 67, 68, 123 }
+#endif /* MX_TX_INTERACTIVE_UDP_PORTS */
+
+#define MX_TX_DROP_TAIL                  0 /* Reject the new frame and return ERR_MEM to lwip */
+#define MX_TX_DROP_HEAD                  1 /* Drop the oldest queued frame to make room */
+
+#define MX_TX_INTERACTIVE_DROP_POLICY    MX_TX_DROP_HEAD
+#define MX_TX_BULK_DROP_POLICY           MX_TX_DROP_TAIL
+
+typedef struct
+{
+    PacketBuffer_t * pxPbuf;
+    TickType_t xEnqueueTime;
+} MxTxQueueItem_t;
+
 typedef struct
 {
     const IotMappedPin_t * gpio_flow;
@@ -92,8 +134,10 @@ typedef struct
     volatile uint32_t ulLastRequestId;
     NetInterface_t * pxNetif;
     MessageBufferHandle_t xControlPlaneResponseBuff;
-    QueueHandle_t xDataPlaneSendQueue;
+    QueueHandle_t xDataPlaneSendQueues[ MX_TX_CLASS_MAX ];
     QueueHandle_t xControlPlaneSendQueue;
+    MxTxQueueStats_t * pxTxQueueStats;
+    MxSpiStats_t * pxSpiStats;
 } MxDataplaneCtx_t;
 
 typedef struct
@@ -113,7 +157,8 @@ typedef struct
     NetInterface_t xNetif;
     volatile MxStatus_t xStatus;
     volatile MxStatus_t xStatusPrevious;
-    QueueHandle_t xDataPlaneSendQueue;
+    QueueHandle_t xDataPlaneSendQueues[ MX_TX_CLASS_MAX ];
+    MxTxQueueStats_t * pxTxQueueStats;
     volatile uint32_t * pulTxPacketsWaiting;
     TaskHandle_t xNetTaskHandle;
     TaskHandle_t xDataPlaneTaskHandle;
@@ -268,6 +268,7 @@ static void hw_gpio_init( void )
 
     __HAL_RCC_GPIOG_CLK_ENABLE();
     __HAL_RCC_GPIOD_CLK_ENABLE();
+    __HAL_RCC_GPIOE_CLK_ENABLE();
     __HAL_RCC_GPIOA_CLK_ENABLE();
     __HAL_RCC_GPIOC_CLK_ENABLE();
     __HAL_RCC_GPIOB_CLK_ENABLE();
@@ -325,6 +326,23 @@ static void hw_gpio_init( void )
         HAL_NVIC_EnableIRQ( MXCHIP_NOTIFY_EXTI_IRQn );
     }
 
+    /* ISM330_INT1_Pin Input (FIFO watermark) */
+    {
+        GPIO_InitTypeDef xGpioInit =
+        {
+            .Pin       = ISM330_INT1_Pin,
+            .Mode      = GPIO_MODE_IT_RISING,
+            .Pull      = GPIO_NOPULL,
+            .Speed     = GPIO_SPEED_FREQ_LOW,
+            .Alternate = 0X0,
+        };
+
+        HAL_GPIO_Init( ISM330_INT1_GPIO_Port, &xGpioInit );
+
+        HAL_NVIC_SetPriority( ISM330_INT1_EXTI_IRQn, 5, 5 );
+        HAL_NVIC_EnableIRQ( ISM330_INT1_EXTI_IRQn );
+    }
+
 
     /* MXCHIP_NSS_Pin Output */
     {
@@ -612,7 +630,7 @@ static void hw_tim5_init( void )
     static TIM_HandleTypeDef xTim5Handle =
     {
         .Instance       = TIM5,
-        .Init.Prescaler = 4096, /* 160 MHz / 4096 = 39KHz */
+        .Init.Prescaler = 159, /* 160 MHz / 160 = 1 MHz, extended by ullRunTimeCounterGet */
         .Init.Period    = 0xFFFFFFFF,
     };
 
@@ -633,6 +651,32 @@ static void hw_tim5_init( void )
     }
 }
 
+/*
+ * The 32 bit TIM5 counter wraps after ~71 minutes at 1 MHz. Extend it to 64
+ * bits by counting the wraps seen between reads. The kernel reads it on every
+ * context switch, far more often than once per wrap, so none is missed.
+ */
+uint64_t ullRunTimeCounterGet( void )
+{
+    static uint32_t ulLastCount = 0;
+    static uint32_t ulWraps = 0;
+    uint64_t ullCount;
+    UBaseType_t uxSavedInterruptStatus = portSET_INTERRUPT_MASK_FROM_ISR();
+    uint32_t ulCount = timer_get_count( pxHndlTim5 );
+
+    if( ulCount < ulLastCount )
+    {
+        ulWraps++;
+    }
+
+    ulLastCount = ulCount;
+    ullCount = ( ( uint64_t ) ulWraps << 32 ) | ulCount;
+
+    portCLEAR_INTERRUPT_MASK_FROM_ISR( uxSavedInterruptStatus );
+
+    return ullCount;
+}
+
 /* HAL MspInit Callbacks */
 void HAL_MspInit( void )
 {
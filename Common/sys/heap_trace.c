@@ -0,0 +1,383 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "heap_trace.h"
+
+/*
+ * The heap is provided here (configAPPLICATION_ALLOCATED_HEAP) so that it can
+ * be walked to build the free block histogram.
+ */
+uint8_t ucHeap[ configTOTAL_HEAP_SIZE ] __attribute__( ( aligned( portBYTE_ALIGNMENT ) ) );
+
+#if HEAP_TRACE_ENABLED
+
+#if ( ( HEAP_TRACE_MAX_BLOCKS & ( HEAP_TRACE_MAX_BLOCKS - 1 ) ) != 0 )
+#error "HEAP_TRACE_MAX_BLOCKS must be a power of two"
+#endif
+
+#if ( HEAP_TRACE_MAX_SITES > 255 )
+#error "HEAP_TRACE_MAX_SITES must fit in a uint8_t"
+#endif
+
+/* copied from heap_4.c */
+typedef struct A_BLOCK_LINK
+{
+    struct A_BLOCK_LINK * pxNextFreeBlock; /*<< The next free block in the list. */
+    size_t xBlockSize;                     /*<< The size of the free block. */
+} BlockLink_t;
+
+#define HEAP_BLOCK_ALLOCATED_BIT    ( ( ( size_t ) 1 ) << ( ( sizeof( size_t ) * 8 ) - 1 ) )
+#define HEAP_STRUCT_SIZE            ( ( sizeof( BlockLink_t ) + ( ( size_t ) ( portBYTE_ALIGNMENT - 1 ) ) ) & ~( ( size_t ) portBYTE_ALIGNMENT_MASK ) )
+
+/* Keep the block table at most 7/8 full so that probe sequences stay short */
+#define HEAP_TRACE_MAX_LOAD         ( ( HEAP_TRACE_MAX_BLOCKS / 8 ) * 7 )
+
+/* Smallest block size counted in histogram bucket 1 */
+#define HEAP_TRACE_HISTOGRAM_SHIFT    5
+
+static HeapTraceSite_t xSites[ HEAP_TRACE_MAX_SITES ];
+static HeapTraceStats_t xStats;
+
+/* Open addressing table of live block addresses and the site that allocated them */
+static void * pvBlockAddr[ HEAP_TRACE_MAX_BLOCKS ];
+static uint8_t ucBlockSite[ HEAP_TRACE_MAX_BLOCKS ];
+static uint32_t ulBlocksTracked = 0;
+
+/* Set by pvHeapTraceMallocFrom while it holds the scheduler suspended */
+static const void * pvCallerOverride = NULL;
+
+/*-----------------------------------------------------------*/
+
+static inline uint32_t prvHash( const void * pvValue,
+                                uint32_t ulMask )
+{
+    /* Heap blocks are 8 byte aligned and code addresses 2 byte aligned */
+    return ( ( ( uint32_t ) ( uintptr_t ) pvValue >> 1 ) * 2654435761UL >> 16 ) & ulMask;
+}
+
+static uint8_t prvGetSite( const void * pvCaller )
+{
+    uint32_t ulIdx = prvHash( pvCaller, HEAP_TRACE_MAX_SITES - 1 );
+    uint8_t ucSite = 0;
+
+    /* Site 0 is kept for callers that do not fit in the table */
+    for( uint32_t i = 0; i < HEAP_TRACE_MAX_SITES; i++ )
+    {
+        uint32_t ulSlot = ( ulIdx + i ) % HEAP_TRACE_MAX_SITES;
+
+        if( ulSlot == 0 )
+        {
+            continue;
+        }
+
+        if( xSites[ ulSlot ].pvCaller == pvCaller )
+        {
+            ucSite = ( uint8_t ) ulSlot;
+            break;
+        }
+        else if( xSites[ ulSlot ].pvCaller == NULL )
+        {
+            xSites[ ulSlot ].pvCaller = pvCaller;
+            ucSite = ( uint8_t ) ulSlot;
+            break;
+        }
+    }
+
+    return ucSite;
+}
+
+static void prvTrackBlock( void * pvAddress,
+                           uint8_t ucSite )
+{
+    uint32_t ulIdx = prvHash( pvAddress, HEAP_TRACE_MAX_BLOCKS - 1 );
+
+    while( pvBlockAddr[ ulIdx ] != NULL )
+    {
+        ulIdx = ( ulIdx + 1 ) & ( HEAP_TRACE_MAX_BLOCKS - 1 );
+    }
+
+    pvBlockAddr[ ulIdx ] = pvAddress;
+    ucBlockSite[ ulIdx ] = ucSite;
+    ulBlocksTracked++;
+}
+
+/* Returns the site of a tracked block and removes it, or -1 if it is not tracked */
+static int32_t prvUntrackBlock( void * pvAddress )
+{
+    uint32_t ulIdx = prvHash( pvAddress, HEAP_TRACE_MAX_BLOCKS - 1 );
+    int32_t lSite = -1;
+
+    while( pvBlockAddr[ ulIdx ] != NULL )
+    {
+        if( pvBlockAddr[ ulIdx ] == pvAddress )
+        {
+            lSite = ucBlockSite[ ulIdx ];
+            break;
+        }
+
+        ulIdx = ( ulIdx + 1 ) & ( HEAP_TRACE_MAX_BLOCKS - 1 );
+    }
+
+    if( lSite >= 0 )
+    {
+        uint32_t ulNext = ulIdx;
+
+        /* Shift later entries of the probe sequence back into the hole */
+        for( ; ; )
+        {
+            uint32_t ulHome;
+
+            ulNext = ( ulNext + 1 ) & ( HEAP_TRACE_MAX_BLOCKS - 1 );
+
+            if( pvBlockAddr[ ulNext ] == NULL )
+            {
+                break;
+            }
+
+            ulHome = prvHash( pvBlockAddr[ ulNext ], HEAP_TRACE_MAX_BLOCKS - 1 );
+
+            /* Move the entry unless its home slot lies cyclically in ( ulIdx, ulNext ] */
+            if( ( ( ulNext - ulHome ) & ( HEAP_TRACE_MAX_BLOCKS - 1 ) ) >=
+                ( ( ulNext - ulIdx ) & ( HEAP_TRACE_MAX_BLOCKS - 1 ) ) )
+            {
+                pvBlockAddr[ ulIdx ] = pvBlockAddr[ ulNext ];
+                ucBlockSite[ ulIdx ] = ucBlockSite[ ulNext ];
+                ulIdx = ulNext;
+            }
+        }
+
+        pvBlockAddr[ ulIdx ] = NULL;
+        ulBlocksTracked--;
+    }
+
+    return lSite;
+}
+
+/* Size of the allocated block at pvAddress, including its header */
+static inline size_t prvBlockSize( const void * pvAddress )
+{
+    const BlockLink_t * pxLink = ( const BlockLink_t * ) ( ( const uint8_t * ) pvAddress - HEAP_STRUCT_SIZE );
+
+    return pxLink->xBlockSize & ~HEAP_BLOCK_ALLOCATED_BIT;
+}
+
+/*-----------------------------------------------------------*/
+
+void vHeapTraceMalloc( void * pvAddress,
+                       size_t xSize,
+                       const void * pvReturnAddress )
+{
+    /* xSize is the size heap_4 asked for, see heap_trace.h */
+    ( void ) xSize;
+
+    if( pvAddress == NULL )
+    {
+        xStats.ulFailures++;
+    }
+    else
+    {
+        const void * pvCaller = ( pvCallerOverride != NULL ) ? pvCallerOverride : pvReturnAddress;
+        uint8_t ucSite = prvGetSite( pvCaller );
+        HeapTraceSite_t * pxSite = &( xSites[ ucSite ] );
+        size_t xBlockSize = prvBlockSize( pvAddress );
+
+        xStats.ulAllocs++;
+        xStats.ulAllocBytes += xBlockSize;
+        xStats.ulLiveBytes += xBlockSize;
+
+        if( xStats.ulLiveBytes > xStats.ulPeakBytes )
+        {
+            xStats.ulPeakBytes = xStats.ulLiveBytes;
+        }
+
+        pxSite->ulAllocs++;
+
+        if( ulBlocksTracked < HEAP_TRACE_MAX_LOAD )
+        {
+            prvTrackBlock( pvAddress, ucSite );
+
+            pxSite->ulLiveBlocks++;
+            pxSite->ulLiveBytes += xBlockSize;
+
+            if( pxSite->ulLiveBytes > pxSite->ulPeakBytes )
+            {
+                pxSite->ulPeakBytes = pxSite->ulLiveBytes;
+            }
+        }
+        else
+        {
+            xStats.ulUntracked++;
+        }
+    }
+}
+
+void vHeapTraceFree( void * pvAddress,
+                     size_t xSize )
+{
+    int32_t lSite = prvUntrackBlock( pvAddress );
+
+    xStats.ulFrees++;
+    xStats.ulLiveBytes -= xSize;
+
+    if( lSite >= 0 )
+    {
+        xSites[ lSite ].ulLiveBlocks--;
+        xSites[ lSite ].ulLiveBytes -= xSize;
+    }
+}
+
+void * pvHeapTraceMallocFrom( size_t xSize,
+                              const void * pvCaller )
+{
+    void * pvReturn = NULL;
+
+    /* pvPortMalloc suspends the scheduler again, nesting is allowed */
+    vTaskSuspendAll();
+    {
+        pvCallerOverride = pvCaller;
+        pvReturn = pvPortMalloc( xSize );
+        pvCallerOverride = NULL;
+    }
+    ( void ) xTaskResumeAll();
+
+    return pvReturn;
+}
+
+/*-----------------------------------------------------------*/
+
+void vHeapTraceGetStats( HeapTraceStats_t * pxStats )
+{
+    vTaskSuspendAll();
+    {
+        *pxStats = xStats;
+    }
+    ( void ) xTaskResumeAll();
+}
+
+/* Copy the ulIndex'th used site, returns 0 when there are no more sites */
+uint32_t ulHeapTraceGetSite( uint32_t ulIndex,
+                             HeapTraceSite_t * pxSite )
+{
+    uint32_t ulFound = 0;
+
+    vTaskSuspendAll();
+    {
+        for( uint32_t i = 0; i < HEAP_TRACE_MAX_SITES; i++ )
+        {
+            if( ( xSites[ i ].ulAllocs > 0 ) || ( xSites[ i ].ulLiveBlocks > 0 ) )
+            {
+                if( ulIndex == 0 )
+                {
+                    *pxSite = xSites[ i ];
+                    ulFound = 1;
+                    break;
+                }
+
+                ulIndex--;
+            }
+        }
+    }
+    ( void ) xTaskResumeAll();
+
+    return ulFound;
+}
+
+/* Clear the counters, live byte counts are kept since those blocks are still allocated */
+void vHeapTraceReset( void )
+{
+    vTaskSuspendAll();
+    {
+        for( uint32_t i = 0; i < HEAP_TRACE_MAX_SITES; i++ )
+        {
+            xSites[ i ].ulAllocs = 0;
+            xSites[ i ].ulPeakBytes = xSites[ i ].ulLiveBytes;
+        }
+
+        xStats.ulAllocs = 0;
+        xStats.ulFrees = 0;
+        xStats.ulFailures = 0;
+        xStats.ulUntracked = 0;
+        xStats.ulAllocBytes = 0;
+        xStats.ulPeakBytes = xStats.ulLiveBytes;
+        xStats.ulResetTick = ( uint32_t ) xTaskGetTickCount();
+    }
+    ( void ) xTaskResumeAll();
+}
+
+/* Walk the heap_4 block list, blocks are contiguous from the start of ucHeap */
+void vHeapTraceWalk( HeapTraceWalk_t * pxWalk )
+{
+    ( void ) memset( pxWalk, 0, sizeof( HeapTraceWalk_t ) );
+
+    vTaskSuspendAll();
+    {
+        uint8_t * pucBlock = ucHeap;
+
+        while( ( pucBlock + HEAP_STRUCT_SIZE ) <= &( ucHeap[ configTOTAL_HEAP_SIZE ] ) )
+        {
+            BlockLink_t * pxLink = ( BlockLink_t * ) pucBlock;
+            size_t xBlockSize = pxLink->xBlockSize & ~HEAP_BLOCK_ALLOCATED_BIT;
+
+            /* The end marker has a size of 0, as does the heap before the first allocation */
+            if( xBlockSize == 0 )
+            {
+                break;
+            }
+
+            if( ( pxLink->xBlockSize & HEAP_BLOCK_ALLOCATED_BIT ) != 0 )
+            {
+                pxWalk->ulUsedBlocks++;
+            }
+            else
+            {
+                uint32_t ulBucket = 0;
+
+                while( ( ulBucket < ( HEAP_TRACE_HISTOGRAM_BUCKETS - 1 ) ) &&
+                       ( ( xBlockSize >> ( ulBucket + HEAP_TRACE_HISTOGRAM_SHIFT ) ) != 0 ) )
+                {
+                    ulBucket++;
+                }
+
+                pxWalk->pulFreeHistogram[ ulBucket ]++;
+                pxWalk->ulFreeBlocks++;
+                pxWalk->ulFreeBytes += xBlockSize;
+
+                if( xBlockSize > pxWalk->ulLargestFree )
+                {
+                    pxWalk->ulLargestFree = xBlockSize;
+                }
+            }
+
+            pucBlock += xBlockSize;
+        }
+    }
+    ( void ) xTaskResumeAll();
+}
+
+#endif /* HEAP_TRACE_ENABLED */
@@ -28,6 +28,7 @@
 #include "FreeRTOS.h"
 #include "task.h"
 #include "hw_defs.h"
+#include "trace_ring.h"
 
 static GPIOInterruptCallback_t volatile xGpioCallbacks[ 16 ] = { NULL };
 static void * volatile xGpioCallbackContext[ 16 ] = { NULL };
@@ -133,30 +134,55 @@ void DebugMon_Handler( void )
 }
 
 /* STM32U5xx Peripheral Interrupt Handlers */
+void EXTI11_IRQHandler( void )
+{
+    vTraceIsrEnter( EXTI11_IRQn );
+
+    HAL_GPIO_EXTI_IRQHandler( GPIO_PIN_11 );
+
+    vTraceIsrExit( EXTI11_IRQn );
+}
+
 void EXTI14_IRQHandler( void )
 {
+    vTraceIsrEnter( EXTI14_IRQn );
+
     HAL_GPIO_EXTI_IRQHandler( GPIO_PIN_14 );
+
+    vTraceIsrExit( EXTI14_IRQn );
 }
 
 void EXTI15_IRQHandler( void )
 {
+    vTraceIsrEnter( EXTI15_IRQn );
+
     HAL_GPIO_EXTI_IRQHandler( GPIO_PIN_15 );
+
+    vTraceIsrExit( EXTI15_IRQn );
 }
 
 void GPDMA1_Channel4_IRQHandler( void )
 {
+    vTraceIsrEnter( GPDMA1_Channel4_IRQn );
+
     if( pxHndlGpdmaCh4 != NULL )
     {
         HAL_DMA_IRQHandler( pxHndlGpdmaCh4 );
     }
+
+    vTraceIsrExit( GPDMA1_Channel4_IRQn );
 }
 
 void GPDMA1_Channel5_IRQHandler( void )
 {
+    vTraceIsrEnter( GPDMA1_Channel5_IRQn );
+
     if( pxHndlGpdmaCh5 != NULL )
     {
         HAL_DMA_IRQHandler( pxHndlGpdmaCh5 );
     }
+
+    vTraceIsrExit( GPDMA1_Channel5_IRQn );
 }
 
 /* Handle TIM6 interrupt for STM32 HAL time base. */
@@ -167,10 +193,14 @@ void TIM6_IRQHandler( void )
 
 void SPI2_IRQHandler( void )
 {
+    vTraceIsrEnter( SPI2_IRQn );
+
     if( pxHndlSpi2 )
     {
         HAL_SPI_IRQHandler( pxHndlSpi2 );
     }
+
+    vTraceIsrExit( SPI2_IRQn );
 }
 
 extern void SysTick_Handler( void );
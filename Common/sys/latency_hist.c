@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+#include <string.h>
+
+#include "latency_hist.h"
+
+/* Values below this get a bucket each */
+#define LATENCY_HIST_LINEAR    4U
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvBucketIndex( uint32_t ulMs )
+{
+    uint32_t ulIndex = ulMs;
+
+    if( ulMs >= LATENCY_HIST_LINEAR )
+    {
+        uint32_t ulExp = 31 - __builtin_clz( ulMs );
+
+        /* The two bits below the leading one select the bucket within the octave */
+        ulIndex = ( 4U * ( ulExp - 1U ) ) + ( ( ulMs >> ( ulExp - 2U ) ) & 3U );
+    }
+
+    if( ulIndex >= LATENCY_HIST_BUCKETS )
+    {
+        ulIndex = LATENCY_HIST_BUCKETS - 1;
+    }
+
+    return ulIndex;
+}
+
+static uint32_t prvBucketUpperBound( uint32_t ulIndex )
+{
+    uint32_t ulBound = ulIndex;
+
+    if( ulIndex == ( LATENCY_HIST_BUCKETS - 1 ) )
+    {
+        /* The last bucket also collects everything above its range */
+        ulBound = UINT32_MAX;
+    }
+    else if( ulIndex >= LATENCY_HIST_LINEAR )
+    {
+        uint32_t ulExp = ( ulIndex / 4U ) + 1U;
+
+        ulBound = ( ( 4U + ( ulIndex % 4U ) + 1U ) << ( ulExp - 2U ) ) - 1U;
+    }
+
+    return ulBound;
+}
+
+/*-----------------------------------------------------------*/
+
+void vLatencyHistRecord( LatencyHist_t * pxHist,
+                         uint32_t ulMs )
+{
+    pxHist->ulCount++;
+    pxHist->ullTotalMs += ulMs;
+
+    if( ulMs > pxHist->ulMaxMs )
+    {
+        pxHist->ulMaxMs = ulMs;
+    }
+
+    pxHist->pulBuckets[ prvBucketIndex( ulMs ) ]++;
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t ulLatencyHistPercentile( const LatencyHist_t * pxHist,
+                                  uint32_t ulPercent )
+{
+    uint32_t ulResult = 0;
+    uint32_t ulRank;
+    uint32_t ulSeen = 0;
+
+    if( ulPercent > 100U )
+    {
+        ulPercent = 100U;
+    }
+
+    /* Nearest rank: the smallest value with at least ulPercent% of the samples at or below it */
+    ulRank = ( uint32_t ) ( ( ( ( uint64_t ) pxHist->ulCount * ulPercent ) + 99U ) / 100U );
+
+    if( ulRank == 0 )
+    {
+        ulRank = 1;
+    }
+
+    for( uint32_t i = 0; ( i < LATENCY_HIST_BUCKETS ) && ( pxHist->ulCount > 0 ); i++ )
+    {
+        ulSeen += pxHist->pulBuckets[ i ];
+
+        if( ulSeen >= ulRank )
+        {
+            ulResult = prvBucketUpperBound( i );
+            break;
+        }
+    }
+
+    if( ulResult > pxHist->ulMaxMs )
+    {
+        ulResult = pxHist->ulMaxMs;
+    }
+
+    return ulResult;
+}
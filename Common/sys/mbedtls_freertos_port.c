@@ -25,11 +25,11 @@
  * @brief Implements mbed TLS platform functions for FreeRTOS.
  */
 
-#include <malloc.h>
 #include <string.h>
 
 /* FreeRTOS includes. */
 #include "FreeRTOS.h"
+#include "task.h"
 #include "semphr.h"
 
 /* mbed TLS includes. */
@@ -44,6 +44,229 @@
 
 /*-----------------------------------------------------------*/
 
+/*
+ * mbed TLS allocates and frees many short lived buffers during a handshake.
+ * Small requests are served from per size class free lists carved out of
+ * 4 KB slabs and larger ones go to the FreeRTOS heap. Every block records its
+ * requested size, so only the bytes handed out are zeroed on free.
+ *
+ * Each slab keeps its own free lists and a count of its live blocks, and the
+ * block header holds the index of its slab. A slab is returned to the heap as
+ * soon as its last block is freed, so one long lived block only pins its own
+ * slab. The slab being carved is kept and carved from its beginning again.
+ *
+ * Free pool blocks are kept zeroed apart from their free list link, so pool
+ * allocations do not need to be zeroed again to meet calloc semantics.
+ */
+
+/**
+ * @brief Payload size of the largest pool size class.
+ */
+#define MBEDTLS_POOL_MAX_CLASS_LEN    1024
+
+/**
+ * @brief Number of size classes: 32, 64, ..., MBEDTLS_POOL_MAX_CLASS_LEN bytes.
+ */
+#define MBEDTLS_POOL_NUM_CLASSES      6
+
+/**
+ * @brief Size of each slab allocated from the FreeRTOS heap, including its header.
+ */
+#define MBEDTLS_POOL_SLAB_LEN         4096
+
+/**
+ * @brief Number of slabs that can be live at once, further pool requests go to the heap.
+ */
+#define MBEDTLS_POOL_MAX_SLABS        32
+
+#if ( MBEDTLS_POOL_MAX_SLABS > 32 )
+#error "MBEDTLS_POOL_MAX_SLABS must fit in the free slab masks"
+#endif
+
+#define MBEDTLS_BLOCK_MAGIC           0xA110
+#define MBEDTLS_BLOCK_CLASS_HEAP      0xFF
+
+typedef struct MbedtlsBlockHeader
+{
+    uint16_t usMagic;
+    uint8_t ucClass;
+    uint8_t ucSlab;  /* Index in pxSlabs, pool blocks only */
+    uint32_t ulSize; /* Requested size */
+} MbedtlsBlockHeader_t;
+
+typedef struct MbedtlsFreeBlock
+{
+    struct MbedtlsFreeBlock * pxNext;
+} MbedtlsFreeBlock_t;
+
+typedef struct MbedtlsSlab
+{
+    MbedtlsFreeBlock_t * pxFreeLists[ MBEDTLS_POOL_NUM_CLASSES ];
+    uint32_t ulLiveBlocks;
+    uint32_t ulDirtyLen; /* Bytes after the header that may be non-zero */
+} MbedtlsSlab_t;
+
+static MbedtlsSlab_t * pxSlabs[ MBEDTLS_POOL_MAX_SLABS ] = { NULL };
+static uint8_t ucCurrentSlab = 0;
+
+/* Bit n is set when slab n has a free block of the size class */
+static uint32_t pulFreeSlabMask[ MBEDTLS_POOL_NUM_CLASSES ] = { 0 };
+static size_t xSlabUsed = 0;
+
+/*-----------------------------------------------------------*/
+
+static inline size_t prvClassLen( uint8_t ucClass )
+{
+    return ( size_t ) 32 << ucClass;
+}
+
+static uint8_t prvSizeToClass( size_t xSize )
+{
+    uint8_t ucClass = 0;
+
+    while( ( ucClass < MBEDTLS_POOL_NUM_CLASSES ) && ( prvClassLen( ucClass ) < xSize ) )
+    {
+        ucClass++;
+    }
+
+    return ( ucClass < MBEDTLS_POOL_NUM_CLASSES ) ? ucClass : MBEDTLS_BLOCK_CLASS_HEAP;
+}
+
+/**
+ * @brief Start carving a new slab. Called with the scheduler suspended.
+ */
+static void prvPoolNewSlab( void )
+{
+    uint8_t ucSlab = 0;
+
+    while( ( ucSlab < MBEDTLS_POOL_MAX_SLABS ) && ( pxSlabs[ ucSlab ] != NULL ) )
+    {
+        ucSlab++;
+    }
+
+    if( ucSlab < MBEDTLS_POOL_MAX_SLABS )
+    {
+        MbedtlsSlab_t * pxSlab = pvPortMalloc( MBEDTLS_POOL_SLAB_LEN );
+
+        if( pxSlab != NULL )
+        {
+            ( void ) memset( pxSlab, 0, MBEDTLS_POOL_SLAB_LEN );
+            pxSlabs[ ucSlab ] = pxSlab;
+            ucCurrentSlab = ucSlab;
+            xSlabUsed = 0;
+        }
+    }
+}
+
+/**
+ * @brief Take a zeroed block of the given class. Called with the scheduler suspended.
+ */
+static MbedtlsBlockHeader_t * prvPoolTake( uint8_t ucClass )
+{
+    MbedtlsBlockHeader_t * pxHeader = NULL;
+    size_t xBlockLen = sizeof( MbedtlsBlockHeader_t ) + prvClassLen( ucClass );
+    uint8_t ucSlab;
+
+    /* Reuse a freed block before carving */
+    if( pulFreeSlabMask[ ucClass ] != 0 )
+    {
+        MbedtlsFreeBlock_t * pxFree;
+
+        ucSlab = ( uint8_t ) __builtin_ctz( pulFreeSlabMask[ ucClass ] );
+        pxFree = pxSlabs[ ucSlab ]->pxFreeLists[ ucClass ];
+
+        pxSlabs[ ucSlab ]->pxFreeLists[ ucClass ] = pxFree->pxNext;
+
+        if( pxFree->pxNext == NULL )
+        {
+            pulFreeSlabMask[ ucClass ] &= ~( 1UL << ucSlab );
+        }
+
+        pxFree->pxNext = NULL;
+        pxHeader = ( MbedtlsBlockHeader_t * ) pxFree - 1;
+    }
+    else
+    {
+        if( ( pxSlabs[ ucCurrentSlab ] == NULL ) ||
+            ( ( xSlabUsed + xBlockLen ) > ( MBEDTLS_POOL_SLAB_LEN - sizeof( MbedtlsSlab_t ) ) ) )
+        {
+            prvPoolNewSlab();
+        }
+
+        ucSlab = ucCurrentSlab;
+
+        if( ( pxSlabs[ ucSlab ] != NULL ) &&
+            ( ( xSlabUsed + xBlockLen ) <= ( MBEDTLS_POOL_SLAB_LEN - sizeof( MbedtlsSlab_t ) ) ) )
+        {
+            uint8_t * pucBlock = ( uint8_t * ) ( pxSlabs[ ucSlab ] + 1 ) + xSlabUsed;
+
+            /* Only a slab that was reset can hold stale headers and links */
+            if( xSlabUsed < pxSlabs[ ucSlab ]->ulDirtyLen )
+            {
+                ( void ) memset( pucBlock, 0, xBlockLen );
+            }
+
+            xSlabUsed += xBlockLen;
+            pxHeader = ( MbedtlsBlockHeader_t * ) pucBlock;
+        }
+    }
+
+    if( pxHeader != NULL )
+    {
+        pxHeader->usMagic = MBEDTLS_BLOCK_MAGIC;
+        pxHeader->ucClass = ucClass;
+        pxHeader->ucSlab = ucSlab;
+        pxSlabs[ ucSlab ]->ulLiveBlocks++;
+    }
+
+    return pxHeader;
+}
+
+/**
+ * @brief Return a zeroed block to its slab. Called with the scheduler suspended.
+ */
+static void prvPoolGive( MbedtlsBlockHeader_t * pxHeader )
+{
+    MbedtlsFreeBlock_t * pxFree = ( MbedtlsFreeBlock_t * ) ( pxHeader + 1 );
+    uint8_t ucSlab = pxHeader->ucSlab;
+    MbedtlsSlab_t * pxSlab = pxSlabs[ ucSlab ];
+
+    configASSERT( ( ucSlab < MBEDTLS_POOL_MAX_SLABS ) && ( pxSlab != NULL ) );
+
+    pxFree->pxNext = pxSlab->pxFreeLists[ pxHeader->ucClass ];
+    pxSlab->pxFreeLists[ pxHeader->ucClass ] = pxFree;
+    pulFreeSlabMask[ pxHeader->ucClass ] |= ( 1UL << ucSlab );
+
+    pxSlab->ulLiveBlocks--;
+
+    if( pxSlab->ulLiveBlocks == 0 )
+    {
+        for( uint8_t ucClass = 0; ucClass < MBEDTLS_POOL_NUM_CLASSES; ucClass++ )
+        {
+            pulFreeSlabMask[ ucClass ] &= ~( 1UL << ucSlab );
+        }
+
+        if( ucSlab != ucCurrentSlab )
+        {
+            pxSlabs[ ucSlab ] = NULL;
+            vPortFree( pxSlab );
+        }
+        else
+        {
+            /* Keep the slab being carved and start again from its beginning */
+            if( xSlabUsed > pxSlab->ulDirtyLen )
+            {
+                pxSlab->ulDirtyLen = xSlabUsed;
+            }
+
+            xSlabUsed = 0;
+            ( void ) memset( pxSlab->pxFreeLists, 0, sizeof( pxSlab->pxFreeLists ) );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
 /**
  * @brief Allocates memory for an array of members.
  *
@@ -56,24 +279,46 @@ void * mbedtls_platform_calloc( size_t nmemb,
                                 size_t size )
 {
     size_t totalSize = nmemb * size;
-    void * pBuffer = NULL;
+    MbedtlsBlockHeader_t * pxHeader = NULL;
 
     /* Check that neither nmemb nor size were 0. */
-    if( totalSize > 0 )
+    if( ( totalSize > 0 ) && ( totalSize <= UINT32_MAX ) )
     {
         /* Overflow check. */
         if( ( totalSize / size ) == nmemb )
         {
-            pBuffer = pvPortMalloc( totalSize );
+            uint8_t ucClass = prvSizeToClass( totalSize );
 
-            if( pBuffer != NULL )
+            if( ucClass != MBEDTLS_BLOCK_CLASS_HEAP )
             {
-                explicit_bzero( pBuffer, totalSize );
+                vTaskSuspendAll();
+                {
+                    pxHeader = prvPoolTake( ucClass );
+                }
+                ( void ) xTaskResumeAll();
+            }
+
+            /* Larger requests, or every slab slot in use */
+            if( pxHeader == NULL )
+            {
+                pxHeader = pvPortMallocFromCaller( sizeof( MbedtlsBlockHeader_t ) + totalSize );
+
+                if( pxHeader != NULL )
+                {
+                    ( void ) memset( pxHeader + 1, 0, totalSize );
+                    pxHeader->usMagic = MBEDTLS_BLOCK_MAGIC;
+                    pxHeader->ucClass = MBEDTLS_BLOCK_CLASS_HEAP;
+                }
+            }
+
+            if( pxHeader != NULL )
+            {
+                pxHeader->ulSize = ( uint32_t ) totalSize;
             }
         }
     }
 
-    return pBuffer;
+    return ( pxHeader != NULL ) ? ( void * ) ( pxHeader + 1 ) : NULL;
 }
 
 /*-----------------------------------------------------------*/
@@ -85,12 +330,29 @@ void * mbedtls_platform_calloc( size_t nmemb,
  */
 void mbedtls_platform_free( void * ptr )
 {
-    size_t xBlockLen = malloc_usable_size( ptr );
-
-    if( xBlockLen > 0 )
+    if( ptr != NULL )
     {
-        explicit_bzero( ptr, xBlockLen );
-        vPortFree( ptr );
+        MbedtlsBlockHeader_t * pxHeader = ( MbedtlsBlockHeader_t * ) ptr - 1;
+
+        /* Catch blocks that were not allocated with mbedtls_calloc */
+        configASSERT( pxHeader->usMagic == MBEDTLS_BLOCK_MAGIC );
+
+        explicit_bzero( ptr, pxHeader->ulSize );
+
+        if( pxHeader->ucClass == MBEDTLS_BLOCK_CLASS_HEAP )
+        {
+            vPortFree( pxHeader );
+        }
+        else
+        {
+            configASSERT( pxHeader->ucClass < MBEDTLS_POOL_NUM_CLASSES );
+
+            vTaskSuspendAll();
+            {
+                prvPoolGive( pxHeader );
+            }
+            ( void ) xTaskResumeAll();
+        }
     }
 }
 
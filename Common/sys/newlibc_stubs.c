@@ -37,23 +37,23 @@ typedef struct A_BLOCK_LINK
     size_t xBlockSize;                     /*<< The size of the free block. */
 } BlockLink_t;
 
-/* Override newlibc memory allocator functions */
+/* Override newlibc memory allocator functions. Allocations are attributed to the caller for heap tracing. */
 void * malloc( size_t xLen )
 {
-    return pvPortMalloc( xLen );
+    return pvPortMallocFromCaller( xLen );
 }
 
 void * _malloc_r( struct _reent * pxReent,
                   size_t xLen )
 {
     ( void ) pxReent;
-    return pvPortMalloc( xLen );
+    return pvPortMallocFromCaller( xLen );
 }
 
 void * calloc( size_t xNum,
                size_t xLen )
 {
-    void * pvBuffer = pvPortMalloc( xNum * xLen );
+    void * pvBuffer = pvPortMallocFromCaller( xNum * xLen );
 
     if( pvBuffer != NULL )
     {
@@ -103,7 +103,7 @@ void * realloc( void * pvPtr,
 
     if( pvPtr == NULL )
     {
-        pvNewBuff = pvPortMalloc( xNewLen );
+        pvNewBuff = pvPortMallocFromCaller( xNewLen );
     }
     else /* pvPtr is not NULL */
     {
@@ -116,7 +116,7 @@ void * realloc( void * pvPtr,
         }
         else
         {
-            pvNewBuff = pvPortMalloc( xNewLen );
+            pvNewBuff = pvPortMallocFromCaller( xNewLen );
         }
 
         if( pvNewBuff != NULL )
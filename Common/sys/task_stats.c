@@ -0,0 +1,362 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "task_stats.h"
+
+/* Default to the Cortex-M cycle counter. Other ports define both macros in FreeRTOSConfig.h. */
+#ifndef taskstatsGET_CYCLE_COUNT
+#include "hw_defs.h"
+#define taskstatsGET_CYCLE_COUNT()    ( DWT->CYCCNT )
+#define taskstatsCYCLE_COUNT_HZ       ( SystemCoreClock )
+#endif
+
+#if ( TASK_STATS_TLS_INDEX >= configNUM_THREAD_LOCAL_STORAGE_POINTERS )
+#error "TASK_STATS_TLS_INDEX must be less than configNUM_THREAD_LOCAL_STORAGE_POINTERS"
+#endif
+
+#if ( configGENERATE_RUN_TIME_STATS != 1 ) || ( configUSE_TRACE_FACILITY != 1 )
+#error "The task stats sampler needs configGENERATE_RUN_TIME_STATS and configUSE_TRACE_FACILITY"
+#endif
+
+/* Extra room in case tasks are created while a window is being sampled */
+#define TASK_STATS_EXTRA_TASKS    4
+
+typedef struct
+{
+    volatile uint32_t ulIrqNumber;
+    volatile uint32_t ulCount;
+    volatile uint32_t ulCycles;
+    uint32_t ulEnterCycles;
+} TaskStatsIsrSlot_t;
+
+void * volatile pvTaskStatsLastTcb = NULL;
+
+static TaskStatsIsrSlot_t xIsrSlots[ TASK_STATS_MAX_IRQS ];
+static volatile uint32_t ulIsrSlotsUsed = 0;
+
+/*-----------------------------------------------------------*/
+
+static TaskStatsIsrSlot_t * prvGetIsrSlot( uint32_t ulIrqNumber )
+{
+    TaskStatsIsrSlot_t * pxSlot = NULL;
+    uint32_t ulIdx;
+
+    for( ulIdx = 0; ulIdx < ulIsrSlotsUsed; ulIdx++ )
+    {
+        if( xIsrSlots[ ulIdx ].ulIrqNumber == ulIrqNumber )
+        {
+            pxSlot = &( xIsrSlots[ ulIdx ] );
+            break;
+        }
+    }
+
+    if( pxSlot == NULL )
+    {
+        UBaseType_t uxSavedInterruptStatus = portSET_INTERRUPT_MASK_FROM_ISR();
+
+        /* A higher priority handler may have claimed a slot in the meantime */
+        if( ulIsrSlotsUsed < TASK_STATS_MAX_IRQS )
+        {
+            pxSlot = &( xIsrSlots[ ulIsrSlotsUsed ] );
+            pxSlot->ulIrqNumber = ulIrqNumber;
+            pxSlot->ulCount = 0;
+            pxSlot->ulCycles = 0;
+            ulIsrSlotsUsed++;
+        }
+
+        portCLEAR_INTERRUPT_MASK_FROM_ISR( uxSavedInterruptStatus );
+    }
+
+    return pxSlot;
+}
+
+/*
+ * A handler does not preempt itself, so each slot is only written by its own
+ * handler. Time spent in nested higher priority handlers is included.
+ */
+void vTaskStatsIsrEnter( uint32_t ulIrqNumber )
+{
+    TaskStatsIsrSlot_t * pxSlot = prvGetIsrSlot( ulIrqNumber );
+
+    if( pxSlot != NULL )
+    {
+        pxSlot->ulEnterCycles = taskstatsGET_CYCLE_COUNT();
+    }
+}
+
+void vTaskStatsIsrExit( uint32_t ulIrqNumber )
+{
+    TaskStatsIsrSlot_t * pxSlot = prvGetIsrSlot( ulIrqNumber );
+
+    if( pxSlot != NULL )
+    {
+        pxSlot->ulCycles += taskstatsGET_CYCLE_COUNT() - pxSlot->ulEnterCycles;
+        pxSlot->ulCount++;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvGetSwitchCount( TaskHandle_t xTask )
+{
+    return ( uint32_t ) ( uintptr_t ) pvTaskGetThreadLocalStoragePointer( xTask, TASK_STATS_TLS_INDEX );
+}
+
+/*
+ * Capture the state of all tasks. The scheduler is suspended so that no task
+ * can be freed by the idle task between the two reads.
+ */
+static UBaseType_t prvGetSystemState( TaskStatus_t * pxTaskStatusArray,
+                                      UBaseType_t uxArraySize,
+                                      uint32_t * pulSwitches,
+                                      configRUN_TIME_COUNTER_TYPE * pxTotalRunTime )
+{
+    UBaseType_t uxNumTasks;
+
+    vTaskSuspendAll();
+    {
+        uxNumTasks = uxTaskGetSystemState( pxTaskStatusArray, uxArraySize, pxTotalRunTime );
+
+        for( UBaseType_t i = 0; i < uxNumTasks; i++ )
+        {
+            pulSwitches[ i ] = prvGetSwitchCount( pxTaskStatusArray[ i ].xHandle );
+        }
+    }
+    ( void ) xTaskResumeAll();
+
+    return uxNumTasks;
+}
+
+static void prvGetIsrTotals( TaskStatsIsrEntry_t * pxIsrs,
+                             uint32_t * pulNumIsrs )
+{
+    uint32_t ulNumIsrs = ulIsrSlotsUsed;
+
+    for( uint32_t i = 0; i < ulNumIsrs; i++ )
+    {
+        pxIsrs[ i ].ulIrqNumber = xIsrSlots[ i ].ulIrqNumber;
+        pxIsrs[ i ].ulCount = xIsrSlots[ i ].ulCount;
+        pxIsrs[ i ].ulCycles = xIsrSlots[ i ].ulCycles;
+    }
+
+    *pulNumIsrs = ulNumIsrs;
+}
+
+static void prvSortByRunTime( TaskStatsEntry_t * pxEntries,
+                              uint32_t ulNumEntries )
+{
+    /* Insertion sort, there are only a few tens of tasks */
+    for( uint32_t i = 1; i < ulNumEntries; i++ )
+    {
+        TaskStatsEntry_t xEntry = pxEntries[ i ];
+        uint32_t j = i;
+
+        while( ( j > 0 ) && ( pxEntries[ j - 1 ].ulRunTime < xEntry.ulRunTime ) )
+        {
+            pxEntries[ j ] = pxEntries[ j - 1 ];
+            j--;
+        }
+
+        pxEntries[ j ] = xEntry;
+    }
+}
+
+/*
+ * Fill up to ulMaxEntries entries with the counters in pxTaskStatusArray less
+ * those in pxBefore, sorted by decreasing run time.
+ */
+static uint32_t prvFillEntries( const TaskStatus_t * pxTaskStatusArray,
+                                UBaseType_t uxNumTasks,
+                                const uint32_t * pulSwitches,
+                                const TaskStatsCounters_t * pxBefore,
+                                UBaseType_t uxNumBefore,
+                                TaskStatsEntry_t * pxEntries,
+                                uint32_t ulMaxEntries )
+{
+    uint32_t ulNumEntries = 0;
+
+    for( UBaseType_t i = 0; ( i < uxNumTasks ) && ( ulNumEntries < ulMaxEntries ); i++ )
+    {
+        TaskStatsEntry_t * pxEntry = &( pxEntries[ ulNumEntries ] );
+        uint32_t ulRunTimeBefore = 0;
+        uint32_t ulSwitchesBefore = 0;
+
+        /* Tasks created during the window start from zero */
+        for( UBaseType_t j = 0; j < uxNumBefore; j++ )
+        {
+            if( pxBefore[ j ].ulTaskNumber == pxTaskStatusArray[ i ].xTaskNumber )
+            {
+                ulRunTimeBefore = pxBefore[ j ].ulRunTime;
+                ulSwitchesBefore = pxBefore[ j ].ulSwitches;
+                break;
+            }
+        }
+
+        pxEntry->pcTaskName = pxTaskStatusArray[ i ].pcTaskName;
+        pxEntry->ulTaskNumber = pxTaskStatusArray[ i ].xTaskNumber;
+        pxEntry->ulRunTime = ( uint32_t ) pxTaskStatusArray[ i ].ulRunTimeCounter - ulRunTimeBefore;
+        pxEntry->ulSwitches = pulSwitches[ i ] - ulSwitchesBefore;
+        pxEntry->usStackHighWaterMark = ( uint16_t ) pxTaskStatusArray[ i ].usStackHighWaterMark;
+        pxEntry->ucPriority = ( uint8_t ) pxTaskStatusArray[ i ].uxCurrentPriority;
+        pxEntry->ucState = ( uint8_t ) pxTaskStatusArray[ i ].eCurrentState;
+        ulNumEntries++;
+    }
+
+    prvSortByRunTime( pxEntries, ulNumEntries );
+
+    return ulNumEntries;
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t ulTaskStatsSample( uint32_t ulWindowMs,
+                            TaskStatsEntry_t * pxEntries,
+                            uint32_t ulMaxEntries,
+                            TaskStatsSummary_t * pxSummary )
+{
+    UBaseType_t uxArraySize = uxTaskGetNumberOfTasks() + TASK_STATS_EXTRA_TASKS;
+    TaskStatus_t * pxTaskStatusArray = NULL;
+    TaskStatsCounters_t * pxBefore = NULL;
+    uint32_t * pulSwitches = NULL;
+    UBaseType_t uxNumBefore = 0;
+    UBaseType_t uxNumAfter = 0;
+    configRUN_TIME_COUNTER_TYPE xRunTimeBefore = 0;
+    configRUN_TIME_COUNTER_TYPE xRunTimeAfter = 0;
+    TickType_t xTicksBefore = 0;
+    TaskStatsIsrEntry_t xIsrsBefore[ TASK_STATS_MAX_IRQS ];
+    uint32_t ulNumIsrsBefore = 0;
+    uint32_t ulNumEntries = 0;
+
+    configASSERT( pxEntries != NULL );
+    configASSERT( pxSummary != NULL );
+
+    pxTaskStatusArray = ( TaskStatus_t * ) pvPortMalloc( sizeof( TaskStatus_t ) * uxArraySize );
+    pxBefore = ( TaskStatsCounters_t * ) pvPortMalloc( sizeof( TaskStatsCounters_t ) * uxArraySize );
+    pulSwitches = ( uint32_t * ) pvPortMalloc( sizeof( uint32_t ) * uxArraySize );
+
+    ( void ) memset( pxSummary, 0, sizeof( TaskStatsSummary_t ) );
+
+    if( ( pxTaskStatusArray != NULL ) &&
+        ( pxBefore != NULL ) &&
+        ( pulSwitches != NULL ) )
+    {
+        xTicksBefore = xTaskGetTickCount();
+        prvGetIsrTotals( xIsrsBefore, &ulNumIsrsBefore );
+        uxNumBefore = prvGetSystemState( pxTaskStatusArray, uxArraySize, pulSwitches, &xRunTimeBefore );
+
+        for( UBaseType_t i = 0; i < uxNumBefore; i++ )
+        {
+            pxBefore[ i ].ulTaskNumber = pxTaskStatusArray[ i ].xTaskNumber;
+            pxBefore[ i ].ulRunTime = pxTaskStatusArray[ i ].ulRunTimeCounter;
+            pxBefore[ i ].ulSwitches = pulSwitches[ i ];
+        }
+
+        vTaskDelay( pdMS_TO_TICKS( ulWindowMs ) );
+
+        uxNumAfter = prvGetSystemState( pxTaskStatusArray, uxArraySize, pulSwitches, &xRunTimeAfter );
+        prvGetIsrTotals( pxSummary->xIsrs, &( pxSummary->ulNumIsrs ) );
+
+        pxSummary->ulWindowTicks = ( uint32_t ) ( xTaskGetTickCount() - xTicksBefore );
+        pxSummary->ulWindowRunTime = ( uint32_t ) ( xRunTimeAfter - xRunTimeBefore );
+        pxSummary->ulCycleHz = taskstatsCYCLE_COUNT_HZ;
+
+        ulNumEntries = prvFillEntries( pxTaskStatusArray, uxNumAfter, pulSwitches,
+                                       pxBefore, uxNumBefore,
+                                       pxEntries, ulMaxEntries );
+
+        /* Slots are only ever appended, so the first ulNumIsrsBefore entries line up */
+        for( uint32_t i = 0; i < ulNumIsrsBefore; i++ )
+        {
+            pxSummary->xIsrs[ i ].ulCount -= xIsrsBefore[ i ].ulCount;
+            pxSummary->xIsrs[ i ].ulCycles -= xIsrsBefore[ i ].ulCycles;
+        }
+    }
+
+    vPortFree( pxTaskStatusArray );
+    vPortFree( pxBefore );
+    vPortFree( pulSwitches );
+
+    return ulNumEntries;
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t ulTaskStatsInterval( TaskStatsInterval_t * pxInterval,
+                              TaskStatsEntry_t * pxEntries,
+                              uint32_t ulMaxEntries,
+                              uint32_t * pulWindowRunTime )
+{
+    UBaseType_t uxArraySize = uxTaskGetNumberOfTasks() + TASK_STATS_EXTRA_TASKS;
+    TaskStatus_t * pxTaskStatusArray = NULL;
+    uint32_t * pulSwitches = NULL;
+    UBaseType_t uxNumTasks = 0;
+    configRUN_TIME_COUNTER_TYPE xRunTime = 0;
+    uint32_t ulNumEntries = 0;
+
+    configASSERT( pxInterval != NULL );
+    configASSERT( pxEntries != NULL );
+    configASSERT( pulWindowRunTime != NULL );
+
+    pxTaskStatusArray = ( TaskStatus_t * ) pvPortMalloc( sizeof( TaskStatus_t ) * uxArraySize );
+    pulSwitches = ( uint32_t * ) pvPortMalloc( sizeof( uint32_t ) * uxArraySize );
+
+    *pulWindowRunTime = 0;
+
+    if( ( pxTaskStatusArray != NULL ) &&
+        ( pulSwitches != NULL ) )
+    {
+        uxNumTasks = prvGetSystemState( pxTaskStatusArray, uxArraySize, pulSwitches, &xRunTime );
+
+        ulNumEntries = prvFillEntries( pxTaskStatusArray, uxNumTasks, pulSwitches,
+                                       pxInterval->xTasks, pxInterval->ulNumTasks,
+                                       pxEntries, ulMaxEntries );
+
+        *pulWindowRunTime = ( uint32_t ) xRunTime - pxInterval->ulRunTime;
+
+        /* Keep the counters for the next interval. Tasks which do not fit are
+         * counted from zero again next time. */
+        pxInterval->ulRunTime = ( uint32_t ) xRunTime;
+        pxInterval->ulNumTasks = 0;
+
+        for( UBaseType_t i = 0; ( i < uxNumTasks ) && ( pxInterval->ulNumTasks < TASK_STATS_INTERVAL_TASKS ); i++ )
+        {
+            TaskStatsCounters_t * pxCounters = &( pxInterval->xTasks[ pxInterval->ulNumTasks ] );
+
+            pxCounters->ulTaskNumber = pxTaskStatusArray[ i ].xTaskNumber;
+            pxCounters->ulRunTime = ( uint32_t ) pxTaskStatusArray[ i ].ulRunTimeCounter;
+            pxCounters->ulSwitches = pulSwitches[ i ];
+            pxInterval->ulNumTasks++;
+        }
+    }
+
+    vPortFree( pxTaskStatusArray );
+    vPortFree( pulSwitches );
+
+    return ulNumEntries;
+}
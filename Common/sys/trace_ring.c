@@ -0,0 +1,135 @@
+/*
+ * FreeRTOS STM32U5 Reference Integration
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "hw_defs.h"
+
+#include "dwt_cycles.h"
+#include "trace_ring.h"
+
+#if TRACE_RING_ENABLED
+
+#if ( ( TRACE_RING_LEN & ( TRACE_RING_LEN - 1 ) ) != 0 )
+#error "TRACE_RING_LEN must be a power of two"
+#endif
+
+volatile uint32_t ulTraceClassMask = 0;
+
+static TraceEvent_t pxTraceRing[ TRACE_RING_LEN ];
+
+/* Total number of events recorded since the last start, never wraps back to 0 in practice */
+static volatile uint32_t ulTraceHead = 0;
+
+/* Task number of the running task, maintained even while recording is stopped */
+static volatile uint16_t usTraceCurrentTask = 0;
+
+/*-----------------------------------------------------------*/
+
+void vTraceRingStart( uint32_t ulClassMask )
+{
+    UBaseType_t uxSavedInterruptStatus;
+
+    /* Timestamps come from the cycle counter */
+    vDwtCycleCounterEnable();
+
+    uxSavedInterruptStatus = portSET_INTERRUPT_MASK_FROM_ISR();
+
+    ulTraceHead = 0;
+    ulTraceClassMask = ulClassMask;
+
+    portCLEAR_INTERRUPT_MASK_FROM_ISR( uxSavedInterruptStatus );
+}
+
+void vTraceRingStop( void )
+{
+    ulTraceClassMask = 0;
+}
+
+/*
+ * Copy the ulIndex'th oldest event in the ring to pxEvent.
+ * Returns the number of events available, recording should be stopped.
+ */
+uint32_t ulTraceRingRead( uint32_t ulIndex,
+                          TraceEvent_t * pxEvent )
+{
+    uint32_t ulHead = ulTraceHead;
+    uint32_t ulCount = ( ulHead > TRACE_RING_LEN ) ? TRACE_RING_LEN : ulHead;
+
+    if( ulIndex < ulCount )
+    {
+        *pxEvent = pxTraceRing[ ( ulHead - ulCount + ulIndex ) & ( TRACE_RING_LEN - 1 ) ];
+    }
+
+    return ulCount;
+}
+
+/* Number of events overwritten since the last start */
+uint32_t ulTraceRingLost( void )
+{
+    uint32_t ulHead = ulTraceHead;
+
+    return ( ulHead > TRACE_RING_LEN ) ? ( ulHead - TRACE_RING_LEN ) : 0;
+}
+
+/*-----------------------------------------------------------*/
+
+void vTraceRingRecordValue( uint32_t ulClass,
+                            uint8_t ucType,
+                            uint8_t ucFlags,
+                            uint32_t ulArg,
+                            uint32_t ulValue )
+{
+    if( ( ulTraceClassMask & ulClass ) != 0 )
+    {
+        UBaseType_t uxSavedInterruptStatus = portSET_INTERRUPT_MASK_FROM_ISR();
+        TraceEvent_t * pxEvent = &( pxTraceRing[ ulTraceHead & ( TRACE_RING_LEN - 1 ) ] );
+
+        ulTraceHead++;
+
+        pxEvent->ulTimestamp = DWT->CYCCNT;
+        pxEvent->ucType = ucType;
+        pxEvent->ucFlags = ucFlags;
+        pxEvent->usTask = usTraceCurrentTask;
+        pxEvent->ulArg = ulArg;
+        pxEvent->ulValue = ulValue;
+
+        portCLEAR_INTERRUPT_MASK_FROM_ISR( uxSavedInterruptStatus );
+    }
+}
+
+/* Called from vTaskSwitchContext with interrupts masked */
+void vTraceRingTaskSwitchedIn( uint32_t ulTaskNumber )
+{
+    if( usTraceCurrentTask != ( uint16_t ) ulTaskNumber )
+    {
+        usTraceCurrentTask = ( uint16_t ) ulTaskNumber;
+        vTraceRingRecord( TRACE_CLASS_SCHED, TRACE_EVT_TASK_SWITCH, 0, 0 );
+    }
+}
+
+#endif /* TRACE_RING_ENABLED */
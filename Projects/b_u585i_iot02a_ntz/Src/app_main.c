@@ -174,6 +174,7 @@ static void vHeartbeatTask( void * pvParameters )
 
 extern void net_main( void * pvParameters );
 extern void vMQTTAgentTask( void * );
+extern void vSensorSchedTask( void * );
 extern void vMotionSensorsPublish( void * );
 extern void vEnvironmentSensorPublishTask( void * );
 extern void vShadowDeviceTask( void * );
@@ -203,6 +204,8 @@ void vInitTask( void * pvArgs )
         ( void ) xEventGroupSetBits( xSystemEvents, EVT_MASK_FS_READY );
 
         KVStore_init();
+
+        vLoggingSetModuleLevels( KVStore_getUInt32( CS_LOG_LEVELS, NULL ) );
     }
     else
     {
@@ -224,6 +227,9 @@ void vInitTask( void * pvArgs )
     xResult = xTaskCreate( vOTAUpdateTask, "OTAUpdate", 4096, NULL, tskIDLE_PRIORITY + 1, NULL );
     configASSERT( xResult == pdTRUE );
 
+    xResult = xTaskCreate( vSensorSchedTask, "SensorSched", 512, NULL, 6, NULL );
+    configASSERT( xResult == pdTRUE );
+
 /*    xResult = xTaskCreate( vEnvironmentSensorPublishTask, "EnvSense", 1024, NULL, 5, NULL ); */
 /*    configASSERT( xResult == pdTRUE ); */
 
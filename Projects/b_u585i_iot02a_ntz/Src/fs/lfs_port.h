@@ -38,3 +38,14 @@ const struct lfs_config * pxInitializeInternalFlashFs( TickType_t xBlockTime );
 
 /* Provided outside of the lfs port */
 lfs_t * pxGetDefaultFsCtx( void );
+
+typedef struct
+{
+    uint32_t ulErases;      /* Blocks erased */
+    uint32_t ulEraseErrors; /* Block erases which failed */
+    uint32_t ulProgBytes;   /* Bytes programmed */
+    uint32_t ulProgErrors;  /* Program operations which failed */
+} LfsPortStats_t;
+
+/* Flash wear counters of the file system since boot */
+void lfs_port_get_stats( LfsPortStats_t * pxStats );
@@ -103,12 +103,15 @@ static int lfs_port_prog( const struct lfs_config * c,
         if( xHAL_Status != HAL_OK )
         {
             HAL_FLASH_Lock();
+            lfs_port_count_prog( size, -1 );
             return -1;
         }
     }
 
     HAL_FLASH_Lock();
 
+    lfs_port_count_prog( size, 0 );
+
     return 0;
 }
 
@@ -131,6 +134,8 @@ static int lfs_port_erase( const struct lfs_config * c,
     HAL_StatusTypeDef xHAL_Status = HAL_FLASHEx_Erase( &xErase_Config, &ulPageError );
     HAL_FLASH_Lock();
 
+    lfs_port_count_erase( xHAL_Status == HAL_OK ? 0 : -1 );
+
     return xHAL_Status == HAL_OK ? 0 : -1;
 }
 
@@ -26,7 +26,8 @@
  */
 
 #include "logging_levels.h"
-#define LOG_LEVEL    LOG_ERROR
+#define LOG_LEVEL     LOG_ERROR
+#define LOG_MODULE    LOG_MODULE_STORAGE
 #include "logging.h"
 
 #include "FreeRTOS.h"
@@ -252,6 +253,8 @@ static int lfs_port_prog( const struct lfs_config * pxCfg,
         }
     }
 
+    lfs_port_count_prog( size, lReturnValue );
+
     return lReturnValue;
 }
 
@@ -278,6 +281,8 @@ static int lfs_port_erase( const struct lfs_config * pxCfg,
 
     LogDebug( "Erase operation completed. Address: 0x%010lX Return Value: %ld", ulEraseAddr, lReturnValue );
 
+    lfs_port_count_erase( lReturnValue );
+
     return lReturnValue;
 }
 
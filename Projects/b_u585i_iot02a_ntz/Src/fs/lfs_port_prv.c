@@ -31,6 +31,9 @@
 #include "lfs_util.h"
 #include "lfs.h"
 #include "lfs_port_prv.h"
+#include "lfs_port.h"
+
+static LfsPortStats_t xLfsPortStats = { 0 };
 
 int lfs_port_lock( const struct lfs_config * c )
 {
@@ -52,6 +55,37 @@ int lfs_port_unlock( const struct lfs_config * c )
     return ( int ) ( xReturnVal == pdTRUE ? 0 : -1 );
 }
 
+void lfs_port_count_prog( lfs_size_t size,
+                          int lResult )
+{
+    if( lResult == 0 )
+    {
+        xLfsPortStats.ulProgBytes += size;
+    }
+    else
+    {
+        xLfsPortStats.ulProgErrors++;
+    }
+}
+
+void lfs_port_count_erase( int lResult )
+{
+    xLfsPortStats.ulErases++;
+
+    if( lResult != 0 )
+    {
+        xLfsPortStats.ulEraseErrors++;
+    }
+}
+
+void lfs_port_get_stats( LfsPortStats_t * pxStats )
+{
+    if( pxStats != NULL )
+    {
+        ( void ) memcpy( pxStats, &xLfsPortStats, sizeof( LfsPortStats_t ) );
+    }
+}
+
 /* The following function lfs_crc is dervied from lfs_util.c and
  * is available under the following terms:
  * Copyright (c) 2017, Arm Limited. All rights reserved.
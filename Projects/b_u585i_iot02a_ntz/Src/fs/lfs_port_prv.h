@@ -41,6 +41,12 @@ int lfs_port_lock( const struct lfs_config * c );
 
 int lfs_port_unlock( const struct lfs_config * c );
 
+/* Update the wear counters, called by the block device drivers with the port mutex held */
+void lfs_port_count_prog( lfs_size_t size,
+                          int lResult );
+
+void lfs_port_count_erase( int lResult );
+
 uint32_t lfs_crc( uint32_t crc,
                   const void * buffer,
                   size_t size );
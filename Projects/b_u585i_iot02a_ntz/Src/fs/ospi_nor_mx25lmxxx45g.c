@@ -27,7 +27,8 @@
 
 
 #include "logging_levels.h"
-#define LOG_LEVEL    LOG_DEBUG
+#define LOG_LEVEL     LOG_DEBUG
+#define LOG_MODULE    LOG_MODULE_STORAGE
 #include "logging.h"
 #include "FreeRTOS.h"
 #include "task.h"
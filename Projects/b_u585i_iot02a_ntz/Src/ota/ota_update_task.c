@@ -40,7 +40,8 @@
 #include "logging_levels.h"
 /* define LOG_LEVEL here if you want to modify the logging level from the default */
 
-#define LOG_LEVEL    LOG_INFO
+#define LOG_LEVEL     LOG_INFO
+#define LOG_MODULE    LOG_MODULE_OTA
 
 #include "logging.h"
 
@@ -55,6 +56,7 @@
 #include "task.h"
 #include "semphr.h"
 #include "sys_evt.h"
+#include "trace_ring.h"
 
 #include "ota_config.h"
 
@@ -542,6 +544,8 @@ static void otaAppCallback( OtaJobEvent_t event,
 {
     OtaErr_t err = OtaErrUninitialized;
 
+    vTraceValue( "ota_job_event", ( uint32_t ) event );
+
     switch( event )
     {
         case OtaJobEventActivate:
@@ -652,6 +656,8 @@ static void prvProcessIncomingData( void * pxContext,
         {
             LogDebug( ( "Received OTA image block, size %d.\n\n", pPublishInfo->payloadLength ) );
 
+            vTraceValue( "ota_block_rx", pPublishInfo->payloadLength );
+
             pData = prvOTAEventBufferGet( &xAppStaticBuffer.eventBufferPool );
 
             if( pData != NULL )
@@ -97,6 +97,7 @@ static void vHeartbeatTask( void * pvParameters )
 
 extern void net_main( void * pvParameters );
 extern void vMQTTAgentTask( void * );
+extern void vSensorSchedTask( void * );
 extern void vMotionSensorsPublish( void * );
 extern void vEnvironmentSensorPublishTask( void * );
 extern void vShadowDeviceTask( void * );
@@ -117,6 +118,8 @@ void vInitTask( void * pvArgs )
 
     KVStore_init();
 
+    vLoggingSetModuleLevels( KVStore_getUInt32( CS_LOG_LEVELS, NULL ) );
+
     xResult = xTaskCreate( vHeartbeatTask, "Heartbeat", 128, NULL, tskIDLE_PRIORITY, NULL );
     configASSERT( xResult == pdTRUE );
 
@@ -131,6 +134,9 @@ void vInitTask( void * pvArgs )
  *  configASSERT( xResult == pdTRUE );
  */
 
+    xResult = xTaskCreate( vSensorSchedTask, "SensorSched", 512, NULL, 12, NULL );
+    configASSERT( xResult == pdTRUE );
+
     xResult = xTaskCreate( vEnvironmentSensorPublishTask, "EnvSense", 1024, NULL, 10, NULL );
     configASSERT( xResult == pdTRUE );
 
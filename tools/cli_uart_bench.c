@@ -0,0 +1,903 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+/*
+ * Host benchmark of the console UART transmit path of Common/cli/cli_uart_drv.c
+ * on a mock of the STM32U5 HAL UART and GPDMA, built on the tools/host
+ * kernel shim.
+ *
+ * A line task plays the part of the USART and of the DMA channel. It shifts
+ * the bytes of each transfer out at CLI_UART_BAUD_RATE, 8N1, and calls the
+ * interrupt handlers of the driver, which call back into the mocked
+ * HAL_UART_IRQHandler and HAL_DMA_IRQHandler:
+ * - DMA: one GPDMA transfer complete and one USART transmission complete
+ *   interrupt per transfer, as with HAL_UART_Transmit_DMA on the target.
+ * - IT: one TX FIFO threshold interrupt per HW_FIFO_LEN bytes and one
+ *   transmission complete interrupt per transfer, as with
+ *   HAL_UART_Transmit_IT and a FIFO threshold of 8_8. This is the baseline:
+ *   the transmit loop the driver used before the DMA change, 64 byte
+ *   transfers from its own tx stream, runs on a second mocked USART.
+ *
+ * Each path sends the same console output, written in TEST_WRITE_LEN byte
+ * pieces like the output of a command, and the same number of log lines
+ * handed out by xLoggingReceive while the tx stream is empty. Checks:
+ * 1. Data: every console byte arrives once and in order, and every log line
+ *    arrives whole, in order and followed by CLI_OUTPUT_EOL.
+ * 2. Throughput: the DMA path keeps the line at least TEST_MIN_LINE_PCT
+ *    percent busy.
+ * 3. Interrupts and wake-ups: the DMA path takes fewer interrupts and fewer
+ *    transmit calls of the tx task per KB than the IT path.
+ *
+ * Reports for each path the throughput in bytes/s, the interrupts and the
+ * transmit calls per KB, and the CPU time per KB of the tx task and of the
+ * interrupt handlers. The line time is accounted on a virtual clock which
+ * advances by the time on the wire plus the time the tx task takes from
+ * the transmission complete interrupt to its next transmit call, so that
+ * the wake-up latency of the line task itself does not count. CPU times are
+ * host thread times and include the host kernel, so compare the two paths
+ * with each other rather than with the target. Log lines which are pending
+ * while no console output is queued go out one per read timeout on the IT
+ * path, which shows in its throughput.
+ *
+ * Exits with a failure status if any check fails.
+ *
+ * Build and run from the repository root:
+ *   cc -O2 -ICommon/cli -Itools/host -ICommon/include \
+ *      tools/cli_uart_bench.c Common/cli/cli_uart_drv.c tools/host/host_kernel.c -lpthread -o cli_uart_bench
+ *   ./cli_uart_bench [console bytes]
+ */
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#include "stream_buffer.h"
+
+#include "cli.h"
+#include "cli_prv.h"
+#include "logging.h"
+#include "task_stats.h"
+
+#define TEST_CONSOLE_BYTES        12288U
+#define TEST_MAX_CONSOLE_BYTES    262144U
+#define TEST_BYTES_PER_LOG        48U
+#define TEST_WRITE_LEN            80U
+#define TEST_CONSOLE_EOL_EVERY    72U
+#define TEST_LOG_PREFIX           'L'
+#define TEST_LOG_LINE_LEN         10U /* "LOG nnnnnn" */
+#define TEST_WIRE_LOG_LEN         ( TEST_LOG_LINE_LEN + CLI_OUTPUT_EOL_LEN )
+#define TEST_MIN_LINE_PCT         95U
+#define TEST_BYTE_NS              ( 1000000000ULL / CLI_UART_FRAMES_PER_SEC )
+
+/* Baseline: the interrupt driven transmit loop of the driver before the DMA change */
+#define TEST_IT_WRITE_LEN         64U
+#define TEST_IT_FIFO_LEN          8U
+#define TEST_IT_READ_TIMEOUT      pdMS_TO_TICKS( 5 )
+#define TEST_BASELINE_UART        ( ( USART_TypeDef * ) 0x40004400UL )
+#define TEST_BASELINE_IRQn        ( ( IRQn_Type ) 62 )
+
+typedef struct
+{
+    const char * pcName;
+    bool xDma;
+    void ( * vWrite )( const void * const pvBuffer,
+                       uint32_t ulLength );
+    void ( * vUartVector )( void );
+    void ( * vDmaVector )( void );
+    UART_HandleTypeDef * pxHandle;
+
+    /* Log lines handed out by xLoggingReceive */
+    uint32_t ulLogLines;
+    uint32_t ulLogsServed;
+
+    /* What came out of the line */
+    uint8_t * pucWire;
+    uint32_t ulWireCapacity;
+    volatile uint32_t ulWireBytes;
+    uint64_t ullLineNs;
+    uint8_t ucFifo[ TEST_IT_FIFO_LEN ];
+    uint32_t ulFifoLen;
+
+    /* Transfers, interrupts and CPU time */
+    volatile uint32_t ulTransmits;
+    volatile uint32_t ulInterrupts;
+    uint64_t ullIsrCpuNs;
+    volatile uint64_t ullRequestNs;
+    volatile uint64_t ullCompleteNs;
+    clockid_t xTxClock;
+    uint64_t ullTxCpuStartNs;
+} TestPath_t;
+
+extern const ConsoleIO_t xConsoleIO;
+extern BaseType_t xInitConsoleUart( void );
+extern void USART1_IRQHandler( void );
+extern void GPDMA1_Channel6_IRQHandler( void );
+
+static void prvBaselineWrite( const void * const pvBuffer,
+                              uint32_t ulLength );
+static void prvBaselineIRQHandler( void );
+
+static UART_HandleTypeDef xBaselineHandle =
+{
+    .Instance                    = TEST_BASELINE_UART,
+    .Init.BaudRate               = CLI_UART_BAUD_RATE,
+    .Init.WordLength             = UART_WORDLENGTH_8B,
+    .Init.StopBits               = UART_STOPBITS_1,
+    .Init.Parity                 = UART_PARITY_NONE,
+    .Init.Mode                   = UART_MODE_TX_RX,
+    .Init.HwFlowCtl              = UART_HWCONTROL_NONE,
+    .Init.OverSampling           = UART_OVERSAMPLING_16,
+    .Init.OneBitSampling         = UART_ONE_BIT_SAMPLE_DISABLE,
+    .Init.ClockPrescaler         = UART_PRESCALER_DIV1,
+    .AdvancedInit.AdvFeatureInit = UART_ADVFEATURE_NO_INIT,
+};
+
+static TestPath_t xItPath =
+{
+    .pcName      = "IT, 64 byte transfers",
+    .xDma        = false,
+    .vWrite      = prvBaselineWrite,
+    .vUartVector = prvBaselineIRQHandler,
+    .pxHandle    = &xBaselineHandle,
+};
+
+static TestPath_t xDmaPath =
+{
+    .pcName      = "DMA, double buffered",
+    .xDma        = true,
+    .vUartVector = USART1_IRQHandler,
+    .vDmaVector  = GPDMA1_Channel6_IRQHandler,
+};
+
+static TestPath_t * volatile pxLogPath = NULL;
+static TestPath_t * volatile pxLinePath = NULL;
+static SemaphoreHandle_t xLineStart = NULL;
+static StreamBufferHandle_t xBaselineStream = NULL;
+static TaskHandle_t xBaselineTask = NULL;
+static uint8_t * pucConsole = NULL;
+static uint32_t ulConsoleBytes = TEST_CONSOLE_BYTES;
+static uint64_t ullIsrEnterNs = 0;
+
+static uint32_t ulFailures = 0;
+
+uint8_t pucLogModuleLevels[ LOG_MODULE_MAX ];
+
+static void prvCheck( bool xCondition,
+                      const char * pcName )
+{
+    if( !xCondition )
+    {
+        ulFailures++;
+    }
+
+    printf( "%s: %s\n", xCondition ? "ok" : "FAILED", pcName );
+}
+
+void * pvPortMalloc( size_t xWantedSize )
+{
+    return malloc( xWantedSize );
+}
+
+void vPortFree( void * pv )
+{
+    free( pv );
+}
+
+static uint64_t prvNowNs( void )
+{
+    struct timespec xNow;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &xNow );
+
+    return ( ( uint64_t ) xNow.tv_sec * 1000000000U ) + ( uint64_t ) xNow.tv_nsec;
+}
+
+static uint64_t prvCpuNs( clockid_t xClock )
+{
+    struct timespec xNow;
+
+    ( void ) clock_gettime( xClock, &xNow );
+
+    return ( ( uint64_t ) xNow.tv_sec * 1000000000U ) + ( uint64_t ) xNow.tv_nsec;
+}
+
+static void prvSleepNs( uint64_t ullNs )
+{
+    struct timespec xDelay =
+    {
+        .tv_sec  = ( time_t ) ( ullNs / 1000000000U ),
+        .tv_nsec = ( long ) ( ullNs % 1000000000U )
+    };
+
+    ( void ) nanosleep( &xDelay, NULL );
+}
+
+static TestPath_t * prvPathFor( const UART_HandleTypeDef * huart )
+{
+    return ( huart->Instance == USART1 ) ? &xDmaPath : &xItPath;
+}
+
+/* Console output: lower case letters, spaces and line feeds, never TEST_LOG_PREFIX */
+static uint8_t prvConsoleByte( uint32_t ulIndex )
+{
+    uint8_t ucByte;
+
+    if( ( ulIndex % TEST_CONSOLE_EOL_EVERY ) == ( TEST_CONSOLE_EOL_EVERY - 1U ) )
+    {
+        ucByte = '\n';
+    }
+    else
+    {
+        uint32_t ulHash = ( ulIndex * 2654435761U ) >> 24;
+
+        ucByte = ( ulHash < 16U ) ? ' ' : ( uint8_t ) ( 'a' + ( ulHash % 26U ) );
+    }
+
+    return ucByte;
+}
+
+/* Interrupt accounting, called by vTraceIsrEnter / vTraceIsrExit */
+void vTaskStatsIsrEnter( uint32_t ulIrqNumber )
+{
+    ( void ) ulIrqNumber;
+
+    ullIsrEnterNs = prvCpuNs( CLOCK_THREAD_CPUTIME_ID );
+}
+
+void vTaskStatsIsrExit( uint32_t ulIrqNumber )
+{
+    TestPath_t * pxPath = pxLinePath;
+
+    ( void ) ulIrqNumber;
+
+    pxPath->ullIsrCpuNs += prvCpuNs( CLOCK_THREAD_CPUTIME_ID ) - ullIsrEnterNs;
+    pxPath->ulInterrupts++;
+}
+
+/* Logging */
+static size_t prvLogReceive( TestPath_t * pxPath,
+                             char * pcBuffer,
+                             size_t xBufferLength )
+{
+    size_t xBytes = 0;
+
+    if( ( pxPath->ulLogsServed < pxPath->ulLogLines ) &&
+        ( xBufferLength > TEST_LOG_LINE_LEN ) )
+    {
+        ( void ) snprintf( pcBuffer, xBufferLength, "LOG %06lu", ( unsigned long ) pxPath->ulLogsServed );
+        pxPath->ulLogsServed++;
+        xBytes = TEST_LOG_LINE_LEN;
+    }
+
+    return xBytes;
+}
+
+size_t xLoggingReceive( char * pcBuffer,
+                        size_t xBufferLength )
+{
+    size_t xBytes = 0;
+
+    if( pxLogPath == &xDmaPath )
+    {
+        xBytes = prvLogReceive( &xDmaPath, pcBuffer, xBufferLength );
+    }
+
+    return xBytes;
+}
+
+void vLoggingPrintf( const char * const pcLogLevel,
+                     const char * const pcFunctionName,
+                     const unsigned long ulLineNumber,
+                     const char * const pcFormat,
+                     ... )
+{
+    va_list xArgs;
+
+    ( void ) fprintf( stderr, "[%s] %s:%lu ", pcLogLevel, pcFunctionName, ulLineNumber );
+
+    va_start( xArgs, pcFormat );
+    ( void ) vfprintf( stderr, pcFormat, xArgs );
+    va_end( xArgs );
+
+    ( void ) fputc( '\n', stderr );
+}
+
+/* HAL mock: configuration */
+HAL_StatusTypeDef HAL_RCCEx_PeriphCLKConfig( RCC_PeriphCLKInitTypeDef * pxPeriphClkInit )
+{
+    ( void ) pxPeriphClkInit;
+
+    return HAL_OK;
+}
+
+void HAL_GPIO_Init( GPIO_TypeDef * pxGpio,
+                    GPIO_InitTypeDef * pxInit )
+{
+    ( void ) pxGpio;
+    ( void ) pxInit;
+}
+
+void HAL_GPIO_DeInit( GPIO_TypeDef * pxGpio,
+                      uint32_t ulPin )
+{
+    ( void ) pxGpio;
+    ( void ) ulPin;
+}
+
+void HAL_NVIC_SetPriority( IRQn_Type xIRQn,
+                           uint32_t ulPreemptPriority,
+                           uint32_t ulSubPriority )
+{
+    ( void ) xIRQn;
+    ( void ) ulPreemptPriority;
+    ( void ) ulSubPriority;
+}
+
+void HAL_NVIC_EnableIRQ( IRQn_Type xIRQn )
+{
+    ( void ) xIRQn;
+}
+
+void HAL_NVIC_DisableIRQ( IRQn_Type xIRQn )
+{
+    ( void ) xIRQn;
+}
+
+HAL_StatusTypeDef HAL_DMA_Init( DMA_HandleTypeDef * pxDma )
+{
+    ( void ) pxDma;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMA_DeInit( DMA_HandleTypeDef * pxDma )
+{
+    ( void ) pxDma;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMA_ConfigChannelAttributes( DMA_HandleTypeDef * pxDma,
+                                                   uint32_t ulChannelAttributes )
+{
+    ( void ) pxDma;
+    ( void ) ulChannelAttributes;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Init( UART_HandleTypeDef * huart )
+{
+    /* The console handle of the driver is private to it */
+    if( huart->Instance == USART1 )
+    {
+        xDmaPath.pxHandle = huart;
+    }
+
+    if( huart->MspInitCallback != NULL )
+    {
+        huart->MspInitCallback( huart );
+    }
+
+    huart->gState = HAL_UART_STATE_READY;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_DeInit( UART_HandleTypeDef * huart )
+{
+    if( huart->MspDeInitCallback != NULL )
+    {
+        huart->MspDeInitCallback( huart );
+    }
+
+    huart->gState = HAL_UART_STATE_RESET;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_RegisterCallback( UART_HandleTypeDef * huart,
+                                             HAL_UART_CallbackIDTypeDef CallbackID,
+                                             pUART_CallbackTypeDef pCallback )
+{
+    HAL_StatusTypeDef xStatus = HAL_OK;
+
+    switch( CallbackID )
+    {
+        case HAL_UART_TX_COMPLETE_CB_ID:
+            huart->TxCpltCallback = pCallback;
+            break;
+
+        case HAL_UART_ERROR_CB_ID:
+            huart->ErrorCallback = pCallback;
+            break;
+
+        case HAL_UART_MSPINIT_CB_ID:
+            huart->MspInitCallback = pCallback;
+            break;
+
+        case HAL_UART_MSPDEINIT_CB_ID:
+            huart->MspDeInitCallback = pCallback;
+            break;
+
+        default:
+            xStatus = HAL_ERROR;
+            break;
+    }
+
+    return xStatus;
+}
+
+HAL_StatusTypeDef HAL_UART_RegisterRxEventCallback( UART_HandleTypeDef * huart,
+                                                    pUART_RxEventCallbackTypeDef pCallback )
+{
+    huart->RxEventCallback = pCallback;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UARTEx_SetTxFifoThreshold( UART_HandleTypeDef * huart,
+                                                 uint32_t Threshold )
+{
+    ( void ) Threshold;
+
+    huart->NbTxDataToProcess = TEST_IT_FIFO_LEN;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UARTEx_SetRxFifoThreshold( UART_HandleTypeDef * huart,
+                                                 uint32_t Threshold )
+{
+    ( void ) huart;
+    ( void ) Threshold;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UARTEx_EnableFifoMode( UART_HandleTypeDef * huart )
+{
+    huart->FifoMode = 1U;
+
+    return HAL_OK;
+}
+
+/* Nothing is received: the line only models the transmit direction */
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_IT( UART_HandleTypeDef * huart,
+                                               uint8_t * pData,
+                                               uint16_t Size )
+{
+    huart->pRxBuffPtr = pData;
+    huart->RxXferSize = Size;
+
+    return HAL_OK;
+}
+
+/* HAL mock: transmit */
+static HAL_StatusTypeDef prvTransmit( UART_HandleTypeDef * huart,
+                                      const uint8_t * pData,
+                                      uint16_t Size )
+{
+    HAL_StatusTypeDef xStatus = HAL_OK;
+    TestPath_t * pxPath = prvPathFor( huart );
+
+    if( ( pData == NULL ) || ( Size == 0U ) )
+    {
+        xStatus = HAL_ERROR;
+    }
+    else if( huart->gState != HAL_UART_STATE_READY )
+    {
+        xStatus = HAL_BUSY;
+    }
+    else
+    {
+        /* CPU time of the tx task is counted from its first transfer */
+        if( pxPath->ulTransmits == 0U )
+        {
+            ( void ) pthread_getcpuclockid( pthread_self(), &( pxPath->xTxClock ) );
+            pxPath->ullTxCpuStartNs = prvCpuNs( pxPath->xTxClock );
+        }
+
+        huart->pTxBuffPtr = pData;
+        huart->TxXferSize = Size;
+        huart->TxXferCount = Size;
+        huart->gState = HAL_UART_STATE_BUSY_TX;
+
+        pxPath->ullRequestNs = prvNowNs();
+        pxPath->ulTransmits++;
+        pxLinePath = pxPath;
+
+        ( void ) xSemaphoreGive( xLineStart );
+    }
+
+    return xStatus;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_IT( UART_HandleTypeDef * huart,
+                                        const uint8_t * pData,
+                                        uint16_t Size )
+{
+    configASSERT( !prvPathFor( huart )->xDma );
+
+    return prvTransmit( huart, pData, Size );
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_DMA( UART_HandleTypeDef * huart,
+                                         const uint8_t * pData,
+                                         uint16_t Size )
+{
+    configASSERT( prvPathFor( huart )->xDma );
+    configASSERT( huart->hdmatx != NULL );
+
+    return prvTransmit( huart, pData, Size );
+}
+
+/* Transfer complete of the channel: the HAL enables the USART transmission complete interrupt */
+void HAL_DMA_IRQHandler( DMA_HandleTypeDef * pxDma )
+{
+    UART_HandleTypeDef * huart = ( UART_HandleTypeDef * ) pxDma->Parent;
+
+    configASSERT( huart != NULL );
+
+    huart->TxXferCount = 0U;
+}
+
+/* TX FIFO threshold: refill the FIFO, or transmission complete once all bytes are out */
+void HAL_UART_IRQHandler( UART_HandleTypeDef * huart )
+{
+    TestPath_t * pxPath = prvPathFor( huart );
+
+    if( huart->gState == HAL_UART_STATE_BUSY_TX )
+    {
+        if( huart->TxXferCount > 0U )
+        {
+            uint32_t ulBytes = huart->TxXferCount;
+
+            configASSERT( !pxPath->xDma );
+
+            if( ulBytes > huart->NbTxDataToProcess )
+            {
+                ulBytes = huart->NbTxDataToProcess;
+            }
+
+            ( void ) memcpy( pxPath->ucFifo, huart->pTxBuffPtr, ulBytes );
+            pxPath->ulFifoLen = ulBytes;
+            huart->pTxBuffPtr += ulBytes;
+            huart->TxXferCount -= ( uint16_t ) ulBytes;
+        }
+        else
+        {
+            huart->gState = HAL_UART_STATE_READY;
+
+            if( huart->TxCpltCallback != NULL )
+            {
+                huart->TxCpltCallback( huart );
+            }
+        }
+    }
+}
+
+/* The line: shifts the bytes out at the baud rate and raises the interrupts */
+static void prvLineShift( TestPath_t * pxPath,
+                          const uint8_t * pucData,
+                          uint32_t ulBytes )
+{
+    uint64_t ullLineNs = ( uint64_t ) ulBytes * TEST_BYTE_NS;
+
+    prvSleepNs( ullLineNs );
+    pxPath->ullLineNs += ullLineNs;
+
+    configASSERT( ( pxPath->ulWireBytes + ulBytes ) <= pxPath->ulWireCapacity );
+    ( void ) memcpy( &( pxPath->pucWire[ pxPath->ulWireBytes ] ), pucData, ulBytes );
+    pxPath->ulWireBytes += ulBytes;
+}
+
+static void prvLineInterrupt( TestPath_t * pxPath,
+                              void ( * vVector )( void ) )
+{
+    /* The tx task may start the next transfer from this interrupt on */
+    pxPath->ullCompleteNs = prvNowNs();
+    vVector();
+}
+
+static void prvLineTask( void * pvParameters )
+{
+    ( void ) pvParameters;
+
+    for( ; ; )
+    {
+        TestPath_t * pxPath;
+        UART_HandleTypeDef * pxHandle;
+
+        ( void ) xSemaphoreTake( xLineStart, portMAX_DELAY );
+
+        pxPath = pxLinePath;
+        pxHandle = pxPath->pxHandle;
+
+        /* The line stays idle until the tx task starts the next transfer */
+        if( ( pxPath->ulTransmits > 1U ) && ( pxPath->ullRequestNs > pxPath->ullCompleteNs ) )
+        {
+            pxPath->ullLineNs += pxPath->ullRequestNs - pxPath->ullCompleteNs;
+        }
+
+        if( pxPath->xDma )
+        {
+            /* The buffer is read as it is sent: it must not change before the transfer completes */
+            prvLineShift( pxPath, pxHandle->pTxBuffPtr, pxHandle->TxXferSize );
+            prvLineInterrupt( pxPath, pxPath->vDmaVector );
+            prvLineInterrupt( pxPath, pxPath->vUartVector );
+        }
+        else
+        {
+            pxPath->ulFifoLen = 0U;
+            prvLineInterrupt( pxPath, pxPath->vUartVector );
+
+            while( pxPath->ulFifoLen > 0U )
+            {
+                uint8_t ucFifo[ TEST_IT_FIFO_LEN ];
+                uint32_t ulBytes = pxPath->ulFifoLen;
+
+                ( void ) memcpy( ucFifo, pxPath->ucFifo, ulBytes );
+                pxPath->ulFifoLen = 0U;
+
+                prvLineShift( pxPath, ucFifo, ulBytes );
+                prvLineInterrupt( pxPath, pxPath->vUartVector );
+            }
+        }
+    }
+}
+
+/* Baseline: the transmit loop of the driver before the DMA change, without the command line handling */
+static void prvBaselineIRQHandler( void )
+{
+    vTraceIsrEnter( TEST_BASELINE_IRQn );
+    HAL_UART_IRQHandler( &xBaselineHandle );
+    vTraceIsrExit( TEST_BASELINE_IRQn );
+}
+
+static void prvBaselineTxComplete( UART_HandleTypeDef * pxUartHandle )
+{
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+    ( void ) pxUartHandle;
+
+    vTaskNotifyGiveIndexedFromISR( xBaselineTask, 1, &xHigherPriorityTaskWoken );
+
+    portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
+}
+
+static void prvBaselineWrite( const void * const pvBuffer,
+                              uint32_t ulLength )
+{
+    const uint8_t * pucBuffer = ( const uint8_t * ) pvBuffer;
+    size_t xBytesSent = 0;
+
+    while( xBytesSent < ulLength )
+    {
+        xBytesSent += xStreamBufferSend( xBaselineStream,
+                                         &( pucBuffer[ xBytesSent ] ),
+                                         ulLength - xBytesSent,
+                                         portMAX_DELAY );
+    }
+}
+
+static void prvBaselineTxTask( void * pvParameters )
+{
+    static char cLogLine[ dlMAX_LOG_LINE_LENGTH ];
+    uint8_t pucTxBuffer[ TEST_IT_WRITE_LEN ];
+
+    ( void ) pvParameters;
+
+    for( ; ; )
+    {
+        size_t xBytes = xStreamBufferReceive( xBaselineStream, pucTxBuffer, TEST_IT_WRITE_LEN, TEST_IT_READ_TIMEOUT );
+
+        if( xBytes == 0U )
+        {
+            size_t xLogBytes = 0U;
+
+            if( pxLogPath == &xItPath )
+            {
+                xLogBytes = prvLogReceive( &xItPath, cLogLine, sizeof( cLogLine ) );
+            }
+
+            if( xLogBytes > 0U )
+            {
+                ( void ) xStreamBufferSend( xBaselineStream, cLogLine, xLogBytes, 0 );
+                ( void ) xStreamBufferSend( xBaselineStream, CLI_OUTPUT_EOL, CLI_OUTPUT_EOL_LEN, 0 );
+
+                xBytes = xStreamBufferReceive( xBaselineStream, pucTxBuffer, TEST_IT_WRITE_LEN, 0 );
+            }
+        }
+
+        if( xBytes > 0U )
+        {
+            ( void ) xTaskNotifyStateClearIndexed( NULL, 1 );
+
+            if( HAL_UART_Transmit_IT( &xBaselineHandle, pucTxBuffer, ( uint16_t ) xBytes ) == HAL_OK )
+            {
+                ( void ) ulTaskNotifyTakeIndexed( 1, pdTRUE, portMAX_DELAY );
+            }
+        }
+    }
+}
+
+/* Console output and log lines must come out whole and in order, log lines between console bytes */
+static bool prvVerify( const TestPath_t * pxPath )
+{
+    uint32_t ulIndex = 0;
+    uint32_t ulConsole = 0;
+    uint32_t ulLogs = 0;
+    bool xIntact = true;
+
+    while( xIntact && ( ulIndex < pxPath->ulWireBytes ) )
+    {
+        if( pxPath->pucWire[ ulIndex ] == TEST_LOG_PREFIX )
+        {
+            char cExpected[ 32 ];
+
+            ( void ) snprintf( cExpected, sizeof( cExpected ), "LOG %06lu%s", ( unsigned long ) ulLogs, CLI_OUTPUT_EOL );
+
+            xIntact = ( ( ulIndex + TEST_WIRE_LOG_LEN ) <= pxPath->ulWireBytes ) &&
+                      ( memcmp( &( pxPath->pucWire[ ulIndex ] ), cExpected, TEST_WIRE_LOG_LEN ) == 0 );
+            ulIndex += TEST_WIRE_LOG_LEN;
+            ulLogs++;
+        }
+        else
+        {
+            xIntact = ( ulConsole < ulConsoleBytes ) &&
+                      ( pxPath->pucWire[ ulIndex ] == pucConsole[ ulConsole ] );
+            ulIndex++;
+            ulConsole++;
+        }
+    }
+
+    if( !xIntact )
+    {
+        printf( "%s: unexpected data at wire offset %lu\n", pxPath->pcName, ( unsigned long ) ( ulIndex - 1U ) );
+    }
+
+    return xIntact && ( ulConsole == ulConsoleBytes ) && ( ulLogs == pxPath->ulLogLines );
+}
+
+static void prvRunPath( TestPath_t * pxPath )
+{
+    uint32_t ulExpected;
+    uint64_t ullDeadlineNs;
+    uint64_t ullTxCpuNs;
+    double dKBytes;
+    double dBytesPerSec;
+    uint32_t ulOffset;
+
+    pxPath->ulLogLines = ulConsoleBytes / TEST_BYTES_PER_LOG;
+    ulExpected = ulConsoleBytes + ( pxPath->ulLogLines * TEST_WIRE_LOG_LEN );
+    pxPath->ulWireCapacity = ulExpected + TEST_WIRE_LOG_LEN;
+    pxPath->pucWire = malloc( pxPath->ulWireCapacity );
+    configASSERT( pxPath->pucWire != NULL );
+
+    pxLogPath = pxPath;
+
+    for( ulOffset = 0; ulOffset < ulConsoleBytes; ulOffset += TEST_WRITE_LEN )
+    {
+        uint32_t ulLength = ulConsoleBytes - ulOffset;
+
+        pxPath->vWrite( &( pucConsole[ ulOffset ] ), ( ulLength < TEST_WRITE_LEN ) ? ulLength : TEST_WRITE_LEN );
+    }
+
+    /* Everything is in the tx stream: wait for the line, with a generous margin */
+    ullDeadlineNs = prvNowNs() + ( 2U * ( uint64_t ) ulExpected * TEST_BYTE_NS ) + 1000000000U;
+
+    while( ( pxPath->ulWireBytes < ulExpected ) && ( prvNowNs() < ullDeadlineNs ) )
+    {
+        vTaskDelay( pdMS_TO_TICKS( 10 ) );
+    }
+
+    /* Nothing more may follow */
+    vTaskDelay( pdMS_TO_TICKS( 20 ) );
+    pxLogPath = NULL;
+
+    ullTxCpuNs = prvCpuNs( pxPath->xTxClock ) - pxPath->ullTxCpuStartNs;
+    dKBytes = ( double ) pxPath->ulWireBytes / 1024.0;
+    dBytesPerSec = ( pxPath->ullLineNs > 0U ) ? ( ( double ) pxPath->ulWireBytes * 1e9 / ( double ) pxPath->ullLineNs ) : 0.0;
+
+    printf( "%-22s %6.0f bytes/s (%5.1f%% of line rate), %6.1f interrupts/KB, %5.2f transmits/KB, "
+            "CPU/KB: tx task %6.1f us, interrupts %6.1f us\n",
+            pxPath->pcName, dBytesPerSec, dBytesPerSec * 100.0 / ( double ) CLI_UART_FRAMES_PER_SEC,
+            ( double ) pxPath->ulInterrupts / dKBytes, ( double ) pxPath->ulTransmits / dKBytes,
+            ( double ) ullTxCpuNs / 1000.0 / dKBytes, ( double ) pxPath->ullIsrCpuNs / 1000.0 / dKBytes );
+
+    prvCheck( pxPath->ulWireBytes == ulExpected, "every byte is sent" );
+    prvCheck( prvVerify( pxPath ), "console output and log lines arrive whole and in order" );
+}
+
+int main( int argc,
+          char ** argv )
+{
+    BaseType_t xResult;
+    uint32_t ulIndex;
+
+    if( argc > 1 )
+    {
+        ulConsoleBytes = ( uint32_t ) strtoul( argv[ 1 ], NULL, 10 );
+    }
+
+    if( ( ulConsoleBytes < CLI_UART_TX_STREAM_LEN ) || ( ulConsoleBytes > TEST_MAX_CONSOLE_BYTES ) )
+    {
+        ulConsoleBytes = TEST_CONSOLE_BYTES;
+    }
+
+    pucConsole = malloc( ulConsoleBytes );
+    configASSERT( pucConsole != NULL );
+
+    for( ulIndex = 0; ulIndex < ulConsoleBytes; ulIndex++ )
+    {
+        pucConsole[ ulIndex ] = prvConsoleByte( ulIndex );
+    }
+
+    vHostKernelStartRealTime();
+
+    xLineStart = xSemaphoreCreateBinary();
+    configASSERT( xLineStart != NULL );
+
+    xResult = xTaskCreate( prvLineTask, "USART line", 0, NULL, 0, NULL );
+    configASSERT( xResult == pdPASS );
+
+    /* Baseline on its own USART, with the stream sizes of the driver */
+    xBaselineStream = xStreamBufferCreate( CLI_UART_TX_STREAM_LEN, TEST_IT_FIFO_LEN );
+    ( void ) HAL_UART_Init( &xBaselineHandle );
+    ( void ) HAL_UART_RegisterCallback( &xBaselineHandle, HAL_UART_TX_COMPLETE_CB_ID, prvBaselineTxComplete );
+    ( void ) HAL_UARTEx_SetTxFifoThreshold( &xBaselineHandle, UART_TXFIFO_THRESHOLD_8_8 );
+    ( void ) HAL_UARTEx_EnableFifoMode( &xBaselineHandle );
+
+    xResult = xTaskCreate( prvBaselineTxTask, "uartTxIT", 0, NULL, 0, &xBaselineTask );
+    configASSERT( xResult == pdPASS );
+
+    /* The driver */
+    xResult = xInitConsoleUart();
+    prvCheck( ( xResult == pdTRUE ) && ( xDmaPath.pxHandle != NULL ), "the console UART initialises" );
+    xDmaPath.vWrite = xConsoleIO.write;
+
+    printf( "%lu console bytes in %u byte writes, one log line per %u bytes, %u baud 8N1\n",
+            ( unsigned long ) ulConsoleBytes, TEST_WRITE_LEN, TEST_BYTES_PER_LOG, CLI_UART_BAUD_RATE );
+
+    prvRunPath( &xItPath );
+    prvRunPath( &xDmaPath );
+
+    prvCheck( ( xDmaPath.ulWireBytes * 100ULL * 1000000000ULL ) >=
+              ( ( uint64_t ) TEST_MIN_LINE_PCT * CLI_UART_FRAMES_PER_SEC * xDmaPath.ullLineNs ),
+              "DMA keeps the line busy" );
+    prvCheck( xDmaPath.ulInterrupts < xItPath.ulInterrupts, "DMA takes fewer interrupts per KB" );
+    prvCheck( xDmaPath.ulTransmits < xItPath.ulTransmits, "DMA wakes the tx task less often per KB" );
+
+    printf( "%s (%lu failures)\n", ( ulFailures == 0 ) ? "PASS" : "FAIL", ( unsigned long ) ulFailures );
+
+    return ( ulFailures == 0 ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,644 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+/*
+ * Host test of the Device Defender custom metrics.
+ *
+ * 1. Latency histogram: records synthetic publish latencies and compares the
+ *    p50 / p90 / p99 reported by latency_hist.c with the exact percentiles.
+ *    A reported percentile must not be below the exact one nor more than 25%
+ *    (plus 1 ms) above it.
+ * 2. Encoder: encodes a report whose "cmet" map holds known values, checks
+ *    that the size pass agrees with the encoded length, then decodes the
+ *    report and compares every custom metric with the expected value. The
+ *    decoder below is independent of TinyCBOR.
+ * 3. Cost: time to summarize the histograms and encode the report, which
+ *    does not depend on traffic or uptime.
+ *
+ * Exits with a failure status if any check fails.
+ *
+ * Build and run from the repository root, with the tinycbor submodule:
+ *   cc -O2 -ICommon/include -ICommon/app/defender -IMiddleware/tinycbor/src tools/custom_metrics_bench.c \
+ *      Common/app/defender/custom_metrics.c Common/app/defender/defender_report.c Common/sys/latency_hist.c \
+ *      Middleware/tinycbor/src/cborencoder.c Middleware/tinycbor/src/cborencoder_close_container_checked.c \
+ *      -o custom_metrics_bench
+ *   ./custom_metrics_bench [iterations]
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "custom_metrics.h"
+#include "defender_report.h"
+#include "latency_hist.h"
+
+#define SIM_SAMPLES             10000U
+#define SIM_REPORT_MAX          1024U
+#define SIM_MAX_DECODED         24U
+#define SIM_MAX_VALUES          8U
+#define SIM_VALUE_STR_LEN       48U
+
+typedef enum
+{
+    SimNumber = 0,
+    SimNumberList,
+    SimStringList
+} SimMetricType_t;
+
+/* One custom metric as decoded from a report */
+typedef struct
+{
+    char pcName[ SIM_VALUE_STR_LEN ];
+    SimMetricType_t xType;
+    uint32_t ulNumValues;
+    uint64_t pullValues[ SIM_MAX_VALUES ];
+    char pcValues[ SIM_MAX_VALUES ][ SIM_VALUE_STR_LEN ];
+} SimMetric_t;
+
+typedef struct
+{
+    const uint8_t * pucBuf;
+    size_t xLen;
+    size_t xPos;
+    bool xError;
+} SimReader_t;
+
+static CustomMetrics_t xSimMetrics;
+static uint32_t ulSimSeed = 1U;
+static uint32_t ulFailures = 0;
+
+/*-----------------------------------------------------------*/
+
+static double prvNowUs( void )
+{
+    struct timespec xNow;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &xNow );
+
+    return ( ( double ) xNow.tv_sec * 1e6 ) + ( ( double ) xNow.tv_nsec / 1e3 );
+}
+
+static uint32_t prvRand( void )
+{
+    ulSimSeed = ( ulSimSeed * 1103515245U ) + 12345U;
+
+    return ( ulSimSeed >> 8 ) & 0xFFFFFFU;
+}
+
+static void prvCheck( bool xCondition,
+                      const char * pcWhat )
+{
+    if( !xCondition )
+    {
+        printf( "FAIL: %s\n", pcWhat );
+        ulFailures++;
+    }
+}
+
+static int prvCompareU32( const void * pvA,
+                          const void * pvB )
+{
+    uint32_t ulA = *( const uint32_t * ) pvA;
+    uint32_t ulB = *( const uint32_t * ) pvB;
+
+    return ( ulA > ulB ) - ( ulA < ulB );
+}
+
+/*-----------------------------------------------------------*/
+
+/* Publish latencies in ms: mostly a short round trip, with a slow tail */
+static uint32_t prvSampleUniform( void )
+{
+    return 1U + ( prvRand() % 1000U );
+}
+
+static uint32_t prvSampleBimodal( void )
+{
+    return ( ( prvRand() % 10U ) == 0 ) ? ( 800U + ( prvRand() % 400U ) ) : ( 20U + ( prvRand() % 30U ) );
+}
+
+static uint32_t prvSampleLongTail( void )
+{
+    uint32_t ulMs = 10U + ( prvRand() % 40U );
+
+    /* Doubles with probability 1/4 each time, up to retransmission timeouts */
+    while( ( ( prvRand() % 4U ) == 0 ) && ( ulMs < 60000U ) )
+    {
+        ulMs *= 2U;
+    }
+
+    return ulMs;
+}
+
+static void prvCheckPercentiles( const char * pcName,
+                                 uint32_t ( * pxSample )( void ) )
+{
+    static uint32_t pulSamples[ SIM_SAMPLES ];
+    static const uint32_t pulPercents[] = { 50, 90, 99 };
+    LatencyHist_t xHist;
+
+    ( void ) memset( &xHist, 0, sizeof( xHist ) );
+
+    for( uint32_t i = 0; i < SIM_SAMPLES; i++ )
+    {
+        pulSamples[ i ] = pxSample();
+        vLatencyHistRecord( &xHist, pulSamples[ i ] );
+    }
+
+    qsort( pulSamples, SIM_SAMPLES, sizeof( uint32_t ), prvCompareU32 );
+
+    printf( "%-10s", pcName );
+
+    for( size_t p = 0; p < ( sizeof( pulPercents ) / sizeof( pulPercents[ 0 ] ) ); p++ )
+    {
+        uint32_t ulRank = ( ( SIM_SAMPLES * pulPercents[ p ] ) + 99U ) / 100U;
+        uint32_t ulExact = pulSamples[ ulRank - 1U ];
+        uint32_t ulReported = ulLatencyHistPercentile( &xHist, pulPercents[ p ] );
+
+        printf( "  p%-2lu %6lu %6lu (%+5.1f%%)", ( unsigned long ) pulPercents[ p ],
+                ( unsigned long ) ulExact, ( unsigned long ) ulReported,
+                100.0 * ( ( double ) ulReported - ( double ) ulExact ) / ( double ) ulExact );
+
+        prvCheck( ( ulReported >= ulExact ) && ( ulReported <= ( ulExact + ( ulExact / 4U ) + 1U ) ),
+                  "percentile outside of the bucket error bound" );
+    }
+
+    printf( "  max %6lu\n", ( unsigned long ) xHist.ulMaxMs );
+
+    prvCheck( xHist.ulMaxMs == pulSamples[ SIM_SAMPLES - 1U ], "max" );
+    prvCheck( ulLatencyHistPercentile( &xHist, 100 ) == xHist.ulMaxMs, "p100 is the max" );
+}
+
+/*-----------------------------------------------------------*/
+
+static CborError prvSimCustomMetrics( CborEncoder * pxEncoder )
+{
+    return xCustomMetricsEncode( pxEncoder, &xSimMetrics );
+}
+
+static const MetricsCollectorFn_t pxSimCustomCollectors[] =
+{
+    prvSimCustomMetrics
+};
+
+static void prvFillMetrics( void )
+{
+    static const TaskStatsEntry_t pxEntries[] =
+    {
+        { .pcTaskName = "IDLE",        .ulRunTime = 612345 },
+        { .pcTaskName = "MQTTAgent",   .ulRunTime = 201000 },
+        { .pcTaskName = "MxDataplane", .ulRunTime = 99999  },
+        { .pcTaskName = "EnvSense",    .ulRunTime = 50000  },
+        { .pcTaskName = "Shadow",      .ulRunTime = 20000  },
+        { .pcTaskName = "AWSDefender", .ulRunTime = 9000   },
+        { .pcTaskName = "Tmr Svc",     .ulRunTime = 7656   }
+    };
+    LatencyHist_t xHist;
+
+    ( void ) memset( &xSimMetrics, 0, sizeof( xSimMetrics ) );
+
+    xSimMetrics.ulHeapMinFree = 23456U;
+    vCustomMetricsSetTasks( &xSimMetrics, pxEntries, sizeof( pxEntries ) / sizeof( pxEntries[ 0 ] ), 1000000U );
+
+    ( void ) memset( &xHist, 0, sizeof( xHist ) );
+
+    for( uint32_t i = 0; i < 300U; i++ )
+    {
+        vLatencyHistRecord( &xHist, prvSampleBimodal() );
+    }
+
+    vCustomMetricsSetLatency( &( xSimMetrics.xPublishLatency ), &xHist );
+
+    xSimMetrics.ulSpiErrors = 3U;
+    xSimMetrics.ulSpiDrops = 17U;
+    xSimMetrics.xHasFs = true;
+    xSimMetrics.ulFsErases = 12U;
+    xSimMetrics.ulFsProgBytes = 49152U;
+    xSimMetrics.ulFsErrors = 0U;
+
+    /* One successful handshake and one failure in the interval */
+    ( void ) memset( &xHist, 0, sizeof( xHist ) );
+    vLatencyHistRecord( &xHist, 2345U );
+    vCustomMetricsSetLatency( &( xSimMetrics.xHandshakeLatency ), &xHist );
+    xSimMetrics.ulHandshakeFailures = 1U;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint64_t prvReadHead( SimReader_t * pxReader,
+                             uint8_t * pucMajor,
+                             bool * pxIndefinite )
+{
+    uint64_t ullValue = 0;
+    uint8_t ucInfo = 0;
+
+    *pucMajor = 0xFFU;
+    *pxIndefinite = false;
+
+    if( pxReader->xPos < pxReader->xLen )
+    {
+        *pucMajor = pxReader->pucBuf[ pxReader->xPos ] >> 5;
+        ucInfo = pxReader->pucBuf[ pxReader->xPos ] & 0x1FU;
+        pxReader->xPos++;
+    }
+    else
+    {
+        pxReader->xError = true;
+    }
+
+    if( ucInfo < 24U )
+    {
+        ullValue = ucInfo;
+    }
+    else if( ucInfo <= 27U )
+    {
+        size_t xBytes = ( size_t ) 1U << ( ucInfo - 24U );
+
+        for( size_t i = 0; ( i < xBytes ) && !pxReader->xError; i++ )
+        {
+            if( pxReader->xPos < pxReader->xLen )
+            {
+                ullValue = ( ullValue << 8 ) | pxReader->pucBuf[ pxReader->xPos++ ];
+            }
+            else
+            {
+                pxReader->xError = true;
+            }
+        }
+    }
+    else if( ucInfo == 31U )
+    {
+        *pxIndefinite = true;
+    }
+    else
+    {
+        pxReader->xError = true;
+    }
+
+    return ullValue;
+}
+
+static bool prvAtBreak( SimReader_t * pxReader )
+{
+    bool xBreak = ( pxReader->xPos < pxReader->xLen ) && ( pxReader->pucBuf[ pxReader->xPos ] == 0xFFU );
+
+    if( xBreak )
+    {
+        pxReader->xPos++;
+    }
+
+    return xBreak;
+}
+
+static void prvReadString( SimReader_t * pxReader,
+                           char * pcOut,
+                           size_t xOutLen )
+{
+    uint8_t ucMajor;
+    bool xIndefinite;
+    uint64_t ullLen = prvReadHead( pxReader, &ucMajor, &xIndefinite );
+
+    if( ( ucMajor != 3U ) || xIndefinite || ( ullLen >= xOutLen ) ||
+        ( ( pxReader->xPos + ullLen ) > pxReader->xLen ) )
+    {
+        pxReader->xError = true;
+        pcOut[ 0 ] = '\0';
+    }
+    else
+    {
+        ( void ) memcpy( pcOut, &( pxReader->pucBuf[ pxReader->xPos ] ), ( size_t ) ullLen );
+        pcOut[ ullLen ] = '\0';
+        pxReader->xPos += ( size_t ) ullLen;
+    }
+}
+
+static void prvSkipItem( SimReader_t * pxReader )
+{
+    uint8_t ucMajor;
+    bool xIndefinite;
+    uint64_t ullValue = prvReadHead( pxReader, &ucMajor, &xIndefinite );
+
+    if( ( ucMajor == 2U ) || ( ucMajor == 3U ) )
+    {
+        pxReader->xPos += ( size_t ) ullValue;
+    }
+    else if( ( ucMajor == 4U ) || ( ucMajor == 5U ) )
+    {
+        uint64_t ullItems = ( ucMajor == 5U ) ? ( ullValue * 2U ) : ullValue;
+
+        for( uint64_t i = 0; ( xIndefinite || ( i < ullItems ) ) && !pxReader->xError; i++ )
+        {
+            if( xIndefinite && prvAtBreak( pxReader ) )
+            {
+                break;
+            }
+
+            prvSkipItem( pxReader );
+        }
+    }
+    else if( ucMajor == 7U )
+    {
+        pxReader->xError = true;
+    }
+}
+
+/* "name": [ { "type": value } ] */
+static void prvReadMetric( SimReader_t * pxReader,
+                           SimMetric_t * pxMetric )
+{
+    uint8_t ucMajor;
+    bool xIndefinite;
+    char pcType[ SIM_VALUE_STR_LEN ];
+    uint64_t ullValue;
+
+    ( void ) memset( pxMetric, 0, sizeof( SimMetric_t ) );
+
+    prvReadString( pxReader, pxMetric->pcName, sizeof( pxMetric->pcName ) );
+    ullValue = prvReadHead( pxReader, &ucMajor, &xIndefinite );
+    pxReader->xError |= ( ucMajor != 4U ) || ( ullValue != 1U );
+    ullValue = prvReadHead( pxReader, &ucMajor, &xIndefinite );
+    pxReader->xError |= ( ucMajor != 5U ) || ( ullValue != 1U );
+    prvReadString( pxReader, pcType, sizeof( pcType ) );
+
+    if( strcmp( pcType, "number" ) == 0 )
+    {
+        pxMetric->xType = SimNumber;
+        pxMetric->ulNumValues = 1;
+        pxMetric->pullValues[ 0 ] = prvReadHead( pxReader, &ucMajor, &xIndefinite );
+        pxReader->xError |= ( ucMajor != 0U );
+    }
+    else
+    {
+        uint64_t ullItems = prvReadHead( pxReader, &ucMajor, &xIndefinite );
+
+        pxMetric->xType = ( strcmp( pcType, "number_list" ) == 0 ) ? SimNumberList : SimStringList;
+        pxReader->xError |= ( ucMajor != 4U ) || xIndefinite || ( ullItems > SIM_MAX_VALUES ) ||
+                            ( strcmp( pcType, "string_list" ) != 0 && pxMetric->xType == SimStringList );
+
+        for( uint32_t i = 0; ( i < ullItems ) && !pxReader->xError; i++ )
+        {
+            if( pxMetric->xType == SimNumberList )
+            {
+                pxMetric->pullValues[ i ] = prvReadHead( pxReader, &ucMajor, &xIndefinite );
+                pxReader->xError |= ( ucMajor != 0U );
+            }
+            else
+            {
+                prvReadString( pxReader, pxMetric->pcValues[ i ], SIM_VALUE_STR_LEN );
+            }
+
+            pxMetric->ulNumValues++;
+        }
+    }
+}
+
+/* Decode the "cmet" map of a report, returns the number of metrics or 0 on error */
+static uint32_t prvDecodeReport( const uint8_t * pucReport,
+                                 size_t xLen,
+                                 SimMetric_t * pxMetrics )
+{
+    SimReader_t xReader = { .pucBuf = pucReport, .xLen = xLen, .xPos = 0, .xError = false };
+    uint32_t ulNumMetrics = 0;
+    uint8_t ucMajor;
+    bool xIndefinite;
+
+    ( void ) prvReadHead( &xReader, &ucMajor, &xIndefinite );
+    xReader.xError |= ( ucMajor != 5U ) || !xIndefinite;
+
+    while( !xReader.xError && !prvAtBreak( &xReader ) )
+    {
+        char pcKey[ SIM_VALUE_STR_LEN ];
+
+        prvReadString( &xReader, pcKey, sizeof( pcKey ) );
+
+        if( strcmp( pcKey, "cmet" ) != 0 )
+        {
+            prvSkipItem( &xReader );
+        }
+        else
+        {
+            ( void ) prvReadHead( &xReader, &ucMajor, &xIndefinite );
+            xReader.xError |= ( ucMajor != 5U ) || !xIndefinite;
+
+            while( !xReader.xError && !prvAtBreak( &xReader ) && ( ulNumMetrics < SIM_MAX_DECODED ) )
+            {
+                prvReadMetric( &xReader, &( pxMetrics[ ulNumMetrics ] ) );
+                ulNumMetrics++;
+            }
+        }
+    }
+
+    if( xReader.xError || ( xReader.xPos != xLen ) )
+    {
+        ulNumMetrics = 0;
+    }
+
+    return ulNumMetrics;
+}
+
+/*-----------------------------------------------------------*/
+
+static const SimMetric_t * prvFindMetric( const SimMetric_t * pxMetrics,
+                                          uint32_t ulNumMetrics,
+                                          const char * pcName )
+{
+    const SimMetric_t * pxFound = NULL;
+
+    for( uint32_t i = 0; i < ulNumMetrics; i++ )
+    {
+        if( strcmp( pxMetrics[ i ].pcName, pcName ) == 0 )
+        {
+            pxFound = &( pxMetrics[ i ] );
+            break;
+        }
+    }
+
+    return pxFound;
+}
+
+static void prvCheckNumber( const SimMetric_t * pxMetrics,
+                            uint32_t ulNumMetrics,
+                            const char * pcName,
+                            uint64_t ullExpected )
+{
+    const SimMetric_t * pxMetric = prvFindMetric( pxMetrics, ulNumMetrics, pcName );
+
+    printf( "  %-15s %llu\n", pcName, ( pxMetric != NULL ) ? ( unsigned long long ) pxMetric->pullValues[ 0 ] : 0ULL );
+    prvCheck( ( pxMetric != NULL ) && ( pxMetric->xType == SimNumber ) &&
+              ( pxMetric->pullValues[ 0 ] == ullExpected ), pcName );
+}
+
+static void prvCheckLatency( const SimMetric_t * pxMetrics,
+                             uint32_t ulNumMetrics,
+                             const char * pcName,
+                             const CustomMetricsLatency_t * pxExpected )
+{
+    const SimMetric_t * pxMetric = prvFindMetric( pxMetrics, ulNumMetrics, pcName );
+    bool xOk = ( pxMetric != NULL ) && ( pxMetric->xType == SimNumberList ) && ( pxMetric->ulNumValues == 4U );
+
+    if( xOk )
+    {
+        printf( "  %-15s [ %llu, %llu, %llu, %llu ]\n", pcName,
+                ( unsigned long long ) pxMetric->pullValues[ 0 ], ( unsigned long long ) pxMetric->pullValues[ 1 ],
+                ( unsigned long long ) pxMetric->pullValues[ 2 ], ( unsigned long long ) pxMetric->pullValues[ 3 ] );
+
+        xOk = ( pxMetric->pullValues[ 0 ] == pxExpected->ulP50Ms ) &&
+              ( pxMetric->pullValues[ 1 ] == pxExpected->ulP90Ms ) &&
+              ( pxMetric->pullValues[ 2 ] == pxExpected->ulP99Ms ) &&
+              ( pxMetric->pullValues[ 3 ] == pxExpected->ulMaxMs );
+    }
+
+    prvCheck( xOk, pcName );
+}
+
+static void prvCheckReport( void )
+{
+    static const char * const ppcTasks[] =
+    {
+        "IDLE:61.2", "MQTTAgent:20.1", "MxDataplane:9.9", "EnvSense:5.0", "Shadow:2.0", "AWSDefender:0.9"
+    };
+    static SimMetric_t pxMetrics[ SIM_MAX_DECODED ];
+    uint8_t pucReport[ SIM_REPORT_MAX ];
+    size_t xNeeded = 0;
+    size_t xLen;
+    uint32_t ulNumMetrics;
+    const SimMetric_t * pxTasks;
+
+    prvFillMetrics();
+
+    ( void ) xDefenderReportEncode( NULL, 0, 42U, NULL, 0, pxSimCustomCollectors, 1, &xNeeded );
+    xLen = xDefenderReportEncode( pucReport, sizeof( pucReport ), 42U, NULL, 0, pxSimCustomCollectors, 1, &xNeeded );
+
+    printf( "report %lu bytes, size pass %lu bytes\n", ( unsigned long ) xLen, ( unsigned long ) xNeeded );
+    prvCheck( ( xLen > 0 ) && ( xLen == xNeeded ), "size pass matches the encoded length" );
+
+    ulNumMetrics = prvDecodeReport( pucReport, xLen, pxMetrics );
+    prvCheck( ulNumMetrics == 12U, "report decodes with 12 custom metrics" );
+
+    prvCheckNumber( pxMetrics, ulNumMetrics, "heap_min_free", 23456U );
+
+    pxTasks = prvFindMetric( pxMetrics, ulNumMetrics, "task_cpu" );
+    prvCheck( ( pxTasks != NULL ) && ( pxTasks->xType == SimStringList ) &&
+              ( pxTasks->ulNumValues == CUSTOM_METRICS_TASKS_MAX ), "task_cpu" );
+
+    for( uint32_t i = 0; ( pxTasks != NULL ) && ( i < pxTasks->ulNumValues ) && ( i < CUSTOM_METRICS_TASKS_MAX ); i++ )
+    {
+        printf( "  %-15s %s\n", ( i == 0 ) ? "task_cpu" : "", pxTasks->pcValues[ i ] );
+        prvCheck( strcmp( pxTasks->pcValues[ i ], ppcTasks[ i ] ) == 0, "task_cpu entry" );
+    }
+
+    prvCheckNumber( pxMetrics, ulNumMetrics, "mqtt_pub_count", 300U );
+    prvCheckLatency( pxMetrics, ulNumMetrics, "mqtt_pub_ms", &( xSimMetrics.xPublishLatency ) );
+    prvCheckNumber( pxMetrics, ulNumMetrics, "mx_spi_errors", 3U );
+    prvCheckNumber( pxMetrics, ulNumMetrics, "mx_spi_drops", 17U );
+    prvCheckNumber( pxMetrics, ulNumMetrics, "lfs_erases", 12U );
+    prvCheckNumber( pxMetrics, ulNumMetrics, "lfs_prog_bytes", 49152U );
+    prvCheckNumber( pxMetrics, ulNumMetrics, "lfs_errors", 0U );
+    prvCheckNumber( pxMetrics, ulNumMetrics, "tls_hs_count", 1U );
+    prvCheckNumber( pxMetrics, ulNumMetrics, "tls_hs_fail", 1U );
+    prvCheckLatency( pxMetrics, ulNumMetrics, "tls_hs_ms", &( xSimMetrics.xHandshakeLatency ) );
+
+    /* Without samples or a file system the optional metrics are left out */
+    ( void ) memset( &( xSimMetrics.xPublishLatency ), 0, sizeof( CustomMetricsLatency_t ) );
+    ( void ) memset( &( xSimMetrics.xHandshakeLatency ), 0, sizeof( CustomMetricsLatency_t ) );
+    xSimMetrics.xHasFs = false;
+
+    xLen = xDefenderReportEncode( pucReport, sizeof( pucReport ), 43U, NULL, 0, pxSimCustomCollectors, 1, &xNeeded );
+    ulNumMetrics = prvDecodeReport( pucReport, xLen, pxMetrics );
+
+    printf( "idle report %lu bytes, %lu custom metrics\n", ( unsigned long ) xLen, ( unsigned long ) ulNumMetrics );
+    prvCheck( ulNumMetrics == 7U, "idle report decodes with 7 custom metrics" );
+    prvCheck( prvFindMetric( pxMetrics, ulNumMetrics, "mqtt_pub_ms" ) == NULL, "mqtt_pub_ms omitted" );
+    prvCheck( prvFindMetric( pxMetrics, ulNumMetrics, "lfs_erases" ) == NULL, "lfs_* omitted" );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvMeasureCost( uint32_t ulIterations )
+{
+    LatencyHist_t xHist;
+    uint8_t pucReport[ SIM_REPORT_MAX ];
+    size_t xNeeded = 0;
+    double dSummarizeUs = 0;
+    double dEncodeUs = 0;
+
+    ( void ) memset( &xHist, 0, sizeof( xHist ) );
+
+    for( uint32_t i = 0; i < SIM_SAMPLES; i++ )
+    {
+        vLatencyHistRecord( &xHist, prvSampleLongTail() );
+    }
+
+    prvFillMetrics();
+
+    for( uint32_t i = 0; i < ulIterations; i++ )
+    {
+        double dStart = prvNowUs();
+
+        vCustomMetricsSetLatency( &( xSimMetrics.xPublishLatency ), &xHist );
+        vCustomMetricsSetLatency( &( xSimMetrics.xHandshakeLatency ), &xHist );
+        dSummarizeUs += prvNowUs() - dStart;
+
+        dStart = prvNowUs();
+        ( void ) xDefenderReportEncode( NULL, 0, i, NULL, 0, pxSimCustomCollectors, 1, &xNeeded );
+        ( void ) xDefenderReportEncode( pucReport, sizeof( pucReport ), i, NULL, 0, pxSimCustomCollectors, 1, &xNeeded );
+        dEncodeUs += prvNowUs() - dStart;
+    }
+
+    printf( "summarize_us %.3f  encode_us %.3f (size and encode pass, %lu bytes)\n",
+            dSummarizeUs / ulIterations, dEncodeUs / ulIterations, ( unsigned long ) xNeeded );
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    uint32_t ulIterations = 10000U;
+
+    if( argc > 1 )
+    {
+        ulIterations = ( uint32_t ) strtoul( argv[ 1 ], NULL, 10 );
+    }
+
+    if( ulIterations == 0 )
+    {
+        ulIterations = 1;
+    }
+
+    printf( "%-10s  %s\n", "latency", "exact / reported percentiles in ms" );
+    prvCheckPercentiles( "uniform", prvSampleUniform );
+    prvCheckPercentiles( "bimodal", prvSampleBimodal );
+    prvCheckPercentiles( "long_tail", prvSampleLongTail );
+
+    prvCheckReport();
+    prvMeasureCost( ulIterations );
+
+    printf( "%s (%lu failures)\n", ( ulFailures == 0 ) ? "PASS" : "FAIL", ( unsigned long ) ulFailures );
+
+    return ( ulFailures == 0 ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,561 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+/*
+ * Host benchmark of the Device Defender report encoder with 1 to 200 TCP
+ * connections.
+ *
+ * The metrics collectors are replaced by collectors encoding a simulated
+ * device (2 listening TCP ports, 3 UDP ports and N established connections)
+ * in the same layout as metrics_collector_lwip.c. Each report is built the
+ * way vDefenderAgentTask() does: a size pass, an allocation of exactly that
+ * size and an encode pass. For each connection count it prints:
+ *   report_B  size of the encoded report
+ *   fixed     whether the report fits the former 1024 byte stack buffer
+ *   peak_B    peak heap used while building one report
+ *   size_us   time of the size pass
+ *   enc_us    time of the encode pass
+ *
+ * With -c a connection is opened between the size pass and the encode pass of
+ * every report, exercising the retry when the report grows.
+ *
+ * With -l it instead models how long the TCPIP core lock is held to collect
+ * the established connections from a list of simulated PCBs:
+ *   encode_us    count the list, then encode each PCB, as the collectors
+ *                did before vMetricsCollectorSnapshot()
+ *   snapshot_us  copy each PCB into the snapshot array
+ * On target the snapshot is timed by the "metrics_snapshot" perf site.
+ *
+ * Build and run from the repository root, with the tinycbor submodule:
+ *   cc -O2 -ICommon/app/defender -IMiddleware/tinycbor/src tools/defender_report_bench.c \
+ *      Common/app/defender/defender_report.c Middleware/tinycbor/src/cborencoder.c \
+ *      Middleware/tinycbor/src/cborencoder_close_container_checked.c -o defender_report_bench
+ *   ./defender_report_bench [-c|-l] [iterations]
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "defender_report.h"
+
+#define SIM_NETIF_NAME          "mx0"
+#define SIM_TCP_PORTS           2U
+#define SIM_UDP_PORTS           3U
+#define SIM_FIXED_BUFFER        1024U /* Former REPORT_BUFFER_SIZE */
+#define SIM_ENCODE_ATTEMPTS     3U    /* REPORT_ENCODE_ATTEMPTS */
+#define SIM_ADDR_STR_LEN        ( 46U + 1U + 5U + 1U )
+
+static const uint32_t pulConnectionCounts[] = { 1, 2, 5, 10, 20, 50, 100, 150, 200 };
+
+static uint32_t ulSimConnections = 0;
+static size_t xHeapUsed = 0;
+static size_t xHeapPeak = 0;
+static uint32_t ulRetries = 0;
+
+/* The fields of struct tcp_pcb read by the collector, spread over a PCB sized
+ * node as they are in lwIP. */
+typedef struct SimPcb
+{
+    struct SimPcb * pxNext;
+    uint8_t pucOther[ 120 ];
+    uint32_t ulRemoteIp;
+    uint16_t usRemotePort;
+    uint16_t usLocalPort;
+    uint8_t ucNetifIdx;
+} SimPcb_t;
+
+typedef struct
+{
+    uint32_t ulRemoteIp;
+    uint16_t usRemotePort;
+    uint16_t usLocalPort;
+    uint8_t ucNetifIdx;
+} SimConnection_t;
+
+/*-----------------------------------------------------------*/
+
+static void * prvAlloc( size_t xSize )
+{
+    size_t * pxBlock = malloc( sizeof( size_t ) + xSize );
+
+    if( pxBlock != NULL )
+    {
+        pxBlock[ 0 ] = xSize;
+        xHeapUsed += xSize;
+
+        if( xHeapUsed > xHeapPeak )
+        {
+            xHeapPeak = xHeapUsed;
+        }
+
+        pxBlock++;
+    }
+
+    return pxBlock;
+}
+
+static void prvFree( void * pvBlock )
+{
+    size_t * pxBlock = ( size_t * ) pvBlock - 1;
+
+    xHeapUsed -= pxBlock[ 0 ];
+    free( pxBlock );
+}
+
+static double prvNowUs( void )
+{
+    struct timespec xNow;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &xNow );
+
+    return ( ( double ) xNow.tv_sec * 1e6 ) + ( ( double ) xNow.tv_nsec / 1e3 );
+}
+
+/*-----------------------------------------------------------*/
+
+static CborError prvAddKvUint( CborEncoder * pxEncoder,
+                               const char * pcKey,
+                               uint64_t xUInt )
+{
+    CborError xError = cbor_encode_text_stringz( pxEncoder, pcKey );
+
+    xError |= cbor_encode_uint( pxEncoder, xUInt );
+
+    return xError;
+}
+
+static CborError prvAddKvStr( CborEncoder * pxEncoder,
+                              const char * pcKey,
+                              const char * pcValue )
+{
+    CborError xError = cbor_encode_text_stringz( pxEncoder, pcKey );
+
+    xError |= cbor_encode_text_stringz( pxEncoder, pcValue );
+
+    return xError;
+}
+
+static CborError prvSimNetworkStats( CborEncoder * pxEncoder )
+{
+    CborEncoder xNSEncoder;
+    CborError xError = cbor_encode_text_stringz( pxEncoder, "ns" );
+
+    xError |= cbor_encoder_create_map( pxEncoder, &xNSEncoder, 4 );
+
+    if( METRICS_CBOR_OK( xError ) )
+    {
+        xError |= prvAddKvUint( &xNSEncoder, "pi", 1843211U );
+        xError |= prvAddKvUint( &xNSEncoder, "po", 1523391U );
+        xError |= prvAddKvUint( &xNSEncoder, "bi", 912334117U );
+        xError |= prvAddKvUint( &xNSEncoder, "bo", 304112873U );
+        xError |= cbor_encoder_close_container( pxEncoder, &xNSEncoder );
+    }
+
+    return xError;
+}
+
+static CborError prvSimPorts( CborEncoder * pxEncoder,
+                              const char * pcKey,
+                              uint32_t ulPorts,
+                              uint16_t usFirstPort )
+{
+    CborEncoder xPortsEncoder;
+    CborEncoder xListEncoder;
+    CborError xError = cbor_encode_text_stringz( pxEncoder, pcKey );
+
+    xError |= cbor_encoder_create_map( pxEncoder, &xPortsEncoder, ( ulPorts > 0 ) ? 2 : 1 );
+    xError |= prvAddKvUint( &xPortsEncoder, "t", ulPorts );
+
+    if( METRICS_CBOR_OK( xError ) && ( ulPorts > 0 ) )
+    {
+        xError |= cbor_encode_text_stringz( &xPortsEncoder, "pts" );
+        xError |= cbor_encoder_create_array( &xPortsEncoder, &xListEncoder, ulPorts );
+
+        for( uint32_t i = 0; ( i < ulPorts ) && METRICS_CBOR_OK( xError ); i++ )
+        {
+            CborEncoder xPTEncoder;
+
+            xError |= cbor_encoder_create_map( &xListEncoder, &xPTEncoder, 2 );
+            xError |= prvAddKvStr( &xPTEncoder, "if", SIM_NETIF_NAME );
+            xError |= prvAddKvUint( &xPTEncoder, "pt", usFirstPort + i );
+            xError |= cbor_encoder_close_container( &xListEncoder, &xPTEncoder );
+        }
+
+        xError |= cbor_encoder_close_container( &xPortsEncoder, &xListEncoder );
+    }
+
+    if( METRICS_CBOR_OK( xError ) )
+    {
+        xError |= cbor_encoder_close_container( pxEncoder, &xPortsEncoder );
+    }
+
+    return xError;
+}
+
+static CborError prvSimTcpPorts( CborEncoder * pxEncoder )
+{
+    return prvSimPorts( pxEncoder, "tp", SIM_TCP_PORTS, 80 );
+}
+
+static CborError prvSimUdpPorts( CborEncoder * pxEncoder )
+{
+    return prvSimPorts( pxEncoder, "up", SIM_UDP_PORTS, 5353 );
+}
+
+static CborError prvSimConnections( CborEncoder * pxEncoder )
+{
+    CborEncoder xTCEncoder;
+    CborEncoder xECEncoder;
+    CborEncoder xCSEncoder;
+    uint32_t ulConnCount = ulSimConnections;
+    CborError xError = cbor_encode_text_stringz( pxEncoder, "tc" );
+
+    xError |= cbor_encoder_create_map( pxEncoder, &xTCEncoder, 1 );
+    xError |= cbor_encode_text_stringz( &xTCEncoder, "ec" );
+    xError |= cbor_encoder_create_map( &xTCEncoder, &xECEncoder, ( ulConnCount > 0 ) ? 2 : 1 );
+    xError |= prvAddKvUint( &xECEncoder, "t", ulConnCount );
+
+    if( METRICS_CBOR_OK( xError ) && ( ulConnCount > 0 ) )
+    {
+        xError |= cbor_encode_text_stringz( &xECEncoder, "cs" );
+        xError |= cbor_encoder_create_array( &xECEncoder, &xCSEncoder, ulConnCount );
+
+        for( uint32_t i = 0; ( i < ulConnCount ) && METRICS_CBOR_OK( xError ); i++ )
+        {
+            CborEncoder xCEncoder;
+            char pcRemote[ SIM_ADDR_STR_LEN ];
+
+            ( void ) snprintf( pcRemote, sizeof( pcRemote ), "%u.%u.%u.%u:%u",
+                               52U, 94U + ( i % 3U ), ( i * 7U ) % 256U, ( i * 13U ) % 256U,
+                               ( i % 4U ) ? 8883U : 443U );
+
+            xError |= cbor_encoder_create_map( &xCSEncoder, &xCEncoder, 3 );
+            xError |= prvAddKvStr( &xCEncoder, "rad", pcRemote );
+            xError |= prvAddKvStr( &xCEncoder, "li", SIM_NETIF_NAME );
+            xError |= prvAddKvUint( &xCEncoder, "lp", 49152U + i );
+            xError |= cbor_encoder_close_container( &xCSEncoder, &xCEncoder );
+        }
+
+        xError |= cbor_encoder_close_container( &xECEncoder, &xCSEncoder );
+    }
+
+    if( METRICS_CBOR_OK( xError ) )
+    {
+        xError |= cbor_encoder_close_container( &xTCEncoder, &xECEncoder );
+        xError |= cbor_encoder_close_container( pxEncoder, &xTCEncoder );
+    }
+
+    return xError;
+}
+
+static const MetricsCollectorFn_t pxSimCollectors[] =
+{
+    prvSimNetworkStats,
+    prvSimTcpPorts,
+    prvSimUdpPorts,
+    prvSimConnections
+};
+
+/*-----------------------------------------------------------*/
+
+/* Mirrors prvBuildDeviceMetricsReport() in defender_task.c. */
+static uint8_t * prvBuildReport( uint64_t ullReportId,
+                                 bool xChurn,
+                                 size_t * pxReportLen,
+                                 double * pdSizeUs,
+                                 double * pdEncodeUs )
+{
+    const size_t xNumCollectors = sizeof( pxSimCollectors ) / sizeof( pxSimCollectors[ 0 ] );
+    uint8_t * pucReport = NULL;
+    size_t xNeeded = 0;
+    size_t xLen = 0;
+    double dStart = prvNowUs();
+
+    ( void ) xDefenderReportEncode( NULL, 0, ullReportId,
+                                    pxSimCollectors, xNumCollectors, NULL, 0, &xNeeded );
+
+    *pdSizeUs += prvNowUs() - dStart;
+
+    if( xChurn )
+    {
+        ulSimConnections++;
+    }
+
+    for( uint32_t ulAttempt = 0; ( ulAttempt < SIM_ENCODE_ATTEMPTS ) && ( xLen == 0 ) && ( xNeeded > 0 ); ulAttempt++ )
+    {
+        pucReport = prvAlloc( xNeeded );
+
+        if( pucReport == NULL )
+        {
+            xNeeded = 0;
+        }
+        else
+        {
+            dStart = prvNowUs();
+            xLen = xDefenderReportEncode( pucReport, xNeeded, ullReportId,
+                                          pxSimCollectors, xNumCollectors, NULL, 0, &xNeeded );
+            *pdEncodeUs += prvNowUs() - dStart;
+
+            if( xLen == 0 )
+            {
+                ulRetries++;
+                prvFree( pucReport );
+                pucReport = NULL;
+            }
+        }
+    }
+
+    if( xChurn )
+    {
+        ulSimConnections--;
+    }
+
+    *pxReportLen = xLen;
+
+    return pucReport;
+}
+
+/*-----------------------------------------------------------*/
+
+static int prvReportSizes( uint32_t ulIterations,
+                           bool xChurn )
+{
+    int lStatus = EXIT_SUCCESS;
+
+    printf( "%6s %9s %6s %7s %8s %8s%s\n", "conns", "report_B", "fixed", "peak_B",
+            "size_us", "enc_us", xChurn ? "  retries" : "" );
+
+    for( size_t c = 0; c < ( sizeof( pulConnectionCounts ) / sizeof( pulConnectionCounts[ 0 ] ) ); c++ )
+    {
+        size_t xReportLen = 0;
+        double dSizeUs = 0;
+        double dEncodeUs = 0;
+        uint8_t pucFixed[ SIM_FIXED_BUFFER ];
+        size_t xFixedNeeded = 0;
+        size_t xFixedLen;
+
+        ulSimConnections = pulConnectionCounts[ c ];
+        xHeapPeak = 0;
+        ulRetries = 0;
+
+        for( uint32_t i = 0; ( i < ulIterations ) && ( lStatus == EXIT_SUCCESS ); i++ )
+        {
+            uint8_t * pucReport = prvBuildReport( 1000U + i, xChurn, &xReportLen, &dSizeUs, &dEncodeUs );
+
+            if( pucReport == NULL )
+            {
+                fprintf( stderr, "Failed to build a report with %lu connections.\n",
+                         ( unsigned long ) ulSimConnections );
+                lStatus = EXIT_FAILURE;
+            }
+            else
+            {
+                prvFree( pucReport );
+            }
+        }
+
+        if( lStatus != EXIT_SUCCESS )
+        {
+            break;
+        }
+
+        xFixedLen = xDefenderReportEncode( pucFixed, sizeof( pucFixed ), 1000U,
+                                           pxSimCollectors,
+                                           sizeof( pxSimCollectors ) / sizeof( pxSimCollectors[ 0 ] ),
+                                           NULL, 0, &xFixedNeeded );
+
+        printf( "%6lu %9lu %6s %7lu %8.2f %8.2f",
+                ( unsigned long ) ulSimConnections, ( unsigned long ) xReportLen,
+                ( xFixedLen > 0 ) ? "ok" : "FAIL", ( unsigned long ) xHeapPeak,
+                dSizeUs / ulIterations, dEncodeUs / ulIterations );
+
+        if( xChurn )
+        {
+            printf( "  %7lu", ( unsigned long ) ulRetries );
+        }
+
+        printf( "\n" );
+    }
+
+    return lStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static CborError prvEncodePcbs( CborEncoder * pxEncoder,
+                                const SimPcb_t * pxList )
+{
+    CborEncoder xCSEncoder;
+    size_t xCount = 0;
+    CborError xError;
+
+    for( const SimPcb_t * pxPcb = pxList; pxPcb != NULL; pxPcb = pxPcb->pxNext )
+    {
+        xCount++;
+    }
+
+    xError = cbor_encoder_create_array( pxEncoder, &xCSEncoder, xCount );
+
+    for( const SimPcb_t * pxPcb = pxList; ( pxPcb != NULL ) && METRICS_CBOR_OK( xError ); pxPcb = pxPcb->pxNext )
+    {
+        CborEncoder xCEncoder;
+        char pcRemote[ SIM_ADDR_STR_LEN ];
+
+        ( void ) snprintf( pcRemote, sizeof( pcRemote ), "%u.%u.%u.%u:%u",
+                           ( unsigned ) ( pxPcb->ulRemoteIp >> 24 ), ( unsigned ) ( ( pxPcb->ulRemoteIp >> 16 ) & 0xFFU ),
+                           ( unsigned ) ( ( pxPcb->ulRemoteIp >> 8 ) & 0xFFU ), ( unsigned ) ( pxPcb->ulRemoteIp & 0xFFU ),
+                           pxPcb->usRemotePort );
+
+        xError |= cbor_encoder_create_map( &xCSEncoder, &xCEncoder, 3 );
+        xError |= prvAddKvStr( &xCEncoder, "rad", pcRemote );
+        xError |= prvAddKvStr( &xCEncoder, "li", SIM_NETIF_NAME );
+        xError |= prvAddKvUint( &xCEncoder, "lp", pxPcb->usLocalPort );
+        xError |= cbor_encoder_close_container( &xCSEncoder, &xCEncoder );
+    }
+
+    xError |= cbor_encoder_close_container( pxEncoder, &xCSEncoder );
+
+    return xError;
+}
+
+static size_t prvSnapshotPcbs( SimConnection_t * pxSnapshot,
+                               const SimPcb_t * pxList )
+{
+    size_t xCount = 0;
+
+    for( const SimPcb_t * pxPcb = pxList; pxPcb != NULL; pxPcb = pxPcb->pxNext )
+    {
+        pxSnapshot[ xCount ].ulRemoteIp = pxPcb->ulRemoteIp;
+        pxSnapshot[ xCount ].usRemotePort = pxPcb->usRemotePort;
+        pxSnapshot[ xCount ].usLocalPort = pxPcb->usLocalPort;
+        pxSnapshot[ xCount ].ucNetifIdx = pxPcb->ucNetifIdx;
+        xCount++;
+    }
+
+    return xCount;
+}
+
+static int prvLockModel( uint32_t ulIterations )
+{
+    const size_t xMaxConnections = pulConnectionCounts[ ( sizeof( pulConnectionCounts ) / sizeof( pulConnectionCounts[ 0 ] ) ) - 1 ];
+    SimPcb_t * pxPcbs = calloc( xMaxConnections, sizeof( SimPcb_t ) );
+    SimConnection_t * pxSnapshot = calloc( xMaxConnections, sizeof( SimConnection_t ) );
+    uint8_t * pucBuffer = malloc( 64U * xMaxConnections );
+    volatile size_t xSink = 0;
+    int lStatus = EXIT_SUCCESS;
+
+    if( ( pxPcbs == NULL ) || ( pxSnapshot == NULL ) || ( pucBuffer == NULL ) )
+    {
+        lStatus = EXIT_FAILURE;
+    }
+    else
+    {
+        printf( "%6s %10s %12s\n", "conns", "encode_us", "snapshot_us" );
+    }
+
+    for( size_t c = 0; ( c < ( sizeof( pulConnectionCounts ) / sizeof( pulConnectionCounts[ 0 ] ) ) ) && ( lStatus == EXIT_SUCCESS ); c++ )
+    {
+        uint32_t ulConns = pulConnectionCounts[ c ];
+        double dEncodeUs = 0;
+        double dSnapshotUs = 0;
+        double dStart;
+
+        for( uint32_t i = 0; i < ulConns; i++ )
+        {
+            pxPcbs[ i ].pxNext = ( ( i + 1U ) < ulConns ) ? &( pxPcbs[ i + 1U ] ) : NULL;
+            pxPcbs[ i ].ulRemoteIp = 0x345E0000U + ( i * 7919U );
+            pxPcbs[ i ].usRemotePort = ( i % 4U ) ? 8883U : 443U;
+            pxPcbs[ i ].usLocalPort = ( uint16_t ) ( 49152U + i );
+        }
+
+        for( uint32_t i = 0; i < ulIterations; i++ )
+        {
+            CborEncoder xEncoder;
+
+            dStart = prvNowUs();
+            cbor_encoder_init( &xEncoder, pucBuffer, 64U * xMaxConnections, 0 );
+            xSink += ( size_t ) prvEncodePcbs( &xEncoder, pxPcbs );
+            dEncodeUs += prvNowUs() - dStart;
+
+            dStart = prvNowUs();
+            xSink += prvSnapshotPcbs( pxSnapshot, pxPcbs );
+            dSnapshotUs += prvNowUs() - dStart;
+        }
+
+        printf( "%6lu %10.2f %12.3f\n", ( unsigned long ) ulConns,
+                dEncodeUs / ulIterations, dSnapshotUs / ulIterations );
+    }
+
+    free( pucBuffer );
+    free( pxSnapshot );
+    free( pxPcbs );
+
+    return lStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    bool xChurn = false;
+    bool xLockModel = false;
+    uint32_t ulIterations = 2000;
+    int lStatus;
+
+    for( int i = 1; i < argc; i++ )
+    {
+        if( strcmp( argv[ i ], "-c" ) == 0 )
+        {
+            xChurn = true;
+        }
+        else if( strcmp( argv[ i ], "-l" ) == 0 )
+        {
+            xLockModel = true;
+        }
+        else
+        {
+            ulIterations = ( uint32_t ) strtoul( argv[ i ], NULL, 10 );
+        }
+    }
+
+    if( ulIterations == 0 )
+    {
+        ulIterations = 1;
+    }
+
+    if( xLockModel )
+    {
+        lStatus = prvLockModel( ulIterations );
+    }
+    else
+    {
+        lStatus = prvReportSizes( ulIterations, xChurn );
+    }
+
+    return lStatus;
+}
@@ -0,0 +1,636 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+/*
+ * Host test of the heap allocation tracker in Common/sys/heap_trace.c.
+ *
+ * The kernel heap is replaced by a first fit allocator which lays out its
+ * blocks like heap_4, so that vHeapTraceWalk can walk them, and calls the
+ * traceMALLOC / traceFREE hooks the same way: traceMALLOC with the size it
+ * asked for and traceFREE with the size of the block. Checks:
+ * 1. Attribution: direct pvPortMalloc callers and callers of a wrapper using
+ *    pvPortMallocFromCaller are each recorded as their own site.
+ * 2. Model: random allocations and frees from a set of callers, compared
+ *    with the live blocks and bytes expected for every site.
+ * 3. Limits: blocks beyond the table load are counted as untracked, callers
+ *    beyond HEAP_TRACE_MAX_SITES are accounted to site 0, and failures and
+ *    vHeapTraceReset are counted as documented.
+ * 4. Walk: the free block summary matches the allocator's own.
+ * 5. Unsplit: a block handed out whole, larger than asked for, is counted
+ *    at its block size when it is allocated and when it is freed.
+ *
+ * Exits with a failure status if any check fails.
+ *
+ * Build and run from the repository root:
+ *   cc -O2 -DHEAP_TRACE_ENABLED=1 -Itools/host -ICommon/include tools/heap_trace_test.c Common/sys/heap_trace.c \
+ *      tools/host/host_kernel.c -lpthread -o heap_trace_test
+ *   ./heap_trace_test [operations]
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "heap_trace.h"
+
+#define TEST_CALLERS          20U
+#define TEST_MAX_LIVE         600U
+#define TEST_MAX_SIZE         512U
+#define TEST_CALLER_BASE      0x08010000UL
+
+/* Same layout as the heap_4 block header */
+typedef struct TestBlock
+{
+    struct TestBlock * pxNextFreeBlock;
+    size_t xBlockSize;
+} TestBlock_t;
+
+#define TEST_ALLOCATED_BIT    ( ( ( size_t ) 1 ) << ( ( sizeof( size_t ) * 8 ) - 1 ) )
+#define TEST_HEADER_SIZE      ( ( sizeof( TestBlock_t ) + portBYTE_ALIGNMENT_MASK ) & ~( ( size_t ) portBYTE_ALIGNMENT_MASK ) )
+
+typedef struct
+{
+    void * pvBlock;
+    uint32_t ulCaller;
+    size_t xBlockSize;
+} TestLive_t;
+
+extern uint8_t ucHeap[ configTOTAL_HEAP_SIZE ];
+
+static uint32_t ulFailures = 0;
+
+/* Return address seen by the last pvPortMalloc call */
+static const void * pvLastReturn = NULL;
+
+/* Return address seen by the last prvWrapperMalloc call */
+static const void * pvWrapperCaller = NULL;
+
+/*-----------------------------------------------------------*/
+
+static void prvCheck( bool xCondition,
+                      const char * pcWhat )
+{
+    if( !xCondition )
+    {
+        printf( "FAIL: %s\n", pcWhat );
+        ulFailures++;
+    }
+}
+
+static TestBlock_t * prvNextBlock( TestBlock_t * pxBlock )
+{
+    return ( TestBlock_t * ) ( ( uint8_t * ) pxBlock + ( pxBlock->xBlockSize & ~TEST_ALLOCATED_BIT ) );
+}
+
+/* One free block spanning the heap, followed by an end marker of size 0 */
+static void prvHeapInit( void )
+{
+    TestBlock_t * pxFirst = ( TestBlock_t * ) ucHeap;
+
+    ( void ) memset( ucHeap, 0, sizeof( ucHeap ) );
+    pxFirst->xBlockSize = configTOTAL_HEAP_SIZE - TEST_HEADER_SIZE;
+}
+
+static void prvHeapMerge( void )
+{
+    TestBlock_t * pxBlock = ( TestBlock_t * ) ucHeap;
+
+    while( pxBlock->xBlockSize != 0 )
+    {
+        TestBlock_t * pxNext = prvNextBlock( pxBlock );
+
+        if( ( ( pxBlock->xBlockSize & TEST_ALLOCATED_BIT ) == 0 ) &&
+            ( pxNext->xBlockSize != 0 ) &&
+            ( ( pxNext->xBlockSize & TEST_ALLOCATED_BIT ) == 0 ) )
+        {
+            pxBlock->xBlockSize += pxNext->xBlockSize;
+        }
+        else
+        {
+            pxBlock = pxNext;
+        }
+    }
+}
+
+void * pvPortMalloc( size_t xWantedSize )
+{
+    void * pvReturn = NULL;
+    size_t xBlockSize = 0;
+
+    pvLastReturn = __builtin_return_address( 0 );
+
+    vTaskSuspendAll();
+    {
+        TestBlock_t * pxBlock = ( TestBlock_t * ) ucHeap;
+
+        if( ( xWantedSize > 0 ) && ( xWantedSize < configTOTAL_HEAP_SIZE ) )
+        {
+            xBlockSize = TEST_HEADER_SIZE + ( ( xWantedSize + portBYTE_ALIGNMENT_MASK ) & ~( ( size_t ) portBYTE_ALIGNMENT_MASK ) );
+
+            while( ( pxBlock->xBlockSize != 0 ) &&
+                   ( ( ( pxBlock->xBlockSize & TEST_ALLOCATED_BIT ) != 0 ) || ( pxBlock->xBlockSize < xBlockSize ) ) )
+            {
+                pxBlock = prvNextBlock( pxBlock );
+            }
+        }
+
+        if( ( xBlockSize > 0 ) && ( pxBlock->xBlockSize != 0 ) )
+        {
+            /* Split as heap_4 does when the remainder can hold a block */
+            if( ( pxBlock->xBlockSize - xBlockSize ) > ( TEST_HEADER_SIZE << 1 ) )
+            {
+                TestBlock_t * pxRest = ( TestBlock_t * ) ( ( uint8_t * ) pxBlock + xBlockSize );
+
+                pxRest->pxNextFreeBlock = NULL;
+                pxRest->xBlockSize = pxBlock->xBlockSize - xBlockSize;
+                pxBlock->xBlockSize = xBlockSize;
+            }
+
+            pxBlock->xBlockSize |= TEST_ALLOCATED_BIT;
+            pvReturn = ( uint8_t * ) pxBlock + TEST_HEADER_SIZE;
+        }
+
+        /* Like heap_4, the size asked for rather than the size of the block */
+        traceMALLOC( pvReturn, xBlockSize );
+    }
+    ( void ) xTaskResumeAll();
+
+    return pvReturn;
+}
+
+void vPortFree( void * pv )
+{
+    if( pv != NULL )
+    {
+        TestBlock_t * pxBlock = ( TestBlock_t * ) ( ( uint8_t * ) pv - TEST_HEADER_SIZE );
+
+        configASSERT( ( pxBlock->xBlockSize & TEST_ALLOCATED_BIT ) != 0 );
+
+        vTaskSuspendAll();
+        {
+            pxBlock->xBlockSize &= ~TEST_ALLOCATED_BIT;
+            traceFREE( pv, pxBlock->xBlockSize );
+            prvHeapMerge();
+        }
+        ( void ) xTaskResumeAll();
+    }
+}
+
+static size_t prvBlockSize( const void * pv )
+{
+    const TestBlock_t * pxBlock = ( const TestBlock_t * ) ( ( const uint8_t * ) pv - TEST_HEADER_SIZE );
+
+    return pxBlock->xBlockSize & ~TEST_ALLOCATED_BIT;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvFindSite( const void * pvCaller,
+                         HeapTraceSite_t * pxSite )
+{
+    bool xFound = false;
+
+    for( uint32_t i = 0; !xFound && ( ulHeapTraceGetSite( i, pxSite ) != 0 ); i++ )
+    {
+        xFound = ( pxSite->pvCaller == pvCaller );
+    }
+
+    return xFound;
+}
+
+static void prvFreeAll( void ** ppvBlocks,
+                        uint32_t ulNumBlocks )
+{
+    for( uint32_t i = 0; i < ulNumBlocks; i++ )
+    {
+        vPortFree( ppvBlocks[ i ] );
+        ppvBlocks[ i ] = NULL;
+    }
+}
+
+/* Each call site must keep its own return address, so the helpers below are
+ * neither inlined, cloned nor merged */
+#if defined( __clang__ )
+#define TEST_CALL_SITE    __attribute__( ( noinline ) )
+#else
+#define TEST_CALL_SITE    __attribute__( ( noipa ) )
+#endif
+
+static TEST_CALL_SITE void * prvAllocA( const void ** ppvCaller )
+{
+    void * pvBlock = pvPortMalloc( 100 );
+
+    *ppvCaller = pvLastReturn;
+
+    return pvBlock;
+}
+
+static TEST_CALL_SITE void * prvAllocB( const void ** ppvCaller )
+{
+    void * pvBlock = pvPortMalloc( 40 );
+
+    *ppvCaller = pvLastReturn;
+
+    return pvBlock;
+}
+
+/* Stands in for wrappers such as malloc and mbedtls_platform_calloc */
+static TEST_CALL_SITE void * prvWrapperMalloc( size_t xSize )
+{
+    pvWrapperCaller = __builtin_return_address( 0 );
+
+    return pvPortMallocFromCaller( xSize );
+}
+
+static TEST_CALL_SITE void * prvUseWrapperC( void )
+{
+    void * pvBlock = prvWrapperMalloc( 64 );
+
+    __asm volatile ( "" ::: "memory" );
+
+    return pvBlock;
+}
+
+static TEST_CALL_SITE void * prvUseWrapperD( void )
+{
+    void * pvBlock = prvWrapperMalloc( 96 );
+
+    __asm volatile ( "" ::: "memory" );
+
+    return pvBlock;
+}
+
+static void prvTestAttribution( void )
+{
+    void * pvBlocks[ 7 ] = { NULL };
+    const void * pvCallerA = NULL;
+    const void * pvCallerB = NULL;
+    const void * pvCallerC = NULL;
+    const void * pvCallerD = NULL;
+    const void * pvInsideWrapper = NULL;
+    size_t xBlockSizeA;
+    HeapTraceSite_t xSite;
+
+    vHeapTraceReset();
+
+    for( uint32_t i = 0; i < 3; i++ )
+    {
+        pvBlocks[ i ] = prvAllocA( &pvCallerA );
+    }
+
+    for( uint32_t i = 3; i < 5; i++ )
+    {
+        pvBlocks[ i ] = prvAllocB( &pvCallerB );
+    }
+
+    pvBlocks[ 5 ] = prvUseWrapperC();
+    pvCallerC = pvWrapperCaller;
+    pvInsideWrapper = pvLastReturn;
+    pvBlocks[ 6 ] = prvUseWrapperD();
+    pvCallerD = pvWrapperCaller;
+
+    prvCheck( pvCallerA != pvCallerB, "direct callers have distinct return addresses" );
+    prvCheck( pvCallerC != pvCallerD, "wrapper callers have distinct return addresses" );
+
+    prvCheck( prvFindSite( pvCallerA, &xSite ) &&
+              ( xSite.ulAllocs == 3 ) && ( xSite.ulLiveBlocks == 3 ) &&
+              ( xSite.ulLiveBytes == ( 3 * prvBlockSize( pvBlocks[ 0 ] ) ) ), "direct caller A" );
+    prvCheck( prvFindSite( pvCallerB, &xSite ) &&
+              ( xSite.ulAllocs == 2 ) && ( xSite.ulLiveBlocks == 2 ) &&
+              ( xSite.ulLiveBytes == ( 2 * prvBlockSize( pvBlocks[ 3 ] ) ) ), "direct caller B" );
+    prvCheck( prvFindSite( pvCallerC, &xSite ) && ( xSite.ulLiveBlocks == 1 ), "wrapper caller C" );
+    prvCheck( prvFindSite( pvCallerD, &xSite ) && ( xSite.ulLiveBlocks == 1 ), "wrapper caller D" );
+    prvCheck( !prvFindSite( pvInsideWrapper, &xSite ), "wrapper itself is not recorded" );
+
+    xBlockSizeA = prvBlockSize( pvBlocks[ 0 ] );
+    prvFreeAll( pvBlocks, 7 );
+
+    prvCheck( prvFindSite( pvCallerA, &xSite ) &&
+              ( xSite.ulLiveBlocks == 0 ) && ( xSite.ulLiveBytes == 0 ) &&
+              ( xSite.ulPeakBytes == ( 3 * xBlockSizeA ) ), "caller A released" );
+    prvCheck( prvFindSite( pvCallerC, &xSite ) && ( xSite.ulLiveBlocks == 0 ), "wrapper caller C released" );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvCheckModel( const uint32_t * pulLiveBlocks,
+                           const uint32_t * pulLiveBytes )
+{
+    HeapTraceStats_t xStats;
+    uint32_t ulTotalBytes = 0;
+    bool xSitesMatch = true;
+
+    for( uint32_t i = 0; i < TEST_CALLERS; i++ )
+    {
+        HeapTraceSite_t xSite;
+        bool xFound = prvFindSite( ( const void * ) ( TEST_CALLER_BASE + ( 4UL * i ) ), &xSite );
+
+        if( pulLiveBlocks[ i ] > 0 )
+        {
+            xSitesMatch = xSitesMatch && xFound &&
+                          ( xSite.ulLiveBlocks == pulLiveBlocks[ i ] ) &&
+                          ( xSite.ulLiveBytes == pulLiveBytes[ i ] ) &&
+                          ( xSite.ulPeakBytes >= xSite.ulLiveBytes );
+        }
+        else
+        {
+            xSitesMatch = xSitesMatch && ( !xFound || ( ( xSite.ulLiveBlocks == 0 ) && ( xSite.ulLiveBytes == 0 ) ) );
+        }
+
+        ulTotalBytes += pulLiveBytes[ i ];
+    }
+
+    vHeapTraceGetStats( &xStats );
+
+    prvCheck( xSitesMatch, "model: per site live blocks and bytes" );
+    prvCheck( xStats.ulLiveBytes == ulTotalBytes, "model: total live bytes" );
+    prvCheck( xStats.ulPeakBytes >= xStats.ulLiveBytes, "model: peak bytes" );
+}
+
+static void prvTestModel( uint32_t ulOperations )
+{
+    static TestLive_t xLive[ TEST_MAX_LIVE ];
+    uint32_t pulLiveBlocks[ TEST_CALLERS ] = { 0 };
+    uint32_t pulLiveBytes[ TEST_CALLERS ] = { 0 };
+    uint32_t ulNumLive = 0;
+    uint32_t ulFailuresBefore = ulFailures;
+
+    vHeapTraceReset();
+    srand( 1 );
+
+    for( uint32_t ulOp = 0; ( ulOp < ulOperations ) && ( ulFailures == ulFailuresBefore ); ulOp++ )
+    {
+        bool xAlloc = ( ulNumLive == 0 ) || ( ( ulNumLive < TEST_MAX_LIVE ) && ( ( rand() % 100 ) < 55 ) );
+
+        if( xAlloc )
+        {
+            uint32_t ulCaller = ( uint32_t ) rand() % TEST_CALLERS;
+            void * pvBlock = pvHeapTraceMallocFrom( 1 + ( ( size_t ) rand() % TEST_MAX_SIZE ),
+                                                    ( const void * ) ( TEST_CALLER_BASE + ( 4UL * ulCaller ) ) );
+
+            if( pvBlock != NULL )
+            {
+                xLive[ ulNumLive ].pvBlock = pvBlock;
+                xLive[ ulNumLive ].ulCaller = ulCaller;
+                xLive[ ulNumLive ].xBlockSize = prvBlockSize( pvBlock );
+                pulLiveBlocks[ ulCaller ]++;
+                pulLiveBytes[ ulCaller ] += ( uint32_t ) xLive[ ulNumLive ].xBlockSize;
+                ulNumLive++;
+            }
+        }
+        else
+        {
+            uint32_t ulIndex = ( uint32_t ) rand() % ulNumLive;
+            TestLive_t * pxLive = &( xLive[ ulIndex ] );
+
+            pulLiveBlocks[ pxLive->ulCaller ]--;
+            pulLiveBytes[ pxLive->ulCaller ] -= ( uint32_t ) pxLive->xBlockSize;
+            vPortFree( pxLive->pvBlock );
+
+            ulNumLive--;
+            xLive[ ulIndex ] = xLive[ ulNumLive ];
+        }
+
+        if( ( ulOp % 97 ) == 0 )
+        {
+            prvCheckModel( pulLiveBlocks, pulLiveBytes );
+        }
+    }
+
+    prvCheckModel( pulLiveBlocks, pulLiveBytes );
+
+    while( ulNumLive > 0 )
+    {
+        ulNumLive--;
+        pulLiveBlocks[ xLive[ ulNumLive ].ulCaller ]--;
+        pulLiveBytes[ xLive[ ulNumLive ].ulCaller ] -= ( uint32_t ) xLive[ ulNumLive ].xBlockSize;
+        vPortFree( xLive[ ulNumLive ].pvBlock );
+    }
+
+    prvCheckModel( pulLiveBlocks, pulLiveBytes );
+
+    printf( "model       %lu operations from %u callers\n", ( unsigned long ) ulOperations, TEST_CALLERS );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvTestLimits( void )
+{
+    static void * pvBlocks[ HEAP_TRACE_MAX_BLOCKS ];
+    const uint32_t ulNumBlocks = HEAP_TRACE_MAX_BLOCKS - 24;
+    const uint32_t ulNumCallers = HEAP_TRACE_MAX_SITES + 6;
+    HeapTraceStats_t xStats;
+    HeapTraceSite_t xSite;
+    uint32_t ulTracked = 0;
+    uint32_t ulSiteZeroAllocs = 0;
+
+    /* Blocks beyond the table load are untracked */
+    vHeapTraceReset();
+
+    for( uint32_t i = 0; i < ulNumBlocks; i++ )
+    {
+        pvBlocks[ i ] = pvHeapTraceMallocFrom( 8, ( const void * ) TEST_CALLER_BASE );
+        prvCheck( pvBlocks[ i ] != NULL, "limits: allocation" );
+    }
+
+    vHeapTraceGetStats( &xStats );
+
+    if( prvFindSite( ( const void * ) TEST_CALLER_BASE, &xSite ) )
+    {
+        ulTracked = xSite.ulLiveBlocks;
+    }
+
+    printf( "limits      %lu blocks, %lu tracked, %lu untracked\n",
+            ( unsigned long ) ulNumBlocks, ( unsigned long ) ulTracked, ( unsigned long ) xStats.ulUntracked );
+    prvCheck( xStats.ulAllocs == ulNumBlocks, "limits: allocations counted" );
+    prvCheck( ( ulTracked + xStats.ulUntracked ) == ulNumBlocks, "limits: tracked plus untracked" );
+    prvCheck( xStats.ulUntracked > 0, "limits: table load is bounded" );
+
+    prvFreeAll( pvBlocks, ulNumBlocks );
+
+    vHeapTraceGetStats( &xStats );
+    prvCheck( xStats.ulLiveBytes == 0, "limits: live bytes after freeing untracked blocks" );
+    prvCheck( prvFindSite( ( const void * ) TEST_CALLER_BASE, &xSite ) && ( xSite.ulLiveBlocks == 0 ),
+              "limits: site released" );
+
+    /* Failures and reset */
+    vHeapTraceReset();
+    prvCheck( pvPortMalloc( configTOTAL_HEAP_SIZE * 2 ) == NULL, "limits: oversized allocation fails" );
+    pvBlocks[ 0 ] = pvPortMalloc( 32 );
+    vHeapTraceGetStats( &xStats );
+    prvCheck( ( xStats.ulFailures == 1 ) && ( xStats.ulAllocs == 1 ), "limits: failure counted" );
+    vHeapTraceReset();
+    vHeapTraceGetStats( &xStats );
+    prvCheck( ( xStats.ulAllocs == 0 ) && ( xStats.ulFailures == 0 ) &&
+              ( xStats.ulLiveBytes == prvBlockSize( pvBlocks[ 0 ] ) ) &&
+              ( xStats.ulPeakBytes == xStats.ulLiveBytes ), "limits: reset keeps live bytes" );
+    vPortFree( pvBlocks[ 0 ] );
+
+    /* Callers beyond the site table go to site 0 */
+    vHeapTraceReset();
+
+    for( uint32_t i = 0; i < ulNumCallers; i++ )
+    {
+        pvBlocks[ i ] = pvHeapTraceMallocFrom( 16, ( const void * ) ( TEST_CALLER_BASE + 0x1000UL + ( 4UL * i ) ) );
+    }
+
+    for( uint32_t i = 0; ulHeapTraceGetSite( i, &xSite ) != 0; i++ )
+    {
+        if( xSite.pvCaller == NULL )
+        {
+            ulSiteZeroAllocs = xSite.ulAllocs;
+        }
+    }
+
+    prvFreeAll( pvBlocks, ulNumCallers );
+
+    printf( "limits      %lu callers, %lu in site 0\n", ( unsigned long ) ulNumCallers, ( unsigned long ) ulSiteZeroAllocs );
+    prvCheck( ulSiteZeroAllocs > 0, "limits: overflow callers in site 0" );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvTestWalk( void )
+{
+    static void * pvBlocks[ 64 ];
+    HeapTraceWalk_t xWalk;
+    uint32_t ulFreeBlocks = 0;
+    uint32_t ulFreeBytes = 0;
+    uint32_t ulLargest = 0;
+    uint32_t ulUsedBlocks = 0;
+    uint32_t ulHistogramTotal = 0;
+    TestBlock_t * pxBlock = ( TestBlock_t * ) ucHeap;
+
+    for( uint32_t i = 0; i < 64; i++ )
+    {
+        pvBlocks[ i ] = pvPortMalloc( 24 + ( 40 * i ) );
+    }
+
+    /* Free every other block to fragment the heap */
+    for( uint32_t i = 0; i < 64; i += 2 )
+    {
+        vPortFree( pvBlocks[ i ] );
+        pvBlocks[ i ] = NULL;
+    }
+
+    while( pxBlock->xBlockSize != 0 )
+    {
+        size_t xSize = pxBlock->xBlockSize & ~TEST_ALLOCATED_BIT;
+
+        if( ( pxBlock->xBlockSize & TEST_ALLOCATED_BIT ) != 0 )
+        {
+            ulUsedBlocks++;
+        }
+        else
+        {
+            ulFreeBlocks++;
+            ulFreeBytes += ( uint32_t ) xSize;
+            ulLargest = ( xSize > ulLargest ) ? ( uint32_t ) xSize : ulLargest;
+        }
+
+        pxBlock = prvNextBlock( pxBlock );
+    }
+
+    vHeapTraceWalk( &xWalk );
+
+    for( uint32_t i = 0; i < HEAP_TRACE_HISTOGRAM_BUCKETS; i++ )
+    {
+        ulHistogramTotal += xWalk.pulFreeHistogram[ i ];
+    }
+
+    printf( "walk        %lu free blocks, %lu free bytes, largest %lu, %lu used blocks\n",
+            ( unsigned long ) xWalk.ulFreeBlocks, ( unsigned long ) xWalk.ulFreeBytes,
+            ( unsigned long ) xWalk.ulLargestFree, ( unsigned long ) xWalk.ulUsedBlocks );
+    prvCheck( ( xWalk.ulFreeBlocks == ulFreeBlocks ) && ( xWalk.ulFreeBytes == ulFreeBytes ) &&
+              ( xWalk.ulLargestFree == ulLargest ) && ( xWalk.ulUsedBlocks == ulUsedBlocks ), "walk: summary" );
+    prvCheck( ulHistogramTotal == ulFreeBlocks, "walk: histogram total" );
+
+    prvFreeAll( pvBlocks, 64 );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvTestUnsplit( void )
+{
+    void * pvFirst = pvPortMalloc( 200 );
+    void * pvGuard = pvPortMalloc( 16 );
+    void * pvBlock = NULL;
+    const void * pvCaller = ( const void * ) TEST_CALLER_BASE; /* Has a site since the limits test */
+    HeapTraceStats_t xBefore;
+    HeapTraceStats_t xStats;
+    HeapTraceSite_t xSite;
+
+    /* Leave a free block 16 bytes larger than the next request needs, too
+     * little to split off a block of its own */
+    vPortFree( pvFirst );
+    vHeapTraceReset();
+    vHeapTraceGetStats( &xBefore );
+
+    pvBlock = pvHeapTraceMallocFrom( 200 - TEST_HEADER_SIZE, pvCaller );
+    vHeapTraceGetStats( &xStats );
+
+    printf( "unsplit     asked for %lu bytes, block of %lu bytes\n",
+            ( unsigned long ) ( 200 - TEST_HEADER_SIZE ), ( unsigned long ) prvBlockSize( pvBlock ) );
+    prvCheck( ( pvBlock == pvFirst ) && ( prvBlockSize( pvBlock ) > 200 ), "unsplit: block handed out whole" );
+    prvCheck( prvFindSite( pvCaller, &xSite ) && ( xSite.ulLiveBytes == prvBlockSize( pvBlock ) ),
+              "unsplit: site counts the block size" );
+    prvCheck( xStats.ulLiveBytes == xBefore.ulLiveBytes + prvBlockSize( pvBlock ), "unsplit: live bytes count the block size" );
+
+    vPortFree( pvBlock );
+    vHeapTraceGetStats( &xStats );
+
+    prvCheck( prvFindSite( pvCaller, &xSite ) && ( xSite.ulLiveBlocks == 0 ) && ( xSite.ulLiveBytes == 0 ),
+              "unsplit: site back to zero" );
+    prvCheck( xStats.ulLiveBytes == xBefore.ulLiveBytes, "unsplit: live bytes back where they were" );
+
+    vPortFree( pvGuard );
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    uint32_t ulOperations = 20000U;
+
+    if( argc > 1 )
+    {
+        ulOperations = ( uint32_t ) strtoul( argv[ 1 ], NULL, 10 );
+    }
+
+    prvHeapInit();
+
+    prvTestAttribution();
+    prvTestModel( ulOperations );
+    prvTestLimits();
+    prvTestWalk();
+    prvTestUnsplit();
+
+    printf( "%s (%lu failures)\n", ( ulFailures == 0 ) ? "PASS" : "FAIL", ( unsigned long ) ulFailures );
+
+    return ( ulFailures == 0 ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
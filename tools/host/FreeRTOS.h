@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+/*
+ * Minimal FreeRTOS kernel interface for building firmware modules on the
+ * host, used by the host tests in tools/. Only what those tests need is
+ * provided. The kernel functions are implemented in host_kernel.c, except
+ * for the heap and the task list which each test provides itself.
+ */
+
+#ifndef _HOST_FREERTOS_H
+#define _HOST_FREERTOS_H
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define portBASE_TYPE   long
+
+typedef long            BaseType_t;
+typedef unsigned long   UBaseType_t;
+typedef uint32_t        TickType_t;
+
+#define pdFALSE                     ( ( BaseType_t ) 0 )
+#define pdTRUE                      ( ( BaseType_t ) 1 )
+#define pdPASS                      ( pdTRUE )
+#define pdFAIL                      ( pdFALSE )
+
+#define portMAX_DELAY               ( ( TickType_t ) 0xFFFFFFFFUL )
+#define portBYTE_ALIGNMENT          8
+#define portBYTE_ALIGNMENT_MASK     ( 0x0007 )
+#define portMEMORY_BARRIER()        __sync_synchronize()
+
+#define configTICK_RATE_HZ          ( ( TickType_t ) 1000 )
+#define portTICK_PERIOD_MS          ( ( TickType_t ) 1000 / configTICK_RATE_HZ )
+#define pdMS_TO_TICKS( xTimeInMs )  ( ( TickType_t ) ( ( ( uint64_t ) ( xTimeInMs ) * configTICK_RATE_HZ ) / 1000U ) )
+
+#ifndef configTOTAL_HEAP_SIZE
+#define configTOTAL_HEAP_SIZE       ( 64 * 1024 )
+#endif
+
+#define configTASK_NOTIFICATION_ARRAY_ENTRIES      8
+#define configNUM_THREAD_LOCAL_STORAGE_POINTERS    5
+#define configMAX_TASK_NAME_LEN                    16
+#define configUSE_TRACE_FACILITY                   1
+#define configGENERATE_RUN_TIME_STATS              1
+#define configRUN_TIME_COUNTER_TYPE                uint64_t
+#define configSTACK_DEPTH_TYPE                     uint16_t
+#define INCLUDE_xTaskAbortDelay                    1
+#define INCLUDE_xTaskGetCurrentTaskHandle          1
+
+#define configASSERT( x )           assert( x )
+
+#define portYIELD_FROM_ISR( x )     ( void ) ( x )
+
+/* Provided by the test, which decides which of its tasks model interrupts */
+BaseType_t xPortIsInsideInterrupt( void );
+
+void * pvPortMalloc( size_t xSize );
+void vPortFree( void * pv );
+
+/* Provided by newlib on the target, by glibc only from 2.38 on */
+#if defined( __GLIBC__ ) && ( ( __GLIBC__ < 2 ) || ( ( __GLIBC__ == 2 ) && ( __GLIBC_MINOR__ < 38 ) ) )
+#define HOST_KERNEL_STRLCPY    1
+size_t strlcpy( char * pcDst,
+                const char * pcSrc,
+                size_t xSize );
+size_t strlcat( char * pcDst,
+                const char * pcSrc,
+                size_t xSize );
+#endif
+
+/* Included by FreeRTOSConfig.h on the target. Event tracing and allocation
+ * tracking are off unless the test builds trace_ring.c with
+ * TRACE_RING_ENABLED=1 or heap_trace.c with HEAP_TRACE_ENABLED=1. */
+#ifndef TRACE_RING_ENABLED
+#define TRACE_RING_ENABLED    0
+#endif
+
+#ifndef HEAP_TRACE_ENABLED
+#define HEAP_TRACE_ENABLED    0
+#endif
+
+#include "trace_ring.h"
+#include "heap_trace.h"
+#include "hw_defs.h"
+
+#endif /* _HOST_FREERTOS_H */
@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+/*
+ * Atomic operations of the host kernel shim, see FreeRTOS.h. The kernel
+ * implements them in critical sections, the host with compiler builtins.
+ */
+
+#ifndef _HOST_ATOMIC_H
+#define _HOST_ATOMIC_H
+
+#include "FreeRTOS.h"
+
+static inline uint32_t Atomic_Increment_u32( uint32_t volatile * pulAddend )
+{
+    return __atomic_fetch_add( pulAddend, 1U, __ATOMIC_SEQ_CST );
+}
+
+static inline uint32_t Atomic_Decrement_u32( uint32_t volatile * pulAddend )
+{
+    return __atomic_fetch_sub( pulAddend, 1U, __ATOMIC_SEQ_CST );
+}
+
+static inline uint32_t Atomic_Add_u32( uint32_t volatile * pulAddend,
+                                       uint32_t ulCount )
+{
+    return __atomic_fetch_add( pulAddend, ulCount, __ATOMIC_SEQ_CST );
+}
+
+#endif /* _HOST_ATOMIC_H */
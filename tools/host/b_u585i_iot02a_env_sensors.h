@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+/*
+ * Environmental sensor BSP interface used by the modules built on the
+ * host. The test provides the BSP functions it calls.
+ */
+
+#ifndef _HOST_ENV_SENSORS_H
+#define _HOST_ENV_SENSORS_H
+
+#include <stdint.h>
+
+#ifndef BSP_ERROR_NONE
+#define BSP_ERROR_NONE     0
+#endif
+
+#define ENV_TEMPERATURE    1U
+#define ENV_PRESSURE       2U
+#define ENV_HUMIDITY       4U
+
+int32_t BSP_ENV_SENSOR_Init( uint32_t Instance,
+                             uint32_t Functions );
+int32_t BSP_ENV_SENSOR_Enable( uint32_t Instance,
+                               uint32_t Function );
+int32_t BSP_ENV_SENSOR_SetOutputDataRate( uint32_t Instance,
+                                          uint32_t Function,
+                                          float Odr );
+int32_t BSP_ENV_SENSOR_GetValue( uint32_t Instance,
+                                 uint32_t Function,
+                                 float * Value );
+
+#endif /* _HOST_ENV_SENSORS_H */
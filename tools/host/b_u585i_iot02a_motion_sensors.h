@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+/*
+ * Motion sensor BSP interface used by the modules built on the host. The
+ * test provides Motion_Sensor_CompObj, e.g. with an ISM330DLC object whose
+ * bus context points at its own register model, and the BSP functions it
+ * calls.
+ */
+
+#ifndef _HOST_MOTION_SENSORS_H
+#define _HOST_MOTION_SENSORS_H
+
+#include "ism330dlc.h"
+
+#ifndef BSP_ERROR_NONE
+#define BSP_ERROR_NONE                 0
+#endif
+
+#define MOTION_SENSOR_INSTANCES_NBR    2
+
+#define MOTION_GYRO                    1U
+#define MOTION_ACCELERO                2U
+#define MOTION_MAGNETO                 4U
+
+typedef struct
+{
+    int32_t x;
+    int32_t y;
+    int32_t z;
+} BSP_MOTION_SENSOR_Axes_t;
+
+extern void * Motion_Sensor_CompObj[ MOTION_SENSOR_INSTANCES_NBR ];
+
+int32_t BSP_MOTION_SENSOR_Init( uint32_t Instance,
+                                uint32_t Functions );
+int32_t BSP_MOTION_SENSOR_Enable( uint32_t Instance,
+                                  uint32_t Function );
+int32_t BSP_MOTION_SENSOR_GetAxes( uint32_t Instance,
+                                   uint32_t Function,
+                                   BSP_MOTION_SENSOR_Axes_t * Axes );
+int32_t BSP_MOTION_SENSOR_SetOutputDataRate( uint32_t Instance,
+                                             uint32_t Function,
+                                             float Odr );
+
+#endif /* _HOST_MOTION_SENSORS_H */
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+/*
+ * coreMQTT-Agent interface used by the publishing tasks built on the host.
+ * The agent context stays opaque and the test provides MQTTAgent_Publish, so
+ * that it decides how commands are queued and completed.
+ */
+
+#ifndef _HOST_CORE_MQTT_AGENT_H
+#define _HOST_CORE_MQTT_AGENT_H
+
+#include "core_mqtt.h"
+
+typedef struct MQTTAgentContext          MQTTAgentContext_t;
+typedef struct MQTTAgentCommandContext   MQTTAgentCommandContext_t;
+
+typedef struct MQTTAgentReturnInfo
+{
+    MQTTStatus_t returnCode;
+    uint8_t * pSubackCodes;
+} MQTTAgentReturnInfo_t;
+
+typedef void (* MQTTAgentCommandCallback_t )( MQTTAgentCommandContext_t * pCmdCallbackContext,
+                                              MQTTAgentReturnInfo_t * pReturnInfo );
+
+typedef struct MQTTAgentCommandInfo
+{
+    MQTTAgentCommandCallback_t cmdCompleteCallback;
+    MQTTAgentCommandContext_t * pCmdCompleteCallbackContext;
+    uint32_t blockTimeMs;
+} MQTTAgentCommandInfo_t;
+
+MQTTStatus_t MQTTAgent_Publish( const MQTTAgentContext_t * pMqttAgentContext,
+                                MQTTPublishInfo_t * pPublishInfo,
+                                const MQTTAgentCommandInfo_t * pCommandInfo );
+
+#endif /* _HOST_CORE_MQTT_AGENT_H */
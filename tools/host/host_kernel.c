@@ -0,0 +1,1373 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+/*
+ * Host implementation of the kernel shim declared in FreeRTOS.h, task.h,
+ * queue.h and event_groups.h.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "event_groups.h"
+#include "stream_buffer.h"
+#include "message_buffer.h"
+#include "timers.h"
+
+static pthread_mutex_t xKernelLock;
+static pthread_once_t xKernelLockOnce = PTHREAD_ONCE_INIT;
+
+static volatile TickType_t xTickCount = 0;
+
+/* Set once by vHostKernelStartRealTime */
+static volatile BaseType_t xRealTime = pdFALSE;
+static struct timespec xRealTimeStart;
+
+/*-----------------------------------------------------------*/
+
+static void prvInitKernelLock( void )
+{
+    pthread_mutexattr_t xAttr;
+
+    ( void ) pthread_mutexattr_init( &xAttr );
+    ( void ) pthread_mutexattr_settype( &xAttr, PTHREAD_MUTEX_RECURSIVE );
+    ( void ) pthread_mutex_init( &xKernelLock, &xAttr );
+    ( void ) pthread_mutexattr_destroy( &xAttr );
+}
+
+void vHostKernelEnterCritical( void )
+{
+    ( void ) pthread_once( &xKernelLockOnce, prvInitKernelLock );
+    ( void ) pthread_mutex_lock( &xKernelLock );
+}
+
+void vHostKernelExitCritical( void )
+{
+    ( void ) pthread_mutex_unlock( &xKernelLock );
+}
+
+void vTaskSuspendAll( void )
+{
+    vHostKernelEnterCritical();
+}
+
+BaseType_t xTaskResumeAll( void )
+{
+    vHostKernelExitCritical();
+
+    return pdFALSE;
+}
+
+BaseType_t xTaskGetSchedulerState( void )
+{
+    return taskSCHEDULER_RUNNING;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Whole ticks elapsed on the monotonic clock since real time started */
+static TickType_t prvRealTimeTicks( void )
+{
+    struct timespec xNow;
+    int64_t llElapsedNs;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &xNow );
+    llElapsedNs = ( ( int64_t ) ( xNow.tv_sec - xRealTimeStart.tv_sec ) * 1000000000LL ) +
+                  ( xNow.tv_nsec - xRealTimeStart.tv_nsec );
+
+    return ( TickType_t ) ( llElapsedNs / ( 1000000000LL / configTICK_RATE_HZ ) );
+}
+
+TickType_t xTaskGetTickCount( void )
+{
+    TickType_t xTicks = xTickCount;
+
+    if( xRealTime == pdTRUE )
+    {
+        xTicks += prvRealTimeTicks();
+    }
+
+    return xTicks;
+}
+
+void vHostKernelAdvanceTicks( TickType_t xTicks )
+{
+    __atomic_fetch_add( &xTickCount, xTicks, __ATOMIC_SEQ_CST );
+}
+
+void vHostKernelStartRealTime( void )
+{
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &xRealTimeStart );
+    xRealTime = pdTRUE;
+}
+
+void vTaskDelay( TickType_t xTicksToDelay )
+{
+    if( xRealTime == pdTRUE )
+    {
+        /* Like the kernel, wake on the boundary of the tick the delay ends in */
+        uint64_t ullWakeNs = ( uint64_t ) ( prvRealTimeTicks() + xTicksToDelay ) * ( 1000000000ULL / configTICK_RATE_HZ );
+        struct timespec xWake =
+        {
+            .tv_sec  = xRealTimeStart.tv_sec + ( time_t ) ( ullWakeNs / 1000000000ULL ),
+            .tv_nsec = xRealTimeStart.tv_nsec + ( long ) ( ullWakeNs % 1000000000ULL ),
+        };
+
+        if( xWake.tv_nsec >= 1000000000L )
+        {
+            xWake.tv_sec++;
+            xWake.tv_nsec -= 1000000000L;
+        }
+
+        while( clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &xWake, NULL ) != 0 )
+        {
+        }
+    }
+    else
+    {
+        vHostKernelAdvanceTicks( xTicksToDelay );
+    }
+}
+
+void vTaskSetTimeOutState( TimeOut_t * const pxTimeOut )
+{
+    pxTimeOut->xTimeOnEntering = xTaskGetTickCount();
+}
+
+BaseType_t xTaskCheckForTimeOut( TimeOut_t * const pxTimeOut,
+                                 TickType_t * const pxTicksToWait )
+{
+    BaseType_t xTimedOut = pdFALSE;
+    TickType_t xElapsed = xTaskGetTickCount() - pxTimeOut->xTimeOnEntering;
+
+    if( *pxTicksToWait == portMAX_DELAY )
+    {
+        xTimedOut = pdFALSE;
+    }
+    else if( xElapsed < *pxTicksToWait )
+    {
+        *pxTicksToWait -= xElapsed;
+        vTaskSetTimeOutState( pxTimeOut );
+    }
+    else
+    {
+        *pxTicksToWait = 0;
+        xTimedOut = pdTRUE;
+    }
+
+    return xTimedOut;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark( TaskHandle_t xTask )
+{
+    ( void ) xTask;
+
+    return 0;
+}
+
+/*-----------------------------------------------------------*/
+
+typedef struct
+{
+    uint32_t pulNotifyValue[ configTASK_NOTIFICATION_ARRAY_ENTRIES ];
+    BaseType_t pxNotifyPending[ configTASK_NOTIFICATION_ARRAY_ENTRIES ];
+    BaseType_t xAbortDelay;
+    pthread_cond_t xWake;
+    char pcName[ configMAX_TASK_NAME_LEN ];
+} HostTask_t;
+
+typedef struct
+{
+    TaskFunction_t pxTaskCode;
+    const char * pcName;
+    void * pvParameters;
+    TaskHandle_t xHandle;
+} HostTaskStart_t;
+
+/* Each task waits on its own condition variable, so a notification only
+ * wakes the task it is sent to */
+static __thread HostTask_t xCurrentTask = { .xWake = PTHREAD_COND_INITIALIZER, .pcName = "main" };
+
+static pthread_mutex_t xNotifyLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t xNotifyCond = PTHREAD_COND_INITIALIZER;
+
+/* Converts a timeout in ticks into an absolute CLOCK_REALTIME deadline */
+static void prvDeadline( TickType_t xTicksToWait,
+                         struct timespec * pxDeadline )
+{
+    ( void ) clock_gettime( CLOCK_REALTIME, pxDeadline );
+    pxDeadline->tv_sec += ( time_t ) ( xTicksToWait / configTICK_RATE_HZ );
+    pxDeadline->tv_nsec += ( long ) ( xTicksToWait % configTICK_RATE_HZ ) * ( 1000000000L / configTICK_RATE_HZ );
+
+    if( pxDeadline->tv_nsec >= 1000000000L )
+    {
+        pxDeadline->tv_sec++;
+        pxDeadline->tv_nsec -= 1000000000L;
+    }
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle( void )
+{
+    return &xCurrentTask;
+}
+
+char * pcTaskGetName( TaskHandle_t xTaskToQuery )
+{
+    HostTask_t * pxTask = ( xTaskToQuery != NULL ) ? ( HostTask_t * ) xTaskToQuery : &xCurrentTask;
+
+    return pxTask->pcName;
+}
+
+static void * prvTaskEntry( void * pvParameters )
+{
+    HostTaskStart_t * pxStart = ( HostTaskStart_t * ) pvParameters;
+    TaskFunction_t pxTaskCode = pxStart->pxTaskCode;
+    void * pvTaskParameters = pxStart->pvParameters;
+
+    if( pxStart->pcName != NULL )
+    {
+        ( void ) strncpy( xCurrentTask.pcName, pxStart->pcName, configMAX_TASK_NAME_LEN - 1 );
+    }
+
+    /* The creator waits for the handle, pxStart is gone once it is set */
+    ( void ) pthread_mutex_lock( &xNotifyLock );
+    pxStart->xHandle = &xCurrentTask;
+    ( void ) pthread_cond_broadcast( &xNotifyCond );
+    ( void ) pthread_mutex_unlock( &xNotifyLock );
+
+    pxTaskCode( pvTaskParameters );
+
+    return NULL;
+}
+
+BaseType_t xTaskCreate( TaskFunction_t pxTaskCode,
+                        const char * const pcName,
+                        const configSTACK_DEPTH_TYPE usStackDepth,
+                        void * const pvParameters,
+                        UBaseType_t uxPriority,
+                        TaskHandle_t * const pxCreatedTask )
+{
+    HostTaskStart_t xStart = { pxTaskCode, pcName, pvParameters, NULL };
+    pthread_t xThread;
+    pthread_attr_t xAttr;
+    BaseType_t xResult = pdFAIL;
+
+    ( void ) usStackDepth;
+    ( void ) uxPriority;
+
+    ( void ) pthread_attr_init( &xAttr );
+    ( void ) pthread_attr_setdetachstate( &xAttr, PTHREAD_CREATE_DETACHED );
+
+    if( pthread_create( &xThread, &xAttr, prvTaskEntry, &xStart ) == 0 )
+    {
+        ( void ) pthread_mutex_lock( &xNotifyLock );
+
+        while( xStart.xHandle == NULL )
+        {
+            ( void ) pthread_cond_wait( &xNotifyCond, &xNotifyLock );
+        }
+
+        ( void ) pthread_mutex_unlock( &xNotifyLock );
+
+        if( pxCreatedTask != NULL )
+        {
+            *pxCreatedTask = xStart.xHandle;
+        }
+
+        xResult = pdPASS;
+    }
+
+    ( void ) pthread_attr_destroy( &xAttr );
+
+    return xResult;
+}
+
+void vTaskDelete( TaskHandle_t xTaskToDelete )
+{
+    configASSERT( ( xTaskToDelete == NULL ) || ( xTaskToDelete == &xCurrentTask ) );
+
+    pthread_exit( NULL );
+}
+
+BaseType_t xTaskAbortDelay( TaskHandle_t xTask )
+{
+    HostTask_t * pxTask = ( HostTask_t * ) xTask;
+
+    configASSERT( pxTask != NULL );
+
+    ( void ) pthread_mutex_lock( &xNotifyLock );
+    pxTask->xAbortDelay = pdTRUE;
+    ( void ) pthread_cond_broadcast( &( pxTask->xWake ) );
+    ( void ) pthread_mutex_unlock( &xNotifyLock );
+
+    return pdPASS;
+}
+
+BaseType_t xTaskNotifyIndexed( TaskHandle_t xTaskToNotify,
+                               UBaseType_t uxIndexToNotify,
+                               uint32_t ulValue,
+                               eNotifyAction eAction )
+{
+    HostTask_t * pxTask = ( HostTask_t * ) xTaskToNotify;
+    BaseType_t xResult = pdPASS;
+    uint32_t * pulValue;
+
+    configASSERT( pxTask != NULL );
+    configASSERT( uxIndexToNotify < configTASK_NOTIFICATION_ARRAY_ENTRIES );
+
+    pulValue = &( pxTask->pulNotifyValue[ uxIndexToNotify ] );
+
+    ( void ) pthread_mutex_lock( &xNotifyLock );
+
+    switch( eAction )
+    {
+        case eSetBits:
+            *pulValue |= ulValue;
+            break;
+
+        case eIncrement:
+            ( *pulValue )++;
+            break;
+
+        case eSetValueWithOverwrite:
+            *pulValue = ulValue;
+            break;
+
+        case eSetValueWithoutOverwrite:
+
+            if( pxTask->pxNotifyPending[ uxIndexToNotify ] == pdFALSE )
+            {
+                *pulValue = ulValue;
+            }
+            else
+            {
+                xResult = pdFAIL;
+            }
+
+            break;
+
+        default:
+            break;
+    }
+
+    pxTask->pxNotifyPending[ uxIndexToNotify ] = pdTRUE;
+    ( void ) pthread_cond_broadcast( &( pxTask->xWake ) );
+    ( void ) pthread_mutex_unlock( &xNotifyLock );
+
+    return xResult;
+}
+
+BaseType_t xTaskNotifyGiveIndexed( TaskHandle_t xTaskToNotify,
+                                   UBaseType_t uxIndexToNotify )
+{
+    return xTaskNotifyIndexed( xTaskToNotify, uxIndexToNotify, 0, eIncrement );
+}
+
+BaseType_t xTaskNotifyIndexedFromISR( TaskHandle_t xTaskToNotify,
+                                      UBaseType_t uxIndexToNotify,
+                                      uint32_t ulValue,
+                                      eNotifyAction eAction,
+                                      BaseType_t * pxHigherPriorityTaskWoken )
+{
+    BaseType_t xReturn = xTaskNotifyIndexed( xTaskToNotify, uxIndexToNotify, ulValue, eAction );
+
+    if( pxHigherPriorityTaskWoken != NULL )
+    {
+        *pxHigherPriorityTaskWoken = pdTRUE;
+    }
+
+    return xReturn;
+}
+
+void vTaskNotifyGiveIndexedFromISR( TaskHandle_t xTaskToNotify,
+                                    UBaseType_t uxIndexToNotify,
+                                    BaseType_t * pxHigherPriorityTaskWoken )
+{
+    ( void ) xTaskNotifyGiveIndexed( xTaskToNotify, uxIndexToNotify );
+
+    if( pxHigherPriorityTaskWoken != NULL )
+    {
+        *pxHigherPriorityTaskWoken = pdTRUE;
+    }
+}
+
+uint32_t ulTaskNotifyTakeIndexed( UBaseType_t uxIndexToWaitOn,
+                                  BaseType_t xClearCountOnExit,
+                                  TickType_t xTicksToWait )
+{
+    uint32_t * pulValue = &( xCurrentTask.pulNotifyValue[ uxIndexToWaitOn ] );
+    uint32_t ulValue;
+    struct timespec xDeadline;
+    int lError = 0;
+
+    configASSERT( uxIndexToWaitOn < configTASK_NOTIFICATION_ARRAY_ENTRIES );
+
+    prvDeadline( xTicksToWait, &xDeadline );
+
+    ( void ) pthread_mutex_lock( &xNotifyLock );
+
+    while( ( *pulValue == 0 ) && ( xTicksToWait != 0 ) && ( lError == 0 ) &&
+           ( xCurrentTask.xAbortDelay == pdFALSE ) )
+    {
+        if( xTicksToWait == portMAX_DELAY )
+        {
+            lError = pthread_cond_wait( &( xCurrentTask.xWake ), &xNotifyLock );
+        }
+        else
+        {
+            lError = pthread_cond_timedwait( &( xCurrentTask.xWake ), &xNotifyLock, &xDeadline );
+        }
+    }
+
+    ulValue = *pulValue;
+
+    if( ulValue != 0 )
+    {
+        *pulValue = ( xClearCountOnExit != pdFALSE ) ? 0 : ( ulValue - 1 );
+    }
+
+    xCurrentTask.pxNotifyPending[ uxIndexToWaitOn ] = pdFALSE;
+    xCurrentTask.xAbortDelay = pdFALSE;
+
+    ( void ) pthread_mutex_unlock( &xNotifyLock );
+
+    return ulValue;
+}
+
+BaseType_t xTaskNotifyWaitIndexed( UBaseType_t uxIndexToWaitOn,
+                                   uint32_t ulBitsToClearOnEntry,
+                                   uint32_t ulBitsToClearOnExit,
+                                   uint32_t * pulNotificationValue,
+                                   TickType_t xTicksToWait )
+{
+    uint32_t * pulValue = &( xCurrentTask.pulNotifyValue[ uxIndexToWaitOn ] );
+    BaseType_t * pxPending = &( xCurrentTask.pxNotifyPending[ uxIndexToWaitOn ] );
+    BaseType_t xReceived;
+    struct timespec xDeadline;
+    int lError = 0;
+
+    configASSERT( uxIndexToWaitOn < configTASK_NOTIFICATION_ARRAY_ENTRIES );
+
+    prvDeadline( xTicksToWait, &xDeadline );
+
+    ( void ) pthread_mutex_lock( &xNotifyLock );
+
+    if( *pxPending == pdFALSE )
+    {
+        *pulValue &= ~ulBitsToClearOnEntry;
+    }
+
+    while( ( *pxPending == pdFALSE ) && ( xTicksToWait != 0 ) && ( lError == 0 ) &&
+           ( xCurrentTask.xAbortDelay == pdFALSE ) )
+    {
+        if( xTicksToWait == portMAX_DELAY )
+        {
+            lError = pthread_cond_wait( &( xCurrentTask.xWake ), &xNotifyLock );
+        }
+        else
+        {
+            lError = pthread_cond_timedwait( &( xCurrentTask.xWake ), &xNotifyLock, &xDeadline );
+        }
+    }
+
+    if( pulNotificationValue != NULL )
+    {
+        *pulNotificationValue = *pulValue;
+    }
+
+    xReceived = *pxPending;
+
+    if( xReceived == pdTRUE )
+    {
+        *pulValue &= ~ulBitsToClearOnExit;
+    }
+
+    *pxPending = pdFALSE;
+    xCurrentTask.xAbortDelay = pdFALSE;
+
+    ( void ) pthread_mutex_unlock( &xNotifyLock );
+
+    return xReceived;
+}
+
+BaseType_t xTaskNotifyStateClearIndexed( TaskHandle_t xTask,
+                                         UBaseType_t uxIndexToClear )
+{
+    HostTask_t * pxTask = ( xTask != NULL ) ? ( HostTask_t * ) xTask : &xCurrentTask;
+    BaseType_t xWasPending;
+
+    configASSERT( uxIndexToClear < configTASK_NOTIFICATION_ARRAY_ENTRIES );
+
+    ( void ) pthread_mutex_lock( &xNotifyLock );
+    xWasPending = pxTask->pxNotifyPending[ uxIndexToClear ];
+    pxTask->pxNotifyPending[ uxIndexToClear ] = pdFALSE;
+    ( void ) pthread_mutex_unlock( &xNotifyLock );
+
+    return xWasPending;
+}
+
+uint32_t ulTaskNotifyValueClearIndexed( TaskHandle_t xTask,
+                                        UBaseType_t uxIndexToClear,
+                                        uint32_t ulBitsToClear )
+{
+    HostTask_t * pxTask = ( xTask != NULL ) ? ( HostTask_t * ) xTask : &xCurrentTask;
+    uint32_t ulValue;
+
+    configASSERT( uxIndexToClear < configTASK_NOTIFICATION_ARRAY_ENTRIES );
+
+    ( void ) pthread_mutex_lock( &xNotifyLock );
+    ulValue = pxTask->pulNotifyValue[ uxIndexToClear ];
+    pxTask->pulNotifyValue[ uxIndexToClear ] &= ~ulBitsToClear;
+    ( void ) pthread_mutex_unlock( &xNotifyLock );
+
+    return ulValue;
+}
+
+/*-----------------------------------------------------------*/
+
+struct HostQueue
+{
+    pthread_mutex_t xLock;
+    pthread_cond_t xChanged;
+    UBaseType_t uxLength;
+    UBaseType_t uxItemSize;
+    UBaseType_t uxHead;
+    UBaseType_t uxCount;
+    uint8_t * pucStorage;
+};
+
+QueueHandle_t xQueueCreate( UBaseType_t uxQueueLength,
+                            UBaseType_t uxItemSize )
+{
+    struct HostQueue * pxQueue;
+
+    configASSERT( uxQueueLength > 0 );
+
+    pxQueue = ( struct HostQueue * ) calloc( 1, sizeof( struct HostQueue ) + ( uxQueueLength * uxItemSize ) );
+
+    if( pxQueue != NULL )
+    {
+        ( void ) pthread_mutex_init( &( pxQueue->xLock ), NULL );
+        ( void ) pthread_cond_init( &( pxQueue->xChanged ), NULL );
+        pxQueue->uxLength = uxQueueLength;
+        pxQueue->uxItemSize = uxItemSize;
+        pxQueue->pucStorage = ( uint8_t * ) &( pxQueue[ 1 ] );
+    }
+
+    return pxQueue;
+}
+
+QueueHandle_t xQueueCreateCountingSemaphore( UBaseType_t uxMaxCount,
+                                             UBaseType_t uxInitialCount )
+{
+    QueueHandle_t xQueue;
+
+    configASSERT( uxInitialCount <= uxMaxCount );
+
+    xQueue = xQueueCreate( uxMaxCount, 0 );
+
+    if( xQueue != NULL )
+    {
+        xQueue->uxCount = uxInitialCount;
+    }
+
+    return xQueue;
+}
+
+void vQueueDelete( QueueHandle_t xQueue )
+{
+    ( void ) pthread_cond_destroy( &( xQueue->xChanged ) );
+    ( void ) pthread_mutex_destroy( &( xQueue->xLock ) );
+    free( xQueue );
+}
+
+BaseType_t xQueueSend( QueueHandle_t xQueue,
+                       const void * pvItemToQueue,
+                       TickType_t xTicksToWait )
+{
+    struct timespec xDeadline;
+    BaseType_t xResult = pdFAIL;
+    int lError = 0;
+
+    prvDeadline( xTicksToWait, &xDeadline );
+
+    ( void ) pthread_mutex_lock( &( xQueue->xLock ) );
+
+    while( ( xQueue->uxCount == xQueue->uxLength ) && ( xTicksToWait != 0 ) && ( lError == 0 ) )
+    {
+        if( xTicksToWait == portMAX_DELAY )
+        {
+            lError = pthread_cond_wait( &( xQueue->xChanged ), &( xQueue->xLock ) );
+        }
+        else
+        {
+            lError = pthread_cond_timedwait( &( xQueue->xChanged ), &( xQueue->xLock ), &xDeadline );
+        }
+    }
+
+    if( xQueue->uxCount < xQueue->uxLength )
+    {
+        UBaseType_t uxTail = ( xQueue->uxHead + xQueue->uxCount ) % xQueue->uxLength;
+
+        if( xQueue->uxItemSize > 0 )
+        {
+            ( void ) memcpy( &( xQueue->pucStorage[ uxTail * xQueue->uxItemSize ] ), pvItemToQueue, xQueue->uxItemSize );
+        }
+
+        xQueue->uxCount++;
+        ( void ) pthread_cond_broadcast( &( xQueue->xChanged ) );
+        xResult = pdPASS;
+    }
+
+    ( void ) pthread_mutex_unlock( &( xQueue->xLock ) );
+
+    return xResult;
+}
+
+BaseType_t xQueueSendFromISR( QueueHandle_t xQueue,
+                              const void * pvItemToQueue,
+                              BaseType_t * pxHigherPriorityTaskWoken )
+{
+    if( pxHigherPriorityTaskWoken != NULL )
+    {
+        *pxHigherPriorityTaskWoken = pdTRUE;
+    }
+
+    return xQueueSend( xQueue, pvItemToQueue, 0 );
+}
+
+BaseType_t xQueueReceive( QueueHandle_t xQueue,
+                          void * pvBuffer,
+                          TickType_t xTicksToWait )
+{
+    struct timespec xDeadline;
+    BaseType_t xResult = pdFAIL;
+    int lError = 0;
+
+    prvDeadline( xTicksToWait, &xDeadline );
+
+    ( void ) pthread_mutex_lock( &( xQueue->xLock ) );
+
+    while( ( xQueue->uxCount == 0 ) && ( xTicksToWait != 0 ) && ( lError == 0 ) )
+    {
+        if( xTicksToWait == portMAX_DELAY )
+        {
+            lError = pthread_cond_wait( &( xQueue->xChanged ), &( xQueue->xLock ) );
+        }
+        else
+        {
+            lError = pthread_cond_timedwait( &( xQueue->xChanged ), &( xQueue->xLock ), &xDeadline );
+        }
+    }
+
+    if( xQueue->uxCount > 0 )
+    {
+        if( xQueue->uxItemSize > 0 )
+        {
+            ( void ) memcpy( pvBuffer, &( xQueue->pucStorage[ xQueue->uxHead * xQueue->uxItemSize ] ), xQueue->uxItemSize );
+        }
+
+        xQueue->uxHead = ( xQueue->uxHead + 1 ) % xQueue->uxLength;
+        xQueue->uxCount--;
+        ( void ) pthread_cond_broadcast( &( xQueue->xChanged ) );
+        xResult = pdPASS;
+    }
+
+    ( void ) pthread_mutex_unlock( &( xQueue->xLock ) );
+
+    return xResult;
+}
+
+BaseType_t xQueueReceiveFromISR( QueueHandle_t xQueue,
+                                 void * pvBuffer,
+                                 BaseType_t * pxHigherPriorityTaskWoken )
+{
+    if( pxHigherPriorityTaskWoken != NULL )
+    {
+        *pxHigherPriorityTaskWoken = pdTRUE;
+    }
+
+    return xQueueReceive( xQueue, pvBuffer, 0 );
+}
+
+UBaseType_t uxQueueMessagesWaiting( QueueHandle_t xQueue )
+{
+    UBaseType_t uxCount;
+
+    ( void ) pthread_mutex_lock( &( xQueue->xLock ) );
+    uxCount = xQueue->uxCount;
+    ( void ) pthread_mutex_unlock( &( xQueue->xLock ) );
+
+    return uxCount;
+}
+
+UBaseType_t uxQueueSpacesAvailable( QueueHandle_t xQueue )
+{
+    UBaseType_t uxSpaces;
+
+    ( void ) pthread_mutex_lock( &( xQueue->xLock ) );
+    uxSpaces = xQueue->uxLength - xQueue->uxCount;
+    ( void ) pthread_mutex_unlock( &( xQueue->xLock ) );
+
+    return uxSpaces;
+}
+
+/*-----------------------------------------------------------*/
+
+struct HostEventGroup
+{
+    pthread_mutex_t xLock;
+    pthread_cond_t xChanged;
+    EventBits_t uxBits;
+};
+
+EventGroupHandle_t xEventGroupCreate( void )
+{
+    struct HostEventGroup * pxGroup = ( struct HostEventGroup * ) calloc( 1, sizeof( struct HostEventGroup ) );
+
+    if( pxGroup != NULL )
+    {
+        ( void ) pthread_mutex_init( &( pxGroup->xLock ), NULL );
+        ( void ) pthread_cond_init( &( pxGroup->xChanged ), NULL );
+    }
+
+    return pxGroup;
+}
+
+void vEventGroupDelete( EventGroupHandle_t xEventGroup )
+{
+    ( void ) pthread_cond_destroy( &( xEventGroup->xChanged ) );
+    ( void ) pthread_mutex_destroy( &( xEventGroup->xLock ) );
+    free( xEventGroup );
+}
+
+EventBits_t xEventGroupSetBits( EventGroupHandle_t xEventGroup,
+                                const EventBits_t uxBitsToSet )
+{
+    EventBits_t uxBits;
+
+    ( void ) pthread_mutex_lock( &( xEventGroup->xLock ) );
+    xEventGroup->uxBits |= uxBitsToSet;
+    uxBits = xEventGroup->uxBits;
+    ( void ) pthread_cond_broadcast( &( xEventGroup->xChanged ) );
+    ( void ) pthread_mutex_unlock( &( xEventGroup->xLock ) );
+
+    return uxBits;
+}
+
+/* Returns the bits from before they were cleared, as the kernel does */
+EventBits_t xEventGroupClearBits( EventGroupHandle_t xEventGroup,
+                                  const EventBits_t uxBitsToClear )
+{
+    EventBits_t uxBits;
+
+    ( void ) pthread_mutex_lock( &( xEventGroup->xLock ) );
+    uxBits = xEventGroup->uxBits;
+    xEventGroup->uxBits &= ~uxBitsToClear;
+    ( void ) pthread_mutex_unlock( &( xEventGroup->xLock ) );
+
+    return uxBits;
+}
+
+static BaseType_t prvBitsSet( EventBits_t uxBits,
+                              EventBits_t uxBitsToWaitFor,
+                              BaseType_t xWaitForAllBits )
+{
+    BaseType_t xSet;
+
+    if( xWaitForAllBits != pdFALSE )
+    {
+        xSet = ( ( uxBits & uxBitsToWaitFor ) == uxBitsToWaitFor ) ? pdTRUE : pdFALSE;
+    }
+    else
+    {
+        xSet = ( ( uxBits & uxBitsToWaitFor ) != 0 ) ? pdTRUE : pdFALSE;
+    }
+
+    return xSet;
+}
+
+EventBits_t xEventGroupWaitBits( EventGroupHandle_t xEventGroup,
+                                 const EventBits_t uxBitsToWaitFor,
+                                 const BaseType_t xClearOnExit,
+                                 const BaseType_t xWaitForAllBits,
+                                 TickType_t xTicksToWait )
+{
+    struct timespec xDeadline;
+    EventBits_t uxBits;
+    int lError = 0;
+
+    prvDeadline( xTicksToWait, &xDeadline );
+
+    ( void ) pthread_mutex_lock( &( xEventGroup->xLock ) );
+
+    while( ( prvBitsSet( xEventGroup->uxBits, uxBitsToWaitFor, xWaitForAllBits ) == pdFALSE ) &&
+           ( xTicksToWait != 0 ) && ( lError == 0 ) )
+    {
+        if( xTicksToWait == portMAX_DELAY )
+        {
+            lError = pthread_cond_wait( &( xEventGroup->xChanged ), &( xEventGroup->xLock ) );
+        }
+        else
+        {
+            lError = pthread_cond_timedwait( &( xEventGroup->xChanged ), &( xEventGroup->xLock ), &xDeadline );
+        }
+    }
+
+    uxBits = xEventGroup->uxBits;
+
+    if( ( xClearOnExit != pdFALSE ) && ( prvBitsSet( uxBits, uxBitsToWaitFor, xWaitForAllBits ) == pdTRUE ) )
+    {
+        xEventGroup->uxBits &= ~uxBitsToWaitFor;
+    }
+
+    ( void ) pthread_mutex_unlock( &( xEventGroup->xLock ) );
+
+    return uxBits;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Message buffers are stream buffers, as in the kernel */
+struct HostStreamBuffer
+{
+    pthread_mutex_t xLock;
+    pthread_cond_t xChanged;
+    size_t xSize;
+    size_t xTriggerLevel;
+    size_t xHead;
+    size_t xUsed;
+    uint8_t * pucStorage;
+};
+
+StreamBufferHandle_t xStreamBufferCreate( size_t xBufferSizeBytes,
+                                          size_t xTriggerLevelBytes )
+{
+    struct HostStreamBuffer * pxBuffer;
+
+    configASSERT( xBufferSizeBytes > 0 );
+    configASSERT( xTriggerLevelBytes <= xBufferSizeBytes );
+
+    pxBuffer = ( struct HostStreamBuffer * ) calloc( 1, sizeof( struct HostStreamBuffer ) + xBufferSizeBytes );
+
+    if( pxBuffer != NULL )
+    {
+        ( void ) pthread_mutex_init( &( pxBuffer->xLock ), NULL );
+        ( void ) pthread_cond_init( &( pxBuffer->xChanged ), NULL );
+        pxBuffer->xSize = xBufferSizeBytes;
+        pxBuffer->xTriggerLevel = ( xTriggerLevelBytes > 0 ) ? xTriggerLevelBytes : 1;
+        pxBuffer->pucStorage = ( uint8_t * ) &( pxBuffer[ 1 ] );
+    }
+
+    return pxBuffer;
+}
+
+void vStreamBufferDelete( StreamBufferHandle_t xStreamBuffer )
+{
+    ( void ) pthread_cond_destroy( &( xStreamBuffer->xChanged ) );
+    ( void ) pthread_mutex_destroy( &( xStreamBuffer->xLock ) );
+    free( xStreamBuffer );
+}
+
+/* Copies into the ring at xOffset bytes past the head */
+static void prvStreamBufferWrite( StreamBufferHandle_t xStreamBuffer,
+                                  size_t xOffset,
+                                  const void * pvData,
+                                  size_t xLength )
+{
+    const uint8_t * pucData = ( const uint8_t * ) pvData;
+    size_t i;
+
+    for( i = 0; i < xLength; i++ )
+    {
+        xStreamBuffer->pucStorage[ ( xStreamBuffer->xHead + xOffset + i ) % xStreamBuffer->xSize ] = pucData[ i ];
+    }
+}
+
+/* Copies out of the ring from xOffset bytes past the head */
+static void prvStreamBufferRead( StreamBufferHandle_t xStreamBuffer,
+                                 size_t xOffset,
+                                 void * pvData,
+                                 size_t xLength )
+{
+    uint8_t * pucData = ( uint8_t * ) pvData;
+    size_t i;
+
+    for( i = 0; i < xLength; i++ )
+    {
+        pucData[ i ] = xStreamBuffer->pucStorage[ ( xStreamBuffer->xHead + xOffset + i ) % xStreamBuffer->xSize ];
+    }
+}
+
+/* Waits with xLock held until there are xMinFree free and xMinUsed used
+ * bytes, or until xTicksToWait have passed */
+static void prvStreamBufferWait( StreamBufferHandle_t xStreamBuffer,
+                                 size_t xMinFree,
+                                 size_t xMinUsed,
+                                 TickType_t xTicksToWait )
+{
+    struct timespec xDeadline;
+    int lError = 0;
+
+    prvDeadline( xTicksToWait, &xDeadline );
+
+    while( ( ( ( xStreamBuffer->xSize - xStreamBuffer->xUsed ) < xMinFree ) || ( xStreamBuffer->xUsed < xMinUsed ) ) &&
+           ( xTicksToWait != 0 ) && ( lError == 0 ) )
+    {
+        if( xTicksToWait == portMAX_DELAY )
+        {
+            lError = pthread_cond_wait( &( xStreamBuffer->xChanged ), &( xStreamBuffer->xLock ) );
+        }
+        else
+        {
+            lError = pthread_cond_timedwait( &( xStreamBuffer->xChanged ), &( xStreamBuffer->xLock ), &xDeadline );
+        }
+    }
+}
+
+size_t xStreamBufferSend( StreamBufferHandle_t xStreamBuffer,
+                          const void * pvTxData,
+                          size_t xDataLengthBytes,
+                          TickType_t xTicksToWait )
+{
+    /* Like the kernel, wait for room for all of the data, then send what fits */
+    size_t xRequired = ( xDataLengthBytes < xStreamBuffer->xSize ) ? xDataLengthBytes : xStreamBuffer->xSize;
+    size_t xSent;
+
+    ( void ) pthread_mutex_lock( &( xStreamBuffer->xLock ) );
+
+    prvStreamBufferWait( xStreamBuffer, xRequired, 0, xTicksToWait );
+
+    xSent = xStreamBuffer->xSize - xStreamBuffer->xUsed;
+
+    if( xSent > xDataLengthBytes )
+    {
+        xSent = xDataLengthBytes;
+    }
+
+    if( xSent > 0 )
+    {
+        prvStreamBufferWrite( xStreamBuffer, xStreamBuffer->xUsed, pvTxData, xSent );
+        xStreamBuffer->xUsed += xSent;
+        ( void ) pthread_cond_broadcast( &( xStreamBuffer->xChanged ) );
+    }
+
+    ( void ) pthread_mutex_unlock( &( xStreamBuffer->xLock ) );
+
+    return xSent;
+}
+
+size_t xStreamBufferSendFromISR( StreamBufferHandle_t xStreamBuffer,
+                                 const void * pvTxData,
+                                 size_t xDataLengthBytes,
+                                 BaseType_t * pxHigherPriorityTaskWoken )
+{
+    if( pxHigherPriorityTaskWoken != NULL )
+    {
+        *pxHigherPriorityTaskWoken = pdTRUE;
+    }
+
+    return xStreamBufferSend( xStreamBuffer, pvTxData, xDataLengthBytes, 0 );
+}
+
+size_t xStreamBufferReceive( StreamBufferHandle_t xStreamBuffer,
+                             void * pvRxData,
+                             size_t xBufferLengthBytes,
+                             TickType_t xTicksToWait )
+{
+    size_t xReceived;
+
+    ( void ) pthread_mutex_lock( &( xStreamBuffer->xLock ) );
+
+    /* Like the kernel, a receiver which finds the buffer empty is woken once
+     * the trigger level is reached, and takes what is there on a timeout */
+    if( xStreamBuffer->xUsed == 0 )
+    {
+        prvStreamBufferWait( xStreamBuffer, 0, xStreamBuffer->xTriggerLevel, xTicksToWait );
+    }
+
+    xReceived = ( xStreamBuffer->xUsed < xBufferLengthBytes ) ? xStreamBuffer->xUsed : xBufferLengthBytes;
+
+    if( xReceived > 0 )
+    {
+        prvStreamBufferRead( xStreamBuffer, 0, pvRxData, xReceived );
+        xStreamBuffer->xHead = ( xStreamBuffer->xHead + xReceived ) % xStreamBuffer->xSize;
+        xStreamBuffer->xUsed -= xReceived;
+        ( void ) pthread_cond_broadcast( &( xStreamBuffer->xChanged ) );
+    }
+
+    ( void ) pthread_mutex_unlock( &( xStreamBuffer->xLock ) );
+
+    return xReceived;
+}
+
+size_t xStreamBufferBytesAvailable( StreamBufferHandle_t xStreamBuffer )
+{
+    size_t xUsed;
+
+    ( void ) pthread_mutex_lock( &( xStreamBuffer->xLock ) );
+    xUsed = xStreamBuffer->xUsed;
+    ( void ) pthread_mutex_unlock( &( xStreamBuffer->xLock ) );
+
+    return xUsed;
+}
+
+BaseType_t xStreamBufferIsEmpty( StreamBufferHandle_t xStreamBuffer )
+{
+    return ( xStreamBufferBytesAvailable( xStreamBuffer ) == 0 ) ? pdTRUE : pdFALSE;
+}
+
+MessageBufferHandle_t xMessageBufferCreate( size_t xBufferSizeBytes )
+{
+    configASSERT( xBufferSizeBytes > sizeof( size_t ) );
+
+    return xStreamBufferCreate( xBufferSizeBytes, 0 );
+}
+
+void vMessageBufferDelete( MessageBufferHandle_t xMessageBuffer )
+{
+    vStreamBufferDelete( xMessageBuffer );
+}
+
+size_t xMessageBufferSend( MessageBufferHandle_t xMessageBuffer,
+                           const void * pvTxData,
+                           size_t xDataLengthBytes,
+                           TickType_t xTicksToWait )
+{
+    size_t xRequired = xDataLengthBytes + sizeof( size_t );
+    size_t xSent = 0;
+
+    ( void ) pthread_mutex_lock( &( xMessageBuffer->xLock ) );
+
+    if( xRequired <= xMessageBuffer->xSize )
+    {
+        prvStreamBufferWait( xMessageBuffer, xRequired, 0, xTicksToWait );
+    }
+
+    if( ( xMessageBuffer->xSize - xMessageBuffer->xUsed ) >= xRequired )
+    {
+        prvStreamBufferWrite( xMessageBuffer, xMessageBuffer->xUsed, &xDataLengthBytes, sizeof( size_t ) );
+        prvStreamBufferWrite( xMessageBuffer, xMessageBuffer->xUsed + sizeof( size_t ), pvTxData, xDataLengthBytes );
+        xMessageBuffer->xUsed += xRequired;
+        ( void ) pthread_cond_broadcast( &( xMessageBuffer->xChanged ) );
+        xSent = xDataLengthBytes;
+    }
+
+    ( void ) pthread_mutex_unlock( &( xMessageBuffer->xLock ) );
+
+    return xSent;
+}
+
+size_t xMessageBufferReceive( MessageBufferHandle_t xMessageBuffer,
+                              void * pvRxData,
+                              size_t xBufferLengthBytes,
+                              TickType_t xTicksToWait )
+{
+    size_t xLength = 0;
+    size_t xReceived = 0;
+
+    ( void ) pthread_mutex_lock( &( xMessageBuffer->xLock ) );
+
+    prvStreamBufferWait( xMessageBuffer, 0, 1, xTicksToWait );
+
+    if( xMessageBuffer->xUsed > 0 )
+    {
+        prvStreamBufferRead( xMessageBuffer, 0, &xLength, sizeof( size_t ) );
+
+        /* A message too long for the receive buffer stays in the buffer */
+        if( xLength <= xBufferLengthBytes )
+        {
+            prvStreamBufferRead( xMessageBuffer, sizeof( size_t ), pvRxData, xLength );
+            xMessageBuffer->xHead = ( xMessageBuffer->xHead + xLength + sizeof( size_t ) ) % xMessageBuffer->xSize;
+            xMessageBuffer->xUsed -= xLength + sizeof( size_t );
+            ( void ) pthread_cond_broadcast( &( xMessageBuffer->xChanged ) );
+            xReceived = xLength;
+        }
+    }
+
+    ( void ) pthread_mutex_unlock( &( xMessageBuffer->xLock ) );
+
+    return xReceived;
+}
+
+/*-----------------------------------------------------------*/
+
+struct HostTimer
+{
+    struct HostTimer * pxNext;
+    TimerCallbackFunction_t pxCallback;
+    void * pvTimerID;
+    TickType_t xPeriod;
+    TickType_t xExpiry;
+    BaseType_t xAutoReload;
+    BaseType_t xActive;
+    BaseType_t xDeleted;
+};
+
+/* The daemon waits at most this long, so that it also follows ticks
+ * advanced by vHostKernelAdvanceTicks */
+#define HOST_TIMER_MAX_WAIT    pdMS_TO_TICKS( 10 )
+
+static pthread_mutex_t xTimerLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t xTimerChanged = PTHREAD_COND_INITIALIZER;
+static pthread_once_t xTimerDaemonOnce = PTHREAD_ONCE_INIT;
+static struct HostTimer * pxTimerList = NULL;
+static TaskHandle_t xTimerDaemonTask = NULL;
+
+/* Unlinks and frees the deleted timers, called with xTimerLock held */
+static void prvReapTimers( void )
+{
+    struct HostTimer ** ppxTimer = &pxTimerList;
+
+    while( *ppxTimer != NULL )
+    {
+        struct HostTimer * pxTimer = *ppxTimer;
+
+        if( pxTimer->xDeleted == pdTRUE )
+        {
+            *ppxTimer = pxTimer->pxNext;
+            free( pxTimer );
+        }
+        else
+        {
+            ppxTimer = &( pxTimer->pxNext );
+        }
+    }
+}
+
+static void prvTimerDaemonTask( void * pvParameters )
+{
+    ( void ) pvParameters;
+
+    ( void ) pthread_mutex_lock( &xTimerLock );
+
+    for( ; ; )
+    {
+        struct HostTimer * pxExpired = NULL;
+        TickType_t xWait = HOST_TIMER_MAX_WAIT;
+        TickType_t xNow = xTaskGetTickCount();
+        struct HostTimer * pxTimer;
+
+        prvReapTimers();
+
+        for( pxTimer = pxTimerList; ( pxTimer != NULL ) && ( pxExpired == NULL ); pxTimer = pxTimer->pxNext )
+        {
+            if( pxTimer->xActive == pdTRUE )
+            {
+                TickType_t xRemaining = pxTimer->xExpiry - xNow;
+
+                if( ( xRemaining == 0 ) || ( xRemaining > ( portMAX_DELAY / 2 ) ) )
+                {
+                    pxExpired = pxTimer;
+                }
+                else if( xRemaining < xWait )
+                {
+                    xWait = xRemaining;
+                }
+            }
+        }
+
+        if( pxExpired != NULL )
+        {
+            if( pxExpired->xAutoReload == pdTRUE )
+            {
+                pxExpired->xExpiry += pxExpired->xPeriod;
+            }
+            else
+            {
+                pxExpired->xActive = pdFALSE;
+            }
+
+            /* Deleted timers are only freed by this task, so the callback
+             * runs unlocked on a timer which still exists */
+            ( void ) pthread_mutex_unlock( &xTimerLock );
+            pxExpired->pxCallback( pxExpired );
+            ( void ) pthread_mutex_lock( &xTimerLock );
+        }
+        else
+        {
+            struct timespec xDeadline;
+
+            prvDeadline( xWait, &xDeadline );
+            ( void ) pthread_cond_timedwait( &xTimerChanged, &xTimerLock, &xDeadline );
+        }
+    }
+}
+
+static void prvStartTimerDaemon( void )
+{
+    BaseType_t xResult = xTaskCreate( prvTimerDaemonTask, "Tmr Svc", 0, NULL, 0, &xTimerDaemonTask );
+
+    configASSERT( xResult == pdPASS );
+}
+
+TimerHandle_t xTimerCreate( const char * const pcTimerName,
+                            const TickType_t xTimerPeriodInTicks,
+                            const BaseType_t xAutoReload,
+                            void * const pvTimerID,
+                            TimerCallbackFunction_t pxCallbackFunction )
+{
+    struct HostTimer * pxTimer;
+
+    ( void ) pcTimerName;
+
+    configASSERT( xTimerPeriodInTicks > 0 );
+
+    ( void ) pthread_once( &xTimerDaemonOnce, prvStartTimerDaemon );
+
+    pxTimer = ( struct HostTimer * ) calloc( 1, sizeof( struct HostTimer ) );
+
+    if( pxTimer != NULL )
+    {
+        pxTimer->pxCallback = pxCallbackFunction;
+        pxTimer->pvTimerID = pvTimerID;
+        pxTimer->xPeriod = xTimerPeriodInTicks;
+        pxTimer->xAutoReload = xAutoReload;
+
+        ( void ) pthread_mutex_lock( &xTimerLock );
+        pxTimer->pxNext = pxTimerList;
+        pxTimerList = pxTimer;
+        ( void ) pthread_mutex_unlock( &xTimerLock );
+    }
+
+    return pxTimer;
+}
+
+BaseType_t xTimerStart( TimerHandle_t xTimer,
+                        TickType_t xTicksToWait )
+{
+    ( void ) xTicksToWait;
+
+    ( void ) pthread_mutex_lock( &xTimerLock );
+    xTimer->xExpiry = xTaskGetTickCount() + xTimer->xPeriod;
+    xTimer->xActive = pdTRUE;
+    ( void ) pthread_cond_broadcast( &xTimerChanged );
+    ( void ) pthread_mutex_unlock( &xTimerLock );
+
+    return pdPASS;
+}
+
+BaseType_t xTimerStop( TimerHandle_t xTimer,
+                       TickType_t xTicksToWait )
+{
+    ( void ) xTicksToWait;
+
+    ( void ) pthread_mutex_lock( &xTimerLock );
+    xTimer->xActive = pdFALSE;
+    ( void ) pthread_mutex_unlock( &xTimerLock );
+
+    return pdPASS;
+}
+
+BaseType_t xTimerChangePeriod( TimerHandle_t xTimer,
+                               TickType_t xNewPeriod,
+                               TickType_t xTicksToWait )
+{
+    configASSERT( xNewPeriod > 0 );
+
+    ( void ) pthread_mutex_lock( &xTimerLock );
+    xTimer->xPeriod = xNewPeriod;
+    ( void ) pthread_mutex_unlock( &xTimerLock );
+
+    /* As in FreeRTOS, changing the period also starts the timer */
+    return xTimerStart( xTimer, xTicksToWait );
+}
+
+BaseType_t xTimerDelete( TimerHandle_t xTimer,
+                         TickType_t xTicksToWait )
+{
+    ( void ) xTicksToWait;
+
+    ( void ) pthread_mutex_lock( &xTimerLock );
+    xTimer->xActive = pdFALSE;
+    xTimer->xDeleted = pdTRUE;
+    ( void ) pthread_cond_broadcast( &xTimerChanged );
+    ( void ) pthread_mutex_unlock( &xTimerLock );
+
+    return pdPASS;
+}
+
+BaseType_t xTimerIsTimerActive( TimerHandle_t xTimer )
+{
+    BaseType_t xActive;
+
+    ( void ) pthread_mutex_lock( &xTimerLock );
+    xActive = xTimer->xActive;
+    ( void ) pthread_mutex_unlock( &xTimerLock );
+
+    return xActive;
+}
+
+void * pvTimerGetTimerID( const TimerHandle_t xTimer )
+{
+    return xTimer->pvTimerID;
+}
+
+TaskHandle_t xTimerGetTimerDaemonTaskHandle( void )
+{
+    return xTimerDaemonTask;
+}
+
+/*-----------------------------------------------------------*/
+
+#if HOST_KERNEL_STRLCPY == 1
+
+size_t strlcpy( char * pcDst,
+                const char * pcSrc,
+                size_t xSize )
+{
+    size_t xLen = strlen( pcSrc );
+
+    if( xSize > 0 )
+    {
+        size_t xCopy = ( xLen < xSize ) ? xLen : ( xSize - 1 );
+
+        ( void ) memcpy( pcDst, pcSrc, xCopy );
+        pcDst[ xCopy ] = '\0';
+    }
+
+    return xLen;
+}
+
+size_t strlcat( char * pcDst,
+                const char * pcSrc,
+                size_t xSize )
+{
+    size_t xDstLen = strnlen( pcDst, xSize );
+    size_t xLen = xDstLen + strlen( pcSrc );
+
+    if( xDstLen < xSize )
+    {
+        ( void ) strlcpy( &( pcDst[ xDstLen ] ), pcSrc, xSize - xDstLen );
+    }
+
+    return xLen;
+}
+
+#endif /* HOST_KERNEL_STRLCPY == 1 */
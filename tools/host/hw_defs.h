@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+/*
+ * Board definitions used by the modules built on the host. The EXTI
+ * callback registry, the DWT registers and SystemCoreClock are provided by
+ * the test which uses them. The HAL interface is in stm32u5xx_hal.h.
+ */
+
+#ifndef _HOST_HW_DEFS_H
+#define _HOST_HW_DEFS_H
+
+#include <stdint.h>
+
+#include "stm32u5xx_hal.h"
+
+#define LED_RED_Pin            GPIO_PIN_6
+#define LED_RED_GPIO_Port      GPIOH
+#define LED_GREEN_Pin          GPIO_PIN_7
+#define LED_GREEN_GPIO_Port    GPIOH
+
+#define ISM330_INT1_Pin        ( ( uint16_t ) 0x0800 )
+
+typedef struct
+{
+    volatile uint32_t CYCCNT;
+} HostDwt_t;
+
+extern HostDwt_t xHostDwt;
+extern uint32_t SystemCoreClock;
+
+#define DWT                ( &xHostDwt )
+
+typedef void ( * GPIOInterruptCallback_t ) ( void * pvContext );
+
+void GPIO_EXTI_Register_Callback( uint16_t usGpioPinMask,
+                                  GPIOInterruptCallback_t pvCallback,
+                                  void * pvContext );
+
+#endif /* _HOST_HW_DEFS_H */
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+/*
+ * Logging macros for the modules built on the host. Messages at or below
+ * the LOG_LEVEL of the including file are printed on stderr.
+ */
+
+#ifndef _HOST_LOGGING_H
+#define _HOST_LOGGING_H
+
+#include <stdio.h>
+
+#include "logging_levels.h"
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL    LOG_DEBUG
+#endif
+
+#define SdkLog( level, pcLevel, ... )                            \
+    do {                                                         \
+        if( LOG_LEVEL >= ( level ) )                             \
+        {                                                        \
+            fprintf( stderr, "<" pcLevel "> %s:%d ", __func__, __LINE__ ); \
+            fprintf( stderr, __VA_ARGS__ );                      \
+            fprintf( stderr, "\n" );                             \
+        }                                                        \
+    } while( 0 )
+
+#define LogSys( ... )      SdkLog( LOG_ERROR, "SYS", __VA_ARGS__ )
+#define LogError( ... )    SdkLog( LOG_ERROR, "ERR", __VA_ARGS__ )
+#define LogWarn( ... )     SdkLog( LOG_WARN, "WRN", __VA_ARGS__ )
+#define LogInfo( ... )     SdkLog( LOG_INFO, "INF", __VA_ARGS__ )
+#define LogDebug( ... )    SdkLog( LOG_DEBUG, "DBG", __VA_ARGS__ )
+
+#endif /* _HOST_LOGGING_H */
@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+/* See lwip/opt.h. Byte order helpers, the host is little endian like the target. */
+
+#ifndef _HOST_LWIP_DEF_H
+#define _HOST_LWIP_DEF_H
+
+#include "lwip/opt.h"
+
+#define PP_HTONS( x )    ( ( u16_t ) ( ( ( ( x ) & ( u16_t ) 0x00ffU ) << 8 ) | ( ( ( x ) & ( u16_t ) 0xff00U ) >> 8 ) ) )
+#define PP_NTOHS( x )    PP_HTONS( x )
+
+static inline u16_t lwip_htons( u16_t usValue )
+{
+    return PP_HTONS( usValue );
+}
+
+#define lwip_ntohs( x )    lwip_htons( x )
+
+#endif /* _HOST_LWIP_DEF_H */
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+/* See lwip/opt.h. Only the interface state used by the MXCHIP driver. */
+
+#ifndef _HOST_LWIP_NETIF_H
+#define _HOST_LWIP_NETIF_H
+
+#include "lwip/opt.h"
+#include "lwip/err.h"
+#include "lwip/pbuf.h"
+#include "netif/ethernet.h"
+
+#define NETIF_FLAG_UP           0x01U
+#define NETIF_FLAG_BROADCAST    0x02U
+#define NETIF_FLAG_LINK_UP      0x04U
+#define NETIF_FLAG_ETHARP       0x08U
+#define NETIF_FLAG_ETHERNET     0x10U
+
+struct ip4_addr
+{
+    u32_t addr;
+};
+
+typedef struct ip4_addr ip4_addr_t;
+typedef struct ip4_addr ip_addr_t;
+
+struct netif;
+
+typedef err_t ( * netif_input_fn )( struct pbuf * p,
+                                    struct netif * inp );
+typedef err_t ( * netif_output_fn )( struct netif * netif,
+                                     struct pbuf * p,
+                                     const ip4_addr_t * ipaddr );
+typedef err_t ( * netif_linkoutput_fn )( struct netif * netif,
+                                         struct pbuf * p );
+typedef void ( * netif_status_callback_fn )( struct netif * netif );
+
+struct netif
+{
+    ip_addr_t ip_addr;
+    ip_addr_t netmask;
+    ip_addr_t gw;
+    netif_input_fn input;
+    netif_output_fn output;
+    netif_linkoutput_fn linkoutput;
+    netif_status_callback_fn status_callback;
+    netif_status_callback_fn link_callback;
+    void * state;
+    void * dhcp;
+    u16_t mtu;
+    u8_t hwaddr_len;
+    u8_t hwaddr[ ETH_HWADDR_LEN ];
+    u8_t flags;
+    char name[ 2 ];
+    u8_t num;
+};
+
+static inline void netif_set_status_callback( struct netif * netif,
+                                              netif_status_callback_fn status_callback )
+{
+    netif->status_callback = status_callback;
+}
+
+static inline void netif_set_link_callback( struct netif * netif,
+                                            netif_status_callback_fn link_callback )
+{
+    netif->link_callback = link_callback;
+}
+
+#endif /* _HOST_LWIP_NETIF_H */
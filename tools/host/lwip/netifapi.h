@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+/* See lwip/opt.h. Declared for the inline helpers of mx_lwip.h, which the
+ * host tests do not call. */
+
+#ifndef _HOST_LWIP_NETIFAPI_H
+#define _HOST_LWIP_NETIFAPI_H
+
+#include "lwip/netif.h"
+
+err_t netifapi_netif_set_addr( struct netif * netif,
+                               const ip4_addr_t * ipaddr,
+                               const ip4_addr_t * netmask,
+                               const ip4_addr_t * gw );
+err_t netifapi_netif_set_up( struct netif * netif );
+err_t netifapi_netif_set_down( struct netif * netif );
+err_t netifapi_netif_set_link_up( struct netif * netif );
+err_t netifapi_netif_set_link_down( struct netif * netif );
+err_t netifapi_dhcp_start( struct netif * netif );
+
+#endif /* _HOST_LWIP_NETIFAPI_H */
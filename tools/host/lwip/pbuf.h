@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+/*
+ * See lwip/opt.h. A pbuf is a single buffer allocated from the heap of the
+ * test, so that the test sees leaked pbufs as heap in use. As in lwIP, the
+ * layer of an allocation reserves the header space below it. Chains and pools
+ * are not modelled.
+ */
+
+#ifndef _HOST_LWIP_PBUF_H
+#define _HOST_LWIP_PBUF_H
+
+#include "lwip/opt.h"
+#include "lwip/err.h"
+#include "task.h"
+
+#define PBUF_LINK_HLEN         14
+#define PBUF_IP_HLEN           20
+#define PBUF_TRANSPORT_HLEN    20
+
+/* The value of a layer is the header space reserved in front of the payload */
+typedef enum
+{
+    PBUF_TRANSPORT = PBUF_LINK_ENCAPSULATION_HLEN + PBUF_LINK_HLEN + PBUF_IP_HLEN + PBUF_TRANSPORT_HLEN,
+    PBUF_IP = PBUF_LINK_ENCAPSULATION_HLEN + PBUF_LINK_HLEN + PBUF_IP_HLEN,
+    PBUF_LINK = PBUF_LINK_ENCAPSULATION_HLEN + PBUF_LINK_HLEN,
+    PBUF_RAW_TX = PBUF_LINK_ENCAPSULATION_HLEN,
+    PBUF_RAW = 0
+} pbuf_layer;
+
+typedef enum
+{
+    PBUF_RAM,
+    PBUF_ROM,
+    PBUF_REF,
+    PBUF_POOL
+} pbuf_type;
+
+struct pbuf
+{
+    struct pbuf * next;
+    void * payload;
+    u16_t tot_len;
+    u16_t len;
+    u8_t type_internal;
+    u8_t flags;
+    u16_t ref;
+};
+
+static inline struct pbuf * pbuf_alloc( pbuf_layer xLayer,
+                                        u16_t usLength,
+                                        pbuf_type xType )
+{
+    struct pbuf * pxPbuf = ( struct pbuf * ) pvPortMalloc( sizeof( struct pbuf ) + ( size_t ) xLayer + usLength );
+
+    if( pxPbuf != NULL )
+    {
+        pxPbuf->next = NULL;
+        pxPbuf->payload = ( u8_t * ) &( pxPbuf[ 1 ] ) + ( size_t ) xLayer;
+        pxPbuf->tot_len = usLength;
+        pxPbuf->len = usLength;
+        pxPbuf->type_internal = ( u8_t ) xType;
+        pxPbuf->flags = 0;
+        pxPbuf->ref = 1;
+    }
+
+    return pxPbuf;
+}
+
+static inline void pbuf_ref( struct pbuf * pxPbuf )
+{
+    taskENTER_CRITICAL();
+    pxPbuf->ref++;
+    taskEXIT_CRITICAL();
+}
+
+/* Returns the number of pbufs freed */
+static inline u8_t pbuf_free( struct pbuf * pxPbuf )
+{
+    u16_t usRef;
+
+    taskENTER_CRITICAL();
+    usRef = --( pxPbuf->ref );
+    taskEXIT_CRITICAL();
+
+    if( usRef == 0 )
+    {
+        vPortFree( pxPbuf );
+    }
+
+    return ( usRef == 0 ) ? 1 : 0;
+}
+
+/* Returns nonzero if the pbuf is too short */
+static inline u8_t pbuf_remove_header( struct pbuf * pxPbuf,
+                                       size_t xSize )
+{
+    u8_t ucError = 1;
+
+    if( xSize <= pxPbuf->len )
+    {
+        pxPbuf->payload = ( u8_t * ) pxPbuf->payload + xSize;
+        pxPbuf->len -= ( u16_t ) xSize;
+        pxPbuf->tot_len -= ( u16_t ) xSize;
+        ucError = 0;
+    }
+
+    return ucError;
+}
+
+/* Returns nonzero if the header space in front of the payload is too short */
+static inline u8_t pbuf_add_header( struct pbuf * pxPbuf,
+                                    size_t xSize )
+{
+    u8_t ucError = 1;
+
+    if( xSize <= ( size_t ) ( ( u8_t * ) pxPbuf->payload - ( u8_t * ) &( pxPbuf[ 1 ] ) ) )
+    {
+        pxPbuf->payload = ( u8_t * ) pxPbuf->payload - xSize;
+        pxPbuf->len += ( u16_t ) xSize;
+        pxPbuf->tot_len += ( u16_t ) xSize;
+        ucError = 0;
+    }
+
+    return ucError;
+}
+
+static inline err_t pbuf_copy( struct pbuf * pxTo,
+                               const struct pbuf * pxFrom )
+{
+    err_t xError = ERR_ARG;
+
+    if( ( pxTo != NULL ) &&
+        ( pxFrom != NULL ) &&
+        ( pxTo->len >= pxFrom->len ) )
+    {
+        ( void ) memcpy( pxTo->payload, pxFrom->payload, pxFrom->len );
+        xError = ERR_OK;
+    }
+
+    return xError;
+}
+
+#endif /* _HOST_LWIP_PBUF_H */
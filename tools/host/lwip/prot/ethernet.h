@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+/* See lwip/opt.h. */
+
+#ifndef _HOST_LWIP_PROT_ETHERNET_H
+#define _HOST_LWIP_PROT_ETHERNET_H
+
+#include "lwip/opt.h"
+
+#define ETH_HWADDR_LEN    6
+
+struct eth_addr
+{
+    u8_t addr[ ETH_HWADDR_LEN ];
+};
+
+struct eth_hdr
+{
+    struct eth_addr dest;
+    struct eth_addr src;
+    u16_t type;
+};
+
+#define SIZEOF_ETH_HDR    14
+
+#define ETHTYPE_IP        0x0800U
+#define ETHTYPE_ARP       0x0806U
+#define ETHTYPE_IPV6      0x86DDU
+
+#endif /* _HOST_LWIP_PROT_ETHERNET_H */
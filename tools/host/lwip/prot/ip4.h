@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+/* See lwip/opt.h. Only the IPv4 header, options are not modelled. */
+
+#ifndef _HOST_LWIP_PROT_IP4_H
+#define _HOST_LWIP_PROT_IP4_H
+
+#include "lwip/opt.h"
+
+struct ip_hdr
+{
+    u8_t _v_hl;
+    u8_t _tos;
+    u16_t _len;
+    u16_t _id;
+    u16_t _offset;
+    u8_t _ttl;
+    u8_t _proto;
+    u16_t _chksum;
+    u32_t src;
+    u32_t dest;
+};
+
+#define IP_HLEN                     20
+
+#define IP_RF                       0x8000U
+#define IP_DF                       0x4000U
+#define IP_MF                       0x2000U
+#define IP_OFFMASK                  0x1fffU
+
+#define IPH_V( hdr )                ( ( hdr )->_v_hl >> 4 )
+#define IPH_HL( hdr )               ( ( hdr )->_v_hl & 0x0f )
+#define IPH_HL_BYTES( hdr )         ( ( u8_t ) ( IPH_HL( hdr ) * 4 ) )
+#define IPH_TOS( hdr )              ( ( hdr )->_tos )
+#define IPH_OFFSET( hdr )           ( ( hdr )->_offset )
+#define IPH_PROTO( hdr )            ( ( hdr )->_proto )
+
+#endif /* _HOST_LWIP_PROT_IP4_H */
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+/* See lwip/opt.h */
+
+#ifndef _HOST_LWIP_SYS_H
+#define _HOST_LWIP_SYS_H
+
+#include "lwip/opt.h"
+#include "lwip/err.h"
+#include "arch/sys_arch.h"
+
+#define SYS_ARCH_TIMEOUT    0xffffffffUL
+#define SYS_MBOX_EMPTY      SYS_ARCH_TIMEOUT
+
+void sys_init( void );
+u32_t sys_now( void );
+
+err_t sys_mbox_new( sys_mbox_t * mbox,
+                    int size );
+void sys_mbox_free( sys_mbox_t * mbox );
+void sys_mbox_post( sys_mbox_t * mbox,
+                    void * msg );
+err_t sys_mbox_trypost( sys_mbox_t * mbox,
+                        void * msg );
+err_t sys_mbox_trypost_fromisr( sys_mbox_t * mbox,
+                                void * msg );
+u32_t sys_arch_mbox_fetch( sys_mbox_t * mbox,
+                           void ** msg,
+                           u32_t timeout );
+u32_t sys_arch_mbox_tryfetch( sys_mbox_t * mbox,
+                              void ** msg );
+
+err_t sys_sem_new( sys_sem_t * sem,
+                   u8_t count );
+void sys_sem_signal( sys_sem_t * sem );
+u32_t sys_arch_sem_wait( sys_sem_t * sem,
+                         u32_t timeout );
+void sys_sem_free( sys_sem_t * sem );
+
+err_t sys_mutex_new( sys_mutex_t * mutex );
+void sys_mutex_lock( sys_mutex_t * mutex );
+void sys_mutex_unlock( sys_mutex_t * mutex );
+void sys_mutex_free( sys_mutex_t * mutex );
+
+sys_thread_t sys_thread_new( const char * name,
+                             void ( * thread )( void * arg ),
+                             void * arg,
+                             int stacksize,
+                             int prio );
+
+sys_prot_t sys_arch_protect( void );
+void sys_arch_unprotect( sys_prot_t pval );
+
+#endif /* _HOST_LWIP_SYS_H */
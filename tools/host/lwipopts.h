@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+/*
+ * lwIP options for building the lwIP port (Common/net/lwip_port) on the host.
+ * Only the options that the port itself tests are set, to the values of
+ * Common/config/lwipopts.h.
+ */
+
+#ifndef _HOST_LWIPOPTS_H
+#define _HOST_LWIPOPTS_H
+
+#ifndef LWIP_PERF
+#define LWIP_PERF                      0
+#endif
+
+#define SYS_STATS                      0
+#define PBUF_LINK_ENCAPSULATION_HLEN   28
+#define LWIP_NETCONN_SEM_PER_THREAD    1
+#define LWIP_NETCONN_FULLDUPLEX        1
+
+#endif /* _HOST_LWIPOPTS_H */
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+/*
+ * Queue interface of the host kernel shim, see FreeRTOS.h.
+ *
+ * A queue is a ring of fixed size items guarded by one POSIX mutex. Like the
+ * kernel, semaphores are queues of zero size items, see semphr.h. Blocked
+ * senders and receivers wait on a condition variable for one millisecond per
+ * tick of timeout, like notification waits, and the FromISR variants are
+ * plain calls that never block.
+ */
+
+#ifndef _HOST_QUEUE_H
+#define _HOST_QUEUE_H
+
+#include "FreeRTOS.h"
+
+typedef struct HostQueue * QueueHandle_t;
+
+QueueHandle_t xQueueCreate( UBaseType_t uxQueueLength,
+                            UBaseType_t uxItemSize );
+QueueHandle_t xQueueCreateCountingSemaphore( UBaseType_t uxMaxCount,
+                                             UBaseType_t uxInitialCount );
+void vQueueDelete( QueueHandle_t xQueue );
+
+BaseType_t xQueueSend( QueueHandle_t xQueue,
+                       const void * pvItemToQueue,
+                       TickType_t xTicksToWait );
+BaseType_t xQueueSendFromISR( QueueHandle_t xQueue,
+                              const void * pvItemToQueue,
+                              BaseType_t * pxHigherPriorityTaskWoken );
+BaseType_t xQueueReceive( QueueHandle_t xQueue,
+                          void * pvBuffer,
+                          TickType_t xTicksToWait );
+BaseType_t xQueueReceiveFromISR( QueueHandle_t xQueue,
+                                 void * pvBuffer,
+                                 BaseType_t * pxHigherPriorityTaskWoken );
+UBaseType_t uxQueueMessagesWaiting( QueueHandle_t xQueue );
+UBaseType_t uxQueueSpacesAvailable( QueueHandle_t xQueue );
+
+#define xQueueSendToBack( xQueue, pvItemToQueue, xTicksToWait ) \
+    xQueueSend( ( xQueue ), ( pvItemToQueue ), ( xTicksToWait ) )
+
+#endif /* _HOST_QUEUE_H */
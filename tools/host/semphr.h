@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+/*
+ * Semaphore interface of the host kernel shim, see FreeRTOS.h. Semaphores are
+ * queues of zero size items, see queue.h. A mutex is a binary semaphore that
+ * starts given: the host has no priorities, so there is nothing to inherit.
+ */
+
+#ifndef _HOST_SEMPHR_H
+#define _HOST_SEMPHR_H
+
+#include "FreeRTOS.h"
+#include "queue.h"
+
+typedef QueueHandle_t SemaphoreHandle_t;
+
+#define xSemaphoreCreateBinary()                              xQueueCreateCountingSemaphore( 1, 0 )
+#define xSemaphoreCreateCounting( uxMaxCount, uxInitialCount ) \
+    xQueueCreateCountingSemaphore( ( uxMaxCount ), ( uxInitialCount ) )
+#define xSemaphoreCreateMutex()                               xQueueCreateCountingSemaphore( 1, 1 )
+#define vSemaphoreCreateBinary( xSemaphore )                  ( ( xSemaphore ) = xQueueCreateCountingSemaphore( 1, 1 ) )
+#define vSemaphoreDelete( xSemaphore )                        vQueueDelete( xSemaphore )
+
+#define xSemaphoreTake( xSemaphore, xBlockTime )              xQueueReceive( ( xSemaphore ), NULL, ( xBlockTime ) )
+#define xSemaphoreGive( xSemaphore )                          xQueueSend( ( xSemaphore ), NULL, 0 )
+#define xSemaphoreGiveFromISR( xSemaphore, pxWoken )          xQueueSendFromISR( ( xSemaphore ), NULL, ( pxWoken ) )
+#define uxSemaphoreGetCount( xSemaphore )                     uxQueueMessagesWaiting( xSemaphore )
+
+typedef struct
+{
+    void * pvDummy[ 10 ];
+} StaticSemaphore_t;
+
+#endif /* _HOST_SEMPHR_H */
@@ -0,0 +1,298 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+/*
+ * STM32U5 HAL interface of the modules built on the host, included through
+ * hw_defs.h like the HAL on the target. Peripheral instances are addresses
+ * which are never dereferenced. Only the console UART with its GPDMA channel
+ * and the SPI link to the MXCHIP module are modelled, by mocks which the test
+ * using them provides. The UART mock moves the bytes and calls the interrupt
+ * handlers of the driver, which call back into HAL_UART_IRQHandler and
+ * HAL_DMA_IRQHandler as on the target. The SPI mock calls the callbacks
+ * registered with HAL_SPI_RegisterCallback when a transfer completes.
+ */
+
+#ifndef _HOST_STM32U5XX_HAL_H
+#define _HOST_STM32U5XX_HAL_H
+
+#include <stdint.h>
+
+typedef enum
+{
+    HAL_OK = 0x00U,
+    HAL_ERROR = 0x01U,
+    HAL_BUSY = 0x02U,
+    HAL_TIMEOUT = 0x03U
+} HAL_StatusTypeDef;
+
+typedef int32_t IRQn_Type;
+
+/* CMSIS */
+#define __DMB()    __sync_synchronize()
+
+#define GPDMA1_Channel6_IRQn    ( ( IRQn_Type ) 35 )
+#define USART1_IRQn             ( ( IRQn_Type ) 61 )
+
+/* Peripheral handles are opaque to the modules built on the host */
+typedef struct HostGpioPort       GPIO_TypeDef;
+typedef struct HostSpiHandle      SPI_HandleTypeDef;
+typedef struct HostUsart          USART_TypeDef;
+typedef struct HostDmaChannel     DMA_Channel_TypeDef;
+
+#define GPIOA              ( ( GPIO_TypeDef * ) 0x42020000UL )
+#define GPIOH              ( ( GPIO_TypeDef * ) 0x42021C00UL )
+#define USART1             ( ( USART_TypeDef * ) 0x40013800UL )
+#define GPDMA1_Channel6    ( ( DMA_Channel_TypeDef * ) 0x40020350UL )
+
+/* RCC, GPIO and NVIC: configuration only, the host has nothing to set up */
+typedef struct
+{
+    uint32_t PeriphClockSelection;
+    uint32_t Usart1ClockSelection;
+} RCC_PeriphCLKInitTypeDef;
+
+#define RCC_PERIPHCLK_USART1          0x00000001UL
+#define RCC_USART1CLKSOURCE_PCLK2     0x00000000UL
+
+#define __HAL_RCC_USART1_CLK_ENABLE()     do {} while( 0 )
+#define __HAL_RCC_USART1_CLK_DISABLE()    do {} while( 0 )
+#define __HAL_RCC_GPIOA_CLK_ENABLE()      do {} while( 0 )
+#define __HAL_RCC_GPDMA1_CLK_ENABLE()     do {} while( 0 )
+
+typedef enum
+{
+    GPIO_PIN_RESET = 0U,
+    GPIO_PIN_SET
+} GPIO_PinState;
+
+typedef struct
+{
+    uint32_t Pin;
+    uint32_t Mode;
+    uint32_t Pull;
+    uint32_t Speed;
+    uint32_t Alternate;
+} GPIO_InitTypeDef;
+
+#define GPIO_PIN_6               ( ( uint16_t ) 0x0040 )
+#define GPIO_PIN_7               ( ( uint16_t ) 0x0080 )
+#define GPIO_PIN_9               ( ( uint16_t ) 0x0200 )
+#define GPIO_PIN_10              ( ( uint16_t ) 0x0400 )
+#define GPIO_MODE_AF_PP          0x00000002UL
+#define GPIO_NOPULL              0x00000000UL
+#define GPIO_SPEED_FREQ_LOW      0x00000000UL
+#define GPIO_AF7_USART1          ( ( uint8_t ) 0x07 )
+
+HAL_StatusTypeDef HAL_RCCEx_PeriphCLKConfig( RCC_PeriphCLKInitTypeDef * pxPeriphClkInit );
+void HAL_GPIO_Init( GPIO_TypeDef * pxGpio,
+                    GPIO_InitTypeDef * pxInit );
+void HAL_GPIO_DeInit( GPIO_TypeDef * pxGpio,
+                      uint32_t ulPin );
+void HAL_GPIO_WritePin( GPIO_TypeDef * pxGpio,
+                        uint16_t usPin,
+                        GPIO_PinState xState );
+GPIO_PinState HAL_GPIO_ReadPin( GPIO_TypeDef * pxGpio,
+                                uint16_t usPin );
+void HAL_NVIC_SetPriority( IRQn_Type xIRQn,
+                           uint32_t ulPreemptPriority,
+                           uint32_t ulSubPriority );
+void HAL_NVIC_EnableIRQ( IRQn_Type xIRQn );
+void HAL_NVIC_DisableIRQ( IRQn_Type xIRQn );
+
+/* GPDMA */
+typedef struct
+{
+    uint32_t Request;
+    uint32_t BlkHWRequest;
+    uint32_t Direction;
+    uint32_t SrcInc;
+    uint32_t DestInc;
+    uint32_t SrcDataWidth;
+    uint32_t DestDataWidth;
+    uint32_t Priority;
+    uint32_t SrcBurstLength;
+    uint32_t DestBurstLength;
+    uint32_t TransferAllocatedPort;
+    uint32_t TransferEventMode;
+    uint32_t Mode;
+} DMA_InitTypeDef;
+
+typedef struct __DMA_HandleTypeDef
+{
+    DMA_Channel_TypeDef * Instance;
+    DMA_InitTypeDef Init;
+    void * Parent;
+} DMA_HandleTypeDef;
+
+#define GPDMA1_REQUEST_USART1_TX       25U
+#define DMA_BREQ_SINGLE_BURST          0x00000000UL
+#define DMA_MEMORY_TO_PERIPH           0x00000200UL
+#define DMA_SINC_INCREMENTED           0x00000008UL
+#define DMA_DINC_FIXED                 0x00000000UL
+#define DMA_SRC_DATAWIDTH_BYTE         0x00000000UL
+#define DMA_DEST_DATAWIDTH_BYTE        0x00000000UL
+#define DMA_LOW_PRIORITY_LOW_WEIGHT    0x00000000UL
+#define DMA_SRC_ALLOCATED_PORT0        0x00000000UL
+#define DMA_DEST_ALLOCATED_PORT1       0x00020000UL
+#define DMA_TCEM_BLOCK_TRANSFER        0x00000000UL
+#define DMA_NORMAL                     0x00U
+#define DMA_CHANNEL_NPRIV              0x20U
+
+#define __HAL_LINKDMA( __HANDLE__, __PPP_DMA_FIELD__, __DMA_HANDLE__ ) \
+    do {                                                              \
+        ( __HANDLE__ )->__PPP_DMA_FIELD__ = &( __DMA_HANDLE__ );      \
+        ( __DMA_HANDLE__ ).Parent = ( __HANDLE__ );                   \
+    } while( 0 )
+
+HAL_StatusTypeDef HAL_DMA_Init( DMA_HandleTypeDef * pxDma );
+HAL_StatusTypeDef HAL_DMA_DeInit( DMA_HandleTypeDef * pxDma );
+HAL_StatusTypeDef HAL_DMA_ConfigChannelAttributes( DMA_HandleTypeDef * pxDma,
+                                                   uint32_t ulChannelAttributes );
+void HAL_DMA_IRQHandler( DMA_HandleTypeDef * pxDma );
+
+/* SPI */
+typedef enum
+{
+    HAL_SPI_TX_COMPLETE_CB_ID = 0x00U,
+    HAL_SPI_RX_COMPLETE_CB_ID = 0x01U,
+    HAL_SPI_TX_RX_COMPLETE_CB_ID = 0x02U,
+    HAL_SPI_ERROR_CB_ID = 0x06U
+} HAL_SPI_CallbackIDTypeDef;
+
+typedef void ( * pSPI_CallbackTypeDef )( SPI_HandleTypeDef * hspi );
+
+HAL_StatusTypeDef HAL_SPI_RegisterCallback( SPI_HandleTypeDef * hspi,
+                                            HAL_SPI_CallbackIDTypeDef CallbackID,
+                                            pSPI_CallbackTypeDef pCallback );
+HAL_StatusTypeDef HAL_SPI_Transmit_DMA( SPI_HandleTypeDef * hspi,
+                                        const uint8_t * pData,
+                                        uint16_t Size );
+HAL_StatusTypeDef HAL_SPI_Receive_DMA( SPI_HandleTypeDef * hspi,
+                                       uint8_t * pData,
+                                       uint16_t Size );
+HAL_StatusTypeDef HAL_SPI_TransmitReceive_DMA( SPI_HandleTypeDef * hspi,
+                                               const uint8_t * pTxData,
+                                               uint8_t * pRxData,
+                                               uint16_t Size );
+
+/* UART */
+typedef struct
+{
+    uint32_t BaudRate;
+    uint32_t WordLength;
+    uint32_t StopBits;
+    uint32_t Parity;
+    uint32_t Mode;
+    uint32_t HwFlowCtl;
+    uint32_t OverSampling;
+    uint32_t OneBitSampling;
+    uint32_t ClockPrescaler;
+} UART_InitTypeDef;
+
+typedef struct
+{
+    uint32_t AdvFeatureInit;
+} UART_AdvFeatureInitTypeDef;
+
+typedef enum
+{
+    HAL_UART_STATE_RESET = 0x00U,
+    HAL_UART_STATE_READY = 0x20U,
+    HAL_UART_STATE_BUSY_TX = 0x21U
+} HAL_UART_StateTypeDef;
+
+typedef enum
+{
+    HAL_UART_TX_COMPLETE_CB_ID = 0x01U,
+    HAL_UART_ERROR_CB_ID = 0x04U,
+    HAL_UART_MSPINIT_CB_ID = 0x0BU,
+    HAL_UART_MSPDEINIT_CB_ID = 0x0CU
+} HAL_UART_CallbackIDTypeDef;
+
+typedef struct __UART_HandleTypeDef
+{
+    USART_TypeDef * Instance;
+    UART_InitTypeDef Init;
+    UART_AdvFeatureInitTypeDef AdvancedInit;
+    const uint8_t * pTxBuffPtr;
+    uint16_t TxXferSize;
+    volatile uint16_t TxXferCount;
+    uint8_t * pRxBuffPtr;
+    uint16_t RxXferSize;
+    uint32_t FifoMode;
+    uint16_t NbTxDataToProcess;
+    DMA_HandleTypeDef * hdmatx;
+    volatile HAL_UART_StateTypeDef gState;
+    void ( * TxCpltCallback )( struct __UART_HandleTypeDef * huart );
+    void ( * ErrorCallback )( struct __UART_HandleTypeDef * huart );
+    void ( * RxEventCallback )( struct __UART_HandleTypeDef * huart,
+                                uint16_t Pos );
+    void ( * MspInitCallback )( struct __UART_HandleTypeDef * huart );
+    void ( * MspDeInitCallback )( struct __UART_HandleTypeDef * huart );
+} UART_HandleTypeDef;
+
+typedef void ( * pUART_CallbackTypeDef )( UART_HandleTypeDef * huart );
+typedef void ( * pUART_RxEventCallbackTypeDef )( UART_HandleTypeDef * huart,
+                                                 uint16_t Pos );
+
+#define UART_WORDLENGTH_8B             0x00000000UL
+#define UART_STOPBITS_1                0x00000000UL
+#define UART_PARITY_NONE               0x00000000UL
+#define UART_MODE_TX_RX                0x0000000CUL
+#define UART_HWCONTROL_NONE            0x00000000UL
+#define UART_OVERSAMPLING_16           0x00000000UL
+#define UART_ONE_BIT_SAMPLE_DISABLE    0x00000000UL
+#define UART_PRESCALER_DIV1            0x00000000UL
+#define UART_ADVFEATURE_NO_INIT        0x00000000UL
+#define UART_TXFIFO_THRESHOLD_8_8      0xE0000000UL
+#define UART_RXFIFO_THRESHOLD_8_8      0x0A000000UL
+
+HAL_StatusTypeDef HAL_UART_Init( UART_HandleTypeDef * huart );
+HAL_StatusTypeDef HAL_UART_DeInit( UART_HandleTypeDef * huart );
+HAL_StatusTypeDef HAL_UART_RegisterCallback( UART_HandleTypeDef * huart,
+                                             HAL_UART_CallbackIDTypeDef CallbackID,
+                                             pUART_CallbackTypeDef pCallback );
+HAL_StatusTypeDef HAL_UART_RegisterRxEventCallback( UART_HandleTypeDef * huart,
+                                                    pUART_RxEventCallbackTypeDef pCallback );
+HAL_StatusTypeDef HAL_UART_Transmit( UART_HandleTypeDef * huart,
+                                     const uint8_t * pData,
+                                     uint16_t Size,
+                                     uint32_t Timeout );
+HAL_StatusTypeDef HAL_UART_Transmit_IT( UART_HandleTypeDef * huart,
+                                        const uint8_t * pData,
+                                        uint16_t Size );
+HAL_StatusTypeDef HAL_UART_Transmit_DMA( UART_HandleTypeDef * huart,
+                                         const uint8_t * pData,
+                                         uint16_t Size );
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_IT( UART_HandleTypeDef * huart,
+                                               uint8_t * pData,
+                                               uint16_t Size );
+HAL_StatusTypeDef HAL_UARTEx_SetTxFifoThreshold( UART_HandleTypeDef * huart,
+                                                 uint32_t Threshold );
+HAL_StatusTypeDef HAL_UARTEx_SetRxFifoThreshold( UART_HandleTypeDef * huart,
+                                                 uint32_t Threshold );
+HAL_StatusTypeDef HAL_UARTEx_EnableFifoMode( UART_HandleTypeDef * huart );
+void HAL_UART_IRQHandler( UART_HandleTypeDef * huart );
+
+#endif /* _HOST_STM32U5XX_HAL_H */
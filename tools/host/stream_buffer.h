@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+/*
+ * Stream buffer interface of the host kernel shim, see FreeRTOS.h.
+ *
+ * A stream buffer is a byte ring guarded by one POSIX mutex. As in the
+ * kernel, a receiver which finds the buffer empty waits for the trigger
+ * level, and a sender waits for room for all of its data, then sends what
+ * fits when it times out.
+ */
+
+#ifndef _HOST_STREAM_BUFFER_H
+#define _HOST_STREAM_BUFFER_H
+
+#include "FreeRTOS.h"
+
+typedef struct HostStreamBuffer * StreamBufferHandle_t;
+
+StreamBufferHandle_t xStreamBufferCreate( size_t xBufferSizeBytes,
+                                          size_t xTriggerLevelBytes );
+void vStreamBufferDelete( StreamBufferHandle_t xStreamBuffer );
+
+size_t xStreamBufferSend( StreamBufferHandle_t xStreamBuffer,
+                          const void * pvTxData,
+                          size_t xDataLengthBytes,
+                          TickType_t xTicksToWait );
+size_t xStreamBufferSendFromISR( StreamBufferHandle_t xStreamBuffer,
+                                 const void * pvTxData,
+                                 size_t xDataLengthBytes,
+                                 BaseType_t * pxHigherPriorityTaskWoken );
+size_t xStreamBufferReceive( StreamBufferHandle_t xStreamBuffer,
+                             void * pvRxData,
+                             size_t xBufferLengthBytes,
+                             TickType_t xTicksToWait );
+size_t xStreamBufferBytesAvailable( StreamBufferHandle_t xStreamBuffer );
+BaseType_t xStreamBufferIsEmpty( StreamBufferHandle_t xStreamBuffer );
+
+#endif /* _HOST_STREAM_BUFFER_H */
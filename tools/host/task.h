@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+/*
+ * Task interface of the host kernel shim, see FreeRTOS.h.
+ *
+ * Critical sections and scheduler suspension take one recursive mutex, so
+ * modules can be exercised from several POSIX threads. The tick count only
+ * advances when the test calls vHostKernelAdvanceTicks, and vTaskDelay
+ * advances it by the delay. Once the test calls vHostKernelStartRealTime, the
+ * tick count also follows the monotonic clock at one tick per millisecond and
+ * vTaskDelay blocks until the tick it is due, so that tasks can run side by
+ * side at their real rates.
+ *
+ * Every POSIX thread that calls xTaskGetCurrentTaskHandle becomes a task with
+ * its own notification array, and xTaskCreate starts a detached thread.
+ * Notification waits block on a condition variable for one millisecond per
+ * tick of timeout, independently of the simulated tick count, and interrupt
+ * handlers are plain calls from any thread. xTaskAbortDelay only ends a
+ * notification wait.
+ *
+ * The task list and thread local storage functions (uxTaskGetSystemState and
+ * friends) are only declared: a test that needs them provides them itself, as
+ * it provides the heap, so that it controls what every task reports.
+ */
+
+#ifndef _HOST_TASK_H
+#define _HOST_TASK_H
+
+#include "FreeRTOS.h"
+
+typedef void * TaskHandle_t;
+
+typedef void ( * TaskFunction_t )( void * pvParameters );
+
+typedef struct
+{
+    TickType_t xTimeOnEntering;
+} TimeOut_t;
+
+typedef enum
+{
+    eRunning = 0,
+    eReady,
+    eBlocked,
+    eSuspended,
+    eDeleted,
+    eInvalid
+} eTaskState;
+
+typedef struct xTASK_STATUS
+{
+    TaskHandle_t xHandle;
+    const char * pcTaskName;
+    UBaseType_t xTaskNumber;
+    eTaskState eCurrentState;
+    UBaseType_t uxCurrentPriority;
+    UBaseType_t uxBasePriority;
+    configRUN_TIME_COUNTER_TYPE ulRunTimeCounter;
+    void * pxStackBase;
+    configSTACK_DEPTH_TYPE usStackHighWaterMark;
+} TaskStatus_t;
+
+typedef enum
+{
+    eNoAction = 0,
+    eSetBits,
+    eIncrement,
+    eSetValueWithOverwrite,
+    eSetValueWithoutOverwrite
+} eNotifyAction;
+
+void vHostKernelEnterCritical( void );
+void vHostKernelExitCritical( void );
+
+#define taskENTER_CRITICAL()                      vHostKernelEnterCritical()
+#define taskEXIT_CRITICAL()                       vHostKernelExitCritical()
+#define taskENTER_CRITICAL_FROM_ISR()             ( vHostKernelEnterCritical(), ( UBaseType_t ) 0 )
+#define taskEXIT_CRITICAL_FROM_ISR( x )           do { ( void ) ( x ); vHostKernelExitCritical(); } while( 0 )
+#define portSET_INTERRUPT_MASK_FROM_ISR()         taskENTER_CRITICAL_FROM_ISR()
+#define portCLEAR_INTERRUPT_MASK_FROM_ISR( x )    taskEXIT_CRITICAL_FROM_ISR( x )
+
+void vTaskSuspendAll( void );
+BaseType_t xTaskResumeAll( void );
+
+/* Tasks run as soon as they are created, so the scheduler is always running */
+#define taskSCHEDULER_SUSPENDED      ( ( BaseType_t ) 0 )
+#define taskSCHEDULER_NOT_STARTED    ( ( BaseType_t ) 1 )
+#define taskSCHEDULER_RUNNING        ( ( BaseType_t ) 2 )
+
+BaseType_t xTaskGetSchedulerState( void );
+
+TickType_t xTaskGetTickCount( void );
+void vTaskDelay( TickType_t xTicksToDelay );
+
+void vTaskSetTimeOutState( TimeOut_t * const pxTimeOut );
+BaseType_t xTaskCheckForTimeOut( TimeOut_t * const pxTimeOut,
+                                 TickType_t * const pxTicksToWait );
+
+/* The host has no task stacks, always 0 */
+UBaseType_t uxTaskGetStackHighWaterMark( TaskHandle_t xTask );
+
+TaskHandle_t xTaskGetCurrentTaskHandle( void );
+char * pcTaskGetName( TaskHandle_t xTaskToQuery );
+
+/* The stack depth and priority are ignored */
+BaseType_t xTaskCreate( TaskFunction_t pxTaskCode,
+                        const char * const pcName,
+                        const configSTACK_DEPTH_TYPE usStackDepth,
+                        void * const pvParameters,
+                        UBaseType_t uxPriority,
+                        TaskHandle_t * const pxCreatedTask );
+
+/* Only a task may delete itself */
+void vTaskDelete( TaskHandle_t xTaskToDelete );
+
+BaseType_t xTaskAbortDelay( TaskHandle_t xTask );
+
+BaseType_t xTaskNotifyIndexed( TaskHandle_t xTaskToNotify,
+                               UBaseType_t uxIndexToNotify,
+                               uint32_t ulValue,
+                               eNotifyAction eAction );
+BaseType_t xTaskNotifyGiveIndexed( TaskHandle_t xTaskToNotify,
+                                   UBaseType_t uxIndexToNotify );
+BaseType_t xTaskNotifyIndexedFromISR( TaskHandle_t xTaskToNotify,
+                                      UBaseType_t uxIndexToNotify,
+                                      uint32_t ulValue,
+                                      eNotifyAction eAction,
+                                      BaseType_t * pxHigherPriorityTaskWoken );
+void vTaskNotifyGiveIndexedFromISR( TaskHandle_t xTaskToNotify,
+                                    UBaseType_t uxIndexToNotify,
+                                    BaseType_t * pxHigherPriorityTaskWoken );
+uint32_t ulTaskNotifyTakeIndexed( UBaseType_t uxIndexToWaitOn,
+                                  BaseType_t xClearCountOnExit,
+                                  TickType_t xTicksToWait );
+BaseType_t xTaskNotifyWaitIndexed( UBaseType_t uxIndexToWaitOn,
+                                   uint32_t ulBitsToClearOnEntry,
+                                   uint32_t ulBitsToClearOnExit,
+                                   uint32_t * pulNotificationValue,
+                                   TickType_t xTicksToWait );
+BaseType_t xTaskNotifyStateClearIndexed( TaskHandle_t xTask,
+                                         UBaseType_t uxIndexToClear );
+uint32_t ulTaskNotifyValueClearIndexed( TaskHandle_t xTask,
+                                        UBaseType_t uxIndexToClear,
+                                        uint32_t ulBitsToClear );
+
+/* Provided by the test */
+UBaseType_t uxTaskGetNumberOfTasks( void );
+UBaseType_t uxTaskGetSystemState( TaskStatus_t * const pxTaskStatusArray,
+                                  const UBaseType_t uxArraySize,
+                                  configRUN_TIME_COUNTER_TYPE * const pulTotalRunTime );
+void * pvTaskGetThreadLocalStoragePointer( TaskHandle_t xTaskToQuery,
+                                           BaseType_t xIndex );
+void vTaskSetThreadLocalStoragePointer( TaskHandle_t xTaskToSet,
+                                        BaseType_t xIndex,
+                                        void * pvValue );
+
+/* Test controls */
+void vHostKernelAdvanceTicks( TickType_t xTicks );
+void vHostKernelStartRealTime( void );
+
+#endif /* _HOST_TASK_H */
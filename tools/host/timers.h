@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+/*
+ * Software timer interface of the host kernel shim, see FreeRTOS.h.
+ *
+ * Callbacks run one at a time in a timer service task, started by the first
+ * xTimerCreate. Commands take effect at once instead of through the timer
+ * command queue, so their block times are ignored. Expiry times are in ticks
+ * of xTaskGetTickCount, so timers only run on time after
+ * vHostKernelStartRealTime.
+ */
+
+#ifndef _HOST_TIMERS_H
+#define _HOST_TIMERS_H
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+typedef struct HostTimer * TimerHandle_t;
+
+typedef void ( * TimerCallbackFunction_t )( TimerHandle_t xTimer );
+
+TimerHandle_t xTimerCreate( const char * const pcTimerName,
+                            const TickType_t xTimerPeriodInTicks,
+                            const BaseType_t xAutoReload,
+                            void * const pvTimerID,
+                            TimerCallbackFunction_t pxCallbackFunction );
+
+BaseType_t xTimerStart( TimerHandle_t xTimer,
+                        TickType_t xTicksToWait );
+BaseType_t xTimerStop( TimerHandle_t xTimer,
+                       TickType_t xTicksToWait );
+BaseType_t xTimerChangePeriod( TimerHandle_t xTimer,
+                               TickType_t xNewPeriod,
+                               TickType_t xTicksToWait );
+BaseType_t xTimerDelete( TimerHandle_t xTimer,
+                         TickType_t xTicksToWait );
+BaseType_t xTimerIsTimerActive( TimerHandle_t xTimer );
+void * pvTimerGetTimerID( const TimerHandle_t xTimer );
+TaskHandle_t xTimerGetTimerDaemonTaskHandle( void );
+
+#define xTimerReset( xTimer, xTicksToWait )    xTimerStart( ( xTimer ), ( xTicksToWait ) )
+
+#endif /* _HOST_TIMERS_H */
@@ -0,0 +1,581 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+/*
+ * Host test of the batched IMU sampling in Common/app/imu_fifo.c.
+ *
+ * The ST ISM330DLC driver is built unmodified on top of a register model of
+ * the sensor, which implements the FIFO control and status registers, the
+ * rolling FIFO_DATA_OUT read, stream mode overflow (oldest words dropped,
+ * over_run flag set) and the INT1 watermark interrupt, delivered through the
+ * EXTI callback registered by the module. Checks:
+ * 1. Init: the watermark is clamped to 1 .. IMU_FIFO_MAX_SAMPLES sets, the
+ *    FIFO is put in stream mode and the watermark is routed to INT1.
+ * 2. Watermark: the consumer is notified once when the level crosses it.
+ * 3. Read: sets come out in order, converted with the driver sensitivities,
+ *    in bursts of 32 sets, and no more than ulMaxSamples at a time.
+ * 4. Overrun: after the FIFO drops words mid set the read realigns on the
+ *    next gyro x word, counts the overrun and returns only whole sets.
+ * 5. Threads: a producer thread fills the FIFO while the consumer waits on
+ *    the watermark and drains it, without losing or reordering sets.
+ * 6. Errors: a bus error fails init, which releases INT1, and fails reads.
+ *
+ * Exits with a failure status if any check fails.
+ *
+ * Build and run from the repository root:
+ *   cc -O2 -Itools/host -ICommon/include -ICommon/cli -IDrivers/BSP/Components/ism330dlc tools/imu_fifo_test.c \
+ *      Common/app/imu_fifo.c Drivers/BSP/Components/ism330dlc/ism330dlc.c \
+ *      Drivers/BSP/Components/ism330dlc/ism330dlc_reg.c tools/host/host_kernel.c -lpthread -o imu_fifo_test
+ *   ./imu_fifo_test [sets]
+ */
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "hw_defs.h"
+#include "imu_fifo.h"
+
+#include "b_u585i_iot02a_motion_sensors.h"
+
+#define TEST_FIFO_WORDS       2048U /* 4 kB of 16 bit words */
+#define TEST_SET_WORDS        6U
+#define TEST_SET_MODULO       4096U
+#define TEST_ODR_HZ           104.0f
+
+#define TEST_FIFO_MODE_MASK   0x07
+#define TEST_INT1_FTH         0x08
+#define TEST_STATUS2_OVR      0x40
+#define TEST_STATUS2_EMPTY    0x10
+#define TEST_STATUS2_WATERM   0x80
+
+typedef struct
+{
+    pthread_mutex_t xLock;
+    uint8_t pucRegs[ 0x80 ];
+    int16_t psFifo[ TEST_FIFO_WORDS ];
+    uint32_t ulHead;      /* Index of the oldest word in psFifo */
+    uint32_t ulCount;     /* Words in the FIFO */
+    uint32_t ulHeadSeq;   /* Position in the stream of the oldest word */
+    uint32_t ulNextSet;   /* Set number of the next set to be sampled */
+    bool xOverrun;
+    bool xBusError;
+    uint32_t ulDataReads; /* FIFO_DATA_OUT transactions */
+} TestSensor_t;
+
+static TestSensor_t xSensor =
+{
+    .xLock = PTHREAD_MUTEX_INITIALIZER
+};
+
+static ISM330DLC_Object_t xSensorObj;
+
+void * Motion_Sensor_CompObj[ MOTION_SENSOR_INSTANCES_NBR ] = { &xSensorObj };
+
+static GPIOInterruptCallback_t pxInt1Callback = NULL;
+static void * pvInt1Context = NULL;
+
+static uint32_t ulFailures = 0;
+
+/*-----------------------------------------------------------*/
+
+static void prvCheck( bool xCondition,
+                      const char * pcWhat )
+{
+    if( !xCondition )
+    {
+        printf( "FAIL: %s\n", pcWhat );
+        ulFailures++;
+    }
+}
+
+void GPIO_EXTI_Register_Callback( uint16_t usGpioPinMask,
+                                  GPIOInterruptCallback_t pvCallback,
+                                  void * pvContext )
+{
+    configASSERT( usGpioPinMask == ISM330_INT1_Pin );
+
+    pxInt1Callback = pvCallback;
+    pvInt1Context = pvContext;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Raw value of word ulWord (gyro x, y, z, accel x, y, z) of set ulSet */
+static int16_t prvSampleWord( uint32_t ulSet,
+                              uint32_t ulWord )
+{
+    return ( int16_t ) ( ( ( ulSet % TEST_SET_MODULO ) * 8U ) + ulWord );
+}
+
+/* Watermark in words, from FIFO_CTRL1 and FIFO_CTRL2 */
+static uint32_t prvWatermark( void )
+{
+    return ( ( uint32_t ) ( xSensor.pucRegs[ ISM330DLC_FIFO_CTRL2 ] & 0x07 ) << 8 ) |
+           xSensor.pucRegs[ ISM330DLC_FIFO_CTRL1 ];
+}
+
+static bool prvStreaming( void )
+{
+    return ( xSensor.pucRegs[ ISM330DLC_FIFO_CTRL5 ] & TEST_FIFO_MODE_MASK ) == ISM330DLC_STREAM_MODE;
+}
+
+static void prvUpdateStatus( void )
+{
+    uint32_t ulPattern = xSensor.ulHeadSeq % TEST_SET_WORDS;
+    uint8_t ucStatus2 = ( uint8_t ) ( ( xSensor.ulCount >> 8 ) & 0x07 );
+
+    if( xSensor.ulCount == 0 )
+    {
+        ucStatus2 |= TEST_STATUS2_EMPTY;
+    }
+
+    if( xSensor.xOverrun )
+    {
+        ucStatus2 |= TEST_STATUS2_OVR;
+    }
+
+    if( ( prvWatermark() != 0 ) && ( xSensor.ulCount >= prvWatermark() ) )
+    {
+        ucStatus2 |= TEST_STATUS2_WATERM;
+    }
+
+    xSensor.pucRegs[ ISM330DLC_FIFO_STATUS1 ] = ( uint8_t ) ( xSensor.ulCount & 0xFF );
+    xSensor.pucRegs[ ISM330DLC_FIFO_STATUS2 ] = ucStatus2;
+    xSensor.pucRegs[ ISM330DLC_FIFO_STATUS3 ] = ( uint8_t ) ( ulPattern & 0xFF );
+    xSensor.pucRegs[ ISM330DLC_FIFO_STATUS4 ] = ( uint8_t ) ( ulPattern >> 8 );
+}
+
+static void prvFifoClear( void )
+{
+    xSensor.ulHead = 0;
+    xSensor.ulCount = 0;
+    xSensor.ulHeadSeq = 0;
+    xSensor.xOverrun = false;
+}
+
+static int32_t prvWriteReg( void * pvHandle,
+                            uint8_t ucReg,
+                            uint8_t * pucData,
+                            uint16_t usLen )
+{
+    int32_t lResult = 0;
+
+    ( void ) pvHandle;
+
+    ( void ) pthread_mutex_lock( &xSensor.xLock );
+
+    if( xSensor.xBusError )
+    {
+        lResult = -1;
+    }
+    else
+    {
+        for( uint16_t i = 0; ( i < usLen ) && ( ( ucReg + i ) < sizeof( xSensor.pucRegs ) ); i++ )
+        {
+            xSensor.pucRegs[ ucReg + i ] = pucData[ i ];
+        }
+
+        /* Bypass mode empties the FIFO */
+        if( !prvStreaming() )
+        {
+            prvFifoClear();
+        }
+
+        prvUpdateStatus();
+    }
+
+    ( void ) pthread_mutex_unlock( &xSensor.xLock );
+
+    return lResult;
+}
+
+static int32_t prvReadReg( void * pvHandle,
+                           uint8_t ucReg,
+                           uint8_t * pucData,
+                           uint16_t usLen )
+{
+    int32_t lResult = 0;
+
+    ( void ) pvHandle;
+
+    ( void ) pthread_mutex_lock( &xSensor.xLock );
+
+    if( xSensor.xBusError )
+    {
+        lResult = -1;
+    }
+    else if( ucReg == ISM330DLC_FIFO_DATA_OUT_L )
+    {
+        /* The output register rolls over, every word read pops the FIFO */
+        xSensor.ulDataReads++;
+
+        for( uint16_t i = 0; ( i + 1U ) < usLen; i += 2U )
+        {
+            int16_t sWord = 0;
+
+            if( xSensor.ulCount > 0 )
+            {
+                sWord = xSensor.psFifo[ xSensor.ulHead ];
+                xSensor.ulHead = ( xSensor.ulHead + 1U ) % TEST_FIFO_WORDS;
+                xSensor.ulCount--;
+                xSensor.ulHeadSeq++;
+                xSensor.xOverrun = false;
+            }
+
+            ( void ) memcpy( &pucData[ i ], &sWord, sizeof( sWord ) );
+        }
+
+        prvUpdateStatus();
+    }
+    else
+    {
+        for( uint16_t i = 0; i < usLen; i++ )
+        {
+            pucData[ i ] = ( ( ucReg + i ) < sizeof( xSensor.pucRegs ) ) ? xSensor.pucRegs[ ucReg + i ] : 0;
+        }
+    }
+
+    ( void ) pthread_mutex_unlock( &xSensor.xLock );
+
+    return lResult;
+}
+
+/* Sample ulSets sets into the FIFO and raise INT1 when the watermark is crossed */
+static void prvSensorSample( uint32_t ulSets )
+{
+    bool xRaiseInt1 = false;
+
+    ( void ) pthread_mutex_lock( &xSensor.xLock );
+
+    for( uint32_t ulSet = 0; ( ulSet < ulSets ) && prvStreaming(); ulSet++ )
+    {
+        bool xBelow = xSensor.ulCount < prvWatermark();
+
+        for( uint32_t ulWord = 0; ulWord < TEST_SET_WORDS; ulWord++ )
+        {
+            if( xSensor.ulCount == TEST_FIFO_WORDS )
+            {
+                xSensor.ulHead = ( xSensor.ulHead + 1U ) % TEST_FIFO_WORDS;
+                xSensor.ulCount--;
+                xSensor.ulHeadSeq++;
+                xSensor.xOverrun = true;
+            }
+
+            xSensor.psFifo[ ( xSensor.ulHead + xSensor.ulCount ) % TEST_FIFO_WORDS ] = prvSampleWord( xSensor.ulNextSet, ulWord );
+            xSensor.ulCount++;
+        }
+
+        xSensor.ulNextSet++;
+
+        if( xBelow && ( xSensor.ulCount >= prvWatermark() ) &&
+            ( ( xSensor.pucRegs[ ISM330DLC_INT1_CTRL ] & TEST_INT1_FTH ) != 0 ) )
+        {
+            xRaiseInt1 = true;
+        }
+    }
+
+    prvUpdateStatus();
+
+    ( void ) pthread_mutex_unlock( &xSensor.xLock );
+
+    if( xRaiseInt1 && ( pxInt1Callback != NULL ) )
+    {
+        pxInt1Callback( pvInt1Context );
+    }
+}
+
+static void prvSensorReset( void )
+{
+    ( void ) pthread_mutex_lock( &xSensor.xLock );
+
+    ( void ) memset( xSensor.pucRegs, 0, sizeof( xSensor.pucRegs ) );
+    prvFifoClear();
+    xSensor.ulNextSet = 0;
+    xSensor.xBusError = false;
+    xSensor.ulDataReads = 0;
+    prvUpdateStatus();
+
+    ( void ) pthread_mutex_unlock( &xSensor.xLock );
+
+    ( void ) memset( &xSensorObj, 0, sizeof( xSensorObj ) );
+    xSensorObj.Ctx.write_reg = prvWriteReg;
+    xSensorObj.Ctx.read_reg = prvReadReg;
+    xSensorObj.Ctx.handle = &xSensor;
+    xSensorObj.is_initialized = 1;
+    xSensorObj.acc_is_enabled = 1;
+    xSensorObj.gyro_is_enabled = 1;
+
+    pxInt1Callback = NULL;
+    pvInt1Context = NULL;
+}
+
+static void prvSetBusError( bool xBusError )
+{
+    ( void ) pthread_mutex_lock( &xSensor.xLock );
+    xSensor.xBusError = xBusError;
+    ( void ) pthread_mutex_unlock( &xSensor.xLock );
+}
+
+/*-----------------------------------------------------------*/
+
+/* Set number of a sample set read by the module, or -1 if the set is not
+ * made of the six words of a single sampled set */
+static int32_t prvDecodeSet( const int32_t plSample[ IMU_FIFO_NUM_AXES ] )
+{
+    int32_t lSet = -1;
+    int32_t lGyroX = ( int32_t ) ( ( float ) prvSampleWord( 0, 0 ) * ISM330DLC_GYRO_SENSITIVITY_FS_250DPS );
+    int32_t lStep = ( int32_t ) ( ( float ) prvSampleWord( 1, 0 ) * ISM330DLC_GYRO_SENSITIVITY_FS_250DPS ) - lGyroX;
+
+    if( ( plSample[ 3 ] >= 0 ) && ( ( plSample[ 3 ] % lStep ) == 0 ) )
+    {
+        uint32_t ulSet = ( uint32_t ) ( plSample[ 3 ] / lStep );
+        bool xMatch = true;
+
+        for( uint32_t ulAxis = 0; ulAxis < 3; ulAxis++ )
+        {
+            xMatch &= ( plSample[ ulAxis ] == ( int32_t ) ( ( float ) prvSampleWord( ulSet, 3 + ulAxis ) * ISM330DLC_ACC_SENSITIVITY_FS_2G ) );
+            xMatch &= ( plSample[ 3 + ulAxis ] == ( int32_t ) ( ( float ) prvSampleWord( ulSet, ulAxis ) * ISM330DLC_GYRO_SENSITIVITY_FS_250DPS ) );
+        }
+
+        lSet = xMatch ? ( int32_t ) ulSet : -1;
+    }
+
+    return lSet;
+}
+
+/* Check that ulCount sets follow each other starting at set ulFirst */
+static bool prvSetsInOrder( int32_t plSamples[][ IMU_FIFO_NUM_AXES ],
+                            uint32_t ulCount,
+                            uint32_t ulFirst )
+{
+    bool xInOrder = true;
+
+    for( uint32_t i = 0; i < ulCount; i++ )
+    {
+        xInOrder &= ( prvDecodeSet( plSamples[ i ] ) == ( int32_t ) ( ( ulFirst + i ) % TEST_SET_MODULO ) );
+    }
+
+    return xInOrder;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvTestInit( void )
+{
+    prvSensorReset();
+    prvCheck( xImuFifoInit( TEST_ODR_HZ, 0 ) == pdTRUE, "init" );
+    prvCheck( prvWatermark() == TEST_SET_WORDS, "watermark of 0 clamped to one set" );
+
+    prvCheck( xImuFifoInit( TEST_ODR_HZ, 1000 ) == pdTRUE, "re-init" );
+    prvCheck( prvWatermark() == IMU_FIFO_MAX_SAMPLES * TEST_SET_WORDS, "watermark clamped to the FIFO size" );
+    prvCheck( prvStreaming(), "stream mode" );
+    prvCheck( ( xSensor.pucRegs[ ISM330DLC_INT1_CTRL ] & TEST_INT1_FTH ) != 0, "watermark routed to INT1" );
+    prvCheck( pxInt1Callback != NULL, "INT1 callback registered" );
+    prvCheck( ( xSensor.pucRegs[ ISM330DLC_CTRL1_XL ] >> 4 ) == ISM330DLC_XL_ODR_104Hz, "accelerometer ODR" );
+    prvCheck( ( xSensor.pucRegs[ ISM330DLC_FIFO_CTRL5 ] >> 3 ) == ISM330DLC_FIFO_104Hz, "FIFO ODR" );
+
+    vImuFifoDeinit();
+    prvCheck( pxInt1Callback == NULL, "deinit releases the INT1 callback" );
+    prvCheck( ( xSensor.pucRegs[ ISM330DLC_INT1_CTRL ] & TEST_INT1_FTH ) == 0, "deinit unroutes the watermark" );
+    prvCheck( !prvStreaming(), "deinit returns to bypass mode" );
+}
+
+static void prvTestWatermark( void )
+{
+    int32_t plSamples[ IMU_FIFO_MAX_SAMPLES ][ IMU_FIFO_NUM_AXES ];
+
+    prvSensorReset();
+    prvCheck( xImuFifoInit( TEST_ODR_HZ, 10 ) == pdTRUE, "init" );
+
+    prvSensorSample( 9 );
+    prvCheck( xImuFifoWait( 0 ) == pdFALSE, "no notification below the watermark" );
+
+    prvSensorSample( 1 );
+    prvCheck( xImuFifoWait( 0 ) == pdTRUE, "notification at the watermark" );
+
+    prvSensorSample( 5 );
+    prvCheck( xImuFifoWait( 0 ) == pdFALSE, "single notification above the watermark" );
+
+    prvCheck( ulImuFifoRead( plSamples, IMU_FIFO_MAX_SAMPLES ) == 15, "all sets read" );
+    prvCheck( prvSetsInOrder( plSamples, 15, 0 ), "sets in order" );
+
+    prvSensorSample( 10 );
+    prvCheck( xImuFifoWait( 0 ) == pdTRUE, "notification after the FIFO was drained" );
+
+    vImuFifoDeinit();
+}
+
+static void prvTestRead( void )
+{
+    int32_t plSamples[ IMU_FIFO_MAX_SAMPLES ][ IMU_FIFO_NUM_AXES ];
+
+    prvSensorReset();
+    prvCheck( xImuFifoInit( TEST_ODR_HZ, IMU_FIFO_MAX_SAMPLES ) == pdTRUE, "init" );
+
+    prvSensorSample( 100 );
+    xSensor.ulDataReads = 0;
+    prvCheck( ulImuFifoRead( plSamples, IMU_FIFO_MAX_SAMPLES ) == 100, "100 sets read" );
+    prvCheck( xSensor.ulDataReads == 4, "100 sets read in 4 bursts" );
+    prvCheck( prvSetsInOrder( plSamples, 100, 0 ), "sets in order and converted" );
+    prvCheck( xSensor.ulCount == 0, "FIFO drained" );
+
+    prvSensorSample( 50 );
+    prvCheck( ulImuFifoRead( plSamples, 20 ) == 20, "read limited to ulMaxSamples" );
+    prvCheck( prvSetsInOrder( plSamples, 20, 100 ), "first part in order" );
+    prvCheck( xSensor.ulCount == 30 * TEST_SET_WORDS, "rest left in the FIFO" );
+    prvCheck( ulImuFifoRead( plSamples, IMU_FIFO_MAX_SAMPLES ) == 30, "rest read" );
+    prvCheck( prvSetsInOrder( plSamples, 30, 120 ), "rest in order" );
+    prvCheck( ulImuFifoRead( plSamples, IMU_FIFO_MAX_SAMPLES ) == 0, "empty FIFO" );
+    prvCheck( ulImuFifoGetOverruns() == 0, "no overrun" );
+
+    vImuFifoDeinit();
+}
+
+static void prvTestOverrun( void )
+{
+    int32_t plSamples[ IMU_FIFO_MAX_SAMPLES ][ IMU_FIFO_NUM_AXES ];
+    uint32_t ulRead;
+    int32_t lFirst;
+
+    prvSensorReset();
+    prvCheck( xImuFifoInit( TEST_ODR_HZ, IMU_FIFO_MAX_SAMPLES ) == pdTRUE, "init" );
+
+    /* 2048 words is not a whole number of sets, so the oldest set is cut */
+    prvSensorSample( 400 );
+    prvCheck( ( xSensor.ulHeadSeq % TEST_SET_WORDS ) != 0, "FIFO starts mid set" );
+
+    ulRead = ulImuFifoRead( plSamples, IMU_FIFO_MAX_SAMPLES );
+    lFirst = prvDecodeSet( plSamples[ 0 ] );
+
+    prvCheck( ulImuFifoGetOverruns() == 1, "overrun counted" );
+    prvCheck( ulRead == ( TEST_FIFO_WORDS / TEST_SET_WORDS ), "whole sets read after the overrun" );
+    prvCheck( lFirst == ( int32_t ) ( 400 - ulRead ), "read realigned on the oldest whole set" );
+    prvCheck( ( lFirst >= 0 ) && prvSetsInOrder( plSamples, ulRead, ( uint32_t ) lFirst ), "sets consistent after the overrun" );
+
+    prvSensorSample( 10 );
+    prvCheck( ulImuFifoRead( plSamples, IMU_FIFO_MAX_SAMPLES ) == 10, "read after the overrun" );
+    prvCheck( prvSetsInOrder( plSamples, 10, 400 ), "sets in order after the overrun" );
+    prvCheck( ulImuFifoGetOverruns() == 1, "overrun flag cleared" );
+
+    vImuFifoDeinit();
+}
+
+static void * prvProducerThread( void * pvSets )
+{
+    uint32_t ulSets = *( uint32_t * ) pvSets;
+    struct timespec xPeriod = { 0, 20000 };
+
+    for( uint32_t i = 0; i < ulSets; i++ )
+    {
+        prvSensorSample( 1 );
+        ( void ) nanosleep( &xPeriod, NULL );
+    }
+
+    return NULL;
+}
+
+static void prvTestThreads( uint32_t ulSets )
+{
+    static int32_t plSamples[ IMU_FIFO_MAX_SAMPLES ][ IMU_FIFO_NUM_AXES ];
+    pthread_t xProducer;
+    uint32_t ulReceived = 0;
+    bool xInOrder = true;
+
+    prvSensorReset();
+    prvCheck( xImuFifoInit( TEST_ODR_HZ, 16 ) == pdTRUE, "init" );
+
+    prvCheck( pthread_create( &xProducer, NULL, prvProducerThread, &ulSets ) == 0, "producer thread" );
+
+    /* The last sets stay below the watermark, so stop waiting on a timeout */
+    while( ( ulReceived < ulSets ) && ( xImuFifoWait( pdMS_TO_TICKS( 200 ) ) == pdTRUE ) )
+    {
+        uint32_t ulRead = ulImuFifoRead( plSamples, IMU_FIFO_MAX_SAMPLES );
+
+        xInOrder &= prvSetsInOrder( plSamples, ulRead, ulReceived );
+        ulReceived += ulRead;
+    }
+
+    ( void ) pthread_join( xProducer, NULL );
+
+    ulReceived += ulImuFifoRead( plSamples, IMU_FIFO_MAX_SAMPLES );
+
+    prvCheck( ulReceived == ulSets, "every set received" );
+    prvCheck( xInOrder, "sets received in order" );
+    prvCheck( ulImuFifoGetOverruns() == 0, "no overrun with a waiting consumer" );
+
+    vImuFifoDeinit();
+}
+
+static void prvTestErrors( void )
+{
+    int32_t plSamples[ IMU_FIFO_MAX_SAMPLES ][ IMU_FIFO_NUM_AXES ];
+
+    prvSensorReset();
+    prvSetBusError( true );
+    prvCheck( xImuFifoInit( TEST_ODR_HZ, 10 ) == pdFALSE, "init fails on a bus error" );
+    prvCheck( pxInt1Callback == NULL, "failed init releases the INT1 callback" );
+
+    prvSetBusError( false );
+    prvCheck( xImuFifoInit( TEST_ODR_HZ, 10 ) == pdTRUE, "init" );
+    prvSensorSample( 20 );
+
+    prvSetBusError( true );
+    prvCheck( ulImuFifoRead( plSamples, IMU_FIFO_MAX_SAMPLES ) == 0, "read fails on a bus error" );
+
+    prvSetBusError( false );
+    prvCheck( ulImuFifoRead( plSamples, IMU_FIFO_MAX_SAMPLES ) == 20, "read after the bus error" );
+
+    vImuFifoDeinit();
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    uint32_t ulSets = 5000U;
+
+    if( argc > 1 )
+    {
+        ulSets = ( uint32_t ) strtoul( argv[ 1 ], NULL, 10 );
+    }
+
+    prvTestInit();
+    prvTestWatermark();
+    prvTestRead();
+    prvTestOverrun();
+    prvTestThreads( ulSets );
+    prvTestErrors();
+
+    printf( "%s (%lu failures)\n", ( ulFailures == 0 ) ? "PASS" : "FAIL", ( unsigned long ) ulFailures );
+
+    return ( ulFailures == 0 ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,256 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+/*
+ * Host benchmark for the single pass shadow document scanner (json_scan).
+ *
+ * Generates shadow delta documents from about 200 bytes to 8 KB with nested
+ * desired state and times locating N registered properties:
+ *   scan    one xJsonScan pass filling all N fields
+ *   rescan  a validation pass followed by one pass per field, the cost
+ *           pattern of JSON_Validate followed by one JSON_Search per field
+ * after checking that paths are matched one key at a time, so that "a.b"
+ * does not match a key named "a.b", and that ulJsonScanToUInt32 rejects
+ * values above UINT32_MAX.
+ *
+ * Build and run from the repository root:
+ *   cc -O2 -ICommon/include tools/json_scan_bench.c Common/app/json_scan.c -o json_scan_bench
+ *   ./json_scan_bench [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "json_scan.h"
+
+#define BENCH_MAX_DOC       ( 8192 )
+#define BENCH_MAX_FIELDS    ( 16 )
+
+static const size_t pxDocSizes[] = { 200, 512, 1024, 2048, 4096, 8192 };
+static const size_t pxFieldCounts[] = { 2, 8, 16 };
+
+static char pcPaths[ BENCH_MAX_FIELDS ][ 32 ];
+
+/*-----------------------------------------------------------*/
+
+static double prvNow( void )
+{
+    struct timespec xNow;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &xNow );
+
+    return ( double ) xNow.tv_sec + ( ( double ) xNow.tv_nsec * 1e-9 );
+}
+
+/*
+ * { "state": { "powerOn": 1, "p0": 0, ..., "cfg0": { "a": [ 1, 2, 3 ], "b": { "c": "text" } }, ... },
+ *   "metadata": { ... }, "version": 12, "timestamp": 1595437367, "clientToken": "388062" }
+ * padded with nested configuration objects until the document reaches xTarget bytes.
+ */
+static size_t prvBuildDoc( char * pcDoc,
+                           size_t xTarget )
+{
+    const char * pcTail = "},\"version\":12,\"timestamp\":1595437367,\"clientToken\":\"388062\"}";
+    size_t xLen = 0;
+    uint32_t i = 0;
+
+    xLen += ( size_t ) snprintf( &( pcDoc[ xLen ] ), BENCH_MAX_DOC - xLen, "{\"state\":{\"powerOn\":1" );
+
+    for( i = 0; i < BENCH_MAX_FIELDS; i++ )
+    {
+        xLen += ( size_t ) snprintf( &( pcDoc[ xLen ] ), BENCH_MAX_DOC - xLen, ",\"p%u\":%u", i, i * 7 );
+    }
+
+    for( i = 0; ; i++ )
+    {
+        char pcCfg[ 160 ];
+        int lCfgLen = snprintf( pcCfg, sizeof( pcCfg ),
+                                ",\"cfg%u\":{\"a\":[1,2,3],\"b\":{\"c\":\"text %u\",\"d\":{\"e\":true,\"f\":null}}}", i, i );
+
+        if( xLen + ( size_t ) lCfgLen + strlen( pcTail ) >= xTarget )
+        {
+            break;
+        }
+
+        memcpy( &( pcDoc[ xLen ] ), pcCfg, ( size_t ) lCfgLen );
+        xLen += ( size_t ) lCfgLen;
+    }
+
+    xLen += ( size_t ) snprintf( &( pcDoc[ xLen ] ), BENCH_MAX_DOC - xLen, "%s", pcTail );
+
+    return xLen;
+}
+
+/* Each segment of a path matches one whole key, 7 means not found */
+static int prvCheckPathSegments( void )
+{
+    static const struct
+    {
+        const char * pcDoc;
+        const char * pcPath;
+        uint32_t ulExpected;
+    } pxCases[] =
+    {
+        { "{\"a.b\":1,\"a\":{\"b\":2}}",         "a.b",           2 },
+        { "{\"a.b\":1}",                         "a.b",           7 },
+        { "{\"a\":{\"b.c\":3}}",                 "a.b.c",         7 },
+        { "{\"a\":{\"b.c\":3}}",                 "a.b",           7 },
+        { "{\"ab\":{\"c\":1},\"a\":{\"bc\":2}}", "a.bc",          2 },
+        { "{\"a\":{\"bc\":1,\"b\":2}}",          "a.b",           2 },
+        { "{\"state\":{\"powerOn\":1}}",         "state.powerOn", 1 }
+    };
+    JsonScanField_t xField = { .pcPath = NULL };
+    int lResult = 0;
+
+    for( size_t i = 0; i < sizeof( pxCases ) / sizeof( pxCases[ 0 ] ); i++ )
+    {
+        xField.pcPath = pxCases[ i ].pcPath;
+
+        if( ( xJsonScan( pxCases[ i ].pcDoc, strlen( pxCases[ i ].pcDoc ), &xField, 1 ) != JSON_SCAN_SUCCESS ) ||
+            ( ulJsonScanToUInt32( &xField, 7 ) != pxCases[ i ].ulExpected ) )
+        {
+            fprintf( stderr, "path %s wrong for %s\n", pxCases[ i ].pcPath, pxCases[ i ].pcDoc );
+            lResult = 1;
+        }
+    }
+
+    return lResult;
+}
+
+/* Version numbers and client tokens at and beyond the uint32_t range */
+static int prvCheckToUInt32( void )
+{
+    static const struct
+    {
+        const char * pcDoc;
+        uint32_t ulExpected;
+    } pxCases[] =
+    {
+        { "{\"version\":4294967295}",  4294967295UL },
+        { "{\"version\":4294967296}",  7            },
+        { "{\"version\":99999999999}", 7            },
+        { "{\"version\":\"12\"}",     12           }
+    };
+    JsonScanField_t xField = { .pcPath = "version" };
+    int lResult = 0;
+
+    for( size_t i = 0; i < sizeof( pxCases ) / sizeof( pxCases[ 0 ] ); i++ )
+    {
+        if( ( xJsonScan( pxCases[ i ].pcDoc, strlen( pxCases[ i ].pcDoc ), &xField, 1 ) != JSON_SCAN_SUCCESS ) ||
+            ( ulJsonScanToUInt32( &xField, 7 ) != pxCases[ i ].ulExpected ) )
+        {
+            fprintf( stderr, "ulJsonScanToUInt32 wrong for %s\n", pxCases[ i ].pcDoc );
+            lResult = 1;
+        }
+    }
+
+    return lResult;
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    static char pcDoc[ BENCH_MAX_DOC + 1 ];
+    JsonScanField_t pxFields[ BENCH_MAX_FIELDS ];
+    long lIterations = ( argc > 1 ) ? strtol( argv[ 1 ], NULL, 10 ) : 20000;
+
+    /* The version, the handled property, then properties spread through the document */
+    ( void ) snprintf( pcPaths[ 0 ], sizeof( pcPaths[ 0 ] ), "version" );
+    ( void ) snprintf( pcPaths[ 1 ], sizeof( pcPaths[ 1 ] ), "state.powerOn" );
+
+    for( uint32_t i = 2; i < BENCH_MAX_FIELDS; i++ )
+    {
+        ( void ) snprintf( pcPaths[ i ], sizeof( pcPaths[ i ] ), "state.p%u", BENCH_MAX_FIELDS - i );
+    }
+
+    for( uint32_t i = 0; i < BENCH_MAX_FIELDS; i++ )
+    {
+        pxFields[ i ].pcPath = pcPaths[ i ];
+        pxFields[ i ].xHandler = NULL;
+    }
+
+    if( ( prvCheckPathSegments() != 0 ) || ( prvCheckToUInt32() != 0 ) )
+    {
+        return 1;
+    }
+
+    printf( "%8s %6s %12s %12s %8s\n", "bytes", "fields", "scan_us", "rescan_us", "speedup" );
+
+    for( size_t d = 0; d < sizeof( pxDocSizes ) / sizeof( pxDocSizes[ 0 ] ); d++ )
+    {
+        size_t xDocLen = prvBuildDoc( pcDoc, pxDocSizes[ d ] );
+
+        for( size_t f = 0; f < sizeof( pxFieldCounts ) / sizeof( pxFieldCounts[ 0 ] ); f++ )
+        {
+            size_t xNumFields = pxFieldCounts[ f ];
+            double dStart, dScan, dRescan;
+
+            if( xJsonScan( pcDoc, xDocLen, pxFields, xNumFields ) != JSON_SCAN_SUCCESS )
+            {
+                fprintf( stderr, "Generated document is invalid\n" );
+                return 1;
+            }
+
+            for( size_t i = 0; i < xNumFields; i++ )
+            {
+                if( pxFields[ i ].xType == JSON_SCAN_NOT_FOUND )
+                {
+                    fprintf( stderr, "Field %s not found\n", pxFields[ i ].pcPath );
+                    return 1;
+                }
+            }
+
+            dStart = prvNow();
+
+            for( long i = 0; i < lIterations; i++ )
+            {
+                ( void ) xJsonScan( pcDoc, xDocLen, pxFields, xNumFields );
+            }
+
+            dScan = ( prvNow() - dStart ) * 1e6 / ( double ) lIterations;
+
+            dStart = prvNow();
+
+            for( long i = 0; i < lIterations; i++ )
+            {
+                ( void ) xJsonScan( pcDoc, xDocLen, NULL, 0 );
+
+                for( size_t j = 0; j < xNumFields; j++ )
+                {
+                    ( void ) xJsonScan( pcDoc, xDocLen, &( pxFields[ j ] ), 1 );
+                }
+            }
+
+            dRescan = ( prvNow() - dStart ) * 1e6 / ( double ) lIterations;
+
+            printf( "%8zu %6zu %12.2f %12.2f %7.1fx\n", xDocLen, xNumFields, dScan, dRescan, dRescan / dScan );
+        }
+    }
+
+    return 0;
+}
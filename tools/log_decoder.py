@@ -0,0 +1,254 @@
+#!python
+#  FreeRTOS STM32 Reference Integration
+#
+#  Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+#
+#  Permission is hereby granted, free of charge, to any person obtaining a copy of
+#  this software and associated documentation files (the "Software"), to deal in
+#  the Software without restriction, including without limitation the rights to
+#  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+#  the Software, and to permit persons to whom the Software is furnished to do so,
+#  subject to the following conditions:
+#
+#  The above copyright notice and this permission notice shall be included in all
+#  copies or substantial portions of the Software.
+#
+#  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+#  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+#  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+#  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+#  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+#  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#
+#  https://www.FreeRTOS.org
+#  https://github.com/FreeRTOS
+"""Decode binary deferred log records (LOGGING_DEFERRED_BINARY).
+
+Console lines starting with "@@" carry a base64 encoded record holding the
+address of a LogSite_t, a timestamp, the task name and the raw printf
+arguments. The call site, format string and file name are read back from the
+firmware ELF file and the line is printed the same way the device would have
+formatted it. All other lines are passed through unchanged.
+"""
+
+import base64
+import re
+import struct
+import sys
+from argparse import ArgumentParser
+
+LINE_PREFIX = "@@"
+RECORD_TAG = 0xB1
+FLAG_TRUNCATED = 0x1
+
+SHF_ALLOC = 0x2
+SHT_NOBITS = 8
+
+# Mirrors prvPackArgs() in Common/cli/logging.c
+CONVERSION_RE = re.compile(
+    r"%(?P<flags>[-+ #0]*)(?P<width>\*|\d+)?(?:\.(?P<prec>\*|\d*))?"
+    r"(?P<length>hh|h|ll|l|j|z|t|L)?(?P<conv>[diuxXocpsfFeEgGaAn%])"
+)
+
+
+class ElfImage(object):
+    """Minimal little endian ELF32 reader for allocated sections."""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            self.data = f.read()
+
+        if self.data[:4] != b"\x7fELF" or self.data[4] != 1 or self.data[5] != 1:
+            raise ValueError("{} is not a little endian ELF32 file".format(path))
+
+        (e_shoff,) = struct.unpack_from("<I", self.data, 0x20)
+        (e_shentsize, e_shnum) = struct.unpack_from("<HH", self.data, 0x2E)
+
+        self.sections = []
+        for i in range(e_shnum):
+            (
+                _name,
+                sh_type,
+                sh_flags,
+                sh_addr,
+                sh_offset,
+                sh_size,
+            ) = struct.unpack_from("<IIIIII", self.data, e_shoff + i * e_shentsize)
+            if (sh_flags & SHF_ALLOC) and sh_type != SHT_NOBITS and sh_size > 0:
+                self.sections.append((sh_addr, sh_size, sh_offset))
+
+    def read(self, addr, length):
+        for (sh_addr, sh_size, sh_offset) in self.sections:
+            if sh_addr <= addr and addr + length <= sh_addr + sh_size:
+                start = sh_offset + addr - sh_addr
+                return self.data[start : start + length]
+        raise KeyError("0x{:08X} not found in ELF".format(addr))
+
+    def read_u32(self, addr):
+        return struct.unpack("<I", self.read(addr, 4))[0]
+
+    def read_string(self, addr):
+        for (sh_addr, sh_size, sh_offset) in self.sections:
+            if sh_addr <= addr < sh_addr + sh_size:
+                start = sh_offset + addr - sh_addr
+                end = self.data.index(b"\x00", start)
+                return self.data[start:end].decode("utf-8", errors="replace")
+        raise KeyError("0x{:08X} not found in ELF".format(addr))
+
+
+class RecordReader(object):
+    def __init__(self, payload):
+        self.payload = payload
+        self.offset = 0
+
+    def take(self, fmt):
+        size = struct.calcsize(fmt)
+        if self.offset + size > len(self.payload):
+            raise EOFError
+        (value,) = struct.unpack_from(fmt, self.payload, self.offset)
+        self.offset += size
+        return value
+
+    def take_string(self):
+        end = self.payload.find(b"\x00", self.offset)
+        if end < 0:
+            raise EOFError
+        value = self.payload[self.offset : end].decode("utf-8", errors="replace")
+        self.offset = end + 1
+        return value
+
+
+def format_message(fmt, reader):
+    """Expand fmt with arguments unpacked from reader, like vsnprintf()."""
+    out = []
+    pos = 0
+    truncated = False
+
+    for match in CONVERSION_RE.finditer(fmt):
+        out.append(fmt[pos : match.start()])
+        pos = match.end()
+        conv = match.group("conv")
+
+        if conv == "%":
+            out.append("%")
+            continue
+
+        if truncated:
+            out.append("?")
+            continue
+
+        try:
+            width = match.group("width") or ""
+            prec = match.group("prec")
+            if width == "*":
+                width = str(reader.take("<i"))
+            if prec == "*":
+                prec = str(reader.take("<i"))
+            spec = "%" + match.group("flags") + width
+            if prec is not None:
+                spec += "." + prec
+
+            length = match.group("length") or ""
+            is_long_long = length in ("ll", "j")
+
+            if conv in "di":
+                value = reader.take("<q" if is_long_long else "<i")
+                out.append((spec + "d") % value)
+            elif conv in "uxXo":
+                value = reader.take("<Q" if is_long_long else "<I")
+                out.append((spec + ("d" if conv == "u" else conv)) % value)
+            elif conv == "c":
+                value = reader.take("<q" if is_long_long else "<I")
+                out.append((spec + "c") % chr(value & 0xFF))
+            elif conv == "p":
+                out.append("0x{:08x}".format(reader.take("<I")))
+            elif conv == "s":
+                out.append((spec + "s") % reader.take_string())
+            elif conv in "fFeEgGaA":
+                value = reader.take("<d")
+                out.append((spec + conv.replace("a", "e").replace("A", "E")) % value)
+        except EOFError:
+            truncated = True
+            out.append("?")
+
+    out.append(fmt[pos:])
+    return "".join(out)
+
+
+def decode_record(elf, payload):
+    reader = RecordReader(payload)
+
+    if reader.take("<B") != RECORD_TAG:
+        raise ValueError("bad record tag")
+
+    flags = reader.take("<B")
+    site_addr = reader.take("<I")
+    timestamp = reader.take("<I")
+    task_name = reader.take_string()
+
+    level = elf.read_string(elf.read_u32(site_addr))
+    file_name = elf.read_string(elf.read_u32(site_addr + 4))
+    line_number = elf.read_u32(site_addr + 8)
+    fmt = elf.read_string(elf.read_u32(site_addr + 12))
+
+    message = format_message(fmt, reader).rstrip("\r\n")
+
+    if flags & FLAG_TRUNCATED:
+        message += " [truncated]"
+
+    return "<{:<3.3s}> {:8d} [{:<10.10s}] {} ({}:{})".format(
+        level,
+        timestamp & 0xFFFFFF,
+        task_name,
+        message,
+        file_name.split("/")[-1],
+        line_number,
+    )
+
+
+def decode_line(elf, line):
+    idx = line.find(LINE_PREFIX)
+    if idx < 0:
+        return line
+
+    try:
+        payload = base64.b64decode(line[idx + len(LINE_PREFIX) :].strip())
+        return line[:idx] + decode_record(elf, payload)
+    except (ValueError, KeyError, EOFError) as err:
+        return "{} <undecodable: {}>".format(line, err)
+
+
+def main():
+    argparser = ArgumentParser(description=__doc__.splitlines()[0])
+    argparser.add_argument("elf_file", help="Firmware ELF file the log came from.")
+    argparser.add_argument(
+        "input_file",
+        help="Captured console output. Defaults to stdin.",
+        nargs="?",
+    )
+    argparser.add_argument(
+        "--port", "-p", help="Read directly from this serial port instead."
+    )
+    argparser.add_argument(
+        "--baud", "-b", help="Serial port baud rate.", type=int, default=115200
+    )
+    args = argparser.parse_args()
+
+    elf = ElfImage(args.elf_file)
+
+    if args.port:
+        import serial
+
+        with serial.Serial(args.port, args.baud) as port:
+            while True:
+                line = port.readline().decode("utf-8", errors="replace")
+                print(decode_line(elf, line.rstrip("\r\n")), flush=True)
+    else:
+        stream = open(args.input_file, "r") if args.input_file else sys.stdin
+        with stream:
+            for line in stream:
+                print(decode_line(elf, line.rstrip("\r\n")))
+
+
+if __name__ == "__main__":
+    main()
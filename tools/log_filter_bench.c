@@ -0,0 +1,212 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+/*
+ * Host test and benchmark of the runtime log level check of Common/cli/logging.h.
+ *
+ * This file includes logging.h first, as every firmware file does through
+ * FreeRTOSConfig.h, and only then the lwIP config header arch/cc.h, which
+ * selects the net module for the lwIP sources. The test provides the
+ * runtime levels and a vLoggingPrintf that formats into a buffer like the
+ * console path does. Checks:
+ * 1. Module: the module chosen by cc.h applies although logging.h was
+ *    included before it.
+ * 2. Filter: a call below the runtime level of its module neither reaches
+ *    vLoggingPrintf nor evaluates its arguments, and a call at the level does.
+ * 3. Cost: time per filtered out call, per passing call and per empty loop
+ *    iteration. A compiler barrier in every iteration makes each call load the
+ *    level again, as it does between other code on the target.
+ *
+ * Exits with a failure status if any check fails.
+ *
+ * Build and run from the repository root:
+ *   cc -O2 -ICommon/cli -Itools/host -ICommon/include -ICommon/net/lwip_port/include \
+ *      tools/log_filter_bench.c -o log_filter_bench
+ *   ./log_filter_bench [calls]
+ */
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "logging.h"
+#include "arch/cc.h"
+
+#define TEST_DEFAULT_CALLS    2000000U
+#define TEST_LINE_LEN         256U
+
+#define TEST_BARRIER()    __asm__ volatile ( "" ::: "memory" )
+
+uint8_t pucLogModuleLevels[ LOG_MODULE_MAX ];
+
+static uint32_t ulFailures = 0;
+static uint32_t ulPrinted = 0;
+static uint32_t ulArgsEvaluated = 0;
+static char cLine[ TEST_LINE_LEN ];
+
+/*-----------------------------------------------------------*/
+
+static void prvCheck( bool xCondition,
+                      const char * pcWhat )
+{
+    if( !xCondition )
+    {
+        printf( "FAIL: %s\n", pcWhat );
+        ulFailures++;
+    }
+}
+
+void * pvPortMalloc( size_t xWantedSize )
+{
+    return malloc( xWantedSize );
+}
+
+void vPortFree( void * pv )
+{
+    free( pv );
+}
+
+void vLoggingPrintf( const char * const pcLogLevel,
+                     const char * const pcFunctionName,
+                     const unsigned long ulLineNumber,
+                     const char * const pcFormat,
+                     ... )
+{
+    va_list xArgs;
+    int lLen;
+
+    lLen = snprintf( cLine, sizeof( cLine ), "<%s> %s:%lu ", pcLogLevel, pcFunctionName, ulLineNumber );
+
+    va_start( xArgs, pcFormat );
+    ( void ) vsnprintf( &( cLine[ lLen ] ), sizeof( cLine ) - ( size_t ) lLen, pcFormat, xArgs );
+    va_end( xArgs );
+
+    ulPrinted++;
+}
+
+static uint32_t prvArg( uint32_t ulValue )
+{
+    ulArgsEvaluated++;
+
+    return ulValue;
+}
+
+static uint64_t prvNowNs( void )
+{
+    struct timespec xNow;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &xNow );
+
+    return ( ( uint64_t ) xNow.tv_sec * 1000000000U ) + ( uint64_t ) xNow.tv_nsec;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvTestModule( void )
+{
+    prvCheck( LOG_MODULE == LOG_MODULE_NET, "arch/cc.h selects the net module after logging.h" );
+}
+
+static void prvTestFilter( void )
+{
+    ulPrinted = 0;
+    ulArgsEvaluated = 0;
+
+    pucLogModuleLevels[ LOG_MODULE_DEFAULT ] = LOG_DEBUG;
+    pucLogModuleLevels[ LOG_MODULE_NET ] = LOG_ERROR;
+
+    LogDebug( "filtered out %u", ( unsigned int ) prvArg( 1 ) );
+    prvCheck( ( ulPrinted == 0 ) && ( ulArgsEvaluated == 0 ),
+              "a call below the runtime level is dropped before its arguments are evaluated" );
+
+    LogError( "passes %u", ( unsigned int ) prvArg( 2 ) );
+    prvCheck( ( ulPrinted == 1 ) && ( ulArgsEvaluated == 1 ), "a call at the runtime level is printed" );
+}
+
+static void prvBenchCost( uint32_t ulCalls )
+{
+    uint32_t ulCall;
+    uint64_t ullStartNs;
+    double xEmptyNs, xFilteredNs, xPassingNs;
+
+    pucLogModuleLevels[ LOG_MODULE_NET ] = LOG_ERROR;
+
+    ullStartNs = prvNowNs();
+
+    for( ulCall = 0; ulCall < ulCalls; ulCall++ )
+    {
+        TEST_BARRIER();
+    }
+
+    xEmptyNs = ( double ) ( prvNowNs() - ullStartNs ) / ( double ) ulCalls;
+
+    ulPrinted = 0;
+    ullStartNs = prvNowNs();
+
+    for( ulCall = 0; ulCall < ulCalls; ulCall++ )
+    {
+        TEST_BARRIER();
+        LogDebug( "rx %lu bytes from %08lx port %u", ( unsigned long ) ulCall, 0xC0A80001UL, 8883U );
+    }
+
+    xFilteredNs = ( double ) ( prvNowNs() - ullStartNs ) / ( double ) ulCalls;
+    prvCheck( ulPrinted == 0, "no filtered out call is printed" );
+
+    ullStartNs = prvNowNs();
+
+    for( ulCall = 0; ulCall < ( ulCalls / 10U ); ulCall++ )
+    {
+        TEST_BARRIER();
+        LogError( "rx %lu bytes from %08lx port %u", ( unsigned long ) ulCall, 0xC0A80001UL, 8883U );
+    }
+
+    xPassingNs = ( double ) ( prvNowNs() - ullStartNs ) / ( double ) ( ulCalls / 10U );
+    prvCheck( ulPrinted == ( ulCalls / 10U ), "every passing call is printed" );
+
+    printf( "cost        %lu calls: empty loop %.2f ns, filtered out %.2f ns, passing %.1f ns per call\n",
+            ( unsigned long ) ulCalls, xEmptyNs, xFilteredNs, xPassingNs );
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    uint32_t ulCalls = TEST_DEFAULT_CALLS;
+
+    if( argc > 1 )
+    {
+        ulCalls = ( uint32_t ) strtoul( argv[ 1 ], NULL, 10 );
+    }
+
+    prvTestModule();
+    prvTestFilter();
+    prvBenchCost( ulCalls );
+
+    printf( "%s (%lu failures)\n", ( ulFailures == 0 ) ? "PASS" : "FAIL", ( unsigned long ) ulFailures );
+
+    return ( ulFailures == 0 ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,564 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+/*
+ * Host benchmark of the log staging of Common/cli/logging.c with many
+ * concurrent loggers, built on the tools/host kernel shim.
+ *
+ * For TEST_DURATION_MS, TEST_LOGGERS tasks log back to back, an interrupt
+ * logs every TEST_ISR_PERIOD_US and a probe task, which stands for a high
+ * priority task like MxNet, wakes every TEST_PROBE_PERIOD_MS. A
+ * consumer task drains xLoggingReceive as fast as it can, as the console TX
+ * task does when the UART keeps up, so throughput is that of the staging and
+ * merge rather than of the line (see cli_uart_bench.c for the line). The
+ * same load runs twice:
+ * - rings: every task formats into its own lock-free staging ring.
+ * - shared: no task gets a ring, as when their allocation fails, so every
+ *   call formats into the shared buffer with the scheduler suspended. This
+ *   is the serialisation of the single print buffer the rings replaced.
+ * The host kernel suspends the scheduler by taking its kernel lock, so on
+ * each wake the probe suspends and resumes the scheduler: this returns once
+ * no other task has it suspended, which is when the probe could be switched
+ * in on the target. Checks:
+ * 1. Accounting: every call is either output or counted as dropped by a
+ *    drop notice, and the call and drop counters of vLoggingGetStats agree.
+ * 2. Order: the lines of each logger are output in call order.
+ * 3. Cleanup: the staging rings of deleted tasks are freed once drained.
+ * 4. Isolation: the worst case delay of the probe is lower with rings than
+ *    with the shared buffer.
+ *
+ * Reports for each mode the lines output per second, the share of calls
+ * dropped, the p50 / p99 / max duration of a log call by the loggers and by
+ * the probe, and the p50 / p99 / max delay of the probe. Durations are host
+ * times and include preemption by the other threads.
+ *
+ * Exits with a failure status if any check fails.
+ *
+ * Build and run from the repository root:
+ *   cc -O2 -ICommon/cli -Itools/host -ICommon/include \
+ *      tools/logging_bench.c Common/cli/logging.c tools/host/host_kernel.c -lpthread -o logging_bench
+ *   ./logging_bench [duration ms]
+ */
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include "cli.h"
+#include "logging.h"
+
+#define TEST_LOGGERS             8U
+#define TEST_DURATION_MS         500U
+#define TEST_MAX_DURATION_MS     60000U
+#define TEST_ISR_PERIOD_US       500U
+#define TEST_PROBE_PERIOD_MS     1U
+#define TEST_MAX_SAMPLES         1000000U
+#define TEST_DRAIN_TIMEOUT_MS    2000U
+#define TEST_LINE_LEN            dlMAX_LOG_LINE_LENGTH
+
+typedef struct
+{
+    uint64_t * pullNs;
+    uint32_t ulCount;
+    uint32_t ulCapacity;
+} TestSamples_t;
+
+typedef struct
+{
+    const char * pcName;
+    bool xShared;
+
+    /* Calls */
+    volatile uint32_t ulLoggerCalls;
+    volatile uint32_t ulProbeCalls;
+    volatile uint32_t ulIsrCalls;
+    TestSamples_t xLoggerCall;
+    TestSamples_t xProbeCall;
+    TestSamples_t xProbeDelay;
+
+    /* Output, written by the consumer only */
+    volatile uint32_t ulLoggerLines;
+    volatile uint32_t ulProbeLines;
+    volatile uint32_t ulIsrLines;
+    volatile uint32_t ulDropped;
+    uint32_t ulOutOfOrder;
+    uint32_t pulNextSequence[ TEST_LOGGERS ];
+} TestMode_t;
+
+static TestMode_t xRingMode = { .pcName = "rings", .xShared = false };
+static TestMode_t xSharedMode = { .pcName = "shared", .xShared = true };
+
+static TestMode_t * volatile pxMode = NULL;
+static volatile bool xStopLoggers = false;
+static volatile bool xStopPeriodic = false;
+static SemaphoreHandle_t xTaskDone = NULL;
+static pthread_mutex_t xSampleLock = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t ulDurationMs = TEST_DURATION_MS;
+
+/* Tasks of the shared mode get no staging ring */
+static __thread bool xRefuseAllocation = false;
+static __thread bool xInsideInterrupt = false;
+static __thread void * pvThreadLocal[ configNUM_THREAD_LOCAL_STORAGE_POINTERS ];
+
+static uint32_t ulFailures = 0;
+
+HostDwt_t xHostDwt;
+uint32_t SystemCoreClock = 160000000U;
+
+static void prvCheck( bool xCondition,
+                      const char * pcName )
+{
+    if( !xCondition )
+    {
+        ulFailures++;
+    }
+
+    printf( "%s: %s\n", xCondition ? "ok" : "FAILED", pcName );
+}
+
+void * pvPortMalloc( size_t xWantedSize )
+{
+    return xRefuseAllocation ? NULL : malloc( xWantedSize );
+}
+
+void vPortFree( void * pv )
+{
+    free( pv );
+}
+
+static uint64_t prvNowNs( void )
+{
+    struct timespec xNow;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &xNow );
+
+    return ( ( uint64_t ) xNow.tv_sec * 1000000000U ) + ( uint64_t ) xNow.tv_nsec;
+}
+
+/* Kernel and board interfaces used by logging.c */
+BaseType_t xPortIsInsideInterrupt( void )
+{
+    return xInsideInterrupt ? pdTRUE : pdFALSE;
+}
+
+void * pvTaskGetThreadLocalStoragePointer( TaskHandle_t xTaskToQuery,
+                                           BaseType_t xIndex )
+{
+    configASSERT( ( xTaskToQuery == NULL ) || ( xTaskToQuery == xTaskGetCurrentTaskHandle() ) );
+
+    return pvThreadLocal[ xIndex ];
+}
+
+void vTaskSetThreadLocalStoragePointer( TaskHandle_t xTaskToSet,
+                                        BaseType_t xIndex,
+                                        void * pvValue )
+{
+    configASSERT( ( xTaskToSet == NULL ) || ( xTaskToSet == xTaskGetCurrentTaskHandle() ) );
+
+    pvThreadLocal[ xIndex ] = pvValue;
+}
+
+void vDwtCycleCounterEnable( void )
+{
+}
+
+UART_HandleTypeDef * vInitUartEarly( void )
+{
+    return NULL;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit( UART_HandleTypeDef * huart,
+                                     const uint8_t * pData,
+                                     uint16_t Size,
+                                     uint32_t Timeout )
+{
+    ( void ) huart;
+    ( void ) Timeout;
+
+    return ( fwrite( pData, 1, Size, stdout ) == Size ) ? HAL_OK : HAL_ERROR;
+}
+
+void HAL_GPIO_WritePin( GPIO_TypeDef * pxGpio,
+                        uint16_t usPin,
+                        GPIO_PinState xState )
+{
+    ( void ) pxGpio;
+    ( void ) usPin;
+    ( void ) xState;
+}
+
+/* Samples */
+static void prvSamplesInit( TestSamples_t * pxSamples,
+                            uint32_t ulCapacity )
+{
+    pxSamples->pullNs = malloc( ulCapacity * sizeof( uint64_t ) );
+    configASSERT( pxSamples->pullNs != NULL );
+    pxSamples->ulCapacity = ulCapacity;
+    pxSamples->ulCount = 0;
+}
+
+static void prvSamplesAdd( TestSamples_t * pxSamples,
+                           uint64_t ullNs )
+{
+    ( void ) pthread_mutex_lock( &xSampleLock );
+
+    if( pxSamples->ulCount < pxSamples->ulCapacity )
+    {
+        pxSamples->pullNs[ pxSamples->ulCount ] = ullNs;
+        pxSamples->ulCount++;
+    }
+
+    ( void ) pthread_mutex_unlock( &xSampleLock );
+}
+
+static int prvCompareU64( const void * pvA,
+                          const void * pvB )
+{
+    uint64_t ullA = *( const uint64_t * ) pvA;
+    uint64_t ullB = *( const uint64_t * ) pvB;
+
+    return ( ullA > ullB ) - ( ullA < ullB );
+}
+
+static uint64_t prvPercentile( const TestSamples_t * pxSamples,
+                               uint32_t ulPercent )
+{
+    uint64_t ullNs = 0;
+
+    if( pxSamples->ulCount > 0U )
+    {
+        ullNs = pxSamples->pullNs[ ( ( uint64_t ) ( pxSamples->ulCount - 1U ) * ulPercent ) / 100U ];
+    }
+
+    return ullNs;
+}
+
+static void prvReportSamples( const char * pcName,
+                              TestSamples_t * pxSamples )
+{
+    qsort( pxSamples->pullNs, pxSamples->ulCount, sizeof( uint64_t ), prvCompareU64 );
+
+    printf( "  %-16s p50 %7.1f us, p99 %7.1f us, max %8.1f us (%lu samples)\n", pcName,
+            ( double ) prvPercentile( pxSamples, 50 ) / 1000.0,
+            ( double ) prvPercentile( pxSamples, 99 ) / 1000.0,
+            ( double ) prvPercentile( pxSamples, 100 ) / 1000.0,
+            ( unsigned long ) pxSamples->ulCount );
+}
+
+/* Tasks */
+static void prvTaskExit( void )
+{
+    /* As traceTASK_DELETE does in vTaskDelete on the target */
+    vLoggingTaskDeleted( xTaskGetCurrentTaskHandle() );
+    ( void ) xSemaphoreGive( xTaskDone );
+    vTaskDelete( NULL );
+}
+
+static void prvLoggerTask( void * pvParameters )
+{
+    TestMode_t * pxTestMode = pxMode;
+    unsigned long ulLogger = ( unsigned long ) ( uintptr_t ) pvParameters;
+    uint32_t ulSequence = 0;
+
+    xRefuseAllocation = pxTestMode->xShared;
+
+    while( !xStopLoggers )
+    {
+        uint64_t ullStartNs = prvNowNs();
+
+        LogInfo( "bench %lu %lu", ulLogger, ( unsigned long ) ulSequence );
+        prvSamplesAdd( &( pxTestMode->xLoggerCall ), prvNowNs() - ullStartNs );
+        ulSequence++;
+    }
+
+    ( void ) __atomic_fetch_add( &( pxTestMode->ulLoggerCalls ), ulSequence, __ATOMIC_SEQ_CST );
+
+    prvTaskExit();
+}
+
+static void prvProbeTask( void * pvParameters )
+{
+    TestMode_t * pxTestMode = pxMode;
+
+    ( void ) pvParameters;
+
+    xRefuseAllocation = pxTestMode->xShared;
+
+    while( !xStopPeriodic )
+    {
+        uint64_t ullStartNs;
+
+        vTaskDelay( pdMS_TO_TICKS( TEST_PROBE_PERIOD_MS ) );
+
+        /* Returns once no other task has the scheduler suspended */
+        ullStartNs = prvNowNs();
+        vTaskSuspendAll();
+        ( void ) xTaskResumeAll();
+        prvSamplesAdd( &( pxTestMode->xProbeDelay ), prvNowNs() - ullStartNs );
+
+        ullStartNs = prvNowNs();
+        LogInfo( "probe %lu", ( unsigned long ) pxTestMode->ulProbeCalls );
+        prvSamplesAdd( &( pxTestMode->xProbeCall ), prvNowNs() - ullStartNs );
+        pxTestMode->ulProbeCalls++;
+    }
+
+    prvTaskExit();
+}
+
+static void prvInterruptTask( void * pvParameters )
+{
+    TestMode_t * pxTestMode = pxMode;
+    struct timespec xPeriod = { .tv_sec = 0, .tv_nsec = TEST_ISR_PERIOD_US * 1000L };
+
+    ( void ) pvParameters;
+
+    xInsideInterrupt = true;
+
+    while( !xStopPeriodic )
+    {
+        ( void ) nanosleep( &xPeriod, NULL );
+
+        LogInfo( "isr %lu", ( unsigned long ) pxTestMode->ulIsrCalls );
+        pxTestMode->ulIsrCalls++;
+    }
+
+    ( void ) xSemaphoreGive( xTaskDone );
+    vTaskDelete( NULL );
+}
+
+/* The console TX task, without the UART */
+static void prvParseLine( TestMode_t * pxTestMode,
+                          const char * pcLine )
+{
+    const char * pcBody = strstr( pcLine, "] " );
+    unsigned long ulLogger = 0;
+    unsigned long ulSequence = 0;
+    unsigned long ulDropped = 0;
+
+    if( pcBody == NULL )
+    {
+        /* Not a log line */
+    }
+    else if( sscanf( pcBody, "] bench %lu %lu", &ulLogger, &ulSequence ) == 2 )
+    {
+        if( ( ulLogger >= TEST_LOGGERS ) || ( ulSequence < pxTestMode->pulNextSequence[ ulLogger ] ) )
+        {
+            pxTestMode->ulOutOfOrder++;
+        }
+        else
+        {
+            pxTestMode->pulNextSequence[ ulLogger ] = ( uint32_t ) ulSequence + 1U;
+        }
+
+        pxTestMode->ulLoggerLines++;
+    }
+    else if( strncmp( pcBody, "] probe ", 8 ) == 0 )
+    {
+        pxTestMode->ulProbeLines++;
+    }
+    else if( strncmp( pcBody, "] isr ", 6 ) == 0 )
+    {
+        pxTestMode->ulIsrLines++;
+    }
+    else if( sscanf( pcBody, "] %lu log messages dropped", &ulDropped ) == 1 )
+    {
+        pxTestMode->ulDropped += ( uint32_t ) ulDropped;
+    }
+    else
+    {
+        /* Other output */
+    }
+}
+
+static void prvConsumerTask( void * pvParameters )
+{
+    static char cLine[ TEST_LINE_LEN + 1 ];
+
+    ( void ) pvParameters;
+
+    for( ; ; )
+    {
+        size_t xLen = xLoggingReceive( cLine, TEST_LINE_LEN );
+
+        if( xLen > 0U )
+        {
+            cLine[ xLen ] = '\0';
+
+            if( pxMode != NULL )
+            {
+                prvParseLine( pxMode, cLine );
+            }
+        }
+        else
+        {
+            vTaskDelay( 1 );
+        }
+    }
+}
+
+static uint32_t prvStagingBuffers( void )
+{
+    LogStagingInfo_t xInfo;
+    uint32_t ulCount = 0;
+
+    while( ulLoggingGetStagingInfo( ulCount, &xInfo ) != 0U )
+    {
+        ulCount++;
+    }
+
+    return ulCount;
+}
+
+static void prvRunMode( TestMode_t * pxTestMode )
+{
+    uint32_t ulCallsMade;
+    uint32_t ulAccounted = 0;
+    uint64_t ullStartNs;
+    uint64_t ullDeadlineNs;
+    uint64_t ullElapsedNs;
+    LoggingStats_t xStats[ LOG_PATH_MAX ];
+    BaseType_t xResult;
+    uint32_t ulLogger;
+    uint32_t i;
+
+    prvSamplesInit( &( pxTestMode->xLoggerCall ), TEST_MAX_SAMPLES );
+    prvSamplesInit( &( pxTestMode->xProbeCall ), TEST_MAX_SAMPLES );
+    prvSamplesInit( &( pxTestMode->xProbeDelay ), TEST_MAX_SAMPLES );
+
+    vLoggingResetStats();
+    xStopLoggers = false;
+    xStopPeriodic = false;
+    pxMode = pxTestMode;
+    ullStartNs = prvNowNs();
+
+    xResult = xTaskCreate( prvInterruptTask, "isr", 0, NULL, 0, NULL );
+    configASSERT( xResult == pdPASS );
+
+    xResult = xTaskCreate( prvProbeTask, "probe", 0, NULL, 0, NULL );
+    configASSERT( xResult == pdPASS );
+
+    for( ulLogger = 0; ulLogger < TEST_LOGGERS; ulLogger++ )
+    {
+        char cName[ configMAX_TASK_NAME_LEN ];
+
+        ( void ) snprintf( cName, sizeof( cName ), "log%lu", ( unsigned long ) ulLogger );
+        xResult = xTaskCreate( prvLoggerTask, cName, 0, ( void * ) ( uintptr_t ) ulLogger, 0, NULL );
+        configASSERT( xResult == pdPASS );
+    }
+
+    vTaskDelay( pdMS_TO_TICKS( ulDurationMs ) );
+    xStopLoggers = true;
+
+    for( ulLogger = 0; ulLogger < TEST_LOGGERS; ulLogger++ )
+    {
+        ( void ) xSemaphoreTake( xTaskDone, portMAX_DELAY );
+    }
+
+    xStopPeriodic = true;
+    ( void ) xSemaphoreTake( xTaskDone, portMAX_DELAY );
+    ( void ) xSemaphoreTake( xTaskDone, portMAX_DELAY );
+
+    /* Wait for the consumer to account for every call */
+    ulCallsMade = pxTestMode->ulLoggerCalls + pxTestMode->ulProbeCalls + pxTestMode->ulIsrCalls;
+    ullDeadlineNs = prvNowNs() + ( ( uint64_t ) TEST_DRAIN_TIMEOUT_MS * 1000000U );
+
+    do
+    {
+        vTaskDelay( 1 );
+        ulAccounted = pxTestMode->ulLoggerLines + pxTestMode->ulProbeLines + pxTestMode->ulIsrLines + pxTestMode->ulDropped;
+    } while( ( ulAccounted < ulCallsMade ) && ( prvNowNs() < ullDeadlineNs ) );
+
+    ullElapsedNs = prvNowNs() - ullStartNs;
+
+    /* The consumer frees the rings of deleted tasks once it finds nothing to output */
+    while( ( prvStagingBuffers() > 1U ) && ( prvNowNs() < ullDeadlineNs ) )
+    {
+        vTaskDelay( 1 );
+    }
+
+    vLoggingGetStats( xStats );
+    pxMode = NULL;
+
+    for( i = 1; i < LOG_PATH_MAX; i++ )
+    {
+        xStats[ 0 ].ulCalls += xStats[ i ].ulCalls;
+        xStats[ 0 ].ulDropped += xStats[ i ].ulDropped;
+    }
+
+    printf( "%s: %lu calls from %u loggers, a probe and an interrupt: %.0f lines/s, %.1f%% dropped\n",
+            pxTestMode->pcName, ( unsigned long ) ulCallsMade, TEST_LOGGERS,
+            ( double ) ( ulCallsMade - pxTestMode->ulDropped ) * 1e9 / ( double ) ullElapsedNs,
+            ( double ) pxTestMode->ulDropped * 100.0 / ( double ) ulCallsMade );
+    prvReportSamples( "logger call", &( pxTestMode->xLoggerCall ) );
+    prvReportSamples( "probe call", &( pxTestMode->xProbeCall ) );
+    prvReportSamples( "probe delay", &( pxTestMode->xProbeDelay ) );
+
+    prvCheck( ulAccounted == ulCallsMade, "every call is output or counted as dropped" );
+    prvCheck( ( xStats[ 0 ].ulCalls == ulCallsMade ) && ( xStats[ 0 ].ulDropped == pxTestMode->ulDropped ),
+              "the call and drop counters agree" );
+    prvCheck( pxTestMode->ulOutOfOrder == 0U, "the lines of each logger are output in call order" );
+    prvCheck( prvStagingBuffers() == 1U, "the rings of deleted tasks are freed" );
+}
+
+int main( int argc,
+          char ** argv )
+{
+    BaseType_t xResult;
+
+    if( argc > 1 )
+    {
+        ulDurationMs = ( uint32_t ) strtoul( argv[ 1 ], NULL, 10 );
+    }
+
+    if( ( ulDurationMs < ( 10U * TEST_PROBE_PERIOD_MS ) ) || ( ulDurationMs > TEST_MAX_DURATION_MS ) )
+    {
+        ulDurationMs = TEST_DURATION_MS;
+    }
+
+    vHostKernelStartRealTime();
+    vLoggingInit();
+
+    xTaskDone = xQueueCreateCountingSemaphore( TEST_LOGGERS + 2U, 0 );
+    configASSERT( xTaskDone != NULL );
+
+    xResult = xTaskCreate( prvConsumerTask, "consumer", 0, NULL, 0, NULL );
+    configASSERT( xResult == pdPASS );
+
+    prvRunMode( &xRingMode );
+    prvRunMode( &xSharedMode );
+
+    prvCheck( prvPercentile( &( xRingMode.xProbeDelay ), 100 ) < prvPercentile( &( xSharedMode.xProbeDelay ), 100 ),
+              "rings keep the probe from waiting on other loggers" );
+
+    printf( "%s (%lu failures)\n", ( ulFailures == 0 ) ? "PASS" : "FAIL", ( unsigned long ) ulFailures );
+
+    return ( ulFailures == 0 ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
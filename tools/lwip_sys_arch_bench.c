@@ -0,0 +1,491 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+/*
+ * Host test and per-packet benchmark of the lwIP port in
+ * Common/net/lwip_port/src/sys_arch.c, built on the tools/host kernel shim
+ * with the lwIP stand-in headers of tools/host/lwip. A ticker thread keeps the
+ * tick count at the milliseconds elapsed since the start. Checks:
+ * 1. Second fetcher: while one task waits in sys_arch_mbox_fetch, a second
+ *    task fetching the same mailbox without a timeout blocks, and gets the
+ *    next message once the first one has left.
+ * 2. Second fetcher timeout: with a timeout, the second task waits for the
+ *    whole timeout before it returns SYS_ARCH_TIMEOUT.
+ * 3. Per packet overhead: the lwIP calls made for one received packet (post
+ *    to the tcpip mailbox from the driver, fetch in the tcpip thread, four
+ *    protect / unprotect pairs for the pbuf and stats, post to the recvmbox,
+ *    fetch in the application) and for one blocking API call (post to the
+ *    tcpip mailbox, fetch, signal the per-thread netconn semaphore, wait on
+ *    it), against the same sequence on the queue based port that sys_arch.c
+ *    replaced: mailboxes on FreeRTOS queues, semaphores on binary semaphores
+ *    and protection by a critical section.
+ *
+ * On the host every primitive ends in a POSIX mutex and condition variable,
+ * so the figures compare the number and kind of kernel objects touched per
+ * packet, not Cortex-M cycles: masking BASEPRI instead of entering a critical
+ * section costs the same here.
+ *
+ * Exits with a failure status if any check fails.
+ *
+ * Build and run from the repository root:
+ *   cc -O2 -Itools/host -ICommon/include -ICommon/cli -ICommon/net/lwip_port/include \
+ *      tools/lwip_sys_arch_bench.c Common/net/lwip_port/src/sys_arch.c tools/host/host_kernel.c \
+ *      -lpthread -o lwip_sys_arch_bench
+ *   ./lwip_sys_arch_bench [packets]
+ */
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "semphr.h"
+
+#include "lwip/sys.h"
+
+#define TEST_DEFAULT_PACKETS       20000U
+#define TEST_TCPIP_MBOX_SIZE       32
+#define TEST_RECV_MBOX_SIZE        16
+#define TEST_PROTECTS_PER_PACKET   4U
+#define TEST_SETTLE_MS             50U
+#define TEST_FETCH_TIMEOUT_MS      100U
+#define TEST_SLACK_MS              5U
+
+/* Requests of the API call benchmark carry the semaphore to signal */
+typedef struct
+{
+    sys_sem_t * pxDone;
+    QueueHandle_t xDone;
+} TestApiMsg_t;
+
+typedef struct
+{
+    sys_mbox_t * pxMbox;
+    u32_t ulTimeOut;
+    u32_t ulResult;
+    void * pvMsg;
+    volatile bool xReturned;
+} TestFetcher_t;
+
+typedef struct
+{
+    uint32_t ulPackets;
+    sys_mbox_t xTcpip;
+    sys_mbox_t xRecv;
+    QueueHandle_t xQueueTcpip;
+    QueueHandle_t xQueueRecv;
+} TestPath_t;
+
+static uint32_t ulFailures = 0;
+
+/*-----------------------------------------------------------*/
+
+static void prvCheck( bool xCondition,
+                      const char * pcWhat )
+{
+    if( !xCondition )
+    {
+        printf( "FAIL: %s\n", pcWhat );
+        ulFailures++;
+    }
+}
+
+void * pvPortMalloc( size_t xWantedSize )
+{
+    return malloc( xWantedSize );
+}
+
+void vPortFree( void * pv )
+{
+    free( pv );
+}
+
+/* Every host task is a thread, so its storage can live in the thread */
+static __thread void * pvThreadLocal[ configNUM_THREAD_LOCAL_STORAGE_POINTERS ];
+
+void * pvTaskGetThreadLocalStoragePointer( TaskHandle_t xTaskToQuery,
+                                           BaseType_t xIndex )
+{
+    configASSERT( xTaskToQuery == xTaskGetCurrentTaskHandle() );
+
+    return pvThreadLocal[ xIndex ];
+}
+
+void vTaskSetThreadLocalStoragePointer( TaskHandle_t xTaskToSet,
+                                        BaseType_t xIndex,
+                                        void * pvValue )
+{
+    configASSERT( xTaskToSet == xTaskGetCurrentTaskHandle() );
+
+    pvThreadLocal[ xIndex ] = pvValue;
+}
+
+static uint64_t prvNowNs( void )
+{
+    struct timespec xNow;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &xNow );
+
+    return ( ( uint64_t ) xNow.tv_sec * 1000000000U ) + ( uint64_t ) xNow.tv_nsec;
+}
+
+static void prvSleepMs( uint32_t ulMs )
+{
+    struct timespec xDelay = { ( time_t ) ( ulMs / 1000U ), ( long ) ( ulMs % 1000U ) * 1000000L };
+
+    ( void ) nanosleep( &xDelay, NULL );
+}
+
+static void * prvTickerThread( void * pvParameters )
+{
+    uint64_t ullStartNs = prvNowNs();
+
+    ( void ) pvParameters;
+
+    for( ; ; )
+    {
+        TickType_t xElapsed = ( TickType_t ) ( ( prvNowNs() - ullStartNs ) / 1000000U );
+
+        prvSleepMs( 1 );
+        vHostKernelAdvanceTicks( xElapsed - xTaskGetTickCount() );
+    }
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+static void * prvFetcherThread( void * pvParameters )
+{
+    TestFetcher_t * pxFetcher = ( TestFetcher_t * ) pvParameters;
+
+    pxFetcher->ulResult = sys_arch_mbox_fetch( pxFetcher->pxMbox, &( pxFetcher->pvMsg ), pxFetcher->ulTimeOut );
+    pxFetcher->xReturned = true;
+
+    return NULL;
+}
+
+static void prvTestSecondFetcher( void )
+{
+    static int lFirst, lSecond;
+    sys_mbox_t xMbox;
+    TestFetcher_t xFetcherA = { &xMbox, 0, 0, NULL, false };
+    TestFetcher_t xFetcherB = { &xMbox, 0, 0, NULL, false };
+    pthread_t xThreadA, xThreadB;
+
+    prvCheck( sys_mbox_new( &xMbox, 4 ) == ERR_OK, "mailbox created" );
+
+    ( void ) pthread_create( &xThreadA, NULL, prvFetcherThread, &xFetcherA );
+    prvSleepMs( TEST_SETTLE_MS );
+    ( void ) pthread_create( &xThreadB, NULL, prvFetcherThread, &xFetcherB );
+    prvSleepMs( TEST_SETTLE_MS );
+
+    prvCheck( !xFetcherA.xReturned && !xFetcherB.xReturned,
+              "a second fetcher without a timeout blocks while the first one waits" );
+
+    sys_mbox_post( &xMbox, &lFirst );
+    sys_mbox_post( &xMbox, &lSecond );
+    ( void ) pthread_join( xThreadA, NULL );
+    ( void ) pthread_join( xThreadB, NULL );
+
+    prvCheck( ( xFetcherA.ulResult != SYS_ARCH_TIMEOUT ) && ( xFetcherB.ulResult != SYS_ARCH_TIMEOUT ) &&
+              ( xFetcherA.pvMsg != NULL ) && ( xFetcherB.pvMsg != NULL ) &&
+              ( xFetcherA.pvMsg != xFetcherB.pvMsg ),
+              "each fetcher gets one of the messages" );
+
+    /* A fetcher that gave up early leaves a message behind */
+    while( sys_arch_mbox_tryfetch( &xMbox, NULL ) != SYS_MBOX_EMPTY )
+    {
+    }
+
+    sys_mbox_free( &xMbox );
+}
+
+static void prvTestSecondFetcherTimeout( void )
+{
+    static int lMsg;
+    sys_mbox_t xMbox;
+    TestFetcher_t xFetcherA = { &xMbox, 0, 0, NULL, false };
+    TestFetcher_t xFetcherB = { &xMbox, TEST_FETCH_TIMEOUT_MS, 0, NULL, false };
+    pthread_t xThreadA, xThreadB;
+    uint64_t ullStartNs, ullWaitedMs;
+
+    prvCheck( sys_mbox_new( &xMbox, 4 ) == ERR_OK, "mailbox created" );
+
+    ( void ) pthread_create( &xThreadA, NULL, prvFetcherThread, &xFetcherA );
+    prvSleepMs( TEST_SETTLE_MS );
+
+    ullStartNs = prvNowNs();
+    ( void ) pthread_create( &xThreadB, NULL, prvFetcherThread, &xFetcherB );
+    ( void ) pthread_join( xThreadB, NULL );
+    ullWaitedMs = ( prvNowNs() - ullStartNs ) / 1000000U;
+
+    printf( "fetch       second fetcher returned after %lu ms of a %u ms timeout\n",
+            ( unsigned long ) ullWaitedMs, TEST_FETCH_TIMEOUT_MS );
+    prvCheck( ( xFetcherB.ulResult == SYS_ARCH_TIMEOUT ) && ( xFetcherB.pvMsg == NULL ),
+              "the second fetcher times out while the first one waits" );
+    prvCheck( ullWaitedMs + TEST_SLACK_MS >= TEST_FETCH_TIMEOUT_MS,
+              "the second fetcher waits for its whole timeout" );
+
+    sys_mbox_post( &xMbox, &lMsg );
+    ( void ) pthread_join( xThreadA, NULL );
+    prvCheck( xFetcherA.pvMsg == &lMsg, "the first fetcher still gets the message" );
+
+    sys_mbox_free( &xMbox );
+}
+
+/*-----------------------------------------------------------*/
+
+/* Stands for the tcpip thread: forwards received packets to the application
+ * and completes API calls, until a NULL message */
+static void * prvTcpipThread( void * pvParameters )
+{
+    TestPath_t * pxPath = ( TestPath_t * ) pvParameters;
+    void * pvMsg = NULL;
+    uint32_t ulProtect;
+
+    do
+    {
+        ( void ) sys_arch_mbox_fetch( &( pxPath->xTcpip ), &pvMsg, 0 );
+
+        for( ulProtect = 0; ulProtect < TEST_PROTECTS_PER_PACKET; ulProtect++ )
+        {
+            sys_prot_t xLevel = sys_arch_protect();
+            sys_arch_unprotect( xLevel );
+        }
+
+        if( ( pvMsg == NULL ) || ( ( ( uintptr_t ) pvMsg & 1U ) != 0U ) )
+        {
+            /* Received packets are tagged with the low bit */
+            sys_mbox_post( &( pxPath->xRecv ), pvMsg );
+        }
+        else
+        {
+            sys_sem_signal( ( ( TestApiMsg_t * ) pvMsg )->pxDone );
+        }
+    } while( pvMsg != NULL );
+
+    return NULL;
+}
+
+static void * prvDriverThread( void * pvParameters )
+{
+    TestPath_t * pxPath = ( TestPath_t * ) pvParameters;
+    uint32_t ulPacket;
+
+    for( ulPacket = 0; ulPacket < pxPath->ulPackets; ulPacket++ )
+    {
+        sys_mbox_post( &( pxPath->xTcpip ), ( void * ) ( ( ( uintptr_t ) ulPacket << 1 ) | 1U ) );
+    }
+
+    return NULL;
+}
+
+static void prvRunPort( uint32_t ulPackets,
+                        double * pxRxNs,
+                        double * pxApiNs )
+{
+    TestPath_t xPath = { ulPackets };
+    TestApiMsg_t xApiMsg;
+    pthread_t xTcpip, xDriver;
+    void * pvMsg;
+    uint32_t ulReceived = 0;
+    uint32_t ulCall;
+    uint64_t ullStartNs;
+
+    ( void ) sys_mbox_new( &( xPath.xTcpip ), TEST_TCPIP_MBOX_SIZE );
+    ( void ) sys_mbox_new( &( xPath.xRecv ), TEST_RECV_MBOX_SIZE );
+    ( void ) pthread_create( &xTcpip, NULL, prvTcpipThread, &xPath );
+
+    ullStartNs = prvNowNs();
+    ( void ) pthread_create( &xDriver, NULL, prvDriverThread, &xPath );
+
+    while( ulReceived < ulPackets )
+    {
+        ( void ) sys_arch_mbox_fetch( &( xPath.xRecv ), &pvMsg, 0 );
+        ulReceived++;
+    }
+
+    *pxRxNs = ( double ) ( prvNowNs() - ullStartNs ) / ( double ) ulPackets;
+    ( void ) pthread_join( xDriver, NULL );
+
+    xApiMsg.pxDone = LWIP_NETCONN_THREAD_SEM_GET();
+    ullStartNs = prvNowNs();
+
+    for( ulCall = 0; ulCall < ulPackets; ulCall++ )
+    {
+        sys_mbox_post( &( xPath.xTcpip ), &xApiMsg );
+        ( void ) sys_arch_sem_wait( xApiMsg.pxDone, 0 );
+    }
+
+    *pxApiNs = ( double ) ( prvNowNs() - ullStartNs ) / ( double ) ulPackets;
+
+    sys_mbox_post( &( xPath.xTcpip ), NULL );
+    ( void ) sys_arch_mbox_fetch( &( xPath.xRecv ), &pvMsg, 0 );
+    ( void ) pthread_join( xTcpip, NULL );
+
+    sys_mbox_free( &( xPath.xTcpip ) );
+    sys_mbox_free( &( xPath.xRecv ) );
+}
+
+/* The same sequence on the queue based port */
+static void * prvQueueTcpipThread( void * pvParameters )
+{
+    TestPath_t * pxPath = ( TestPath_t * ) pvParameters;
+    void * pvMsg = NULL;
+    uint32_t ulProtect;
+
+    do
+    {
+        ( void ) xQueueReceive( pxPath->xQueueTcpip, &pvMsg, portMAX_DELAY );
+
+        for( ulProtect = 0; ulProtect < TEST_PROTECTS_PER_PACKET; ulProtect++ )
+        {
+            taskENTER_CRITICAL();
+            taskEXIT_CRITICAL();
+        }
+
+        if( ( pvMsg == NULL ) || ( ( ( uintptr_t ) pvMsg & 1U ) != 0U ) )
+        {
+            ( void ) xQueueSend( pxPath->xQueueRecv, &pvMsg, portMAX_DELAY );
+        }
+        else
+        {
+            ( void ) xSemaphoreGive( ( ( TestApiMsg_t * ) pvMsg )->xDone );
+        }
+    } while( pvMsg != NULL );
+
+    return NULL;
+}
+
+static void * prvQueueDriverThread( void * pvParameters )
+{
+    TestPath_t * pxPath = ( TestPath_t * ) pvParameters;
+    uint32_t ulPacket;
+    void * pvMsg;
+
+    for( ulPacket = 0; ulPacket < pxPath->ulPackets; ulPacket++ )
+    {
+        pvMsg = ( void * ) ( ( ( uintptr_t ) ulPacket << 1 ) | 1U );
+        ( void ) xQueueSend( pxPath->xQueueTcpip, &pvMsg, portMAX_DELAY );
+    }
+
+    return NULL;
+}
+
+static void prvRunQueuePort( uint32_t ulPackets,
+                             double * pxRxNs,
+                             double * pxApiNs )
+{
+    TestPath_t xPath = { ulPackets };
+    TestApiMsg_t xApiMsg;
+    pthread_t xTcpip, xDriver;
+    void * pvMsg;
+    void * pvEnd = NULL;
+    uint32_t ulReceived = 0;
+    uint32_t ulCall;
+    uint64_t ullStartNs;
+
+    xPath.xQueueTcpip = xQueueCreate( TEST_TCPIP_MBOX_SIZE, sizeof( void * ) );
+    xPath.xQueueRecv = xQueueCreate( TEST_RECV_MBOX_SIZE, sizeof( void * ) );
+    ( void ) pthread_create( &xTcpip, NULL, prvQueueTcpipThread, &xPath );
+
+    ullStartNs = prvNowNs();
+    ( void ) pthread_create( &xDriver, NULL, prvQueueDriverThread, &xPath );
+
+    while( ulReceived < ulPackets )
+    {
+        ( void ) xQueueReceive( xPath.xQueueRecv, &pvMsg, portMAX_DELAY );
+        ulReceived++;
+    }
+
+    *pxRxNs = ( double ) ( prvNowNs() - ullStartNs ) / ( double ) ulPackets;
+    ( void ) pthread_join( xDriver, NULL );
+
+    xApiMsg.xDone = xSemaphoreCreateBinary();
+    pvMsg = &xApiMsg;
+    ullStartNs = prvNowNs();
+
+    for( ulCall = 0; ulCall < ulPackets; ulCall++ )
+    {
+        ( void ) xQueueSend( xPath.xQueueTcpip, &pvMsg, portMAX_DELAY );
+        ( void ) xSemaphoreTake( xApiMsg.xDone, portMAX_DELAY );
+    }
+
+    *pxApiNs = ( double ) ( prvNowNs() - ullStartNs ) / ( double ) ulPackets;
+
+    ( void ) xQueueSend( xPath.xQueueTcpip, &pvEnd, portMAX_DELAY );
+    ( void ) xQueueReceive( xPath.xQueueRecv, &pvMsg, portMAX_DELAY );
+    ( void ) pthread_join( xTcpip, NULL );
+
+    vSemaphoreDelete( xApiMsg.xDone );
+    vQueueDelete( xPath.xQueueTcpip );
+    vQueueDelete( xPath.xQueueRecv );
+}
+
+static void prvBenchPerPacket( uint32_t ulPackets )
+{
+    double xRxNs, xApiNs, xQueueRxNs, xQueueApiNs;
+
+    prvRunPort( ulPackets, &xRxNs, &xApiNs );
+    prvRunQueuePort( ulPackets, &xQueueRxNs, &xQueueApiNs );
+
+    printf( "packet      %lu packets, tcpip mailbox %d, recvmbox %d, %u protect pairs per packet\n",
+            ( unsigned long ) ulPackets, TEST_TCPIP_MBOX_SIZE, TEST_RECV_MBOX_SIZE, TEST_PROTECTS_PER_PACKET );
+    printf( "packet      receive   sys_arch %8.0f ns   queue port %8.0f ns   %+6.1f%%\n",
+            xRxNs, xQueueRxNs, 100.0 * ( xRxNs - xQueueRxNs ) / xQueueRxNs );
+    printf( "packet      api call  sys_arch %8.0f ns   queue port %8.0f ns   %+6.1f%%\n",
+            xApiNs, xQueueApiNs, 100.0 * ( xApiNs - xQueueApiNs ) / xQueueApiNs );
+
+    prvCheck( ( xRxNs > 0.0 ) && ( xApiNs > 0.0 ), "every packet and call completes" );
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    uint32_t ulPackets = TEST_DEFAULT_PACKETS;
+    pthread_t xTicker;
+
+    if( argc > 1 )
+    {
+        ulPackets = ( uint32_t ) strtoul( argv[ 1 ], NULL, 10 );
+    }
+
+    sys_init();
+    ( void ) pthread_create( &xTicker, NULL, prvTickerThread, NULL );
+
+    prvTestSecondFetcher();
+    prvTestSecondFetcherTimeout();
+    prvBenchPerPacket( ulPackets );
+
+    printf( "%s (%lu failures)\n", ( ulFailures == 0 ) ? "PASS" : "FAIL", ( unsigned long ) ulFailures );
+
+    return ( ulFailures == 0 ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,477 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+/*
+ * Host benchmark and test of the mbed TLS allocator in
+ * Common/sys/mbedtls_freertos_port.c.
+ *
+ * 1. Soak: random calloc / free of pool and heap sized blocks. Every block
+ *    must be zeroed when handed out and must not overlap another live block.
+ * 2. Pinning: one long lived block must only keep its own slab, not every
+ *    slab carved since the pool was last idle.
+ * 3. Handshake replay: replays a synthetic TLS handshake allocation pattern,
+ *    with I/O buffers, a certificate chain, bignum temporaries with stack
+ *    like lifetimes and a session block which lives into the next handshake.
+ *    The pool is compared with plain FreeRTOS heap allocations, as done
+ *    before the pool existed: time per calloc / free pair, heap calls, peak
+ *    heap use and heap use retained between handshakes. The host heap is
+ *    the C library's, which is much faster than heap_4, so the heap call
+ *    count is the figure that carries over to the target.
+ *
+ * Exits with a failure status if any check fails.
+ *
+ * Build and run from the repository root, with the mbedtls submodule:
+ *   cc -O2 -Itools/host -ICommon/include -IMiddleware/ARM/mbedtls/include tools/mbedtls_alloc_bench.c \
+ *      Common/sys/mbedtls_freertos_port.c tools/host/host_kernel.c -lpthread -o mbedtls_alloc_bench
+ *   ./mbedtls_alloc_bench [handshakes]
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#define SIM_SLAB_LEN            4096U /* MBEDTLS_POOL_SLAB_LEN */
+#define SIM_SOAK_SLOTS          256U
+#define SIM_SOAK_OPS            200000U
+#define SIM_PIN_BLOCKS          512U
+#define SIM_MAX_IDS             128U
+#define SIM_MAX_OPS             4096U
+#define SIM_IO_BUF_LEN          6144U
+#define SIM_SESSION_LEN         256U
+#define SIM_CERT_BLOCKS         40U
+#define SIM_BIGNUM_STEPS        1500U
+#define SIM_BIGNUM_DEPTH        32U
+
+/* Id of the session block, which is carried over to the next handshake */
+#define SIM_SESSION_ID          0U
+
+typedef enum
+{
+    SimAlloc = 0,
+    SimFree
+} SimOpType_t;
+
+typedef struct
+{
+    SimOpType_t xType;
+    uint16_t usId;
+    uint32_t ulSize;
+} SimOp_t;
+
+typedef struct
+{
+    const char * pcName;
+    void * ( *pxCalloc )( size_t xNum, size_t xSize );
+    void ( * pxFree )( void * pv );
+} SimAllocator_t;
+
+typedef struct
+{
+    uint64_t ullCalls;
+    uint64_t ullLive;
+    uint64_t ullPeak;
+} SimHeapStats_t;
+
+void * mbedtls_platform_calloc( size_t nmemb,
+                                size_t size );
+void mbedtls_platform_free( void * ptr );
+
+static uint32_t ulFailures = 0;
+static SimHeapStats_t xHeap;
+
+static SimOp_t xTrace[ SIM_MAX_OPS ];
+static uint32_t ulTraceLen = 0;
+
+/*-----------------------------------------------------------*/
+
+static double prvNowUs( void )
+{
+    struct timespec xNow;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &xNow );
+
+    return ( ( double ) xNow.tv_sec * 1e6 ) + ( ( double ) xNow.tv_nsec / 1e3 );
+}
+
+static void prvCheck( bool xCondition,
+                      const char * pcWhat )
+{
+    if( !xCondition )
+    {
+        printf( "FAIL: %s\n", pcWhat );
+        ulFailures++;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/* FreeRTOS heap, counting calls and live bytes. The scheduler is suspended
+ * as heap_4 does, so both allocators pay for the same locking. */
+void * pvPortMalloc( size_t xSize )
+{
+    size_t * pxBlock;
+
+    vTaskSuspendAll();
+    pxBlock = malloc( sizeof( size_t ) * 2 + xSize );
+
+    if( pxBlock != NULL )
+    {
+        pxBlock[ 0 ] = xSize;
+        xHeap.ullCalls++;
+        xHeap.ullLive += xSize;
+
+        if( xHeap.ullLive > xHeap.ullPeak )
+        {
+            xHeap.ullPeak = xHeap.ullLive;
+        }
+
+        pxBlock += 2;
+    }
+
+    ( void ) xTaskResumeAll();
+
+    return pxBlock;
+}
+
+void vPortFree( void * pv )
+{
+    if( pv != NULL )
+    {
+        size_t * pxBlock = ( size_t * ) pv - 2;
+
+        vTaskSuspendAll();
+        xHeap.ullCalls++;
+        xHeap.ullLive -= pxBlock[ 0 ];
+        free( pxBlock );
+        ( void ) xTaskResumeAll();
+    }
+}
+
+/* The allocator before the pool: heap block with the size in a header */
+static void * prvHeapCalloc( size_t xNum,
+                             size_t xSize )
+{
+    size_t xTotal = xNum * xSize;
+    uint64_t * pullBlock = pvPortMalloc( sizeof( uint64_t ) + xTotal );
+
+    if( pullBlock != NULL )
+    {
+        pullBlock[ 0 ] = xTotal;
+        ( void ) memset( pullBlock + 1, 0, xTotal );
+        pullBlock++;
+    }
+
+    return pullBlock;
+}
+
+static void prvHeapFree( void * pv )
+{
+    if( pv != NULL )
+    {
+        uint64_t * pullBlock = ( uint64_t * ) pv - 1;
+
+        explicit_bzero( pv, ( size_t ) pullBlock[ 0 ] );
+        vPortFree( pullBlock );
+    }
+}
+
+static const SimAllocator_t xAllocators[] =
+{
+    { "pool", mbedtls_platform_calloc, mbedtls_platform_free },
+    { "heap", prvHeapCalloc,           prvHeapFree           },
+};
+
+/*-----------------------------------------------------------*/
+
+static bool prvIsZero( const uint8_t * pucData,
+                       size_t xLen )
+{
+    bool xZero = true;
+
+    for( size_t i = 0; xZero && ( i < xLen ); i++ )
+    {
+        xZero = ( pucData[ i ] == 0 );
+    }
+
+    return xZero;
+}
+
+static bool prvHasPattern( const uint8_t * pucData,
+                           size_t xLen,
+                           uint8_t ucPattern )
+{
+    bool xIntact = true;
+
+    for( size_t i = 0; xIntact && ( i < xLen ); i++ )
+    {
+        xIntact = ( pucData[ i ] == ucPattern );
+    }
+
+    return xIntact;
+}
+
+static void prvTestSoak( void )
+{
+    static uint8_t * pucBlocks[ SIM_SOAK_SLOTS ];
+    static size_t xSizes[ SIM_SOAK_SLOTS ];
+    bool xZeroed = true;
+    bool xIntact = true;
+
+    srand( 7 );
+
+    for( uint32_t i = 0; i < SIM_SOAK_OPS; i++ )
+    {
+        uint32_t ulSlot = ( uint32_t ) rand() % SIM_SOAK_SLOTS;
+        uint8_t ucPattern = ( uint8_t ) ( ulSlot | 1U );
+
+        if( pucBlocks[ ulSlot ] != NULL )
+        {
+            xIntact = xIntact && prvHasPattern( pucBlocks[ ulSlot ], xSizes[ ulSlot ], ucPattern );
+            mbedtls_platform_free( pucBlocks[ ulSlot ] );
+            pucBlocks[ ulSlot ] = NULL;
+        }
+        else
+        {
+            /* Mostly pool sizes with some heap sized blocks */
+            xSizes[ ulSlot ] = ( ( rand() % 16 ) == 0 ) ? ( 1025U + ( ( size_t ) rand() % 3000U ) ) : ( 1U + ( ( size_t ) rand() % 1024U ) );
+            pucBlocks[ ulSlot ] = mbedtls_platform_calloc( 1, xSizes[ ulSlot ] );
+
+            if( pucBlocks[ ulSlot ] != NULL )
+            {
+                xZeroed = xZeroed && prvIsZero( pucBlocks[ ulSlot ], xSizes[ ulSlot ] );
+                ( void ) memset( pucBlocks[ ulSlot ], ucPattern, xSizes[ ulSlot ] );
+            }
+        }
+    }
+
+    for( uint32_t i = 0; i < SIM_SOAK_SLOTS; i++ )
+    {
+        mbedtls_platform_free( pucBlocks[ i ] );
+        pucBlocks[ i ] = NULL;
+    }
+
+    printf( "soak        %u operations, heap retained when idle: %llu B\n",
+            SIM_SOAK_OPS, ( unsigned long long ) xHeap.ullLive );
+    prvCheck( xZeroed, "soak: blocks are zeroed" );
+    prvCheck( xIntact, "soak: blocks do not overlap" );
+    prvCheck( xHeap.ullLive <= SIM_SLAB_LEN, "soak: only the current slab is kept when idle" );
+    prvCheck( mbedtls_platform_calloc( 0, 16 ) == NULL, "soak: zero members" );
+    prvCheck( mbedtls_platform_calloc( SIZE_MAX / 2, 4 ) == NULL, "soak: size overflow" );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvTestPinning( void )
+{
+    static void * pvBlocks[ SIM_PIN_BLOCKS ];
+    uint64_t ullPeak;
+
+    /* Fill several slabs, then keep only the very first block */
+    for( uint32_t i = 0; i < SIM_PIN_BLOCKS; i++ )
+    {
+        pvBlocks[ i ] = mbedtls_platform_calloc( 1, 64 );
+    }
+
+    ullPeak = xHeap.ullLive;
+
+    for( uint32_t i = 1; i < SIM_PIN_BLOCKS; i++ )
+    {
+        mbedtls_platform_free( pvBlocks[ i ] );
+    }
+
+    printf( "pinning     %u blocks in %llu B of slabs, %llu B retained by one live block\n",
+            SIM_PIN_BLOCKS, ( unsigned long long ) ullPeak, ( unsigned long long ) xHeap.ullLive );
+    prvCheck( ullPeak > ( 4U * SIM_SLAB_LEN ), "pinning: blocks span several slabs" );
+    prvCheck( xHeap.ullLive <= ( 2U * SIM_SLAB_LEN ), "pinning: one live block keeps at most its own and the current slab" );
+
+    mbedtls_platform_free( pvBlocks[ 0 ] );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvTraceAdd( SimOpType_t xType,
+                         uint16_t usId,
+                         uint32_t ulSize )
+{
+    if( ulTraceLen < SIM_MAX_OPS )
+    {
+        xTrace[ ulTraceLen ].xType = xType;
+        xTrace[ ulTraceLen ].usId = usId;
+        xTrace[ ulTraceLen ].ulSize = ulSize;
+        ulTraceLen++;
+    }
+}
+
+/*
+ * One handshake. Ids 0 and 1 to 2 are the session and I/O buffers, the
+ * certificate chain follows and the remaining ids are used as a stack of
+ * bignum temporaries.
+ */
+static void prvBuildTrace( void )
+{
+    static const uint32_t pulBignumSizes[] = { 32, 64, 96, 128, 256, 384, 512 };
+    const uint16_t usCertBase = 3;
+    const uint16_t usBignumBase = usCertBase + SIM_CERT_BLOCKS;
+    uint32_t ulDepth = 0;
+
+    srand( 11 );
+
+    prvTraceAdd( SimAlloc, 1, SIM_IO_BUF_LEN );
+    prvTraceAdd( SimAlloc, 2, SIM_IO_BUF_LEN );
+
+    for( uint16_t i = 0; i < SIM_CERT_BLOCKS; i++ )
+    {
+        prvTraceAdd( SimAlloc, usCertBase + i, 48U + ( ( uint32_t ) rand() % 650U ) );
+    }
+
+    for( uint32_t i = 0; i < SIM_BIGNUM_STEPS; i++ )
+    {
+        bool xPush = ( ulDepth == 0 ) || ( ( ulDepth < SIM_BIGNUM_DEPTH ) && ( ( rand() % 100 ) < 55 ) );
+
+        if( xPush )
+        {
+            prvTraceAdd( SimAlloc, usBignumBase + ulDepth,
+                         pulBignumSizes[ ( uint32_t ) rand() % ( sizeof( pulBignumSizes ) / sizeof( pulBignumSizes[ 0 ] ) ) ] );
+            ulDepth++;
+        }
+        else
+        {
+            ulDepth--;
+            prvTraceAdd( SimFree, usBignumBase + ulDepth, 0 );
+        }
+    }
+
+    while( ulDepth > 0 )
+    {
+        ulDepth--;
+        prvTraceAdd( SimFree, usBignumBase + ulDepth, 0 );
+    }
+
+    /* The new session replaces the previous handshake's one */
+    prvTraceAdd( SimFree, SIM_SESSION_ID, 0 );
+    prvTraceAdd( SimAlloc, SIM_SESSION_ID, SIM_SESSION_LEN );
+
+    for( uint16_t i = 0; i < SIM_CERT_BLOCKS; i++ )
+    {
+        prvTraceAdd( SimFree, usCertBase + i, 0 );
+    }
+
+    prvTraceAdd( SimFree, 1, 0 );
+    prvTraceAdd( SimFree, 2, 0 );
+}
+
+static void prvReplay( const SimAllocator_t * pxAllocator,
+                       uint32_t ulHandshakes )
+{
+    static void * pvSlots[ SIM_MAX_IDS ];
+    uint64_t ullRetained = 0;
+    uint64_t ullPairs = 0;
+    double dStart;
+    double dElapsedUs;
+
+    ( void ) memset( &xHeap, 0, sizeof( xHeap ) );
+
+    dStart = prvNowUs();
+
+    for( uint32_t ulHandshake = 0; ulHandshake < ulHandshakes; ulHandshake++ )
+    {
+        for( uint32_t i = 0; i < ulTraceLen; i++ )
+        {
+            const SimOp_t * pxOp = &( xTrace[ i ] );
+
+            if( pxOp->xType == SimAlloc )
+            {
+                pvSlots[ pxOp->usId ] = pxAllocator->pxCalloc( 1, pxOp->ulSize );
+                ullPairs++;
+            }
+            else
+            {
+                pxAllocator->pxFree( pvSlots[ pxOp->usId ] );
+                pvSlots[ pxOp->usId ] = NULL;
+            }
+        }
+
+        if( xHeap.ullLive > ullRetained )
+        {
+            ullRetained = xHeap.ullLive;
+        }
+    }
+
+    dElapsedUs = prvNowUs() - dStart;
+
+    pxAllocator->pxFree( pvSlots[ SIM_SESSION_ID ] );
+    pvSlots[ SIM_SESSION_ID ] = NULL;
+
+    printf( "%-10s  %8.1f  %10.1f  %9llu  %9llu\n",
+            pxAllocator->pcName,
+            ( dElapsedUs * 1000.0 ) / ( double ) ullPairs,
+            ( double ) xHeap.ullCalls / ( double ) ulHandshakes,
+            ( unsigned long long ) xHeap.ullPeak,
+            ( unsigned long long ) ullRetained );
+
+    if( pxAllocator->pxCalloc == mbedtls_platform_calloc )
+    {
+        prvCheck( ullRetained <= ( 2U * SIM_SLAB_LEN ), "replay: the session block does not pin the handshake's slabs" );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    uint32_t ulHandshakes = 2000U;
+
+    if( argc > 1 )
+    {
+        ulHandshakes = ( uint32_t ) strtoul( argv[ 1 ], NULL, 10 );
+    }
+
+    if( ulHandshakes == 0 )
+    {
+        ulHandshakes = 1;
+    }
+
+    prvTestSoak();
+    prvTestPinning();
+
+    prvBuildTrace();
+
+    printf( "replay      %lu handshakes of %lu operations\n", ( unsigned long ) ulHandshakes, ( unsigned long ) ulTraceLen );
+    printf( "%-10s  %8s  %10s  %9s  %9s\n", "allocator", "ns/pair", "heap_calls", "peak_B", "retained_B" );
+
+    for( uint32_t i = 0; i < ( sizeof( xAllocators ) / sizeof( xAllocators[ 0 ] ) ); i++ )
+    {
+        prvReplay( &( xAllocators[ i ] ), ulHandshakes );
+    }
+
+    printf( "%s (%lu failures)\n", ( ulFailures == 0 ) ? "PASS" : "FAIL", ( unsigned long ) ulFailures );
+
+    return ( ulFailures == 0 ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,949 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+/*
+ * Host evaluation of the MXCHIP TX path under mixed bulk and interactive
+ * load: the real prvxLinkOutput (Common/net/mxchip/mx_lwip.c) feeds the real
+ * data plane thread (Common/net/mxchip/mx_dataplane.c), which moves the
+ * frames over a mocked SPI link to an emulated EMW3080. Built on the
+ * tools/host kernel shim with the lwIP and HAL stand-in headers of
+ * tools/host.
+ *
+ * The emulated module raises the flow pin when the data plane asserts NSS
+ * and again after the header exchange, like the EMW3080. It never has data
+ * to send (the notify pin stays low) and does not answer bypass frames, so
+ * only the TX direction is exercised. Each data phase takes
+ * TEST_SPI_NS_PER_BYTE per byte: an estimate of the sustained TX rate of the
+ * module, not a measurement of an EMW3080. The module checks the SPI header
+ * and the BypassInOut_t header of every frame and logs the flow, sequence
+ * number and queueing delay carried by the frame. The main task calls
+ * linkoutput like the lwIP tcpip thread and frees its pbuf after each call.
+ * Checks:
+ * 1. Classification: ARP, ICMP, DSCP >= CS3, MQTT (port 8883) and DNS frames
+ *    are interactive. Other TCP and UDP flows, IP fragments, IPv6 and MQTT on
+ *    a port that is not configured are bulk, whatever their size, so the
+ *    frames of one connection stay in order. A pbuf without header space
+ *    goes through the copy path and arrives intact.
+ * 2. Drop policies: with the module stalled, a full bulk queue refuses new
+ *    frames with ERR_MEM (drop-tail), a full interactive queue drops its
+ *    oldest frame and accepts the new one (drop-head). Both are counted in
+ *    the queue statistics. Once the module resumes, the queued interactive
+ *    frames are sent ahead of the queued bulk frames.
+ * 3. Mixed load: a bulk TCP flow keeps the bulk queue full for
+ *    TEST_DURATION_MS while an MQTT flow sends a small frame every
+ *    TEST_INTERACTIVE_PERIOD_US. Run twice, with the MQTT frames on port 8883
+ *    (interactive) and on port 1883 (bulk, the single FIFO of the old
+ *    driver). A refused frame is retried after TEST_BACKOFF_US like a TCP
+ *    retransmission, and the delay of an MQTT frame is counted from its
+ *    first attempt. Reports the duration of the linkoutput calls, the
+ *    p50 / p99 / max delay of both flows from linkoutput to the SPI data
+ *    phase, the bulk throughput and the delay statistics kept by the driver.
+ *    Every accepted frame arrives once and in order and every refusal is
+ *    counted as a drop. linkoutput does not wait for a free slot: most calls
+ *    are refused, and their p99 duration is below the wire time of one bulk
+ *    frame. The p99 delay of interactive MQTT frames is below the wire time
+ *    of a full bulk queue and below the p50 delay of the same frames sent as
+ *    bulk.
+ * 4. Resources: no pbuf is leaked, the TX packet count returns to zero and
+ *    there are no SPI or header errors.
+ *
+ * Delays are measured on the host clock, so they include the thread
+ * wake-ups of the host kernel. The data plane thread starts with the 2.1 s
+ * hardware reset of the module.
+ *
+ * Exits with a failure status if any check fails.
+ *
+ * Build and run from the repository root:
+ *   cc -O2 -Itools/host -ICommon/include -ICommon/cli -ICommon/net/mxchip -ICommon/net/lwip_port/include \
+ *      tools/mx_dataplane_emulator.c Common/net/mxchip/mx_lwip.c Common/net/mxchip/mx_dataplane.c \
+ *      tools/host/host_kernel.c -lpthread -o mx_dataplane_emulator
+ *   ./mx_dataplane_emulator [duration_ms]
+ */
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "message_buffer.h"
+#include "atomic.h"
+
+#include "mx_ipc.h"
+#include "mx_prv.h"
+#include "lwip/prot/ip.h"
+#include "lwip/prot/ip4.h"
+#include "lwip/prot/udp.h"
+
+#define TEST_DURATION_MS              1000U
+#define TEST_MAX_DURATION_MS          10000U
+#define TEST_INTERACTIVE_PERIOD_US    5000U
+#define TEST_BACKOFF_US               200U
+#define TEST_SPI_NS_PER_BYTE          1000U /* 8 Mbit/s */
+#define TEST_DRAIN_TIMEOUT_MS         5000U
+#define TEST_MAX_RX                   32768U
+#define TEST_MAX_OUTPUT_SAMPLES       65536U
+
+#define TEST_BULK_LEN                 1514U
+#define TEST_SMALL_LEN                80U
+#define TEST_TAG_MAGIC                0x4D584450UL
+#define TEST_TAG_OFFSET               ( SIZEOF_ETH_HDR + IP_HLEN + 20U ) /* Behind a TCP header */
+
+/* Pins of the mocked module, the port is opaque on the host */
+#define TEST_PIN_FLOW                 ( ( uint16_t ) 0x0001 )
+#define TEST_PIN_RESET                ( ( uint16_t ) 0x0002 )
+#define TEST_PIN_NSS                  ( ( uint16_t ) 0x0004 )
+#define TEST_PIN_NOTIFY               ( ( uint16_t ) 0x0008 )
+
+typedef enum
+{
+    TEST_FLOW_ARP = 0,
+    TEST_FLOW_ICMP,
+    TEST_FLOW_BULK,
+    TEST_FLOW_MQTT,
+    TEST_FLOW_MQTT_PLAIN,
+    TEST_FLOW_CS3,
+    TEST_FLOW_AF11,
+    TEST_FLOW_DNS,
+    TEST_FLOW_UDP,
+    TEST_FLOW_FRAGMENT,
+    TEST_FLOW_IPV6,
+    TEST_FLOW_MAX
+} TestFlowId_t;
+
+typedef struct
+{
+    const char * pcName;
+    uint16_t usEthType;
+    uint8_t ucProto;
+    uint8_t ucTos;
+    uint16_t usOffset; /* Flags and fragment offset */
+    uint16_t usSrcPort;
+    uint16_t usDstPort;
+    MxTxClass_t xClass; /* Expected class */
+} TestFlow_t;
+
+/* Carried by every test frame at TEST_TAG_OFFSET */
+typedef struct
+{
+    uint32_t ulMagic;
+    uint32_t ulFlow;
+    uint32_t ulSeq;
+    uint32_t ulPad;
+    uint64_t ullSentNs;
+} TestTag_t;
+
+typedef struct
+{
+    uint32_t ulFlow;
+    uint32_t ulSeq;
+    uint64_t ullDelayNs;
+} TestRx_t;
+
+struct HostSpiHandle
+{
+    pSPI_CallbackTypeDef pxCallbacks[ HAL_SPI_ERROR_CB_ID + 1 ];
+};
+
+typedef struct
+{
+    volatile bool xStalled;
+    volatile bool xSelected;
+    uint16_t usExpectedLen;
+    volatile uint32_t ulRxCount;
+    volatile uint32_t ulCorrupt;
+    TestRx_t xRx[ TEST_MAX_RX ];
+} TestModule_t;
+
+typedef struct
+{
+    uint32_t ulAccepted[ TEST_FLOW_MAX ];
+    uint32_t ulRefused[ TEST_FLOW_MAX ];
+    uint32_t ulOutputSamples;
+    uint64_t ullOutputNs[ TEST_MAX_OUTPUT_SAMPLES ];
+} TestSender_t;
+
+static const TestFlow_t xFlows[ TEST_FLOW_MAX ] =
+{
+    [ TEST_FLOW_ARP ] =        { "arp",           ETHTYPE_ARP,  0,             0x00, 0x0000, 0,     0,    MX_TX_CLASS_INTERACTIVE },
+    [ TEST_FLOW_ICMP ] =       { "icmp",          ETHTYPE_IP,   IP_PROTO_ICMP, 0x00, 0x0000, 0,     0,    MX_TX_CLASS_INTERACTIVE },
+    [ TEST_FLOW_BULK ] =       { "tcp 443",       ETHTYPE_IP,   IP_PROTO_TCP,  0x00, 0x0000, 49152, 443,  MX_TX_CLASS_BULK        },
+    [ TEST_FLOW_MQTT ] =       { "mqtt 8883",     ETHTYPE_IP,   IP_PROTO_TCP,  0x00, 0x0000, 49153, 8883, MX_TX_CLASS_INTERACTIVE },
+    [ TEST_FLOW_MQTT_PLAIN ] = { "mqtt 1883",     ETHTYPE_IP,   IP_PROTO_TCP,  0x00, 0x0000, 49154, 1883, MX_TX_CLASS_BULK        },
+    [ TEST_FLOW_CS3 ] =        { "tcp 443 cs3",   ETHTYPE_IP,   IP_PROTO_TCP,  0x60, 0x0000, 49155, 443,  MX_TX_CLASS_INTERACTIVE },
+    [ TEST_FLOW_AF11 ] =       { "tcp 443 af11",  ETHTYPE_IP,   IP_PROTO_TCP,  0x28, 0x0000, 49156, 443,  MX_TX_CLASS_BULK        },
+    [ TEST_FLOW_DNS ] =        { "udp 53",        ETHTYPE_IP,   IP_PROTO_UDP,  0x00, 0x0000, 5353,  53,   MX_TX_CLASS_INTERACTIVE },
+    [ TEST_FLOW_UDP ] =        { "udp 5001",      ETHTYPE_IP,   IP_PROTO_UDP,  0x00, 0x0000, 5000,  5001, MX_TX_CLASS_BULK        },
+    [ TEST_FLOW_FRAGMENT ] =   { "udp 53 frag",   ETHTYPE_IP,   IP_PROTO_UDP,  0x00, IP_MF,  5353,  53,   MX_TX_CLASS_BULK        },
+    [ TEST_FLOW_IPV6 ] =       { "ipv6",          ETHTYPE_IPV6, 0,             0x00, 0x0000, 0,     0,    MX_TX_CLASS_BULK        },
+};
+
+static const IotMappedPin_t xPinFlow = { GPIOA, TEST_PIN_FLOW, 0 };
+static const IotMappedPin_t xPinReset = { GPIOA, TEST_PIN_RESET, 0 };
+static const IotMappedPin_t xPinNss = { GPIOA, TEST_PIN_NSS, 0 };
+static const IotMappedPin_t xPinNotify = { GPIOA, TEST_PIN_NOTIFY, 0 };
+
+static struct HostSpiHandle xSpi;
+static GPIOInterruptCallback_t xFlowCallback = NULL;
+static void * pvFlowContext = NULL;
+
+static MxNetConnectCtx_t xNetCtx;
+static MxDataplaneCtx_t xDataplaneCtx;
+static MxTxQueueStats_t xTxQueueStats[ MX_TX_CLASS_MAX ];
+static MxSpiStats_t xSpiStats;
+static TestModule_t xModule;
+static TestSender_t xSender;
+
+static volatile uint32_t ulLiveAllocations = 0;
+static uint32_t ulFailures = 0;
+
+/*-----------------------------------------------------------*/
+
+static void prvCheck( bool xCondition,
+                      const char * pcWhat )
+{
+    if( !xCondition )
+    {
+        printf( "FAIL: %s\n", pcWhat );
+        ulFailures++;
+    }
+}
+
+/* Only pbufs are allocated from the heap, so live allocations are pbufs */
+void * pvPortMalloc( size_t xWantedSize )
+{
+    void * pv = malloc( xWantedSize );
+
+    if( pv != NULL )
+    {
+        ( void ) Atomic_Increment_u32( &ulLiveAllocations );
+    }
+
+    return pv;
+}
+
+void vPortFree( void * pv )
+{
+    if( pv != NULL )
+    {
+        ( void ) Atomic_Decrement_u32( &ulLiveAllocations );
+    }
+
+    free( pv );
+}
+
+/* Frames are handed to linkoutput directly, ARP resolution is not used */
+err_t etharp_output( struct netif * netif,
+                     struct pbuf * q,
+                     const ip4_addr_t * ipaddr )
+{
+    ( void ) netif;
+    ( void ) q;
+    ( void ) ipaddr;
+
+    return ERR_VAL;
+}
+
+static uint64_t prvNowNs( void )
+{
+    struct timespec xNow;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &xNow );
+
+    return ( ( uint64_t ) xNow.tv_sec * 1000000000U ) + ( uint64_t ) xNow.tv_nsec;
+}
+
+static void prvSleepUs( uint32_t ulUs )
+{
+    struct timespec xDelay = { ( time_t ) ( ulUs / 1000000U ), ( long ) ( ulUs % 1000000U ) * 1000L };
+
+    ( void ) nanosleep( &xDelay, NULL );
+}
+
+/*-----------------------------------------------------------*/
+
+/* The emulated EMW3080 behind the mocked GPIO and SPI HAL */
+
+void GPIO_EXTI_Register_Callback( uint16_t usGpioPinMask,
+                                  GPIOInterruptCallback_t pvCallback,
+                                  void * pvContext )
+{
+    if( usGpioPinMask == TEST_PIN_FLOW )
+    {
+        pvFlowContext = pvContext;
+        xFlowCallback = pvCallback;
+    }
+}
+
+static void prvRaiseFlow( void )
+{
+    if( ( xModule.xStalled == false ) && ( xFlowCallback != NULL ) )
+    {
+        xFlowCallback( pvFlowContext );
+    }
+}
+
+void HAL_GPIO_WritePin( GPIO_TypeDef * pxGpio,
+                        uint16_t usPin,
+                        GPIO_PinState xState )
+{
+    ( void ) pxGpio;
+
+    if( usPin == TEST_PIN_NSS )
+    {
+        xModule.xSelected = ( xState == GPIO_PIN_RESET );
+
+        /* Ready for the header exchange */
+        if( xModule.xSelected )
+        {
+            prvRaiseFlow();
+        }
+    }
+}
+
+/* The module has nothing to send */
+GPIO_PinState HAL_GPIO_ReadPin( GPIO_TypeDef * pxGpio,
+                                uint16_t usPin )
+{
+    ( void ) pxGpio;
+    ( void ) usPin;
+
+    return GPIO_PIN_RESET;
+}
+
+HAL_StatusTypeDef HAL_SPI_RegisterCallback( SPI_HandleTypeDef * hspi,
+                                            HAL_SPI_CallbackIDTypeDef CallbackID,
+                                            pSPI_CallbackTypeDef pCallback )
+{
+    HAL_StatusTypeDef xStatus = HAL_ERROR;
+
+    if( CallbackID <= HAL_SPI_ERROR_CB_ID )
+    {
+        hspi->pxCallbacks[ CallbackID ] = pCallback;
+        xStatus = HAL_OK;
+    }
+
+    return xStatus;
+}
+
+static void prvSpiComplete( SPI_HandleTypeDef * hspi,
+                            HAL_SPI_CallbackIDTypeDef xCallbackId )
+{
+    configASSERT( hspi->pxCallbacks[ xCallbackId ] != NULL );
+    hspi->pxCallbacks[ xCallbackId ]( hspi );
+}
+
+/* Header exchange */
+HAL_StatusTypeDef HAL_SPI_TransmitReceive_DMA( SPI_HandleTypeDef * hspi,
+                                               const uint8_t * pTxData,
+                                               uint8_t * pRxData,
+                                               uint16_t Size )
+{
+    const SPIHeader_t * pxTxHeader = ( const SPIHeader_t * ) pTxData;
+    SPIHeader_t * pxRxHeader = ( SPIHeader_t * ) pRxData;
+
+    configASSERT( xModule.xSelected );
+
+    if( ( Size != sizeof( SPIHeader_t ) ) ||
+        ( pxTxHeader->type != 0x0A ) ||
+        ( ( uint16_t ) ( pxTxHeader->len ^ pxTxHeader->lenx ) != 0xFFFFU ) )
+    {
+        xModule.ulCorrupt++;
+        xModule.usExpectedLen = 0;
+    }
+    else
+    {
+        xModule.usExpectedLen = pxTxHeader->len;
+    }
+
+    ( void ) memset( pxRxHeader, 0, Size );
+    pxRxHeader->type = 0x0B;
+    pxRxHeader->len = 0;
+    pxRxHeader->lenx = 0xFFFFU;
+
+    prvSpiComplete( hspi, HAL_SPI_TX_RX_COMPLETE_CB_ID );
+
+    /* Ready for the data phase */
+    prvRaiseFlow();
+
+    return HAL_OK;
+}
+
+/* Data phase: logs the frame, then takes the wire time of the module */
+HAL_StatusTypeDef HAL_SPI_Transmit_DMA( SPI_HandleTypeDef * hspi,
+                                        const uint8_t * pData,
+                                        uint16_t Size )
+{
+    const BypassInOut_t * pxBypass = ( const BypassInOut_t * ) pData;
+    uint64_t ullNowNs = prvNowNs();
+    TestTag_t xTag;
+
+    configASSERT( xModule.xSelected );
+
+    if( ( Size != xModule.usExpectedLen ) ||
+        ( Size < sizeof( BypassInOut_t ) + TEST_TAG_OFFSET + sizeof( TestTag_t ) ) ||
+        ( pxBypass->xHeader.usIPCApiId != IPC_WIFI_BYPASS_OUT ) ||
+        ( pxBypass->lIndex != WIFI_BYPASS_MODE_STATION ) ||
+        ( pxBypass->usDataLen != Size - sizeof( BypassInOut_t ) ) )
+    {
+        xModule.ulCorrupt++;
+    }
+    else
+    {
+        ( void ) memcpy( &xTag, &( pData[ sizeof( BypassInOut_t ) + TEST_TAG_OFFSET ] ), sizeof( TestTag_t ) );
+
+        if( ( xTag.ulMagic != TEST_TAG_MAGIC ) || ( xTag.ulFlow >= TEST_FLOW_MAX ) )
+        {
+            xModule.ulCorrupt++;
+        }
+        else if( xModule.ulRxCount < TEST_MAX_RX )
+        {
+            TestRx_t * pxRx = &( xModule.xRx[ xModule.ulRxCount ] );
+
+            pxRx->ulFlow = xTag.ulFlow;
+            pxRx->ulSeq = xTag.ulSeq;
+            pxRx->ullDelayNs = ullNowNs - xTag.ullSentNs;
+            xModule.ulRxCount++;
+        }
+    }
+
+    prvSleepUs( ( uint32_t ) ( ( ( uint64_t ) Size * TEST_SPI_NS_PER_BYTE ) / 1000U ) );
+
+    prvSpiComplete( hspi, HAL_SPI_TX_COMPLETE_CB_ID );
+
+    return HAL_OK;
+}
+
+/* The module never announces data, so the data plane never receives */
+HAL_StatusTypeDef HAL_SPI_Receive_DMA( SPI_HandleTypeDef * hspi,
+                                       uint8_t * pData,
+                                       uint16_t Size )
+{
+    ( void ) pData;
+    ( void ) Size;
+
+    xModule.ulCorrupt++;
+    prvSpiComplete( hspi, HAL_SPI_ERROR_CB_ID );
+
+    return HAL_OK;
+}
+
+/*-----------------------------------------------------------*/
+
+/* The "tcpip thread": builds a frame of flow ulFlow and passes it to linkoutput */
+static err_t prvSend( uint32_t ulFlow,
+                      uint16_t usLen,
+                      uint32_t ulSeq,
+                      pbuf_layer xLayer,
+                      uint64_t ullSentNs )
+{
+    const TestFlow_t * pxFlow = &( xFlows[ ulFlow ] );
+    PacketBuffer_t * pxPbuf = pbuf_alloc( xLayer, usLen, PBUF_RAM );
+    err_t xError = ERR_MEM;
+
+    if( pxPbuf != NULL )
+    {
+        uint8_t * pucFrame = ( uint8_t * ) pxPbuf->payload;
+        struct eth_hdr * pxEth = ( struct eth_hdr * ) pucFrame;
+        struct ip_hdr * pxIp = ( struct ip_hdr * ) &( pucFrame[ SIZEOF_ETH_HDR ] );
+        struct udp_hdr * pxPorts = ( struct udp_hdr * ) &( pucFrame[ SIZEOF_ETH_HDR + IP_HLEN ] );
+        TestTag_t xTag = { TEST_TAG_MAGIC, ulFlow, ulSeq, 0, ullSentNs };
+        uint64_t ullStartNs;
+        uint64_t ullOutputNs;
+
+        configASSERT( usLen >= TEST_TAG_OFFSET + sizeof( TestTag_t ) );
+
+        ( void ) memset( pucFrame, 0, usLen );
+        pxEth->type = lwip_htons( pxFlow->usEthType );
+
+        if( pxFlow->usEthType == ETHTYPE_IP )
+        {
+            pxIp->_v_hl = 0x45;
+            pxIp->_tos = pxFlow->ucTos;
+            pxIp->_len = lwip_htons( ( u16_t ) ( usLen - SIZEOF_ETH_HDR ) );
+            pxIp->_offset = lwip_htons( pxFlow->usOffset );
+            pxIp->_ttl = 64;
+            pxIp->_proto = pxFlow->ucProto;
+            pxPorts->src = lwip_htons( pxFlow->usSrcPort );
+            pxPorts->dest = lwip_htons( pxFlow->usDstPort );
+        }
+
+        ( void ) memcpy( &( pucFrame[ TEST_TAG_OFFSET ] ), &xTag, sizeof( xTag ) );
+
+        ullStartNs = prvNowNs();
+        xError = xNetCtx.xNetif.linkoutput( &( xNetCtx.xNetif ), pxPbuf );
+        ullOutputNs = prvNowNs() - ullStartNs;
+
+        /* lwIP frees its reference once linkoutput returns */
+        PBUF_FREE( pxPbuf );
+
+        if( xSender.ulOutputSamples < TEST_MAX_OUTPUT_SAMPLES )
+        {
+            xSender.ullOutputNs[ xSender.ulOutputSamples++ ] = ullOutputNs;
+        }
+
+        if( xError == ERR_OK )
+        {
+            xSender.ulAccepted[ ulFlow ]++;
+        }
+        else
+        {
+            xSender.ulRefused[ ulFlow ]++;
+        }
+    }
+
+    return xError;
+}
+
+/* Waits until the module has logged ulRxCount frames and no frame is queued */
+static bool prvWaitDrained( uint32_t ulRxCount )
+{
+    TickType_t xStart = xTaskGetTickCount();
+
+    while( ( ( xModule.ulRxCount < ulRxCount ) || ( xDataplaneCtx.ulTxPacketsWaiting != 0 ) ) &&
+           ( ( xTaskGetTickCount() - xStart ) < pdMS_TO_TICKS( TEST_DRAIN_TIMEOUT_MS ) ) )
+    {
+        vTaskDelay( pdMS_TO_TICKS( 1 ) );
+    }
+
+    return( ( xModule.ulRxCount == ulRxCount ) && ( xDataplaneCtx.ulTxPacketsWaiting == 0 ) );
+}
+
+/* Frames of ulFlow logged from index ulFirst, in order of transmission */
+static uint32_t prvCollect( uint32_t ulFirst,
+                            uint32_t ulFlow,
+                            const TestRx_t ** ppxRx,
+                            uint32_t ulMax )
+{
+    uint32_t ulCount = 0;
+    uint32_t i;
+
+    for( i = ulFirst; i < xModule.ulRxCount; i++ )
+    {
+        if( ( xModule.xRx[ i ].ulFlow == ulFlow ) && ( ulCount < ulMax ) )
+        {
+            ppxRx[ ulCount++ ] = &( xModule.xRx[ i ] );
+        }
+    }
+
+    return ulCount;
+}
+
+/* Time taken by the module to receive a frame of usLen bytes */
+static uint64_t prvWireTimeNs( uint16_t usLen )
+{
+    return ( ( uint64_t ) usLen + sizeof( BypassInOut_t ) ) * TEST_SPI_NS_PER_BYTE;
+}
+
+static int prvCompareU64( const void * pvA,
+                          const void * pvB )
+{
+    uint64_t ullA = *( const uint64_t * ) pvA;
+    uint64_t ullB = *( const uint64_t * ) pvB;
+
+    return ( ullA > ullB ) - ( ullA < ullB );
+}
+
+/*-----------------------------------------------------------*/
+
+typedef struct
+{
+    uint32_t ulFlow;
+    uint16_t usLen;
+    pbuf_layer xLayer;
+} TestFrame_t;
+
+static void prvRunClassification( void )
+{
+    static const TestFrame_t xFrames[] =
+    {
+        { TEST_FLOW_ARP,        TEST_SMALL_LEN, PBUF_LINK      },
+        { TEST_FLOW_ICMP,       TEST_SMALL_LEN, PBUF_IP        },
+        { TEST_FLOW_BULK,       TEST_BULK_LEN,  PBUF_TRANSPORT },
+        { TEST_FLOW_BULK,       TEST_SMALL_LEN, PBUF_TRANSPORT },
+        { TEST_FLOW_MQTT,       TEST_SMALL_LEN, PBUF_TRANSPORT },
+        { TEST_FLOW_MQTT_PLAIN, TEST_SMALL_LEN, PBUF_TRANSPORT },
+        { TEST_FLOW_CS3,        TEST_BULK_LEN,  PBUF_TRANSPORT },
+        { TEST_FLOW_AF11,       TEST_SMALL_LEN, PBUF_TRANSPORT },
+        { TEST_FLOW_DNS,        TEST_SMALL_LEN, PBUF_TRANSPORT },
+        { TEST_FLOW_UDP,        TEST_SMALL_LEN, PBUF_RAW       }, /* No header space: copied */
+        { TEST_FLOW_FRAGMENT,   TEST_BULK_LEN,  PBUF_IP        },
+        { TEST_FLOW_IPV6,       TEST_SMALL_LEN, PBUF_LINK      },
+    };
+    const uint32_t ulFrames = sizeof( xFrames ) / sizeof( xFrames[ 0 ] );
+    uint32_t ulFirst = xModule.ulRxCount;
+    uint32_t ulMisclassified = 0;
+    uint32_t ulLastInteractive = 0;
+    uint32_t ulFirstBulk = UINT32_MAX;
+    uint32_t ulCopied = 0;
+    uint32_t ulBulkSeq = 0;
+    uint32_t i;
+
+    xModule.xStalled = true;
+
+    for( i = 0; i < ulFrames; i++ )
+    {
+        const TestFlow_t * pxFlow = &( xFlows[ xFrames[ i ].ulFlow ] );
+        MxTxQueueStats_t xBefore = xTxQueueStats[ pxFlow->xClass ];
+        uint32_t ulSeq = ( xFrames[ i ].ulFlow == TEST_FLOW_BULK ) ? ulBulkSeq++ : 0U;
+        err_t xError = prvSend( xFrames[ i ].ulFlow, xFrames[ i ].usLen, ulSeq, xFrames[ i ].xLayer, prvNowNs() );
+
+        if( ( xError != ERR_OK ) ||
+            ( xTxQueueStats[ pxFlow->xClass ].ulEnqueued != xBefore.ulEnqueued + 1U ) )
+        {
+            printf( "misclassified: %s\n", pxFlow->pcName );
+            ulMisclassified++;
+        }
+
+        ulCopied += xTxQueueStats[ pxFlow->xClass ].ulCopiedFrames - xBefore.ulCopiedFrames;
+    }
+
+    xModule.xStalled = false;
+
+    prvCheck( prvWaitDrained( ulFirst + ulFrames ), "the classified frames are transmitted" );
+
+    for( i = ulFirst; i < xModule.ulRxCount; i++ )
+    {
+        if( xFlows[ xModule.xRx[ i ].ulFlow ].xClass == MX_TX_CLASS_INTERACTIVE )
+        {
+            ulLastInteractive = i;
+        }
+        else if( ulFirstBulk == UINT32_MAX )
+        {
+            ulFirstBulk = i;
+        }
+    }
+
+    {
+        const TestRx_t * pxBulk[ 2 ] = { NULL, NULL };
+
+        prvCheck( ( prvCollect( ulFirst, TEST_FLOW_BULK, pxBulk, 2 ) == 2 ) &&
+                  ( pxBulk[ 0 ]->ulSeq == 0 ) && ( pxBulk[ 1 ]->ulSeq == 1 ),
+                  "a short segment does not overtake a full one of the same connection" );
+    }
+
+    printf( "classification: %lu frames, %lu misclassified, %lu copied\n",
+            ( unsigned long ) ulFrames, ( unsigned long ) ulMisclassified, ( unsigned long ) ulCopied );
+
+    prvCheck( ulMisclassified == 0, "frames are classified by flow" );
+    prvCheck( ulCopied == 1, "only the pbuf without header space is copied" );
+    prvCheck( ulLastInteractive < ulFirstBulk, "queued interactive frames are sent ahead of bulk frames" );
+}
+
+static void prvRunDropPolicies( void )
+{
+    const uint32_t ulExtra = 3;
+    uint32_t ulFirst = xModule.ulRxCount;
+    MxTxQueueStats_t xBefore[ MX_TX_CLASS_MAX ];
+    uint32_t ulBulkRefused = 0;
+    uint32_t ulInteractiveRefused = 0;
+    const TestRx_t * pxRx[ DATA_PLANE_QUEUE_LEN + 1 ];
+    uint32_t ulCount;
+    bool xInOrder = true;
+    uint32_t i;
+
+    ( void ) memcpy( xBefore, xTxQueueStats, sizeof( xBefore ) );
+
+    xModule.xStalled = true;
+
+    for( i = 0; i < DATA_PLANE_QUEUE_LEN + ulExtra; i++ )
+    {
+        ulBulkRefused += ( prvSend( TEST_FLOW_BULK, TEST_BULK_LEN, i, PBUF_TRANSPORT, prvNowNs() ) == ERR_MEM ) ? 1U : 0U;
+    }
+
+    for( i = 0; i < DATA_PLANE_PRIO_QUEUE_LEN + ulExtra; i++ )
+    {
+        ulInteractiveRefused += ( prvSend( TEST_FLOW_MQTT, TEST_SMALL_LEN, i, PBUF_TRANSPORT, prvNowNs() ) != ERR_OK ) ? 1U : 0U;
+    }
+
+    xModule.xStalled = false;
+
+    prvCheck( prvWaitDrained( ulFirst + DATA_PLANE_QUEUE_LEN + DATA_PLANE_PRIO_QUEUE_LEN ),
+              "the queued frames are transmitted once the module resumes" );
+
+    printf( "drop policies: bulk %lu refused / %lu dropped, interactive %lu refused / %lu dropped\n",
+            ( unsigned long ) ulBulkRefused,
+            ( unsigned long ) ( xTxQueueStats[ MX_TX_CLASS_BULK ].ulDropped - xBefore[ MX_TX_CLASS_BULK ].ulDropped ),
+            ( unsigned long ) ulInteractiveRefused,
+            ( unsigned long ) ( xTxQueueStats[ MX_TX_CLASS_INTERACTIVE ].ulDropped - xBefore[ MX_TX_CLASS_INTERACTIVE ].ulDropped ) );
+
+    prvCheck( ulBulkRefused == ulExtra, "a full bulk queue refuses new frames with ERR_MEM" );
+    prvCheck( xTxQueueStats[ MX_TX_CLASS_BULK ].ulDropped - xBefore[ MX_TX_CLASS_BULK ].ulDropped == ulExtra,
+              "refused bulk frames are counted as drops" );
+    prvCheck( ulInteractiveRefused == 0, "a full interactive queue accepts new frames" );
+    prvCheck( xTxQueueStats[ MX_TX_CLASS_INTERACTIVE ].ulDropped - xBefore[ MX_TX_CLASS_INTERACTIVE ].ulDropped == ulExtra,
+              "a full interactive queue drops its oldest frames" );
+
+    ulCount = prvCollect( ulFirst, TEST_FLOW_BULK, pxRx, DATA_PLANE_QUEUE_LEN + 1 );
+
+    for( i = 0; i < ulCount; i++ )
+    {
+        xInOrder = xInOrder && ( pxRx[ i ]->ulSeq == i );
+    }
+
+    prvCheck( ( ulCount == DATA_PLANE_QUEUE_LEN ) && xInOrder, "the accepted bulk frames are sent in order" );
+
+    ulCount = prvCollect( ulFirst, TEST_FLOW_MQTT, pxRx, DATA_PLANE_QUEUE_LEN + 1 );
+    xInOrder = true;
+
+    for( i = 0; i < ulCount; i++ )
+    {
+        xInOrder = xInOrder && ( pxRx[ i ]->ulSeq == i + ulExtra );
+    }
+
+    prvCheck( ( ulCount == DATA_PLANE_PRIO_QUEUE_LEN ) && xInOrder, "the newest interactive frames are sent in order" );
+    prvCheck( xModule.xRx[ ulFirst ].ulFlow == TEST_FLOW_MQTT, "the interactive queue is drained first" );
+}
+
+/* Reports the p50 / p99 / max of ulCount delays and returns the p50 and p99 */
+static void prvReportDelays( const char * pcName,
+                             uint64_t * pullDelayNs,
+                             uint32_t ulCount,
+                             uint64_t * pullP50Ns,
+                             uint64_t * pullP99Ns )
+{
+    qsort( pullDelayNs, ulCount, sizeof( uint64_t ), prvCompareU64 );
+
+    *pullP50Ns = ( ulCount > 0 ) ? pullDelayNs[ ulCount / 2U ] : 0U;
+    *pullP99Ns = ( ulCount > 0 ) ? pullDelayNs[ ( ulCount * 99U ) / 100U ] : 0U;
+
+    printf( "  %-10s %5lu samples, p50 %7.0f us, p99 %7.0f us, max %7.0f us\n",
+            pcName, ( unsigned long ) ulCount,
+            ( double ) *pullP50Ns / 1e3, ( double ) *pullP99Ns / 1e3,
+            ( ulCount > 0 ) ? ( double ) pullDelayNs[ ulCount - 1U ] / 1e3 : 0.0 );
+}
+
+/* Runs the mixed load with the MQTT frames on flow ulMqttFlow and returns their p50 and p99 delay */
+static void prvRunMixed( const char * pcName,
+                         uint32_t ulMqttFlow,
+                         uint32_t ulDurationMs,
+                         uint64_t * pullMqttP50Ns,
+                         uint64_t * pullMqttP99Ns )
+{
+    static const TestRx_t * pxRx[ TEST_MAX_RX ];
+    static uint64_t ullDelayNs[ TEST_MAX_RX ];
+    MxTxQueueStats_t xBefore[ MX_TX_CLASS_MAX ];
+    uint32_t ulFirst = xModule.ulRxCount;
+    uint32_t ulRefusedBefore = xSender.ulRefused[ TEST_FLOW_BULK ] + xSender.ulRefused[ ulMqttFlow ];
+    uint32_t ulRefused;
+    uint32_t ulBulkSeq = 0;
+    uint32_t ulMqttSeq = 0;
+    uint32_t ulCount;
+    uint64_t ullStartNs;
+    uint64_t ullEndNs;
+    uint64_t ullNextMqttNs;
+    uint64_t ullMqttSentNs = 0;
+    uint64_t ullBulkP50Ns;
+    uint64_t ullBulkP99Ns;
+    uint64_t ullOutputP50Ns;
+    uint64_t ullOutputP99Ns;
+    bool xMqttPending = false;
+    bool xInOrder = true;
+    uint32_t i;
+
+    ( void ) memcpy( xBefore, xTxQueueStats, sizeof( xBefore ) );
+    xSender.ulOutputSamples = 0;
+
+    ullStartNs = prvNowNs();
+    ullEndNs = ullStartNs + ( ( uint64_t ) ulDurationMs * 1000000U );
+    ullNextMqttNs = ullStartNs;
+
+    for( uint64_t ullNowNs = ullStartNs; ullNowNs < ullEndNs; ullNowNs = prvNowNs() )
+    {
+        err_t xError;
+
+        if( ( xMqttPending == false ) && ( ullNowNs >= ullNextMqttNs ) )
+        {
+            xMqttPending = true;
+            ullMqttSentNs = ullNowNs;
+            ullNextMqttNs += ( uint64_t ) TEST_INTERACTIVE_PERIOD_US * 1000U;
+        }
+
+        if( xMqttPending )
+        {
+            xError = prvSend( ulMqttFlow, TEST_SMALL_LEN, ulMqttSeq, PBUF_TRANSPORT, ullMqttSentNs );
+
+            if( xError == ERR_OK )
+            {
+                ulMqttSeq++;
+                xMqttPending = false;
+            }
+        }
+        else
+        {
+            xError = prvSend( TEST_FLOW_BULK, TEST_BULK_LEN, ulBulkSeq, PBUF_TRANSPORT, ullNowNs );
+
+            if( xError == ERR_OK )
+            {
+                ulBulkSeq++;
+            }
+        }
+
+        if( xError != ERR_OK )
+        {
+            prvSleepUs( TEST_BACKOFF_US );
+        }
+    }
+
+    prvCheck( prvWaitDrained( ulFirst + ulBulkSeq + ulMqttSeq ), "every accepted frame is transmitted" );
+
+    ulRefused = xSender.ulRefused[ TEST_FLOW_BULK ] + xSender.ulRefused[ ulMqttFlow ] - ulRefusedBefore;
+
+    printf( "%s: %lu ms, %lu frames refused\n", pcName, ( unsigned long ) ulDurationMs, ( unsigned long ) ulRefused );
+
+    prvReportDelays( "linkoutput", xSender.ullOutputNs, xSender.ulOutputSamples, &ullOutputP50Ns, &ullOutputP99Ns );
+
+    ulCount = prvCollect( ulFirst, ulMqttFlow, pxRx, TEST_MAX_RX );
+
+    for( i = 0; i < ulCount; i++ )
+    {
+        xInOrder = xInOrder && ( pxRx[ i ]->ulSeq == i );
+        ullDelayNs[ i ] = pxRx[ i ]->ullDelayNs;
+    }
+
+    prvCheck( ( ulCount == ulMqttSeq ) && xInOrder, "every MQTT frame arrives once and in order" );
+    prvReportDelays( xFlows[ ulMqttFlow ].pcName, ullDelayNs, ulCount, pullMqttP50Ns, pullMqttP99Ns );
+
+    ulCount = prvCollect( ulFirst, TEST_FLOW_BULK, pxRx, TEST_MAX_RX );
+    xInOrder = true;
+
+    for( i = 0; i < ulCount; i++ )
+    {
+        xInOrder = xInOrder && ( pxRx[ i ]->ulSeq == i );
+        ullDelayNs[ i ] = pxRx[ i ]->ullDelayNs;
+    }
+
+    prvCheck( ( ulCount == ulBulkSeq ) && xInOrder, "every accepted bulk frame arrives once and in order" );
+    prvReportDelays( xFlows[ TEST_FLOW_BULK ].pcName, ullDelayNs, ulCount, &ullBulkP50Ns, &ullBulkP99Ns );
+
+    printf( "  bulk throughput %.0f kB/s\n",
+            ( double ) ulBulkSeq * TEST_BULK_LEN * 1e6 / ( double ) ulDurationMs / 1e3 / 1e3 );
+
+    for( i = 0; i < MX_TX_CLASS_MAX; i++ )
+    {
+        uint32_t ulDequeued = xTxQueueStats[ i ].ulDequeued - xBefore[ i ].ulDequeued;
+        uint32_t ulDelayTicks = xTxQueueStats[ i ].ulTotalDelayTicks - xBefore[ i ].ulTotalDelayTicks;
+
+        printf( "  driver %-11s %5lu enqueued, %5lu dropped, %5lu dequeued, mean delay %.2f ticks\n",
+                ( i == MX_TX_CLASS_INTERACTIVE ) ? "interactive" : "bulk",
+                ( unsigned long ) ( xTxQueueStats[ i ].ulEnqueued - xBefore[ i ].ulEnqueued ),
+                ( unsigned long ) ( xTxQueueStats[ i ].ulDropped - xBefore[ i ].ulDropped ),
+                ( unsigned long ) ulDequeued,
+                ( ulDequeued > 0 ) ? ( double ) ulDelayTicks / ( double ) ulDequeued : 0.0 );
+    }
+
+    prvCheck( ulRefused == ( xTxQueueStats[ MX_TX_CLASS_BULK ].ulDropped - xBefore[ MX_TX_CLASS_BULK ].ulDropped ),
+              "every refused frame is counted as a bulk drop" );
+    prvCheck( xTxQueueStats[ MX_TX_CLASS_INTERACTIVE ].ulDropped == xBefore[ MX_TX_CLASS_INTERACTIVE ].ulDropped,
+              "no interactive frame is dropped under bulk load" );
+    /* Most calls are refused, a blocking enqueue would hold them until the data plane frees a slot */
+    prvCheck( ullOutputP99Ns < prvWireTimeNs( TEST_BULK_LEN ), "linkoutput does not wait for a free slot" );
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    uint32_t ulDurationMs = TEST_DURATION_MS;
+    uint64_t ullMarkedP50Ns;
+    uint64_t ullMarkedP99Ns;
+    uint64_t ullPlainP50Ns;
+    uint64_t ullPlainP99Ns;
+    uint64_t ullFullQueueNs;
+    BaseType_t xResult;
+
+    if( argc > 1 )
+    {
+        ulDurationMs = ( uint32_t ) strtoul( argv[ 1 ], NULL, 10 );
+    }
+
+    if( ( ulDurationMs < 100U ) || ( ulDurationMs > TEST_MAX_DURATION_MS ) )
+    {
+        ulDurationMs = TEST_DURATION_MS;
+    }
+
+    vHostKernelStartRealTime();
+
+    /* Set up like mx_netconn.c */
+    xNetCtx.xDataPlaneSendQueues[ MX_TX_CLASS_INTERACTIVE ] = xQueueCreate( DATA_PLANE_PRIO_QUEUE_LEN, sizeof( MxTxQueueItem_t ) );
+    xNetCtx.xDataPlaneSendQueues[ MX_TX_CLASS_BULK ] = xQueueCreate( DATA_PLANE_QUEUE_LEN, sizeof( MxTxQueueItem_t ) );
+    xNetCtx.pxTxQueueStats = xTxQueueStats;
+    xNetCtx.pulTxPacketsWaiting = &( xDataplaneCtx.ulTxPacketsWaiting );
+    xNetCtx.xNetif.state = &xNetCtx;
+
+    xDataplaneCtx.gpio_flow = &xPinFlow;
+    xDataplaneCtx.gpio_reset = &xPinReset;
+    xDataplaneCtx.gpio_nss = &xPinNss;
+    xDataplaneCtx.gpio_notify = &xPinNotify;
+    xDataplaneCtx.pxSpiHandle = &xSpi;
+    xDataplaneCtx.ulTxPacketsWaiting = 0;
+    xDataplaneCtx.ulLastRequestId = 0;
+    xDataplaneCtx.pxNetif = &( xNetCtx.xNetif );
+    xDataplaneCtx.xControlPlaneResponseBuff = xMessageBufferCreate( CONTROL_PLANE_BUFFER_SZ );
+    xDataplaneCtx.xDataPlaneSendQueues[ MX_TX_CLASS_INTERACTIVE ] = xNetCtx.xDataPlaneSendQueues[ MX_TX_CLASS_INTERACTIVE ];
+    xDataplaneCtx.xDataPlaneSendQueues[ MX_TX_CLASS_BULK ] = xNetCtx.xDataPlaneSendQueues[ MX_TX_CLASS_BULK ];
+    xDataplaneCtx.xControlPlaneSendQueue = xQueueCreate( CONTROL_PLANE_QUEUE_LEN, sizeof( PacketBuffer_t * ) );
+    xDataplaneCtx.pxTxQueueStats = xTxQueueStats;
+    xDataplaneCtx.pxSpiStats = &xSpiStats;
+
+    xResult = xTaskCreate( vDataplaneThread, "MxDataPlane", 0, &xDataplaneCtx, 0, &( xDataplaneCtx.xDataPlaneTaskHandle ) );
+    configASSERT( xResult == pdPASS );
+    xNetCtx.xDataPlaneTaskHandle = xDataplaneCtx.xDataPlaneTaskHandle;
+
+    ( void ) prvInitNetInterface( &( xNetCtx.xNetif ) );
+
+    prvRunClassification();
+    prvRunDropPolicies();
+
+    prvRunMixed( "mixed load, mqtt interactive", TEST_FLOW_MQTT, ulDurationMs, &ullMarkedP50Ns, &ullMarkedP99Ns );
+    prvRunMixed( "mixed load, mqtt as bulk", TEST_FLOW_MQTT_PLAIN, ulDurationMs, &ullPlainP50Ns, &ullPlainP99Ns );
+
+    /* Wire time of a full bulk queue */
+    ullFullQueueNs = ( uint64_t ) DATA_PLANE_QUEUE_LEN * prvWireTimeNs( TEST_BULK_LEN );
+
+    printf( "mqtt p99 delay: %.0f us interactive, %.0f us as bulk, full bulk queue %.0f us\n",
+            ( double ) ullMarkedP99Ns / 1e3, ( double ) ullPlainP99Ns / 1e3, ( double ) ullFullQueueNs / 1e3 );
+
+    prvCheck( ullMarkedP99Ns < ullFullQueueNs, "interactive frames do not wait behind a full bulk queue" );
+    prvCheck( ullMarkedP99Ns < ullPlainP50Ns, "interactive frames overtake the bulk queue" );
+
+    printf( "spi: %lu transfers, %lu errors, %lu header errors, module: %lu corrupt frames\n",
+            ( unsigned long ) xSpiStats.ulTransfers, ( unsigned long ) xSpiStats.ulErrors,
+            ( unsigned long ) xSpiStats.ulHeaderErrors, ( unsigned long ) xModule.ulCorrupt );
+
+    prvCheck( ( xSpiStats.ulErrors == 0 ) && ( xSpiStats.ulHeaderErrors == 0 ), "no SPI transfer fails" );
+    prvCheck( xModule.ulCorrupt == 0, "every frame reaches the module intact" );
+    prvCheck( xModule.ulRxCount < TEST_MAX_RX, "the module log did not overflow" );
+    prvCheck( xDataplaneCtx.ulTxPacketsWaiting == 0, "every TX packet is accounted for" );
+    prvCheck( ulLiveAllocations == 0, "no pbuf is leaked" );
+
+    printf( "%s (%lu failures)\n", ( ulFailures == 0 ) ? "PASS" : "FAIL", ( unsigned long ) ulFailures );
+
+    return ( ulFailures == 0 ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,779 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+/*
+ * Host evaluation of the MXCHIP control plane in Common/net/mxchip/mx_ipc.c
+ * against an emulated EMW3080, built on the tools/host kernel shim with the
+ * lwIP stand-in headers of tools/host/lwip.
+ *
+ * The emulated module takes the place of the data plane task: it drains the
+ * control plane send queue when notified on DATA_WAITING_IDX, decrements the
+ * TX packet count after each "transfer" like mx_dataplane.c and answers each
+ * request after a per API service time, one request at a time. Every
+ * TEST_DROP_EVERY th request is lost and never answered. Responses are
+ * delivered to prvControlPlaneRouter through the response message buffer, in
+ * a critical section like xProcessRxPacket. Checks:
+ * 1. Throughput and tail latency: TEST_REQUESTS asynchronous requests with
+ *    one, then NUM_IPC_REQUEST_CTX, outstanding at a time, and the same
+ *    number of synchronous requests from NUM_IPC_REQUEST_CTX tasks. Reports
+ *    completed requests per second and the p50 / p99 latency of answered
+ *    requests. Every request completes exactly once, answered requests carry
+ *    the module's response and the lost ones time out.
+ * 2. Timeouts: no request times out before its timeout has elapsed.
+ * 3. Callbacks: completion callbacks, including timeouts, run in the control
+ *    plane router task, never in the timer service task.
+ * 4. Contexts: with the module stalled, NUM_IPC_REQUEST_CTX requests are
+ *    accepted and the next one is refused. All of them time out. Repeated
+ *    once the module has answered them late, so that all contexts are free
+ *    again after late responses.
+ * 5. Resources: no pbuf is leaked and the TX packet count never goes below
+ *    zero, i.e. requests are counted before the module can transmit them.
+ *
+ * Latencies are measured on the host clock, so they include the thread
+ * wake-ups of the host kernel; the service times of the module are
+ * estimates, not measurements of an EMW3080.
+ *
+ * Exits with a failure status if any check fails.
+ *
+ * Build and run from the repository root:
+ *   cc -O2 -Itools/host -ICommon/include -ICommon/cli -ICommon/net/mxchip -ICommon/net/lwip_port/include \
+ *      tools/mx_ipc_emulator.c Common/net/mxchip/mx_ipc.c tools/host/host_kernel.c -lpthread -o mx_ipc_emulator
+ *   ./mx_ipc_emulator [requests]
+ */
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "semphr.h"
+#include "message_buffer.h"
+#include "timers.h"
+#include "atomic.h"
+
+#include "mx_ipc.h"
+#include "mx_prv.h"
+
+#define TEST_REQUESTS             400U
+#define TEST_MAX_REQUESTS         4000U
+#define TEST_TIMEOUT_MS           20U
+#define TEST_DROP_EVERY           16U
+#define TEST_MAX_PENDING          ( 2U * CONTROL_PLANE_QUEUE_LEN )
+#define TEST_IDLE_POLL_US         50U
+#define TEST_SETTLE_MS            ( 4U * TEST_TIMEOUT_MS )
+
+#define TEST_VERSION_US           800U /* IPC_SYS_VERSION */
+#define TEST_GET_MAC_US           400U /* IPC_WIFI_GET_MAC */
+#define TEST_DISCONNECT_US        1500U /* IPC_WIFI_DISCONNECT */
+#define TEST_BYPASS_SET_US        300U /* IPC_WIFI_BYPASS_SET */
+
+static const char cTestVersion[ MX_FIRMWARE_REVISION_SIZE + 1 ] = "V2.3.4";
+static const uint8_t ucTestMac[ MX_MACADDR_LEN ] = { 0xC8, 0x93, 0x46, 0x01, 0x02, 0x03 };
+
+typedef struct
+{
+    uint64_t ullIssueNs;
+    uint64_t ullDoneNs;
+    TickType_t xIssueTick;
+    TickType_t xDoneTick;
+    uint16_t usApiId;
+    IPCError_t xResult;
+    volatile uint32_t ulCompletions;
+    bool xInRouter;
+    char cVersion[ MX_FIRMWARE_REVISION_SIZE + 1 ];
+    MacAddress_t xMac;
+} TestRequest_t;
+
+typedef struct
+{
+    PacketBuffer_t * pxRxPbuf;
+    uint64_t ullDueNs;
+} TestResponse_t;
+
+typedef struct
+{
+    volatile bool xStalled;
+    volatile uint32_t ulRequests;
+    volatile uint32_t ulDropped;
+    volatile uint32_t ulUnderflows;
+    volatile uint32_t ulOverflows;
+    uint64_t ullBusyUntilNs;
+    TestResponse_t xPending[ TEST_MAX_PENDING ];
+    uint32_t ulPending;
+} TestModule_t;
+
+typedef struct
+{
+    TestRequest_t * pxRequests;
+    uint32_t ulCount;
+    SemaphoreHandle_t xDone;
+} TestSyncClient_t;
+
+static ControlPlaneCtx_t xControlPlaneCtx;
+static volatile uint32_t ulTxPacketsWaiting = 0;
+static volatile uint32_t ulLastRequestId = 0;
+static TestModule_t xModule;
+static TaskHandle_t xRouterTask = NULL;
+static SemaphoreHandle_t xSlots = NULL;
+static TestRequest_t xRequests[ TEST_MAX_REQUESTS ];
+
+static volatile uint32_t ulLiveAllocations = 0;
+static uint32_t ulFailures = 0;
+
+/*-----------------------------------------------------------*/
+
+static void prvCheck( bool xCondition,
+                      const char * pcWhat )
+{
+    if( !xCondition )
+    {
+        printf( "FAIL: %s\n", pcWhat );
+        ulFailures++;
+    }
+}
+
+/* Only pbufs are allocated from the heap, so live allocations are pbufs */
+void * pvPortMalloc( size_t xWantedSize )
+{
+    void * pv = malloc( xWantedSize );
+
+    if( pv != NULL )
+    {
+        ( void ) Atomic_Increment_u32( &ulLiveAllocations );
+    }
+
+    return pv;
+}
+
+void vPortFree( void * pv )
+{
+    if( pv != NULL )
+    {
+        ( void ) Atomic_Decrement_u32( &ulLiveAllocations );
+    }
+
+    free( pv );
+}
+
+/* Provided by mx_dataplane.c on the target */
+uint32_t prvGetNextRequestID( void )
+{
+    uint32_t ulRequestId = Atomic_Increment_u32( &ulLastRequestId ) + 1U;
+
+    /* Avoid ulRequestId == 0 */
+    if( ulRequestId == 0 )
+    {
+        ulRequestId = Atomic_Increment_u32( &ulLastRequestId ) + 1U;
+    }
+
+    return ulRequestId;
+}
+
+static uint64_t prvNowNs( void )
+{
+    struct timespec xNow;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &xNow );
+
+    return ( ( uint64_t ) xNow.tv_sec * 1000000000U ) + ( uint64_t ) xNow.tv_nsec;
+}
+
+static void prvSleepUs( uint32_t ulUs )
+{
+    struct timespec xDelay = { ( time_t ) ( ulUs / 1000000U ), ( long ) ( ulUs % 1000000U ) * 1000L };
+
+    ( void ) nanosleep( &xDelay, NULL );
+}
+
+static void prvEventCallback( MxStatus_t xEvent,
+                              void * pvCtx )
+{
+    ( void ) xEvent;
+    ( void ) pvCtx;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvServiceUs( uint16_t usApiId )
+{
+    uint32_t ulUs = TEST_GET_MAC_US;
+
+    switch( usApiId )
+    {
+        case IPC_SYS_VERSION:
+            ulUs = TEST_VERSION_US;
+            break;
+
+        case IPC_WIFI_DISCONNECT:
+            ulUs = TEST_DISCONNECT_US;
+            break;
+
+        case IPC_WIFI_BYPASS_SET:
+            ulUs = TEST_BYPASS_SET_US;
+            break;
+
+        default:
+            break;
+    }
+
+    return ulUs;
+}
+
+/* Builds the module's response to a request */
+static PacketBuffer_t * prvBuildResponse( const IPCHeader_t * pxRequest )
+{
+    uint16_t usDataLen = sizeof( struct IPCResponseStatus );
+    PacketBuffer_t * pxRxPbuf;
+
+    if( pxRequest->usIPCApiId == IPC_SYS_VERSION )
+    {
+        usDataLen = sizeof( IPCResponseSysVersion_t );
+    }
+    else if( pxRequest->usIPCApiId == IPC_WIFI_GET_MAC )
+    {
+        usDataLen = sizeof( IPCResponseWifiGetMac_t );
+    }
+
+    pxRxPbuf = PBUF_ALLOC_RX( sizeof( IPCHeader_t ) + usDataLen );
+
+    if( pxRxPbuf != NULL )
+    {
+        IPCPacket_t * pxPacket = ( IPCPacket_t * ) pxRxPbuf->payload;
+
+        pxPacket->xHeader.ulIPCRequestId = pxRequest->ulIPCRequestId;
+        pxPacket->xHeader.usIPCApiId = pxRequest->usIPCApiId;
+
+        if( pxRequest->usIPCApiId == IPC_SYS_VERSION )
+        {
+            ( void ) memcpy( pxPacket->xData.xResponseSysVersion.cFirmwareRevision, cTestVersion, MX_FIRMWARE_REVISION_SIZE );
+        }
+        else if( pxRequest->usIPCApiId == IPC_WIFI_GET_MAC )
+        {
+            ( void ) memcpy( pxPacket->xData.xResponseWifiGetMac.ucMacAddress, ucTestMac, MX_MACADDR_LEN );
+        }
+        else
+        {
+            pxPacket->xData.xEventStatus.status = IPC_SUCCESS;
+        }
+    }
+
+    return pxRxPbuf;
+}
+
+/* "Transmits" one request: the module answers it, one request at a time */
+static void prvModuleTransmit( PacketBuffer_t * pxTxPbuf )
+{
+    const IPCHeader_t * pxRequest = ( const IPCHeader_t * ) pxTxPbuf->payload;
+    uint64_t ullNowNs = prvNowNs();
+    uint32_t ulRequest = xModule.ulRequests++;
+
+    if( ( ulRequest % TEST_DROP_EVERY ) == ( TEST_DROP_EVERY - 1U ) )
+    {
+        xModule.ulDropped++;
+    }
+    else if( xModule.ulPending == TEST_MAX_PENDING )
+    {
+        xModule.ulOverflows++;
+    }
+    else
+    {
+        TestResponse_t * pxResponse = &( xModule.xPending[ xModule.ulPending ] );
+
+        if( xModule.ullBusyUntilNs < ullNowNs )
+        {
+            xModule.ullBusyUntilNs = ullNowNs;
+        }
+
+        xModule.ullBusyUntilNs += ( uint64_t ) prvServiceUs( pxRequest->usIPCApiId ) * 1000U;
+
+        pxResponse->pxRxPbuf = prvBuildResponse( pxRequest );
+        pxResponse->ullDueNs = xModule.ullBusyUntilNs;
+
+        if( pxResponse->pxRxPbuf != NULL )
+        {
+            xModule.ulPending++;
+        }
+    }
+
+    /* Like mx_dataplane.c: count the transfer, then free the TX buffer */
+    if( ulTxPacketsWaiting == 0 )
+    {
+        xModule.ulUnderflows++;
+    }
+    else
+    {
+        ( void ) Atomic_Decrement_u32( &ulTxPacketsWaiting );
+    }
+
+    PBUF_FREE( pxTxPbuf );
+}
+
+/* Delivers the responses which are due, in order, like xProcessRxPacket */
+static void prvModuleDeliver( void )
+{
+    uint64_t ullNowNs = prvNowNs();
+
+    while( ( xModule.ulPending > 0 ) && ( xModule.xPending[ 0 ].ullDueNs <= ullNowNs ) )
+    {
+        PacketBuffer_t * pxRxPbuf = xModule.xPending[ 0 ].pxRxPbuf;
+        size_t xSent;
+
+        taskENTER_CRITICAL();
+        {
+            xSent = xMessageBufferSend( xControlPlaneCtx.xControlPlaneResponseBuff,
+                                        &pxRxPbuf,
+                                        sizeof( PacketBuffer_t * ),
+                                        0 );
+        }
+        taskEXIT_CRITICAL();
+
+        if( xSent == 0 )
+        {
+            xModule.ulOverflows++;
+            PBUF_FREE( pxRxPbuf );
+        }
+
+        xModule.ulPending--;
+        ( void ) memmove( &( xModule.xPending[ 0 ] ), &( xModule.xPending[ 1 ] ), xModule.ulPending * sizeof( TestResponse_t ) );
+    }
+}
+
+static void prvModuleTask( void * pvParameters )
+{
+    ( void ) pvParameters;
+
+    for( ; ; )
+    {
+        PacketBuffer_t * pxTxPbuf = NULL;
+
+        /* Block until notified when there is nothing to answer */
+        ( void ) ulTaskNotifyTakeIndexed( DATA_WAITING_IDX, pdTRUE, ( xModule.ulPending == 0 ) ? pdMS_TO_TICKS( 1 ) : 0 );
+
+        while( ( xModule.xStalled == false ) &&
+               ( xQueueReceive( xControlPlaneCtx.xControlPlaneSendQueue, &pxTxPbuf, 0 ) == pdTRUE ) )
+        {
+            prvModuleTransmit( pxTxPbuf );
+        }
+
+        prvModuleDeliver();
+
+        if( xModule.ulPending > 0 )
+        {
+            prvSleepUs( TEST_IDLE_POLL_US );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvRequestDone( IPCError_t xError,
+                            void * pvCallbackCtx )
+{
+    TestRequest_t * pxRequest = ( TestRequest_t * ) pvCallbackCtx;
+
+    pxRequest->ullDoneNs = prvNowNs();
+    pxRequest->xDoneTick = xTaskGetTickCount();
+    pxRequest->xResult = xError;
+    pxRequest->xInRouter = ( xTaskGetCurrentTaskHandle() == xRouterTask );
+    ( void ) Atomic_Increment_u32( &( pxRequest->ulCompletions ) );
+
+    ( void ) xSemaphoreGive( xSlots );
+}
+
+static uint16_t prvApiFor( uint32_t ulIndex )
+{
+    static const uint16_t usApis[] = { IPC_WIFI_GET_MAC, IPC_SYS_VERSION, IPC_WIFI_BYPASS_SET, IPC_WIFI_DISCONNECT };
+
+    return usApis[ ulIndex % ( sizeof( usApis ) / sizeof( usApis[ 0 ] ) ) ];
+}
+
+static void prvPrepare( TestRequest_t * pxRequest,
+                        uint16_t usApiId )
+{
+    ( void ) memset( pxRequest, 0, sizeof( TestRequest_t ) );
+    pxRequest->usApiId = usApiId;
+    pxRequest->xResult = IPC_ERROR;
+    pxRequest->xIssueTick = xTaskGetTickCount();
+    pxRequest->ullIssueNs = prvNowNs();
+}
+
+static IPCError_t prvIssueAsync( TestRequest_t * pxRequest,
+                                 TickType_t xTimeout )
+{
+    IPCError_t xError = IPC_PARAMETER_ERROR;
+
+    switch( pxRequest->usApiId )
+    {
+        case IPC_SYS_VERSION:
+            xError = mx_RequestVersionAsync( pxRequest->cVersion, sizeof( pxRequest->cVersion ), xTimeout, prvRequestDone, pxRequest );
+            break;
+
+        case IPC_WIFI_GET_MAC:
+            xError = mx_GetMacAddressAsync( &( pxRequest->xMac ), xTimeout, prvRequestDone, pxRequest );
+            break;
+
+        case IPC_WIFI_BYPASS_SET:
+            xError = mx_SetBypassModeAsync( pdTRUE, xTimeout, prvRequestDone, pxRequest );
+            break;
+
+        case IPC_WIFI_DISCONNECT:
+            xError = mx_DisconnectAsync( xTimeout, prvRequestDone, pxRequest );
+            break;
+
+        default:
+            break;
+    }
+
+    return xError;
+}
+
+static IPCError_t prvIssueSync( TestRequest_t * pxRequest,
+                                TickType_t xTimeout )
+{
+    IPCError_t xError = IPC_PARAMETER_ERROR;
+
+    switch( pxRequest->usApiId )
+    {
+        case IPC_SYS_VERSION:
+            xError = mx_RequestVersion( pxRequest->cVersion, sizeof( pxRequest->cVersion ), xTimeout );
+            break;
+
+        case IPC_WIFI_GET_MAC:
+            xError = mx_GetMacAddress( &( pxRequest->xMac ), xTimeout );
+            break;
+
+        case IPC_WIFI_BYPASS_SET:
+            xError = mx_SetBypassMode( pdTRUE, xTimeout );
+            break;
+
+        case IPC_WIFI_DISCONNECT:
+            xError = mx_Disconnect( xTimeout );
+            break;
+
+        default:
+            break;
+    }
+
+    pxRequest->ullDoneNs = prvNowNs();
+    pxRequest->xDoneTick = xTaskGetTickCount();
+    pxRequest->xResult = xError;
+    pxRequest->xInRouter = true;
+    ( void ) Atomic_Increment_u32( &( pxRequest->ulCompletions ) );
+
+    return xError;
+}
+
+/* Waits until the slots of all outstanding requests are back */
+static bool prvWaitIdle( uint32_t ulOutstanding )
+{
+    bool xIdle = true;
+    uint32_t i;
+
+    for( i = 0; i < ulOutstanding; i++ )
+    {
+        xIdle = xIdle && ( xSemaphoreTake( xSlots, pdMS_TO_TICKS( TEST_SETTLE_MS ) ) == pdTRUE );
+    }
+
+    for( i = 0; i < ulOutstanding; i++ )
+    {
+        ( void ) xSemaphoreGive( xSlots );
+    }
+
+    return xIdle;
+}
+
+static void prvSyncClientTask( void * pvParameters )
+{
+    TestSyncClient_t * pxClient = ( TestSyncClient_t * ) pvParameters;
+    uint32_t i;
+
+    for( i = 0; i < pxClient->ulCount; i++ )
+    {
+        TestRequest_t * pxRequest = &( pxClient->pxRequests[ i ] );
+
+        prvPrepare( pxRequest, prvApiFor( i ) );
+        ( void ) prvIssueSync( pxRequest, pdMS_TO_TICKS( TEST_TIMEOUT_MS ) );
+    }
+
+    ( void ) xSemaphoreGive( pxClient->xDone );
+    vTaskDelete( NULL );
+}
+
+/*-----------------------------------------------------------*/
+
+static int prvCompareU64( const void * pvA,
+                          const void * pvB )
+{
+    uint64_t ullA = *( const uint64_t * ) pvA;
+    uint64_t ullB = *( const uint64_t * ) pvB;
+
+    return ( ullA > ullB ) - ( ullA < ullB );
+}
+
+/* Checks and reports ulCount completed requests which took ullWallNs */
+static void prvReport( const char * pcName,
+                       const TestRequest_t * pxRequests,
+                       uint32_t ulCount,
+                       uint64_t ullWallNs )
+{
+    static uint64_t ullLatencyNs[ TEST_MAX_REQUESTS ];
+    uint32_t ulAnswered = 0;
+    uint32_t ulTimeouts = 0;
+    uint32_t ulOnce = 0;
+    uint32_t ulCorrect = 0;
+    uint32_t ulEarly = 0;
+    uint32_t ulInRouter = 0;
+    uint32_t ulErrors = 0;
+    uint32_t i;
+
+    for( i = 0; i < ulCount; i++ )
+    {
+        const TestRequest_t * pxRequest = &( pxRequests[ i ] );
+
+        ulOnce += ( pxRequest->ulCompletions == 1U ) ? 1U : 0U;
+        ulInRouter += pxRequest->xInRouter ? 1U : 0U;
+
+        if( pxRequest->xResult == IPC_SUCCESS )
+        {
+            bool xCorrect = true;
+
+            if( pxRequest->usApiId == IPC_SYS_VERSION )
+            {
+                xCorrect = ( strcmp( pxRequest->cVersion, cTestVersion ) == 0 );
+            }
+            else if( pxRequest->usApiId == IPC_WIFI_GET_MAC )
+            {
+                xCorrect = ( memcmp( pxRequest->xMac.addr, ucTestMac, MX_MACADDR_LEN ) == 0 );
+            }
+
+            ulCorrect += xCorrect ? 1U : 0U;
+            ullLatencyNs[ ulAnswered++ ] = pxRequest->ullDoneNs - pxRequest->ullIssueNs;
+        }
+        else if( pxRequest->xResult == IPC_TIMEOUT )
+        {
+            ulTimeouts++;
+            ulEarly += ( ( TickType_t ) ( pxRequest->xDoneTick - pxRequest->xIssueTick ) < pdMS_TO_TICKS( TEST_TIMEOUT_MS ) ) ? 1U : 0U;
+        }
+        else
+        {
+            ulErrors++;
+        }
+    }
+
+    qsort( ullLatencyNs, ulAnswered, sizeof( uint64_t ), prvCompareU64 );
+
+    printf( "%-22s %4lu requests, %4lu answered, %3lu timed out, %7.0f req/s, p50 %6.0f us, p99 %6.0f us\n",
+            pcName, ( unsigned long ) ulCount, ( unsigned long ) ulAnswered, ( unsigned long ) ulTimeouts,
+            ( double ) ulAnswered * 1e9 / ( double ) ullWallNs,
+            ( ulAnswered > 0 ) ? ( double ) ullLatencyNs[ ulAnswered / 2U ] / 1e3 : 0.0,
+            ( ulAnswered > 0 ) ? ( double ) ullLatencyNs[ ( ulAnswered * 99U ) / 100U ] / 1e3 : 0.0 );
+
+    prvCheck( ulOnce == ulCount, "every request completes exactly once" );
+    prvCheck( ulErrors == 0, "every request is sent" );
+    prvCheck( ulCorrect == ulAnswered, "answered requests carry the module's response" );
+    prvCheck( ulTimeouts > 0, "lost requests time out" );
+    prvCheck( ulEarly == 0, "no request times out early" );
+    prvCheck( ulInRouter == ulCount, "completion callbacks run in the control plane router" );
+}
+
+/* Issues ulCount asynchronous requests with ulOutstanding in flight */
+static void prvRunAsync( const char * pcName,
+                         uint32_t ulCount,
+                         uint32_t ulOutstanding )
+{
+    uint64_t ullStartNs;
+    IPCError_t xError;
+    uint32_t i;
+
+    xSlots = xSemaphoreCreateCounting( ulOutstanding, ulOutstanding );
+    ullStartNs = prvNowNs();
+
+    for( i = 0; i < ulCount; i++ )
+    {
+        TestRequest_t * pxRequest = &( xRequests[ i ] );
+
+        ( void ) xSemaphoreTake( xSlots, portMAX_DELAY );
+        prvPrepare( pxRequest, prvApiFor( i ) );
+
+        /* The callback may run before the request call returns */
+        xError = prvIssueAsync( pxRequest, pdMS_TO_TICKS( TEST_TIMEOUT_MS ) );
+
+        if( xError != IPC_SUCCESS )
+        {
+            pxRequest->xResult = xError;
+            ( void ) xSemaphoreGive( xSlots );
+        }
+    }
+
+    prvCheck( prvWaitIdle( ulOutstanding ), "all asynchronous requests complete" );
+    prvReport( pcName, xRequests, ulCount, prvNowNs() - ullStartNs );
+
+    vSemaphoreDelete( xSlots );
+}
+
+/* Issues ulCount synchronous requests from NUM_IPC_REQUEST_CTX tasks */
+static void prvRunSync( const char * pcName,
+                        uint32_t ulCount )
+{
+    TestSyncClient_t xClients[ NUM_IPC_REQUEST_CTX ];
+    SemaphoreHandle_t xDone = xSemaphoreCreateCounting( NUM_IPC_REQUEST_CTX, 0 );
+    uint32_t ulPerClient = ulCount / NUM_IPC_REQUEST_CTX;
+    uint64_t ullStartNs = prvNowNs();
+    bool xDoneAll = true;
+    uint32_t i;
+
+    for( i = 0; i < NUM_IPC_REQUEST_CTX; i++ )
+    {
+        xClients[ i ].pxRequests = &( xRequests[ i * ulPerClient ] );
+        xClients[ i ].ulCount = ulPerClient;
+        xClients[ i ].xDone = xDone;
+        ( void ) xTaskCreate( prvSyncClientTask, "SyncClient", 0, &( xClients[ i ] ), 0, NULL );
+    }
+
+    for( i = 0; i < NUM_IPC_REQUEST_CTX; i++ )
+    {
+        xDoneAll = xDoneAll && ( xSemaphoreTake( xDone, portMAX_DELAY ) == pdTRUE );
+    }
+
+    prvCheck( xDoneAll, "all synchronous requests return" );
+    prvReport( pcName, xRequests, ulPerClient * NUM_IPC_REQUEST_CTX, prvNowNs() - ullStartNs );
+
+    vSemaphoreDelete( xDone );
+}
+
+/* Fills every context while the module is stalled, then lets the late
+ * responses in, which the router drops */
+static void prvRunContexts( void )
+{
+    TestRequest_t xStalled[ NUM_IPC_REQUEST_CTX + 1 ];
+    uint32_t ulAccepted = 0;
+    uint32_t ulTimeouts = 0;
+    uint32_t ulInRouter = 0;
+    uint32_t i;
+
+    xSlots = xSemaphoreCreateCounting( NUM_IPC_REQUEST_CTX + 1, NUM_IPC_REQUEST_CTX + 1 );
+    xModule.xStalled = true;
+
+    for( i = 0; i < NUM_IPC_REQUEST_CTX + 1; i++ )
+    {
+        /* The last request waits for a context for less time than the others hold theirs */
+        TickType_t xTimeout = ( i < NUM_IPC_REQUEST_CTX ) ? pdMS_TO_TICKS( TEST_TIMEOUT_MS ) : pdMS_TO_TICKS( TEST_TIMEOUT_MS / 4U );
+
+        ( void ) xSemaphoreTake( xSlots, 0 );
+        prvPrepare( &( xStalled[ i ] ), IPC_WIFI_GET_MAC );
+
+        if( mx_GetMacAddressAsync( &( xStalled[ i ].xMac ), xTimeout, prvRequestDone, &( xStalled[ i ] ) ) == IPC_SUCCESS )
+        {
+            ulAccepted++;
+        }
+        else
+        {
+            ( void ) xSemaphoreGive( xSlots );
+        }
+    }
+
+    prvCheck( ulAccepted == NUM_IPC_REQUEST_CTX, "all contexts are free and one more request is refused" );
+    prvCheck( prvWaitIdle( NUM_IPC_REQUEST_CTX + 1 ), "stalled requests time out" );
+
+    for( i = 0; i < ulAccepted; i++ )
+    {
+        ulTimeouts += ( ( xStalled[ i ].xResult == IPC_TIMEOUT ) && ( xStalled[ i ].ulCompletions == 1U ) ) ? 1U : 0U;
+        ulInRouter += xStalled[ i ].xInRouter ? 1U : 0U;
+    }
+
+    prvCheck( ulTimeouts == ulAccepted, "every stalled request times out once" );
+    prvCheck( ulInRouter == ulAccepted, "timeouts are completed by the control plane router" );
+
+    xModule.xStalled = false;
+    ( void ) xTaskNotifyGiveIndexed( xControlPlaneCtx.xDataPlaneTaskHandle, DATA_WAITING_IDX );
+    vTaskDelay( pdMS_TO_TICKS( TEST_SETTLE_MS ) );
+
+    vSemaphoreDelete( xSlots );
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    uint32_t ulCount = TEST_REQUESTS;
+    TaskHandle_t xModuleTask = NULL;
+    BaseType_t xResult;
+
+    if( argc > 1 )
+    {
+        ulCount = ( uint32_t ) strtoul( argv[ 1 ], NULL, 10 );
+    }
+
+    if( ( ulCount < NUM_IPC_REQUEST_CTX * TEST_DROP_EVERY ) || ( ulCount > TEST_MAX_REQUESTS ) )
+    {
+        ulCount = TEST_REQUESTS;
+    }
+
+    vHostKernelStartRealTime();
+
+    xResult = xTaskCreate( prvModuleTask, "EMW3080", 0, NULL, 0, &xModuleTask );
+    configASSERT( xResult == pdPASS );
+
+    xControlPlaneCtx.xControlPlaneSendQueue = xQueueCreate( CONTROL_PLANE_QUEUE_LEN, sizeof( PacketBuffer_t * ) );
+    xControlPlaneCtx.xControlPlaneResponseBuff = xMessageBufferCreate( CONTROL_PLANE_BUFFER_SZ );
+    xControlPlaneCtx.xDataPlaneTaskHandle = xModuleTask;
+    xControlPlaneCtx.xEventCallback = prvEventCallback;
+    xControlPlaneCtx.pxEventCallbackCtx = NULL;
+    xControlPlaneCtx.pulTxPacketsWaiting = &ulTxPacketsWaiting;
+
+    xResult = xTaskCreate( prvControlPlaneRouter, "MxControlPlane", 0, &xControlPlaneCtx, 0, &xRouterTask );
+    configASSERT( xResult == pdPASS );
+
+    /* Let the router create its contexts and timers */
+    vTaskDelay( pdMS_TO_TICKS( 10 ) );
+
+    prvRunAsync( "async, 1 outstanding", ulCount, 1 );
+    prvRunAsync( "async, all contexts", ulCount, NUM_IPC_REQUEST_CTX );
+    prvRunSync( "sync, task per context", ulCount );
+    prvRunContexts();
+
+    /* Again, after the late responses to the stalled requests */
+    prvRunContexts();
+
+    vTaskDelay( pdMS_TO_TICKS( TEST_SETTLE_MS ) );
+
+    printf( "module: %lu requests, %lu lost, %lu response overflows, %lu TX count underflows\n",
+            ( unsigned long ) xModule.ulRequests, ( unsigned long ) xModule.ulDropped,
+            ( unsigned long ) xModule.ulOverflows, ( unsigned long ) xModule.ulUnderflows );
+
+    prvCheck( xModule.ulUnderflows == 0, "the TX packet count never goes below zero" );
+    prvCheck( ulTxPacketsWaiting == 0, "every TX packet is accounted for" );
+    prvCheck( xModule.ulOverflows == 0, "the response buffer never overflows" );
+    prvCheck( ulLiveAllocations == 0, "no pbuf is leaked" );
+
+    printf( "%s (%lu failures)\n", ( ulFailures == 0 ) ? "PASS" : "FAIL", ( unsigned long ) ulFailures );
+
+    return ( ulFailures == 0 ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,138 @@
+#!python
+#  FreeRTOS STM32 Reference Integration
+#
+#  Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+#
+#  Permission is hereby granted, free of charge, to any person obtaining a copy of
+#  this software and associated documentation files (the "Software"), to deal in
+#  the Software without restriction, including without limitation the rights to
+#  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+#  the Software, and to permit persons to whom the Software is furnished to do so,
+#  subject to the following conditions:
+#
+#  The above copyright notice and this permission notice shall be included in all
+#  copies or substantial portions of the Software.
+#
+#  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+#  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+#  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+#  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+#  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+#  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#
+#  https://www.FreeRTOS.org
+#  https://github.com/FreeRTOS
+
+"""Load a recorded sensor trace onto the target and replay it.
+
+Each CSV row is sent with the "replay csv" CLI command. A first line that is
+not numeric is treated as a header and skipped. Env rows have four columns
+(temp_0, rh, temp_1, baro) and motion rows nine (acc xyz in mG, gyro xyz in
+mDPS, mag xyz in mGauss). Once the rows are loaded the source is started in
+trace mode and, with --duration, the "replay stats" output is polled until the
+run ends and the source is stopped again.
+"""
+
+import csv
+import sys
+import time
+from argparse import ArgumentParser
+
+import serial
+
+MAX_ROWS = 256
+PROMPT = b"> "
+
+
+def read_rows(path):
+    rows = []
+    with open(path, newline="") as csv_file:
+        for row in csv.reader(csv_file):
+            values = [cell.strip() for cell in row if cell.strip()]
+            if not values:
+                continue
+            try:
+                [float(value) for value in values]
+            except ValueError:
+                if not rows:
+                    continue
+                raise
+            rows.append(values)
+    return rows
+
+
+class Console:
+    """Line oriented access to the target CLI."""
+
+    def __init__(self, port, baud):
+        self.ser = serial.Serial(port, baud, timeout=0.1)
+        self.ser.reset_input_buffer()
+        # Control+C clears any partially typed command
+        self.command(b"\x03", echo=False)
+
+    def command(self, cmd, timeout=2.0, echo=True):
+        if echo:
+            print("> {}".format(cmd), file=sys.stderr)
+            cmd = cmd.encode("ascii") + b"\r\n"
+        self.ser.write(cmd)
+        lines = []
+        deadline = time.monotonic() + timeout
+        while time.monotonic() < deadline:
+            line = self.ser.readline()
+            if not line:
+                continue
+            if line.startswith(PROMPT):
+                break
+            lines.append(line.decode("utf-8", errors="replace").rstrip("\r\n"))
+        return lines[1:] if echo else lines
+
+
+def main():
+    argparser = ArgumentParser(description=__doc__.splitlines()[0])
+    argparser.add_argument("csv_file", help="Trace rows, one sample per line.")
+    argparser.add_argument("--port", "-p", required=True, help="Target serial port.")
+    argparser.add_argument(
+        "--baud", "-b", help="Serial port baud rate.", type=int, default=115200
+    )
+    argparser.add_argument(
+        "--source", "-s", choices=("env", "motion"), default="env",
+        help="Publisher to feed.",
+    )
+    argparser.add_argument(
+        "--rate", "-r", type=int, default=10, help="Replay rate in samples per second."
+    )
+    argparser.add_argument(
+        "--duration", "-d", type=float,
+        help="Run for this many seconds, printing stats, then stop.",
+    )
+    args = argparser.parse_args()
+
+    rows = read_rows(args.csv_file)
+    if len(rows) > MAX_ROWS:
+        print("Only the first {} of {} rows fit on the target".format(MAX_ROWS, len(rows)), file=sys.stderr)
+        rows = rows[:MAX_ROWS]
+
+    console = Console(args.port, args.baud)
+    console.command("replay stop {}".format(args.source))
+    console.command("replay clear {}".format(args.source))
+
+    for index, row in enumerate(rows):
+        response = console.command("replay csv {} {}".format(args.source, ",".join(row)))
+        if "ok" not in response:
+            sys.exit("Row {} rejected: {}".format(index + 1, " ".join(response)))
+
+    for line in console.command("replay start {} {} trace".format(args.source, args.rate)):
+        print(line)
+
+    if args.duration:
+        deadline = time.monotonic() + args.duration
+        while time.monotonic() < deadline:
+            time.sleep(min(5.0, max(0.0, deadline - time.monotonic())))
+            for line in console.command("replay stats"):
+                print(line)
+        for line in console.command("replay stop {}".format(args.source)):
+            print(line)
+
+
+if __name__ == "__main__":
+    main()
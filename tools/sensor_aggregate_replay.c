@@ -0,0 +1,396 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+/*
+ * Host replay check of the sensor aggregation engine in
+ * Common/app/sensor_aggregate.c.
+ *
+ * Replays samples through windows of the given length and compares the
+ * statistics of every window and axis with reference values computed in
+ * double precision with a two pass algorithm. Min and max must match
+ * exactly, mean, RMS and variance to within float rounding. Fixed cases with
+ * known results cover an empty window, a single sample, a constant signal, a
+ * large offset with small noise and a full window at the documented
+ * magnitude limit of 2^21.
+ *
+ * Without a trace, a synthetic 9 axis IMU signal is used: accelerometer in
+ * mg with gravity on z, gyroscope in mdps and magnetometer in mgauss. A trace
+ * is CSV with one sample per line and one integer column per axis.
+ *
+ * Exits with a failure status if any check fails.
+ *
+ * Build and run from the repository root:
+ *   cc -O2 -ICommon/include tools/sensor_aggregate_replay.c Common/app/sensor_aggregate.c -lm -o sensor_aggregate_replay
+ *   ./sensor_aggregate_replay [-w window] [-n samples] [trace.csv]
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "sensor_aggregate.h"
+
+#define REPLAY_MAX_LINE          1024
+#define REPLAY_IMU_AXES          9U
+#define REPLAY_MAGNITUDE_LIMIT   ( 1L << 21 )
+
+/* Relative tolerance of the float results, a few float ulps */
+#define REPLAY_REL_TOLERANCE     ( 1e-6 )
+
+typedef struct
+{
+    int32_t lMin;
+    int32_t lMax;
+    double dMean;
+    double dRms;
+    double dVariance;
+} ReferenceStats_t;
+
+static uint32_t ulFailures = 0;
+static uint32_t ulWindowsChecked = 0;
+static double dMaxRelError = 0.0;
+
+/* Samples of the current window, kept for the reference computation */
+static int32_t plWindow[ SENSOR_AGG_MAX_SAMPLES ][ SENSOR_AGG_MAX_AXES ];
+
+/*-----------------------------------------------------------*/
+
+static void prvCheck( bool xCondition,
+                      const char * pcWhat )
+{
+    if( !xCondition )
+    {
+        printf( "FAIL: %s\n", pcWhat );
+        ulFailures++;
+    }
+}
+
+static bool prvClose( double dActual,
+                      double dExpected,
+                      double dScale )
+{
+    double dError = fabs( dActual - dExpected ) / ( ( dScale > 1.0 ) ? dScale : 1.0 );
+
+    if( dError > dMaxRelError )
+    {
+        dMaxRelError = dError;
+    }
+
+    return dError <= REPLAY_REL_TOLERANCE;
+}
+
+static void prvReference( uint32_t ulCount,
+                          uint32_t ulAxis,
+                          ReferenceStats_t * pxRef )
+{
+    double dSum = 0.0;
+    double dSumSq = 0.0;
+    double dSpread = 0.0;
+
+    pxRef->lMin = INT32_MAX;
+    pxRef->lMax = INT32_MIN;
+
+    for( uint32_t i = 0; i < ulCount; i++ )
+    {
+        int32_t lValue = plWindow[ i ][ ulAxis ];
+
+        pxRef->lMin = ( lValue < pxRef->lMin ) ? lValue : pxRef->lMin;
+        pxRef->lMax = ( lValue > pxRef->lMax ) ? lValue : pxRef->lMax;
+        dSum += ( double ) lValue;
+        dSumSq += ( double ) lValue * ( double ) lValue;
+    }
+
+    pxRef->dMean = dSum / ( double ) ulCount;
+    pxRef->dRms = sqrt( dSumSq / ( double ) ulCount );
+
+    /* Second pass around the mean, as a check independent of the engine's formula */
+    for( uint32_t i = 0; i < ulCount; i++ )
+    {
+        double dDiff = ( double ) plWindow[ i ][ ulAxis ] - pxRef->dMean;
+
+        dSpread += dDiff * dDiff;
+    }
+
+    pxRef->dVariance = dSpread / ( double ) ulCount;
+}
+
+static void prvCheckWindow( const SensorAggWindow_t * pxWindow )
+{
+    bool xMatch = true;
+
+    for( uint32_t ulAxis = 0; ulAxis < pxWindow->ulNumAxes; ulAxis++ )
+    {
+        SensorAggStats_t xStats;
+        ReferenceStats_t xRef;
+
+        vSensorAggGetStats( pxWindow, ulAxis, &xStats );
+        prvReference( pxWindow->ulCount, ulAxis, &xRef );
+
+        /* Errors are relative to the magnitude of the samples */
+        xMatch = xMatch &&
+                 ( xStats.lMin == xRef.lMin ) && ( xStats.lMax == xRef.lMax ) &&
+                 prvClose( xStats.fMean, xRef.dMean, xRef.dRms ) &&
+                 prvClose( xStats.fRms, xRef.dRms, xRef.dRms ) &&
+                 prvClose( xStats.fVariance, xRef.dVariance, xRef.dRms * xRef.dRms );
+    }
+
+    ulWindowsChecked++;
+    prvCheck( xMatch, "replay: window statistics match the reference" );
+}
+
+/*-----------------------------------------------------------*/
+
+static int32_t prvNoise( int32_t lAmplitude )
+{
+    return ( int32_t ) ( rand() % ( 2 * lAmplitude + 1 ) ) - lAmplitude;
+}
+
+/* Synthetic 9 axis IMU sample at ulIndex, sampled at 100 Hz */
+static void prvImuSample( uint32_t ulIndex,
+                          int32_t * plValues )
+{
+    double dT = ( double ) ulIndex / 100.0;
+
+    plValues[ 0 ] = ( int32_t ) lround( 150.0 * sin( 2.0 * M_PI * 1.3 * dT ) ) + prvNoise( 8 );
+    plValues[ 1 ] = ( int32_t ) lround( 80.0 * cos( 2.0 * M_PI * 0.7 * dT ) ) + prvNoise( 8 );
+    plValues[ 2 ] = 1000 + prvNoise( 12 );
+    plValues[ 3 ] = ( int32_t ) lround( 25000.0 * sin( 2.0 * M_PI * 0.2 * dT ) ) + prvNoise( 350 );
+    plValues[ 4 ] = prvNoise( 350 );
+    plValues[ 5 ] = -420 + prvNoise( 350 );
+    plValues[ 6 ] = 230 + prvNoise( 3 );
+    plValues[ 7 ] = -85 + prvNoise( 3 );
+    plValues[ 8 ] = 410 + prvNoise( 3 );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvCheckFixedCases( void )
+{
+    SensorAggWindow_t xWindow;
+    SensorAggStats_t xStats;
+    int32_t plValues[ SENSOR_AGG_MAX_AXES ] = { 0 };
+
+    /* Empty window and out of range axis */
+    vSensorAggInit( &xWindow, 3 );
+    vSensorAggGetStats( &xWindow, 0, &xStats );
+    prvCheck( ( xStats.lMin == 0 ) && ( xStats.lMax == 0 ) && ( xStats.fMean == 0.0f ) &&
+              ( xStats.fRms == 0.0f ) && ( xStats.fVariance == 0.0f ), "fixed: empty window is zeroed" );
+
+    /* Single sample */
+    plValues[ 0 ] = -7;
+    plValues[ 1 ] = 0;
+    plValues[ 2 ] = 12345;
+    vSensorAggAddSample( &xWindow, plValues );
+    vSensorAggGetStats( &xWindow, 0, &xStats );
+    prvCheck( ( xStats.lMin == -7 ) && ( xStats.lMax == -7 ) && ( xStats.fMean == -7.0f ) &&
+              ( xStats.fRms == 7.0f ) && ( xStats.fVariance == 0.0f ), "fixed: single sample" );
+    vSensorAggGetStats( &xWindow, 3, &xStats );
+    prvCheck( ( xStats.lMin == 0 ) && ( xStats.lMax == 0 ) && ( xStats.fMean == 0.0f ), "fixed: axis out of range is zeroed" );
+
+    /* Constant signal has no variance */
+    vSensorAggReset( &xWindow );
+
+    for( uint32_t i = 0; i < SENSOR_AGG_MAX_SAMPLES; i++ )
+    {
+        plValues[ 0 ] = -123456;
+        vSensorAggAddSample( &xWindow, plValues );
+    }
+
+    vSensorAggGetStats( &xWindow, 0, &xStats );
+    prvCheck( ( xStats.fMean == -123456.0f ) && ( xStats.fVariance == 0.0f ), "fixed: constant signal" );
+
+    /* Small noise on a large offset, where E[x^2] - E[x]^2 in float would cancel */
+    vSensorAggReset( &xWindow );
+
+    for( uint32_t i = 0; i < SENSOR_AGG_MAX_SAMPLES; i++ )
+    {
+        plValues[ 0 ] = ( int32_t ) ( REPLAY_MAGNITUDE_LIMIT - 2 ) + ( ( ( i & 1U ) != 0 ) ? 1 : -1 );
+        vSensorAggAddSample( &xWindow, plValues );
+    }
+
+    vSensorAggGetStats( &xWindow, 0, &xStats );
+    prvCheck( xStats.fVariance == 1.0f, "fixed: unit variance on a large offset" );
+
+    /* Full window at the magnitude limit, the sums must not overflow */
+    vSensorAggReset( &xWindow );
+
+    for( uint32_t i = 0; i < SENSOR_AGG_MAX_SAMPLES; i++ )
+    {
+        plValues[ 0 ] = ( ( i & 1U ) != 0 ) ? ( int32_t ) REPLAY_MAGNITUDE_LIMIT : ( int32_t ) -REPLAY_MAGNITUDE_LIMIT;
+        plValues[ 1 ] = ( int32_t ) -REPLAY_MAGNITUDE_LIMIT;
+        vSensorAggAddSample( &xWindow, plValues );
+    }
+
+    vSensorAggGetStats( &xWindow, 0, &xStats );
+    prvCheck( ( xStats.fMean == 0.0f ) &&
+              ( xStats.fRms == ( float ) REPLAY_MAGNITUDE_LIMIT ) &&
+              ( xStats.fVariance == ( float ) REPLAY_MAGNITUDE_LIMIT * ( float ) REPLAY_MAGNITUDE_LIMIT ), "fixed: full window at the magnitude limit" );
+    vSensorAggGetStats( &xWindow, 1, &xStats );
+    prvCheck( ( xStats.fMean == ( float ) -REPLAY_MAGNITUDE_LIMIT ) && ( xStats.fVariance == 0.0f ), "fixed: negative limit" );
+
+    /* Axis count is clamped */
+    vSensorAggInit( &xWindow, SENSOR_AGG_MAX_AXES + 4 );
+    prvCheck( xWindow.ulNumAxes == SENSOR_AGG_MAX_AXES, "fixed: axis count clamped" );
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvReadSample( FILE * pxFile,
+                               int32_t * plValues )
+{
+    char pcLine[ REPLAY_MAX_LINE ];
+    uint32_t ulCount = 0;
+
+    while( ( ulCount == 0 ) && ( fgets( pcLine, sizeof( pcLine ), pxFile ) != NULL ) )
+    {
+        char * pcToken = strtok( pcLine, ",; \t\r\n" );
+
+        if( pcLine[ 0 ] == '#' )
+        {
+            continue;
+        }
+
+        while( ( pcToken != NULL ) && ( ulCount < SENSOR_AGG_MAX_AXES ) )
+        {
+            plValues[ ulCount++ ] = ( int32_t ) strtol( pcToken, NULL, 10 );
+            pcToken = strtok( NULL, ",; \t\r\n" );
+        }
+    }
+
+    return ulCount;
+}
+
+int main( int argc,
+          char ** argv )
+{
+    static SensorAggWindow_t xWindow;
+    uint32_t ulWindowLen = 100;
+    uint32_t ulMaxSamples = 100000;
+    uint32_t ulNumAxes = 0;
+    uint32_t ulSamples = 0;
+    const char * pcPath = NULL;
+    FILE * pxFile = NULL;
+    double dSeconds = 0.0;
+
+    for( int i = 1; i < argc; i++ )
+    {
+        if( ( strcmp( argv[ i ], "-w" ) == 0 ) && ( i + 1 < argc ) )
+        {
+            ulWindowLen = ( uint32_t ) strtoul( argv[ ++i ], NULL, 10 );
+        }
+        else if( ( strcmp( argv[ i ], "-n" ) == 0 ) && ( i + 1 < argc ) )
+        {
+            ulMaxSamples = ( uint32_t ) strtoul( argv[ ++i ], NULL, 10 );
+        }
+        else
+        {
+            pcPath = argv[ i ];
+        }
+    }
+
+    if( ( ulWindowLen == 0 ) || ( ulWindowLen > SENSOR_AGG_MAX_SAMPLES ) )
+    {
+        fprintf( stderr, "Window length must be 1 to %u\n", SENSOR_AGG_MAX_SAMPLES );
+        return EXIT_FAILURE;
+    }
+
+    if( ( pcPath != NULL ) && ( ( pxFile = fopen( pcPath, "r" ) ) == NULL ) )
+    {
+        perror( pcPath );
+        return EXIT_FAILURE;
+    }
+
+    prvCheckFixedCases();
+
+    srand( 3 );
+
+    while( ulSamples < ulMaxSamples )
+    {
+        int32_t plValues[ SENSOR_AGG_MAX_AXES ];
+        uint32_t ulCount = REPLAY_IMU_AXES;
+        struct timespec xStart, xEnd;
+
+        if( pxFile != NULL )
+        {
+            ulCount = prvReadSample( pxFile, plValues );
+
+            if( ulCount == 0 )
+            {
+                break;
+            }
+        }
+        else
+        {
+            prvImuSample( ulSamples, plValues );
+        }
+
+        if( ulNumAxes == 0 )
+        {
+            ulNumAxes = ulCount;
+            vSensorAggInit( &xWindow, ulNumAxes );
+        }
+        else if( ulCount != ulNumAxes )
+        {
+            fprintf( stderr, "Skipping sample with %lu axes\n", ( unsigned long ) ulCount );
+            continue;
+        }
+
+        ( void ) memcpy( plWindow[ xWindow.ulCount ], plValues, sizeof( int32_t ) * ulNumAxes );
+
+        ( void ) clock_gettime( CLOCK_MONOTONIC, &xStart );
+        vSensorAggAddSample( &xWindow, plValues );
+        ( void ) clock_gettime( CLOCK_MONOTONIC, &xEnd );
+
+        dSeconds += ( double ) ( xEnd.tv_sec - xStart.tv_sec ) + ( double ) ( xEnd.tv_nsec - xStart.tv_nsec ) * 1e-9;
+        ulSamples++;
+
+        if( xWindow.ulCount == ulWindowLen )
+        {
+            prvCheckWindow( &xWindow );
+            vSensorAggReset( &xWindow );
+        }
+    }
+
+    if( xWindow.ulCount > 0 )
+    {
+        prvCheckWindow( &xWindow );
+    }
+
+    if( pxFile != NULL )
+    {
+        fclose( pxFile );
+    }
+
+    printf( "samples            %lu of %lu axes from %s\n", ( unsigned long ) ulSamples,
+            ( unsigned long ) ulNumAxes, ( pcPath != NULL ) ? pcPath : "synthetic IMU signal" );
+    printf( "windows checked    %lu of %lu samples\n", ( unsigned long ) ulWindowsChecked, ( unsigned long ) ulWindowLen );
+    printf( "max rel error      %.3g (tolerance %.3g)\n", dMaxRelError, REPLAY_REL_TOLERANCE );
+    printf( "cpu per sample     %.1f ns\n", ( ulSamples > 0 ) ? ( dSeconds * 1e9 / ( double ) ulSamples ) : 0.0 );
+    printf( "%s (%lu failures)\n", ( ulFailures == 0 ) ? "PASS" : "FAIL", ( unsigned long ) ulFailures );
+
+    return ( ulFailures == 0 ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
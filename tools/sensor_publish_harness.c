@@ -0,0 +1,655 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+/*
+ * Host load harness for the sensor publishing tasks.
+ *
+ * Runs vEnvironmentSensorPublishTask and vMotionSensorsPublish unmodified,
+ * in real time on the host kernel shim, with the sensors replaced by the
+ * replay driver in Common/app/sensor_replay.c: every sample comes from a
+ * recorded CSV trace or from the synthetic generator, at 1 Hz to 1 kHz per
+ * source. Traces use the format of tools/replay_push.py, one row per sample
+ * (env: temp_0, rh, temp_1, baro; motion: acc xyz mG, gyro xyz mDPS, mag xyz
+ * mGauss) with an optional header line.
+ *
+ * The MQTT agent is modelled by a task draining a command queue of the
+ * firmware's length (MQTT_AGENT_COMMAND_QUEUE_LENGTH) and spending a fixed
+ * time sending each publish before it completes the command, so that a slow
+ * link backs the publishing tasks up as it does on the board.
+ *
+ * At the end of the run it reports, per source, the samples due, consumed
+ * and dropped, the publishes, failures, payload bytes and end-to-end publish
+ * rate, then the deepest agent queue, the publish latency from
+ * MQTTAgent_Publish to its completion and the heap in use and at its peak.
+ * Both tasks wait for each publish to complete, so the agent queue holds at
+ * most one command per task and a slow link shows up as dropped samples and
+ * latency rather than as queue depth.
+ *
+ * Options:
+ *   -e <Hz>      env sample rate, 0 to leave the env task out (default 1)
+ *   -m <Hz>      motion sample rate, 0 to leave the motion task out (default 104)
+ *   -E <csv>     replay an env trace instead of synthetic samples
+ *   -M <csv>     replay a motion trace instead of synthetic samples
+ *   -c           CBOR payloads instead of JSON
+ *   -r           raw motion samples instead of window summaries
+ *   -w <ms>      motion window (default 1000)
+ *   -s <us>      time the agent takes to send one publish (default 2000)
+ *   -t <s>       length of the run (default 10)
+ *
+ * Host threads are preemptive peers of equal priority, so the tasks do not
+ * run in the order their priorities would impose on the board, and task
+ * stacks are not measured.
+ *
+ * Build and run from the repository root, with the tinycbor submodule:
+ *   cc -O2 -Itools/host -ICommon/include -ICommon/cli -ICommon/app/mqtt -ICommon/config -ICommon/kvstore \
+ *      -IMiddleware/tinycbor/src tools/sensor_publish_harness.c Common/app/env_sensor_publish.c \
+ *      Common/app/motion_sensors_publish.c Common/app/sensor_replay.c Common/app/sensor_aggregate.c \
+ *      Common/app/telemetry_cbor.c Common/app/telemetry_delta.c Common/sys/latency_hist.c \
+ *      Middleware/tinycbor/src/cborencoder.c Middleware/tinycbor/src/cborencoder_close_container_checked.c \
+ *      tools/host/host_kernel.c -lpthread -lm -o sensor_publish_harness
+ *   ./sensor_publish_harness -e 1000 -m 1000 -c -t 10
+ */
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
+#include "kvstore.h"
+#include "core_mqtt_agent.h"
+#include "core_mqtt_config.h"
+#include "mqtt_agent_task.h"
+#include "sys_evt.h"
+#include "sensor_sched.h"
+#include "sensor_replay.h"
+#include "telemetry_cbor.h"
+#include "latency_hist.h"
+
+#define HARNESS_THING_NAME    "host-harness"
+#define HARNESS_MAX_LINE      512
+
+typedef struct
+{
+    MQTTAgentCommandCallback_t pxCallback;
+    MQTTAgentCommandContext_t * pxContext;
+    size_t xPayloadLen;
+} HarnessCommand_t;
+
+struct MQTTAgentContext
+{
+    QueueHandle_t xQueue;
+    uint32_t ulSendUs;
+    UBaseType_t uxMaxDepth;
+    uint32_t ulPublishes;
+    uint32_t ulRejected;
+    uint64_t ullBytes;
+};
+
+void vEnvironmentSensorPublishTask( void * pvParameters );
+void vMotionSensorsPublish( void * pvParameters );
+
+EventGroupHandle_t xSystemEvents = NULL;
+
+static struct MQTTAgentContext xAgent;
+static LatencyHist_t xLatency;
+
+static TelemetryFormat_t xFormat = TELEMETRY_FORMAT_JSON;
+static uint32_t ulMotionPubMode = 0;
+static uint32_t ulMotionWindowMs = MOTION_WINDOW_MS_DFLT;
+
+static pthread_mutex_t xHeapLock = PTHREAD_MUTEX_INITIALIZER;
+static size_t xHeapUsed = 0;
+static size_t xHeapPeak = 0;
+
+static uint32_t ulFailures = 0;
+
+/*-----------------------------------------------------------*/
+
+static void prvCheck( bool xCondition,
+                      const char * pcName )
+{
+    if( !xCondition )
+    {
+        printf( "FAIL: %s\n", pcName );
+        ulFailures++;
+    }
+}
+
+/* Blocks start with their size, so that the heap in use can be tracked */
+void * pvPortMalloc( size_t xSize )
+{
+    size_t * pxBlock = malloc( sizeof( size_t ) + xSize );
+
+    if( pxBlock != NULL )
+    {
+        *pxBlock = xSize;
+        pxBlock++;
+
+        ( void ) pthread_mutex_lock( &xHeapLock );
+        xHeapUsed += xSize;
+        xHeapPeak = ( xHeapUsed > xHeapPeak ) ? xHeapUsed : xHeapPeak;
+        ( void ) pthread_mutex_unlock( &xHeapLock );
+    }
+
+    return pxBlock;
+}
+
+void vPortFree( void * pv )
+{
+    if( pv != NULL )
+    {
+        size_t * pxBlock = ( ( size_t * ) pv ) - 1;
+
+        ( void ) pthread_mutex_lock( &xHeapLock );
+        xHeapUsed -= *pxBlock;
+        ( void ) pthread_mutex_unlock( &xHeapLock );
+
+        free( pxBlock );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/* Configuration read by the publishing tasks, the rest keeps its default */
+
+size_t KVStore_getString( KVStoreKey_t key,
+                          char * pvBuffer,
+                          size_t xMaxLength )
+{
+    size_t xLength = 0;
+
+    if( ( key == CS_CORE_THING_NAME ) && ( xMaxLength > sizeof( HARNESS_THING_NAME ) ) )
+    {
+        ( void ) strcpy( pvBuffer, HARNESS_THING_NAME );
+        xLength = strlen( HARNESS_THING_NAME );
+    }
+
+    return xLength;
+}
+
+char * KVStore_getStringHeap( KVStoreKey_t key,
+                              size_t * pxLength )
+{
+    char * pcValue = pvPortMalloc( sizeof( HARNESS_THING_NAME ) );
+
+    if( pcValue != NULL )
+    {
+        size_t xLength = KVStore_getString( key, pcValue, sizeof( HARNESS_THING_NAME ) + 1 );
+
+        if( pxLength != NULL )
+        {
+            *pxLength = xLength;
+        }
+    }
+
+    return pcValue;
+}
+
+uint32_t KVStore_getUInt32( KVStoreKey_t key,
+                            BaseType_t * pxSuccess )
+{
+    uint32_t ulValue = 0;
+
+    switch( key )
+    {
+        case CS_ENV_PUB_FORMAT:
+        case CS_MOTION_PUB_FORMAT:
+            ulValue = ( uint32_t ) xFormat;
+            break;
+
+        case CS_MOTION_PUB_MODE:
+            ulValue = ulMotionPubMode;
+            break;
+
+        case CS_MOTION_WINDOW_MS:
+            ulValue = ulMotionWindowMs;
+            break;
+
+        case CS_ENV_DEADBAND_TEMP:
+            ulValue = ENV_DEADBAND_TEMP_DFLT;
+            break;
+
+        case CS_ENV_DEADBAND_RH:
+            ulValue = ENV_DEADBAND_RH_DFLT;
+            break;
+
+        case CS_ENV_DEADBAND_BARO:
+            ulValue = ENV_DEADBAND_BARO_DFLT;
+            break;
+
+        case CS_ENV_KEYFRAME_S:
+            ulValue = ENV_KEYFRAME_S_DFLT;
+            break;
+
+        default:
+            break;
+    }
+
+    if( pxSuccess != NULL )
+    {
+        *pxSuccess = pdTRUE;
+    }
+
+    return ulValue;
+}
+
+/*-----------------------------------------------------------*/
+
+/* The sensors never deliver: while a replay source runs, the publishing tasks
+ * take every sample from it and only flush their ring */
+
+SensorRing_t * pxSensorRingCreate( uint32_t ulLength )
+{
+    SensorRing_t * pxRing = pvPortMalloc( sizeof( SensorRing_t ) + ( ulLength * sizeof( SensorSample_t ) ) );
+
+    if( pxRing != NULL )
+    {
+        ( void ) memset( pxRing, 0, sizeof( SensorRing_t ) );
+        pxRing->ulMask = ulLength - 1;
+        pxRing->pxSamples = ( SensorSample_t * ) &( pxRing[ 1 ] );
+    }
+
+    return pxRing;
+}
+
+BaseType_t xSensorSchedEnable( SensorId_t xSensor,
+                               float fRateHz,
+                               SensorRing_t * pxRing )
+{
+    ( void ) xSensor;
+    ( void ) fRateHz;
+    ( void ) pxRing;
+
+    return pdTRUE;
+}
+
+BaseType_t xSensorRingWait( TickType_t xTimeout )
+{
+    vTaskDelay( xTimeout );
+
+    return pdFALSE;
+}
+
+BaseType_t xSensorRingPop( SensorRing_t * pxRing,
+                           SensorSample_t * pxSample )
+{
+    ( void ) pxRing;
+    ( void ) pxSample;
+
+    return pdFALSE;
+}
+
+void vSensorRingFlush( SensorRing_t * pxRing )
+{
+    ( void ) pxRing;
+}
+
+/*-----------------------------------------------------------*/
+
+/* MQTT agent model: a bounded command queue drained by one task */
+
+MQTTAgentHandle_t xGetMqttAgentHandle( void )
+{
+    return &xAgent;
+}
+
+bool xIsMqttAgentConnected( void )
+{
+    return true;
+}
+
+UBaseType_t uxGetMqttAgentQueueDepth( void )
+{
+    return uxQueueMessagesWaiting( xAgent.xQueue );
+}
+
+void vMqttAgentRecordPublishLatency( uint32_t ulLatencyMs )
+{
+    taskENTER_CRITICAL();
+    {
+        vLatencyHistRecord( &xLatency, ulLatencyMs );
+    }
+    taskEXIT_CRITICAL();
+}
+
+MQTTStatus_t MQTTAgent_Publish( const MQTTAgentContext_t * pMqttAgentContext,
+                                MQTTPublishInfo_t * pPublishInfo,
+                                const MQTTAgentCommandInfo_t * pCommandInfo )
+{
+    struct MQTTAgentContext * pxAgent = ( struct MQTTAgentContext * ) pMqttAgentContext;
+    HarnessCommand_t xCommand =
+    {
+        .pxCallback  = pCommandInfo->cmdCompleteCallback,
+        .pxContext   = pCommandInfo->pCmdCompleteCallbackContext,
+        .xPayloadLen = pPublishInfo->payloadLength,
+    };
+    MQTTStatus_t xStatus = MQTTSuccess;
+
+    if( xQueueSend( pxAgent->xQueue, &xCommand, pdMS_TO_TICKS( pCommandInfo->blockTimeMs ) ) != pdPASS )
+    {
+        taskENTER_CRITICAL();
+        {
+            pxAgent->ulRejected++;
+        }
+        taskEXIT_CRITICAL();
+
+        xStatus = MQTTSendFailed;
+    }
+    else
+    {
+        UBaseType_t uxDepth = uxQueueMessagesWaiting( pxAgent->xQueue );
+
+        taskENTER_CRITICAL();
+        {
+            pxAgent->uxMaxDepth = ( uxDepth > pxAgent->uxMaxDepth ) ? uxDepth : pxAgent->uxMaxDepth;
+        }
+        taskEXIT_CRITICAL();
+    }
+
+    return xStatus;
+}
+
+static void prvAgentTask( void * pvParameters )
+{
+    struct MQTTAgentContext * pxAgent = ( struct MQTTAgentContext * ) pvParameters;
+    const struct timespec xSendTime =
+    {
+        .tv_sec  = ( time_t ) ( pxAgent->ulSendUs / 1000000U ),
+        .tv_nsec = ( long ) ( pxAgent->ulSendUs % 1000000U ) * 1000L,
+    };
+
+    for( ; ; )
+    {
+        HarnessCommand_t xCommand;
+
+        if( xQueueReceive( pxAgent->xQueue, &xCommand, portMAX_DELAY ) == pdPASS )
+        {
+            MQTTAgentReturnInfo_t xReturn = { .returnCode = MQTTSuccess, .pSubackCodes = NULL };
+
+            ( void ) nanosleep( &xSendTime, NULL );
+
+            taskENTER_CRITICAL();
+            {
+                pxAgent->ulPublishes++;
+                pxAgent->ullBytes += xCommand.xPayloadLen;
+            }
+            taskEXIT_CRITICAL();
+
+            if( xCommand.pxCallback != NULL )
+            {
+                xCommand.pxCallback( xCommand.pxContext, &xReturn );
+            }
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/* Load a CSV trace, skipping lines that are not all numbers */
+static bool prvLoadTrace( SensorReplaySourceId_t xSource,
+                          uint32_t ulNumChannels,
+                          const char * pcPath )
+{
+    FILE * pxFile = fopen( pcPath, "r" );
+    char pcLine[ HARNESS_MAX_LINE ];
+    uint32_t ulRows = 0;
+    bool xFull = false;
+
+    if( pxFile == NULL )
+    {
+        printf( "cannot open %s\n", pcPath );
+    }
+    else
+    {
+        while( !xFull && ( fgets( pcLine, sizeof( pcLine ), pxFile ) != NULL ) )
+        {
+            float pfRow[ SENSOR_REPLAY_MAX_CHANNELS ];
+            uint32_t ulColumns = 0;
+            char * pcCursor = pcLine;
+            char * pcEnd = NULL;
+
+            while( ulColumns < SENSOR_REPLAY_MAX_CHANNELS )
+            {
+                pfRow[ ulColumns ] = strtof( pcCursor, &pcEnd );
+
+                if( pcEnd == pcCursor )
+                {
+                    break;
+                }
+
+                ulColumns++;
+                pcCursor = pcEnd + strspn( pcEnd, " \t" );
+
+                if( *pcCursor != ',' )
+                {
+                    break;
+                }
+
+                pcCursor++;
+            }
+
+            if( ulColumns == ulNumChannels )
+            {
+                xFull = ( xSensorReplayAddRow( xSource, pfRow, ulColumns ) != pdTRUE );
+                ulRows += xFull ? 0 : 1;
+            }
+        }
+
+        ( void ) fclose( pxFile );
+
+        printf( "trace       %s: %lu rows%s\n", pcPath, ( unsigned long ) ulRows,
+                xFull ? ", truncated to SENSOR_REPLAY_MAX_ROWS" : "" );
+    }
+
+    return ulRows > 0;
+}
+
+static void prvReportSource( const char * pcName,
+                             SensorReplaySourceId_t xSource )
+{
+    SensorReplayStats_t xStats;
+    double dElapsedS;
+
+    vSensorReplayGetStats( xSource, &xStats );
+    dElapsedS = ( xStats.ulElapsedMs > 0 ) ? ( ( double ) xStats.ulElapsedMs / 1000.0 ) : 1.0;
+
+    printf( "%-6s %5lu Hz %-9s due %7lu consumed %7lu dropped %7lu | published %6lu (%7.1f/s) failed %4lu %8lu B, %6.1f B/publish\n",
+            pcName, ( unsigned long ) xStats.ulRateHz, ( xStats.xMode == SENSOR_REPLAY_TRACE ) ? "trace" : "synthetic",
+            ( unsigned long ) xStats.ulSamples, ( unsigned long ) xStats.ulConsumed, ( unsigned long ) xStats.ulDropped,
+            ( unsigned long ) xStats.ulPublished, ( double ) xStats.ulPublished / dElapsedS,
+            ( unsigned long ) xStats.ulFailed, ( unsigned long ) xStats.ulBytes,
+            ( xStats.ulPublished > 0 ) ? ( ( double ) xStats.ulBytes / ( double ) xStats.ulPublished ) : 0.0 );
+    printf( "       deepest agent queue once a publish completed %lu of %u\n",
+            ( unsigned long ) xStats.ulMaxQueueDepth, MQTT_AGENT_COMMAND_QUEUE_LENGTH );
+
+    prvCheck( xStats.ulPublished > 0, pcName );
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    uint32_t ulEnvHz = 1;
+    uint32_t ulMotionHz = 104;
+    const char * pcEnvTrace = NULL;
+    const char * pcMotionTrace = NULL;
+    uint32_t ulRunS = 10;
+    struct timespec xRunTime = { 0 };
+    bool xSetup = true;
+
+    xAgent.ulSendUs = 2000;
+
+    for( int i = 1; i < argc; i++ )
+    {
+        if( ( strcmp( argv[ i ], "-e" ) == 0 ) && ( i + 1 < argc ) )
+        {
+            ulEnvHz = ( uint32_t ) strtoul( argv[ ++i ], NULL, 10 );
+        }
+        else if( ( strcmp( argv[ i ], "-m" ) == 0 ) && ( i + 1 < argc ) )
+        {
+            ulMotionHz = ( uint32_t ) strtoul( argv[ ++i ], NULL, 10 );
+        }
+        else if( ( strcmp( argv[ i ], "-E" ) == 0 ) && ( i + 1 < argc ) )
+        {
+            pcEnvTrace = argv[ ++i ];
+        }
+        else if( ( strcmp( argv[ i ], "-M" ) == 0 ) && ( i + 1 < argc ) )
+        {
+            pcMotionTrace = argv[ ++i ];
+        }
+        else if( strcmp( argv[ i ], "-c" ) == 0 )
+        {
+            xFormat = TELEMETRY_FORMAT_CBOR;
+        }
+        else if( strcmp( argv[ i ], "-r" ) == 0 )
+        {
+            ulMotionPubMode = 1;
+        }
+        else if( ( strcmp( argv[ i ], "-w" ) == 0 ) && ( i + 1 < argc ) )
+        {
+            ulMotionWindowMs = ( uint32_t ) strtoul( argv[ ++i ], NULL, 10 );
+        }
+        else if( ( strcmp( argv[ i ], "-s" ) == 0 ) && ( i + 1 < argc ) )
+        {
+            xAgent.ulSendUs = ( uint32_t ) strtoul( argv[ ++i ], NULL, 10 );
+        }
+        else if( ( strcmp( argv[ i ], "-t" ) == 0 ) && ( i + 1 < argc ) )
+        {
+            ulRunS = ( uint32_t ) strtoul( argv[ ++i ], NULL, 10 );
+        }
+        else
+        {
+            printf( "usage: %s [-e Hz] [-m Hz] [-E env.csv] [-M motion.csv] [-c] [-r] [-w ms] [-s us] [-t s]\n", argv[ 0 ] );
+            xSetup = false;
+        }
+    }
+
+    if( ( pcEnvTrace != NULL ) && xSetup )
+    {
+        xSetup = prvLoadTrace( SENSOR_REPLAY_ENV, 4, pcEnvTrace );
+    }
+
+    if( ( pcMotionTrace != NULL ) && xSetup )
+    {
+        xSetup = prvLoadTrace( SENSOR_REPLAY_MOTION, 9, pcMotionTrace );
+    }
+
+    xSystemEvents = xEventGroupCreate();
+    xAgent.xQueue = xQueueCreate( MQTT_AGENT_COMMAND_QUEUE_LENGTH, sizeof( HarnessCommand_t ) );
+    xSetup = xSetup && ( xSystemEvents != NULL ) && ( xAgent.xQueue != NULL );
+
+    if( xSetup )
+    {
+        ( void ) xEventGroupSetBits( xSystemEvents, EVT_MASK_MQTT_CONNECTED );
+        vHostKernelStartRealTime();
+
+        /* Sources run before the tasks start, so they never wait on the sensors */
+        if( ulEnvHz > 0 )
+        {
+            xSetup &= ( xSensorReplayStart( SENSOR_REPLAY_ENV, ulEnvHz,
+                                            ( pcEnvTrace != NULL ) ? SENSOR_REPLAY_TRACE : SENSOR_REPLAY_SYNTHETIC ) == pdTRUE );
+        }
+
+        if( ulMotionHz > 0 )
+        {
+            xSetup &= ( xSensorReplayStart( SENSOR_REPLAY_MOTION, ulMotionHz,
+                                            ( pcMotionTrace != NULL ) ? SENSOR_REPLAY_TRACE : SENSOR_REPLAY_SYNTHETIC ) == pdTRUE );
+        }
+
+        if( !xSetup )
+        {
+            printf( "rates must be between %u and %u Hz\n", SENSOR_REPLAY_MIN_RATE_HZ, SENSOR_REPLAY_MAX_RATE_HZ );
+        }
+    }
+
+    if( xSetup )
+    {
+        ( void ) xTaskCreate( prvAgentTask, "MQTTAgent", 0, &xAgent, 0, NULL );
+
+        if( ulEnvHz > 0 )
+        {
+            ( void ) xTaskCreate( vEnvironmentSensorPublishTask, "EnvSense", 0, NULL, 0, NULL );
+        }
+
+        if( ulMotionHz > 0 )
+        {
+            ( void ) xTaskCreate( vMotionSensorsPublish, "MotionS", 0, NULL, 0, NULL );
+        }
+
+        printf( "run         %lu s, %s payloads, motion %s over %lu ms, %lu us per publish\n",
+                ( unsigned long ) ulRunS, ( xFormat == TELEMETRY_FORMAT_CBOR ) ? "CBOR" : "JSON",
+                ( ulMotionPubMode == 1 ) ? "raw samples" : "summaries", ( unsigned long ) ulMotionWindowMs,
+                ( unsigned long ) xAgent.ulSendUs );
+
+        xRunTime.tv_sec = ( time_t ) ulRunS;
+
+        while( nanosleep( &xRunTime, &xRunTime ) != 0 )
+        {
+        }
+
+        if( ulEnvHz > 0 )
+        {
+            prvReportSource( "env", SENSOR_REPLAY_ENV );
+        }
+
+        if( ulMotionHz > 0 )
+        {
+            prvReportSource( "motion", SENSOR_REPLAY_MOTION );
+        }
+
+        taskENTER_CRITICAL();
+        {
+            printf( "agent       %lu publishes, %llu B, %lu rejected by a full queue, deepest queue %lu of %u\n",
+                    ( unsigned long ) xAgent.ulPublishes, ( unsigned long long ) xAgent.ullBytes,
+                    ( unsigned long ) xAgent.ulRejected, ( unsigned long ) xAgent.uxMaxDepth,
+                    MQTT_AGENT_COMMAND_QUEUE_LENGTH );
+            printf( "latency     publish to completion: mean %.1f ms, p50 %lu ms, p99 %lu ms, max %lu ms\n",
+                    ( xLatency.ulCount > 0 ) ? ( ( double ) xLatency.ullTotalMs / ( double ) xLatency.ulCount ) : 0.0,
+                    ( unsigned long ) ulLatencyHistPercentile( &xLatency, 50 ),
+                    ( unsigned long ) ulLatencyHistPercentile( &xLatency, 99 ),
+                    ( unsigned long ) xLatency.ulMaxMs );
+        }
+        taskEXIT_CRITICAL();
+
+        ( void ) pthread_mutex_lock( &xHeapLock );
+        printf( "heap        %lu B in use, peak %lu B\n", ( unsigned long ) xHeapUsed, ( unsigned long ) xHeapPeak );
+        ( void ) pthread_mutex_unlock( &xHeapLock );
+    }
+    else
+    {
+        ulFailures++;
+    }
+
+    printf( "%s (%lu failures)\n", ( ulFailures == 0 ) ? "PASS" : "FAIL", ( unsigned long ) ulFailures );
+
+    /* The tasks never return, the process ends with them */
+    return ( ulFailures == 0 ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,397 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+/*
+ * Host test of the sensor replay load generator in Common/app/sensor_replay.c.
+ *
+ * Checks:
+ * 1. Synthetic: due samples are read in order, the excess is counted as
+ *    dropped, and values are reproducible whatever the batch sizes.
+ * 2. Trace: pushed rows are replayed in a loop, rows cannot be pushed or
+ *    cleared while the source runs, and publish statistics are recorded.
+ * 3. Stop: a stopped source returns no samples and drops none.
+ * 4. Race: a reader thread reads the motion source while the main thread
+ *    keeps stopping it, clearing and pushing a new trace and restarting it,
+ *    as the publish task and the "replay" CLI command do. Freed traces are
+ *    poisoned with NaN and kept in quarantine, so a sample generated from a
+ *    freed trace or with the rate of a stopped source is caught.
+ *
+ * Exits with a failure status if any check fails.
+ *
+ * Build and run from the repository root:
+ *   cc -O2 -Itools/host -ICommon/include -ICommon/app/mqtt tools/sensor_replay_test.c Common/app/sensor_replay.c \
+ *      tools/host/host_kernel.c -lpthread -lm -o sensor_replay_test
+ *   ./sensor_replay_test [race duration in ms]
+ */
+
+#include <math.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "sensor_replay.h"
+#include "mqtt_agent_task.h"
+
+#define TEST_QUARANTINE_LEN    64U
+#define TEST_READ_BATCH        32U
+#define TEST_ENV_CHANNELS      4U
+#define TEST_MOTION_CHANNELS   9U
+
+/* Largest synthetic deviation from the channel base, amplitude plus noise */
+#define TEST_MAX_DEVIATION     600.0f
+
+static void * pvQuarantine[ TEST_QUARANTINE_LEN ];
+static uint32_t ulQuarantineNext = 0;
+static pthread_mutex_t xHeapLock = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t ulLiveBlocks = 0;
+
+static UBaseType_t uxQueueDepth = 0;
+
+static volatile bool xReaderRun = false;
+static uint32_t ulReaderBadSamples = 0;
+static uint32_t ulReaderSamples = 0;
+
+static uint32_t ulFailures = 0;
+
+/*-----------------------------------------------------------*/
+
+static void prvCheck( bool xCondition,
+                      const char * pcWhat )
+{
+    if( !xCondition )
+    {
+        printf( "FAIL: %s\n", pcWhat );
+        ulFailures++;
+    }
+}
+
+/* Blocks start with their size so that vPortFree can poison them */
+void * pvPortMalloc( size_t xSize )
+{
+    size_t * pxBlock = malloc( sizeof( size_t ) + xSize );
+
+    if( pxBlock != NULL )
+    {
+        *pxBlock = xSize;
+        pxBlock++;
+
+        ( void ) pthread_mutex_lock( &xHeapLock );
+        ulLiveBlocks++;
+        ( void ) pthread_mutex_unlock( &xHeapLock );
+    }
+
+    return pxBlock;
+}
+
+/* Freed blocks are filled with NaN and only released to the C heap once
+ * TEST_QUARANTINE_LEN more blocks have been freed */
+void vPortFree( void * pv )
+{
+    if( pv != NULL )
+    {
+        size_t * pxBlock = ( ( size_t * ) pv ) - 1;
+
+        ( void ) memset( pv, 0xFF, *pxBlock );
+
+        ( void ) pthread_mutex_lock( &xHeapLock );
+        free( pvQuarantine[ ulQuarantineNext ] );
+        pvQuarantine[ ulQuarantineNext ] = pxBlock;
+        ulQuarantineNext = ( ulQuarantineNext + 1U ) % TEST_QUARANTINE_LEN;
+        ulLiveBlocks--;
+        ( void ) pthread_mutex_unlock( &xHeapLock );
+    }
+}
+
+UBaseType_t uxGetMqttAgentQueueDepth( void )
+{
+    return uxQueueDepth;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Trace value of channel ulChannel in row ulRow of trace number ulTrace */
+static float prvTraceValue( uint32_t ulTrace,
+                            uint32_t ulRow,
+                            uint32_t ulChannel )
+{
+    return ( float ) ( ( ulTrace * 10000U ) + ( ulRow * 100U ) + ulChannel );
+}
+
+static void prvPushTrace( SensorReplaySourceId_t xSource,
+                          uint32_t ulTrace,
+                          uint32_t ulRows,
+                          uint32_t ulChannels )
+{
+    float pfRow[ SENSOR_REPLAY_MAX_CHANNELS ];
+
+    for( uint32_t ulRow = 0; ulRow < ulRows; ulRow++ )
+    {
+        for( uint32_t ulChannel = 0; ulChannel < ulChannels; ulChannel++ )
+        {
+            pfRow[ ulChannel ] = prvTraceValue( ulTrace, ulRow, ulChannel );
+        }
+
+        prvCheck( xSensorReplayAddRow( xSource, pfRow, ulChannels ) == pdTRUE, "push trace row" );
+    }
+}
+
+/* A motion sample is either a whole trace row or a finite synthetic sample */
+static bool prvMotionSampleValid( const float pfSample[ SENSOR_REPLAY_MAX_CHANNELS ] )
+{
+    bool xTraceRow = true;
+    bool xSynthetic = true;
+
+    for( uint32_t ulChannel = 0; ulChannel < TEST_MOTION_CHANNELS; ulChannel++ )
+    {
+        xTraceRow &= ( pfSample[ ulChannel ] == ( pfSample[ 0 ] + ( float ) ulChannel ) ) &&
+                     ( pfSample[ 0 ] >= prvTraceValue( 1, 0, 0 ) );
+        xSynthetic &= isfinite( pfSample[ ulChannel ] ) &&
+                      ( fabsf( pfSample[ ulChannel ] ) < ( 1000.0f + TEST_MAX_DEVIATION ) );
+    }
+
+    return xTraceRow || xSynthetic;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvTestSynthetic( void )
+{
+    static float pfFirst[ 100 ][ SENSOR_REPLAY_MAX_CHANNELS ];
+    static float pfSecond[ 100 ][ SENSOR_REPLAY_MAX_CHANNELS ];
+    SensorReplayStats_t xStats;
+    uint32_t ulRead = 0;
+    bool xSame = true;
+
+    prvCheck( xSensorReplayStart( SENSOR_REPLAY_ENV, 0, SENSOR_REPLAY_SYNTHETIC ) == pdFALSE, "rate below the minimum" );
+    prvCheck( xSensorReplayStart( SENSOR_REPLAY_ENV, 2000, SENSOR_REPLAY_SYNTHETIC ) == pdFALSE, "rate above the maximum" );
+    prvCheck( xSensorReplayStart( SENSOR_REPLAY_ENV, 100, SENSOR_REPLAY_TRACE ) == pdFALSE, "trace mode without a trace" );
+
+    prvCheck( xSensorReplayStart( SENSOR_REPLAY_ENV, 100, SENSOR_REPLAY_SYNTHETIC ) == pdTRUE, "start" );
+    prvCheck( xSensorReplayPeriod( SENSOR_REPLAY_ENV ) == pdMS_TO_TICKS( 10 ), "period" );
+
+    vHostKernelAdvanceTicks( pdMS_TO_TICKS( 1000 ) );
+    prvCheck( ulSensorReplayRead( SENSOR_REPLAY_ENV, pfFirst, 40 ) == 40, "batch limited to ulMaxSamples" );
+
+    vSensorReplayGetStats( SENSOR_REPLAY_ENV, &xStats );
+    prvCheck( ( xStats.ulSamples == 100 ) && ( xStats.ulConsumed == 40 ) && ( xStats.ulDropped == 60 ), "excess samples dropped" );
+
+    for( uint32_t i = 0; i < 40; i++ )
+    {
+        for( uint32_t ulChannel = 0; ulChannel < TEST_ENV_CHANNELS; ulChannel++ )
+        {
+            xSame &= isfinite( pfFirst[ i ][ ulChannel ] ) && ( fabsf( pfFirst[ i ][ ulChannel ] ) < 1100.0f );
+        }
+    }
+
+    prvCheck( xSame, "synthetic samples in range" );
+
+    /* The same samples again, read in batches of different sizes */
+    prvCheck( xSensorReplayStart( SENSOR_REPLAY_ENV, 100, SENSOR_REPLAY_SYNTHETIC ) == pdTRUE, "restart" );
+    vHostKernelAdvanceTicks( pdMS_TO_TICKS( 1000 ) );
+    prvCheck( ulSensorReplayRead( SENSOR_REPLAY_ENV, pfSecond, 40 ) == 40, "batch after restart" );
+    prvCheck( memcmp( pfFirst, pfSecond, 40 * sizeof( pfFirst[ 0 ] ) ) == 0, "synthetic samples reproducible" );
+
+    prvCheck( xSensorReplayStart( SENSOR_REPLAY_ENV, 100, SENSOR_REPLAY_SYNTHETIC ) == pdTRUE, "restart" );
+
+    for( uint32_t i = 0; i < 100; i++ )
+    {
+        vHostKernelAdvanceTicks( pdMS_TO_TICKS( 10 ) );
+        ulRead += ulSensorReplayRead( SENSOR_REPLAY_ENV, &( pfSecond[ ulRead ] ), 100 - ulRead );
+    }
+
+    prvCheck( ulRead == 100, "every sample read one at a time" );
+    prvCheck( memcmp( pfFirst, &( pfSecond[ 60 ] ), 40 * sizeof( pfFirst[ 0 ] ) ) == 0, "drops skip the oldest samples" );
+
+    /* Split across two batches */
+    prvCheck( xSensorReplayStart( SENSOR_REPLAY_ENV, 100, SENSOR_REPLAY_SYNTHETIC ) == pdTRUE, "restart" );
+    vHostKernelAdvanceTicks( pdMS_TO_TICKS( 600 ) );
+    prvCheck( ulSensorReplayRead( SENSOR_REPLAY_ENV, pfFirst, 100 ) == 60, "first 60 samples" );
+    vHostKernelAdvanceTicks( pdMS_TO_TICKS( 400 ) );
+    prvCheck( ulSensorReplayRead( SENSOR_REPLAY_ENV, pfFirst, 40 ) == 40, "last 40 samples" );
+    prvCheck( memcmp( pfFirst, &( pfSecond[ 60 ] ), 40 * sizeof( pfFirst[ 0 ] ) ) == 0, "samples independent of batching" );
+
+    vSensorReplayStop( SENSOR_REPLAY_ENV );
+}
+
+static void prvTestTrace( void )
+{
+    float pfSamples[ 10 ][ SENSOR_REPLAY_MAX_CHANNELS ];
+    SensorReplayStats_t xStats;
+    bool xInOrder = true;
+
+    prvPushTrace( SENSOR_REPLAY_ENV, 1, 3, TEST_ENV_CHANNELS );
+    prvCheck( xSensorReplayAddRow( SENSOR_REPLAY_ENV, pfSamples[ 0 ], TEST_MOTION_CHANNELS ) == pdFALSE, "row of the wrong width" );
+
+    prvCheck( xSensorReplayStart( SENSOR_REPLAY_ENV, 1000, SENSOR_REPLAY_TRACE ) == pdTRUE, "start trace" );
+    prvCheck( xSensorReplayAddRow( SENSOR_REPLAY_ENV, pfSamples[ 0 ], TEST_ENV_CHANNELS ) == pdFALSE, "no rows pushed while running" );
+
+    vSensorReplayClear( SENSOR_REPLAY_ENV );
+    vSensorReplayGetStats( SENSOR_REPLAY_ENV, &xStats );
+    prvCheck( xStats.ulTraceRows == 3, "no clear while running" );
+
+    vHostKernelAdvanceTicks( 10 );
+    prvCheck( ulSensorReplayRead( SENSOR_REPLAY_ENV, pfSamples, 10 ) == 10, "trace samples" );
+
+    for( uint32_t i = 0; i < 10; i++ )
+    {
+        for( uint32_t ulChannel = 0; ulChannel < TEST_ENV_CHANNELS; ulChannel++ )
+        {
+            xInOrder &= ( pfSamples[ i ][ ulChannel ] == prvTraceValue( 1, i % 3, ulChannel ) );
+        }
+    }
+
+    prvCheck( xInOrder, "trace replayed in a loop" );
+
+    uxQueueDepth = 7;
+    vSensorReplayRecordPublish( SENSOR_REPLAY_ENV, pdTRUE, 120 );
+    uxQueueDepth = 3;
+    vSensorReplayRecordPublish( SENSOR_REPLAY_ENV, pdFALSE, 120 );
+    vSensorReplayGetStats( SENSOR_REPLAY_ENV, &xStats );
+    prvCheck( ( xStats.ulPublished == 1 ) && ( xStats.ulFailed == 1 ) && ( xStats.ulBytes == 120 ) &&
+              ( xStats.ulMaxQueueDepth == 7 ), "publish statistics" );
+
+    vSensorReplayStop( SENSOR_REPLAY_ENV );
+    vSensorReplayClear( SENSOR_REPLAY_ENV );
+    vSensorReplayGetStats( SENSOR_REPLAY_ENV, &xStats );
+    prvCheck( xStats.ulTraceRows == 0, "cleared once stopped" );
+}
+
+static void prvTestStop( void )
+{
+    float pfSamples[ 10 ][ SENSOR_REPLAY_MAX_CHANNELS ];
+    SensorReplayStats_t xStats;
+
+    prvCheck( xSensorReplayStart( SENSOR_REPLAY_ENV, 100, SENSOR_REPLAY_SYNTHETIC ) == pdTRUE, "start" );
+    vHostKernelAdvanceTicks( pdMS_TO_TICKS( 50 ) );
+    prvCheck( ulSensorReplayRead( SENSOR_REPLAY_ENV, pfSamples, 10 ) == 5, "read before stop" );
+
+    vSensorReplayStop( SENSOR_REPLAY_ENV );
+    prvCheck( xSensorReplayActive( SENSOR_REPLAY_ENV ) == pdFALSE, "stopped" );
+
+    vHostKernelAdvanceTicks( pdMS_TO_TICKS( 50 ) );
+    prvCheck( ulSensorReplayRead( SENSOR_REPLAY_ENV, pfSamples, 10 ) == 0, "no samples once stopped" );
+
+    vSensorReplayGetStats( SENSOR_REPLAY_ENV, &xStats );
+    prvCheck( ( xStats.ulConsumed == 5 ) && ( xStats.ulDropped == 0 ), "no drops once stopped" );
+}
+
+static void * prvReaderThread( void * pvParameters )
+{
+    static float pfSamples[ TEST_READ_BATCH ][ SENSOR_REPLAY_MAX_CHANNELS ];
+
+    ( void ) pvParameters;
+
+    while( xReaderRun )
+    {
+        uint32_t ulRead;
+
+        vHostKernelAdvanceTicks( 1 );
+        ulRead = ulSensorReplayRead( SENSOR_REPLAY_MOTION, pfSamples, TEST_READ_BATCH );
+
+        for( uint32_t i = 0; i < ulRead; i++ )
+        {
+            if( !prvMotionSampleValid( pfSamples[ i ] ) )
+            {
+                ulReaderBadSamples++;
+            }
+        }
+
+        ulReaderSamples += ulRead;
+    }
+
+    return NULL;
+}
+
+static uint64_t prvNowMs( void )
+{
+    struct timespec xNow;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &xNow );
+
+    return ( ( uint64_t ) xNow.tv_sec * 1000U ) + ( ( uint64_t ) xNow.tv_nsec / 1000000U );
+}
+
+static void prvTestRace( uint32_t ulDurationMs )
+{
+    pthread_t xReader;
+    uint32_t ulLiveBefore = ulLiveBlocks;
+    uint64_t ullEnd = prvNowMs() + ulDurationMs;
+
+    xReaderRun = true;
+    prvCheck( pthread_create( &xReader, NULL, prvReaderThread, NULL ) == 0, "reader thread" );
+
+    for( uint32_t i = 0; prvNowMs() < ullEnd; i++ )
+    {
+        SensorReplayMode_t xMode = ( ( i % 3 ) == 0 ) ? SENSOR_REPLAY_SYNTHETIC : SENSOR_REPLAY_TRACE;
+
+        vSensorReplayStop( SENSOR_REPLAY_MOTION );
+        vSensorReplayClear( SENSOR_REPLAY_MOTION );
+        prvPushTrace( SENSOR_REPLAY_MOTION, 1 + ( i % 50 ), 1 + ( i % 7 ), TEST_MOTION_CHANNELS );
+        prvCheck( xSensorReplayStart( SENSOR_REPLAY_MOTION, 500 + ( i % 500 ), xMode ) == pdTRUE, "restart" );
+        vHostKernelAdvanceTicks( TEST_READ_BATCH );
+    }
+
+    xReaderRun = false;
+    ( void ) pthread_join( xReader, NULL );
+
+    vSensorReplayStop( SENSOR_REPLAY_MOTION );
+    vSensorReplayClear( SENSOR_REPLAY_MOTION );
+
+    prvCheck( ulReaderSamples > 0, "reader got samples" );
+    prvCheck( ulReaderBadSamples == 0, "no sample from a stopped source or a freed trace" );
+    prvCheck( ulLiveBlocks == ulLiveBefore, "every trace freed" );
+
+    if( ulReaderBadSamples != 0 )
+    {
+        printf( "%lu of %lu samples invalid\n", ( unsigned long ) ulReaderBadSamples, ( unsigned long ) ulReaderSamples );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    uint32_t ulDurationMs = 3000U;
+
+    if( argc > 1 )
+    {
+        ulDurationMs = ( uint32_t ) strtoul( argv[ 1 ], NULL, 10 );
+    }
+
+    prvTestSynthetic();
+    prvTestTrace();
+    prvTestStop();
+    prvTestRace( ulDurationMs );
+
+    printf( "%s (%lu failures)\n", ( ulFailures == 0 ) ? "PASS" : "FAIL", ( unsigned long ) ulFailures );
+
+    return ( ulFailures == 0 ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,829 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+/*
+ * Host test of the sensor acquisition service in Common/app/sensor_sched.c.
+ *
+ * vSensorSchedTask runs in its own thread against mock BSP sensors and a
+ * mock of the imu_fifo.c interface, whose watermark "interrupt" notifies the
+ * acquisition task on IMU_FIFO_NOTIFY_IDX like the real one. A ticker thread
+ * keeps the tick count at the milliseconds elapsed since the start, so ticks
+ * and the timed notification waits of the host kernel share one time base.
+ * Checks:
+ * 1. Timeout: xSensorSchedEnable gives up after SENSOR_SCHED_ENABLE_TIMEOUT_MS
+ *    when the acquisition task is not running, and the late acknowledgement
+ *    does not satisfy the next request.
+ * 2. Handshake: enable and disable requests return as soon as the
+ *    acquisition task has applied them.
+ * 3. Requests: an enable request does not make the acquisition task drain
+ *    the IMU FIFO as if its watermark interrupt had fired.
+ * 4. FIFO: a watermark interrupt drains the FIFO into the ring, with sets
+ *    back-dated one ODR period apart.
+ * 5. Deadlines: a polled sensor is read once per period into the ring.
+ * 6. Errors: a sensor which fails to start is reported and left off.
+ * 7. Jitter and RAM: every BSP read holds a mock I2C bus for 200 to 600 us.
+ *    Four sensors at 10 to 50 Hz are acquired for 2 s by the service, then
+ *    by one polling thread per sensor which reads and delays like the tasks
+ *    the service replaced. Reports the error of each sampling interval, the
+ *    drift from the ideal sampling grid and the stack and ring RAM of both
+ *    designs. The service must not drift. Drift is the error of the median
+ *    interval over the whole run, so that an overrun, after which the
+ *    service moves its grid on purpose, and samples the host delayed do not
+ *    count as drift.
+ *
+ * Exits with a failure status if any check fails.
+ *
+ * Build and run from the repository root:
+ *   cc -O2 -Itools/host -ICommon/include -ICommon/cli -IDrivers/BSP/Components/ism330dlc tools/sensor_sched_test.c \
+ *      Common/app/sensor_sched.c tools/host/host_kernel.c -lpthread -o sensor_sched_test
+ *   ./sensor_sched_test
+ */
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "hw_defs.h"
+#include "dwt_cycles.h"
+#include "imu_fifo.h"
+#include "sensor_sched.h"
+
+#include "b_u585i_iot02a_env_sensors.h"
+#include "b_u585i_iot02a_motion_sensors.h"
+
+#define TEST_RING_LENGTH       64U
+#define TEST_IMU_RATE_HZ       12.5f
+#define TEST_ENV_RATE_HZ       10.0f
+#define TEST_FIFO_SETS         64U
+#define TEST_REQUESTS          20U
+#define TEST_BSP_FAIL          ( -5 )
+
+#define TEST_BUS_MIN_US           200U
+#define TEST_BUS_MAX_US           600U
+#define TEST_MEASURE_MS           2000U
+#define TEST_MEASURE_RING         256U
+#define TEST_MAX_DRIFT_MS         3
+#define TEST_JITTER_MAX_INTERVALS 128
+#define TEST_SCHED_STACK_WORDS    512U /* SensorSched in app_main.c */
+#define TEST_ENV_RING_LEN         8U   /* ENV_RING_LEN */
+#define TEST_MOTION_RING_LEN      64U  /* MOTION_RING_LEN */
+
+typedef struct
+{
+    pthread_mutex_t xLock;
+    TaskHandle_t xConsumer;
+    uint32_t ulWatermark;
+    uint32_t ulLevel;
+    uint32_t ulNextSet;
+    uint32_t ulReads;
+    uint32_t ulDeinits;
+    BaseType_t xAvailable;
+} TestFifo_t;
+
+static TestFifo_t xFifo =
+{
+    .xLock      = PTHREAD_MUTEX_INITIALIZER,
+    .xAvailable = pdTRUE
+};
+
+typedef struct
+{
+    uint32_t ulSamples;
+    uint32_t ulLastMs;
+    uint32_t ulSumErrorMs; /* Of the intervals between samples */
+    uint32_t ulMaxErrorMs;
+    uint32_t pulIntervalsMs[ TEST_JITTER_MAX_INTERVALS ];
+} TestJitter_t;
+
+typedef struct
+{
+    SensorId_t xSensor;
+    uint32_t ulPeriodMs;
+    TickType_t xEnd;
+    TestJitter_t xJitter;
+} TestPoller_t;
+
+static const struct
+{
+    SensorId_t xSensor;
+    uint32_t ulPeriodMs;
+} xMeasured[] =
+{
+    { SENSOR_ID_HTS221,  100 },
+    { SENSOR_ID_LPS22HH, 100 },
+    { SENSOR_ID_IMU,     20  },
+    { SENSOR_ID_MAGNETO, 40  }
+};
+
+#define TEST_NUM_MEASURED    ( sizeof( xMeasured ) / sizeof( xMeasured[ 0 ] ) )
+
+/* Tick differences above this are in the past, as SENSOR_SCHED_HORIZON */
+#define SENSOR_SCHED_HORIZON_TEST    ( portMAX_DELAY / 2 )
+
+static pthread_mutex_t xBus = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t ulBusSeed = 1;
+
+/* Instance that fails BSP_ENV_SENSOR_SetOutputDataRate, or -1 */
+static volatile int32_t lEnvFailInstance = -1;
+
+HostDwt_t xHostDwt;
+uint32_t SystemCoreClock = 160000000UL;
+
+void * Motion_Sensor_CompObj[ MOTION_SENSOR_INSTANCES_NBR ];
+
+static uint32_t ulFailures = 0;
+
+/*-----------------------------------------------------------*/
+
+static void prvCheck( bool xCondition,
+                      const char * pcWhat )
+{
+    if( !xCondition )
+    {
+        printf( "FAIL: %s\n", pcWhat );
+        ulFailures++;
+    }
+}
+
+static void prvSleepUs( uint32_t ulUs )
+{
+    struct timespec xSleep = { ( time_t ) ( ulUs / 1000000U ), ( long ) ( ulUs % 1000000U ) * 1000L };
+
+    ( void ) nanosleep( &xSleep, NULL );
+}
+
+static void prvSleepMs( uint32_t ulMs )
+{
+    prvSleepUs( ulMs * 1000U );
+}
+
+/* One I2C transfer, which holds the bus and runs the cycle counter for its duration */
+static void prvBusTransfer( void )
+{
+    uint32_t ulUs;
+
+    ( void ) pthread_mutex_lock( &xBus );
+
+    ulBusSeed = ( ulBusSeed * 1103515245UL ) + 12345UL;
+    ulUs = TEST_BUS_MIN_US + ( ( ulBusSeed >> 16 ) % ( TEST_BUS_MAX_US - TEST_BUS_MIN_US ) );
+    prvSleepUs( ulUs );
+    xHostDwt.CYCCNT += ulUs * ( SystemCoreClock / 1000000UL );
+
+    ( void ) pthread_mutex_unlock( &xBus );
+}
+
+void vDwtCycleCounterEnable( void )
+{
+}
+
+void * pvPortMalloc( size_t xWantedSize )
+{
+    return malloc( xWantedSize );
+}
+
+void vPortFree( void * pv )
+{
+    free( pv );
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t BSP_ENV_SENSOR_Init( uint32_t Instance,
+                             uint32_t Functions )
+{
+    ( void ) Instance;
+    ( void ) Functions;
+
+    return BSP_ERROR_NONE;
+}
+
+int32_t BSP_ENV_SENSOR_Enable( uint32_t Instance,
+                               uint32_t Function )
+{
+    ( void ) Instance;
+    ( void ) Function;
+
+    return BSP_ERROR_NONE;
+}
+
+int32_t BSP_ENV_SENSOR_SetOutputDataRate( uint32_t Instance,
+                                          uint32_t Function,
+                                          float Odr )
+{
+    ( void ) Function;
+    ( void ) Odr;
+
+    return ( ( int32_t ) Instance == lEnvFailInstance ) ? TEST_BSP_FAIL : BSP_ERROR_NONE;
+}
+
+int32_t BSP_ENV_SENSOR_GetValue( uint32_t Instance,
+                                 uint32_t Function,
+                                 float * Value )
+{
+    prvBusTransfer();
+    *Value = ( float ) ( ( Instance * 100U ) + Function );
+
+    return BSP_ERROR_NONE;
+}
+
+int32_t BSP_MOTION_SENSOR_Init( uint32_t Instance,
+                                uint32_t Functions )
+{
+    ( void ) Instance;
+    ( void ) Functions;
+
+    return BSP_ERROR_NONE;
+}
+
+int32_t BSP_MOTION_SENSOR_Enable( uint32_t Instance,
+                                  uint32_t Function )
+{
+    ( void ) Instance;
+    ( void ) Function;
+
+    return BSP_ERROR_NONE;
+}
+
+int32_t BSP_MOTION_SENSOR_GetAxes( uint32_t Instance,
+                                   uint32_t Function,
+                                   BSP_MOTION_SENSOR_Axes_t * Axes )
+{
+    prvBusTransfer();
+    Axes->x = ( int32_t ) Function;
+    Axes->y = ( int32_t ) Instance;
+    Axes->z = 0;
+
+    return BSP_ERROR_NONE;
+}
+
+int32_t BSP_MOTION_SENSOR_SetOutputDataRate( uint32_t Instance,
+                                             uint32_t Function,
+                                             float Odr )
+{
+    ( void ) Instance;
+    ( void ) Function;
+    ( void ) Odr;
+
+    return BSP_ERROR_NONE;
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t xImuFifoInit( float fOdrHz,
+                         uint32_t ulWatermark )
+{
+    ( void ) fOdrHz;
+
+    ( void ) pthread_mutex_lock( &xFifo.xLock );
+    xFifo.xConsumer = xTaskGetCurrentTaskHandle();
+    xFifo.ulWatermark = ulWatermark;
+    xFifo.ulLevel = 0;
+    ( void ) pthread_mutex_unlock( &xFifo.xLock );
+
+    return xFifo.xAvailable;
+}
+
+void vImuFifoDeinit( void )
+{
+    ( void ) pthread_mutex_lock( &xFifo.xLock );
+    xFifo.xConsumer = NULL;
+    xFifo.ulDeinits++;
+    ( void ) pthread_mutex_unlock( &xFifo.xLock );
+}
+
+BaseType_t xImuFifoWait( TickType_t xTimeout )
+{
+    return( ulTaskNotifyTakeIndexed( IMU_FIFO_NOTIFY_IDX, pdTRUE, xTimeout ) > 0 ? pdTRUE : pdFALSE );
+}
+
+/* Set i of the stream holds i in every axis */
+uint32_t ulImuFifoRead( int32_t plSamples[][ IMU_FIFO_NUM_AXES ],
+                        uint32_t ulMaxSamples )
+{
+    uint32_t ulNumRead;
+
+    ( void ) pthread_mutex_lock( &xFifo.xLock );
+
+    ulNumRead = ( xFifo.ulLevel < ulMaxSamples ) ? xFifo.ulLevel : ulMaxSamples;
+
+    for( uint32_t i = 0; i < ulNumRead; i++ )
+    {
+        for( uint32_t ulAxis = 0; ulAxis < IMU_FIFO_NUM_AXES; ulAxis++ )
+        {
+            plSamples[ i ][ ulAxis ] = ( int32_t ) ( xFifo.ulNextSet - xFifo.ulLevel + i );
+        }
+    }
+
+    xFifo.ulLevel -= ulNumRead;
+    xFifo.ulReads++;
+
+    ( void ) pthread_mutex_unlock( &xFifo.xLock );
+
+    return ulNumRead;
+}
+
+uint32_t ulImuFifoGetOverruns( void )
+{
+    return 0;
+}
+
+/* Sample ulSets sets and raise the watermark interrupt when it is crossed */
+static void prvFifoSample( uint32_t ulSets )
+{
+    TaskHandle_t xNotify = NULL;
+
+    ( void ) pthread_mutex_lock( &xFifo.xLock );
+
+    if( xFifo.xConsumer != NULL )
+    {
+        BaseType_t xBelow = ( xFifo.ulLevel < xFifo.ulWatermark ) ? pdTRUE : pdFALSE;
+
+        xFifo.ulLevel += ulSets;
+        xFifo.ulNextSet += ulSets;
+
+        if( ( xBelow == pdTRUE ) && ( xFifo.ulLevel >= xFifo.ulWatermark ) )
+        {
+            xNotify = xFifo.xConsumer;
+        }
+    }
+
+    ( void ) pthread_mutex_unlock( &xFifo.xLock );
+
+    if( xNotify != NULL )
+    {
+        BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+        vTaskNotifyGiveIndexedFromISR( xNotify, IMU_FIFO_NOTIFY_IDX, &xHigherPriorityTaskWoken );
+    }
+}
+
+static uint32_t prvFifoReads( void )
+{
+    uint32_t ulReads;
+
+    ( void ) pthread_mutex_lock( &xFifo.xLock );
+    ulReads = xFifo.ulReads;
+    ( void ) pthread_mutex_unlock( &xFifo.xLock );
+
+    return ulReads;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint64_t prvNowMs( void )
+{
+    struct timespec xNow;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &xNow );
+
+    return ( ( uint64_t ) xNow.tv_sec * 1000U ) + ( ( uint64_t ) xNow.tv_nsec / 1000000U );
+}
+
+static void * prvTickerThread( void * pvParameters )
+{
+    uint64_t ullStartMs = prvNowMs();
+
+    ( void ) pvParameters;
+
+    for( ; ; )
+    {
+        TickType_t xElapsed = ( TickType_t ) ( prvNowMs() - ullStartMs );
+
+        prvSleepMs( 1 );
+        vHostKernelAdvanceTicks( xElapsed - xTaskGetTickCount() );
+    }
+
+    return NULL;
+}
+
+static void * prvSchedThread( void * pvParameters )
+{
+    vSensorSchedTask( pvParameters );
+
+    return NULL;
+}
+
+/* Pop everything queued in the ring */
+static uint32_t prvRingDrain( SensorRing_t * pxRing,
+                              SensorSample_t * pxSamples,
+                              uint32_t ulMaxSamples )
+{
+    uint32_t ulCount = 0;
+    SensorSample_t xSample;
+
+    while( xSensorRingPop( pxRing, &xSample ) == pdTRUE )
+    {
+        if( ulCount < ulMaxSamples )
+        {
+            pxSamples[ ulCount ] = xSample;
+        }
+
+        ulCount++;
+    }
+
+    return ulCount;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvTestTimeout( SensorRing_t * pxRing )
+{
+    TickType_t xStart = xTaskGetTickCount();
+    TickType_t xElapsed;
+
+    prvCheck( xSensorSchedEnable( SENSOR_ID_HTS221, TEST_ENV_RATE_HZ, pxRing ) == pdFALSE,
+              "enable fails without the acquisition task" );
+
+    xElapsed = xTaskGetTickCount() - xStart;
+    prvCheck( ( xElapsed >= pdMS_TO_TICKS( 1000 ) ) && ( xElapsed < pdMS_TO_TICKS( 1500 ) ), "enable times out after 1 s" );
+}
+
+static void prvTestHandshake( SensorRing_t * pxRing )
+{
+    TickType_t xStart;
+    bool xAllApplied = true;
+
+    /* The timed out request is applied once the task runs, without an acknowledgement */
+    prvSleepMs( 50 );
+    prvCheck( xSensorSchedEnable( SENSOR_ID_HTS221, 0.0f, NULL ) == pdTRUE, "disable" );
+
+    xStart = xTaskGetTickCount();
+
+    for( uint32_t i = 0; i < TEST_REQUESTS; i++ )
+    {
+        xAllApplied &= ( xSensorSchedEnable( SENSOR_ID_LPS22HH, TEST_ENV_RATE_HZ, pxRing ) == pdTRUE );
+        xAllApplied &= ( xSensorSchedEnable( SENSOR_ID_LPS22HH, 0.0f, NULL ) == pdTRUE );
+    }
+
+    prvCheck( xAllApplied, "every request applied" );
+    prvCheck( ( xTaskGetTickCount() - xStart ) < pdMS_TO_TICKS( 500 ), "requests return once applied" );
+
+    vSensorRingFlush( pxRing );
+}
+
+static void prvTestRequestsAreNotFifoEvents( SensorRing_t * pxRing )
+{
+    uint32_t ulReads;
+
+    prvCheck( xSensorSchedEnable( SENSOR_ID_IMU, TEST_IMU_RATE_HZ, pxRing ) == pdTRUE, "enable IMU" );
+
+    /* Let the first read after the start go through */
+    prvSleepMs( 20 );
+    ulReads = prvFifoReads();
+
+    for( uint32_t i = 0; i < TEST_REQUESTS; i++ )
+    {
+        ( void ) xSensorSchedEnable( SENSOR_ID_MAGNETO, 10.0f, pxRing );
+        ( void ) xSensorSchedEnable( SENSOR_ID_MAGNETO, 0.0f, NULL );
+    }
+
+    prvCheck( prvFifoReads() == ulReads, "no FIFO read on an enable request" );
+
+    vSensorRingFlush( pxRing );
+}
+
+static void prvTestFifo( SensorRing_t * pxRing )
+{
+    SensorSample_t pxSamples[ TEST_RING_LENGTH ];
+    uint32_t ulWatermark = xFifo.ulWatermark;
+    uint32_t ulFirstSet = xFifo.ulNextSet;
+    uint32_t ulCount;
+    bool xInOrder = true;
+
+    prvCheck( ulWatermark == 3, "watermark for 250 ms at 12.5 Hz" );
+
+    /* Consume any wake left by earlier pushes */
+    ( void ) xSensorRingWait( 0 );
+
+    prvFifoSample( ulWatermark - 1 );
+    prvCheck( xSensorRingWait( pdMS_TO_TICKS( 50 ) ) == pdFALSE, "nothing below the watermark" );
+
+    prvFifoSample( 1 );
+    prvCheck( xSensorRingWait( pdMS_TO_TICKS( 200 ) ) == pdTRUE, "consumer woken on the watermark" );
+
+    ulCount = prvRingDrain( pxRing, pxSamples, TEST_RING_LENGTH );
+    prvCheck( ulCount == ulWatermark, "FIFO drained into the ring" );
+
+    for( uint32_t i = 0; ( i < ulCount ) && ( i < TEST_RING_LENGTH ); i++ )
+    {
+        xInOrder &= ( pxSamples[ i ].ucSensor == SENSOR_ID_IMU ) &&
+                    ( pxSamples[ i ].ucNumValues == IMU_FIFO_NUM_AXES ) &&
+                    ( pxSamples[ i ].fValues[ 0 ] == ( float ) ( ulFirstSet + i ) );
+
+        if( i > 0 )
+        {
+            xInOrder &= ( ( pxSamples[ i ].ulTimestampMs - pxSamples[ i - 1 ].ulTimestampMs ) == 80U );
+        }
+    }
+
+    prvCheck( xInOrder, "sets in order, one ODR period apart" );
+
+    prvCheck( xSensorSchedEnable( SENSOR_ID_IMU, 0.0f, NULL ) == pdTRUE, "disable IMU" );
+    prvCheck( xFifo.ulDeinits > 0, "FIFO released" );
+    prvCheck( xFifo.xConsumer == NULL, "FIFO consumer cleared" );
+
+    vSensorRingFlush( pxRing );
+}
+
+static void prvTestDeadlines( SensorRing_t * pxRing )
+{
+    SensorSample_t pxSamples[ TEST_RING_LENGTH ];
+    SensorSchedStats_t xStats;
+    uint32_t ulCount;
+    bool xPeriodic = true;
+
+    prvCheck( xSensorSchedEnable( SENSOR_ID_HTS221, TEST_ENV_RATE_HZ, pxRing ) == pdTRUE, "enable HTS221" );
+    prvSleepMs( 550 );
+    prvCheck( xSensorSchedEnable( SENSOR_ID_HTS221, 0.0f, NULL ) == pdTRUE, "disable HTS221" );
+
+    ulCount = prvRingDrain( pxRing, pxSamples, TEST_RING_LENGTH );
+    prvCheck( ( ulCount >= 5 ) && ( ulCount <= 7 ), "one read per period" );
+
+    for( uint32_t i = 0; ( i < ulCount ) && ( i < TEST_RING_LENGTH ); i++ )
+    {
+        xPeriodic &= ( pxSamples[ i ].ucSensor == SENSOR_ID_HTS221 ) &&
+                     ( pxSamples[ i ].fValues[ 0 ] == ( float ) ENV_TEMPERATURE ) &&
+                     ( pxSamples[ i ].fValues[ 1 ] == ( float ) ENV_HUMIDITY );
+
+        if( i > 0 )
+        {
+            uint32_t ulDeltaMs = pxSamples[ i ].ulTimestampMs - pxSamples[ i - 1 ].ulTimestampMs;
+
+            xPeriodic &= ( ulDeltaMs >= 90U ) && ( ulDeltaMs <= 110U );
+        }
+    }
+
+    prvCheck( xPeriodic, "samples 100 ms apart" );
+
+    vSensorSchedGetStats( SENSOR_ID_HTS221, &xStats );
+    prvCheck( ( xStats.ulSamples >= ulCount ) && ( xStats.fRateHz == 0.0f ), "HTS221 statistics" );
+}
+
+static void prvTestErrors( SensorRing_t * pxRing )
+{
+    SensorSchedStats_t xStats;
+
+    lEnvFailInstance = 1;
+    prvCheck( xSensorSchedEnable( SENSOR_ID_LPS22HH, TEST_ENV_RATE_HZ, pxRing ) == pdFALSE, "enable fails on a BSP error" );
+
+    vSensorSchedGetStats( SENSOR_ID_LPS22HH, &xStats );
+    prvCheck( ( xStats.ulErrors > 0 ) && ( xStats.fRateHz == 0.0f ), "failed sensor reported and off" );
+
+    lEnvFailInstance = -1;
+    prvCheck( xSensorSchedEnable( SENSOR_ID_LPS22HH, TEST_ENV_RATE_HZ, pxRing ) == pdTRUE, "enable after the error" );
+    prvCheck( xSensorSchedEnable( SENSOR_ID_LPS22HH, 0.0f, NULL ) == pdTRUE, "disable" );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvJitterAdd( TestJitter_t * pxJitter,
+                          uint32_t ulPeriodMs,
+                          uint32_t ulTimestampMs )
+{
+    if( pxJitter->ulSamples > 0 )
+    {
+        int32_t lError = ( int32_t ) ( ulTimestampMs - pxJitter->ulLastMs ) - ( int32_t ) ulPeriodMs;
+        uint32_t ulError = ( uint32_t ) ( ( lError < 0 ) ? -lError : lError );
+
+        if( pxJitter->ulSamples <= TEST_JITTER_MAX_INTERVALS )
+        {
+            pxJitter->pulIntervalsMs[ pxJitter->ulSamples - 1 ] = ulTimestampMs - pxJitter->ulLastMs;
+        }
+
+        pxJitter->ulSumErrorMs += ulError;
+        pxJitter->ulMaxErrorMs = ( ulError > pxJitter->ulMaxErrorMs ) ? ulError : pxJitter->ulMaxErrorMs;
+    }
+
+    pxJitter->ulLastMs = ulTimestampMs;
+    pxJitter->ulSamples++;
+}
+
+static int prvCompareU32( const void * pvA,
+                          const void * pvB )
+{
+    uint32_t ulA = *( const uint32_t * ) pvA;
+    uint32_t ulB = *( const uint32_t * ) pvB;
+
+    return ( ulA > ulB ) - ( ulA < ulB );
+}
+
+/* Distance from the sampling grid the run ends at if every interval had
+ * the median length */
+static int32_t prvJitterDrift( const TestJitter_t * pxJitter,
+                               uint32_t ulPeriodMs )
+{
+    uint32_t pulSorted[ TEST_JITTER_MAX_INTERVALS ];
+    uint32_t ulIntervals = pxJitter->ulSamples - 1;
+    int32_t lDrift = 0;
+
+    if( pxJitter->ulSamples > 1 )
+    {
+        ulIntervals = ( ulIntervals < TEST_JITTER_MAX_INTERVALS ) ? ulIntervals : TEST_JITTER_MAX_INTERVALS;
+        ( void ) memcpy( pulSorted, pxJitter->pulIntervalsMs, ulIntervals * sizeof( uint32_t ) );
+        qsort( pulSorted, ulIntervals, sizeof( uint32_t ), prvCompareU32 );
+
+        lDrift = ( ( int32_t ) pulSorted[ ulIntervals / 2 ] - ( int32_t ) ulPeriodMs ) *
+                 ( int32_t ) ( pxJitter->ulSamples - 1 );
+    }
+
+    return lDrift;
+}
+
+static void prvJitterPrint( const char * pcDesign,
+                            SensorId_t xSensor,
+                            uint32_t ulPeriodMs,
+                            const TestJitter_t * pxJitter )
+{
+    static const char * const pcNames[ SENSOR_ID_MAX ] = { "hts221", "lps22hh", "ism330dlc", "iis2mdc" };
+    uint32_t ulIntervals = ( pxJitter->ulSamples > 1 ) ? ( pxJitter->ulSamples - 1 ) : 1;
+
+    printf( "jitter      %-7s %-10s %4lu ms %4lu samples, interval error mean %.2f max %2lu ms, drift %4ld ms\n",
+            pcDesign, pcNames[ xSensor ], ( unsigned long ) ulPeriodMs, ( unsigned long ) pxJitter->ulSamples,
+            ( double ) pxJitter->ulSumErrorMs / ( double ) ulIntervals,
+            ( unsigned long ) pxJitter->ulMaxErrorMs, ( long ) prvJitterDrift( pxJitter, ulPeriodMs ) );
+}
+
+/* Stands in for a per sensor task which reads its sensor and then delays */
+static void * prvPollerThread( void * pvParameters )
+{
+    TestPoller_t * pxPoller = ( TestPoller_t * ) pvParameters;
+
+    while( ( TickType_t ) ( pxPoller->xEnd - xTaskGetTickCount() ) < SENSOR_SCHED_HORIZON_TEST )
+    {
+        uint32_t ulTimestampMs = xTaskGetTickCount() * portTICK_PERIOD_MS;
+        BSP_MOTION_SENSOR_Axes_t xAxes;
+        float fValue;
+
+        switch( pxPoller->xSensor )
+        {
+            case SENSOR_ID_HTS221:
+            case SENSOR_ID_LPS22HH:
+                ( void ) BSP_ENV_SENSOR_GetValue( ( uint32_t ) pxPoller->xSensor, ENV_TEMPERATURE, &fValue );
+                ( void ) BSP_ENV_SENSOR_GetValue( ( uint32_t ) pxPoller->xSensor, ENV_HUMIDITY, &fValue );
+                break;
+
+            case SENSOR_ID_IMU:
+                ( void ) BSP_MOTION_SENSOR_GetAxes( 0, MOTION_ACCELERO, &xAxes );
+                ( void ) BSP_MOTION_SENSOR_GetAxes( 0, MOTION_GYRO, &xAxes );
+                break;
+
+            default:
+                ( void ) BSP_MOTION_SENSOR_GetAxes( 1, MOTION_MAGNETO, &xAxes );
+                break;
+        }
+
+        prvJitterAdd( &( pxPoller->xJitter ), pxPoller->ulPeriodMs, ulTimestampMs );
+
+        /* vTaskDelay( period ): nothing notifies this index */
+        ( void ) ulTaskNotifyTakeIndexed( 0, pdTRUE, pdMS_TO_TICKS( pxPoller->ulPeriodMs ) );
+    }
+
+    return NULL;
+}
+
+static void prvMeasureJitterAndRam( void )
+{
+    static SensorSample_t pxSamples[ TEST_MEASURE_RING ];
+    TestJitter_t xSched[ SENSOR_ID_MAX ];
+    TestPoller_t xPollers[ TEST_NUM_MEASURED ];
+    pthread_t xThreads[ TEST_NUM_MEASURED ];
+    SensorRing_t * pxRing = pxSensorRingCreate( TEST_MEASURE_RING );
+    uint32_t ulPeriods[ SENSOR_ID_MAX ] = { 0 };
+    uint32_t ulCount;
+    size_t xStackBytes = TEST_SCHED_STACK_WORDS * sizeof( uint32_t );
+    size_t xRingBytes = ( TEST_ENV_RING_LEN + TEST_MOTION_RING_LEN ) * sizeof( SensorSample_t );
+    bool xEnabled = true;
+    bool xNoDrift = true;
+
+    prvCheck( pxRing != NULL, "measurement ring" );
+
+    if( pxRing == NULL )
+    {
+        return;
+    }
+
+    /* Service: poll the IMU too, every sensor then runs on deadlines */
+    ( void ) memset( xSched, 0, sizeof( xSched ) );
+    xFifo.xAvailable = pdFALSE;
+
+    for( size_t i = 0; i < TEST_NUM_MEASURED; i++ )
+    {
+        ulPeriods[ xMeasured[ i ].xSensor ] = xMeasured[ i ].ulPeriodMs;
+        xEnabled &= ( xSensorSchedEnable( xMeasured[ i ].xSensor, 1000.0f / ( float ) xMeasured[ i ].ulPeriodMs, pxRing ) == pdTRUE );
+    }
+
+    prvSleepMs( TEST_MEASURE_MS );
+
+    for( size_t i = 0; i < TEST_NUM_MEASURED; i++ )
+    {
+        xEnabled &= ( xSensorSchedEnable( xMeasured[ i ].xSensor, 0.0f, NULL ) == pdTRUE );
+    }
+
+    xFifo.xAvailable = pdTRUE;
+    prvCheck( xEnabled, "measured sensors enabled and disabled" );
+
+    ulCount = prvRingDrain( pxRing, pxSamples, TEST_MEASURE_RING );
+    prvCheck( ulCount <= TEST_MEASURE_RING, "measurement fits the ring" );
+
+    for( uint32_t i = 0; ( i < ulCount ) && ( i < TEST_MEASURE_RING ); i++ )
+    {
+        SensorId_t xSensor = ( SensorId_t ) pxSamples[ i ].ucSensor;
+
+        prvJitterAdd( &( xSched[ xSensor ] ), ulPeriods[ xSensor ], pxSamples[ i ].ulTimestampMs );
+    }
+
+    for( size_t i = 0; i < TEST_NUM_MEASURED; i++ )
+    {
+        SensorId_t xSensor = xMeasured[ i ].xSensor;
+        SensorSchedStats_t xStats;
+        int32_t lDrift = prvJitterDrift( &( xSched[ xSensor ] ), xMeasured[ i ].ulPeriodMs );
+
+        vSensorSchedGetStats( xSensor, &xStats );
+        prvJitterPrint( "service", xSensor, xMeasured[ i ].ulPeriodMs, &( xSched[ xSensor ] ) );
+        printf( "            %-7s %-10s worst lateness %lu ms, longest bus read %lu us\n", "", xStats.pcName,
+                ( unsigned long ) xStats.ulMaxLatenessMs, ( unsigned long ) xStats.ulMaxReadUs );
+
+        xNoDrift &= ( xSched[ xSensor ].ulSamples >= ( TEST_MEASURE_MS / xMeasured[ i ].ulPeriodMs ) - 1 ) &&
+                    ( lDrift <= TEST_MAX_DRIFT_MS ) && ( lDrift >= -TEST_MAX_DRIFT_MS );
+    }
+
+    prvCheck( xNoDrift, "service keeps every sensor on its sampling grid" );
+
+    /* One polling thread per sensor sharing the bus */
+    for( size_t i = 0; i < TEST_NUM_MEASURED; i++ )
+    {
+        ( void ) memset( &( xPollers[ i ] ), 0, sizeof( TestPoller_t ) );
+        xPollers[ i ].xSensor = xMeasured[ i ].xSensor;
+        xPollers[ i ].ulPeriodMs = xMeasured[ i ].ulPeriodMs;
+        xPollers[ i ].xEnd = xTaskGetTickCount() + pdMS_TO_TICKS( TEST_MEASURE_MS );
+        prvCheck( pthread_create( &( xThreads[ i ] ), NULL, prvPollerThread, &( xPollers[ i ] ) ) == 0, "polling thread" );
+    }
+
+    for( size_t i = 0; i < TEST_NUM_MEASURED; i++ )
+    {
+        ( void ) pthread_join( xThreads[ i ], NULL );
+        prvJitterPrint( "polled", xPollers[ i ].xSensor, xPollers[ i ].ulPeriodMs, &( xPollers[ i ].xJitter ) );
+    }
+
+    /* The BSP calls are the same in both designs, so a polling task needs the same stack */
+    printf( "ram         service: 1 stack of %lu B for %lu sensors, rings %lu B; one task per sensor: %lu B of stacks\n",
+            ( unsigned long ) xStackBytes, ( unsigned long ) TEST_NUM_MEASURED, ( unsigned long ) xRingBytes,
+            ( unsigned long ) ( xStackBytes * TEST_NUM_MEASURED ) );
+    printf( "ram         %ld B saved against one task per sensor, %lu B added against polling in the two publish tasks\n",
+            ( long ) ( xStackBytes * ( TEST_NUM_MEASURED - 1 ) ) - ( long ) xRingBytes,
+            ( unsigned long ) ( xStackBytes + xRingBytes ) );
+}
+
+/*-----------------------------------------------------------*/
+
+int main( void )
+{
+    pthread_t xTicker;
+    pthread_t xSched;
+    SensorRing_t * pxRing = pxSensorRingCreate( TEST_RING_LENGTH );
+
+    prvCheck( pxRing != NULL, "ring" );
+    prvCheck( pthread_create( &xTicker, NULL, prvTickerThread, NULL ) == 0, "ticker thread" );
+
+    prvTestTimeout( pxRing );
+
+    prvCheck( pthread_create( &xSched, NULL, prvSchedThread, NULL ) == 0, "acquisition thread" );
+
+    prvTestHandshake( pxRing );
+    prvTestRequestsAreNotFifoEvents( pxRing );
+    prvTestFifo( pxRing );
+    prvTestDeadlines( pxRing );
+    prvTestErrors( pxRing );
+    prvMeasureJitterAndRam();
+
+    printf( "%s (%lu failures)\n", ( ulFailures == 0 ) ? "PASS" : "FAIL", ( unsigned long ) ulFailures );
+
+    return ( ulFailures == 0 ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,336 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+/*
+ * Host simulation of shadow reported state traffic.
+ *
+ * Drives a set of device properties through typical change patterns for one
+ * simulated hour and counts the /update messages and bytes sent by:
+ *   periodic     a complete reported document every 15 s
+ *   poll         a complete document every 15 s when any property changed
+ *   incremental  the shadow_reported registry: partial documents sent on
+ *                change, coalesced and rate limited
+ * Bytes include the MQTT PUBLISH header and topic. Latency is the time from
+ * the first unreported change of a property to the report carrying it.
+ *
+ * Build and run from the repository root:
+ *   cc -O2 -ICommon/include tools/shadow_report_sim.c Common/app/shadow_reported.c -lm -o shadow_report_sim
+ *   ./shadow_report_sim [idle|typical|busy] [debounce_ms max_delay_ms min_interval_ms]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "shadow_reported.h"
+
+#define SIM_STEP_MS           ( 10U )
+#define SIM_DURATION_MS       ( 3600U * 1000U )
+#define SIM_POLL_MS           ( 15000U )
+#define SIM_RESPONSE_MS       ( 150U ) /* Service round trip for an update */
+#define SIM_DOC_LENGTH        ( 512U )
+#define SIM_MAX_PROPS         ( 16U )
+#define SIM_TOPIC             "$aws/things/stm32u5-0123456789abcdef/shadow/update"
+
+typedef struct
+{
+    const char * pcName;
+    uint32_t ulMeanGapMs;   /* Mean time between bursts of changes, 0 for a constant */
+    uint32_t ulBurstLen;    /* Changes per burst */
+    uint32_t ulBurstGapMs;  /* Time between changes within a burst */
+    int32_t lRange;         /* Values are drawn from 0 .. lRange - 1 */
+} SimPattern_t;
+
+typedef struct
+{
+    const char * pcName;
+    int32_t plSent[ SIM_MAX_PROPS ];           /* Last value sent by this strategy */
+    uint32_t pulPendingSince[ SIM_MAX_PROPS ]; /* First change not yet sent */
+    uint32_t ulMessages;
+    uint64_t ullBytes;
+    uint64_t ullLatencyMs;
+    uint32_t ulLatencyCount;
+    uint32_t ulMaxLatencyMs;
+} SimResult_t;
+
+/* Patterns of a small connected appliance */
+static const SimPattern_t pxTypical[] =
+{
+    { "powerOn",     30 * 60000, 1,  0,   2   },  /* Switched on and off twice an hour */
+    { "mode",        20 * 60000, 6,  300, 4   },  /* A user stepping through modes */
+    { "fanLevel",    2 * 60000,  1,  0,   5   },  /* Automatic fan control */
+    { "setpoint",    10 * 60000, 20, 100, 300 },  /* A rotary encoder being turned */
+    { "rssiBucket",  5 * 60000,  1,  0,   4   },
+    { "filterHours", 60 * 60000, 1,  0,   10000 },
+    { "fwVersion",   0,          0,  0,   1   },
+    { "errorCode",   0,          0,  0,   1   },
+};
+
+static uint32_t ulSeed = 12345;
+static uint32_t ulRateScale = 1;
+static uint32_t ulNumPatterns = sizeof( pxTypical ) / sizeof( pxTypical[ 0 ] );
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvRand( void )
+{
+    ulSeed = ulSeed * 1664525U + 1013904223U;
+
+    return ulSeed >> 8;
+}
+
+/* Exponentially distributed gap around ulMeanMs */
+static uint32_t prvNextGap( uint32_t ulMeanMs )
+{
+    double dU = ( ( double ) ( prvRand() & 0xFFFF ) + 1.0 ) / 65537.0;
+
+    return ( uint32_t ) ( -log( dU ) * ( double ) ulMeanMs / ( double ) ulRateScale ) + SIM_STEP_MS;
+}
+
+static size_t prvPublishSize( size_t xPayloadLen )
+{
+    size_t xRemaining = 2 + strlen( SIM_TOPIC ) + 2 + xPayloadLen;
+
+    return 1 + ( ( xRemaining < 128 ) ? 1 : 2 ) + xRemaining;
+}
+
+static size_t prvFullDocLength( const int32_t * plValues )
+{
+    char pcDoc[ SIM_DOC_LENGTH ];
+    int lLen = snprintf( pcDoc, sizeof( pcDoc ), "{\"state\":{\"reported\":{" );
+
+    for( uint32_t i = 0; i < ulNumPatterns; i++ )
+    {
+        lLen += snprintf( &( pcDoc[ lLen ] ), sizeof( pcDoc ) - ( size_t ) lLen, "%s\"%s\":%ld",
+                          ( i == 0 ) ? "" : ",", pxTypical[ i ].pcName, ( long ) plValues[ i ] );
+    }
+
+    lLen += snprintf( &( pcDoc[ lLen ] ), sizeof( pcDoc ) - ( size_t ) lLen, "}},\"clientToken\":\"%06lu\"}", 123456UL );
+
+    return ( size_t ) lLen;
+}
+
+static void prvChanged( SimResult_t * pxResult,
+                        uint32_t ulIndex,
+                        int32_t lValue,
+                        uint32_t ulNowMs )
+{
+    if( lValue == pxResult->plSent[ ulIndex ] )
+    {
+        /* Changed back to the value last sent, nothing left to report */
+        pxResult->pulPendingSince[ ulIndex ] = UINT32_MAX;
+    }
+    else if( pxResult->pulPendingSince[ ulIndex ] == UINT32_MAX )
+    {
+        pxResult->pulPendingSince[ ulIndex ] = ulNowMs;
+    }
+}
+
+static void prvSent( SimResult_t * pxResult,
+                     uint32_t ulIndex,
+                     int32_t lValue,
+                     uint32_t ulNowMs )
+{
+    if( pxResult->pulPendingSince[ ulIndex ] != UINT32_MAX )
+    {
+        uint32_t ulLatency = ulNowMs - pxResult->pulPendingSince[ ulIndex ];
+
+        pxResult->ullLatencyMs += ulLatency;
+        pxResult->ulLatencyCount++;
+
+        if( ulLatency > pxResult->ulMaxLatencyMs )
+        {
+            pxResult->ulMaxLatencyMs = ulLatency;
+        }
+
+        pxResult->pulPendingSince[ ulIndex ] = UINT32_MAX;
+    }
+
+    pxResult->plSent[ ulIndex ] = lValue;
+}
+
+static void prvPrint( const SimResult_t * pxResult )
+{
+    printf( "%-12s %10lu %12llu %14.0f %12lu\n",
+            pxResult->pcName,
+            ( unsigned long ) pxResult->ulMessages,
+            ( unsigned long long ) pxResult->ullBytes,
+            ( pxResult->ulLatencyCount > 0 ) ? ( double ) pxResult->ullLatencyMs / pxResult->ulLatencyCount : 0.0,
+            ( unsigned long ) pxResult->ulMaxLatencyMs );
+}
+
+int main( int argc,
+          char ** argv )
+{
+    static ShadowReported_t xReported;
+    static ShadowProperty_t pxProps[ SIM_MAX_PROPS ];
+    char pcDoc[ SIM_DOC_LENGTH ];
+    int32_t plValues[ SIM_MAX_PROPS ] = { 0 };
+    uint32_t pulNextEventMs[ SIM_MAX_PROPS ];
+    uint32_t pulBurstLeft[ SIM_MAX_PROPS ] = { 0 };
+    uint32_t ulDebounceMs = 250, ulMaxDelayMs = 2000, ulMinIntervalMs = 1000;
+    uint32_t ulResponseDueMs = UINT32_MAX;
+    uint32_t ulChanges = 0;
+    static SimResult_t xPeriodic = { .pcName = "periodic" };
+    static SimResult_t xPoll = { .pcName = "poll" };
+    static SimResult_t xIncremental = { .pcName = "incremental" };
+    size_t xFullLen = 0;
+
+    if( argc > 1 )
+    {
+        if( strcmp( argv[ 1 ], "idle" ) == 0 )
+        {
+            ulNumPatterns = 1;
+        }
+        else if( strcmp( argv[ 1 ], "busy" ) == 0 )
+        {
+            ulRateScale = 5;
+        }
+        else if( strcmp( argv[ 1 ], "typical" ) != 0 )
+        {
+            fprintf( stderr, "usage: %s [idle|typical|busy] [debounce_ms max_delay_ms min_interval_ms]\n", argv[ 0 ] );
+            return 1;
+        }
+    }
+
+    if( argc > 4 )
+    {
+        ulDebounceMs = ( uint32_t ) strtoul( argv[ 2 ], NULL, 10 );
+        ulMaxDelayMs = ( uint32_t ) strtoul( argv[ 3 ], NULL, 10 );
+        ulMinIntervalMs = ( uint32_t ) strtoul( argv[ 4 ], NULL, 10 );
+    }
+
+    vShadowReportedInit( &xReported, pxProps, SIM_MAX_PROPS, ulDebounceMs, ulMaxDelayMs, ulMinIntervalMs );
+
+    for( uint32_t i = 0; i < ulNumPatterns; i++ )
+    {
+        ( void ) lShadowReportedAdd( &xReported, pxTypical[ i ].pcName, 0, 0 );
+        pulNextEventMs[ i ] = ( pxTypical[ i ].ulMeanGapMs > 0 ) ? prvNextGap( pxTypical[ i ].ulMeanGapMs ) : UINT32_MAX;
+
+        /* Every property is unreported at start */
+        xPeriodic.pulPendingSince[ i ] = 0;
+        xPoll.pulPendingSince[ i ] = 0;
+        xIncremental.pulPendingSince[ i ] = 0;
+    }
+
+    for( uint32_t ulNowMs = 0; ulNowMs < SIM_DURATION_MS; ulNowMs += SIM_STEP_MS )
+    {
+        /* Property changes */
+        for( uint32_t i = 0; i < ulNumPatterns; i++ )
+        {
+            if( ulNowMs >= pulNextEventMs[ i ] )
+            {
+                const SimPattern_t * pxPattern = &( pxTypical[ i ] );
+
+                if( pulBurstLeft[ i ] == 0 )
+                {
+                    pulBurstLeft[ i ] = pxPattern->ulBurstLen;
+                }
+
+                plValues[ i ] = ( plValues[ i ] + 1 + ( int32_t ) ( prvRand() % ( uint32_t ) ( pxPattern->lRange > 1 ? pxPattern->lRange - 1 : 1 ) ) ) % pxPattern->lRange;
+                ulChanges++;
+                pulBurstLeft[ i ]--;
+
+                pulNextEventMs[ i ] = ulNowMs + ( ( pulBurstLeft[ i ] > 0 ) ? pxPattern->ulBurstGapMs : prvNextGap( pxPattern->ulMeanGapMs ) );
+
+                prvChanged( &xPeriodic, i, plValues[ i ], ulNowMs );
+                prvChanged( &xPoll, i, plValues[ i ], ulNowMs );
+                prvChanged( &xIncremental, i, plValues[ i ], ulNowMs );
+
+                vShadowReportedSet( &xReported, ( int32_t ) i, plValues[ i ], ulNowMs );
+            }
+        }
+
+        /* Periodic and polled complete documents */
+        if( ( ulNowMs % SIM_POLL_MS ) == 0 )
+        {
+            xFullLen = prvFullDocLength( plValues );
+
+            xPeriodic.ulMessages++;
+            xPeriodic.ullBytes += prvPublishSize( xFullLen );
+            uint8_t ucPollDue = ( ulNowMs == 0 );
+
+            for( uint32_t i = 0; i < ulNumPatterns; i++ )
+            {
+                prvSent( &xPeriodic, i, plValues[ i ], ulNowMs );
+                ucPollDue |= ( xPoll.pulPendingSince[ i ] != UINT32_MAX );
+            }
+
+            if( ucPollDue )
+            {
+                xPoll.ulMessages++;
+                xPoll.ullBytes += prvPublishSize( xFullLen );
+
+                for( uint32_t i = 0; i < ulNumPatterns; i++ )
+                {
+                    prvSent( &xPoll, i, plValues[ i ], ulNowMs );
+                }
+            }
+        }
+
+        /* Incremental reports, accepted after one round trip */
+        if( ulNowMs >= ulResponseDueMs )
+        {
+            vShadowReportedComplete( &xReported, 1, ulNowMs );
+            ulResponseDueMs = UINT32_MAX;
+        }
+
+        if( ulShadowReportedTimeToSendMs( &xReported, ulNowMs ) == 0 )
+        {
+            size_t xLen = xShadowReportedBuild( &xReported, pcDoc, sizeof( pcDoc ), 123456, ulNowMs );
+
+            if( xLen > 0 )
+            {
+                xIncremental.ulMessages++;
+                xIncremental.ullBytes += prvPublishSize( xLen );
+
+                /* Only the properties carried by this document are reported */
+                for( uint32_t i = 0; i < ulNumPatterns; i++ )
+                {
+                    char pcKey[ 32 ];
+
+                    ( void ) snprintf( pcKey, sizeof( pcKey ), "\"%s\":", pxTypical[ i ].pcName );
+
+                    if( strstr( pcDoc, pcKey ) != NULL )
+                    {
+                        prvSent( &xIncremental, i, plValues[ i ], ulNowMs );
+                    }
+                }
+
+                ulResponseDueMs = ulNowMs + SIM_RESPONSE_MS;
+            }
+        }
+    }
+
+    printf( "%lu properties, %lu changes in one hour, debounce %lu ms, max delay %lu ms, min interval %lu ms\n",
+            ( unsigned long ) ulNumPatterns, ( unsigned long ) ulChanges,
+            ( unsigned long ) ulDebounceMs, ( unsigned long ) ulMaxDelayMs, ( unsigned long ) ulMinIntervalMs );
+    printf( "%-12s %10s %12s %14s %12s\n", "strategy", "msgs/h", "bytes/h", "mean_lat_ms", "max_lat_ms" );
+    prvPrint( &xPeriodic );
+    prvPrint( &xPoll );
+    prvPrint( &xIncremental );
+
+    return 0;
+}
@@ -0,0 +1,295 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+/*
+ * Host simulation of the shadow service with 1 to 32 shadows.
+ *
+ * For each shadow count it compares the single task service against one
+ * task per shadow, as the classic shadow task was written before, and prints:
+ *   ram_B     static and heap RAM of the shadow code (stack, TCB, contexts,
+ *             topic strings, documents); task sizes are estimates below
+ *   subs      subscriptions held in the MQTT agent subscription manager,
+ *             which has MQTT_AGENT_MAX_SUBSCRIPTIONS (10) entries
+ *   route_ns  CPU time to route one incoming delta or update response: topic
+ *             filter matching as done by the subscription manager, shadow
+ *             lookup and the delta scan, measured on the host
+ *
+ * Build and run from the repository root:
+ *   cc -O2 -ICommon/include tools/shadow_service_sim.c Common/app/shadow_topic.c \
+ *      Common/app/shadow_reported.c Common/app/json_scan.c -o shadow_service_sim
+ *   ./shadow_service_sim [messages]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "shadow_service.h"
+#include "shadow_topic.h"
+
+#define SIM_THING              "stm32u5-0123456789abcdef"
+#define SIM_PROPS              4U
+#define SIM_TASK_STACK_BYTES   ( 1024U * 4U ) /* Stack of the shadow task in app_main.c */
+#define SIM_TCB_BYTES          ( 120U )       /* Cortex-M33 TCB with 8 notification entries */
+#define SIM_DOC_BYTES          ( 512U )       /* Shared report document */
+#define SIM_TASK_DOC_BYTES     ( 128U )       /* Report document of each per shadow task */
+#define SIM_SUB_ENTRY_BYTES    ( 12U + 16U )  /* MQTTSubscribeInfo_t and callback element */
+#define SIM_MAX_SUBSCRIPTIONS  ( 10U )
+#define SIM_MAX_TOPIC          ( 160U )
+
+static const size_t pxShadowCounts[] = { 1, 2, 4, 8, 16, 32 };
+
+static const char * pcSuffixes[ 3 ] =
+{
+    SHADOW_TOPIC_SUFFIX_DELTA,
+    SHADOW_TOPIC_SUFFIX_ACCEPTED,
+    SHADOW_TOPIC_SUFFIX_REJECTED,
+};
+
+static ShadowInstance_t pxShadows[ SHADOW_SERVICE_MAX_SHADOWS ];
+static ShadowProperty_t pxProps[ SHADOW_SERVICE_MAX_SHADOWS ][ SIM_PROPS ];
+static JsonScanField_t pxDeltaFields[ SHADOW_SERVICE_MAX_SHADOWS ][ SIM_PROPS + 1 ];
+static char pcNames[ SHADOW_SERVICE_MAX_SHADOWS ][ 32 ];
+static char pcUpdateTopics[ SHADOW_SERVICE_MAX_SHADOWS ][ SIM_MAX_TOPIC ];
+static char pcFilters[ 3 * SHADOW_SERVICE_MAX_SHADOWS ][ SIM_MAX_TOPIC ];
+static uint32_t ulHandled = 0;
+
+/*-----------------------------------------------------------*/
+
+static double prvNow( void )
+{
+    struct timespec xNow;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &xNow );
+
+    return ( double ) xNow.tv_sec + ( ( double ) xNow.tv_nsec * 1e-9 );
+}
+
+static void prvDeltaHandler( const JsonScanField_t * pxField,
+                             void * pvCtx )
+{
+    ( void ) pvCtx;
+
+    ulHandled += ulJsonScanToUInt32( pxField, 0 );
+}
+
+/* MQTT topic filter matching with single level wildcards, as MQTT_MatchTopic */
+static int prvMatchFilter( const char * pcTopic,
+                           size_t xTopicLen,
+                           const char * pcFilter )
+{
+    size_t i = 0;
+
+    while( *pcFilter != '\0' )
+    {
+        if( *pcFilter == '+' )
+        {
+            while( ( i < xTopicLen ) && ( pcTopic[ i ] != '/' ) )
+            {
+                i++;
+            }
+
+            pcFilter++;
+        }
+        else if( ( i < xTopicLen ) && ( pcTopic[ i ] == *pcFilter ) )
+        {
+            i++;
+            pcFilter++;
+        }
+        else
+        {
+            return 0;
+        }
+    }
+
+    return( i == xTopicLen );
+}
+
+/* Route an incoming publish as the subscription manager and the service callback do */
+static void prvRoute( const char * pcTopic,
+                      const char * pcPayload,
+                      size_t xNumFilters,
+                      size_t xNumShadows,
+                      int xService )
+{
+    size_t xTopicLen = strlen( pcTopic );
+
+    for( size_t f = 0; f < xNumFilters; f++ )
+    {
+        if( prvMatchFilter( pcTopic, xTopicLen, pcFilters[ f ] ) )
+        {
+            ShadowInstance_t * pxShadow = NULL;
+
+            if( xService )
+            {
+                const char * pcName = NULL;
+                size_t xNameLen = 0;
+                ShadowTopicType_t xType = xShadowTopicParse( pcTopic, xTopicLen, SIM_THING, strlen( SIM_THING ), &pcName, &xNameLen );
+
+                for( size_t i = 0; ( xType != SHADOW_TOPIC_UNKNOWN ) && ( i < xNumShadows ) && ( pxShadow == NULL ); i++ )
+                {
+                    if( ( pxShadows[ i ].usNameLen == xNameLen ) &&
+                        ( ( pcName == NULL ) || ( memcmp( pxShadows[ i ].pcName, pcName, xNameLen ) == 0 ) ) )
+                    {
+                        pxShadow = &( pxShadows[ i ] );
+                    }
+                }
+            }
+            else
+            {
+                /* One subscription per topic: the callback context is the shadow */
+                pxShadow = &( pxShadows[ f / 3 ] );
+            }
+
+            if( pxShadow != NULL )
+            {
+                if( xJsonScan( pcPayload, strlen( pcPayload ), pxShadow->pxDeltaFields, pxShadow->xNumDeltaFields ) == JSON_SCAN_SUCCESS )
+                {
+                    vJsonScanDispatch( &( pxShadow->pxDeltaFields[ 1 ] ), pxShadow->xNumDeltaFields - 1, NULL );
+                }
+            }
+        }
+    }
+}
+
+int main( int argc,
+          char ** argv )
+{
+    const char * pcDelta = "{\"version\":12,\"timestamp\":1595437367,\"state\":{\"p1\":1},"
+                           "\"metadata\":{\"p1\":{\"timestamp\":1595437367}},\"clientToken\":\"388062\"}";
+    long lMessages = ( argc > 1 ) ? strtol( argv[ 1 ], NULL, 10 ) : 200000;
+    static char pcTopics[ 3 * SHADOW_SERVICE_MAX_SHADOWS ][ SIM_MAX_TOPIC ];
+    char pcScratch[ SIM_MAX_TOPIC ];
+
+    printf( "sizeof( ShadowInstance_t ) %zu, %u reported properties per shadow\n",
+            sizeof( ShadowInstance_t ), SIM_PROPS );
+    printf( "%7s | %8s %5s %9s | %8s %5s %9s\n", "shadows", "ram_B", "subs", "route_ns", "ram_B", "subs", "route_ns" );
+    printf( "%7s | %25s | %25s\n", "", "single task service", "one task per shadow" );
+
+    for( size_t c = 0; c < sizeof( pxShadowCounts ) / sizeof( pxShadowCounts[ 0 ] ); c++ )
+    {
+        size_t xNumShadows = pxShadowCounts[ c ];
+        size_t xServiceRam = SIM_TASK_STACK_BYTES + SIM_TCB_BYTES + SIM_DOC_BYTES + sizeof( ShadowInstance_t * ) * SHADOW_SERVICE_MAX_SHADOWS;
+        size_t xTaskRam = 0;
+        size_t xServiceSubs = 0;
+        size_t xTaskSubs = 3 * xNumShadows;
+        double dStart, dService, dTasks;
+
+        /* Shadow 0 is the classic shadow, the others are named */
+        for( size_t i = 0; i < xNumShadows; i++ )
+        {
+            ( void ) snprintf( pcNames[ i ], sizeof( pcNames[ i ] ), "subsystem-%02u", ( unsigned ) i );
+
+            pxDeltaFields[ i ][ 0 ].pcPath = "version";
+
+            for( uint32_t p = 0; p < SIM_PROPS; p++ )
+            {
+                static char pcPaths[ SIM_PROPS ][ 16 ];
+
+                ( void ) snprintf( pcPaths[ p ], sizeof( pcPaths[ p ] ), "state.p%u", p );
+                pxDeltaFields[ i ][ p + 1 ].pcPath = pcPaths[ p ];
+                pxDeltaFields[ i ][ p + 1 ].xHandler = prvDeltaHandler;
+            }
+
+            /* As vShadowServiceInitInstance */
+            ( void ) memset( &( pxShadows[ i ] ), 0, sizeof( ShadowInstance_t ) );
+            pxShadows[ i ].pcName = ( i == 0 ) ? NULL : pcNames[ i ];
+            pxShadows[ i ].usNameLen = ( i == 0 ) ? 0 : ( uint16_t ) strlen( pcNames[ i ] );
+            pxShadows[ i ].pxDeltaFields = pxDeltaFields[ i ];
+            pxShadows[ i ].xNumDeltaFields = SIM_PROPS + 1;
+            vShadowReportedInit( &( pxShadows[ i ].xReported ), pxProps[ i ], SIM_PROPS, 250, 2000, 1000 );
+
+            for( uint32_t p = 0; p < SIM_PROPS; p++ )
+            {
+                ( void ) lShadowReportedAdd( &( pxShadows[ i ].xReported ), pxDeltaFields[ i ][ p + 1 ].pcPath + 6, 0, 0 );
+            }
+
+            pxShadows[ i ].usTopicUpdateLen = ( uint16_t ) xShadowTopicBuild( pcUpdateTopics[ i ], SIM_MAX_TOPIC, SIM_THING, strlen( SIM_THING ),
+                                                                              pxShadows[ i ].pcName, SHADOW_TOPIC_SUFFIX_UPDATE );
+
+            xServiceRam += sizeof( ShadowInstance_t ) + pxShadows[ i ].usTopicUpdateLen + 1 +
+                           SIM_PROPS * sizeof( ShadowProperty_t ) + ( SIM_PROPS + 1 ) * sizeof( JsonScanField_t );
+
+            /* A task per shadow holds its stack, TCB, document, context and five topics */
+            xTaskRam += SIM_TASK_STACK_BYTES + SIM_TCB_BYTES + SIM_TASK_DOC_BYTES + 64 +
+                        SIM_PROPS * sizeof( ShadowProperty_t ) + ( SIM_PROPS + 1 ) * sizeof( JsonScanField_t ) +
+                        pxShadows[ i ].usTopicUpdateLen + 1 + 3 * SIM_SUB_ENTRY_BYTES;
+
+            for( uint32_t t = 0; t < 3; t++ )
+            {
+                xTaskRam += xShadowTopicBuild( pcTopics[ 3 * i + t ], SIM_MAX_TOPIC, SIM_THING, strlen( SIM_THING ),
+                                               pxShadows[ i ].pcName, pcSuffixes[ t ] ) + 1;
+            }
+
+            xTaskRam += xShadowTopicBuild( pcScratch, SIM_MAX_TOPIC, SIM_THING, strlen( SIM_THING ),
+                                           pxShadows[ i ].pcName, "delete" ) + 1;
+        }
+
+        /* Service filters: the classic shadow's three, then three for every named shadow */
+        for( uint32_t t = 0; t < 3; t++ )
+        {
+            xServiceRam += xShadowTopicBuild( pcFilters[ xServiceSubs++ ], SIM_MAX_TOPIC, SIM_THING, strlen( SIM_THING ), NULL, pcSuffixes[ t ] ) + 1;
+        }
+
+        for( uint32_t t = 0; ( t < 3 ) && ( xNumShadows > 1 ); t++ )
+        {
+            xServiceRam += xShadowTopicBuild( pcFilters[ xServiceSubs++ ], SIM_MAX_TOPIC, SIM_THING, strlen( SIM_THING ), "+", pcSuffixes[ t ] ) + 1;
+        }
+
+        xServiceRam += xServiceSubs * SIM_SUB_ENTRY_BYTES;
+
+        dStart = prvNow();
+
+        for( long m = 0; m < lMessages; m++ )
+        {
+            prvRoute( pcTopics[ ( size_t ) m % ( 3 * xNumShadows ) ], pcDelta, xServiceSubs, xNumShadows, 1 );
+        }
+
+        dService = ( prvNow() - dStart ) * 1e9 / ( double ) lMessages;
+
+        /* The per shadow layout subscribes to every exact topic */
+        for( size_t f = 0; f < 3 * xNumShadows; f++ )
+        {
+            ( void ) memcpy( pcFilters[ f ], pcTopics[ f ], SIM_MAX_TOPIC );
+        }
+
+        dStart = prvNow();
+
+        for( long m = 0; m < lMessages; m++ )
+        {
+            prvRoute( pcTopics[ ( size_t ) m % ( 3 * xNumShadows ) ], pcDelta, xTaskSubs, xNumShadows, 0 );
+        }
+
+        dTasks = ( prvNow() - dStart ) * 1e9 / ( double ) lMessages;
+
+        printf( "%7zu | %8zu %5zu %9.0f | %8zu %4zu%s %9.0f\n",
+                xNumShadows, xServiceRam, xServiceSubs, dService,
+                xTaskRam, xTaskSubs, ( xTaskSubs > SIM_MAX_SUBSCRIPTIONS ) ? "!" : " ", dTasks );
+    }
+
+    printf( "! exceeds MQTT_AGENT_MAX_SUBSCRIPTIONS; handled %lu properties\n", ( unsigned long ) ulHandled );
+
+    return 0;
+}
@@ -0,0 +1,397 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+/*
+ * Host test of the windowed CPU usage sampler in Common/sys/task_stats.c.
+ *
+ * The test provides the kernel task list: every task has a fixed share of a
+ * 1 MHz run time counter, like TIM5 on the target, and a fixed context
+ * switch rate, so the counters the kernel reports are functions of the tick
+ * count. The counter starts just below 2^32 so the windows cross the point
+ * where a 32-bit counter would wrap. Interrupts which fired since the
+ * previous query are replayed through vTaskStatsIsrEnter / vTaskStatsIsrExit
+ * against the DWT cycle counter, as time only moves in vTaskDelay. Checks:
+ * 1. Window: ulTaskStatsSample reports the run time and switches of every
+ *    task over the window, sorted by decreasing run time, with tasks created
+ *    during the window counted from zero and deleted tasks left out.
+ * 2. Interrupts: invocation counts and cycles of each handler over the window.
+ * 3. Interval: ulTaskStatsInterval reports the run time since boot, then the
+ *    deltas since the previous call.
+ * 4. Limits: no more than ulMaxEntries entries are filled.
+ *
+ * Exits with a failure status if any check fails.
+ *
+ * Build and run from the repository root:
+ *   cc -O2 -Itools/host -ICommon/include tools/task_stats_test.c Common/sys/task_stats.c \
+ *      tools/host/host_kernel.c -lpthread -o task_stats_test
+ *   ./task_stats_test
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "hw_defs.h"
+#include "task_stats.h"
+
+#define TEST_RUN_TIME_HZ          1000000U
+#define TEST_RUN_TIME_PER_TICK    ( TEST_RUN_TIME_HZ / configTICK_RATE_HZ )
+#define TEST_RUN_TIME_AT_BOOT     4294800000ULL /* 2^32 wraps 167 ms after boot */
+#define TEST_CYCLES_PER_TICK      ( 160000000U / configTICK_RATE_HZ )
+#define TEST_WINDOW_MS            500U
+#define TEST_MAX_ENTRIES          16U
+
+typedef struct
+{
+    const char * pcName;
+    UBaseType_t uxNumber;
+    UBaseType_t uxPriority;
+    uint32_t ulPermille;       /* Share of the run time counter */
+    uint32_t ulSwitchesPerSec;
+    uint16_t usStackHighWater;
+    TickType_t xCreated;       /* Tick the task was created at */
+    TickType_t xDeleted;       /* Tick the task was deleted at, 0 while it runs */
+} TestTask_t;
+
+typedef struct
+{
+    uint32_t ulIrqNumber;
+    uint32_t ulPeriodTicks;
+    uint32_t ulCycles; /* Cycles spent in the handler per invocation */
+} TestIrq_t;
+
+static TestTask_t xTasks[] =
+{
+    { "IDLE",      1, 0, 550, 100,  120, 0, 0 },
+    { "sensors",   4, 4, 40,  20,   90,  0, 0 },
+    { "MQTTAgent", 2, 3, 250, 400,  310, 0, 0 },
+    { "net",       3, 5, 100, 1000, 205, 0, 0 },
+    { "late",      5, 2, 30,  60,   400, 0, 0 }, /* Created during the first window */
+    { "gone",      6, 2, 20,  40,   400, 0, 0 }  /* Deleted during the first window */
+};
+
+#define TEST_NUM_TASKS    ( sizeof( xTasks ) / sizeof( xTasks[ 0 ] ) )
+
+static const TestIrq_t xIrqs[] =
+{
+    { 45, 1,  160  },
+    { 61, 10, 3200 }
+};
+
+#define TEST_NUM_IRQS    ( sizeof( xIrqs ) / sizeof( xIrqs[ 0 ] ) )
+
+/* Last tick whose interrupts were replayed */
+static TickType_t xIrqsReplayed = 0;
+
+HostDwt_t xHostDwt;
+uint32_t SystemCoreClock = 160000000UL;
+
+static uint32_t ulFailures = 0;
+
+/*-----------------------------------------------------------*/
+
+static void prvCheck( bool xCondition,
+                      const char * pcWhat )
+{
+    if( !xCondition )
+    {
+        printf( "FAIL: %s\n", pcWhat );
+        ulFailures++;
+    }
+}
+
+void * pvPortMalloc( size_t xWantedSize )
+{
+    return malloc( xWantedSize );
+}
+
+void vPortFree( void * pv )
+{
+    free( pv );
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvTaskExists( const TestTask_t * pxTask,
+                           TickType_t xNow )
+{
+    return ( xNow >= pxTask->xCreated ) &&
+           ( ( pxTask->xDeleted == 0 ) || ( xNow < pxTask->xDeleted ) );
+}
+
+static uint64_t prvTotalRunTime( TickType_t xTick )
+{
+    return TEST_RUN_TIME_AT_BOOT + ( ( uint64_t ) xTick * TEST_RUN_TIME_PER_TICK );
+}
+
+static uint64_t prvTaskRunTime( const TestTask_t * pxTask,
+                                TickType_t xNow )
+{
+    uint64_t ullElapsed = prvTotalRunTime( xNow ) - prvTotalRunTime( pxTask->xCreated );
+
+    /* Tasks which existed at boot own their share of the counter since it started */
+    if( pxTask->xCreated == 0 )
+    {
+        ullElapsed = prvTotalRunTime( xNow );
+    }
+
+    return ( ullElapsed * pxTask->ulPermille ) / 1000U;
+}
+
+static uint32_t prvTaskSwitches( const TestTask_t * pxTask,
+                                 TickType_t xNow )
+{
+    return ( uint32_t ) ( ( ( uint64_t ) ( xNow - pxTask->xCreated ) * pxTask->ulSwitchesPerSec ) / configTICK_RATE_HZ );
+}
+
+/* Run the handlers of every tick since the previous call, one tick of cycles apart */
+static void prvReplayInterrupts( void )
+{
+    TickType_t xNow = xTaskGetTickCount();
+
+    while( xIrqsReplayed != xNow )
+    {
+        uint32_t ulTickStart = xHostDwt.CYCCNT;
+
+        xIrqsReplayed++;
+
+        for( size_t i = 0; i < TEST_NUM_IRQS; i++ )
+        {
+            if( ( xIrqsReplayed % xIrqs[ i ].ulPeriodTicks ) == 0 )
+            {
+                vTaskStatsIsrEnter( xIrqs[ i ].ulIrqNumber );
+                xHostDwt.CYCCNT += xIrqs[ i ].ulCycles;
+                vTaskStatsIsrExit( xIrqs[ i ].ulIrqNumber );
+            }
+        }
+
+        xHostDwt.CYCCNT = ulTickStart + TEST_CYCLES_PER_TICK;
+    }
+}
+
+UBaseType_t uxTaskGetNumberOfTasks( void )
+{
+    TickType_t xNow = xTaskGetTickCount();
+    UBaseType_t uxNumTasks = 0;
+
+    for( size_t i = 0; i < TEST_NUM_TASKS; i++ )
+    {
+        uxNumTasks += prvTaskExists( &( xTasks[ i ] ), xNow ) ? 1 : 0;
+    }
+
+    return uxNumTasks;
+}
+
+UBaseType_t uxTaskGetSystemState( TaskStatus_t * const pxTaskStatusArray,
+                                  const UBaseType_t uxArraySize,
+                                  configRUN_TIME_COUNTER_TYPE * const pulTotalRunTime )
+{
+    TickType_t xNow = xTaskGetTickCount();
+    UBaseType_t uxNumTasks = 0;
+
+    prvReplayInterrupts();
+
+    if( uxArraySize >= uxTaskGetNumberOfTasks() )
+    {
+        for( size_t i = 0; i < TEST_NUM_TASKS; i++ )
+        {
+            const TestTask_t * pxTask = &( xTasks[ i ] );
+
+            if( prvTaskExists( pxTask, xNow ) )
+            {
+                TaskStatus_t * pxStatus = &( pxTaskStatusArray[ uxNumTasks ] );
+
+                ( void ) memset( pxStatus, 0, sizeof( TaskStatus_t ) );
+                pxStatus->xHandle = ( TaskHandle_t ) pxTask;
+                pxStatus->pcTaskName = pxTask->pcName;
+                pxStatus->xTaskNumber = pxTask->uxNumber;
+                pxStatus->eCurrentState = ( pxTask->uxNumber == 1 ) ? eReady : eBlocked;
+                pxStatus->uxCurrentPriority = pxTask->uxPriority;
+                pxStatus->uxBasePriority = pxTask->uxPriority;
+                pxStatus->ulRunTimeCounter = prvTaskRunTime( pxTask, xNow );
+                pxStatus->usStackHighWaterMark = pxTask->usStackHighWater;
+                uxNumTasks++;
+            }
+        }
+
+        if( pulTotalRunTime != NULL )
+        {
+            *pulTotalRunTime = prvTotalRunTime( xNow );
+        }
+    }
+
+    return uxNumTasks;
+}
+
+void * pvTaskGetThreadLocalStoragePointer( TaskHandle_t xTaskToQuery,
+                                           BaseType_t xIndex )
+{
+    configASSERT( xIndex == TASK_STATS_TLS_INDEX );
+
+    return ( void * ) ( uintptr_t ) prvTaskSwitches( ( const TestTask_t * ) xTaskToQuery, xTaskGetTickCount() );
+}
+
+/*-----------------------------------------------------------*/
+
+static const TaskStatsEntry_t * prvFindEntry( const TaskStatsEntry_t * pxEntries,
+                                              uint32_t ulNumEntries,
+                                              UBaseType_t uxNumber )
+{
+    const TaskStatsEntry_t * pxEntry = NULL;
+
+    for( uint32_t i = 0; i < ulNumEntries; i++ )
+    {
+        if( pxEntries[ i ].ulTaskNumber == uxNumber )
+        {
+            pxEntry = &( pxEntries[ i ] );
+        }
+    }
+
+    return pxEntry;
+}
+
+static void prvTestSample( void )
+{
+    TaskStatsEntry_t pxEntries[ TEST_MAX_ENTRIES ];
+    TaskStatsSummary_t xSummary;
+    TickType_t xStart = xTaskGetTickCount();
+    uint32_t ulNumEntries;
+    bool xSorted = true;
+    bool xCounted = true;
+
+    xTasks[ 4 ].xCreated = xStart + ( TEST_WINDOW_MS / 2 );
+    xTasks[ 5 ].xDeleted = xStart + ( TEST_WINDOW_MS / 2 );
+    prvReplayInterrupts();
+
+    ulNumEntries = ulTaskStatsSample( TEST_WINDOW_MS, pxEntries, TEST_MAX_ENTRIES, &xSummary );
+
+    prvCheck( ( prvTotalRunTime( xStart ) < ( 1ULL << 32 ) ) &&
+              ( prvTotalRunTime( xStart + TEST_WINDOW_MS ) > ( 1ULL << 32 ) ), "window crosses 2^32" );
+    prvCheck( ulNumEntries == TEST_NUM_TASKS - 1, "one entry per task at the end of the window" );
+    prvCheck( xSummary.ulWindowTicks == TEST_WINDOW_MS, "window ticks" );
+    prvCheck( xSummary.ulWindowRunTime == TEST_WINDOW_MS * TEST_RUN_TIME_PER_TICK, "window run time" );
+    prvCheck( xSummary.ulCycleHz == SystemCoreClock, "cycle counter frequency" );
+    prvCheck( prvFindEntry( pxEntries, ulNumEntries, xTasks[ 5 ].uxNumber ) == NULL, "deleted task left out" );
+
+    for( uint32_t i = 1; i < ulNumEntries; i++ )
+    {
+        xSorted &= ( pxEntries[ i - 1 ].ulRunTime >= pxEntries[ i ].ulRunTime );
+    }
+
+    prvCheck( xSorted, "sorted by decreasing run time" );
+
+    for( size_t i = 0; i < TEST_NUM_TASKS - 1; i++ )
+    {
+        const TaskStatsEntry_t * pxEntry = prvFindEntry( pxEntries, ulNumEntries, xTasks[ i ].uxNumber );
+        TickType_t xFrom = ( xTasks[ i ].xCreated > xStart ) ? xTasks[ i ].xCreated : xStart;
+        uint32_t ulRunTime = ( uint32_t ) ( ( ( uint64_t ) ( xStart + TEST_WINDOW_MS - xFrom ) * TEST_RUN_TIME_PER_TICK * xTasks[ i ].ulPermille ) / 1000U );
+        uint32_t ulSwitches = ( ( xStart + TEST_WINDOW_MS - xFrom ) * xTasks[ i ].ulSwitchesPerSec ) / configTICK_RATE_HZ;
+
+        xCounted &= ( pxEntry != NULL ) &&
+                    ( strcmp( pxEntry->pcTaskName, xTasks[ i ].pcName ) == 0 ) &&
+                    ( pxEntry->ulRunTime == ulRunTime ) &&
+                    ( pxEntry->ulSwitches == ulSwitches ) &&
+                    ( pxEntry->usStackHighWaterMark == xTasks[ i ].usStackHighWater ) &&
+                    ( pxEntry->ucPriority == xTasks[ i ].uxPriority );
+    }
+
+    prvCheck( xCounted, "run time and switches of every task over the window" );
+
+    prvCheck( xSummary.ulNumIsrs == TEST_NUM_IRQS, "one entry per interrupt handler" );
+
+    for( size_t i = 0; ( i < TEST_NUM_IRQS ) && ( i < xSummary.ulNumIsrs ); i++ )
+    {
+        uint32_t ulCount = TEST_WINDOW_MS / xIrqs[ i ].ulPeriodTicks;
+
+        prvCheck( ( xSummary.xIsrs[ i ].ulIrqNumber == xIrqs[ i ].ulIrqNumber ) &&
+                  ( xSummary.xIsrs[ i ].ulCount == ulCount ) &&
+                  ( xSummary.xIsrs[ i ].ulCycles == ulCount * xIrqs[ i ].ulCycles ), "interrupt counts and cycles over the window" );
+    }
+}
+
+static void prvTestInterval( void )
+{
+    TaskStatsEntry_t pxEntries[ TEST_MAX_ENTRIES ];
+    TaskStatsInterval_t xInterval;
+    TickType_t xNow = xTaskGetTickCount();
+    uint32_t ulWindowRunTime = 0;
+    uint32_t ulNumEntries;
+    const TaskStatsEntry_t * pxIdle;
+
+    ( void ) memset( &xInterval, 0, sizeof( xInterval ) );
+
+    ulNumEntries = ulTaskStatsInterval( &xInterval, pxEntries, TEST_MAX_ENTRIES, &ulWindowRunTime );
+    pxIdle = prvFindEntry( pxEntries, ulNumEntries, 1 );
+
+    prvCheck( ulWindowRunTime == ( uint32_t ) prvTotalRunTime( xNow ), "first interval starts at boot" );
+    prvCheck( ( pxIdle != NULL ) && ( pxIdle->ulRunTime == ( uint32_t ) prvTaskRunTime( &( xTasks[ 0 ] ), xNow ) ), "idle run time since boot" );
+
+    vTaskDelay( pdMS_TO_TICKS( 1000 ) );
+
+    ulNumEntries = ulTaskStatsInterval( &xInterval, pxEntries, TEST_MAX_ENTRIES, &ulWindowRunTime );
+    prvCheck( ulWindowRunTime == TEST_RUN_TIME_HZ, "interval run time" );
+    prvCheck( ulNumEntries == TEST_NUM_TASKS - 1, "one entry per task" );
+
+    for( uint32_t i = 0; i < ulNumEntries; i++ )
+    {
+        const TestTask_t * pxTask = NULL;
+
+        for( size_t j = 0; j < TEST_NUM_TASKS; j++ )
+        {
+            pxTask = ( xTasks[ j ].uxNumber == pxEntries[ i ].ulTaskNumber ) ? &( xTasks[ j ] ) : pxTask;
+        }
+
+        prvCheck( ( pxTask != NULL ) &&
+                  ( pxEntries[ i ].ulRunTime == pxTask->ulPermille * ( TEST_RUN_TIME_HZ / 1000U ) ) &&
+                  ( pxEntries[ i ].ulSwitches == pxTask->ulSwitchesPerSec ), "interval deltas" );
+    }
+}
+
+static void prvTestLimits( void )
+{
+    TaskStatsEntry_t pxEntries[ 2 ];
+    TaskStatsSummary_t xSummary;
+
+    prvCheck( ulTaskStatsSample( 10, pxEntries, 2, &xSummary ) == 2, "entries limited to ulMaxEntries" );
+}
+
+/*-----------------------------------------------------------*/
+
+int main( void )
+{
+    /* Start between boot and the 32-bit wrap */
+    vTaskDelay( pdMS_TO_TICKS( 100 ) );
+
+    prvTestSample();
+    prvTestInterval();
+    prvTestLimits();
+
+    printf( "%s (%lu failures)\n", ( ulFailures == 0 ) ? "PASS" : "FAIL", ( unsigned long ) ulFailures );
+
+    return ( ulFailures == 0 ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,480 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+/*
+ * Host benchmark of the sensor telemetry encodings.
+ *
+ * Encodes the same readings as JSON and as CBOR with the formatters the
+ * publishing tasks use, and reports per payload the bytes per message, the
+ * samples it carries, the bytes per sample and the encode time:
+ *
+ * 1. env: one reading of the four channels. JSON is the format string of
+ *    prvFormatJson in env_sensor_publish.c, CBOR a keyframe and an update
+ *    carrying every channel, quantized and delta coded as the task does.
+ * 2. motion summary: the statistics of a one second window of 104 samples,
+ *    prvFormatSummary against prvFormatSummaryCbor. The aggregation itself
+ *    is common to both and not timed.
+ * 3. motion raw: a batch of MOTION_MAX_RAW_SAMPLES samples, prvFormatRaw
+ *    against prvFormatRawCbor.
+ *
+ * The motion formatters are static to motion_sensors_publish.c, which is
+ * built into this file; its task is linked in but never started. Every
+ * encode must succeed and every CBOR payload must be smaller than its JSON
+ * equivalent. The schema message, sent once per connection, is reported
+ * separately.
+ *
+ * Exits with a failure status if any check fails.
+ *
+ * Build and run from the repository root, with the tinycbor submodule:
+ *   cc -O2 -Itools/host -ICommon/include -ICommon/cli -ICommon/app/mqtt -ICommon/config -ICommon/kvstore \
+ *      -IMiddleware/tinycbor/src tools/telemetry_cbor_bench.c Common/app/sensor_aggregate.c \
+ *      Common/app/telemetry_cbor.c Common/app/telemetry_delta.c \
+ *      Middleware/tinycbor/src/cborencoder.c Middleware/tinycbor/src/cborencoder_close_container_checked.c \
+ *      tools/host/host_kernel.c -lpthread -lm -o telemetry_cbor_bench
+ *   ./telemetry_cbor_bench [iterations]
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../Common/app/motion_sensors_publish.c"
+
+#define BENCH_ITERATIONS        20000U
+#define BENCH_READINGS          64U
+#define BENCH_ENV_CHANNELS      4U
+#define BENCH_WINDOW_SAMPLES    104U
+#define BENCH_MAX_LEN           MQTT_PUBLISH_MAX_LEN
+
+typedef struct
+{
+    float fTemperature0;
+    float fHumidity;
+    float fTemperature1;
+    float fBarometricPressure;
+} BenchEnvData_t;
+
+/* The keyframe layout of env_sensor_publish.c */
+static const TelemetryField_t xBenchEnvFields[ BENCH_ENV_CHANNELS + 1 ] =
+{
+    { "seq",       TELEMETRY_FIELD_FIXED, 0  },
+    { "temp_0_c",  TELEMETRY_FIELD_FIXED, -2 },
+    { "rh_pct",    TELEMETRY_FIELD_FIXED, -1 },
+    { "temp_1_c",  TELEMETRY_FIELD_FIXED, -2 },
+    { "baro_mbar", TELEMETRY_FIELD_FIXED, -2 },
+};
+
+static const TelemetrySchema_t xBenchEnvSchema =
+{
+    .usId         = 1,
+    .usRepeatFrom = sizeof( xBenchEnvFields ) / sizeof( xBenchEnvFields[ 0 ] ),
+    .ulNumFields  = sizeof( xBenchEnvFields ) / sizeof( xBenchEnvFields[ 0 ] ),
+    .pxFields     = xBenchEnvFields,
+    .ulNumGroups  = 0,
+    .ppcGroups    = NULL,
+};
+
+static BenchEnvData_t xEnvReadings[ BENCH_READINGS ];
+static SensorAggWindow_t xWindows[ BENCH_READINGS ];
+static int32_t plMotionSamples[ BENCH_READINGS ][ MOTION_MAX_RAW_SAMPLES ][ MOTION_NUM_AXES ];
+static uint8_t pucBenchBuf[ BENCH_MAX_LEN ];
+static uint32_t ulBenchSeed = 1U;
+static uint32_t ulFailures = 0;
+
+/*-----------------------------------------------------------*/
+
+/* motion_sensors_publish.c is linked in for its formatters, its task never runs */
+
+size_t KVStore_getString( KVStoreKey_t key,
+                          char * pvBuffer,
+                          size_t xMaxLength )
+{
+    ( void ) key;
+    ( void ) pvBuffer;
+    ( void ) xMaxLength;
+
+    return 0;
+}
+
+char * KVStore_getStringHeap( KVStoreKey_t key,
+                              size_t * pxLength )
+{
+    ( void ) key;
+    ( void ) pxLength;
+
+    return NULL;
+}
+
+uint32_t KVStore_getUInt32( KVStoreKey_t key,
+                            BaseType_t * pxSuccess )
+{
+    ( void ) key;
+    ( void ) pxSuccess;
+
+    return 0;
+}
+
+SensorRing_t * pxSensorRingCreate( uint32_t ulLength )
+{
+    ( void ) ulLength;
+
+    return NULL;
+}
+
+BaseType_t xSensorSchedEnable( SensorId_t xSensor,
+                               float fRateHz,
+                               SensorRing_t * pxRing )
+{
+    ( void ) xSensor;
+    ( void ) fRateHz;
+    ( void ) pxRing;
+
+    return pdFALSE;
+}
+
+BaseType_t xSensorRingWait( TickType_t xTimeout )
+{
+    ( void ) xTimeout;
+
+    return pdFALSE;
+}
+
+BaseType_t xSensorRingPop( SensorRing_t * pxRing,
+                           SensorSample_t * pxSample )
+{
+    ( void ) pxRing;
+    ( void ) pxSample;
+
+    return pdFALSE;
+}
+
+void vSensorRingFlush( SensorRing_t * pxRing )
+{
+    ( void ) pxRing;
+}
+
+BaseType_t xSensorReplayActive( SensorReplaySourceId_t xSource )
+{
+    ( void ) xSource;
+
+    return pdFALSE;
+}
+
+TickType_t xSensorReplayPeriod( SensorReplaySourceId_t xSource )
+{
+    ( void ) xSource;
+
+    return 0;
+}
+
+uint32_t ulSensorReplayRead( SensorReplaySourceId_t xSource,
+                             float pfSamples[][ SENSOR_REPLAY_MAX_CHANNELS ],
+                             uint32_t ulMaxSamples )
+{
+    ( void ) xSource;
+    ( void ) pfSamples;
+    ( void ) ulMaxSamples;
+
+    return 0;
+}
+
+void vSensorReplayRecordPublish( SensorReplaySourceId_t xSource,
+                                 BaseType_t xPublished,
+                                 size_t xBytes )
+{
+    ( void ) xSource;
+    ( void ) xPublished;
+    ( void ) xBytes;
+}
+
+MQTTAgentHandle_t xGetMqttAgentHandle( void )
+{
+    return NULL;
+}
+
+bool xIsMqttAgentConnected( void )
+{
+    return false;
+}
+
+void vMqttAgentRecordPublishLatency( uint32_t ulLatencyMs )
+{
+    ( void ) ulLatencyMs;
+}
+
+MQTTStatus_t MQTTAgent_Publish( const MQTTAgentContext_t * pMqttAgentContext,
+                                MQTTPublishInfo_t * pPublishInfo,
+                                const MQTTAgentCommandInfo_t * pCommandInfo )
+{
+    ( void ) pMqttAgentContext;
+    ( void ) pPublishInfo;
+    ( void ) pCommandInfo;
+
+    return MQTTSendFailed;
+}
+
+void * pvPortMalloc( size_t xSize )
+{
+    return malloc( xSize );
+}
+
+void vPortFree( void * pv )
+{
+    free( pv );
+}
+
+/*-----------------------------------------------------------*/
+
+static double prvNowUs( void )
+{
+    struct timespec xNow;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &xNow );
+
+    return ( ( double ) xNow.tv_sec * 1e6 ) + ( ( double ) xNow.tv_nsec / 1e3 );
+}
+
+static uint32_t prvRand( void )
+{
+    ulBenchSeed = ( ulBenchSeed * 1103515245U ) + 12345U;
+
+    return ( ulBenchSeed >> 8 ) & 0xFFFFFFU;
+}
+
+/* Uniform in [ -lRange, lRange ] */
+static int32_t prvRandRange( int32_t lRange )
+{
+    return ( int32_t ) ( prvRand() % ( ( uint32_t ) ( 2 * lRange ) + 1U ) ) - lRange;
+}
+
+static void prvCheck( bool xCondition,
+                      const char * pcWhat )
+{
+    if( !xCondition )
+    {
+        printf( "FAIL: %s\n", pcWhat );
+        ulFailures++;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/* Readings in the ranges of the board's sensors, as the replay generator makes them */
+static void prvFillReadings( void )
+{
+    for( uint32_t r = 0; r < BENCH_READINGS; r++ )
+    {
+        int32_t plSample[ MOTION_NUM_AXES ];
+
+        xEnvReadings[ r ].fTemperature0 = 22.0f + ( ( float ) prvRandRange( 500 ) / 100.0f );
+        xEnvReadings[ r ].fHumidity = 45.0f + ( ( float ) prvRandRange( 150 ) / 10.0f );
+        xEnvReadings[ r ].fTemperature1 = xEnvReadings[ r ].fTemperature0 + ( ( float ) prvRandRange( 50 ) / 100.0f );
+        xEnvReadings[ r ].fBarometricPressure = 1013.25f + ( ( float ) prvRandRange( 2000 ) / 100.0f );
+
+        vSensorAggInit( &( xWindows[ r ] ), MOTION_NUM_AXES );
+
+        for( uint32_t i = 0; i < BENCH_WINDOW_SAMPLES; i++ )
+        {
+            for( uint32_t ulAxis = 0; ulAxis < MOTION_NUM_AXES; ulAxis++ )
+            {
+                /* Accelerometer around 1 g on z, gyroscope at rest, magnetometer */
+                plSample[ ulAxis ] = ( ulAxis < 3 ) ? ( ( ulAxis == 2 ) ? 1000 : 0 ) + prvRandRange( 50 ) :
+                                     ( ulAxis < 6 ) ? prvRandRange( 700 ) :
+                                     -300 + prvRandRange( 200 );
+
+                if( i < MOTION_MAX_RAW_SAMPLES )
+                {
+                    plMotionSamples[ r ][ i ][ ulAxis ] = plSample[ ulAxis ];
+                }
+            }
+
+            vSensorAggAddSample( &( xWindows[ r ] ), plSample );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static size_t prvEnvJson( uint32_t r )
+{
+    const BenchEnvData_t * pxData = &( xEnvReadings[ r ] );
+    int lLen = snprintf( ( char * ) pucBenchBuf,
+                         BENCH_MAX_LEN,
+                         "{ \"temp_0_c\": %f, \"rh_pct\": %f, \"temp_1_c\": %f, \"baro_mbar\": %f }",
+                         pxData->fTemperature0,
+                         pxData->fHumidity,
+                         pxData->fTemperature1,
+                         pxData->fBarometricPressure );
+
+    return ( ( lLen > 0 ) && ( ( size_t ) lLen < BENCH_MAX_LEN ) ) ? ( size_t ) lLen : 0;
+}
+
+/* Quantize, delta code and encode one reading as the env task does */
+static size_t prvEnvCbor( uint32_t r,
+                          TelemetryDeltaAction_t xForce )
+{
+    static TelemetryDelta_t xDelta;
+    const BenchEnvData_t * pxData = &( xEnvReadings[ r ] );
+    const float pfValues[ BENCH_ENV_CHANNELS ] =
+    {
+        pxData->fTemperature0,
+        pxData->fHumidity,
+        pxData->fTemperature1,
+        pxData->fBarometricPressure
+    };
+    int64_t pllValues[ BENCH_ENV_CHANNELS ];
+    TelemetryDeltaAction_t xAction;
+
+    if( ( xDelta.ulNumChannels == 0 ) || ( xForce == TELEMETRY_DELTA_KEYFRAME ) )
+    {
+        /* No dead band, so every reading that changes is an update */
+        vTelemetryDeltaInit( &xDelta, BENCH_ENV_CHANNELS, NULL, 0xFFFFFFFFU );
+    }
+
+    for( uint32_t i = 0; i < BENCH_ENV_CHANNELS; i++ )
+    {
+        pllValues[ i ] = llTelemetryQuantize( pfValues[ i ], xBenchEnvFields[ i + 1 ].cExponent );
+    }
+
+    xAction = xTelemetryDeltaUpdate( &xDelta, pllValues );
+
+    return ( xAction == xForce ) ?
+           xTelemetryEncodeDelta( &xBenchEnvSchema, &xDelta, xAction, pucBenchBuf, BENCH_MAX_LEN ) : 0;
+}
+
+static size_t prvEnvJsonBench( uint32_t r )
+{
+    return prvEnvJson( r );
+}
+
+static size_t prvEnvKeyframeBench( uint32_t r )
+{
+    return prvEnvCbor( r, TELEMETRY_DELTA_KEYFRAME );
+}
+
+static size_t prvEnvUpdateBench( uint32_t r )
+{
+    return prvEnvCbor( r, TELEMETRY_DELTA_UPDATE );
+}
+
+static size_t prvSummaryJsonBench( uint32_t r )
+{
+    return prvFormatSummary( ( char * ) pucBenchBuf, BENCH_MAX_LEN, &( xWindows[ r ] ), 1000U );
+}
+
+static size_t prvSummaryCborBench( uint32_t r )
+{
+    return prvFormatSummaryCbor( pucBenchBuf, BENCH_MAX_LEN, &( xWindows[ r ] ), 1000U );
+}
+
+static size_t prvRawJsonBench( uint32_t r )
+{
+    return prvFormatRaw( ( char * ) pucBenchBuf, BENCH_MAX_LEN, plMotionSamples[ r ], MOTION_MAX_RAW_SAMPLES, 80U );
+}
+
+static size_t prvRawCborBench( uint32_t r )
+{
+    return prvFormatRawCbor( pucBenchBuf, BENCH_MAX_LEN, plMotionSamples[ r ], MOTION_MAX_RAW_SAMPLES, 80U );
+}
+
+/*-----------------------------------------------------------*/
+
+/* Returns the mean bytes per message */
+static double prvBench( const char * pcPayload,
+                        const char * pcFormat,
+                        size_t ( * pxEncode )( uint32_t ),
+                        uint32_t ulSamplesPerMsg,
+                        uint32_t ulIterations )
+{
+    uint64_t ullBytes = 0;
+    uint32_t ulEmpty = 0;
+    double dStartUs;
+    double dElapsedUs;
+
+    /* Sizes first, on a pass that also warms the caches */
+    for( uint32_t r = 0; r < BENCH_READINGS; r++ )
+    {
+        size_t xLen = pxEncode( r );
+
+        ullBytes += xLen;
+        ulEmpty += ( xLen == 0 ) ? 1U : 0U;
+    }
+
+    dStartUs = prvNowUs();
+
+    for( uint32_t i = 0; i < ulIterations; i++ )
+    {
+        ulEmpty += ( pxEncode( i % BENCH_READINGS ) == 0 ) ? 1U : 0U;
+    }
+
+    dElapsedUs = prvNowUs() - dStartUs;
+
+    printf( "%-16s %-13s %8.1f %8lu %8.2f %10.0f\n", pcPayload, pcFormat,
+            ( double ) ullBytes / BENCH_READINGS, ( unsigned long ) ulSamplesPerMsg,
+            ( double ) ullBytes / ( ( double ) BENCH_READINGS * ulSamplesPerMsg ),
+            ( dElapsedUs * 1000.0 ) / ulIterations );
+
+    prvCheck( ulEmpty == 0, "every encode succeeds" );
+
+    return ( double ) ullBytes / BENCH_READINGS;
+}
+
+int main( int argc,
+          char ** argv )
+{
+    uint32_t ulIterations = ( argc > 1 ) ? ( uint32_t ) strtoul( argv[ 1 ], NULL, 10 ) : BENCH_ITERATIONS;
+    double dJson;
+    double dCbor;
+
+    ulIterations = ( ulIterations > 0 ) ? ulIterations : BENCH_ITERATIONS;
+
+    prvFillReadings();
+
+    printf( "%-16s %-13s %8s %8s %8s %10s\n", "payload", "format", "bytes", "samples", "B/sample", "ns/encode" );
+
+    dJson = prvBench( "env", "json", prvEnvJsonBench, 1U, ulIterations );
+    dCbor = prvBench( "env", "cbor keyframe", prvEnvKeyframeBench, 1U, ulIterations );
+    prvCheck( dCbor < dJson, "env keyframe smaller than JSON" );
+    dCbor = prvBench( "env", "cbor update", prvEnvUpdateBench, 1U, ulIterations );
+    prvCheck( dCbor < dJson, "env update smaller than JSON" );
+
+    dJson = prvBench( "motion summary", "json", prvSummaryJsonBench, BENCH_WINDOW_SAMPLES, ulIterations );
+    dCbor = prvBench( "motion summary", "cbor", prvSummaryCborBench, BENCH_WINDOW_SAMPLES, ulIterations );
+    prvCheck( dCbor < dJson, "motion summary smaller than JSON" );
+
+    dJson = prvBench( "motion raw", "json", prvRawJsonBench, MOTION_MAX_RAW_SAMPLES, ulIterations );
+    dCbor = prvBench( "motion raw", "cbor", prvRawCborBench, MOTION_MAX_RAW_SAMPLES, ulIterations );
+    prvCheck( dCbor < dJson, "motion raw smaller than JSON" );
+
+    printf( "schema           env %lu, motion summary %lu, motion raw %lu bytes, once per connection\n",
+            ( unsigned long ) xTelemetryEncodeSchema( &xBenchEnvSchema, pucBenchBuf, BENCH_MAX_LEN ),
+            ( unsigned long ) xTelemetryEncodeSchema( &xSummarySchema, pucBenchBuf, BENCH_MAX_LEN ),
+            ( unsigned long ) xTelemetryEncodeSchema( &xRawSchema, pucBenchBuf, BENCH_MAX_LEN ) );
+
+    printf( "%s (%lu failures)\n", ( ulFailures == 0 ) ? "PASS" : "FAIL", ( unsigned long ) ulFailures );
+
+    return ( ulFailures == 0 ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,240 @@
+#!python
+#  FreeRTOS STM32 Reference Integration
+#
+#  Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+#
+#  Permission is hereby granted, free of charge, to any person obtaining a copy of
+#  this software and associated documentation files (the "Software"), to deal in
+#  the Software without restriction, including without limitation the rights to
+#  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+#  the Software, and to permit persons to whom the Software is furnished to do so,
+#  subject to the following conditions:
+#
+#  The above copyright notice and this permission notice shall be included in all
+#  copies or substantial portions of the Software.
+#
+#  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+#  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+#  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+#  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+#  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+#  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#
+#  https://www.FreeRTOS.org
+#  https://github.com/FreeRTOS
+
+"""Decode CBOR sensor telemetry records using their published schema.
+
+The schema is the payload published on "<topic>/schema" and each record a
+payload published on "<topic>" while the topic is configured for CBOR
+(motion_pub_format / env_pub_format set to 1). Decoded records are printed as
+JSON. With --sizes the encoded size of each record is compared against the
+same record as compact JSON.
+
+Keyframe and delta records (env_sensor_data) are reconstructed in order: a
+delta record is applied to the previous record only if its sequence number
+follows on, otherwise it is reported and skipped until the next keyframe.
+"""
+
+import json
+import struct
+import sys
+from argparse import ArgumentParser
+
+FIELD_FIXED = 0
+FIELD_HALF = 1
+DELTA_ID_FLAG = 0x8000
+
+
+class CborDecoder:
+    """Minimal CBOR decoder covering the subset emitted by telemetry_cbor.c."""
+
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def _read(self, length):
+        if self.pos + length > len(self.data):
+            raise ValueError("truncated CBOR item")
+        chunk = self.data[self.pos : self.pos + length]
+        self.pos += length
+        return chunk
+
+    def _argument(self, info):
+        if info < 24:
+            return info
+        if info == 31:
+            return None
+        sizes = {24: ">B", 25: ">H", 26: ">I", 27: ">Q"}
+        if info not in sizes:
+            raise ValueError("invalid additional info {}".format(info))
+        fmt = sizes[info]
+        return struct.unpack(fmt, self._read(struct.calcsize(fmt)))[0]
+
+    def _items(self, count):
+        if count is not None:
+            return [self.decode() for _ in range(count)]
+        items = []
+        while self.data[self.pos] != 0xFF:
+            items.append(self.decode())
+        self.pos += 1
+        return items
+
+    def decode(self):
+        initial = self._read(1)[0]
+        major = initial >> 5
+        info = initial & 0x1F
+
+        if major == 7:
+            if info == 25:
+                return struct.unpack(">e", self._read(2))[0]
+            if info == 26:
+                return struct.unpack(">f", self._read(4))[0]
+            if info == 27:
+                return struct.unpack(">d", self._read(8))[0]
+            return {20: False, 21: True, 22: None}.get(info)
+
+        arg = self._argument(info)
+
+        if major == 0:
+            return arg
+        if major == 1:
+            return -1 - arg
+        if major in (2, 3):
+            if arg is None:
+                raise ValueError("indefinite length strings are not supported")
+            raw = self._read(arg)
+            return raw.decode("utf-8") if major == 3 else raw
+        if major == 4:
+            return self._items(arg)
+        if major == 5:
+            pairs = self._items(None if arg is None else arg * 2)
+            return dict(zip(pairs[0::2], pairs[1::2]))
+        # Tags carry no meaning for telemetry, return the tagged item
+        return self.decode()
+
+
+def decode_cbor(data):
+    decoder = CborDecoder(data)
+    item = decoder.decode()
+    if decoder.pos != len(data):
+        raise ValueError("{} trailing bytes".format(len(data) - decoder.pos))
+    return item
+
+
+def field_value(field, value):
+    _, field_type, exponent = field
+    if field_type == FIELD_FIXED and exponent != 0:
+        return round(value * (10 ** exponent), -exponent if exponent < 0 else 0)
+    return value
+
+
+def decode_record(schema, record):
+    """Map the values of one record onto the field names of its schema."""
+    if not isinstance(record, list) or not record or record[0] != schema["id"]:
+        raise ValueError("record does not match schema {}".format(schema["id"]))
+
+    fields = schema["f"]
+    repeat_from = schema["rpt"]
+    values = record[1:]
+    decoded = {}
+
+    for field, value in zip(fields[:repeat_from], values):
+        decoded[field[0]] = field_value(field, value)
+
+    repeated = fields[repeat_from:]
+    if repeated:
+        rest = values[repeat_from:]
+        groups = [
+            {
+                field[0]: field_value(field, value)
+                for field, value in zip(repeated, rest[i : i + len(repeated)])
+            }
+            for i in range(0, len(rest), len(repeated))
+        ]
+        labels = schema.get("g")
+        if labels:
+            for label, group in zip(labels, groups):
+                decoded[label] = group
+        else:
+            decoded["records"] = groups
+
+    return decoded
+
+
+class DeltaState:
+    """Receiver side of telemetry_delta: rebuilds full records from deltas."""
+
+    def __init__(self):
+        self.seq = None
+        self.values = None
+
+    def apply(self, schema, record):
+        """Return the full record for a keyframe or delta record, or None."""
+        if record[0] == schema["id"]:
+            self.seq = record[1]
+            self.values = list(record[2:])
+            return record
+
+        if record[0] != schema["id"] | DELTA_ID_FLAG:
+            raise ValueError("record does not match schema {}".format(schema["id"]))
+
+        seq, mask, deltas = record[1], record[2], iter(record[3:])
+        if self.values is None or seq != self.seq + 1:
+            self.seq = None
+            self.values = None
+            return None
+
+        for channel in range(len(self.values)):
+            if mask & (1 << channel):
+                self.values[channel] += next(deltas)
+
+        self.seq = seq
+        return [schema["id"], seq] + self.values
+
+
+def main():
+    argparser = ArgumentParser(description=__doc__.splitlines()[0])
+    argparser.add_argument("schema", help="Binary schema payload")
+    argparser.add_argument("records", nargs="+", help="Binary record payloads")
+    argparser.add_argument(
+        "--sizes",
+        action="store_true",
+        help="Compare the CBOR record size against compact JSON",
+    )
+    args = argparser.parse_args()
+
+    with open(args.schema, "rb") as schema_file:
+        schema = decode_cbor(schema_file.read())
+
+    delta = DeltaState()
+
+    for path in args.records:
+        with open(path, "rb") as record_file:
+            data = record_file.read()
+
+        record = decode_cbor(data)
+        if isinstance(record, list) and record and record[0] & DELTA_ID_FLAG:
+            record = delta.apply(schema, record)
+            if record is None:
+                print("# {}: out of sequence delta, waiting for a keyframe".format(path), file=sys.stderr)
+                continue
+        elif schema["f"] and schema["f"][0][0] == "seq":
+            delta.apply(schema, record)
+
+        decoded = decode_record(schema, record)
+        print(json.dumps(decoded))
+
+        if args.sizes:
+            json_len = len(json.dumps(decoded, separators=(",", ":")))
+            samples = decoded.get("samples", 1) or 1
+            print(
+                "# {}: cbor {} bytes, json {} bytes, {:.1f} / {:.1f} bytes per sample".format(
+                    path, len(data), json_len, len(data) / samples, json_len / samples
+                ),
+                file=sys.stderr,
+            )
+
+
+if __name__ == "__main__":
+    main()
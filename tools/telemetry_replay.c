@@ -0,0 +1,307 @@
+/*
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ */
+
+/*
+ * Host replay benchmark for the telemetry_delta compressor.
+ *
+ * Replays a recorded trace through the compressor and reports the compression
+ * ratio against sending every sample as a keyframe and as JSON, the CPU time
+ * per sample and the reconstruction error of each channel. The trace is CSV
+ * with one sample per line and one column per channel, e.g. captured from the
+ * env_sensor_data JSON payloads.
+ *
+ * Build and run from the repository root:
+ *   cc -O2 -ICommon/include tools/telemetry_replay.c Common/app/telemetry_delta.c -lm -o telemetry_replay
+ *   ./telemetry_replay -e -2,-1,-2,-2 -d 5,5,5,10 -k 60 trace.csv
+ *
+ * Record sizes are the CBOR sizes produced by xTelemetryEncodeDelta.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "telemetry_delta.h"
+
+#define REPLAY_MAX_LINE    1024
+
+typedef struct
+{
+    double dMaxError;
+    double dSumSqError;
+} ChannelError_t;
+
+static uint32_t ulNumChannels = 0;
+static int8_t pcExponents[ TELEMETRY_DELTA_MAX_CHANNELS ];
+static uint32_t pulDeadbands[ TELEMETRY_DELTA_MAX_CHANNELS ];
+
+/*-----------------------------------------------------------*/
+
+/* Size of a CBOR unsigned or negative integer head */
+static size_t prvCborIntSize( int64_t llValue )
+{
+    uint64_t ullArg = ( llValue < 0 ) ? ( uint64_t ) ( -1 - llValue ) : ( uint64_t ) llValue;
+
+    return ( ullArg < 24 ) ? 1 :
+           ( ullArg <= 0xFF ) ? 2 :
+           ( ullArg <= 0xFFFF ) ? 3 :
+           ( ullArg <= 0xFFFFFFFF ) ? 5 : 9;
+}
+
+/* Indefinite length array: start byte, schema id, ..., break byte */
+static size_t prvRecordSize( const TelemetryDelta_t * pxDelta,
+                             TelemetryDeltaAction_t xAction )
+{
+    size_t xSize = 2 + prvCborIntSize( 1 ) + prvCborIntSize( pxDelta->ulSeq );
+
+    if( xAction == TELEMETRY_DELTA_KEYFRAME )
+    {
+        for( uint32_t i = 0; i < pxDelta->ulNumChannels; i++ )
+        {
+            xSize += prvCborIntSize( pxDelta->pllLast[ i ] );
+        }
+    }
+    else
+    {
+        xSize += prvCborIntSize( 0x8000 ) - prvCborIntSize( 1 );
+        xSize += prvCborIntSize( pxDelta->ulChangedMask );
+
+        for( uint32_t i = 0; i < pxDelta->ulNumChannels; i++ )
+        {
+            if( ( pxDelta->ulChangedMask & ( 1UL << i ) ) != 0 )
+            {
+                xSize += prvCborIntSize( pxDelta->pllDelta[ i ] );
+            }
+        }
+    }
+
+    return xSize;
+}
+
+static size_t prvJsonSize( const float * pfValues )
+{
+    char pcBuf[ REPLAY_MAX_LINE ];
+    size_t xOffset = 0;
+
+    for( uint32_t i = 0; i < ulNumChannels; i++ )
+    {
+        xOffset += ( size_t ) snprintf( &( pcBuf[ xOffset ] ), sizeof( pcBuf ) - xOffset,
+                                        "%s\"channel_%lu\": %f", ( i == 0 ) ? "{ " : ", ",
+                                        ( unsigned long ) i, ( double ) pfValues[ i ] );
+    }
+
+    return xOffset + 2;
+}
+
+static uint32_t prvParseList( const char * pcList,
+                              long * plOut )
+{
+    uint32_t ulCount = 0;
+    char * pcEnd = NULL;
+
+    while( ( *pcList != '\0' ) && ( ulCount < TELEMETRY_DELTA_MAX_CHANNELS ) )
+    {
+        plOut[ ulCount++ ] = strtol( pcList, &pcEnd, 10 );
+        pcList = ( *pcEnd == ',' ) ? pcEnd + 1 : pcEnd;
+
+        if( pcEnd == pcList )
+        {
+            break;
+        }
+    }
+
+    return ulCount;
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    static TelemetryDelta_t xDelta;
+    ChannelError_t pxErrors[ TELEMETRY_DELTA_MAX_CHANNELS ] = { 0 };
+    int64_t pllReceiver[ TELEMETRY_DELTA_MAX_CHANNELS ] = { 0 };
+    long plList[ TELEMETRY_DELTA_MAX_CHANNELS ];
+    uint32_t ulKeyframe = 60;
+    const char * pcPath = NULL;
+    FILE * pxFile = stdin;
+    char pcLine[ REPLAY_MAX_LINE ];
+    uint64_t ullSamples = 0, ullRecords = 0, ullBytes = 0, ullKeyframeBytes = 0, ullJsonBytes = 0;
+    double dSeconds = 0.0;
+    uint32_t ulNumExp = 0, ulNumDb = 0;
+
+    for( int i = 1; i < argc; i++ )
+    {
+        if( ( strcmp( argv[ i ], "-e" ) == 0 ) && ( i + 1 < argc ) )
+        {
+            ulNumExp = prvParseList( argv[ ++i ], plList );
+
+            for( uint32_t j = 0; j < ulNumExp; j++ )
+            {
+                pcExponents[ j ] = ( int8_t ) plList[ j ];
+            }
+        }
+        else if( ( strcmp( argv[ i ], "-d" ) == 0 ) && ( i + 1 < argc ) )
+        {
+            ulNumDb = prvParseList( argv[ ++i ], plList );
+
+            for( uint32_t j = 0; j < ulNumDb; j++ )
+            {
+                pulDeadbands[ j ] = ( uint32_t ) plList[ j ];
+            }
+        }
+        else if( ( strcmp( argv[ i ], "-k" ) == 0 ) && ( i + 1 < argc ) )
+        {
+            ulKeyframe = ( uint32_t ) strtoul( argv[ ++i ], NULL, 10 );
+        }
+        else
+        {
+            pcPath = argv[ i ];
+        }
+    }
+
+    if( ( pcPath != NULL ) && ( ( pxFile = fopen( pcPath, "r" ) ) == NULL ) )
+    {
+        perror( pcPath );
+        return 1;
+    }
+
+    while( fgets( pcLine, sizeof( pcLine ), pxFile ) != NULL )
+    {
+        float pfValues[ TELEMETRY_DELTA_MAX_CHANNELS ];
+        int64_t pllValues[ TELEMETRY_DELTA_MAX_CHANNELS ];
+        uint32_t ulCount = 0;
+        char * pcToken = strtok( pcLine, ",; \t\r\n" );
+
+        while( ( pcToken != NULL ) && ( ulCount < TELEMETRY_DELTA_MAX_CHANNELS ) )
+        {
+            pfValues[ ulCount++ ] = strtof( pcToken, NULL );
+            pcToken = strtok( NULL, ",; \t\r\n" );
+        }
+
+        if( ( ulCount == 0 ) || ( pcLine[ 0 ] == '#' ) )
+        {
+            continue;
+        }
+
+        if( ulNumChannels == 0 )
+        {
+            ulNumChannels = ulCount;
+            vTelemetryDeltaInit( &xDelta, ulNumChannels, pulDeadbands, ulKeyframe );
+        }
+        else if( ulCount != ulNumChannels )
+        {
+            fprintf( stderr, "Skipping sample with %lu channels\n", ( unsigned long ) ulCount );
+            continue;
+        }
+
+        struct timespec xStart, xEnd;
+        TelemetryDeltaAction_t xAction;
+
+        ( void ) clock_gettime( CLOCK_MONOTONIC, &xStart );
+
+        for( uint32_t i = 0; i < ulNumChannels; i++ )
+        {
+            pllValues[ i ] = llTelemetryQuantize( pfValues[ i ], pcExponents[ i ] );
+        }
+
+        xAction = xTelemetryDeltaUpdate( &xDelta, pllValues );
+
+        ( void ) clock_gettime( CLOCK_MONOTONIC, &xEnd );
+
+        dSeconds += ( double ) ( xEnd.tv_sec - xStart.tv_sec ) + ( double ) ( xEnd.tv_nsec - xStart.tv_nsec ) * 1e-9;
+
+        ullSamples++;
+        ullJsonBytes += prvJsonSize( pfValues );
+        ullKeyframeBytes += 2 + prvCborIntSize( 1 ) + prvCborIntSize( ullSamples );
+
+        for( uint32_t i = 0; i < ulNumChannels; i++ )
+        {
+            ullKeyframeBytes += prvCborIntSize( pllValues[ i ] );
+        }
+
+        /* Apply the record the way a receiver would */
+        if( xAction != TELEMETRY_DELTA_SKIP )
+        {
+            ullRecords++;
+            ullBytes += prvRecordSize( &xDelta, xAction );
+
+            for( uint32_t i = 0; i < ulNumChannels; i++ )
+            {
+                if( xAction == TELEMETRY_DELTA_KEYFRAME )
+                {
+                    pllReceiver[ i ] = xDelta.pllLast[ i ];
+                }
+                else if( ( xDelta.ulChangedMask & ( 1UL << i ) ) != 0 )
+                {
+                    pllReceiver[ i ] += xDelta.pllDelta[ i ];
+                }
+            }
+        }
+
+        for( uint32_t i = 0; i < ulNumChannels; i++ )
+        {
+            double dValue = ( double ) pllReceiver[ i ] * pow( 10.0, pcExponents[ i ] );
+            double dError = fabs( dValue - ( double ) pfValues[ i ] );
+
+            if( dError > pxErrors[ i ].dMaxError )
+            {
+                pxErrors[ i ].dMaxError = dError;
+            }
+
+            pxErrors[ i ].dSumSqError += dError * dError;
+        }
+    }
+
+    if( ullSamples == 0 )
+    {
+        fprintf( stderr, "No samples in the trace\n" );
+        return 1;
+    }
+
+    printf( "samples            %llu\n", ( unsigned long long ) ullSamples );
+    printf( "records sent       %llu (%.1f%%)\n", ( unsigned long long ) ullRecords, 100.0 * ( double ) ullRecords / ( double ) ullSamples );
+    printf( "bytes              %llu (%.2f per sample)\n", ( unsigned long long ) ullBytes, ( double ) ullBytes / ( double ) ullSamples );
+    printf( "ratio vs keyframes %.2f (%llu bytes)\n", ( double ) ullKeyframeBytes / ( double ) ( ullBytes ? ullBytes : 1 ), ( unsigned long long ) ullKeyframeBytes );
+    printf( "ratio vs JSON      %.2f (%llu bytes)\n", ( double ) ullJsonBytes / ( double ) ( ullBytes ? ullBytes : 1 ), ( unsigned long long ) ullJsonBytes );
+    printf( "cpu per sample     %.1f ns\n", dSeconds * 1e9 / ( double ) ullSamples );
+
+    for( uint32_t i = 0; i < ulNumChannels; i++ )
+    {
+        printf( "channel %-2lu         dead band %lu, max error %g, rms error %g\n",
+                ( unsigned long ) i,
+                ( unsigned long ) pulDeadbands[ i ],
+                pxErrors[ i ].dMaxError,
+                sqrt( pxErrors[ i ].dSumSqError / ( double ) ullSamples ) );
+    }
+
+    if( pxFile != stdin )
+    {
+        fclose( pxFile );
+    }
+
+    return 0;
+}
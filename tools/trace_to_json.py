@@ -0,0 +1,291 @@
+#!python
+#  FreeRTOS STM32 Reference Integration
+#
+#  Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+#
+#  Permission is hereby granted, free of charge, to any person obtaining a copy of
+#  this software and associated documentation files (the "Software"), to deal in
+#  the Software without restriction, including without limitation the rights to
+#  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+#  the Software, and to permit persons to whom the Software is furnished to do so,
+#  subject to the following conditions:
+#
+#  The above copyright notice and this permission notice shall be included in all
+#  copies or substantial portions of the Software.
+#
+#  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+#  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+#  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+#  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+#  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+#  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#
+#  https://www.FreeRTOS.org
+#  https://github.com/FreeRTOS
+
+"""Convert a "trace dump" CLI capture to Chrome trace event JSON.
+
+The output can be opened in chrome://tracing or https://ui.perfetto.dev.
+Task run time is shown on one track per task, interrupt handlers on one track
+per IRQ number and user begin / end spans (vTraceBegin / vTraceEnd) on one
+track per task. Queue events and user values are shown as instant events and
+counters.
+"""
+
+import json
+import re
+import sys
+from argparse import ArgumentParser
+
+HEADER_RE = re.compile(r"#trace hz=(?P<hz>\d+) events=(?P<events>\d+) lost=(?P<lost>\d+)")
+TASK_RE = re.compile(r"^T (?P<num>\d+) (?P<name>.*)$")
+EVENT_RE = re.compile(
+    r"^E (?P<ts>\d+) (?P<type>\w+) (?P<task>\d+) 0x(?P<arg>[0-9a-fA-F]+) "
+    r"(?P<value>\d+) (?P<flags>\d+) ?(?P<label>.*)$"
+)
+
+PID_TASKS = 1
+PID_ISR = 2
+PID_USER = 3
+
+# ucQueueType values from queue.h
+QUEUE_TYPES = {
+    0: "queue",
+    1: "mutex",
+    2: "counting semaphore",
+    3: "binary semaphore",
+    4: "recursive mutex",
+    5: "queue set",
+}
+
+
+def parse_dump(lines):
+    """Return (hz, lost, task names, events) from the lines of a trace dump."""
+    hz = None
+    lost = 0
+    tasks = {}
+    events = []
+
+    for line in lines:
+        line = line.rstrip("\r\n")
+
+        # Skip anything the console printed before the dump, such as the prompt
+        header = HEADER_RE.search(line)
+        if header:
+            hz = int(header.group("hz"))
+            lost = int(header.group("lost"))
+            tasks = {}
+            events = []
+            continue
+
+        if hz is None:
+            continue
+
+        if line.startswith("#end"):
+            break
+
+        match = TASK_RE.match(line)
+        if match:
+            tasks[int(match.group("num"))] = match.group("name")
+            continue
+
+        match = EVENT_RE.match(line)
+        if match:
+            events.append(
+                {
+                    "cycles": int(match.group("ts")),
+                    "type": match.group("type"),
+                    "task": int(match.group("task")),
+                    "arg": int(match.group("arg"), 16),
+                    "value": int(match.group("value")),
+                    "flags": int(match.group("flags")),
+                    "label": match.group("label"),
+                }
+            )
+
+    if hz is None:
+        raise ValueError("No '#trace' header found in the input.")
+
+    return hz, lost, tasks, events
+
+
+def unwrap_timestamps(events, hz):
+    """Convert the 32 bit cycle counter to microseconds from the first event."""
+    elapsed = 0
+    previous = None
+
+    for event in events:
+        if previous is not None:
+            elapsed += (event["cycles"] - previous) & 0xFFFFFFFF
+        previous = event["cycles"]
+        event["us"] = elapsed * 1e6 / hz
+
+
+def task_name(tasks, num):
+    return tasks.get(num, "task %d" % num)
+
+
+def convert(hz, lost, tasks, events):
+    unwrap_timestamps(events, hz)
+
+    trace = []
+
+    def metadata(pid, name, tid=None, thread_name=None):
+        if tid is None:
+            trace.append(
+                {"ph": "M", "name": "process_name", "pid": pid, "args": {"name": name}}
+            )
+        else:
+            trace.append(
+                {
+                    "ph": "M",
+                    "name": "thread_name",
+                    "pid": pid,
+                    "tid": tid,
+                    "args": {"name": thread_name},
+                }
+            )
+
+    metadata(PID_TASKS, "Tasks")
+    metadata(PID_ISR, "Interrupts")
+    metadata(PID_USER, "User events")
+
+    seen_tasks = set()
+    seen_irqs = set()
+    running = None
+    open_isrs = {}
+
+    for event in events:
+        ts = event["us"]
+        task = event["task"]
+        kind = event["type"]
+
+        if task not in seen_tasks:
+            seen_tasks.add(task)
+            metadata(PID_TASKS, None, task, task_name(tasks, task))
+            metadata(PID_USER, None, task, task_name(tasks, task))
+
+        if kind == "switch":
+            if running is not None:
+                trace.append(
+                    {
+                        "ph": "X",
+                        "name": task_name(tasks, running[0]),
+                        "pid": PID_TASKS,
+                        "tid": running[0],
+                        "ts": running[1],
+                        "dur": ts - running[1],
+                    }
+                )
+            running = (task, ts)
+
+        elif kind in ("isr_enter", "isr_exit"):
+            irq = event["arg"]
+            if irq not in seen_irqs:
+                seen_irqs.add(irq)
+                metadata(PID_ISR, None, irq, "IRQ %d" % irq)
+
+            if kind == "isr_enter":
+                open_isrs[irq] = ts
+            elif irq in open_isrs:
+                start = open_isrs.pop(irq)
+                trace.append(
+                    {
+                        "ph": "X",
+                        "name": "IRQ %d" % irq,
+                        "pid": PID_ISR,
+                        "tid": irq,
+                        "ts": start,
+                        "dur": ts - start,
+                    }
+                )
+
+        elif kind in ("begin", "end"):
+            trace.append(
+                {
+                    "ph": "B" if kind == "begin" else "E",
+                    "name": event["label"],
+                    "pid": PID_USER,
+                    "tid": task,
+                    "ts": ts,
+                }
+            )
+
+        elif kind == "value":
+            trace.append(
+                {
+                    "ph": "C",
+                    "name": event["label"],
+                    "pid": PID_USER,
+                    "ts": ts,
+                    "args": {"value": event["value"]},
+                }
+            )
+
+        else:
+            name = event["label"] or "0x%08x" % event["arg"]
+            trace.append(
+                {
+                    "ph": "i",
+                    "s": "t",
+                    "name": "%s %s" % (kind, name),
+                    "pid": PID_TASKS,
+                    "tid": task,
+                    "ts": ts,
+                    "args": {
+                        "object": "0x%08x" % event["arg"],
+                        "kind": QUEUE_TYPES.get(event["flags"], "unknown"),
+                    },
+                }
+            )
+
+    if running is not None and events:
+        end = events[-1]["us"]
+        trace.append(
+            {
+                "ph": "X",
+                "name": task_name(tasks, running[0]),
+                "pid": PID_TASKS,
+                "tid": running[0],
+                "ts": running[1],
+                "dur": end - running[1],
+            }
+        )
+
+    return {
+        "traceEvents": trace,
+        "displayTimeUnit": "ns",
+        "otherData": {"cycle_hz": hz, "lost_events": lost},
+    }
+
+
+def main():
+    argparser = ArgumentParser(description=__doc__.splitlines()[0])
+    argparser.add_argument(
+        "input_file",
+        help="Captured console output of 'trace dump'. Defaults to stdin.",
+        nargs="?",
+    )
+    argparser.add_argument(
+        "--output", "-o", help="Output JSON file. Defaults to stdout."
+    )
+    args = argparser.parse_args()
+
+    stream = open(args.input_file, "r") if args.input_file else sys.stdin
+    with stream:
+        hz, lost, tasks, events = parse_dump(stream)
+
+    if lost:
+        print("Warning: %d events were overwritten before the dump." % lost, file=sys.stderr)
+
+    result = convert(hz, lost, tasks, events)
+
+    if args.output:
+        with open(args.output, "w") as out:
+            json.dump(result, out)
+    else:
+        json.dump(result, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()